@@ -45,6 +45,7 @@
 #include "usb_drv.h"
 #include "config.controller.h"
 #include "tasks.controller.h"
+#include "datalogfile.h"
 
 //*****************************************************************************
 // Local Functions Declarations
@@ -323,6 +324,9 @@ S16 pwr_disconnectFromBatt(void)
  */
 void pwr_shutdown(void)
 {
+	// Write out the data log file still being written behind
+	DLF_Shutdown();
+
 	// Close all open files (Note that files must be closed before suspending tasks)
 	f_closeAll();
 
@@ -179,6 +179,26 @@ S32 f_write(fHandler_t* file, const void *buf, U16 count)
 }
 
 
+//! \brief Flush cached data of a file being written.
+S16 f_sync(fHandler_t* file)
+{
+	// Sanity check
+	if(file == NULL)
+	{
+		avr32rerrno = EPARAM;
+		return FILE_FAIL;
+	}
+
+	if(FATFs_f_sync(file) != FR_OK)
+	{
+		avr32rerrno = EFERR;
+		return FILE_FAIL;
+	}
+
+	return FILE_OK;
+}
+
+
 //! \brief Read from a file.
 S32 f_read(fHandler_t* file, void *buf, U16 const count)
 {
@@ -605,6 +625,21 @@ S32 f_write(fHandler_t* file, const void *buf, U16 count)
 }
 
 
+//! \brief Flush cached data of a file being written.
+S16 f_sync(fHandler_t* file)
+{
+	// Sanity check
+	if(file == NULL || *file < 0)
+	{
+		avr32rerrno = EPARAM;
+		return FILE_FAIL;
+	}
+
+	// fsaccess writes through on every write()
+	return FILE_OK;
+}
+
+
 //! \brief Read from a file.
 S32 f_read(fHandler_t* file, void *buf, U16 count)
 {
@@ -1009,6 +1044,151 @@ S16 file_getNextListElement(char* name, U8 maxName, U32* size, Bool *isDir, stru
 #endif	// #ifdef USE_ATMEL_FS
 
 
+//-----------------------------------------------------------------------------
+// Batched writing (any file system)
+//-----------------------------------------------------------------------------
+
+// Write the staged bytes, then stage up to the next aligned offset
+static S16 batchFlush(fBatch_t* batch)
+{
+	if(batch->fill)
+	{
+		if(f_write(&batch->file, batch->buf, batch->fill) != batch->fill)
+			return FILE_FAIL;
+
+		batch->unsynced += batch->fill;
+		batch->fill = 0;
+	}
+
+	S32 pos = f_getPos(&batch->file);
+	if(pos < 0)
+		return FILE_FAIL;
+
+	batch->lead = batch->size - (U32)pos % batch->size;
+
+	return FILE_OK;
+}
+
+
+//! \brief Open a file for batched appending.
+S16 f_batchOpen(fBatch_t* batch, const char* pathname, U16 flags, U8* buf, U16 size)
+{
+	// Sanity check
+	if(batch == NULL || buf == NULL || size == 0 || size % 512)
+	{
+		avr32rerrno = EPARAM;
+		return FILE_FAIL;
+	}
+
+	batch->isOpen = FALSE;
+
+	if(f_open(pathname, flags | O_APPEND, &batch->file) != FILE_OK)
+		return FILE_FAIL;
+
+	batch->buf = buf;
+	batch->size = size;
+	batch->fill = 0;
+	batch->unsynced = 0;
+
+	// An existing file may end anywhere: the first write realigns
+	if(batchFlush(batch) != FILE_OK)
+	{
+		f_close(&batch->file);
+		return FILE_FAIL;
+	}
+
+	batch->isOpen = TRUE;
+
+	return FILE_OK;
+}
+
+
+//! \brief Append to a batched file.
+S32 f_batchWrite(fBatch_t* batch, const void* data, U32 count)
+{
+	const U8* src = data;
+	U32 done = 0;
+
+	// Sanity check
+	if(batch == NULL || data == NULL || !batch->isOpen)
+	{
+		avr32rerrno = EPARAM;
+		return -1;
+	}
+
+	while(done < count)
+	{
+		U32 n = batch->lead - batch->fill;
+
+		if(batch->fill == 0 && count - done >= n)
+		{
+			// A whole aligned block is at hand: skip the staging copy
+			if(f_write(&batch->file, src + done, n) != (S32)n)
+				return -1;
+
+			batch->unsynced += n;
+			batch->lead = batch->size;
+			done += n;
+			continue;
+		}
+
+		if(n > count - done)
+			n = count - done;
+
+		memcpy(batch->buf + batch->fill, src + done, n);
+		batch->fill += n;
+		done += n;
+
+		if(batch->fill == batch->lead && batchFlush(batch) != FILE_OK)
+			return -1;
+	}
+
+	return count;
+}
+
+
+//! \brief Checkpoint: write staged data and sync the file.
+S16 f_batchSync(fBatch_t* batch)
+{
+	// Sanity check
+	if(batch == NULL || !batch->isOpen)
+	{
+		avr32rerrno = EPARAM;
+		return FILE_FAIL;
+	}
+
+	if(batchFlush(batch) != FILE_OK)
+		return FILE_FAIL;
+
+	if(f_sync(&batch->file) != FILE_OK)
+		return FILE_FAIL;
+
+	batch->unsynced = 0;
+
+	return FILE_OK;
+}
+
+
+//! \brief Write staged data and close the file.
+S16 f_batchClose(fBatch_t* batch)
+{
+	// Sanity check
+	if(batch == NULL || !batch->isOpen)
+	{
+		avr32rerrno = EPARAM;
+		return FILE_FAIL;
+	}
+
+	S16 rv = batchFlush(batch);
+
+	f_close(&batch->file);
+	batch->isOpen = FALSE;
+
+	return rv;
+}
+
+
+
 //*****************************************************************************
 // Local functions
 //*****************************************************************************
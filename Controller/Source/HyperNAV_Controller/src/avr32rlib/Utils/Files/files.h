@@ -32,7 +32,7 @@ typedef FIL fHandler_t;
 //*****************************************************************************
 // Config
 //*****************************************************************************
-#define FILE_MAX_FILES	4	//!< Maximum simultaneous files open
+#define FILE_MAX_FILES	6	//!< Maximum simultaneous files open
 
 
 //*****************************************************************************
@@ -69,6 +69,21 @@ typedef FIL fHandler_t;
 // Exported data types
 //*****************************************************************************
 
+//! Batched sequential writer.
+//! Keeps a file open and stages data in a caller supplied buffer,
+//! writing it out in whole buffers at offsets that are a multiple of
+//! the buffer size. With a buffer size dividing the cluster size, every
+//! write covers whole sectors of one cluster.
+typedef struct {
+	fHandler_t	file;
+	U8*		buf;		//!< Staging buffer
+	U16		size;		//!< Staging buffer size, a multiple of 512
+	U16		fill;		//!< Bytes staged
+	U16		lead;		//!< Bytes to stage until the next aligned offset
+	U32		unsynced;	//!< Bytes written since the last sync
+	Bool		isOpen;
+} fBatch_t;
+
 
 //*****************************************************************************
 // Exported functions
@@ -105,6 +120,12 @@ S16 f_close(fHandler_t* file);
 S32 f_write(fHandler_t* file, const void *buf, U16 count);
 
 
+//! \brief Flush cached data and directory entry of a file being written.
+//! @param file  File handler
+//! @return FILE_OK: Success	FILE_FAIL: Error, check 'nsyserrno'
+S16 f_sync(fHandler_t* file);
+
+
 //! \brief Read from a file.
 //! @param file  File handler
 //! @param buf   Pointer for data that are read.
@@ -153,6 +174,37 @@ S32 f_getSize(fHandler_t* file);
 
 
 
+//-----------------------------------------------------------------------------
+// BATCHED WRITING
+//-----------------------------------------------------------------------------
+
+//! \brief Open a file for batched appending.
+//! @param batch	Writer to initialize
+//! @param pathname	A file path in the "x:\\file.ext" format
+//! @param flags	f_open() flags, O_APPEND is implied
+//! @param buf		Staging buffer, kept in use until f_batchClose()
+//! @param size		Staging buffer size, a multiple of 512
+//! @return FILE_OK: Success	FILE_FAIL: Error, check 'nsyserrno'
+S16 f_batchOpen(fBatch_t* batch, const char* pathname, U16 flags, U8* buf, U16 size);
+
+
+//! \brief Append to a batched file.
+//! Only full staging buffers are written to the file.
+//! @return Amount of data accepted (-1 if error)
+S32 f_batchWrite(fBatch_t* batch, const void* data, U32 count);
+
+
+//! \brief Checkpoint: write staged data and sync the file.
+//! @return FILE_OK: Success	FILE_FAIL: Error, check 'nsyserrno'
+S16 f_batchSync(fBatch_t* batch);
+
+
+//! \brief Write staged data and close the file.
+//! @return FILE_OK: Success	FILE_FAIL: Error, check 'nsyserrno'
+S16 f_batchClose(fBatch_t* batch);
+
+
+
 //-----------------------------------------------------------------------------
 // FILE SYSTEM HANDLING
 //-----------------------------------------------------------------------------
@@ -0,0 +1,11 @@
+/*! \file FreeRTOS.h (host build) ***********************************************
+ *
+ * \brief Stand-in for the FreeRTOS header included by ffconf.h.
+ *
+  ***************************************************************************/
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+typedef void* xSemaphoreHandle;
+
+#endif
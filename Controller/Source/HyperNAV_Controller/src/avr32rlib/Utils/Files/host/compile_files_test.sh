@@ -0,0 +1,23 @@
+#!/bin/sh
+
+#  Build the host test of the file library over a RAM disk.
+#  files.c and FatFs are compiled unchanged; this folder provides
+#  the RAM disk diskio and stand-ins for the AVR32/FreeRTOS headers.
+#
+#  Usage:  sh compile_files_test.sh
+#          ./files_test                  # 8 kB clusters, 8 kB staging
+#          ./files_test -c 32768 -b 16384 -n 2000
+
+gcc \
+     -O2 -Wall \
+     -o files_test \
+     -I . \
+     -I .. \
+     -I ../FATFs \
+     -I ../../Errno \
+     -I ../../../../../../../../Shared/FirmwareDefinitions \
+     ../files.c \
+     ../FATFs/ff.c \
+     ../../Errno/avr32rerrno.c \
+     diskio_ramdisk.c \
+     files_test.c
@@ -0,0 +1,30 @@
+/*! \file compiler.h (host build) ***********************************************
+ *
+ * \brief Types of the AVR32 framework compiler.h used by files.c,
+ *        for building the file library (and code using it) on a host.
+ *
+  ***************************************************************************/
+#ifndef _COMPILER_H_
+#define _COMPILER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint8_t		U8;
+typedef uint16_t	U16;
+typedef uint32_t	U32;
+typedef uint64_t	U64;
+typedef int8_t		S8;
+typedef int16_t		S16;
+typedef int32_t		S32;
+typedef int64_t		S64;
+typedef float		F32;
+typedef double		F64;
+typedef unsigned char	Bool;
+
+#define FALSE	0
+#define TRUE	1
+
+#define Tst_bits(lvalue, mask)	((lvalue) & (mask))
+
+#endif /* _COMPILER_H_ */
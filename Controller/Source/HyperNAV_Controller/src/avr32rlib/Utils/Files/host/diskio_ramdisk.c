@@ -0,0 +1,131 @@
+/*-----------------------------------------------------------------------*/
+/* RAM disk control module for FatFs (host builds)                       */
+/*-----------------------------------------------------------------------*/
+/* Physical drive 0 is a zeroed memory block of 512 byte sectors.
+/  Every access is counted in ramdisk_stats, so that host tests can
+/  measure how the file library drives the disk.
+/-----------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "diskio.h"
+#include "diskio_ramdisk.h"
+
+#define SS	512
+
+RAMDISK_STATS ramdisk_stats;
+
+static BYTE* Disk;
+static DWORD Sectors;
+static DSTATUS Stat = STA_NOINIT;
+
+
+int ramdisk_create (DWORD sectors)
+{
+	ramdisk_destroy();
+
+	Disk = calloc(sectors, SS);
+	if (!Disk) return -1;
+
+	Sectors = sectors;
+	memset(&ramdisk_stats, 0, sizeof(ramdisk_stats));
+	return 0;
+}
+
+
+void ramdisk_destroy (void)
+{
+	free(Disk);
+	Disk = 0;
+	Sectors = 0;
+	Stat = STA_NOINIT;
+}
+
+
+DSTATUS disk_initialize (BYTE drv)
+{
+	if (drv || !Disk) return STA_NOINIT | STA_NODISK;
+
+	Stat = 0;
+	return Stat;
+}
+
+
+DSTATUS disk_status (BYTE drv)
+{
+	if (drv) return STA_NOINIT;
+	return Stat;
+}
+
+
+DRESULT disk_read (BYTE drv, BYTE* buff, DWORD sector, BYTE count)
+{
+	if (drv || !count) return RES_PARERR;
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+	if (sector + count > Sectors) return RES_PARERR;
+
+	memcpy(buff, Disk + sector * SS, count * SS);
+
+	ramdisk_stats.reads++;
+	ramdisk_stats.read_sectors += count;
+	return RES_OK;
+}
+
+
+DRESULT disk_write (BYTE drv, const BYTE* buff, DWORD sector, BYTE count)
+{
+	if (drv || !count) return RES_PARERR;
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+	if (sector + count > Sectors) return RES_PARERR;
+
+	memcpy(Disk + sector * SS, buff, count * SS);
+
+	ramdisk_stats.writes++;
+	ramdisk_stats.write_sectors += count;
+	if (count > ramdisk_stats.max_sectors) ramdisk_stats.max_sectors = count;
+	return RES_OK;
+}
+
+
+DRESULT disk_ioctl (BYTE drv, BYTE ctrl, void* buff)
+{
+	if (drv) return RES_PARERR;
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+
+	switch (ctrl) {
+	case CTRL_SYNC:
+		ramdisk_stats.syncs++;
+		return RES_OK;
+
+	case GET_SECTOR_COUNT:
+		*(DWORD*)buff = Sectors;
+		return RES_OK;
+
+	case GET_SECTOR_SIZE:
+		*(WORD*)buff = SS;
+		return RES_OK;
+
+	case GET_BLOCK_SIZE:
+		*(DWORD*)buff = 1;
+		return RES_OK;
+	}
+
+	return RES_PARERR;
+}
+
+
+DWORD get_fattime (void)
+{
+	time_t now = time(NULL);
+	struct tm t;
+	gmtime_r(&now, &t);
+
+	return ((DWORD)(t.tm_year - 80) << 25)
+	     | ((DWORD)(t.tm_mon + 1) << 21)
+	     | ((DWORD)t.tm_mday << 16)
+	     | ((DWORD)t.tm_hour << 11)
+	     | ((DWORD)t.tm_min << 5)
+	     | ((DWORD)t.tm_sec >> 1);
+}
@@ -0,0 +1,25 @@
+/*-----------------------------------------------------------------------
+/  RAM disk for host builds of the file library
+/-----------------------------------------------------------------------*/
+
+#ifndef _DISKIO_RAMDISK
+#define _DISKIO_RAMDISK
+
+#include "integer.h"
+
+/* Counters of the disk functions, reset by ramdisk_create() */
+typedef struct {
+	unsigned long	writes;			/* disk_write() calls */
+	unsigned long	write_sectors;	/* Sectors written */
+	unsigned long	max_sectors;	/* Largest single disk_write() */
+	unsigned long	reads;			/* disk_read() calls */
+	unsigned long	read_sectors;	/* Sectors read */
+	unsigned long	syncs;			/* CTRL_SYNC requests */
+} RAMDISK_STATS;
+
+extern RAMDISK_STATS ramdisk_stats;
+
+int  ramdisk_create (DWORD sectors);	/* Allocate a zeroed disk, 0:OK */
+void ramdisk_destroy (void);
+
+#endif
@@ -0,0 +1,5 @@
+/*! \file file.h (host build) ***************************************************
+ *
+ * \brief Empty stand-in for the Atmel file system header (USE_FATFS only).
+ *
+  ***************************************************************************/
@@ -0,0 +1,279 @@
+/*! \file files_test.c **********************************************************
+ *
+ * \brief Host test of the file library over a RAM disk.
+ *
+ * Appends the spectra of a simulated profile to two files (starboard
+ * and port, interleaved as they arrive from the spectrometer board),
+ * once the way write_spec_data() used to (open, append, close per
+ * spectrum) and once through the batched writer. Both files are read
+ * back and compared, and the disk_write() traffic of each is printed
+ * as CSV.
+ *
+ * Exits 1 if data differ or the batched writer does not reduce the
+ * number of disk writes at least four-fold.
+ *
+ **********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "compiler.h"
+#include "files.h"
+#include "ff.h"
+#include "diskio.h"
+#include "diskio_ramdisk.h"
+#include "spectrometer_data.h"
+
+#define RECORD_SZ	sizeof(Spectrometer_Data_t)
+
+
+//*****************************************************************************
+// FatFs sync objects (single threaded host)
+//*****************************************************************************
+int  ff_cre_syncobj(BYTE vol, _SYNC_t* sobj)	{ (void)vol; *sobj = 0; return 1; }
+int  ff_del_syncobj(_SYNC_t sobj)		{ (void)sobj; return 1; }
+int  ff_req_grant(_SYNC_t sobj)			{ (void)sobj; return 1; }
+void ff_rel_grant(_SYNC_t sobj)			{ (void)sobj; }
+
+
+// Deterministic content of record r of a side
+static void fill_record(U8* rec, int side, int r)
+{
+	unsigned int i;
+	for(i=0; i<RECORD_SZ; i++)
+		rec[i] = (U8)(i*31 + r*7 + side*101 + (i>>8));
+}
+
+
+// Partition, format and mount the RAM disk
+static int make_volume(DWORD sectors, UINT cluster)
+{
+	static FATFS fs;
+	static BYTE work[_MAX_SS];
+	DWORD plist[] = { 100, 0, 0, 0 };
+
+	if(ramdisk_create(sectors))
+		return -1;
+
+	if(disk_initialize(0))
+		return -2;
+
+	if(FATFs_f_fdisk(0, plist, work) != FR_OK)
+		return -3;
+
+	FATFs_f_mount(0, &fs);
+	if(FATFs_f_mkfs(0, 0, cluster) != FR_OK)
+		return -4;
+	FATFs_f_mount(0, NULL);
+
+	if(!f_fsProbe())
+		return -5;
+
+	return 0;
+}
+
+
+// Compare a file with the records written to it
+static int verify(const char* name, int side, int records)
+{
+	fHandler_t fh;
+	U8 expect[RECORD_SZ], got[RECORD_SZ];
+	int r, bad = 0;
+
+	if(f_open(name, O_RDONLY, &fh) != FILE_OK)
+		return 1;
+
+	if(f_getSize(&fh) != (S32)(records*RECORD_SZ))
+		bad = 1;
+
+	for(r=0; r<records && !bad; r++)
+	{
+		fill_record(expect, side, r);
+		if(f_read(&fh, got, RECORD_SZ) != (S32)RECORD_SZ || memcmp(got, expect, RECORD_SZ))
+			bad = 1;
+	}
+
+	f_close(&fh);
+	return bad;
+}
+
+
+static void print_stats(const char* mode, int records, unsigned int staging, unsigned int cluster)
+{
+	printf("%s,%d,%u,%u,%u,%lu,%lu,%.0f,%lu,%lu\n",
+		mode, records, (unsigned int)RECORD_SZ, staging, cluster,
+		ramdisk_stats.writes, ramdisk_stats.write_sectors,
+		ramdisk_stats.writes ? 512.0*ramdisk_stats.write_sectors/ramdisk_stats.writes : 0.0,
+		ramdisk_stats.max_sectors, ramdisk_stats.syncs);
+}
+
+
+static void print_usage(const char* pn)
+{
+	printf("Host test of the batched file writer over a RAM disk\n");
+	printf("Usage: %s [-h -? -nN -cC -bB -kK]\n", pn);
+	printf("       -h, -?  Print this usage message.\n");
+	printf("       -nN     Spectra per side [default: 500]\n");
+	printf("       -cC     Cluster size in bytes [default: 8192]\n");
+	printf("       -bB     Staging buffer size in bytes [default: 8192]\n");
+	printf("       -kK     Checkpoint (f_batchSync) every K bytes [default: 65536]\n");
+	printf("Writes CSV to stdout: one line for open/append/close per spectrum,\n");
+	printf("one for the batched writer.\n");
+}
+
+
+int main(int argc, char** argv)
+{
+	int records = 500;
+	unsigned int cluster = 8192, staging = 8192, checkpoint = 65536;
+	int opt;
+
+	while((opt = getopt(argc, argv, "h?n:c:b:k:")) != -1)
+	{
+		switch(opt)
+		{
+		case 'n': records = atoi(optarg); break;
+		case 'c': cluster = atoi(optarg); break;
+		case 'b': staging = atoi(optarg); break;
+		case 'k': checkpoint = atoi(optarg); break;
+		default: print_usage(argv[0]); return 0;
+		}
+	}
+
+	if(records < 1 || staging < 512 || staging % 512 || staging > 32768)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	// Enough room for both passes
+	DWORD sectors = 2*(2*records*RECORD_SZ)/512 + 32768;
+
+	U8 rec[RECORD_SZ];
+	const char* name[2][2] = {
+		{ "0:\\ONE.SBR", "0:\\ONE.POR" },
+		{ "0:\\TWO.SBR", "0:\\TWO.POR" } };
+	int side, r, fail = 0;
+
+	printf("mode,spectra_per_side,record_bytes,staging_bytes,cluster_bytes,disk_writes,sectors_written,bytes_per_write,max_sectors_per_write,syncs\n");
+
+	//
+	//  Open, append, close per spectrum
+	//
+	if(make_volume(sectors, cluster))
+	{
+		fprintf(stderr, "Cannot create RAM disk volume\n");
+		return 1;
+	}
+
+	fHandler_t fh;
+	for(side=0; side<2; side++)
+	{
+		if(f_open(name[0][side], O_WRONLY | O_CREAT, &fh) != FILE_OK) return 1;
+		f_close(&fh);
+	}
+
+	memset(&ramdisk_stats, 0, sizeof(ramdisk_stats));
+
+	for(r=0; r<records; r++)
+	{
+		for(side=0; side<2; side++)
+		{
+			fill_record(rec, side, r);
+			if(f_open(name[0][side], O_WRONLY | O_APPEND, &fh) != FILE_OK
+			|| f_write(&fh, rec, RECORD_SZ) != (S32)RECORD_SZ)
+			{
+				fprintf(stderr, "per_spectrum: write %d failed\n", r);
+				return 1;
+			}
+			f_close(&fh);
+		}
+	}
+
+	print_stats("per_spectrum", records, 0, cluster);
+	unsigned long per_spectrum_writes = ramdisk_stats.writes;
+
+	for(side=0; side<2; side++)
+	{
+		if(verify(name[0][side], side, records))
+		{
+			fprintf(stderr, "per_spectrum: %s differs\n", name[0][side]);
+			fail = 1;
+		}
+	}
+
+	//
+	//  Batched writer
+	//
+	static fBatch_t batch[2];
+	U8* buf[2] = { malloc(staging), malloc(staging) };
+
+	for(side=0; side<2; side++)
+	{
+		if(f_open(name[1][side], O_WRONLY | O_CREAT, &fh) != FILE_OK) return 1;
+		f_close(&fh);
+	}
+
+	memset(&ramdisk_stats, 0, sizeof(ramdisk_stats));
+
+	for(side=0; side<2; side++)
+	{
+		if(f_batchOpen(&batch[side], name[1][side], O_WRONLY, buf[side], staging) != FILE_OK)
+		{
+			fprintf(stderr, "batched: cannot open %s\n", name[1][side]);
+			return 1;
+		}
+	}
+
+	for(r=0; r<records; r++)
+	{
+		for(side=0; side<2; side++)
+		{
+			fill_record(rec, side, r);
+			if(f_batchWrite(&batch[side], rec, RECORD_SZ) != (S32)RECORD_SZ)
+			{
+				fprintf(stderr, "batched: write %d failed\n", r);
+				return 1;
+			}
+			if(batch[side].unsynced >= checkpoint && f_batchSync(&batch[side]) != FILE_OK)
+			{
+				fprintf(stderr, "batched: sync %d failed\n", r);
+				return 1;
+			}
+		}
+	}
+
+	for(side=0; side<2; side++)
+	{
+		if(f_batchClose(&batch[side]) != FILE_OK)
+		{
+			fprintf(stderr, "batched: cannot close %s\n", name[1][side]);
+			fail = 1;
+		}
+	}
+
+	print_stats("batched", records, staging, cluster);
+
+	for(side=0; side<2; side++)
+	{
+		if(verify(name[1][side], side, records))
+		{
+			fprintf(stderr, "batched: %s differs\n", name[1][side]);
+			fail = 1;
+		}
+	}
+
+	if(4*ramdisk_stats.writes > per_spectrum_writes)
+	{
+		fprintf(stderr, "batched: %lu disk writes, per spectrum: %lu\n", ramdisk_stats.writes, per_spectrum_writes);
+		fail = 1;
+	}
+
+	free(buf[0]);
+	free(buf[1]);
+	ramdisk_destroy();
+
+	return fail;
+}
@@ -0,0 +1,6 @@
+/*! \file semphr.h (host build) *************************************************
+ *
+ * \brief Stand-in for the FreeRTOS header included by ffconf.h.
+ *
+  ***************************************************************************/
+#include "FreeRTOS.h"
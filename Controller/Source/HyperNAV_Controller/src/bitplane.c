@@ -0,0 +1,273 @@
+/*! \file bitplane.c
+ *
+ *  \brief Transpose spectra into bitplanes and back.
+ *
+ *         The work unit is a block of 16 pixels,
+ *         which is turned into 16 bit masks (one per pixel bit),
+ *         pixel i of the block at bit (15-i) of the mask,
+ *         so that the high byte / low byte of a mask
+ *         are the plane bytes for pixels 0..7 / 8..15 of the block.
+ *
+ *  @author BP, Satlantic
+ *  @date   2026-10-17
+ *
+ ***************************************************************************/
+
+# include "bitplane.h"
+
+# if defined(__AVX2__)
+#  include <immintrin.h>
+# elif defined(__SSE2__)
+#  include <emmintrin.h>
+# endif
+
+# if !defined(__AVX2__) && !defined(__SSE2__)
+
+//  Byte k (k=0..3, counted from the least significant byte)
+//  of nibble_spread[v] is bit k of v.
+//  Shifting the entry left by s places the bit at position s within each byte,
+//  so that OR-ing the entries of 8 pixels yields an 8x8 bit transpose.
+//
+static const uint32_t nibble_spread[16] = {
+  0x00000000, 0x00000001, 0x00000100, 0x00000101,
+  0x00010000, 0x00010001, 0x00010100, 0x00010101,
+  0x01000000, 0x01000001, 0x01000100, 0x01000101,
+  0x01010000, 0x01010001, 0x01010100, 0x01010101
+};
+
+static void block_to_masks ( const uint16_t* px, uint16_t mask[16] ) {
+
+  int b;
+  for ( b=0; b<16; b++ ) mask[b] = 0;
+
+  int half;
+  for ( half=0; half<2; half++ ) {
+
+    uint32_t b00_03 = 0, b04_07 = 0, b08_11 = 0, b12_15 = 0;
+
+    int i;
+    for ( i=0; i<8; i++ ) {
+      uint16_t const v  = px[8*half+i];
+      int      const sh = 7-i;
+      b00_03 |= nibble_spread[ v     &0x0F] << sh;
+      b04_07 |= nibble_spread[(v>> 4)&0x0F] << sh;
+      b08_11 |= nibble_spread[(v>> 8)&0x0F] << sh;
+      b12_15 |= nibble_spread[(v>>12)&0x0F] << sh;
+    }
+
+    int const to = half ? 0 : 8;
+    int k;
+    for ( k=0; k<4; k++ ) {
+      mask[   k] |= ((b00_03>>(8*k))&0xFF) << to;
+      mask[ 4+k] |= ((b04_07>>(8*k))&0xFF) << to;
+      mask[ 8+k] |= ((b08_11>>(8*k))&0xFF) << to;
+      mask[12+k] |= ((b12_15>>(8*k))&0xFF) << to;
+    }
+  }
+}
+
+static void masks_to_block ( const uint16_t mask[16], uint16_t* px ) {
+
+  int half;
+  for ( half=0; half<2; half++ ) {
+
+    //  Byte m of lo_0_3 is the low byte of pixel 3-m,
+    //  byte m of lo_4_7 is the low byte of pixel 7-m, same for hi_*.
+    uint32_t lo_0_3 = 0, lo_4_7 = 0, hi_0_3 = 0, hi_4_7 = 0;
+
+    int b;
+    for ( b=0; b<8; b++ ) {
+      uint8_t const q = half ? ( mask[b] & 0xFF ) : ( mask[b] >> 8 );
+      lo_0_3 |= nibble_spread[q>>4  ] << b;
+      lo_4_7 |= nibble_spread[q&0x0F] << b;
+    }
+    for ( b=8; b<16; b++ ) {
+      uint8_t const q = half ? ( mask[b] & 0xFF ) : ( mask[b] >> 8 );
+      hi_0_3 |= nibble_spread[q>>4  ] << (b-8);
+      hi_4_7 |= nibble_spread[q&0x0F] << (b-8);
+    }
+
+    int i;
+    for ( i=0; i<4; i++ ) {
+      px[8*half+  i] = (uint16_t)( ((hi_0_3>>(8*(3-i)))&0xFF) << 8 | ((lo_0_3>>(8*(3-i)))&0xFF) );
+      px[8*half+4+i] = (uint16_t)( ((hi_4_7>>(8*(3-i)))&0xFF) << 8 | ((lo_4_7>>(8*(3-i)))&0xFF) );
+    }
+  }
+}
+
+# endif
+
+# if defined(__SSE2__) && !defined(__AVX2__)
+
+//  Reverse the order of the 8 words in a vector
+static __m128i reverse_words ( __m128i x ) {
+  x = _mm_shufflelo_epi16 ( x, _MM_SHUFFLE(0,1,2,3) );
+  x = _mm_shufflehi_epi16 ( x, _MM_SHUFFLE(0,1,2,3) );
+  return _mm_shuffle_epi32 ( x, _MM_SHUFFLE(1,0,3,2) );
+}
+
+static void block_to_masks ( const uint16_t* px, uint16_t mask[16] ) {
+
+  __m128i const lo_byte = _mm_set1_epi16 ( 0x00FF );
+
+  //  Byte k of the packed vectors is pixel 15-k,
+  //  so that movemask bit k is pixel 15-k.
+  __m128i const a = reverse_words ( _mm_loadu_si128 ( (const __m128i*)(px  ) ) );
+  __m128i const b = reverse_words ( _mm_loadu_si128 ( (const __m128i*)(px+8) ) );
+
+  __m128i hi = _mm_packus_epi16 ( _mm_srli_epi16 ( b, 8 ), _mm_srli_epi16 ( a, 8 ) );
+  __m128i lo = _mm_packus_epi16 ( _mm_and_si128 ( b, lo_byte ), _mm_and_si128 ( a, lo_byte ) );
+
+  int k;
+  for ( k=7; k>=0; k-- ) {
+    mask[8+k] = (uint16_t)_mm_movemask_epi8 ( hi ); hi = _mm_add_epi8 ( hi, hi );
+    mask[  k] = (uint16_t)_mm_movemask_epi8 ( lo ); lo = _mm_add_epi8 ( lo, lo );
+  }
+}
+
+static void masks_to_block ( const uint16_t mask[16], uint16_t* px ) {
+
+  __m128i const sel_a = _mm_set_epi16 ( 0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, (short)0x8000 );
+  __m128i const sel_b = _mm_set_epi16 ( 0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080 );
+
+  __m128i acc_a = _mm_setzero_si128();
+  __m128i acc_b = _mm_setzero_si128();
+
+  int b;
+  for ( b=0; b<16; b++ ) {
+    if ( !mask[b] ) continue;
+    __m128i const v   = _mm_set1_epi16 ( (short)mask[b] );
+    __m128i const bit = _mm_set1_epi16 ( (short)(1<<b) );
+    acc_a = _mm_or_si128 ( acc_a, _mm_and_si128 ( _mm_cmpeq_epi16 ( _mm_and_si128 ( v, sel_a ), sel_a ), bit ) );
+    acc_b = _mm_or_si128 ( acc_b, _mm_and_si128 ( _mm_cmpeq_epi16 ( _mm_and_si128 ( v, sel_b ), sel_b ), bit ) );
+  }
+
+  _mm_storeu_si128 ( (__m128i*)(px  ), acc_a );
+  _mm_storeu_si128 ( (__m128i*)(px+8), acc_b );
+}
+
+# endif
+
+# if defined(__AVX2__)
+
+//  Two blocks (32 pixels) at a time.
+//
+static void blocks_to_masks ( const uint16_t* px, uint16_t mask0[16], uint16_t mask1[16] ) {
+
+  __m256i const lo_byte = _mm256_set1_epi16 ( 0x00FF );
+
+  //  Reverse words within each 128-bit lane, then swap the lanes:
+  //  x0 = [ p15..p8 | p7..p0 ], x1 = [ p31..p24 | p23..p16 ]
+  __m256i x0 = _mm256_loadu_si256 ( (const __m256i*)(px   ) );
+  __m256i x1 = _mm256_loadu_si256 ( (const __m256i*)(px+16) );
+  x0 = _mm256_shuffle_epi32 ( _mm256_shufflehi_epi16 ( _mm256_shufflelo_epi16 ( x0, 0x1B ), 0x1B ), 0x4E );
+  x1 = _mm256_shuffle_epi32 ( _mm256_shufflehi_epi16 ( _mm256_shufflelo_epi16 ( x1, 0x1B ), 0x1B ), 0x4E );
+  x0 = _mm256_permute4x64_epi64 ( x0, 0x4E );
+  x1 = _mm256_permute4x64_epi64 ( x1, 0x4E );
+
+  //  After packing the quad-words are [ p15..p8, p31..p24, p7..p0, p23..p16 ],
+  //  reorder to [ p15..p8, p7..p0, p31..p24, p23..p16 ].
+  __m256i hi = _mm256_packus_epi16 ( _mm256_srli_epi16 ( x0, 8 ), _mm256_srli_epi16 ( x1, 8 ) );
+  __m256i lo = _mm256_packus_epi16 ( _mm256_and_si256 ( x0, lo_byte ), _mm256_and_si256 ( x1, lo_byte ) );
+  hi = _mm256_permute4x64_epi64 ( hi, 0xD8 );
+  lo = _mm256_permute4x64_epi64 ( lo, 0xD8 );
+
+  int k;
+  for ( k=7; k>=0; k-- ) {
+    uint32_t const mh = (uint32_t)_mm256_movemask_epi8 ( hi ); hi = _mm256_add_epi8 ( hi, hi );
+    uint32_t const ml = (uint32_t)_mm256_movemask_epi8 ( lo ); lo = _mm256_add_epi8 ( lo, lo );
+    mask0[8+k] = (uint16_t)( mh      );  mask1[8+k] = (uint16_t)( mh>>16 );
+    mask0[  k] = (uint16_t)( ml      );  mask1[  k] = (uint16_t)( ml>>16 );
+  }
+}
+
+static void masks_to_block ( const uint16_t mask[16], uint16_t* px ) {
+
+  __m256i const sel = _mm256_set_epi16 ( 0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+                                         0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, (short)0x8000 );
+  __m256i acc = _mm256_setzero_si256();
+
+  int b;
+  for ( b=0; b<16; b++ ) {
+    if ( !mask[b] ) continue;
+    __m256i const v   = _mm256_set1_epi16 ( (short)mask[b] );
+    __m256i const bit = _mm256_set1_epi16 ( (short)(1<<b) );
+    acc = _mm256_or_si256 ( acc, _mm256_and_si256 ( _mm256_cmpeq_epi16 ( _mm256_and_si256 ( v, sel ), sel ), bit ) );
+  }
+
+  _mm256_storeu_si256 ( (__m256i*)px, acc );
+}
+
+# endif
+
+static void store_masks ( const uint16_t mask[16], uint8_t* planes, uint32_t plane_stride,
+                          uint16_t top_bit, uint16_t num_planes ) {
+  uint16_t n;
+  for ( n=0; n<num_planes; n++ ) {
+    uint16_t const m = mask[top_bit-n];
+    planes[0] = (uint8_t)( m >> 8   );
+    planes[1] = (uint8_t)( m &  0xFF );
+    planes += plane_stride;
+  }
+}
+
+static void load_masks ( uint16_t mask[16], const uint8_t* planes, uint32_t plane_stride,
+                         uint16_t top_bit, uint16_t num_planes ) {
+  int b;
+  for ( b=0; b<16; b++ ) mask[b] = 0;
+
+  uint16_t n;
+  for ( n=0; n<num_planes; n++ ) {
+    mask[top_bit-n] = (uint16_t)( planes[0] << 8 | planes[1] );
+    planes += plane_stride;
+  }
+}
+
+void bitplane_transpose ( const uint16_t* px, uint32_t npix,
+                          uint8_t* planes, uint32_t plane_stride,
+                          uint16_t top_bit, uint16_t num_planes ) {
+
+  if ( top_bit > 15 ) top_bit = 15;
+  if ( num_planes > top_bit+1 ) num_planes = top_bit+1;
+
+  uint16_t mask[16];
+  uint32_t p = 0;
+
+# if defined(__AVX2__)
+  uint16_t mask1[16];
+  for ( ; p+32 <= npix; p += 32 ) {
+    blocks_to_masks ( px+p, mask, mask1 );
+    store_masks ( mask,  planes + p/8,     plane_stride, top_bit, num_planes );
+    store_masks ( mask1, planes + p/8 + 2, plane_stride, top_bit, num_planes );
+  }
+  if ( p < npix ) {
+    //  Single trailing block: pad to 32 pixels
+    uint16_t tail[32] = { 0 };
+    int i;
+    for ( i=0; i<16; i++ ) tail[i] = px[p+i];
+    blocks_to_masks ( tail, mask, mask1 );
+    store_masks ( mask, planes + p/8, plane_stride, top_bit, num_planes );
+  }
+# else
+  for ( ; p < npix; p += 16 ) {
+    block_to_masks ( px+p, mask );
+    store_masks ( mask, planes + p/8, plane_stride, top_bit, num_planes );
+  }
+# endif
+}
+
+void bitplane_untranspose ( const uint8_t* planes, uint32_t plane_stride,
+                            uint16_t top_bit, uint16_t num_planes,
+                            uint16_t* px, uint32_t npix ) {
+
+  if ( top_bit > 15 ) top_bit = 15;
+  if ( num_planes > top_bit+1 ) num_planes = top_bit+1;
+
+  uint16_t mask[16];
+  uint32_t p;
+
+  for ( p=0; p < npix; p += 16 ) {
+    load_masks ( mask, planes + p/8, plane_stride, top_bit, num_planes );
+    masks_to_block ( mask, px+p );
+  }
+}
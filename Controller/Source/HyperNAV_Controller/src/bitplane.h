@@ -0,0 +1,40 @@
+/*! \file bitplane.h
+ *
+ *  \brief Transpose spectra into bitplanes and back.
+ *
+ *         Plane n (n = 0 .. num_planes-1) holds bit (top_bit-n)
+ *         of every pixel, most significant bit first within a byte,
+ *         i.e., pixel p is at bit (7-p%8) of byte p/8 of a plane.
+ *         Plane n starts at planes + n*plane_stride,
+ *         so that several spectra can be interleaved into common planes.
+ *
+ *         Pixels are handled in blocks of 16 (N_SPEC_PIX is a multiple of 16):
+ *         On the AVR32 (and any host without SIMD) an 8x8 bit transpose
+ *         is done via a nibble lookup table, on hosts with SSE2/AVX2
+ *         the transpose uses byte movemask.
+ *
+ *  @author BP, Satlantic
+ *  @date   2026-10-17
+ *
+ ***************************************************************************/
+
+# ifndef _BITPLANE_H_
+# define _BITPLANE_H_
+
+# include <stdint.h>
+
+//  npix must be a multiple of 16.
+//  Pixel bits below (top_bit-num_planes+1) are discarded.
+//
+void bitplane_transpose   ( const uint16_t* px, uint32_t npix,
+                            uint8_t* planes, uint32_t plane_stride,
+                            uint16_t top_bit, uint16_t num_planes );
+
+//  npix must be a multiple of 16.
+//  Pixel bits not held in any plane are set to zero.
+//
+void bitplane_untranspose ( const uint8_t* planes, uint32_t plane_stride,
+                            uint16_t top_bit, uint16_t num_planes,
+                            uint16_t* px, uint32_t npix );
+
+# endif // _BITPLANE_H_
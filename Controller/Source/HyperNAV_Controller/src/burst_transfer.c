@@ -0,0 +1,713 @@
+/*! \file burst_transfer.c
+ *
+ *  \brief Transmission of a profile's packets in bursts.
+ *
+ *         No I/O in here, see bt_io_t: this file is compiled unchanged
+ *         into the controller firmware and into the host harness.
+ *
+ *  @author BP, Satlantic
+ *  @date   2026-10-17
+ *
+ ***************************************************************************/
+
+# include "burst_transfer.h"
+
+# include <stdio.h>
+# include <string.h>
+
+# include "zlib.h"
+
+//  State of burst b of packet p
+//
+static uint32_t bt_bst ( bt_t const* bt, uint16_t p, int b )
+{
+  if ( b >= BST_Bursts ) return 0;
+  return ( bt->burst_status[p].w[b/BST_PerWord] >> (3*(b%BST_PerWord)) ) & 0x7;
+}
+
+static void bt_bst_set ( bt_t* bt, uint16_t p, int b, uint32_t state )
+{
+  if ( b < BST_Bursts )
+  {
+    uint32_t* const w = bt->burst_status[p].w + b/BST_PerWord;
+    *w &= ~(0x7UL<<(3*(b%BST_PerWord)));
+    *w |=  (state<<(3*(b%BST_PerWord)));
+  }
+}
+
+static void bt_bst_all ( bt_t* bt, uint16_t p, uint32_t state )
+{
+  int b;
+  memset ( bt->burst_status+p, 0, sizeof(Burst_Status_t) );
+  for ( b=0; b<BST_Bursts; b++ )
+  {
+    bt->burst_status[p].w[b/BST_PerWord] |= (state<<(3*(b%BST_PerWord)));
+  }
+}
+
+static void bt_note ( bt_t* bt, char const* text )
+{
+  if ( bt->io.note ) bt->io.note ( bt->io.context, text );
+}
+
+static void bt_record ( bt_t* bt, uint16_t p )
+{
+  if ( bt->io.record ) bt->io.record ( bt->io.context, p );
+}
+
+void bt_init ( bt_t* bt, bt_io_t const* io )
+{
+  memset ( bt, 0, sizeof(bt_t) );
+
+  bt->io            = *io;
+  bt->poll_ms       = 500;
+  bt->in_transfer   = NO_PACKET_IN_TRANSFER;
+  bt->timed_packet  = NO_PACKET_IN_TRANSFER;
+  bt->mode_reply[0] = -1;
+  bt->mode_reply[1] = -1;
+}
+
+void bt_profile ( bt_t* bt, uint16_t profileID, uint16_t numPackets,
+                  Packet_Status_t* packet_status, uint16_t* packet_bursts, Burst_Status_t* burst_status )
+{
+  bt->profileID     = profileID;
+  bt->numPackets    = numPackets;
+  bt->packet_status = packet_status;
+  bt->packet_bursts = packet_bursts;
+  bt->burst_status  = burst_status;
+  bt->in_transfer   = NO_PACKET_IN_TRANSFER;
+
+  uint16_t p;
+  for ( p=0; p<numPackets; p++ )
+  {
+    packet_status[p] = PCK_Unsent;
+    packet_bursts[p] = 0;
+    bt_bst_all ( bt, p, BST_Unsent );
+  }
+}
+
+//  burst_status holds at most BST_Bursts-2 data bursts,
+//  between burst 0 and the terminating burst.
+//
+int bt_burst_count ( int nData, int burst_size )
+{
+  int const nB = 1 + ( nData - 1 ) / burst_size;
+  return ( nB <= BST_Bursts-2 ) ? nB : BST_Bursts-2;
+}
+
+void bt_sts_line ( bt_t const* bt, uint16_t p, char* line )
+{
+  int n = snprintf ( line, BT_STS_LINE+1, "%03hu %c %03hu ",
+                     p, "USC"[bt->packet_status[p]], bt->packet_bursts[p] );
+  int b;
+  for ( b=0; b<BST_Bursts; b+=4 )
+  {
+    int digit = 0, j;
+    for ( j=0; j<4; j++ )
+    {
+      if ( BST_Confirmed & bt_bst ( bt, p, b+j ) ) digit |= 1<<j;
+    }
+    line[n++] = "0123456789ABCDEF"[digit];
+  }
+  line[n++] = '\r';
+  line[n++] = '\n';
+  line[n]   = 0;
+}
+
+//  Burst b confirmed in the map of a record or a HELD reply
+//
+static int bt_map_bit ( char const* map, int b )
+{
+  int const digit = ( map[b/4] <= '9' ) ? map[b/4]-'0' : map[b/4]-'A'+10;
+  return digit & (1<<(b%4));
+}
+
+int bt_sts_parse ( bt_t* bt, uint16_t p, char const* line )
+{
+  uint16_t pp, nB;
+  char pck;
+  int n = 0;
+
+  if ( 3 != sscanf ( line, "%hu %c %hu %n", &pp, &pck, &nB, &n ) || !n || pp != p || nB > BST_Bursts-2 ) return -1;
+
+  char const* map = line + n;
+  int i;
+  for ( i=0; i<BT_STS_MAP; i++ )
+  {
+    if ( !( ( '0' <= map[i] && map[i] <= '9' ) || ( 'A' <= map[i] && map[i] <= 'F' ) ) ) return -1;
+  }
+
+  bt->packet_bursts[p] = nB;
+
+  int b;
+  if ( 'C' == pck )
+  {
+    bt->packet_status[p] = PCK_Confirmed;
+    bt_bst_all ( bt, p, BST_Confirmed );
+  }
+  else if ( nB )
+  {
+    bt->packet_status[p] = PCK_Unsent;
+    memset ( bt->burst_status+p, 0, sizeof(Burst_Status_t) );
+    for ( b=0; b<BST_Bursts; b++ )
+    {
+      if      ( 0 == b || b > nB )      bt_bst_set ( bt, p, b, BST_Unsent );
+      else if ( bt_map_bit ( map, b ) ) bt_bst_set ( bt, p, b, BST_Confirmed );
+      else                              bt_bst_set ( bt, p, b, BST_Sent );
+    }
+  }
+
+  return 0;
+}
+
+void bt_session ( bt_t* bt )
+{
+  if ( !bt->good ) bt->good = bt->fixed_burst;
+
+  bt->target       = bt->adapt ? bt->good : bt->fixed_burst;
+  bt->sent         = 0;
+  bt->asked        = 0;
+  bt->clean        = 0;
+  bt->rtt          = 0;
+  bt->Bps          = 0;
+  bt->timed_packet = NO_PACKET_IN_TRANSFER;
+}
+
+//  Before the burst 0 of a packet not yet split:
+//  shrink on loss, grow on a clean run, and with a window,
+//  keep bursts large enough to fill the link for a round trip.
+//
+static void bt_burst_adapt ( bt_t* bt )
+{
+  if ( !bt->adapt ) return;
+
+  uint32_t target = bt->target;
+
+  if ( bt->asked && bt->asked * BT_BURST_LOSSY >= bt->sent )
+  {
+    target /= 2;
+  }
+  else
+  {
+    if ( bt->clean >= BT_BURST_CLEAN )
+    {
+      target += target/2;
+      bt->clean = 0;
+    }
+
+    if ( bt->window && bt->rtt && bt->Bps )
+    {
+      uint32_t const fill = bt->Bps * bt->rtt / 1000 / bt->window;
+      if ( target < fill ) target = fill;
+    }
+  }
+
+  if ( target < BT_BURST_MIN ) target = BT_BURST_MIN;
+  if ( target > BT_BURST_MAX ) target = BT_BURST_MAX;
+
+  if ( target != bt->target )
+  {
+    char mmm[40];
+    snprintf ( mmm, sizeof(mmm), "Burst %hu %hu/%hu %lu\r\n", (uint16_t)target,
+               bt->asked, bt->sent, (unsigned long)bt->rtt );
+    bt_note ( bt, mmm );
+
+    bt->target = target;
+    bt->sent   = 0;
+    bt->asked  = 0;
+  }
+  else if ( bt->sent > 4*BT_BURST_LOSSY )
+  {
+    //  Let the ratio follow the link
+    bt->sent  /= 2;
+    bt->asked /= 2;
+  }
+}
+
+//  Data burst b of packet p, of the given size,
+//  went out between send_ms and now.
+//
+static void bt_burst_sent_at ( bt_t* bt, uint16_t p, int b, int size, uint32_t send_ms )
+{
+  uint32_t const now = bt->io.now_ms ( bt->io.context );
+  uint32_t const ms  = now - send_ms;
+
+  if ( ms )
+  {
+    uint32_t const Bps = 1000UL * size / ms;
+    bt->Bps = bt->Bps ? ( 7*bt->Bps + Bps ) / 8 : Bps;
+  }
+
+  if ( p != bt->timed_packet )
+  {
+    bt->timed_packet = p;
+    memset ( bt->timed_ms,     0, sizeof(bt->timed_ms) );
+    memset ( bt->timed_resent, 0, sizeof(bt->timed_resent) );
+  }
+
+  if ( b < BST_Bursts )
+  {
+    if ( bt->timed_ms[b] ) bt->timed_resent[b] = 1;
+    bt->timed_ms[b] = now;
+  }
+  bt->sent++;
+}
+
+//  Data burst b of packet p was acknowledged.
+//  Bursts sent more than once are not timed: which one was acknowledged?
+//
+static void bt_burst_acked ( bt_t* bt, uint16_t p, int b )
+{
+  bt->clean++;
+
+  if ( p != bt->timed_packet || b >= BST_Bursts || !bt->timed_ms[b] ) return;
+
+  if ( !bt->timed_resent[b] )
+  {
+    uint32_t const ms = bt->io.now_ms ( bt->io.context ) - bt->timed_ms[b];
+    bt->rtt = bt->rtt ? ( 7*bt->rtt + ms ) / 8 : ms;
+  }
+  bt->timed_ms[b] = 0;
+}
+
+//  Data burst b of packet p was asked for again
+//
+static void bt_burst_asked_for ( bt_t* bt, uint16_t p, int b )
+{
+  bt->asked++;
+  bt->clean = 0;
+  if ( p == bt->timed_packet && b < BST_Bursts ) bt->timed_resent[b] = 1;
+}
+
+//  Replies of the receiver (see ProfileManager/profile_receive.c), one per line:
+//    "RXED,hynv,profl,pckt,999,CRC"       packet received
+//    "RSND,hynv,profl,pckt,brs,CRC"       resend burst brs, or the packet (999)
+//    "HELD,hynv,profl,pckt,nbr,map,CRC"   bursts received of the packet, in reply to its burst 0.
+//                                         One hex digit per 4 bursts, bursts 0..3 first.
+//  and with a sliding window or repair bursts:
+//    "WNDW,hynv,profl,rep,win,CRC"        repair bursts and window granted, in reply to the offer
+//    "ACKD,hynv,profl,pckt,brs,CRC"       data bursts 1..brs received
+//    "RSND,hynv,profl,pckt,brs,CRC"       also as soon as a burst arrives damaged, or past a missing one
+//  and with binary framing:
+//    "MODE,hynv,profl,0000,mds,CRC"       modes granted, in reply to the offer
+//    "MODE,hynv,profl,0001,ok,CRC"        probe burst received intact (1) or not (0)
+//  The CRC is over all characters in front of it.
+//
+//  Returns 1 if this is an RXED or HELD reply on packet wait_packet.
+//
+static int bt_reply ( bt_t* bt, char* reply, uint16_t wait_packet )
+{
+  char type[5];
+  uint16_t hynv, prof, p, value;
+  int n = 0;
+
+  if ( 5 != sscanf ( reply, "%4[A-Z],%hu,%hu,%hu,%hu,%n", type, &hynv, &prof, &p, &value, &n ) || !n )
+    return 0;
+
+  char* map = reply + n;
+  char* end = map;
+
+  if ( 0 == strcmp ( type, "HELD" ) )
+  {
+    while ( ( '0' <= *end && *end <= '9' ) || ( 'A' <= *end && *end <= 'F' ) ) end++;
+    if ( ',' != *end ) return 0;
+    end++;
+  }
+
+  unsigned long crc;
+  if ( 8 != strlen ( end ) || 1 != sscanf ( end, "%8lX", &crc ) ) return 0;
+
+  uLong calc = crc32 ( 0L, Z_NULL, 0 );
+        calc = crc32 ( calc, (Bytef*)reply, end-reply );
+
+  if ( calc != crc || prof != bt->profileID ) return 0;
+
+  if ( 0 == strcmp ( type, "WNDW" ) )
+  {
+    //  The packet field holds the repair bursts granted
+    bt->window = ( value < bt->offer_window ) ? value : bt->offer_window;
+    bt->repair = ( p     < bt->offer_repair ) ? p     : bt->offer_repair;
+    return 0;
+  }
+
+  if ( 0 == strcmp ( type, "MODE" ) )
+  {
+    if ( p < 2 ) bt->mode_reply[p] = value;
+    return 0;
+  }
+
+  if ( p >= bt->numPackets ) return 0;
+
+  //  The record of packet p before this reply: Only a change goes to the eMMC
+  char record[BT_STS_LINE+1];
+  bt_sts_line ( bt, p, record );
+
+  int b;
+
+  if ( 0 == strcmp ( type, "ACKD" ) )
+  {
+    for ( b=1; b<=value && b<BST_Bursts; b++ )
+    {
+      if ( BST_Sent & bt_bst ( bt, p, b ) ) bt_burst_acked ( bt, p, b );
+      bt_bst_set ( bt, p, b, BST_Confirmed );
+    }
+  }
+  else if ( 0 == strcmp ( type, "RXED" ) )
+  {
+    for ( b=1; b<=bt->packet_bursts[p] && b<BST_Bursts; b++ )
+    {
+      if ( BST_Sent & bt_bst ( bt, p, b ) ) bt_burst_acked ( bt, p, b );
+    }
+    if ( PCK_Confirmed != bt->packet_status[p] ) bt->good = bt->target;
+
+    bt->packet_status[p] = PCK_Confirmed;
+    bt_bst_all ( bt, p, BST_Confirmed );
+  }
+  else if ( 0 == strcmp ( type, "HELD" ) )
+  {
+    if ( !bt->packet_bursts[p] && value <= BST_Bursts-2 ) bt->packet_bursts[p] = value;
+
+    for ( b=0; b<BST_Bursts && map+b/4 < end-1; b++ )
+    {
+      if ( bt_map_bit ( map, b ) ) bt_bst_set ( bt, p, b, BST_Confirmed );
+    }
+  }
+  else if ( 0 == strcmp ( type, "RSND" ) )
+  {
+    //  Also if confirmed: Assume the earlier confirmation was in error
+    //
+    uint16_t const nB = bt->packet_bursts[p];
+
+    if ( 1 <= value && value <= nB ) bt_burst_asked_for ( bt, p, value );
+
+    for ( b=0; b<BST_Bursts; b++ )
+    {
+      if ( 999 == value || b == value || b == nB+1 ) bt_bst_set ( bt, p, b, BST_Unsent );
+    }
+    bt->packet_status[p] = PCK_Unsent;
+  }
+  else
+  {
+    return 0;
+  }
+
+  char line[BT_STS_LINE+1];
+  bt_sts_line ( bt, p, line );
+  if ( strcmp ( line, record ) ) bt_record ( bt, p );
+
+  return p == wait_packet && ( 0 == strcmp ( type, "RXED" ) || 0 == strcmp ( type, "HELD" ) );
+}
+
+int bt_replies ( bt_t* bt, uint16_t wait_packet )
+{
+  int reported = 0;
+  int16_t n;
+
+  while ( 0 < ( n = bt->io.recv ( bt->io.context, bt->line + bt->have, sizeof(bt->line)-1-bt->have ) ) )
+  {
+    bt->reply_ms = bt->io.now_ms ( bt->io.context );
+    bt->have += n;
+    bt->line[bt->have] = 0;
+
+    char* start = bt->line;
+    char* eol;
+    while ( ( eol = strstr ( start, "\r\n" ) ) )
+    {
+      *eol = 0;
+      reported |= bt_reply ( bt, start, wait_packet );
+      start = eol+2;
+    }
+
+    bt->have -= ( start - bt->line );
+
+    if  ( bt->have == sizeof(bt->line)-1 )
+    {
+      //  Not a reply
+      bt->have = 0;
+    }
+
+    memmove ( bt->line, start, bt->have );
+  }
+
+  return ( n < 0 ) ? -1 : reported;
+}
+
+//  A new call: The receiver may have any of the bursts sent
+//  but not confirmed during the last call.
+//  Send burst 0 of those packets again, to ask.
+//  Also used when the window stalls, after a lost reply.
+//
+static void bt_resume_marks ( bt_t* bt )
+{
+  uint16_t p;
+  for ( p=0; p<bt->numPackets; p++ )
+  {
+    if  ( PCK_Confirmed != bt->packet_status[p]  &&  !( BST_Unsent & bt_bst ( bt, p, 0 ) ) )
+    {
+      bt_bst_set ( bt, p, 0,                     BST_Unsent );
+      bt_bst_set ( bt, p, bt->packet_bursts[p]+1, BST_Unsent );
+      bt->packet_status[p] = PCK_Unsent;
+    }
+  }
+}
+
+//  Burst 0 of packet p went out again, after a lost call or a reset.
+//  Wait for the receiver to report which bursts it has,
+//  then send the others again.
+//
+static void bt_resume_query ( bt_t* bt, uint16_t p )
+{
+  int b;
+  int resuming = 0;
+
+  for ( b=1; b<=bt->packet_bursts[p]; b++ )
+  {
+    if ( BST_Sent & bt_bst ( bt, p, b ) ) resuming = 1;
+  }
+
+  if ( !resuming ) return;
+
+  uint32_t waited;
+  for ( waited=0; waited<BT_RESUME_WAIT_MS; waited+=bt->poll_ms )
+  {
+    if ( bt_replies ( bt, p ) ) break;
+    bt->io.sleep_ms ( bt->io.context, bt->poll_ms );
+  }
+
+  for ( b=1; b<=bt->packet_bursts[p]+1; b++ )
+  {
+    if ( BST_Sent & bt_bst ( bt, p, b ) ) bt_bst_set ( bt, p, b, BST_Unsent );
+  }
+}
+
+//  Offer the receiver a window of offer_window data bursts and
+//  offer_repair repair bursts per packet, framed like burst 0:
+//  "WNDWhhhhppppp0000rrrwwww" and its CRC.
+//  Older receivers skip it as noise between bursts and never answer:
+//  window stays 0, and bursts go out one per step, without repair.
+//
+static void bt_window_offer ( bt_t* bt )
+{
+  bt->window   = 0;
+  bt->repair   = 0;
+  bt->reply_ms = bt->io.now_ms ( bt->io.context );
+
+  if ( !bt->offer_window && !bt->offer_repair ) return;
+
+  char offer[33];
+  snprintf ( offer, 25, "WNDW%04hu%05hu0000%03hu%04hu", bt->serial, bt->profileID,
+             bt->offer_repair, bt->offer_window );
+
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, (Bytef*)offer, 24 );
+  snprintf ( offer+24, 9, "%08lX", crc );
+
+  if ( bt->io.send ( bt->io.context, offer, 32 ) ) return;
+
+  uint32_t waited;
+  for ( waited=0; waited<BT_WINDOW_OFFER_MS && !bt->window && !bt->repair; waited+=bt->poll_ms )
+  {
+    bt->io.sleep_ms ( bt->io.context, bt->poll_ms );
+    bt_replies ( bt, NO_PACKET_IN_TRANSFER );
+  }
+}
+
+//  Returns 1 if the window holds no room for another data burst.
+//  Counted are the bursts sent and not acknowledged of the packet
+//  in transfer, and of packets sent to their terminating burst.
+//  Full for BT_WINDOW_STALL_MS without a reply, an acknowledgement
+//  was lost: ask the receiver which bursts it holds.
+//
+static int bt_window_full ( bt_t* bt )
+{
+  int in_flight = 0;
+  uint16_t p;
+  int b;
+
+  for ( p=0; p<bt->numPackets; p++ )
+  {
+    if ( PCK_Sent != bt->packet_status[p] && p != bt->in_transfer ) continue;
+
+    for ( b=1; b<=bt->packet_bursts[p]; b++ )
+    {
+      if ( BST_Sent & bt_bst ( bt, p, b ) ) in_flight++;
+    }
+  }
+
+  if ( in_flight < bt->window )
+  {
+    bt->was_full = 0;
+    return 0;
+  }
+
+  uint32_t const now = bt->io.now_ms ( bt->io.context );
+
+  if ( !bt->was_full )
+  {
+    bt->was_full   = 1;
+    bt->full_since = now;
+  }
+  else if ( now - bt->full_since > BT_WINDOW_STALL_MS
+         && now - bt->reply_ms   > BT_WINDOW_STALL_MS )
+  {
+    bt_resume_marks ( bt );
+    bt->was_full = 0;
+  }
+
+  return 1;
+}
+
+//  All packets went out: Let BRX terminate, then log out.
+//  Until then, the receiver may still ask for bursts to be resent.
+//
+static int bt_finish ( bt_t* bt )
+{
+  int s;
+  for ( s=0; s<BT_FINISH_S; s++ )
+  {
+    bt->io.sleep_ms ( bt->io.context, 1000 );
+    if ( bt_replies ( bt, NO_PACKET_IN_TRANSFER ) < 0 ) return BT_LINK_FAIL;
+
+    int all_confirmed = 1;
+    uint16_t p;
+    for ( p=1; p<bt->numPackets; p++ )
+    {
+      if ( PCK_Unsent == bt->packet_status[p] ) return BT_CONTINUE;
+      if ( PCK_Confirmed != bt->packet_status[p] ) all_confirmed = 0;
+    }
+    if ( all_confirmed ) break;
+  }
+
+  return BT_ALL_DONE;
+}
+
+int bt_transmission ( bt_t* bt )
+{
+  void* const context = bt->io.context;
+  char mmm[32];
+
+  if ( bt->connected && bt_replies ( bt, NO_PACKET_IN_TRANSFER ) < 0 ) return BT_LINK_FAIL;
+
+  if ( bt->in_transfer == NO_PACKET_IN_TRANSFER || bt->packet_status[bt->in_transfer] != PCK_Unsent )
+  {
+    //  No packet currently transferring. Find next packet to transfer.
+    bt->in_transfer = NO_PACKET_IN_TRANSFER;
+
+    uint16_t p;
+    for ( p=1; p<bt->numPackets; p++ )
+    {
+      if ( PCK_Unsent == bt->packet_status[p] )
+      {
+        bt->in_transfer = p;
+        if ( bt->io.retrieve ) bt->io.retrieve ( context, p );
+        break;
+      }
+    }
+
+    if ( bt->in_transfer == NO_PACKET_IN_TRANSFER )
+    {
+      int rv = BT_ALL_DONE;
+
+      if ( bt->connected )
+      {
+        rv = bt_finish ( bt );
+        if ( BT_CONTINUE == rv ) return rv;
+
+        if ( bt->io.disconnect ) bt->io.disconnect ( context );
+        bt->connected = 0;
+        if ( bt->io.call_ended ) bt->io.call_ended ( context );
+      }
+      return rv;
+    }
+  }
+
+  if ( !bt->connected || ( bt->io.carrier && !bt->io.carrier ( context ) ) )
+  {
+    //  (Re)-establish the connection
+    //
+    if ( bt->connected && bt->io.call_ended ) bt->io.call_ended ( context );
+    bt->connected = 0;
+
+    if ( bt->io.connect && bt->io.connect ( context ) ) return BT_LINK_FAIL;
+    bt->connected = 1;
+
+    //  Ask the receiver what it holds of packets
+    //  left unconfirmed by an earlier call
+    bt->have = 0;
+    bt_resume_marks ( bt );
+    bt_window_offer ( bt );
+    bt_session ( bt );
+    bt->in_transfer = NO_PACKET_IN_TRANSFER;
+    return BT_CONTINUE;
+  }
+
+  uint16_t const p    = bt->in_transfer;
+  int const      next = bt->window ? BT_SEND_NOW : BT_CONTINUE;
+  int            nB   = bt->packet_bursts[p];
+  int            b;
+
+  if ( BST_Unsent & bt_bst ( bt, p, 0 ) )
+  {
+    if ( !nB ) bt_burst_adapt ( bt );
+    if ( bt->io.burst ( context, p, bt->target, &nB, 0 ) ) return BT_CONTINUE;
+
+    if ( bt->packet_bursts[p] && nB != bt->packet_bursts[p] )
+    {
+      //  Split again: send all of it
+      bt_bst_all ( bt, p, BST_Unsent );
+    }
+    bt->packet_bursts[p] = nB;
+    bt_bst_set ( bt, p, 0, BST_Sent );
+    snprintf ( mmm, sizeof(mmm), "Txed %02hu.0\r\n", p );
+    bt_note ( bt, mmm );
+    bt_record ( bt, p );
+    bt_resume_query ( bt, p );
+    return next;
+  }
+
+  for ( b=1; b<=nB+1; b++ )
+  {
+    if ( !( BST_Unsent & bt_bst ( bt, p, b ) ) ) continue;
+
+    if ( b <= nB && bt->window && bt_window_full ( bt ) ) return BT_CONTINUE;
+
+    uint32_t const send_ms = bt->io.now_ms ( context );
+    if ( bt->io.burst ( context, p, bt->target, &nB, b ) ) continue;
+
+    if ( b <= nB ) bt_burst_sent_at ( bt, p, b, 1 + ( bt->io.size ( context, p ) - 1 ) / nB, send_ms );
+    bt_bst_set ( bt, p, b, BST_Sent );
+    snprintf ( mmm, sizeof(mmm), "Txed %02hu.%d\r\n", p, b );
+    bt_note ( bt, mmm );
+
+    if ( b == nB )
+    {
+      //  Repair bursts once, in front of the first terminating burst
+      if ( bt->repair && bt->io.repair && !( BST_Repaired & bt->burst_status[p].w[0] ) )
+      {
+        bt->io.repair ( context, p, nB, bt->repair );
+        bt->burst_status[p].w[0] |= BST_Repaired;
+      }
+
+      //  Send terminating burst immediately after last data burst
+      if ( !bt->io.burst ( context, p, bt->target, &nB, nB+1 ) ) bt_bst_set ( bt, p, nB+1, BST_Sent );
+    }
+
+    //  Terminating burst sent (also after a resent burst)
+    if ( !( BST_Unsent & bt_bst ( bt, p, nB+1 ) ) )
+    {
+      bt->packet_status[p] = PCK_Sent;
+      bt_record ( bt, p );
+    }
+    return next;
+  }
+
+  //  Nothing left to send: The receiver held all bursts
+  for ( b=1; b<=nB+1 && !( BST_Unsent & bt_bst ( bt, p, b ) ); b++ ) ;
+  if ( b > nB+1 )
+  {
+    bt->packet_status[p] = PCK_Sent;
+    bt_record ( bt, p );
+  }
+
+  return BT_CONTINUE;
+}
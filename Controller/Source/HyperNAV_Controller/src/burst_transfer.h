@@ -0,0 +1,214 @@
+/*! \file burst_transfer.h
+ *
+ *  \brief Transmission of a profile's packets in bursts.
+ *
+ *         The steps of the transmission: which packet and which burst next,
+ *         the sliding window, the adaptive burst size, the replies of the
+ *         receiver (see ProfileManager/profile_receive.c), and the wait for
+ *         the last of them. Everything outside, the link, the clock, the
+ *         packet files and the .STS records, is reached via bt_io_t.
+ *
+ *         The profile manager runs it over the modem. The host harness
+ *         ProfileManager/window_matrix.c compiles this file unchanged,
+ *         and runs it over a TCP socket.
+ *
+ *  @author BP, Satlantic
+ *  @date   2026-10-17
+ *
+ ***************************************************************************/
+
+# ifndef _BURST_TRANSFER_H_
+# define _BURST_TRANSFER_H_
+
+# include <stdint.h>
+
+//  Packets and bursts of a profile in transmission
+//
+# define NO_PACKET_IN_TRANSFER 0xFFFF
+
+typedef enum { PCK_Unsent, PCK_Sent, PCK_Confirmed } Packet_Status_t;
+
+//  Settings
+//
+# define BT_RESUME_WAIT_MS   20000   //  for the receiver to report the bursts it holds
+# define BT_WINDOW_OFFER_MS  5000    //  for the receiver to grant a window
+# define BT_WINDOW_STALL_MS  30000   //  window full, no reply: ask what the receiver holds
+# define BT_FINISH_S         75      //  for the last replies, once all packets were sent
+
+//  Adaptive burst size: halve when at least 1 in BT_BURST_LOSSY
+//  data bursts is asked for again, grow by half after BT_BURST_CLEAN
+//  acknowledged in a row.
+# define BT_BURST_MIN    512
+# define BT_BURST_MAX    8192
+# define BT_BURST_LOSSY  8
+# define BT_BURST_CLEAN  8
+
+//  Bytes of the largest packet on the wire:
+//  a data packet of MXHNV spectra, ASCII85 encoded
+# define BT_PACKET_MAX   (40*1024)
+
+//  State of the bursts of a packet: burst 0, up to BST_Bursts-2
+//  data bursts, such that the largest packet splits into bursts
+//  of BT_BURST_MIN, and the terminating burst.
+//  3 bits each, BST_PerWord to a uint32_t.
+//
+# define BST_Unsent    0x01
+# define BST_Sent      0x02
+# define BST_Confirmed 0x04
+# define BST_Bursts    ( 2 + BT_PACKET_MAX/BT_BURST_MIN )
+# define BST_PerWord   10
+# define BST_Words     ( ( BST_Bursts + BST_PerWord-1 ) / BST_PerWord )
+# define BST_Repaired  (1UL<<30)   //  in word 0, above its bursts: repair bursts were sent
+
+typedef struct {
+  uint32_t w [BST_Words];
+} Burst_Status_t;
+
+//  Return values of bt_transmission()
+//
+# define BT_ALL_DONE  0
+# define BT_CONTINUE  1   //  pause, then call again
+# define BT_LINK_FAIL 2
+# define BT_SEND_NOW  3   //  room in the window: no pause before the next burst
+
+//  The outside of the transmission.
+//  Optional functions may be 0.
+//
+typedef struct bt_io {
+
+  void*    context;
+
+  uint32_t (*now_ms)     ( void* context );
+  void     (*sleep_ms)   ( void* context, uint32_t ms );
+
+  //  What the receiver sent, without blocking: bytes read, <0 if the link is gone
+  int16_t  (*recv)       ( void* context, char* data, uint16_t size );
+  //  0 once sent
+  int      (*send)       ( void* context, char const* data, uint16_t size );
+
+  //  Optional: 1 while connected. Without it, the link is always up.
+  int      (*carrier)    ( void* context );
+  //  Optional: 0 once connected
+  int      (*connect)    ( void* context );
+  //  Optional: the call is over
+  void     (*disconnect) ( void* context );
+  //  Optional: a connected call ended, or was lost
+  void     (*call_ended) ( void* context );
+
+  //  Optional: packet p is next, have it ready
+  void     (*retrieve)   ( void* context, uint16_t p );
+  //  Burst b (0 .. *nB+1) of packet p, 0 once sent.
+  //  Burst 0 of a packet not yet split (*nB 0) sets *nB, for bursts of at most burst_size.
+  //  It may split a packet again, into another *nB.
+  int      (*burst)      ( void* context, uint16_t p, int burst_size, int* nB, int b );
+  //  Bytes of packet p sent in its data bursts
+  int      (*size)       ( void* context, uint16_t p );
+  //  Optional: the repair bursts of packet p, split into nB data bursts
+  void     (*repair)     ( void* context, uint16_t p, int nB, uint16_t nRepair );
+
+  //  Optional: the record of packet p changed
+  void     (*record)     ( void* context, uint16_t p );
+  //  Optional: a line of telemetry
+  void     (*note)       ( void* context, char const* text );
+
+} bt_io_t;
+
+typedef struct bt {
+
+  //  Settings, see bt_init()
+  //
+  bt_io_t          io;
+  uint16_t         serial;         //  HYNV_num
+  uint16_t         offer_window;   //  data bursts in flight, 0: one burst per step
+  uint16_t         offer_repair;   //  repair bursts per packet
+  uint16_t         fixed_burst;    //  burst size if not adaptive, and to start with
+  uint8_t          adapt;          //  adaptive burst size
+  uint16_t         poll_ms;        //  between looks at the replies, while waiting for one
+
+  //  The profile, see bt_profile()
+  //
+  uint16_t         profileID;
+  uint16_t         numPackets;
+  Packet_Status_t* packet_status;
+  uint16_t*        packet_bursts;  //  data bursts, 0 until burst 0 was first sent
+  Burst_Status_t*  burst_status;
+  uint16_t         in_transfer;
+
+  //  The call
+  //
+  uint8_t          connected;
+  uint16_t         window;         //  granted, 0: one burst per step
+  uint16_t         repair;         //  granted
+  int32_t          mode_reply[2];  //  MODE replies 0000 and 0001, -1 until received
+  uint32_t         reply_ms;       //  when the receiver was last heard
+  uint32_t         full_since;
+  uint8_t          was_full;
+  char             line[48 + 1000/4];
+  uint16_t         have;
+
+  //  Adaptive burst size.
+  //  A packet is split into equal bursts of at most target bytes,
+  //  once, when its burst 0 is first sent: packet_bursts[] then determines
+  //  the size of its bursts, also when resumed in a later call.
+  //
+  uint16_t         target;
+  uint16_t         good;           //  target when a packet was last confirmed
+  uint16_t         sent;           //  data bursts sent ...
+  uint16_t         asked;          //  ... and of those, asked for again
+  uint16_t         clean;          //  acknowledged in a row, none asked for again
+  uint32_t         rtt;            //  ms from sending a data burst to its acknowledgement, smoothed
+  uint32_t         Bps;            //  link rate while sending data bursts, smoothed
+  uint16_t         timed_packet;   //  whose data bursts are timed
+  uint32_t         timed_ms     [BST_Bursts];   //  when sent, 0 if not timed
+  uint8_t          timed_resent [BST_Bursts];   //  1: sent again (not timed)
+
+} bt_t;
+
+//  No call, no profile. Set the settings after.
+//
+void bt_init ( bt_t* bt, bt_io_t const* io );
+
+//  The profile to transmit, its packets all unsent
+//
+void bt_profile ( bt_t* bt, uint16_t profileID, uint16_t numPackets,
+                  Packet_Status_t* packet_status, uint16_t* packet_bursts, Burst_Status_t* burst_status );
+
+//  One step of the transmission: connect if needed,
+//  take in the replies, and send the next burst.
+//  Returns BT_ALL_DONE once all packets went out and the last replies are in.
+//
+int bt_transmission ( bt_t* bt );
+
+//  Start of a call: the burst size for its first packets
+//
+void bt_session ( bt_t* bt );
+
+//  Read what the receiver sent so far, without blocking.
+//  Returns 1 if it reported on packet wait_packet, -1 if the link is gone.
+//
+int bt_replies ( bt_t* bt, uint16_t wait_packet );
+
+//  Number of data bursts to split nData bytes into
+//
+int bt_burst_count ( int nData, int burst_size );
+
+//  Record of packet p in the .STS file:
+//    "ppp S nnn map\r\n"
+//  packet number, packet status (U/S/C), number of data bursts
+//  (0 until burst 0 was sent), and the bursts the receiver confirmed:
+//  as in its HELD reply, one hex digit per 4 bursts, bursts 0..3 first,
+//  bit 0 of a digit being the lowest numbered burst of the digit.
+//
+# define BT_STS_MAP  ( ( BST_Bursts + 3 ) / 4 )
+# define BT_STS_LINE ( 10 + BT_STS_MAP + 2 )
+
+void bt_sts_line ( bt_t const* bt, uint16_t p, char* line );
+
+//  Restore packet p from its record.
+//  Data bursts sent but not confirmed are marked BST_Sent:
+//  Burst 0 goes out again to ask the receiver if it has them.
+//  Returns 0 if the record is of packet p.
+//
+int bt_sts_parse ( bt_t* bt, uint16_t p, char const* line );
+
+# endif
@@ -25,6 +25,7 @@
 # include "profile_packet.shared.h"
 # include "sram_memory_map.controller.h"
 # include "spi.controller.h"
+# include "spi_link.h"
 
 # include "io_funcs.controller.h"
 //# include "syslog.h"
@@ -48,6 +49,10 @@ static xSemaphoreHandle gTaskCtrlMutex = NULL;
 # define N_RX_PACKETS 16
 static xQueueHandle rxPackets = NULL;
 
+//  Given when a packet is pushed, and by the interrupt on the other board's
+//  ready line, so that the task can sleep on it alone
+static xSemaphoreHandle wakeSemaphore = NULL;
+
 typedef union {
   Spectrometer_Data_t          Spectrometer_Data;
   OCR_Data_t                            OCR_Data;
@@ -64,26 +69,215 @@ static data_exchange_data_package_t local_data_package[N_DA_POINTERS] = { {0, 0,
 // Local Functions
 //*****************************************************************************
 
-//! Transmits a packet to the slave via SPI
-//! @param      header          Pointer to the packet header
-//! @param      header_size     Header size in bytes
-//! @param      data            Pointer to the packet data
-//! @param      data_size       Data size in bytes
-//! @return                     The number of header+data bytes transmitted
-static int16_t send_via_SPI_RAM_RAM( uint8_t* header, int16_t header_size, uint8_t* data, int16_t data_size, int16_t* tx_size ) {
+//  Flag a full package empty, once done with its data (hold its mutex)
+//
+static void data_package_emptied ( data_exchange_data_package_t* package ) {
+
+  if ( package->state == FullRAM ) {
+    package->state = EmptyRAM;
+  } else if ( package->state == FullSRAM ) {
+    package->state = EmptySRAM;
+  }
+}
+
+//  Board to board link, see data_exchange_packet.h
+//  Transmit frames in RAM, the receive frame in SRAM (spectrum sized)
+static SPI_Link_t board_link;
+static uint8_t    link_tx[2][DE_LINK_CTRL_FRAME];
+
+static SPI_Link_Transport_t const link_transport = { 0, SPI_link_send, SPI_link_receive };
+
+typedef char link_rx_fits_sram[ ( DE_LINK_SPEC_FRAME <= SRAM_DXC_LINK_SIZE ) ? 1 : -1 ];
+typedef char link_config_fits_frame[ ( SPI_LINK_HEAD + SPI_LINK_RECORD + DE_LINK_HEADER_SIZE
+                                      + sizeof(Config_Data_t) + SPI_LINK_TAIL <= DE_LINK_CTRL_FRAME ) ? 1 : -1 ];
+
+//! Size of the value or package data of a packet
+//! @param      type            Packet type
+//! @param      usePointer      Set to 1 if the data is in a data package
+//! @return                     Data size in bytes
+static uint16_t link_data_size( data_exchange_type_t type, int* usePointer ) {
+
+  *usePointer = 0;
+
+  switch ( type ) {
+
+  case DE_Type_Nothing:              return 0;
+
+  case DE_Type_Ping:                 return sizeof(((data_exchange_packet_t*)0)->data.Ping_Message);
+  case DE_Type_Command:              return sizeof(data_exchange_command_t);
+  case DE_Type_Response:             return sizeof(data_exchange_respond_t);
+  case DE_Type_Syslog_Message:       return sizeof(data_exchange_syslog_t);
+
+  case DE_Type_Configuration_Data:   *usePointer = 1; return sizeof(        Config_Data_t);
+  case DE_Type_Spectrometer_Data:    *usePointer = 1; return sizeof(  Spectrometer_Data_t);
+//case DE_Type_OCR_Data:             *usePointer = 1; return sizeof(           OCR_Data_t);
+  case DE_Type_OCR_Frame:            *usePointer = 1; return             OCR_FRAME_LENGTH ;
+//case DE_Type_MCOMS_Data:           *usePointer = 1; return sizeof(         MCOMS_Data_t);
+  case DE_Type_MCOMS_Frame:          *usePointer = 1; return           MCOMS_FRAME_LENGTH ;
+  case DE_Type_Profile_Info_Packet:  *usePointer = 1; return sizeof(Profile_Info_Packet_t);
+  case DE_Type_Profile_Data_Packet:  *usePointer = 1; return sizeof(Profile_Data_Packet_t);
+
+  //  Do NOT add a "default:" here.
+  //  That way, the compiler will generate a warning
+  //  if one possible packet type was missed.
+
+  }
+
+  return 0;
+}
+
+//! Add a packet to the frame being filled.
+//! The data of a package is copied into the frame, and the package released.
+//! @return                     SPI_LINK_OK, SPI_LINK_FULL (flush, then try again) or SPI_LINK_FAIL
+static int16_t link_queue_packet( data_exchange_packet_t* packet ) {
+
+  int usePointer;
+  uint16_t const data_size = link_data_size( packet->type, &usePointer );
+
+  uint8_t packet_header[ DE_LINK_HEADER_SIZE ];
+
+  memcpy ( packet_header,                                   &(packet->to  ), sizeof(data_exchange_address_t) );
+  memcpy ( packet_header+  sizeof(data_exchange_address_t), &(packet->from), sizeof(data_exchange_address_t) );
+  memcpy ( packet_header+2*sizeof(data_exchange_address_t), &(packet->type), sizeof(data_exchange_type_t)    );
+
+  if ( !usePointer ) {
+    return spi_link_queue ( &board_link, packet_header, DE_LINK_HEADER_SIZE, (uint8_t const*)&(packet->data), data_size );
+  }
+
+  //  A package starts a frame of its own
+  if ( spi_link_filling ( &board_link ) ) {
+    return SPI_LINK_FULL;
+  }
+
+  int16_t queued = SPI_LINK_FAIL;
+
+  if ( pdTRUE == xSemaphoreTake ( packet->data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
+
+    if ( packet->data.DataPackagePointer->state == FullRAM
+      || packet->data.DataPackagePointer->state == FullSRAM ) {
+      queued = spi_link_queue ( &board_link, packet_header, DE_LINK_HEADER_SIZE, packet->data.DataPackagePointer->address, data_size );
+    }
+
+    //  Copied into the frame, or can never be sent: release the package
+    if ( queued != SPI_LINK_FULL ) {
+      data_package_emptied ( packet->data.DataPackagePointer );
+    }
+
+    xSemaphoreGive ( packet->data.DataPackagePointer->mutex );
+  }
+
+  if ( queued == SPI_LINK_FAIL ) {
+    io_out_S32 ( "TX Dropped %ld\r\n", (S32)packet->type );
+  }
 
-  return SPI_tx_packet( header, header_size, data, data_size, tx_size );
+  return queued;
 }
 
-//! Transmits a packet to the slave via SPI
-//! @param      header          Pointer to the packet header
-//! @param      header_size     Header size in bytes
-//! @param      data            Pointer to the packet data
-//! @param      data_size       Data size in bytes
-//! @return                     The number of header+data bytes transmitted
-static int16_t send_via_SPI_RAM_SRAM( uint8_t* header, int16_t header_size, uint8_t* data, int16_t data_size, int16_t* tx_size ) {
+//! spi_link return of a record whose frame was given up.
+//! Its package, if any, was released when copied into the frame,
+//! so the packet is only reported.
+static void link_given_up( __attribute__((unused)) void* context, uint8_t* header, uint16_t header_size,
+                           __attribute__((unused)) uint8_t* data, __attribute__((unused)) uint16_t data_size ) {
 
-  return SPI_tx_packet( header, header_size, data, data_size, tx_size );
+  data_exchange_type_t type = DE_Type_Nothing;
+
+  if ( header_size == DE_LINK_HEADER_SIZE ) {
+    memcpy ( &type, header+2*sizeof(data_exchange_address_t), sizeof(data_exchange_type_t) );
+  }
+  io_out_S32 ( "TX GivenUp %ld\r\n", (S32)type );
+}
+
+//! True if a local data package is free to receive a frame into
+static int link_package_free( void ) {
+
+  int i;
+  for ( i=0; i<N_DA_POINTERS; i++ ) {
+    if ( local_data_package[i].state == EmptySRAM ) return 1;
+  }
+  return 0;
+}
+
+//! spi_link delivery of one received record:
+//! Rebuild the packet, then pass it on, or respond to it if addressed to myself
+static void link_deliver( void* context, uint8_t* header, uint16_t header_size, uint8_t* data, uint16_t data_size ) {
+
+  data_exchange_address_t const myAddress = *(data_exchange_address_t const*)context;
+
+  data_exchange_packet_t packet_rx_via_SPI;
+
+  if ( header_size != DE_LINK_HEADER_SIZE ) {
+    io_out_S32 ( "RX HSzErr %ld\r\n", (S32)header_size );
+    return;
+  }
+
+  memcpy ( &(packet_rx_via_SPI.to  ), header                                  , sizeof(data_exchange_address_t) );
+  memcpy ( &(packet_rx_via_SPI.from), header+  sizeof(data_exchange_address_t), sizeof(data_exchange_address_t) );
+  memcpy ( &(packet_rx_via_SPI.type), header+2*sizeof(data_exchange_address_t), sizeof(data_exchange_type_t)    );
+
+  int usePointer;
+  uint16_t const expected_size = link_data_size( packet_rx_via_SPI.type, &usePointer );
+
+  if ( packet_rx_via_SPI.type == DE_Type_Nothing || data_size != expected_size ) {
+    io_out_S32 ( "RX DSzErr %ld\r\n", (S32)data_size );
+    return;
+  }
+
+  if ( !usePointer ) {
+
+    memcpy ( &(packet_rx_via_SPI.data), data, data_size );
+
+  } else {
+
+    int data_copied = 0;
+    int i;
+    for ( i=0; i<N_DA_POINTERS && !data_copied; i++) {
+      if ( pdTRUE == xSemaphoreTake ( local_data_package[i].mutex, 100 /*portMAX_DELAY*/ ) ) {
+        if ( local_data_package[i].state == EmptySRAM ) {
+          memcpy ( local_data_package[i].address, data, data_size );
+          local_data_package[i].state = FullSRAM;
+          packet_rx_via_SPI.data.DataPackagePointer = &local_data_package[i];
+          data_copied = 1;
+        }
+        xSemaphoreGive( local_data_package[i].mutex );
+      }
+    }
+
+    if ( !data_copied ) {
+      io_out_string ( "RX NoPackage\r\n" );
+      return;
+    }
+  }
+
+  if ( packet_rx_via_SPI.to == myAddress ) {
+
+    //  Only expecting Ping, ignore all others (that were sent in error!).
+
+    if ( packet_rx_via_SPI.type == DE_Type_Ping ) {
+
+      data_exchange_packet_t packet_response;
+
+      packet_response.to = packet_rx_via_SPI.from;
+      packet_response.from = myAddress;
+      packet_response.type = DE_Type_Response;
+      packet_response.data.Response.Code = RSP_ALL_Ping;
+      packet_response.data.Response.value.u64 = 0;  //  Will be ignored
+
+      data_exchange_packet_router ( myAddress, &packet_response );
+
+    } else if ( usePointer ) {
+
+      //  This is not supposed to happen.
+      //  Throw out the data, and mark the package as empty, ie. reusable
+      //
+      if ( pdTRUE == xSemaphoreTake ( packet_rx_via_SPI.data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
+        packet_rx_via_SPI.data.DataPackagePointer->state = EmptySRAM;
+        xSemaphoreGive ( packet_rx_via_SPI.data.DataPackagePointer->mutex );
+      }
+    }
+
+  } else if ( packet_rx_via_SPI.to != DE_Addr_Nobody ) {
+    data_exchange_packet_router ( myAddress, &packet_rx_via_SPI );
+  }
 }
 
 
@@ -109,12 +303,19 @@ static void data_exchange_controller( __attribute__((unused)) void* pvParameters
 # endif
   data_exchange_address_t const myAddress = DE_Addr_ControllerBoard_DataExchange;
 
+  //  A packet that did not fit the frame being filled,
+  //  it goes into the next frame ahead of the queue
+  data_exchange_packet_t pendingPacket;
+  Bool havePending = FALSE;
+
   for(;;) {
 
     if (gRunTask) {
 
       gTaskIsRunning = TRUE;
 
+      int busy = 0;
+
 uint32_t gplp  = pm_read_gplp( &AVR32_PM, 1 );
          gplp &= 0x000FFFFF;
                  pm_write_gplp( &AVR32_PM, 1, gplp );
@@ -138,14 +339,41 @@ uint32_t gplp  = pm_read_gplp( &AVR32_PM, 1 );
 
       //  The other board will indicate if it 
       //  has intention / no intention of sending something.
-      //  If the other board wants to send,
-      //  we will defer checking the in-queue for 'to-be-sent' packets,
-      //  and will first service the request from the other board.
-      if ( SPI_IND_Passive == SPI_Get_OtherBoard_Indicator() ) {
+      //  If the other board wants to send, its frame is taken first,
+      //  as soon as a package is free for the data it may carry.
+      if ( SPI_IND_Active == SPI_Get_OtherBoard_Indicator() ) {
+
+        if ( link_package_free() ) {
+
+gplp  = pm_read_gplp( &AVR32_PM, 1 );
+gplp |= 0x04000000;
+        pm_write_gplp( &AVR32_PM, 1, gplp );
+
+          int32_t const received = spi_link_receive ( &board_link, link_deliver, (void*)&myAddress );
 
+gplp  = pm_read_gplp( &AVR32_PM, 1 );
+gplp |= 0x08000000;
+        pm_write_gplp( &AVR32_PM, 1, gplp );
+
+          if ( received < 0 ) {
+            io_out_S32 ( "RX %ld\r\n", (S32)received );
+          }
+
+          busy = 1;
+        }
+
+      } else {
+
+        //  Packets for the other board fill the next frame
+        //
         data_exchange_packet_t packet_rx_via_queue;
 
-        if( pdPASS == xQueueReceive( rxPackets, &packet_rx_via_queue, 0 ) ) {
+        if ( havePending && SPI_LINK_FULL != link_queue_packet ( &pendingPacket ) ) {
+          havePending = FALSE;
+          busy = 1;
+        }
+
+        while ( !havePending && pdPASS == xQueueReceive( rxPackets, &packet_rx_via_queue, 0 ) ) {
 
           if ( packet_rx_via_queue.to == myAddress ) {
 
@@ -194,11 +422,7 @@ gplp |= 0x00100000;
               case DE_Type_Profile_Info_Packet:
               case DE_Type_Profile_Data_Packet:
                 if ( pdTRUE == xSemaphoreTake ( packet_rx_via_queue.data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
-                  if ( packet_rx_via_queue.data.DataPackagePointer->state == FullRAM ) {
-                    packet_rx_via_queue.data.DataPackagePointer->state = EmptyRAM;
-                  } else if ( packet_rx_via_queue.data.DataPackagePointer->state == FullSRAM ) {
-                    packet_rx_via_queue.data.DataPackagePointer->state = EmptySRAM;
-                  }
+                  data_package_emptied ( packet_rx_via_queue.data.DataPackagePointer );
                   xSemaphoreGive ( packet_rx_via_queue.data.DataPackagePointer->mutex );
                 }
               break;
@@ -226,528 +450,63 @@ gplp |= 0x00200000;
 
           } else {  //  The final destination of this packet is another task. -- Pass it on.
 
-# if 0
-            //  Negotiate TX/RX
-            //
-            enum { NEG_Undefined, NEG_Can_Send, NEG_Will_Receive, NEG_Conflict, NEG_No_Response } negotiation = NEG_Undefined;
-
-            //  Inform the other board that we intend to send a packet via SPI
-            SPI_Set_MyBoard_Indicator( SPI_IND_Active );
-
-            //  Wait some time (i.e., 20*HNV_DataXControlTask_PERIOD_MS/10 milliseconds
-            //  until the other board confirms that it is responsive
-            int wait = 50;
-            while ( SPI_IND_Passive == SPI_Get_OtherBoard_Indicator() && --wait>0 ) {
-              io_out_string ( "Wait for Other Board Active\r\n" );
-              vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_DataXControlTask_PERIOD_MS ) );
+            if ( SPI_LINK_FULL == link_queue_packet ( &packet_rx_via_queue ) ) {
+              //  Into the next frame, once this one is on its way
+              pendingPacket = packet_rx_via_queue;
+              havePending = TRUE;
             }
+          }
 
-            if ( SPI_IND_Passive == SPI_Get_OtherBoard_Indicator() ) {
-
-              negotiation = NEG_No_Response;
-
-            } else {
-
-# if 0
-              switch ( SPI_Negotiate ( SPI_INT_WantToTransmit ) ) {
-              case SPI_NEG_Conflict:    negotiation = NEG_Conflict; break;
-              case SPI_NEG_CommFailure: negotiation = NEG_No_Response; break;
-              case SPI_NEG_Agreed:      negotiation = NEG_Can_Send; break;
-              default:                  negotiation = NEG_Undefined; break;
-              }
-# else
-                                        negotiation = NEG_Can_Send;
-# endif
-
-            }
-
-            if ( negotiation != NEG_Can_Send ) {
-
-              //  The other board did not respond within the time period
-              //  or the negotiation did not succees.
-              //  ==> Abort the attempt to transfer
-              //  and return the current packet to the queue
-              //  for another attempt.  FIXME  If SPI communication
-              //  continues to fail, the queue will block.
-              xQueueSendToFront ( rxPackets, &packet_rx_via_queue, 0 );
-              SPI_Set_MyBoard_Indicator( SPI_IND_Passive );
-
-              io_out_string ( "Negotiation failed\r\n" );
-
-            } else {  //  NEG_Can_Send == negotiation
-
-              io_out_string ( "Other Board Is Active\r\n" );
-# endif
-              int data_size = 0;
-              int usePointer = 0;
-
-              switch ( packet_rx_via_queue.type ) {
-
-              case DE_Type_Nothing:              break;
-
-              case DE_Type_Ping:                 data_size = sizeof(packet_rx_via_queue.data.Ping_Message); break;
-              case DE_Type_Command:              data_size = sizeof(data_exchange_command_t);               break;
-              case DE_Type_Response:             data_size = sizeof(data_exchange_respond_t);               break;
-              case DE_Type_Syslog_Message:       data_size = sizeof(data_exchange_syslog_t);                break;
-
-              case DE_Type_Configuration_Data:   data_size = sizeof(        Config_Data_t); usePointer = 1; break;
-              case DE_Type_Spectrometer_Data:    data_size = sizeof(  Spectrometer_Data_t); usePointer = 1; break;
-//            case DE_Type_OCR_Data:             data_size = sizeof(           OCR_Data_t); usePointer = 1; break;
-              case DE_Type_OCR_Frame:            data_size =             OCR_FRAME_LENGTH ; usePointer = 1; break;
-//            case DE_Type_MCOMS_Data:           data_size = sizeof(         MCOMS_Data_t); usePointer = 1; break;
-              case DE_Type_MCOMS_Frame:          data_size =           MCOMS_FRAME_LENGTH ; usePointer = 1; break;
-              case DE_Type_Profile_Info_Packet:  data_size = sizeof(Profile_Info_Packet_t); usePointer = 1; break;
-              case DE_Type_Profile_Data_Packet:  data_size = sizeof(Profile_Data_Packet_t); usePointer = 1; break;
-
-              //  Do NOT add a "default:" here.
-              //  That way, the compiler will generate a warning
-              //  if one possible packet type was missed.
-
-              }
-
-              uint16_t const packet_header_size = sizeof(data_exchange_address_t)
-                                                + sizeof(data_exchange_address_t)
-                                                + sizeof(data_exchange_type_t);
-              uint8_t  packet_header[ packet_header_size ];
-
-              //  Packet header as bytes
-
-              memcpy ( packet_header,                                   &(packet_rx_via_queue.to  ), sizeof(data_exchange_address_t) );
-              memcpy ( packet_header+  sizeof(data_exchange_address_t), &(packet_rx_via_queue.from), sizeof(data_exchange_address_t) );
-              memcpy ( packet_header+2*sizeof(data_exchange_address_t), &(packet_rx_via_queue.type), sizeof(data_exchange_type_t)    );
-
-//  FIXME -- Artifical Delay to ensure the other side is ready to receive
-//            vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_DataXControlTask_PERIOD_MS/5 ) );
-
-              int16_t num_bytes_sent = 0;
-              int16_t sent_status;
-
-              if ( !usePointer ) {
-
-                switch ( packet_rx_via_queue.type ) {
-
-                case DE_Type_Ping:                sent_status = send_via_SPI_RAM_RAM ( packet_header, packet_header_size,
-                                                                         (uint8_t*)packet_rx_via_queue.data.Ping_Message, data_size,
-                                                                         &num_bytes_sent );
-                                                  break;
-
-                case DE_Type_Command:             sent_status = send_via_SPI_RAM_RAM ( packet_header, packet_header_size,
-                                                                         (uint8_t*)(&packet_rx_via_queue.data.Command), data_size,
-                                                                         &num_bytes_sent );
-                                                  break;
-
-                case DE_Type_Response:            sent_status = send_via_SPI_RAM_RAM ( packet_header, packet_header_size,
-                                                                         (uint8_t*)(&packet_rx_via_queue.data.Response), data_size,
-                                                                         &num_bytes_sent );
-                                                  break;
-
-                case DE_Type_Syslog_Message:      sent_status = send_via_SPI_RAM_RAM ( packet_header, packet_header_size,
-                                                                         (uint8_t*)(&packet_rx_via_queue.data.Syslog), data_size,
-                                                                         &num_bytes_sent );
-                                                  break;
-
-                default: sent_status = 0;
-                                                  //  Handled via data_size > 0 in following else block
-                                                  break;
-                }
+          busy = 1;
+        }
 
-              } else {
+        //  Send what is due: the frame being filled, a frame again,
+        //  or an acknowledgement of the last frame received
 
 gplp  = pm_read_gplp( &AVR32_PM, 1 );
 gplp |= 0x00400000;
         pm_write_gplp( &AVR32_PM, 1, gplp );
 
-                //  Inside this code block,
-                //  (1) the data pointed to by the received packet is sent via SPI
-                //  (2) Then the received memory is released (flagged as Empty[S]RAM),
-                //  TODO: If transfer fails?
-                if ( pdTRUE == xSemaphoreTake ( packet_rx_via_queue.data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
-
-gplp  = pm_read_gplp( &AVR32_PM, 1 );
-gplp |= 0x01000000;
-        pm_write_gplp( &AVR32_PM, 1, gplp );
-
-                  if ( packet_rx_via_queue.data.DataPackagePointer->state == FullRAM ) {
-                    //  send data from RAM
-                    sent_status = send_via_SPI_RAM_RAM ( packet_header, packet_header_size,
-                                           packet_rx_via_queue.data.DataPackagePointer->address, data_size,
-                                           &num_bytes_sent );
-                    packet_rx_via_queue.data.DataPackagePointer->state = EmptyRAM;
-                  } else if ( packet_rx_via_queue.data.DataPackagePointer->state == FullSRAM ) {
-                    //  send data from SRAM
-                    sent_status = send_via_SPI_RAM_SRAM ( packet_header, packet_header_size,
-                                           packet_rx_via_queue.data.DataPackagePointer->address, data_size,
-                                           &num_bytes_sent );
-                    packet_rx_via_queue.data.DataPackagePointer->state = EmptySRAM;
-                  }
-gplp  = pm_read_gplp( &AVR32_PM, 1 );
-gplp |= 0x02000000;
-        pm_write_gplp( &AVR32_PM, 1, gplp );
-
-                  xSemaphoreGive ( packet_rx_via_queue.data.DataPackagePointer->mutex );
-                }
+        int32_t const sent = spi_link_flush ( &board_link );
 
 gplp  = pm_read_gplp( &AVR32_PM, 1 );
 gplp |= 0x00800000;
         pm_write_gplp( &AVR32_PM, 1, gplp );
 
-              }
-
-              if(0) {
-                  data_exchange_packet_t packet_message;
-                  packet_message.to   = DE_Addr_ControllerBoard_Commander;
-                  packet_message.from = myAddress;
-                  packet_message.type = DE_Type_Syslog_Message;
-                  packet_message.data.Syslog.number = SL_MSG_DXC_Sent;
-                  packet_message.data.Syslog.value  = num_bytes_sent;
-                  data_exchange_packet_router ( myAddress, &packet_message );
-              }
-
-              if(0) {
-                  fHandler_t fh;
-                  int ok;
-                  char const* lfn = "0:\\DAT\\DXC.LOG";
-
-                  if ( !f_exists(lfn) ) {
-                    ok = ( FILE_OK == f_open( lfn, O_WRONLY | O_CREAT, &fh ) );
-                  } else {
-                    ok = ( FILE_OK == f_open( lfn, O_WRONLY | O_APPEND, &fh ) );
-                  }
-
-                  if ( ok ) {
-                    char msg[64];
-
-                    switch ( sent_status ) {
-                    case -1: f_write( &fh, "TX NoCom\r\n", 10 ); break;
-                    case -2: f_write( &fh, "TX Conflict\r\n", 13 ); break;
-                    case -3: f_write( &fh, "TX Timeout\r\n", 12 ); break;
-                    case -4: f_write( &fh, "TX Fail\r\n", 9 ); break;
-                    case -5: f_write( &fh, "TX NoResp\r\n", 11 ); break;
-                    case -6: f_write( &fh, "TX TooLarge\r\n", 13 ); break;
-                    default: {
-                               snprintf( msg, 64, "TX Sizes %02x %02x %02x %hd\r\n",
-                                                   packet_rx_via_queue.type & 0xFF,
-                                                   packet_rx_via_queue.to   & 0xFF,
-                                                   packet_rx_via_queue.from & 0xFF,
-                                                   num_bytes_sent );
-                                f_write ( &fh, msg, strlen(msg) );
-                             }
-                    }
-                    f_close( &fh );
-                  }
-              }
-
-              if (0) {
-              switch ( sent_status ) {
-              case -1:  io_out_string ( "TX NoCom\r\n" ); break;
-              case -2:  io_out_string ( "TX Conflict\r\n" ); break;
-              case -3:  io_out_string ( "TX Timeout\r\n" ); break;
-              case -4:  io_out_string ( "TX Fail\r\n" ); break;
-              case -5:  io_out_string ( "TX NoResp\r\n" ); break;
-              default:  if ( num_bytes_sent != packet_header_size+data_size ) {
-                        io_out_string ( "TX SzErr\r\n" );
-                        } else {
-                        io_out_string ( "TX SzOk\r\n" );
-                        }
-              }
-              }
-
-# if 0
-              //  Tell the other board that all is done.
-              //  This should already have been done inside SPI_tx_packet().
-
-              SPI_Set_MyBoard_Indicator( SPI_IND_Passive );
-
-              wait = 50;
-              while ( SPI_IND_Active == SPI_Get_OtherBoard_Indicator() && --wait>0 ) {
-                io_out_string ( "Wait for Other Board to turn off\r\n" );
-                vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_DataXControlTask_PERIOD_MS ) );
-              }
-            }
-# endif
-          }
-        }
-
-             //  Check for incoming packet via SPI
-      } /* else */ if ( SPI_IND_Active == SPI_Get_OtherBoard_Indicator() ) {
-
-# if 0
-        //SPI_Set_MyBoard_Indicator( SPI_IND_Active );
-        //vTaskDelay( (portTickType)TASK_DELAY_MS( 1 ) );
-
-        if ( 0 && SPI_NEG_Agreed != SPI_Negotiate ( SPI_INT_ReadyToReceive ) ) {
-          
-          //  This should be impossible to occur.
-          SPI_Set_MyBoard_Indicator( SPI_IND_Passive );
-
-        } else {
-# endif
-          data_exchange_packet_t packet_rx_via_SPI;
-
-          uint16_t const packet_header_size = sizeof(data_exchange_address_t)
-                                            + sizeof(data_exchange_address_t)
-                                            + sizeof(data_exchange_type_t);
-          uint8_t  packet_header[ packet_header_size ];
-          int16_t received_size;
-          int16_t received_status;
-
-gplp  = pm_read_gplp( &AVR32_PM, 1 );
-gplp |= 0x10000000;
-        pm_write_gplp( &AVR32_PM, 1, gplp );
-
-          int data_copied = 0;
-          int i;
-          for ( i=0; i<N_DA_POINTERS && !data_copied; i++) {
-            if ( pdTRUE == xSemaphoreTake ( local_data_package[i].mutex, 100 /*portMAX_DELAY*/ ) ) {
-              if ( local_data_package[i].state == EmptySRAM ) {
-
-gplp  = pm_read_gplp( &AVR32_PM, 1 );
-gplp |= 0x04000000;
-        pm_write_gplp( &AVR32_PM, 1, gplp );
-                received_status = SPI_rx_packet ( packet_header, packet_header_size,
-                                                     local_data_package[i].address,
-                                                     sizeof(any_local_data_t),
-                                                     &received_size );
-gplp  = pm_read_gplp( &AVR32_PM, 1 );
-gplp |= 0x08000000;
-        pm_write_gplp( &AVR32_PM, 1, gplp );
-
-                int32_t remaining_data_size;
-
-                if ( received_size > packet_header_size ) {
-                  memcpy ( &(packet_rx_via_SPI.to  ), packet_header                                  , sizeof(data_exchange_address_t) );
-                  memcpy ( &(packet_rx_via_SPI.from), packet_header+  sizeof(data_exchange_address_t), sizeof(data_exchange_address_t) );
-                  memcpy ( &(packet_rx_via_SPI.type), packet_header+2*sizeof(data_exchange_address_t), sizeof(data_exchange_type_t)    );
-
-                  remaining_data_size = received_size-packet_header_size;
-                } else {
-                  remaining_data_size = 0;
-                  packet_rx_via_SPI.type = DE_Type_Nothing;
-                  packet_rx_via_SPI.to   = DE_Addr_Nobody;
-                  packet_rx_via_SPI.from = DE_Addr_Nobody;
-                }
-
-                uint16_t value_size = 0;
-                uint16_t data_size = 0;
-
-                switch ( packet_rx_via_SPI.type ) {
-
-                case DE_Type_Ping:                 value_size = sizeof(packet_rx_via_SPI.data.Ping_Message);
-                                                   if ( value_size <= remaining_data_size ) {
-                                                     memcpy ( &packet_rx_via_SPI.data.Ping_Message, local_data_package[i].address, value_size );
-                                                   }
-                                                   break;
-
-                case DE_Type_Command:              value_size = sizeof(data_exchange_command_t);
-                                                   if ( value_size <= remaining_data_size ) {
-                                                     memcpy ( &packet_rx_via_SPI.data.Command, local_data_package[i].address, value_size );
-                                                   }
-                                                   break;
-
-                case DE_Type_Response:             value_size = sizeof(data_exchange_respond_t);
-                                                   if ( value_size <= remaining_data_size ) {
-                                                     memcpy ( &packet_rx_via_SPI.data.Response, local_data_package[i].address, value_size );
-                                                   }
-                                                   break;
-
-                case DE_Type_Syslog_Message:       value_size = sizeof(data_exchange_syslog_t);
-                                                   if ( value_size <= remaining_data_size ) {
-                                                     memcpy ( &packet_rx_via_SPI.data.Syslog, local_data_package[i].address, value_size );
-                                                   }
-                                                   break;
-
-                case DE_Type_Configuration_Data:   data_size = sizeof(        Config_Data_t); break;
-                case DE_Type_Spectrometer_Data:    data_size = sizeof(  Spectrometer_Data_t); break;
-//              case DE_Type_OCR_Data:             data_size = sizeof(           OCR_Data_t); break;
-                case DE_Type_OCR_Frame:            data_size =             OCR_FRAME_LENGTH ; break;
-//              case DE_Type_MCOMS_Data:           data_size = sizeof(         MCOMS_Data_t); break;
-                case DE_Type_MCOMS_Frame:          data_size =           MCOMS_FRAME_LENGTH ; break;
-                case DE_Type_Profile_Info_Packet:  data_size = sizeof(Profile_Info_Packet_t); break;
-                case DE_Type_Profile_Data_Packet:  data_size = sizeof(Profile_Data_Packet_t); break;
-
-                case DE_Type_Nothing:              // when error in SPI_rx_packet() occurred
-                default:                           /*  Should never happen -- Trigger ERROR message -- TODO??? */
-                                                   break;
-                }
-
-                if ( data_size > 0 ) {
-                  if ( data_size <= remaining_data_size ) {
-                    packet_rx_via_SPI.data.DataPackagePointer = &local_data_package[i];
-                    local_data_package[i].state = FullSRAM;
-                  }
-                }
-
-
-                if(0) {
-                  data_exchange_packet_t packet_message;
-                  packet_message.to   = DE_Addr_ControllerBoard_Commander;
-                  packet_message.from = myAddress;
-                  packet_message.type = DE_Type_Syslog_Message;
-                  packet_message.data.Syslog.number = SL_MSG_DXC_Received;
-                  packet_message.data.Syslog.value  = received_size;
-                  data_exchange_packet_router ( myAddress, &packet_message );
-                }
-
-                if(0) {
-                  fHandler_t fh;
-                  int ok;
-                  char const* lfn = "0:\\DAT\\DXC.LOG";
-
-                  if ( !f_exists(lfn) ) {
-                    ok = ( FILE_OK == f_open( lfn, O_WRONLY | O_CREAT, &fh ) );
-                  } else {
-                    ok = ( FILE_OK == f_open( lfn, O_WRONLY | O_APPEND, &fh ) );
-                  }
-
-                  if ( ok ) {
-                    char msg[64];
-
-                    switch ( received_status ) {
-                    case  0: f_write( &fh, "RX NoData\r\n", 11 ); break;
-                    case -1: f_write( &fh, "RX NoCom\r\n", 10 ); break;
-                    case -2: f_write( &fh, "RX Conflict\r\n", 13 ); break;
-                    case -3: f_write( &fh, "RX Timeout\r\n", 12 ); break;
-                    case -4: f_write( &fh, "RX Fail\r\n", 9 ); break;
-                    case -5: f_write( &fh, "RX NoResp\r\n", 11 ); break;
-                    case -6: f_write( &fh, "RX TooLarge\r\n", 13 ); break;
-                    default: {
-                               snprintf( msg, 64, "RX Sizes %02x %02x %02x %hd %hu %hu\r\n",
-                                                   packet_rx_via_SPI.type & 0xFF,
-                                                   packet_rx_via_SPI.to   & 0xFF,
-                                                   packet_rx_via_SPI.from & 0xFF,
-                                                   received_size,
-                                                   value_size,
-                                                   data_size );
-                                f_write ( &fh, msg, strlen(msg) );
-                             }
-                    }
-                    f_close( &fh );
-                  }
-                }
-
-                if (0) {
-                switch ( received_status ) {
-                case -1:  io_out_string ( "RX NoCom\r\n" ); break;
-                case -2:  io_out_string ( "RX Conflict\r\n" ); break;
-                case -3:  io_out_string ( "RX Timeout\r\n" ); break;
-                case -4:  io_out_string ( "RX Fail\r\n" ); break;
-                case -5:  io_out_string ( "RX NoResp\r\n" ); break;
-                default:  if ( value_size && remaining_data_size<value_size ) {
-
-                            char msg[64];
-                            snprintf( msg, 64, "RX VSzErr %hx %02x %02x %02x\r\n",
-                                               received_size,
-                            packet_rx_via_SPI.type & 0xFF,
-                            packet_rx_via_SPI.to   & 0xFF,
-                            packet_rx_via_SPI.from & 0xFF );
-                            io_out_string ( msg );
-
-                            packet_rx_via_SPI.to = DE_Addr_Nobody;
-
-                          } else if ( data_size && remaining_data_size<data_size ) {
-
-                            io_out_S32 ( "RX DSzErr %ld\r\n", (S32)received_size );
-
-                            packet_rx_via_SPI.to = DE_Addr_Nobody;
-
-                          } else if ( !value_size && !data_size ) {
-
-                            io_out_S32 ( "RX ?SzErr %ld\r\n", (S32)received_size );
-
-                            packet_rx_via_SPI.to = DE_Addr_Nobody;
-                          }
-                }
-                }
-
-                data_copied = 1;
-              }
-              xSemaphoreGive( local_data_package[i].mutex );
-            }
-          }
-
-gplp  = pm_read_gplp( &AVR32_PM, 1 );
-gplp |= 0x20000000;
-        pm_write_gplp( &AVR32_PM, 1, gplp );
-
-# if 0
-          if ( !data_copied ) {
-                          io_out_string ( "RX NotTried\r\n" );
-          }
-# endif
-
-           //  Send the just received packet on its way
-           //  or respond to it if addressed to myself
-           //
-           if ( packet_rx_via_SPI.to == myAddress ) {
-
-            //  Only expecting Ping, ignore all others (that were sent in error!).
-
-            if ( packet_rx_via_SPI.type == DE_Type_Ping ) {
-
-              data_exchange_packet_t packet_response;
-
-              packet_response.to = packet_rx_via_SPI.from;
-              packet_response.from = myAddress;
-              packet_response.type = DE_Type_Response;
-              packet_response.data.Response.Code = RSP_ALL_Ping;
-              packet_response.data.Response.value.u64 = 0;  //  Will be ignored
-
-              data_exchange_packet_router ( myAddress, &packet_response );
-
-            } else {
-
-              //syslog_out ( SYSLOG_ERROR, "data_exchange_controller", "Received nonPING/QUERY packet" );
-
-              //  This is not supposed to happen.
-              //  If received a packet containing data, clean data,
-              //  ie., throw out, and mark location as empty, ie. reusable
-              //
-              switch ( packet_rx_via_SPI.type ) {
-
-              case DE_Type_Configuration_Data:
-              case DE_Type_Spectrometer_Data:
-//            case DE_Type_OCR_Data:
-              case DE_Type_OCR_Frame:
-//            case DE_Type_MCOMS_Data:
-              case DE_Type_MCOMS_Frame:
-              case DE_Type_Profile_Info_Packet:
-              case DE_Type_Profile_Data_Packet:
-                if ( pdTRUE == xSemaphoreTake ( packet_rx_via_SPI.data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
-                  if ( packet_rx_via_SPI.data.DataPackagePointer->state == FullRAM ) {
-                    packet_rx_via_SPI.data.DataPackagePointer->state = EmptyRAM;
-                  } else if ( packet_rx_via_SPI.data.DataPackagePointer->state == FullSRAM ) {
-                    packet_rx_via_SPI.data.DataPackagePointer->state = EmptySRAM;
-                  }
-                  xSemaphoreGive ( packet_rx_via_SPI.data.DataPackagePointer->mutex );
-                }
-              break;
-
-              default:
-                //  No action required. Packet has been consumed without a trace.
-              break;
-              }
-            }
-           } else if ( packet_rx_via_SPI.to != DE_Addr_Nobody ) {
-            data_exchange_packet_router ( myAddress, &packet_rx_via_SPI );
-           }
-# if 0
+        if ( sent > 0 ) {
+          busy = 1;
+        } else if ( sent < 0 ) {
+          io_out_S32 ( "TX %ld\r\n", (S32)sent );
         }
-# endif
-gplp  = pm_read_gplp( &AVR32_PM, 1 );
-gplp |= 0x40000000;
-        pm_write_gplp( &AVR32_PM, 1, gplp );
+      }
 
+      // Sleep
+      //
+      // After a packet, look again at once: more may be queued.
+      // Otherwise block until a packet is pushed, or the other board's ready
+      // line falls; either gives wakeSemaphore. While the other board waits
+      // and no package is free, or a frame waits for its acknowledgement,
+      // look again after the task period at the latest. Else the time out
+      // only covers a missed edge.
+      gHNV_DataXControlTask_Status = TASK_SLEEPING;
+      if ( busy ) {
+        taskYIELD();
+      } else if ( SPI_IND_Active == SPI_Get_OtherBoard_Indicator() || !spi_link_idle ( &board_link ) ) {
+        xSemaphoreTake( wakeSemaphore, (portTickType)TASK_DELAY_MS( HNV_DataXControlTask_PERIOD_MS ) );
+      } else {
+        xSemaphoreTake( wakeSemaphore, (portTickType)TASK_DELAY_MS( HNV_DataXControlTask_IDLE_MS ) );
       }
+      gHNV_DataXControlTask_Status = TASK_RUNNING;
 
     } else {
 
       gTaskIsRunning = FALSE;
-    }
 
-    // Sleep
-    gHNV_DataXControlTask_Status = TASK_SLEEPING;
-    vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_DataXControlTask_PERIOD_MS ) );
-    gHNV_DataXControlTask_Status = TASK_RUNNING;
+      // Sleep
+      gHNV_DataXControlTask_Status = TASK_SLEEPING;
+      vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_DataXControlTask_PERIOD_MS ) );
+      gHNV_DataXControlTask_Status = TASK_RUNNING;
+    }
   }
 
 }
@@ -761,7 +520,21 @@ void data_exchange_controller_pushPacket( data_exchange_packet_t* packet ) {
   //  We trust that the queue is implemented thread-safe.
   if ( packet ) {
     // io_out_string ( "DBG DXC push packet\r\n" );
-    xQueueSendToBack ( rxPackets, packet, 0 );
+    if ( pdTRUE == xQueueSendToBack ( rxPackets, packet, 0 ) ) {
+      xSemaphoreGive ( wakeSemaphore );
+    } else {
+      //  Not delivered: nobody else holds the package, so free it here,
+      //  or its sender would wait for it forever.
+      int usePointer;
+      link_data_size ( packet->type, &usePointer );
+
+      if ( usePointer ) {
+        if ( pdTRUE == xSemaphoreTake ( packet->data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
+          data_package_emptied ( packet->data.DataPackagePointer );
+          xSemaphoreGive ( packet->data.DataPackagePointer->mutex );
+        }
+      }
+    }
   }
 }
 
@@ -772,6 +545,7 @@ Bool data_exchange_controller_resumeTask(void)
   xSemaphoreTake(gTaskCtrlMutex, portMAX_DELAY);
 
   // Potentially do setup here
+  SPI_Wake_On_OtherBoard_Active( wakeSemaphore );
 
   // Command
   gRunTask = TRUE;
@@ -792,13 +566,15 @@ Bool data_exchange_controller_pauseTask(void)
   // Grab control mutex
   xSemaphoreTake(gTaskCtrlMutex, portMAX_DELAY);
 
-  // Command
+  // Command, and wake the task to see it
   gRunTask = FALSE;
+  xSemaphoreGive( wakeSemaphore );
 
   // Wait for task to stop running
   while(gTaskIsRunning) vTaskDelay( (portTickType)TASK_DELAY_MS(10) );
 
   // Potentially do cleanup here
+  SPI_Wake_On_OtherBoard_Active( NULL );
 
   // Return control mutex
   xSemaphoreGive(gTaskCtrlMutex);
@@ -835,6 +611,12 @@ Bool data_exchange_controller_createTask(void)
       if ( NULL == ( rxPackets = xQueueCreate(N_RX_PACKETS, sizeof(data_exchange_packet_t) ) ) )
         break;
 
+      // Create wake-up semaphore, not given until there is something to do
+      vSemaphoreCreateBinary( wakeSemaphore );
+      if ( NULL == wakeSemaphore )
+        break;
+      xSemaphoreTake( wakeSemaphore, 0 );
+
 
       // Allocate memory for frames that are received
       //
@@ -858,6 +640,15 @@ Bool data_exchange_controller_createTask(void)
 
       }
 
+      //  Board to board link
+      //
+      uint8_t* link_frame[3] = { link_tx[0], link_tx[1], (uint8_t*)sram_DXC_LINK };
+      if ( SPI_LINK_OK != spi_link_init ( &board_link, link_frame, DE_LINK_CTRL_FRAME, DE_LINK_SPEC_FRAME,
+                                          DE_LINK_RECORDS_MAX, &link_transport ) ) {
+        all_allocated = false;
+      }
+      spi_link_on_given_up ( &board_link, link_given_up, NULL );
+
       if ( !all_allocated ) {
         for ( i=0; i<N_DA_POINTERS; i++) {
           if ( local_data_package[i].mutex ) {
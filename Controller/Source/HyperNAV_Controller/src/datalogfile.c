@@ -12,9 +12,16 @@
 # include <stdio.h>
 # include <string.h>
 
+# include "FreeRTOS.h"
+# include "queue.h"
+# include "semphr.h"
+# include "task.h"
+
 # include "syslog.h"
 # include "files.h"
 # include "extern.controller.h"
+# include "tasks.controller.h"
+# include "sram_memory_map.controller.h"
 
 //  The log file name will be up to 33 characters long.
 //  "0:/FREEFALL/YY-MM-DD/FF-#####.raw"   ---  for free fall profiles
@@ -23,6 +30,119 @@
 
 static char dlf_current_file_name[34] = "";
 
+//  Write-behind of the log file.
+//
+//  DLF_Write() copies data into a ring in SRAM and posts the size
+//  to the writer task. The writer task keeps the log file open
+//  from DLF_Start() to DLF_Stop() and hands the ring contents to
+//  a batched writer, so the eMMC sees cluster aligned writes of
+//  whole sectors rather than an open, seek, partial sector write
+//  and close for every field of every frame.
+//
+//  The file is synced after DLF_SYNC_BYTES, after DLF_SYNC_MS,
+//  at DLF_Stop() and at shutdown (DLF_Shutdown(), from pwr_shutdown()).
+
+# define DLF_SYNC_BYTES       (64*1024L)
+# define DLF_SYNC_MS           5000
+# define DLF_WRITE_WAIT_MS     2000   //  Longest wait for room in the ring
+# define DLF_SHUTDOWN_WAIT_MS   500   //  Longest wait for the writer at shutdown
+# define DLF_N_POSTS             16
+
+static xQueueHandle     dlf_posts = NULL;   //  Sizes of data put into the ring
+static xSemaphoreHandle dlf_lock  = NULL;   //  Held while using the ring tail or the file
+static xSemaphoreHandle dlf_room  = NULL;   //  Given when the ring was drained
+
+//  Free running byte counts; ring offset is count % SRAM_DLF_RING_SIZE
+static volatile uint32_t dlf_head = 0;      //  Put by DLF_Write()
+static volatile uint32_t dlf_tail = 0;      //  Taken by the holder of dlf_lock
+
+static fBatch_t      dlf_batch;
+static volatile bool dlf_failed = false;    //  A write to the log file failed
+static portTickType  dlf_synced_at;
+
+//  Pass everything in the ring to the log file (hold dlf_lock)
+static void dlf_drain () {
+
+  uint32_t const head = dlf_head;
+
+  while ( dlf_tail != head ) {
+
+    uint32_t const at = dlf_tail % SRAM_DLF_RING_SIZE;
+    uint32_t n = head - dlf_tail;
+    if ( n > SRAM_DLF_RING_SIZE - at ) n = SRAM_DLF_RING_SIZE - at;
+
+    if ( dlf_batch.isOpen && !dlf_failed
+      && (S32)n != f_batchWrite ( &dlf_batch, sram_DLF_RING + at, n ) ) {
+      dlf_failed = true;
+    }
+
+    dlf_tail += n;
+  }
+
+  xSemaphoreGive ( dlf_room );
+}
+
+//  Write out staged data and sync the log file (hold dlf_lock)
+static void dlf_sync () {
+
+  if ( dlf_batch.isOpen && !dlf_failed
+    && ( dlf_batch.fill || dlf_batch.unsynced ) ) {
+    if ( FILE_OK != f_batchSync ( &dlf_batch ) ) {
+      dlf_failed = true;
+    }
+  }
+
+  dlf_synced_at = xTaskGetTickCount();
+}
+
+//  Drain the ring and close the log file (hold dlf_lock)
+static void dlf_close () {
+
+  dlf_drain();
+
+  if ( dlf_batch.isOpen ) {
+    if ( FILE_OK != f_batchClose ( &dlf_batch ) ) {
+      dlf_failed = true;
+    }
+  }
+}
+
+static void dlf_writer_loop ( __attribute__((unused)) void* pvParameters ) {
+
+  portTickType wait = portMAX_DELAY;
+
+  for (;;) {
+
+    uint16_t posted;
+
+    THIS_TASK_WILL_SLEEP( gHNV_DataLogWriterTask_Status );
+    xQueueReceive ( dlf_posts, &posted, wait );
+    THIS_TASK_IS_RUNNING( gHNV_DataLogWriterTask_Status );
+
+    xSemaphoreTake ( dlf_lock, portMAX_DELAY );
+
+    dlf_drain();
+
+    portTickType const since = xTaskGetTickCount() - dlf_synced_at;
+
+    if ( dlf_batch.unsynced >= DLF_SYNC_BYTES
+      || since >= (portTickType)TASK_DELAY_MS( DLF_SYNC_MS ) ) {
+      dlf_sync();
+    }
+
+    //  Data not on the eMMC yet: wake up in time to sync
+    if ( dlf_batch.isOpen && !dlf_failed
+      && ( dlf_batch.fill || dlf_batch.unsynced ) ) {
+      portTickType const due = (portTickType)TASK_DELAY_MS( DLF_SYNC_MS ) - ( xTaskGetTickCount() - dlf_synced_at );
+      wait = due <= (portTickType)TASK_DELAY_MS( DLF_SYNC_MS ) ? due : 0;
+    } else {
+      wait = portMAX_DELAY;
+    }
+
+    xSemaphoreGive ( dlf_lock );
+  }
+}
+
 //! \brief  Start logging
 //!         Must call DLF_Start() before calling DLF_Write()
 //!
@@ -47,6 +167,11 @@ int16_t DLF_Start( char* yy_mm_dd, char type ) {
     return (int16_t)(-1);
   }
 
+  //  No writer task to take the data
+  if ( NULL == dlf_lock ) {
+    return (int16_t)(-12);
+  }
+
   //  Declate filder and file names
   //
   fHandler_t fh;
@@ -127,33 +252,40 @@ int16_t DLF_Start( char* yy_mm_dd, char type ) {
   }
   snprintf ( dlf_current_file_name, 34, "0:\\%s\\%s\\%2.2s-%05hu.raw", subDir, yy_mm_dd, ID, counter );
 
-  if ( f_exists ( dlf_current_file_name ) ) {
-    //  This is unexpected.
-    //  A data log file of this name should not exist.
-    //  Ignore this error, and just append to the file.
-    if ( FILE_OK != f_open ( dlf_current_file_name, O_WRONLY | O_APPEND, &fh ) ) {
-      return (int16_t)(-8);
-    }
+  //  The log file stays open until DLF_Stop(),
+  //  a previous one not stopped is closed here.
+  bool const exists = f_exists ( dlf_current_file_name );
 
-    if ( 10 != f_write( &fh, "\r\nAPPEND\r\n", 10 ) ) {
-      f_close ( &fh );
+  xSemaphoreTake ( dlf_lock, portMAX_DELAY );
+
+  dlf_close();
+  dlf_failed = false;
+
+  //  If the file exists, this is unexpected.
+  //  A data log file of this name should not exist.
+  //  Ignore this error, and just append to the file.
+  S16 const opened = f_batchOpen ( &dlf_batch, dlf_current_file_name,
+                                   exists ? O_WRONLY : O_WRONLY | O_CREAT,
+                                   sram_DLF_STAGE, SRAM_DLF_STAGE_SIZE );
+  dlf_synced_at = xTaskGetTickCount();
+
+  xSemaphoreGive ( dlf_lock );
+
+  if ( FILE_OK != opened ) {
+    dlf_current_file_name[0] = 0;
+    return (int16_t)( exists ? -8 : -10 );
+  }
+
+  if ( exists ) {
+    if ( 10 != DLF_Write( (uint8_t*)"\r\nAPPEND\r\n", 10 ) ) {
       return (int16_t)(-9);
     }
-
   } else {
-    //  Make sure the new log file can be generated.
-    if ( FILE_OK != f_open ( dlf_current_file_name, O_WRONLY | O_CREAT, &fh ) ) {
-      return (int16_t)(-10);
-    }
-
-    if ( 7 != f_write( &fh, "BEGIN\r\n", 7 ) ) {
-      f_close ( &fh );
+    if ( 7 != DLF_Write( (uint8_t*)"BEGIN\r\n", 7 ) ) {
       return (int16_t)(-11);
     }
   }
 
-  f_close ( &fh );
-
   return (int16_t)0;
 }
 
@@ -165,48 +297,116 @@ void DLF_Stop() {
     return;
   }
 
-  fHandler_t fh;
-
-  if ( FILE_OK != f_open ( dlf_current_file_name, O_WRONLY | O_APPEND, &fh ) ) {
-    return;
-  }
+  DLF_Write( (uint8_t*)"END\r\n", 5 );
 
-  if ( 5 != f_write( &fh, "END\r\n", 5 ) ) {
-    f_close ( &fh );
-    return;
-  }
-
-  f_close ( &fh );
+  xSemaphoreTake ( dlf_lock, portMAX_DELAY );
+  dlf_close();
+  xSemaphoreGive ( dlf_lock );
 
   dlf_current_file_name[0] = 0;
 
   return;
 }
 
+//! \brief  Write out and close the log file before power goes away
+void DLF_Shutdown() {
+
+  if ( NULL == dlf_lock ) {
+    return;
+  }
+
+  //  Do not hold up the shutdown if the writer is stuck
+  if ( pdTRUE == xSemaphoreTake ( dlf_lock, (portTickType)TASK_DELAY_MS( DLF_SHUTDOWN_WAIT_MS ) ) ) {
+    dlf_close();
+    dlf_current_file_name[0] = 0;
+    xSemaphoreGive ( dlf_lock );
+  }
+}
+
 //! \brief  Log data (maximum of 2^15 bytes per call)
 //!
-//! @param  
-//! @param  
-//! return   number of bytes written to file
-//! return  -1  FAILED due to write to file failure
+//! The data are copied to the write-behind ring,
+//! and reach the file when the writer task gets to them.
+//!
+//! @param  data        data to log
+//! @param  size        number of bytes
+//! return   number of bytes accepted
+//! return  -1  FAILED due to write to file failure, or the writer falling behind
 //! return  -2  FAILED due to DLG_Start() not done/succeeded
-//! return  -3  FAILED due to file open error
 int32_t DLF_Write( uint8_t* data, uint16_t size ) {
 
   if ( 0 == dlf_current_file_name[0] ) {
     return (int32_t)(-2);
   }
 
-  fHandler_t fh;
+  uint16_t done = 0;
 
-  if ( FILE_OK != f_open ( dlf_current_file_name, O_WRONLY | O_APPEND, &fh ) ) {
-    return (int16_t)(-3);
+  while ( done < size ) {
+
+    if ( dlf_failed ) {
+      return (int32_t)(-1);
+    }
+
+    uint32_t const room = SRAM_DLF_RING_SIZE - ( dlf_head - dlf_tail );
+
+    if ( 0 == room ) {
+      //  Ring full: wait for the writer
+      if ( pdTRUE != xSemaphoreTake ( dlf_room, (portTickType)TASK_DELAY_MS( DLF_WRITE_WAIT_MS ) ) ) {
+        return (int32_t)(-1);
+      }
+      continue;
+    }
+
+    uint32_t const at = dlf_head % SRAM_DLF_RING_SIZE;
+    uint16_t n = size - done;
+    if ( n > room ) n = room;
+    if ( n > SRAM_DLF_RING_SIZE - at ) n = SRAM_DLF_RING_SIZE - at;
+
+    memcpy ( sram_DLF_RING + at, data + done, n );
+    dlf_head += n;
+    done += n;
+
+    //  If the queue is full, the writer has yet to run and will see this data anyway
+    xQueueSendToBack ( dlf_posts, &n, 0 );
   }
 
-  int32_t written = f_write( &fh, data, size );
-  f_close ( &fh );
+  return (int32_t)done;
+}
+
+// Allocate the data log file writer task and its queue
+Bool datalogfile_createTask(void)
+{
+  static Bool gTaskCreated = FALSE;
+
+  if(!gTaskCreated) {
+
+    // Create lock of ring tail and file
+    if ( NULL == ( dlf_lock = xSemaphoreCreateMutex() ) ) {
+      return FALSE;
+    }
+
+    // Create signal of ring drained
+    vSemaphoreCreateBinary( dlf_room );
+    if ( NULL == dlf_room ) {
+      return FALSE;
+    }
+
+    // Create queue of data posted to the ring
+    if ( NULL == ( dlf_posts = xQueueCreate( DLF_N_POSTS, sizeof(uint16_t) ) ) ) {
+      return FALSE;
+    }
+
+    // Create task
+    if ( pdPASS != xTaskCreate( dlf_writer_loop,
+                  HNV_DataLogWriterTask_NAME, HNV_DataLogWriterTask_STACK_SIZE, NULL,
+                  HNV_DataLogWriterTask_PRIORITY, &gHNV_DataLogWriterTask_Handler)) {
+      return FALSE;
+    }
+
+    gTaskCreated = TRUE;
+  }
 
-  return written;
+  return TRUE;
 }
 
 //  FIXME -- Multiple directories must be supported!
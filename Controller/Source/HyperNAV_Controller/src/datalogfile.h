@@ -11,8 +11,6 @@
 
 # include "files.h"
 
-# include "config.controller.h"
-
 # define DLF_OK	 0
 # define DLF_FAIL	-1
 
@@ -23,6 +21,8 @@
 char const* dlf_LogDirName ();
 
 # if 0
+# include "config.controller.h"
+
 /**
  *!	\brief	A wrapper function to open the appropriate frame log file for writing.
  *!
@@ -32,24 +32,33 @@ S16 dlf_openLogFile ( CFG_Log_File_Type log_file_type, CFG_Frame_Type frame_type
 		fHandler_t* fh, bool* write_info_header );
 # endif
 
+//! \brief  Create the task writing behind DLF_Write()
+Bool datalogfile_createTask(void);
+
 //! \brief  Start logging
 //!         Must call DLF_Start() before calling DLF_Write()
+//!         The log file is kept open until DLF_Stop()
 //!
 //! @param  yy_mm_dd    date string, specifies the current date and determines log folder
 //! return   0  OK
-//! return  -1  FAILED due to file system access failure
+//! return  -1  FAILED due to misformatted yy_mm_dd parameter
+//! return  <0  FAILED due to file system access failure, or no writer task
 int16_t DLF_Start( char* yy_mm_dd, char type );
 
-//! \brief  Stop logging
+//! \brief  Stop logging, write out and close the log file
 void DLF_Stop();
 
+//! \brief  Write out and close the log file, for shutdown and power loss
+void DLF_Shutdown();
+
 //! \brief  Log data (maximum write of 2^16 bytes)
+//!         The data reach the file in the writer task
 //!
-//! @param  
-//! @param  
-//! return   number of bytes written to file
-//! return  -1  FAILED due to not being started
-//! return  -2  FAILED due to write to file failure
+//! @param  data        data to log
+//! @param  size        number of bytes
+//! return   number of bytes accepted
+//! return  -1  FAILED due to write to file failure
+//! return  -2  FAILED due to not being started
 int32_t DLF_Write( uint8_t* data, uint16_t size );
 
 
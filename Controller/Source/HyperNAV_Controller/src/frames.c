@@ -1243,17 +1243,42 @@ int16_t frm_generateAndOutput( Spectrometer_Data_t* hsd ) {
 
 # else
 
+# include <fcntl.h>
 # include <libgen.h>
 # include <math.h>
+# include <stdint.h>
 # include <stdio.h>
 # include <stdlib.h>
 # include <string.h>
 # include <time.h>
 # include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+
+//  Find bracketing for linear interpolation
+//  wavelength[i-1] < neededWL <= wavelength[i]
+//  by binary search over the ascending wavelengths.
+//  Only call for wavelength[0] <= neededWL <= wavelength[numValues-1].
+//
+static int ipolBracket ( double wavelength[],
+                         int    numValues,
+                         double neededWL ) {
+  int lo = 0;
+  int hi = numValues-1;
 
-# warning "When building calibration file generation, memmem() function prototype provided manually."
-//  Manually provide function prototype
-void *memmem(const void *haystack, size_t haystacklen, const void *needle, size_t needlelen);
+  while ( lo < hi ) {
+    int const mid = lo + ( hi - lo ) / 2;
+    if ( wavelength[mid] < neededWL ) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  //  neededWL == wavelength[0]: Use the first interval
+  //
+  return lo ? lo : 1;
+}
 
 static double lampIpol ( double wavelength[],
                          double irradiance[],
@@ -1264,13 +1289,7 @@ static double lampIpol ( double wavelength[],
   if ( neededWL < wavelength[0] ) return 0.0;
   if ( wavelength[numValues-1] < neededWL ) return 0.0;
 
-  //  Find bracketing
-  //  wavelength[i] <= neededWL < wavelength[i+1]
-  //
-  int i = 0;
-  while ( i<numValues && wavelength[i] < neededWL ) {
-    i++;
-  }
+  int const i = ipolBracket ( wavelength, numValues, neededWL );
 
   //  Interpolate linearly
   //
@@ -1301,13 +1320,7 @@ static double targIpol ( double wavelength[],
   if ( neededWL < wavelength[0] ) return 0.0;
   if ( wavelength[numValues-1] < neededWL ) return 0.0;
 
-  //  Find bracketing
-  //  wavelength[i] <= neededWL < wavelength[i+1]
-  //
-  int i = 0;
-  while ( i<numValues && wavelength[i] < neededWL ) {
-    i++;
-  }
+  int const i = ipolBracket ( wavelength, numValues, neededWL );
 
   //  Interpolate linearly
   //
@@ -1329,6 +1342,69 @@ static double targIpol ( double wavelength[],
   return R0 + ( R1 - R0 ) * ( neededWL - W0 ) / ( W1 - W0 );
 }
 
+//  Frames found in a capture file
+//
+typedef struct {
+  size_t   offset;    //  of "SATX" in the file
+  uint16_t serial;    //  HyperNav serial number
+  char     tag;       //  'D' dark, 'L' light
+  uint16_t side;
+  uint16_t intTime;   //  milli-seconds
+} Frame_Index_t;
+
+//  Index all full-resolution ('Z') frames in a single pass over the file.
+//  After a frame, scanning resumes at its end, so spectrum data are never
+//  taken for a header.
+//  Returns the number of frames, or -1 if out of memory.
+//  Free *index when done.
+//
+static int index_frames ( uint8_t const* file, size_t file_size, size_t framesize, Frame_Index_t** index ) {
+
+  int nFrames = 0;
+  int nAlloc  = 0;
+
+  *index = 0;
+
+  uint8_t const* const end = file + file_size;
+  uint8_t const* p = file;
+
+  //  A frame must fit, followed by at least one byte
+  //
+  while ( (size_t)(end-p) > framesize
+       && ( p = memchr ( p, 'S', end-p-framesize ) ) ) {
+
+    if ( p[1] == 'A' && p[2] == 'T' && p[3] == 'X'
+      && ( p[4] == 'D' || p[4] == 'L' ) && p[5] == 'Z'
+      && '0' <= p[6] && p[6] <= '9' && '0' <= p[7] && p[7] <= '9'
+      && '0' <= p[8] && p[8] <= '9' && '0' <= p[9] && p[9] <= '9' ) {
+
+      if ( nFrames == nAlloc ) {
+        nAlloc = nAlloc ? 2*nAlloc : 1024;
+        Frame_Index_t* more = realloc ( *index, nAlloc*sizeof(Frame_Index_t) );
+        if ( !more ) {
+          free ( *index );
+          *index = 0;
+          return -1;
+        }
+        *index = more;
+      }
+
+      Frame_Index_t* fi = *index + nFrames++;
+      fi->offset  = p - file;
+      fi->serial  = 1000*(p[6]-'0') + 100*(p[7]-'0') + 10*(p[8]-'0') + (p[9]-'0');
+      fi->tag     = p[4];
+      fi->side    = ( p[22] << 8 ) | p[23];   //  Big endian
+      fi->intTime = ( p[26] << 8 ) | p[27];
+
+      p += framesize;
+    } else {
+      p++;
+    }
+  }
+
+  return nFrames;
+}
+
 static double immersionCoefficient_viaFit( double wl ) {
 
     double const wl2 = wl*wl;
@@ -1483,34 +1559,218 @@ static int parse_thermal_correction_file ( char* filename, double coeff[] ) {
    int16_t sTemperature  [8*MAXSPECTRA];
   int      nLights = 0;
 
-  double    XM [ SPECSIZE ][ SPECSIZE ];
+  double  (*XM)[ SPECSIZE ] = 0;
+
+//  Inverse stray light matrix
+//
+//  The text file holds SPECSIZE x SPECSIZE numbers, row by row.
+//  Parsing it takes seconds, so the matrix is also kept in a binary
+//  cache file next to it (name + ".bin"), which later runs map into memory.
+//  The cache is used only if it was made from a text file of the same size and time.
+//
+# define XM_CACHE_MAGIC "HNVXM001"
+
+typedef struct {
+  char     magic[8];
+  uint32_t rows;
+  uint32_t cols;
+  int64_t  src_size;
+  int64_t  src_mtime;
+  uint8_t  pad[32];   //  Matrix starts 64-byte aligned
+} XM_Cache_Header_t;
+
+static int map_inverse_stray_light_cache ( char const* cachename, struct stat const* src ) {
+
+  int fd = open ( cachename, O_RDONLY );
+  if ( fd < 0 ) return 0;
+
+  struct stat st;
+  size_t const size = sizeof(XM_Cache_Header_t) + sizeof(double)*SPECSIZE*SPECSIZE;
+
+  if ( fstat ( fd, &st ) || (size_t)st.st_size != size ) {
+    close ( fd );
+    return 0;
+  }
+
+  void* map = mmap ( 0, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close ( fd );
+
+  if ( MAP_FAILED == map ) return 0;
+
+  XM_Cache_Header_t const* h = map;
+
+  if ( memcmp ( h->magic, XM_CACHE_MAGIC, 8 )
+    || h->rows != SPECSIZE || h->cols != SPECSIZE
+    || h->src_size  != (int64_t)src->st_size
+    || h->src_mtime != (int64_t)src->st_mtime ) {
+    munmap ( map, size );
+    return 0;
+  }
+
+  XM = (double (*)[SPECSIZE]) ( (uint8_t*)map + sizeof(XM_Cache_Header_t) );
+
+  return SPECSIZE*SPECSIZE;
+}
+
+static void write_inverse_stray_light_cache ( char const* cachename, struct stat const* src ) {
+
+  XM_Cache_Header_t h;
+  memset ( &h, 0, sizeof(h) );
+  memcpy ( h.magic, XM_CACHE_MAGIC, 8 );
+  h.rows      = SPECSIZE;
+  h.cols      = SPECSIZE;
+  h.src_size  = src->st_size;
+  h.src_mtime = src->st_mtime;
+
+  //  Write to a temporary name, so that a concurrent run never maps a partial cache
+  //
+  char* tmpname = malloc ( strlen(cachename) + 16 );
+  sprintf ( tmpname, "%s.%d", cachename, (int)getpid() );
+
+  FILE* fp = fopen ( tmpname, "wb" );
+
+  if ( fp ) {
+    int ok = 1 == fwrite ( &h, sizeof(h), 1, fp )
+          && SPECSIZE == fwrite ( XM, sizeof(double)*SPECSIZE, SPECSIZE, fp );
+    ok = ( 0 == fclose ( fp ) ) && ok;
+
+    if ( !ok || rename ( tmpname, cachename ) ) {
+      fprintf ( stderr, "Info: Cannot write stray light matrix cache %s\n", cachename );
+      unlink ( tmpname );
+    }
+  }
+
+  free ( tmpname );
+}
 
 static int parse_inverse_stray_light_file ( char* filename ) {
 
   if ( !filename || !filename[0] ) return 0;
 
-  int nCoeffs = 0;
+  struct stat src;
+  if ( stat ( filename, &src ) ) return 0;
+
+  char* cachename = malloc ( strlen(filename) + 5 );
+  strcpy ( cachename, filename );
+  strcat ( cachename, ".bin" );
+
+  int nCoeffs = map_inverse_stray_light_cache ( cachename, &src );
+
+  if ( nCoeffs ) {
+    fprintf ( stderr, "Stray light matrix from %s\n", cachename );
+    free ( cachename );
+    return nCoeffs;
+  }
 
   FILE* fp = fopen ( filename, "r" );
 
+  char* text = 0;
+
   if ( fp ) {
+    text = malloc ( src.st_size + 1 );
+    if ( text && src.st_size != (off_t)fread ( text, 1, src.st_size, fp ) ) {
+      free ( text );
+      text = 0;
+    }
+    fclose ( fp );
+  }
+
+  if ( text ) {
+    text[src.st_size] = 0;
+
+    XM = malloc ( sizeof(double)*SPECSIZE*SPECSIZE );
+
+    //  strtod() converts exactly as fscanf("%lf") does
+    //
+    char* next = text;
     int row, col;
-    for ( row=0; row<SPECSIZE; row++ ) {
+    for ( row=0; row<SPECSIZE && XM; row++ ) {
     for ( col=0; col<SPECSIZE; col++ ) {
-      if ( 1 != fscanf ( fp, "%lf", &(XM[row][col]) ) ) {
-        fclose ( fp );
-        return nCoeffs;
+      char* end;
+      XM[row][col] = strtod ( next, &end );
+      if ( end == next ) {
+        row = SPECSIZE;
+        break;
       }
+      next = end;
       nCoeffs++;
     }
     }
 
-    fclose ( fp );
+    free ( text );
+
+    if ( SPECSIZE*SPECSIZE == nCoeffs ) {
+      write_inverse_stray_light_cache ( cachename, &src );
+    }
   }
 
+  free ( cachename );
   return nCoeffs;
 }
 
+//  out[v] = XM x in[v] for nvec spectra of SPECSIZE values.
+//
+//  Each XM tile of XM_ROWBLOCK rows by XM_COLBLOCK columns is loaded into cache
+//  once and used for all spectra, and row blocks are spread over OpenMP threads.
+//  Every output value is still summed over col = 0 .. SPECSIZE-1 in order,
+//  so the result is bit-identical to the plain triple loop.
+//
+# define XM_ROWBLOCK   4
+# define XM_COLBLOCK 512
+
+static void stray_light_correct ( double const (*xm)[SPECSIZE],
+                                  double const (*in)[SPECSIZE],
+                                  double       (*out)[SPECSIZE],
+                                  int nvec ) {
+  int rb;
+
+# pragma omp parallel for schedule(static)
+  for ( rb=0; rb<SPECSIZE; rb+=XM_ROWBLOCK ) {
+
+    int v;
+    for ( v=0; v<nvec; v++ ) {
+      int r;
+      for ( r=rb; r<rb+XM_ROWBLOCK; r++ ) {
+        out[v][r] = 0;
+      }
+    }
+
+    int cb;
+    for ( cb=0; cb<SPECSIZE; cb+=XM_COLBLOCK ) {
+
+      double const* x0 = xm[rb+0] + cb;
+      double const* x1 = xm[rb+1] + cb;
+      double const* x2 = xm[rb+2] + cb;
+      double const* x3 = xm[rb+3] + cb;
+
+      for ( v=0; v<nvec; v++ ) {
+
+        double const* s = in[v] + cb;
+
+        //  Four independent sums keep the FPU busy
+        //
+        double a0 = out[v][rb+0];
+        double a1 = out[v][rb+1];
+        double a2 = out[v][rb+2];
+        double a3 = out[v][rb+3];
+
+        int c;
+        for ( c=0; c<XM_COLBLOCK; c++ ) {
+          a0 += x0[c] * s[c];
+          a1 += x1[c] * s[c];
+          a2 += x2[c] * s[c];
+          a3 += x3[c] * s[c];
+        }
+
+        out[v][rb+0] = a0;
+        out[v][rb+1] = a1;
+        out[v][rb+2] = a2;
+        out[v][rb+3] = a3;
+      }
+    }
+  }
+}
+
 int main( int argc, char* argv[] ) {
 
   union {
@@ -1695,38 +1955,26 @@ int main( int argc, char* argv[] ) {
 
     if ( file_size ) {
 
-      uint8_t* haystack = fileInMemory;
-      size_t   haysize  = file_size;
-      char     needle[16]; snprintf ( needle, 16, "SATXDZ%04d", HyperNavSN );
-      size_t   needleSz = 10;
-
-      fprintf ( stderr, "Searching for %s\n", needle );
-
-      uint8_t* occurrence = 0;
+      Frame_Index_t* index;
+      int const nFrames = index_frames ( fileInMemory, file_size, framesize, &index );
 
-      while ( haystack && ( occurrence = memmem( haystack, haysize, needle, needleSz ) ) ) {
+      fprintf ( stderr, "Searching %d frames for SATXDZ%04d\n", nFrames, HyperNavSN );
 
-        size_t forward = occurrence-haystack;
-        haysize -= forward;
+      int f;
+      for ( f=0; f<nFrames && nDarks<MAXSPECTRA; f++ ) {
+        if ( 'D' == index[f].tag && HyperNavSN == index[f].serial ) {
 
-        if ( haysize > framesize  ) {
-          if ( nDarks<MAXSPECTRA ) {
+          uint8_t const* frame = fileInMemory + index[f].offset;
 
-            memcpy ( &(darkIntTime [nDarks]), occurrence+       26,    2 );
-            memcpy ( &(darkAverage [nDarks]), occurrence+       28,    2 );
-            memcpy (   darkSpectrum[nDarks] , occurrence+frame_aux, 4096 );
-            nDarks++;
-            haystack = occurrence + framesize;
-            haysize -= framesize;
-          } else {
-            haystack = 0;
-          }
-        } else {
-          haystack = 0;
+          memcpy ( &(darkIntTime [nDarks]), frame+       26,    2 );
+          memcpy ( &(darkAverage [nDarks]), frame+       28,    2 );
+          memcpy (   darkSpectrum[nDarks] , frame+frame_aux, 4096 );
+          nDarks++;
         }
-
       }
 
+      free ( index );
+
       //  TODO
       //  Verify frame validity using checksum
 
@@ -1769,38 +2017,26 @@ int main( int argc, char* argv[] ) {
     if ( file_size ) {
 
 
-      uint8_t* haystack = fileInMemory;
-      size_t   haysize  = file_size;
-      char     needle[16]; snprintf ( needle, 16, "SATXLZ%04d", HyperNavSN );
-      size_t   needleSz = 10;
-
-      fprintf ( stderr, "Searching for %s\n", needle );
-
-      uint8_t* occurrence = 0;
+      Frame_Index_t* index;
+      int const nFrames = index_frames ( fileInMemory, file_size, framesize, &index );
 
-      while ( haystack && ( occurrence = memmem( haystack, haysize, needle, needleSz ) ) ) {
+      fprintf ( stderr, "Searching %d frames for SATXLZ%04d\n", nFrames, HyperNavSN );
 
-        size_t forward = occurrence-haystack;
-        haysize -= forward;
+      int f;
+      for ( f=0; f<nFrames && nLights<8*MAXSPECTRA; f++ ) {
+        if ( 'L' == index[f].tag && HyperNavSN == index[f].serial ) {
 
-        if ( haysize > framesize  ) {
-          if ( nLights<8*MAXSPECTRA ) {
+          uint8_t const* frame = fileInMemory + index[f].offset;
 
-            memcpy ( &(lightIntTime [nLights]), occurrence+       26,    2 );
-            memcpy ( &(sTemperature [nLights]), occurrence+       34,    2 );
-            memcpy (   lightSpectrum[nLights] , occurrence+frame_aux, 4096 );
-            nLights++;
-            haystack = occurrence + framesize;
-            haysize -= framesize;
-          } else {
-            haystack = 0;
-          }
-        } else {
-          haystack = 0;
+          memcpy ( &(lightIntTime [nLights]), frame+       26,    2 );
+          memcpy ( &(sTemperature [nLights]), frame+       34,    2 );
+          memcpy (   lightSpectrum[nLights] , frame+frame_aux, 4096 );
+          nLights++;
         }
-
       }
 
+      free ( index );
+
       //  TODO
       //  Verify frame validity using checksum
 
@@ -1994,17 +2230,9 @@ int main( int argc, char* argv[] ) {
     //  Apply inverse stray light matrix multiplication
     //
 
-    int row;
-
-    for ( row=0; row<SPECSIZE; row+=1 ) {
-
-      XMxLMD[row] = 0;
-
-      int col;
-      for ( col=0; col<SPECSIZE; col++ ) {
-        XMxLMD[row] += XM[row][col] * LMD[col];
-      }
-    }
+    stray_light_correct ( (double const (*)[SPECSIZE]) XM,
+                          (double const (*)[SPECSIZE]) &LMD,
+                          (double (*)[SPECSIZE]) &XMxLMD, 1 );
 
   }
 
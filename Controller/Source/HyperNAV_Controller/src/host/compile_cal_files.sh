@@ -0,0 +1,37 @@
+#!/bin/sh
+
+#  Build the calibration file generator (frames.c with BUILD_CAL_FILES)
+#  and the host tests of its stray light correction and frame indexing.
+#  Without OpenMP, drop -fopenmp: the correction then runs on one thread
+#  and gives the same result.
+#
+#  The corrected values are bit-identical to those of the former generator,
+#  so the CalFiles/*.cal made with -X by either one compare equal:
+#          diff -r CalFiles.former CalFiles
+#
+#  Usage:  sh compile_cal_files.sh
+#          ./stray_light_test                  # random matrix, 16 spectra
+#          ./stray_light_test -x XM.txt -n 1   # a real matrix, one spectrum
+#          ./frame_index_test                  # 50000 frame synthetic capture
+#          ./frame_index_test -n 2000 -o cap.raw
+
+gcc \
+     -O2 -fopenmp \
+     -DBUILD_CAL_FILES \
+     -o cal_files \
+     ../frames.c \
+     -lm
+
+gcc \
+     -O2 -fopenmp \
+     -DBUILD_CAL_FILES \
+     -o stray_light_test \
+     stray_light_test.c \
+     -lm
+
+gcc \
+     -O2 \
+     -DBUILD_CAL_FILES \
+     -o frame_index_test \
+     frame_index_test.c \
+     -lm
@@ -0,0 +1,33 @@
+#!/bin/sh
+
+#  Build the host test of the write-behind data log file.
+#  datalogfile.c, files.c and FatFs are compiled unchanged over the RAM disk
+#  of the file library host test; standin/ runs the FreeRTOS calls on pthreads.
+#
+#  Usage:  sh compile_datalogfile_test.sh
+#          ./datalogfile_test                # 500 frames of 2048 pixels
+#          ./datalogfile_test -n2000 -c32768
+
+FILES=../avr32rlib/Utils/Files
+
+gcc \
+     -O2 -Wall \
+     -Wno-cpp \
+     -DOPERATION_AUTONOMOUS \
+     -o datalogfile_test \
+     -I standin \
+     -I $FILES/host \
+     -I $FILES \
+     -I $FILES/FATFs \
+     -I ../avr32rlib/Utils/Errno \
+     -I ../avr32rlib/Utils/Syslog \
+     -I .. \
+     -I ../../../../../Shared/FirmwareDefinitions \
+     ../datalogfile.c \
+     $FILES/files.c \
+     $FILES/FATFs/ff.c \
+     ../avr32rlib/Utils/Errno/avr32rerrno.c \
+     $FILES/host/diskio_ramdisk.c \
+     standin/freertos_host.c \
+     datalogfile_test.c \
+     -lpthread
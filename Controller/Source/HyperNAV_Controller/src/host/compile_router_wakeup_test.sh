@@ -0,0 +1,33 @@
+#!/bin/sh
+
+#  Build the host harness of packet latency and idle wake-ups
+#  of the data exchange task. data_exchange.controller.c and spi_link.c
+#  are compiled unchanged; standin/ runs the FreeRTOS calls on pthreads,
+#  and the harness plays the spectrometer board. pm.h is included first,
+#  for the GPLP trace calls of the task.
+#
+#  Usage:  sh compile_router_wakeup_test.sh
+#          ./router_wakeup_test              # 5 s traffic, 5 s quiet
+#          ./router_wakeup_test -b 20 -q 10
+
+FILES=../avr32rlib/Utils/Files
+
+gcc \
+     -O2 -Wall \
+     -Wno-cpp \
+     -DOPERATION_AUTONOMOUS \
+     -o router_wakeup_test \
+     -include standin/pm.h \
+     -I standin \
+     -I $FILES/host \
+     -I $FILES \
+     -I $FILES/FATFs \
+     -I ../avr32rlib/Utils/Errno \
+     -I ../avr32rlib/Utils/Syslog \
+     -I .. \
+     -I ../../../../../Shared/FirmwareDefinitions \
+     ../data_exchange.controller.c \
+     ../../../../../Shared/FirmwareDefinitions/spi_link.c \
+     standin/freertos_host.c \
+     router_wakeup_test.c \
+     -lpthread
@@ -0,0 +1,25 @@
+#!/bin/sh
+
+#  Build the host test of the wavelength to pixel range mapping.
+#  wavelength.c, files.c and FatFs are compiled unchanged over the RAM disk
+#  and the AVR32/FreeRTOS stand-ins of the file library host test.
+#
+#  Usage:  sh compile_wavelength_test.sh
+#          ./wavelength_test                 # 200 polynomials, 500 windows each
+#          ./wavelength_test -c 1000 -w 2000
+
+FILES=../avr32rlib/Utils/Files
+
+gcc \
+     -O2 -Wall \
+     -o wavelength_test \
+     -I $FILES/host \
+     -I $FILES \
+     -I $FILES/FATFs \
+     -I ../avr32rlib/Utils/Errno \
+     -I ../../../../../Shared/FirmwareDefinitions \
+     $FILES/files.c \
+     $FILES/FATFs/ff.c \
+     ../avr32rlib/Utils/Errno/avr32rerrno.c \
+     $FILES/host/diskio_ramdisk.c \
+     wavelength_test.c
@@ -0,0 +1,380 @@
+/*! \file datalogfile_test.c ****************************************************
+ *
+ * \brief Host test of the write-behind data log file over a RAM disk.
+ *
+ * Logs the frames of a simulated free fall profile the way frames.c and
+ * stream_log.c do (a frame header, a spectrum, a checksum and terminator,
+ * and now and then an OCR or MCOMS frame, each a DLF_Write() call), once
+ * through the open, append, write and close per call that DLF_Write()
+ * used to do, and once through datalogfile.c with its writer task.
+ * The disk_write() traffic per logged record of each is printed as CSV.
+ *
+ * Then checks that data reach the disk on time (DLF_SYNC_MS) without
+ * DLF_Stop(), and that DLF_Shutdown() writes out all data accepted.
+ *
+ * Exits 1 if a file differs from the data logged, or the writer task
+ * does not reduce the disk writes per record at least four-fold
+ * (with fewer sectors written).
+ *
+ **********************************************************************************/
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+
+# include "FreeRTOS.h"
+# include "semphr.h"
+# include "task.h"
+
+# include "compiler.h"
+# include "files.h"
+# include "ff.h"
+# include "diskio.h"
+# include "diskio_ramdisk.h"
+
+# include "datalogfile.h"
+# include "tasks.controller.h"
+# include "sram_memory_map.controller.h"
+
+# define DATE      "26-10-17"
+# define LOG_DIR   "0:\\FREEFALL\\" DATE "\\"
+
+//*****************************************************************************
+// Controller globals used by datalogfile.c
+//*****************************************************************************
+static U8 sram_ring[SRAM_DLF_RING_SIZE];
+static U8 sram_stage[SRAM_DLF_STAGE_SIZE];
+
+sram_pointer const sram_DLF_RING  = sram_ring;
+sram_pointer const sram_DLF_STAGE = sram_stage;
+
+xTaskHandle  gHNV_DataLogWriterTask_Handler = NULL;
+taskStatus_t gHNV_DataLogWriterTask_Status  = TASK_UNKNOWN;
+
+
+//*****************************************************************************
+// FatFs sync objects: the writer task and the test share the volume
+//*****************************************************************************
+int  ff_cre_syncobj(BYTE vol, _SYNC_t* sobj)	{ (void)vol; *sobj = xSemaphoreCreateMutex(); return *sobj != NULL; }
+int  ff_del_syncobj(_SYNC_t sobj)		{ (void)sobj; return 1; }
+int  ff_req_grant(_SYNC_t sobj)			{ return pdTRUE == xSemaphoreTake(sobj, portMAX_DELAY); }
+void ff_rel_grant(_SYNC_t sobj)			{ xSemaphoreGive(sobj); }
+
+
+// Deterministic content: byte k of everything logged
+static U8 content(U32 k)
+{
+	return (U8)(k*31 + (k>>8) + (k>>16)*7);
+}
+
+
+//*****************************************************************************
+// The two ways of logging
+//*****************************************************************************
+typedef S32 (*log_write_t)(U8* data, U16 size);
+
+static const char* old_file = "0:\\OLD.RAW";
+
+// DLF_Write() as it used to be
+static S32 old_write(U8* data, U16 size)
+{
+	fHandler_t fh;
+	S32 written;
+
+	if(f_open(old_file, O_WRONLY | O_APPEND, &fh) != FILE_OK)
+		return -3;
+
+	written = f_write(&fh, data, size);
+	f_close(&fh);
+	return written;
+}
+
+static S32 dlf_write(U8* data, U16 size)
+{
+	return DLF_Write(data, size);
+}
+
+
+// Log the pieces of one frame, and an auxiliary frame every few
+// Returns the number of records, or -1
+static U32 logged;
+
+static int log_piece(log_write_t write, U16 size)
+{
+	static U8 buf[8192];
+	U16 i;
+
+	for(i=0; i<size; i++)
+		buf[i] = content(logged+i);
+
+	if(write(buf, size) != size)
+		return -1;
+
+	logged += size;
+	return 1;
+}
+
+static int log_frame(log_write_t write, int f, int pixels)
+{
+	int records = 0;
+
+	if(log_piece(write, 40 + (f*13)%80) < 0)	return -1;	// SATX.., time, pressure, ... up to the spectrum
+	if(log_piece(write, 2*pixels) < 0)		return -1;	// spectrum
+	if(log_piece(write, 3) < 0)			return -1;	// checksum, \r\n
+	records = 3;
+
+	if(f%4 == 1) { if(log_piece(write, 46) < 0) return -1; records++; }	// OCR
+	if(f%4 == 3) { if(log_piece(write, 34) < 0) return -1; records++; }	// MCOMS
+
+	return records;
+}
+
+
+//*****************************************************************************
+// Volume and checks
+//*****************************************************************************
+
+// Partition, format and mount the RAM disk
+static int make_volume(DWORD sectors, UINT cluster)
+{
+	static FATFS fs;
+	static BYTE work[_MAX_SS];
+	DWORD plist[] = { 100, 0, 0, 0 };
+
+	if(ramdisk_create(sectors))
+		return -1;
+
+	if(disk_initialize(0))
+		return -2;
+
+	if(FATFs_f_fdisk(0, plist, work) != FR_OK)
+		return -3;
+
+	FATFs_f_mount(0, &fs);
+	if(FATFs_f_mkfs(0, 0, cluster) != FR_OK)
+		return -4;
+	FATFs_f_mount(0, NULL);
+
+	if(!f_fsProbe())
+		return -5;
+
+	return 0;
+}
+
+
+// Compare a file with: head, the logged content from 'from' to 'logged', tail
+static int verify(const char* name, const char* head, U32 from, const char* tail)
+{
+	fHandler_t fh;
+	U8 got[512];
+	U32 k = from;
+	int bad = 0;
+	size_t h = strlen(head), t = strlen(tail);
+
+	if(f_open(name, O_RDONLY, &fh) != FILE_OK)
+		return 1;
+
+	if(f_getSize(&fh) != (S32)(h + (logged-from) + t))
+		bad = 1;
+
+	if(!bad && (f_read(&fh, got, h) != (S32)h || memcmp(got, head, h)))
+		bad = 1;
+
+	while(!bad && k < logged)
+	{
+		U32 i, want = logged-k < sizeof(got) ? logged-k : sizeof(got);
+
+		if(f_read(&fh, got, want) != (S32)want)
+			bad = 1;
+		for(i=0; i<want && !bad; i++)
+			if(got[i] != content(k+i))
+				bad = 1;
+		k += want;
+	}
+
+	if(!bad && t && (f_read(&fh, got, t) != (S32)t || memcmp(got, tail, t)))
+		bad = 1;
+
+	f_close(&fh);
+	return bad;
+}
+
+
+// Size of a file as on the disk
+static S32 size_on_disk(const char* name)
+{
+	fHandler_t fh;
+	S32 size;
+
+	if(f_open(name, O_RDONLY, &fh) != FILE_OK)
+		return -1;
+	size = f_getSize(&fh);
+	f_close(&fh);
+	return size;
+}
+
+
+static void print_stats(const char* mode, int frames, int records, unsigned int cluster)
+{
+	printf("%s,%d,%d,%lu,%u,%lu,%lu,%.2f,%.2f,%lu\n",
+		mode, frames, records, (unsigned long)logged, cluster,
+		ramdisk_stats.writes, ramdisk_stats.write_sectors,
+		(double)ramdisk_stats.writes/records,
+		(double)ramdisk_stats.write_sectors/records,
+		ramdisk_stats.syncs);
+}
+
+
+static void print_usage(const char* pn)
+{
+	printf("Host test of the write-behind data log file over a RAM disk\n");
+	printf("Usage: %s [-h -? -nN -cC -pP]\n", pn);
+	printf("       -h, -?  Print this usage message.\n");
+	printf("       -nN     Frames logged [default: 500]\n");
+	printf("       -cC     Cluster size in bytes [default: 8192]\n");
+	printf("       -pP     Spectrum pixels [default: 2048]\n");
+	printf("Writes CSV to stdout: one line for open/append/close per DLF_Write(),\n");
+	printf("one for the writer task; then checks sync on time and at shutdown.\n");
+}
+
+
+int main(int argc, char** argv)
+{
+	int frames = 500, pixels = 2048;
+	unsigned int cluster = 8192;
+	int f, records, r, fail = 0;
+	double old_writes, old_sectors;
+
+	for(r=1; r<argc; r++)
+	{
+		if(argv[r][0] != '-' || argv[r][1] == 'h' || argv[r][1] == '?') { print_usage(argv[0]); return 0; }
+		switch(argv[r][1])
+		{
+		case 'n': frames  = atoi(argv[r]+2); break;
+		case 'c': cluster = atoi(argv[r]+2); break;
+		case 'p': pixels  = atoi(argv[r]+2); break;
+		default:  print_usage(argv[0]); return 0;
+		}
+	}
+	if(frames < 1 || pixels < 1 || 2*pixels > 8192) { print_usage(argv[0]); return 0; }
+
+	if(make_volume(frames*(2*pixels+512)/256 + 65536, cluster))
+	{
+		fprintf(stderr, "Cannot make RAM disk volume\n");
+		return 1;
+	}
+
+	if(!datalogfile_createTask())
+	{
+		fprintf(stderr, "Cannot create writer task\n");
+		return 1;
+	}
+
+	printf("mode,frames,records,bytes,cluster,disk_writes,sectors_written,writes_per_record,sectors_per_record,syncs\n");
+
+	// Open, append, write, close per DLF_Write()
+	{
+		fHandler_t fh;
+		f_open(old_file, O_WRONLY | O_CREAT, &fh);
+		f_close(&fh);
+
+		memset(&ramdisk_stats, 0, sizeof(ramdisk_stats));
+		logged = 0;
+		for(f=0, records=0; f<frames; f++)
+		{
+			if((r = log_frame(old_write, f, pixels)) < 0) break;
+			records += r;
+		}
+		print_stats("per_write", frames, records, cluster);
+		old_writes  = (double)ramdisk_stats.writes/records;
+		old_sectors = (double)ramdisk_stats.write_sectors/records;
+
+		if(f < frames || verify(old_file, "", 0, ""))
+		{
+			fprintf(stderr, "per_write: file differs from data logged\n");
+			fail = 1;
+		}
+	}
+
+	// Writer task
+	{
+		if(DLF_Start(DATE, 'F'))
+		{
+			fprintf(stderr, "DLF_Start() failed\n");
+			return 1;
+		}
+
+		memset(&ramdisk_stats, 0, sizeof(ramdisk_stats));
+		logged = 0;
+		for(f=0, records=0; f<frames; f++)
+		{
+			if((r = log_frame(dlf_write, f, pixels)) < 0) break;
+			records += r;
+		}
+		DLF_Stop();
+		print_stats("write_behind", frames, records, cluster);
+
+		if(f < frames || verify(LOG_DIR "FF-00001.raw", "BEGIN\r\n", 0, "END\r\n"))
+		{
+			fprintf(stderr, "write_behind: file differs from data logged\n");
+			fail = 1;
+		}
+
+		if(4.0*ramdisk_stats.writes/records > old_writes
+		|| (double)ramdisk_stats.write_sectors/records >= old_sectors)
+		{
+			fprintf(stderr, "write_behind: less than a four-fold reduction of disk writes per record\n");
+			fail = 1;
+		}
+	}
+
+	// Data reach the disk within DLF_SYNC_MS, without DLF_Stop()
+	{
+		S32 expect;
+
+		DLF_Start(DATE, 'F');
+		logged = 0;
+		for(f=0; f<3; f++)
+			log_frame(dlf_write, f, pixels);
+		expect = 7 + logged;
+
+		r = 0;
+		while(size_on_disk(LOG_DIR "FF-00002.raw") != expect && r++ < 80)
+			vTaskDelay(100);
+
+		printf("# sync on time: %ld of %ld bytes on disk after %d ms\n",
+			(long)size_on_disk(LOG_DIR "FF-00002.raw"), (long)expect, 100*r);
+		if(size_on_disk(LOG_DIR "FF-00002.raw") != expect)
+		{
+			fprintf(stderr, "sync on time: data not on disk\n");
+			fail = 1;
+		}
+		DLF_Stop();
+	}
+
+	// Power loss: DLF_Shutdown() writes out what was accepted
+	{
+		DLF_Start(DATE, 'F');
+		logged = 0;
+		for(f=0; f<frames/3+1; f++)
+			log_frame(dlf_write, f, pixels);
+		DLF_Shutdown();
+
+		printf("# shutdown: %lu bytes logged, %ld bytes in file\n",
+			(unsigned long)logged, (long)size_on_disk(LOG_DIR "FF-00003.raw") - 7);
+		if(verify(LOG_DIR "FF-00003.raw", "BEGIN\r\n", 0, ""))
+		{
+			fprintf(stderr, "shutdown: file differs from data logged\n");
+			fail = 1;
+		}
+		if(DLF_Write((U8*)"x", 1) != -2)
+		{
+			fprintf(stderr, "shutdown: DLF_Write() still accepted data\n");
+			fail = 1;
+		}
+	}
+
+	ramdisk_destroy();
+	return fail;
+}
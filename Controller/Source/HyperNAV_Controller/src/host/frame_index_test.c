@@ -0,0 +1,240 @@
+/*! \file frame_index_test.c *****************************************************
+ *
+ * \brief Host test and benchmark of the frame indexer and the interpolation
+ *        of the calibration file generator (frames.c built with BUILD_CAL_FILES).
+ *
+ * Generates a synthetic capture of N frames: dark and light frames of
+ * two instruments, with bits of telemetry text in between. Frames are
+ * then found once with the former memmem() loop, once per tag, and once
+ * with index_frames(). Lamp and plaque data are interpolated at the
+ * wavelengths of all pixels, with the former linear search and with
+ * lampIpol() / targIpol(). Timings are printed as CSV.
+ *
+ * Exits 1 if the indexer finds other frames, or interpolation differs.
+ *
+ **********************************************************************************/
+
+# define _GNU_SOURCE   //  memmem()
+
+# define main cal_files_main
+# include "../frames.c"
+# undef main
+
+# include <sys/time.h>
+
+//  As calculated in main() of frames.c
+//
+# define FRAME_AUX  ( 6+4 + 4 + 8 + 3*2 + 3*2 + 2 + 4 + 4*4 + 2 + 2 + 2*2 + 2*2 + 4 )
+# define FRAME_SIZE ( FRAME_AUX + 2048*2 + 1 )
+
+static double now ( void ) {
+  struct timeval tv;
+  gettimeofday ( &tv, 0 );
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+static uint8_t* make_capture ( int nFrames, size_t* size ) {
+
+  uint8_t* cap = malloc ( (size_t)nFrames * ( FRAME_SIZE + 64 ) );
+  uint8_t* p = cap;
+  int f;
+
+  for ( f=0; f<nFrames; f++ ) {
+
+    //  Occasional telemetry between frames
+    //
+    if ( 0 == f % 7 ) {
+      p += sprintf ( (char*)p, "SATHNV,%d,OK\r\n", f );
+    }
+
+    int const serial = ( f % 5 ) ? 1001 : 1002;
+    char const tag   = ( f % 3 ) ? 'L' : 'D';
+    sprintf ( (char*)p, "SATX%cZ%04d", tag, serial );
+
+    int i;
+    for ( i=10; i<FRAME_SIZE; i++ ) {
+      p[i] = (uint8_t)lrand48();
+    }
+    p[22] = 0;  p[23] = f & 1;                  //  Side
+    p[26] = 0;  p[27] = ( f < nFrames/2 ) ? 64 : 128; //  Integration time
+    p[FRAME_SIZE-1] = '\n';
+
+    p += FRAME_SIZE;
+  }
+  p += sprintf ( (char*)p, "SATHNV,END\r\n" );
+
+  *size = p - cap;
+  return cap;
+}
+
+//  The search index_frames() replaced
+//
+static int memmem_frames ( uint8_t* file, size_t file_size, char tag, int serial, size_t* offsets, int max ) {
+
+  uint8_t* haystack = file;
+  size_t   haysize  = file_size;
+  char     needle[16]; snprintf ( needle, 16, "SATX%cZ%04d", tag, serial );
+  size_t   needleSz = 10;
+  int      n = 0;
+
+  uint8_t* occurrence = 0;
+
+  while ( haystack && ( occurrence = memmem( haystack, haysize, needle, needleSz ) ) ) {
+
+    size_t forward = occurrence-haystack;
+    haysize -= forward;
+
+    if ( haysize > FRAME_SIZE && n < max ) {
+      offsets[n++] = occurrence - file;
+      haystack = occurrence + FRAME_SIZE;
+      haysize -= FRAME_SIZE;
+    } else {
+      haystack = 0;
+    }
+  }
+
+  return n;
+}
+
+//  The interpolation lampIpol() and targIpol() replaced
+//
+static double linearIpol ( double wavelength[], double value[], int numValues, double neededWL ) {
+
+  if ( neededWL < wavelength[0] ) return 0.0;
+  if ( wavelength[numValues-1] < neededWL ) return 0.0;
+
+  int i = 0;
+  while ( i<numValues && wavelength[i] < neededWL ) {
+    i++;
+  }
+
+  double W0 = wavelength[i-1];
+  double W1 = wavelength[i];
+
+  double V0 = value[i-1];
+  double V1 = value[i];
+
+  return V0 + ( V1 - V0 ) * ( neededWL - W0 ) / ( W1 - W0 );
+}
+
+static void print_usage ( char const* pn ) {
+  printf ( "Host test of frame indexing and interpolation of the cal file generator\n" );
+  printf ( "Usage: %s [-h -? -n N -o file]\n", pn );
+  printf ( "       -h, -?   Print this usage message.\n" );
+  printf ( "       -n N     Frames in the synthetic capture [default: 50000]\n" );
+  printf ( "       -o file  Also write the capture to file\n" );
+}
+
+int main ( int argc, char* argv[] ) {
+
+  int   nFrames = 50000;
+  char* out_fn  = 0;
+  int   opt;
+
+  while ( (opt = getopt(argc, argv, "h?n:o:")) != -1 ) {
+    switch ( opt ) {
+    case 'n': nFrames = atoi(optarg); break;
+    case 'o': out_fn  = optarg;       break;
+    default:  print_usage(argv[0]);   return 0;
+    }
+  }
+
+  if ( nFrames < 1 ) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  size_t size;
+  uint8_t* cap = make_capture ( nFrames, &size );
+
+  if ( out_fn ) {
+    FILE* fp = fopen ( out_fn, "wb" );
+    if ( !fp || 1 != fwrite ( cap, size, 1, fp ) || fclose ( fp ) ) {
+      fprintf ( stderr, "Cannot write %s\n", out_fn );
+      return 1;
+    }
+  }
+
+  int fail = 0;
+
+  printf ( "step,items,seconds,speedup,identical\n" );
+
+  //  Frames: the former search ran once per tag
+  //
+  size_t* offsets[2] = { malloc ( nFrames*sizeof(size_t) ), malloc ( nFrames*sizeof(size_t) ) };
+  char const tags[2] = { 'D', 'L' };
+  int nFound[2];
+  int t;
+
+  double t0 = now();
+  for ( t=0; t<2; t++ ) {
+    nFound[t] = memmem_frames ( cap, size, tags[t], 1001, offsets[t], nFrames );
+  }
+  double t1 = now();
+
+  Frame_Index_t* index;
+  int const nIndexed = index_frames ( cap, size, FRAME_SIZE, &index );
+  int nMatch[2] = { 0, 0 };
+  int same = ( nIndexed == nFrames );
+  int f;
+  for ( f=0; f<nIndexed; f++ ) {
+    if ( 1001 != index[f].serial ) continue;
+    t = ( 'L' == index[f].tag );
+    if ( nMatch[t] >= nFound[t] || offsets[t][nMatch[t]] != index[f].offset ) same = 0;
+    nMatch[t]++;
+  }
+  double t2 = now();
+
+  same = same && nMatch[0] == nFound[0] && nMatch[1] == nFound[1];
+  fail |= !same;
+
+  printf ( "memmem,%d,%.4f,1.0,1\n",     nFound[0]+nFound[1], t1-t0 );
+  printf ( "index_frames,%d,%.4f,%.1f,%d\n", nIndexed, t2-t1, (t1-t0)/(t2-t1), same );
+
+  free ( index );
+  free ( offsets[0] );
+  free ( offsets[1] );
+  free ( cap );
+
+  //  Interpolation over a plaque file sized grid, at all pixels of all subsamplings
+  //
+  int const nGrid = 10000;
+  double* wl  = malloc ( nGrid*sizeof(double) );
+  double* val = malloc ( nGrid*sizeof(double) );
+  int g;
+  for ( g=0; g<nGrid; g++ ) {
+    wl [g] = 250.0 + 0.1*g;
+    val[g] = 0.95 + 0.01*sin(0.01*g);
+  }
+
+  int const nQueries = 2*2*3*SPECSIZE;
+  double* linear = malloc ( nQueries*sizeof(double) );
+  double* binary = malloc ( nQueries*sizeof(double) );
+  int q;
+
+  t0 = now();
+  for ( q=0; q<nQueries; q++ ) {
+    linear[q] = linearIpol ( wl, val, nGrid, 240.0 + 1000.0*q/nQueries );
+  }
+  t1 = now();
+  for ( q=0; q<nQueries; q++ ) {
+    binary[q] = targIpol ( wl, val, nGrid, 240.0 + 1000.0*q/nQueries );
+  }
+  t2 = now();
+
+  same = !memcmp ( linear, binary, nQueries*sizeof(double) );
+  for ( q=0; q<nQueries; q++ ) {
+    if ( binary[q] != lampIpol ( wl, val, nGrid, 240.0 + 1000.0*q/nQueries ) ) same = 0;
+  }
+  fail |= !same;
+
+  printf ( "linear_search,%d,%.4f,1.0,1\n",      nQueries, t1-t0 );
+  printf ( "binary_search,%d,%.4f,%.1f,%d\n",    nQueries, t2-t1, (t1-t0)/(t2-t1), same );
+
+  free ( linear );
+  free ( binary );
+  free ( wl );
+  free ( val );
+
+  return fail;
+}
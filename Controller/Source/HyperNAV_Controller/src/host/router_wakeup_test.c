@@ -0,0 +1,396 @@
+/*! \file router_wakeup_test.c *****************************************************
+ *
+ * \brief Host harness of packet latency and idle wake-ups of the data exchange task
+ *
+ * data_exchange.controller.c and spi_link.c are compiled unchanged and run
+ * over the FreeRTOS stand-in (standin/), with 1 ms ticks. This harness
+ * provides what the task takes from the board: the SPI transport and the
+ * ready line of the spectrometer board, the GPLP trace register, the
+ * packet router and the SRAM packages.
+ *
+ * The spectrometer board is a thread running its own spi_link over a
+ * socket pair. Its ready line is active while one of its frames waits in
+ * the socket; putting a frame there is the falling edge, which gives the
+ * semaphore handed to SPI_Wake_On_OtherBoard_Active(), as the interrupt does.
+ *
+ * An acquisition thread pushes packets for the spectrometer board for a
+ * while, and the spectrometer board sends packets back; then both stay
+ * quiet. Prints as CSV the latency percentiles from pushing a packet to
+ * its delivery on the other board, and from raising the ready line to the
+ * task taking the frame, and the task's loop passes per second while
+ * there is no traffic. Loop passes are counted by the GPLP trace word,
+ * which the task clears at the top of every pass.
+ *
+ * Exits 1 if a packet is lost, if a 99th percentile latency is not below
+ * the task period (the delay of the former polling loop), if the idle task
+ * wakes more than twice a second, or if pausing the task takes longer than
+ * a task period.
+ *
+ * The stream log task is not covered: stream_log.c needs the frame,
+ * telemetry and configuration modules.
+ *
+ **********************************************************************************/
+
+# include <poll.h>
+# include <pthread.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <sys/socket.h>
+# include <time.h>
+# include <unistd.h>
+
+# include "FreeRTOS.h"
+# include "semphr.h"
+# include "task.h"
+# include "pm.h"
+
+# include "tasks.controller.h"
+# include "data_exchange.controller.h"
+# include "data_exchange_packet.h"
+# include "spectrometer_data.h"
+# include "sram_memory_map.controller.h"
+# include "spi.controller.h"
+# include "spi_link.h"
+# include "io_funcs.controller.h"
+
+//*****************************************************************************
+// Board of the controller task
+//*****************************************************************************
+
+xTaskHandle  gHNV_DataXControlTask_Handler;
+taskStatus_t gHNV_DataXControlTask_Status;
+
+static U8 dxc_1[ sizeof(Spectrometer_Data_t) ];
+static U8 dxc_2[ sizeof(Spectrometer_Data_t) ];
+static U8 dxc_link[ DE_LINK_SPEC_FRAME ];
+
+sram_pointer const sram_DXC_1    = dxc_1;
+sram_pointer const sram_DXC_2    = dxc_2;
+sram_pointer const sram_DXC_LINK = dxc_link;
+
+static double now_ms ( void ) {
+  struct timespec ts;
+  clock_gettime ( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+# define MAX_PACKETS 100000
+typedef struct {
+  double   ms[MAX_PACKETS];
+  int      n;
+} Samples_t;
+
+static Samples_t pushed_lat, line_lat;
+static double    pushed_ms[MAX_PACKETS];
+static int volatile pushed, delivered, sent, routed;
+static int volatile quiet;
+static long volatile passes;     //  loop passes during the quiet phase
+static int volatile  running = 1;
+
+static pthread_mutex_t samples_m = PTHREAD_MUTEX_INITIALIZER;
+
+static void sample ( Samples_t* s, double ms ) {
+  pthread_mutex_lock ( &samples_m );
+  if ( s->n < MAX_PACKETS ) s->ms[s->n++] = ms;
+  pthread_mutex_unlock ( &samples_m );
+}
+
+volatile avr32_pm_t AVR32_PM;
+
+unsigned long pm_read_gplp ( volatile avr32_pm_t* pm, unsigned long gplp ) {
+  return pm->gplp[gplp];
+}
+
+void pm_write_gplp ( volatile avr32_pm_t* pm, unsigned long gplp, unsigned long value ) {
+  //  The top of each pass clears the trace bits
+  if ( gplp == 1 && !( value & 0xFFF00000 ) && quiet ) passes++;
+  pm->gplp[gplp] = value;
+}
+
+S16 io_out_string ( char const* const string ) {
+  fputs ( string, stderr );
+  return 0;
+}
+
+S16 io_out_S32 ( char* format, S32 value ) {
+  fprintf ( stderr, format, (long)value );
+  return 0;
+}
+
+//  Packets the task passes to tasks on this board
+void data_exchange_packet_router ( data_exchange_address_t current_node, data_exchange_packet_t* packet ) {
+
+  (void)current_node;
+
+  if ( packet->to == DE_Addr_ControllerBoard_Commander && packet->type == DE_Type_Syslog_Message ) {
+    routed++;
+  }
+}
+
+//*****************************************************************************
+// Spectrometer board: SPI, ready line, its own link
+//*****************************************************************************
+
+static int sv[2];                        //  controller side, spectrometer side
+static xSemaphoreHandle volatile wake;   //  given at the falling edge
+static double volatile line_raised_ms;
+static pthread_mutex_t line_m = PTHREAD_MUTEX_INITIALIZER;
+
+static int write_all ( int fd, uint8_t const* p, size_t n ) {
+  while ( n ) {
+    ssize_t w = write ( fd, p, n );
+    if ( w <= 0 ) return -1;
+    p += w; n -= w;
+  }
+  return 0;
+}
+
+static int read_all ( int fd, uint8_t* p, size_t n ) {
+  while ( n ) {
+    ssize_t r = read ( fd, p, n );
+    if ( r <= 0 ) return -1;
+    p += r; n -= r;
+  }
+  return 0;
+}
+
+static int has_frame ( int fd ) {
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  return poll ( &pfd, 1, 0 ) > 0;
+}
+
+//  A 2 byte size, then the frame
+static int32_t frame_send ( int fd, uint8_t* frame, uint16_t size ) {
+  uint8_t s[2] = { size >> 8, size };
+  return write_all ( fd, s, 2 ) || write_all ( fd, frame, size ) ? -1 : size;
+}
+
+static int32_t frame_receive ( int fd, uint8_t* frame, uint16_t max_size ) {
+  uint8_t s[2];
+  if ( read_all ( fd, s, 2 ) ) return -1;
+  uint16_t size = ( s[0] << 8 ) | s[1];
+  if ( size > max_size || read_all ( fd, frame, size ) ) return -6;
+  return size;
+}
+
+SPI_Indicator_t SPI_Get_OtherBoard_Indicator ( void ) {
+  return has_frame ( sv[0] ) ? SPI_IND_Active : SPI_IND_Passive;
+}
+
+void SPI_Wake_On_OtherBoard_Active ( xSemaphoreHandle semaphore ) {
+  wake = semaphore;
+}
+
+int32_t SPI_link_send ( void* context, uint8_t* frame, uint16_t size ) {
+  (void)context;
+  return frame_send ( sv[0], frame, size );
+}
+
+int32_t SPI_link_receive ( void* context, uint8_t* frame, uint16_t max_size ) {
+
+  (void)context;
+  if ( !has_frame ( sv[0] ) ) return 0;
+
+  pthread_mutex_lock ( &line_m );
+  int32_t const size = frame_receive ( sv[0], frame, max_size );
+  if ( line_raised_ms > 0 ) {
+    sample ( &line_lat, now_ms() - line_raised_ms );
+  }
+  line_raised_ms = 0;
+  pthread_mutex_unlock ( &line_m );
+  return size;
+}
+
+//  The spectrometer board puts a frame out: the ready line falls.
+//  As over the SPI, it waits for the controller board to have taken
+//  the previous frame, and gives up after a while (frame kept).
+static int32_t spec_send ( void* context, uint8_t* frame, uint16_t size ) {
+
+  double const give_up_ms = now_ms() + 500;
+  (void)context;
+
+  while ( has_frame ( sv[0] ) ) {
+    if ( now_ms() > give_up_ms ) return -1;
+    vTaskDelay ( 1 );
+  }
+
+  pthread_mutex_lock ( &line_m );
+  int const edge = !has_frame ( sv[0] );
+  int32_t const r = frame_send ( sv[1], frame, size );
+  if ( edge ) {
+    line_raised_ms = now_ms();
+    if ( wake ) xSemaphoreGive ( wake );
+  }
+  pthread_mutex_unlock ( &line_m );
+  return r;
+}
+
+static int32_t spec_receive ( void* context, uint8_t* frame, uint16_t max_size ) {
+  (void)context;
+  return has_frame ( sv[1] ) ? frame_receive ( sv[1], frame, max_size ) : 0;
+}
+
+static SPI_Link_Transport_t const spec_transport = { 0, spec_send, spec_receive };
+static SPI_Link_t spec_link;
+static uint8_t    spec_frame[3][DE_LINK_SPEC_FRAME];
+
+static void put_header ( uint8_t* header, data_exchange_address_t to, data_exchange_address_t from, data_exchange_type_t type ) {
+  memcpy ( header,                                   &to,   sizeof(data_exchange_address_t) );
+  memcpy ( header+  sizeof(data_exchange_address_t), &from, sizeof(data_exchange_address_t) );
+  memcpy ( header+2*sizeof(data_exchange_address_t), &type, sizeof(data_exchange_type_t)    );
+}
+
+static void spec_deliver ( void* context, uint8_t* header, uint16_t header_size, uint8_t* data, uint16_t data_size ) {
+
+  data_exchange_syslog_t syslog;
+  (void)context; (void)header;
+
+  if ( header_size != DE_LINK_HEADER_SIZE || data_size != sizeof(syslog) ) return;
+  memcpy ( &syslog, data, sizeof(syslog) );
+  if ( syslog.value < MAX_PACKETS ) {
+    sample ( &pushed_lat, now_ms() - pushed_ms[syslog.value] );
+  }
+  delivered++;
+}
+
+//  Takes the frames of the controller board at once, sends a packet
+//  every 50..450 ms until quiet
+static void* spectrometer_board ( void* arg ) {
+
+  unsigned int seed = 11;
+  double next_ms = now_ms();
+  (void)arg;
+
+  while ( running ) {
+
+    struct pollfd pfd = { sv[1], POLLIN, 0 };
+    poll ( &pfd, 1, 1 );
+
+    while ( spi_link_receive ( &spec_link, spec_deliver, 0 ) > 0 ) ;
+
+    if ( !quiet && now_ms() >= next_ms && sent < MAX_PACKETS ) {
+      uint8_t header[ DE_LINK_HEADER_SIZE ];
+      data_exchange_syslog_t syslog = { SL_MSG_DXC_Sent, sent };
+      put_header ( header, DE_Addr_ControllerBoard_Commander, DE_Addr_DataAcquisition, DE_Type_Syslog_Message );
+      if ( SPI_LINK_OK == spi_link_queue ( &spec_link, header, DE_LINK_HEADER_SIZE, (uint8_t*)&syslog, sizeof(syslog) ) ) {
+        sent++;
+      }
+      next_ms = now_ms() + 50 + rand_r ( &seed ) % 400;
+    }
+
+    spi_link_flush ( &spec_link );
+  }
+  return 0;
+}
+
+//  Packets for the spectrometer board every 200..300 ms until quiet
+static void* acquisition ( void* arg ) {
+
+  unsigned int seed = 7;
+  (void)arg;
+
+  while ( running ) {
+    if ( !quiet && pushed < MAX_PACKETS ) {
+      data_exchange_packet_t p;
+      p.to   = DE_Addr_SpectrometerBoard_Commander;
+      p.from = DE_Addr_ControllerBoard_Commander;
+      p.type = DE_Type_Syslog_Message;
+      p.data.Syslog.number = SL_MSG_DXC_Received;
+      p.data.Syslog.value  = pushed;
+      pushed_ms[pushed] = now_ms();
+      pushed++;
+      data_exchange_controller_pushPacket ( &p );
+    }
+    vTaskDelay ( 200 + rand_r ( &seed ) % 100 );
+  }
+  return 0;
+}
+
+//*****************************************************************************
+// Measurements
+//*****************************************************************************
+
+static int cmp ( void const* a, void const* b ) {
+  double d = *(double const*)a - *(double const*)b;
+  return d < 0 ? -1 : d > 0;
+}
+
+static double pct ( Samples_t* s, double p ) {
+  if ( !s->n ) return 0;
+  int i = (int)( p * ( s->n - 1 ) + 0.5 );
+  return s->ms[i];
+}
+
+static void print_usage ( char const* pn ) {
+  printf ( "Host harness of packet latency and idle wake-ups of the data exchange task\n" );
+  printf ( "Usage: %s [-h -? -bB -qQ]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -bB     Seconds with traffic [default: 5]\n" );
+  printf ( "       -qQ     Seconds without traffic [default: 5]\n" );
+}
+
+int main ( int argc, char** argv ) {
+
+  int busy_s = 5, quiet_s = 5;
+  int opt;
+
+  while ( ( opt = getopt ( argc, argv, "h?b:q:" ) ) != -1 ) {
+    switch ( opt ) {
+    case 'b': busy_s  = atoi ( optarg ); break;
+    case 'q': quiet_s = atoi ( optarg ); break;
+    default : print_usage ( argv[0] ); return 0;
+    }
+  }
+  if ( busy_s < 1 || quiet_s < 1 ) {
+    print_usage ( argv[0] );
+    return 1;
+  }
+
+  uint8_t* frame[3] = { spec_frame[0], spec_frame[1], spec_frame[2] };
+  if ( socketpair ( AF_UNIX, SOCK_STREAM, 0, sv )
+    || spi_link_init ( &spec_link, frame, DE_LINK_SPEC_FRAME, DE_LINK_CTRL_FRAME, DE_LINK_RECORDS_MAX, &spec_transport )
+    || !data_exchange_controller_createTask()
+    || !data_exchange_controller_resumeTask() ) {
+    fprintf ( stderr, "Cannot set up the task\n" );
+    return 1;
+  }
+
+  pthread_t t[2];
+  pthread_create ( &t[0], 0, spectrometer_board, 0 );
+  pthread_create ( &t[1], 0, acquisition, 0 );
+
+  vTaskDelay ( busy_s * 1000 );
+  quiet = 1;
+  vTaskDelay ( 500 );              //  let the last packets drain
+  passes = 0;
+  vTaskDelay ( quiet_s * 1000 );
+  double const passes_per_s = passes / (double)quiet_s;
+
+  double const pause_ms = now_ms();
+  data_exchange_controller_pauseTask();
+  double const paused_ms = now_ms() - pause_ms;
+
+  running = 0;
+  pthread_join ( t[0], 0 );
+  pthread_join ( t[1], 0 );
+
+  qsort ( pushed_lat.ms, pushed_lat.n, sizeof(double), cmp );
+  qsort ( line_lat.ms,   line_lat.n,   sizeof(double), cmp );
+
+  printf ( "path,packets,taken,p50_ms,p90_ms,p99_ms,max_ms\n" );
+  printf ( "to_other_board,%d,%d,%.2f,%.2f,%.2f,%.2f\n", pushed, delivered,
+           pct ( &pushed_lat, 0.5 ), pct ( &pushed_lat, 0.9 ), pct ( &pushed_lat, 0.99 ), pct ( &pushed_lat, 1.0 ) );
+  printf ( "from_other_board,%d,%d,%.2f,%.2f,%.2f,%.2f\n", sent, routed,
+           pct ( &line_lat, 0.5 ), pct ( &line_lat, 0.9 ), pct ( &line_lat, 0.99 ), pct ( &line_lat, 1.0 ) );
+  printf ( "idle_passes_per_s,%.1f\n", passes_per_s );
+  printf ( "pause_ms,%.1f\n", paused_ms );
+
+  int fail = !pushed || delivered != pushed || !sent || routed != sent
+          || pct ( &pushed_lat, 0.99 ) >= HNV_DataXControlTask_PERIOD_MS
+          || pct ( &line_lat,   0.99 ) >= HNV_DataXControlTask_PERIOD_MS
+          || passes_per_s > 2
+          || paused_ms >= HNV_DataXControlTask_PERIOD_MS;
+  if ( fail ) fprintf ( stderr, "FAIL\n" );
+  return fail;
+}
@@ -0,0 +1,34 @@
+/*! \file FreeRTOS.h (host build) ***********************************************
+ *
+ * \brief Stand-in for the FreeRTOS 7 kernel, over pthreads,
+ *        for running tasks of the controller in a host process.
+ *        Ticks are milliseconds.
+ *
+  ***************************************************************************/
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t	portTickType;
+#define portBASE_TYPE		long
+typedef long		portSTACK_TYPE;
+
+#define portCHAR		char
+#define portMAX_DELAY		((portTickType)0xffffffff)
+#define portTICK_RATE_MS	((portTickType)1)
+#define TASK_DELAY_MS(x)	((x)/portTICK_RATE_MS)
+
+#define pdTRUE		1
+#define pdFALSE		0
+#define pdPASS		1
+#define pdFAIL		0
+
+#define tskIDLE_PRIORITY	0
+
+typedef struct host_queue*	xQueueHandle;
+typedef xQueueHandle		xSemaphoreHandle;
+typedef void*			xTaskHandle;
+typedef void (*pdTASK_CODE)(void*);
+
+#endif
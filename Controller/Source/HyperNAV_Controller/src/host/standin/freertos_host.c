@@ -0,0 +1,210 @@
+/*! \file freertos_host.c (host build) ******************************************
+ *
+ * \brief Queues, semaphores and tasks of the FreeRTOS stand-in, over pthreads.
+ *
+  ***************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+struct host_queue {
+	pthread_mutex_t	lock;
+	pthread_cond_t	changed;
+	unsigned	length;
+	unsigned	itemSize;
+	unsigned	count;
+	unsigned	first;
+	unsigned char*	items;
+};
+
+
+xQueueHandle xQueueCreate(unsigned portBASE_TYPE length, unsigned portBASE_TYPE itemSize)
+{
+	xQueueHandle q = calloc(1, sizeof(struct host_queue));
+
+	if(!q || !length)
+		return NULL;
+
+	q->items = calloc(length, itemSize ? itemSize : 1);
+	if(!q->items)
+	{
+		free(q);
+		return NULL;
+	}
+	q->length = length;
+	q->itemSize = itemSize;
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->changed, NULL);
+	return q;
+}
+
+
+xSemaphoreHandle host_semaphore_create(int given)
+{
+	xSemaphoreHandle s = xQueueCreate(1, 0);
+
+	if(s && given)
+		xSemaphoreGive(s);
+	return s;
+}
+
+
+// Wait for the queue to change, 0 on timeout (hold q->lock)
+static int wait_change(xQueueHandle q, portTickType wait, const struct timespec* until)
+{
+	if(wait == portMAX_DELAY)
+		return 0 == pthread_cond_wait(&q->changed, &q->lock);
+
+	return ETIMEDOUT != pthread_cond_timedwait(&q->changed, &q->lock, until);
+}
+
+
+static void deadline(portTickType wait, struct timespec* until)
+{
+	clock_gettime(CLOCK_REALTIME, until);
+	until->tv_sec  += wait / 1000;
+	until->tv_nsec += (wait % 1000) * 1000000L;
+	if(until->tv_nsec >= 1000000000L)
+	{
+		until->tv_sec++;
+		until->tv_nsec -= 1000000000L;
+	}
+}
+
+
+portBASE_TYPE xQueueSendToBack(xQueueHandle q, const void* item, portTickType wait)
+{
+	struct timespec until;
+	portBASE_TYPE rv = pdFALSE;
+
+	deadline(wait, &until);
+	pthread_mutex_lock(&q->lock);
+
+	while(q->count == q->length)
+		if(!wait || !wait_change(q, wait, &until))
+			break;
+
+	if(q->count < q->length)
+	{
+		if(q->itemSize)
+			memcpy(q->items + ((q->first + q->count) % q->length) * q->itemSize, item, q->itemSize);
+		q->count++;
+		pthread_cond_broadcast(&q->changed);
+		rv = pdTRUE;
+	}
+
+	pthread_mutex_unlock(&q->lock);
+	return rv;
+}
+
+
+portBASE_TYPE xQueueReceive(xQueueHandle q, void* buffer, portTickType wait)
+{
+	struct timespec until;
+	portBASE_TYPE rv = pdFALSE;
+
+	deadline(wait, &until);
+	pthread_mutex_lock(&q->lock);
+
+	while(q->count == 0)
+		if(!wait || !wait_change(q, wait, &until))
+			break;
+
+	if(q->count)
+	{
+		if(q->itemSize)
+			memcpy(buffer, q->items + q->first * q->itemSize, q->itemSize);
+		q->first = (q->first + 1) % q->length;
+		q->count--;
+		pthread_cond_broadcast(&q->changed);
+		rv = pdTRUE;
+	}
+
+	pthread_mutex_unlock(&q->lock);
+	return rv;
+}
+
+
+unsigned portBASE_TYPE uxQueueMessagesWaiting(xQueueHandle q)
+{
+	unsigned portBASE_TYPE n;
+
+	pthread_mutex_lock(&q->lock);
+	n = q->count;
+	pthread_mutex_unlock(&q->lock);
+	return n;
+}
+
+
+void vQueueDelete(xQueueHandle q)
+{
+	pthread_mutex_destroy(&q->lock);
+	pthread_cond_destroy(&q->changed);
+	free(q->items);
+	free(q);
+}
+
+
+struct task_start {
+	pdTASK_CODE	code;
+	void*		parameters;
+};
+
+static void* task_thread(void* arg)
+{
+	struct task_start start = *(struct task_start*)arg;
+
+	free(arg);
+	start.code(start.parameters);
+	return NULL;
+}
+
+
+portBASE_TYPE xTaskCreate(pdTASK_CODE code, const signed portCHAR* name, unsigned short stackDepth,
+                          void* parameters, unsigned portBASE_TYPE priority, xTaskHandle* created)
+{
+	pthread_t thread;
+	struct task_start* start = malloc(sizeof(struct task_start));
+
+	(void)name; (void)stackDepth; (void)priority;
+
+	if(!start)
+		return pdFAIL;
+	start->code = code;
+	start->parameters = parameters;
+
+	if(pthread_create(&thread, NULL, task_thread, start))
+	{
+		free(start);
+		return pdFAIL;
+	}
+	pthread_detach(thread);
+
+	if(created)
+		*created = (xTaskHandle)thread;
+	return pdPASS;
+}
+
+
+portTickType xTaskGetTickCount(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (portTickType)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+
+void vTaskDelay(portTickType ticks)
+{
+	usleep(ticks * 1000);
+}
@@ -0,0 +1,20 @@
+/*! \file pm.h (host build) *****************************************************
+ *
+ * \brief Stand-in for the general purpose low-power registers of the power
+ *        manager, which the controller tasks write as a trace of their loop.
+ *        The harness defines AVR32_PM and the two accessors.
+ *
+  ***************************************************************************/
+#ifndef _PM_H_
+#define _PM_H_
+
+typedef struct {
+	unsigned long	gplp[2];
+} avr32_pm_t;
+
+extern volatile avr32_pm_t AVR32_PM;
+
+unsigned long pm_read_gplp(volatile avr32_pm_t* pm, unsigned long gplp);
+void pm_write_gplp(volatile avr32_pm_t* pm, unsigned long gplp, unsigned long value);
+
+#endif
@@ -0,0 +1,19 @@
+/*! \file queue.h (host build) **************************************************
+ *
+ * \brief Stand-in for the FreeRTOS queue API, over pthreads.
+ *
+  ***************************************************************************/
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include "FreeRTOS.h"
+
+xQueueHandle xQueueCreate(unsigned portBASE_TYPE length, unsigned portBASE_TYPE itemSize);
+portBASE_TYPE xQueueSendToBack(xQueueHandle q, const void* item, portTickType wait);
+portBASE_TYPE xQueueReceive(xQueueHandle q, void* buffer, portTickType wait);
+unsigned portBASE_TYPE uxQueueMessagesWaiting(xQueueHandle q);
+void vQueueDelete(xQueueHandle q);
+
+#define xQueueSend	xQueueSendToBack
+
+#endif
@@ -0,0 +1,20 @@
+/*! \file semphr.h (host build) *************************************************
+ *
+ * \brief Stand-in for the FreeRTOS semaphores, which are queues
+ *        of zero sized items as in the kernel. The mutex does not
+ *        inherit priority.
+ *
+  ***************************************************************************/
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "queue.h"
+
+xSemaphoreHandle host_semaphore_create(int given);
+
+#define vSemaphoreCreateBinary(x)	((x) = host_semaphore_create(1))
+#define xSemaphoreCreateMutex()		host_semaphore_create(1)
+#define xSemaphoreTake(x, wait)		xQueueReceive((x), NULL, (wait))
+#define xSemaphoreGive(x)		xQueueSendToBack((x), NULL, 0)
+
+#endif
@@ -0,0 +1,14 @@
+/*! \file smc_sram.h (host build) ***********************************************
+ *
+ * \brief Stand-in for the SRAM on the EBI: the harness defines the
+ *        sram_pointer constants it needs over host memory.
+ *
+  ***************************************************************************/
+#ifndef _SMC_SRAM_H_
+#define _SMC_SRAM_H_
+
+#include "compiler.h"
+
+typedef U8* sram_pointer;
+
+#endif
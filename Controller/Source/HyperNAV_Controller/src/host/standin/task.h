@@ -0,0 +1,21 @@
+/*! \file task.h (host build) ***************************************************
+ *
+ * \brief Stand-in for the FreeRTOS task API: a task is a detached thread,
+ *        priorities are ignored.
+ *
+  ***************************************************************************/
+#ifndef TASK_H
+#define TASK_H
+
+#include <sched.h>
+
+#include "FreeRTOS.h"
+
+portBASE_TYPE xTaskCreate(pdTASK_CODE code, const signed portCHAR* name, unsigned short stackDepth,
+                          void* parameters, unsigned portBASE_TYPE priority, xTaskHandle* created);
+portTickType xTaskGetTickCount(void);
+void vTaskDelay(portTickType ticks);
+
+#define taskYIELD()	sched_yield()
+
+#endif
@@ -0,0 +1,183 @@
+/*! \file stray_light_test.c *****************************************************
+ *
+ * \brief Host test and benchmark of the stray light correction of the
+ *        calibration file generator (frames.c built with BUILD_CAL_FILES).
+ *
+ * Reads an inverse stray light matrix (or writes a random one), then
+ *  - parses the text file, and maps the binary cache it leaves behind,
+ *  - applies it to N spectra with the former triple loop and with
+ *    stray_light_correct(),
+ * and prints the timings as CSV.
+ *
+ * Exits 1 if the cached matrix or any corrected value is not
+ * bit-identical to the text file and the former loop.
+ *
+ **********************************************************************************/
+
+# define main cal_files_main
+# include "../frames.c"
+# undef main
+
+# include <sys/time.h>
+
+static double now ( void ) {
+  struct timeval tv;
+  gettimeofday ( &tv, 0 );
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+//  The loop stray_light_correct() replaces
+//
+static void stray_light_reference ( double const* in, double* out ) {
+  int row;
+  for ( row=0; row<SPECSIZE; row+=1 ) {
+    out[row] = 0;
+    int col;
+    for ( col=0; col<SPECSIZE; col++ ) {
+      out[row] += XM[row][col] * in[col];
+    }
+  }
+}
+
+static int write_random_matrix ( char const* filename ) {
+  FILE* fp = fopen ( filename, "w" );
+  if ( !fp ) return 1;
+
+  //  Diagonally dominant, like an inverse stray light matrix
+  //
+  int row, col;
+  for ( row=0; row<SPECSIZE; row++ ) {
+    for ( col=0; col<SPECSIZE; col++ ) {
+      double x = ( row == col ) ? 1.0 + 1e-3*drand48() : -1e-5*drand48();
+      fprintf ( fp, "%.17g%c", x, col<SPECSIZE-1 ? '\t' : '\n' );
+    }
+  }
+  return fclose ( fp );
+}
+
+static void print_usage ( char const* pn ) {
+  printf ( "Host test of the stray light correction\n" );
+  printf ( "Usage: %s [-h -? -x XMfile -n N -r R]\n", pn );
+  printf ( "       -h, -?     Print this usage message.\n" );
+  printf ( "       -x XMfile  Inverse stray light matrix [default: random, in /tmp]\n" );
+  printf ( "       -n N       Spectra corrected in one call [default: 16]\n" );
+  printf ( "       -r R       Repetitions timed [default: 5]\n" );
+}
+
+int main ( int argc, char* argv[] ) {
+
+  char* XM_fn = 0;
+  int   nvec  = 16;
+  int   reps  = 5;
+  int   opt;
+
+  while ( (opt = getopt(argc, argv, "h?x:n:r:")) != -1 ) {
+    switch ( opt ) {
+    case 'x': XM_fn = optarg;        break;
+    case 'n': nvec  = atoi(optarg);  break;
+    case 'r': reps  = atoi(optarg);  break;
+    default:  print_usage(argv[0]);  return 0;
+    }
+  }
+
+  if ( nvec < 1 || reps < 1 ) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  char tmpname[64];
+  if ( !XM_fn ) {
+    snprintf ( tmpname, sizeof(tmpname), "/tmp/stray_light_test.%d.txt", (int)getpid() );
+    XM_fn = tmpname;
+    if ( write_random_matrix ( XM_fn ) ) {
+      fprintf ( stderr, "Cannot write %s\n", XM_fn );
+      return 1;
+    }
+  }
+
+  char cachename[256];
+  snprintf ( cachename, sizeof(cachename), "%s.bin", XM_fn );
+  unlink ( cachename );
+
+  int fail = 0;
+
+  printf ( "step,spectra,seconds,per_spectrum_ms,identical\n" );
+
+  //  Parse text, then map the cache written by the first parse
+  //
+  double t0 = now();
+  int n = parse_inverse_stray_light_file ( XM_fn );
+  double t1 = now();
+
+  if ( SPECSIZE*SPECSIZE != n ) {
+    fprintf ( stderr, "%s: %d values\n", XM_fn, n );
+    return 1;
+  }
+
+  double (*text)[SPECSIZE] = XM;
+
+  double t2 = now();
+  n = parse_inverse_stray_light_file ( XM_fn );
+  double t3 = now();
+
+  int same = ( SPECSIZE*SPECSIZE == n ) && XM != text
+          && !memcmp ( XM, text, sizeof(double)*SPECSIZE*SPECSIZE );
+  fail |= !same;
+
+  printf ( "parse_text,1,%.3f,%.3f,1\n", t1-t0, 1e3*(t1-t0) );
+  printf ( "map_cache,1,%.6f,%.3f,%d\n", t3-t2, 1e3*(t3-t2), same );
+
+  //  Correct spectra: former loop against blocked kernel
+  //
+  double (*in )[SPECSIZE] = malloc ( sizeof(double)*SPECSIZE*nvec );
+  double (*ref)[SPECSIZE] = malloc ( sizeof(double)*SPECSIZE*nvec );
+  double (*out)[SPECSIZE] = malloc ( sizeof(double)*SPECSIZE*nvec );
+
+  int v, c, r;
+  for ( v=0; v<nvec; v++ ) {
+    for ( c=0; c<SPECSIZE; c++ ) {
+      in[v][c] = 65535.0 * drand48() - 2000.0;
+    }
+  }
+
+  t0 = now();
+  for ( r=0; r<reps; r++ ) {
+    for ( v=0; v<nvec; v++ ) {
+      stray_light_reference ( in[v], ref[v] );
+    }
+  }
+  t1 = now();
+
+  t2 = now();
+  for ( r=0; r<reps; r++ ) {
+    stray_light_correct ( (double const (*)[SPECSIZE]) XM, (double const (*)[SPECSIZE]) in, out, nvec );
+  }
+  t3 = now();
+
+  same = !memcmp ( out, ref, sizeof(double)*SPECSIZE*nvec );
+  fail |= !same;
+
+  printf ( "triple_loop,%d,%.3f,%.3f,1\n",       nvec, t1-t0, 1e3*(t1-t0)/reps/nvec );
+  printf ( "blocked,%d,%.3f,%.3f,%d\n",          nvec, t3-t2, 1e3*(t3-t2)/reps/nvec, same );
+
+  if ( !same ) {
+    double maxdiff = 0;
+    for ( v=0; v<nvec; v++ ) {
+      for ( c=0; c<SPECSIZE; c++ ) {
+        double d = fabs ( out[v][c] - ref[v][c] );
+        if ( d > maxdiff ) maxdiff = d;
+      }
+    }
+    fprintf ( stderr, "blocked: max difference %g\n", maxdiff );
+  }
+
+  free ( in );
+  free ( ref );
+  free ( out );
+  free ( text );
+
+  unlink ( cachename );
+  if ( XM_fn == tmpname ) unlink ( tmpname );
+
+  return fail;
+}
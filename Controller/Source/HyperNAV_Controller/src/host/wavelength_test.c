@@ -0,0 +1,241 @@
+/*! \file wavelength_test.c ******************************************************
+ *
+ * \brief Host test of the wavelength to pixel range mapping (wavelength.c)
+ *        over a RAM disk.
+ *
+ * For random wavelength polynomials (increasing, decreasing, and not
+ * monotonic over the cells), a .WLC file is written, parsed, and loaded
+ * back via its binary file. Then random wavelength windows are mapped
+ * with wl_PixelRange() / wl_PixelRanges() and with a linear scan over
+ * all cells, and the results compared. Timings are printed as CSV.
+ *
+ * Exits 1 if any window maps differently.
+ *
+ **********************************************************************************/
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+# include <sys/time.h>
+
+# include "../wavelength.c"
+
+# include "ff.h"
+# include "diskio.h"
+# include "diskio_ramdisk.h"
+
+//*****************************************************************************
+// FatFs sync objects (single threaded host)
+//*****************************************************************************
+int  ff_cre_syncobj(BYTE vol, _SYNC_t* sobj)	{ (void)vol; *sobj = 0; return 1; }
+int  ff_del_syncobj(_SYNC_t sobj)		{ (void)sobj; return 1; }
+int  ff_req_grant(_SYNC_t sobj)			{ (void)sobj; return 1; }
+void ff_rel_grant(_SYNC_t sobj)			{ (void)sobj; }
+
+//	As in io_funcs.controller.c
+char* scan_to_next_EOL ( char start[], char** next_start ) {
+
+	if ( (char*)0 == start ) return (char*)0;
+
+	char* begin_of_line = start;
+	while ( *begin_of_line == '\r' || *begin_of_line == '\n' )
+		begin_of_line++;
+
+	if ( 0 == *begin_of_line ) return (char*)0;
+
+	char* end_of_line = begin_of_line;
+	while ( *end_of_line != 0 && *end_of_line != '\r' && *end_of_line != '\n' )
+		end_of_line++;
+
+	if ( *end_of_line ) {
+		*end_of_line = 0;
+		*next_start = end_of_line+1;
+	} else {
+		*next_start = end_of_line;
+	}
+
+	return begin_of_line;
+}
+
+static double now ( void ) {
+	struct timeval tv;
+	gettimeofday ( &tv, 0 );
+	return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+//	The scan wl_PixelRange() replaced
+static S16 linear_range ( S16 side, F64 wl_low, F64 wl_high, S16* px_low, S16* px_high ) {
+
+	*px_low  = N_SPEC_PIX-1;
+	*px_high = 0;
+
+	S16 cell;
+	for ( cell=0; cell<N_SPEC_PIX; cell++ ) {
+		if ( wl_wlenOfCell ( side, cell ) >= wl_low ) {
+			*px_low = cell;
+			break;
+		}
+	}
+	for ( cell=N_SPEC_PIX-1; cell>0; cell-- ) {
+		if ( wl_wlenOfCell ( side, cell ) <= wl_high ) {
+			*px_high = cell;
+			break;
+		}
+	}
+
+	return *px_high ? WL_OK : WL_FAIL;
+}
+
+static int write_wlc ( S16 side, F64 const c[4], S16 pixbase ) {
+
+	char text[256];
+	int n = snprintf ( text, sizeof(text),
+		"# Zeiss-CGS-UV-NIR 0%d\r\nPIXBASE %hd\r\nC0 %.9e\r\nC1 %.9e\r\nC2 %.9e\r\nC3 %.9e\r\n",
+		1000+side, pixbase, c[0], c[1], c[2], c[3] );
+
+	fHandler_t fh;
+	if ( FILE_OK != f_open ( wl_MakeFileName(side), O_WRONLY | O_CREAT | O_TRUNC, &fh ) )
+		return 1;
+	int bad = ( n != f_write ( &fh, text, n ) );
+	f_close ( &fh );
+
+	f_delete ( wl_MakeBinFName(side) );
+
+	return bad;
+}
+
+static void print_usage ( char const* pn ) {
+	printf ( "Host test of the wavelength to pixel range mapping\n" );
+	printf ( "Usage: %s [-h -? -c C -w W]\n", pn );
+	printf ( "       -h, -?  Print this usage message.\n" );
+	printf ( "       -c C    Random wavelength polynomials [default: 200]\n" );
+	printf ( "       -w W    Random windows per polynomial [default: 500]\n" );
+}
+
+int main ( int argc, char** argv ) {
+
+	int polys = 200, windows = 500;
+	int opt;
+
+	while ( (opt = getopt(argc, argv, "h?c:w:")) != -1 ) {
+		switch ( opt ) {
+		case 'c': polys   = atoi(optarg); break;
+		case 'w': windows = atoi(optarg); break;
+		default:  print_usage(argv[0]);   return 0;
+		}
+	}
+
+	if ( polys < 1 || windows < 1 || windows > 30000 ) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	//	RAM disk volume
+	static FATFS fs;
+	static BYTE work[_MAX_SS];
+	DWORD plist[] = { 100, 0, 0, 0 };
+
+	if ( ramdisk_create(8192) || disk_initialize(0)
+	  || FATFs_f_fdisk(0, plist, work) != FR_OK ) {
+		fprintf ( stderr, "Cannot create RAM disk\n" );
+		return 1;
+	}
+	FATFs_f_mount(0, &fs);
+	if ( FATFs_f_mkfs(0, 0, 4096) != FR_OK ) return 1;
+	FATFs_f_mount(0, NULL);
+	if ( !f_fsProbe() ) return 1;
+
+	F64* lo  = malloc ( windows*sizeof(F64) );
+	F64* hi  = malloc ( windows*sizeof(F64) );
+	S16* pl  = malloc ( windows*sizeof(S16) );
+	S16* ph  = malloc ( windows*sizeof(S16) );
+	S16* rpl = malloc ( windows*sizeof(S16) );
+	S16* rph = malloc ( windows*sizeof(S16) );
+
+	int kinds[3] = { 0, 0, 0 };
+	long mismatches = 0;
+	double t_linear = 0, t_binary = 0;
+	int p;
+
+	srand48 ( 1 );
+
+	for ( p=0; p<polys; p++ ) {
+
+		S16 const side = p & 1;
+
+		//	Like a real spectrometer: ~190 + 0.4*cell nm, with a small curvature.
+		//	Every fifth polynomial runs the other way, every seventh folds over.
+		F64 c[4];
+		c[0] = 180.0 + 20.0*drand48();
+		c[1] = 0.35 + 0.1*drand48();
+		c[2] = -2e-5 + 4e-5*drand48();
+		c[3] = -1e-9 + 2e-9*drand48();
+		if ( 0 == p % 5 ) {
+			c[0] += 2048*c[1];
+			c[1] = -c[1];
+		}
+		if ( 0 == p % 7 ) {
+			c[2] = -c[1] / 2000.0;	//	Extreme near cell 1000
+			c[3] = 0;
+		}
+		S16 const pixbase = ( p % 3 ) ? 0 : 11;
+
+		if ( write_wlc ( side, c, pixbase )
+		  || WL_OK != wl_ParseFile ( wl_MakeFileName(side), side )
+		  || WL_OK != wl_Load ( side ) ) {
+			fprintf ( stderr, "poly %d: cannot write, parse or load\n", p );
+			return 1;
+		}
+
+		kinds[ wl_direction[side] + 1 ]++;
+
+		//	Windows around and beyond the wavelengths of the cells,
+		//	some ending exactly at a cell's wavelength
+		F64 const w0 = wl_wlenOfCell ( side, 0 );
+		F64 const w1 = wl_wlenOfCell ( side, N_SPEC_PIX-1 );
+		F64 const wmin = ( w0 < w1 ? w0 : w1 ) - 20;
+		F64 const span = ( w0 < w1 ? w1 - w0 : w0 - w1 ) + 40;
+		int w;
+		for ( w=0; w<windows; w++ ) {
+			lo[w] = wmin + span*drand48();
+			hi[w] = lo[w] + 0.5*span*drand48();
+			if ( 0 == w % 4 ) lo[w] = wl_wlenOfCell ( side, lrand48() % N_SPEC_PIX );
+			if ( 1 == w % 4 ) hi[w] = wl_wlenOfCell ( side, lrand48() % N_SPEC_PIX );
+		}
+
+		double t0 = now();
+		for ( w=0; w<windows; w++ ) {
+			linear_range ( side, lo[w], hi[w], &rpl[w], &rph[w] );
+		}
+		double t1 = now();
+		wl_PixelRanges ( side, windows, lo, hi, pl, ph );
+		double t2 = now();
+
+		t_linear += t1-t0;
+		t_binary += t2-t1;
+
+		for ( w=0; w<windows; w++ ) {
+			S16 a, b;
+			S16 const rv = wl_PixelRange ( side, lo[w], hi[w], &a, &b );
+			if ( pl[w] != rpl[w] || ph[w] != rph[w] || a != pl[w] || b != ph[w]
+			  || rv != ( rph[w] ? WL_OK : WL_FAIL ) ) {
+				if ( mismatches < 10 ) {
+					fprintf ( stderr, "poly %d window %.6f..%.6f: %hd..%hd, linear %hd..%hd\n",
+						p, lo[w], hi[w], pl[w], ph[w], rpl[w], rph[w] );
+				}
+				mismatches++;
+			}
+		}
+	}
+
+	printf ( "polynomials,increasing,decreasing,not_monotonic,windows,linear_us,binary_us,speedup,mismatches\n" );
+	printf ( "%d,%d,%d,%d,%ld,%.2f,%.2f,%.1f,%ld\n", polys, kinds[2], kinds[0], kinds[1],
+		(long)polys*windows, 1e6*t_linear/polys/windows, 1e6*t_binary/polys/windows,
+		t_linear/t_binary, mismatches );
+
+	free ( lo ); free ( hi ); free ( pl ); free ( ph ); free ( rpl ); free ( rph );
+	ramdisk_destroy();
+
+	return mismatches ? 1 : 0;
+}
@@ -34,6 +34,7 @@
 # include "tasks.controller.h"
 # include "aux_data_acquisition.h"
 # include "stream_log.h"
+# include "datalogfile.h"
 # include "profile_manager.h"
 # include "data_exchange.controller.h"
 
@@ -119,6 +120,9 @@ static Bool create_controller_tasks() {
 # if defined(OPERATION_AUTONOMOUS)
     // Start Stream-Output & Log-to-File Task
     tasksCreatedOK &= stream_log_createTask();
+
+    // Write-behind of the data log file
+    tasksCreatedOK &= datalogfile_createTask();
 # endif
 
 # if defined(OPERATION_NAVIS)
@@ -833,6 +833,26 @@ F64  NUM_PixelToWavelength ( int pixel ) {
 	}
 }
 
+//	First channel with a wavelength above (strict) or at or above wl.
+//	The CAL file wavelengths ascend, and are padded with 999.0.
+static U16 num_search_wavelength ( F64 wl, bool strict ) {
+
+	U16 lo = 0;
+	U16 hi = SPEC_PIXELS;
+
+	while ( lo < hi ) {
+		U16 const mid = lo + ( hi - lo ) / 2;
+		F64 const wl_mid = num_cal_file.wavelength[mid];
+		if ( wl_mid < wl || ( strict && wl_mid == wl ) ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
 S16 NUM_WavelengthRange_to_PixelRange (
 		F32	const wl_low,
 		F32 const wl_high,
@@ -843,29 +863,15 @@ S16 NUM_WavelengthRange_to_PixelRange (
 		return NUM_FAIL;
 	} else {
 
-		*px_low = 0xFFFF;
-		*px_high = 0;
-
-		U16 channel;
-
-		*px_low = SPEC_PIXELS-1;
 		//  Find the first channel with a wavelength at or above wl_low
-		for ( channel=0; channel<SPEC_PIXELS; channel++ ) {
-			if ( num_cal_file.wavelength[channel] >= wl_low ) {
-				*px_low = channel;
-				break;
-			}
-		}
+		U16 channel = num_search_wavelength ( wl_low, false );
+		*px_low = ( channel < SPEC_PIXELS ) ? channel : SPEC_PIXELS-1;
 
-		*px_high = 0;
-		for ( channel=SPEC_PIXELS-1; channel>0; channel-- ) {
-			if ( num_cal_file.wavelength[channel] <= wl_high ) {
-				*px_high = channel;
-				break;
-			}
-		}
+		//  Find the last channel with a wavelength at or below wl_high
+		channel = num_search_wavelength ( wl_high, true );
+		*px_high = ( channel > 1 ) ? channel-1 : 0;
 
-		if ( 0xFFFF == *px_low || 0 == *px_high ) {
+		if ( 0 == *px_high ) {
 			return NUM_FAIL;
 		} else {
 			return NUM_OK;
@@ -27,6 +27,9 @@
 # include "ocr_data.h"
 # include "mcoms_data.h"
 # include "profile_packet.shared.h"
+# include "profile_packet.controller.h"
+# include "bitplane.h"
+# include "burst_transfer.h"
 # include "sram_memory_map.controller.h"
 //# define sram_memcpy memcpy
 # define sram_memset memset     //  FIXME
@@ -42,12 +45,61 @@
 
 # include "zlib.h"
 
+# if defined(__GNUC__)
+#   include <malloc.h>
+#   include <unistd.h>
+# endif
+
 # define BRS_TEST 0
 
 //*****************************************************************************
 // Settings
 //*****************************************************************************
 
+//  Compress spectrometer packets with zlib, using the first row of
+//  pmg_deflate_params[] that fits into the free heap.
+//  Packets are sent uncompressed if no row fits, or with 0 here.
+# define PMG_ADAPTIVE_COMPRESSION 1
+
+//  Heap left to other tasks while a packet is compressed
+# define PMG_HEAP_RESERVE (8*1024)
+
+//  Spectrum data log files are synced after this many bytes
+# define PMG_SPEC_CHECKPOINT (64*1024)
+
+//  The steps of a profile transmission are in burst_transfer.c,
+//  with their timeouts, shared with the host harness.
+
+//  Sliding window: data bursts sent and not yet acknowledged,
+//  offered to the receiver once the call is set up.
+//  Receivers that do not answer the offer within BT_WINDOW_OFFER_MS,
+//  or 0 here, get one burst per transmission step, as before.
+# define PMG_TX_WINDOW        4
+
+//  Repair bursts per packet, offered with the window: sent once after
+//  the last data burst of a packet, repair burst j being the XOR of data
+//  bursts j, j+PMG_TX_REPAIR, j+2*PMG_TX_REPAIR, ..., such that the receiver
+//  rebuilds one lost burst of each without asking for it again.
+//  0, or receivers that do not grant them, for none. Each costs 1/8 or so
+//  of the packet on every transmission; worth it where many packets need a
+//  resend round trip (see ProfileManager/repair_bench.c).
+//  Offered with binary framing only, their data being binary.
+# define PMG_TX_REPAIR        0
+
+//  Binary framing of bursts (see profile_packet.shared.h), offered once
+//  logged in: packet data go out as they are, rather than ASCII85 encoded,
+//  1/5 fewer bytes on the wire. Receivers that do not grant it within
+//  PMG_MODE_REPLY_MS, paths found not 8 bit clean by the probe burst,
+//  or 0 here, get ASCII framing with packet data ASCII85 encoded.
+# define PMG_TX_BINARY        1
+# define PMG_MODE_REPLY_MS    5000
+
+//  Adaptive burst size (see BT_BURST_MIN and on), 0 for FIXED_BURST_SIZE
+//  throughout. A call starts from the target of the last packet confirmed,
+//  kept in PMG_BURST_FILE across calls and resets.
+# define PMG_BURST_ADAPT  1
+# define PMG_BURST_FILE   EMMC_DRIVE PMG_PROFILE_FOLDER "\\" PMG_PROFILE_FOLDER ".BSZ"
+
 //*****************************************************************************
 // Local Variables
 //*****************************************************************************
@@ -89,12 +141,6 @@ pmg_datatype_t;
 # define PMG_PROFILE_FOLDER "NAVIS"
 static char const* pmg_datafile_extension[PMG_N_DATAFILES] = { "SBD", "PRT", "OCR", "MCM" };
 
-uint16_t const NO_PACKET_IN_TRANSFER = 0xFFFF;
-typedef enum { PCK_Unsent, PCK_Sent, PCK_Confirmed } Packet_Status_t;
-# define BST_Unsent    0x01
-# define BST_Sent      0x02
-# define BST_Confirmed 0x04
-
 //! \brief  Generate profile management directory name.
 //!
 //! return  pointer to static char[]
@@ -157,6 +203,26 @@ static void timeval_add_usec ( struct timeval* tv, uint32_t usec ) {
 }
 # endif
 
+//  zlib deflate parameters, by decreasing heap use.
+//  Chosen with ProfileManager/zlib_sweep -t on simulated spectra:
+//  the smallest output for each heap budget.
+//  heap is the peak zlib allocation measured on the host,
+//  which is slightly above the AVR32 use (64-bit pointers).
+typedef struct pmg_deflate_param {
+  uint32_t heap;
+  int8_t   level;
+  int8_t   windowBits;
+  int8_t   memLevel;
+  int8_t   strategy;
+} pmg_deflate_param_t;
+
+static pmg_deflate_param_t const pmg_deflate_params[] = {
+  { 104240, 5, 13, 7, Z_FILTERED         },   //  ratio 0.564
+  {  38704, 4, 12, 5, Z_FILTERED         },   //  ratio 0.565
+  {  22320, 9, 11, 4, Z_FILTERED         },   //  ratio 0.566
+  {  14128, 8, 10, 3, Z_DEFAULT_STRATEGY },   //  ratio 0.569
+};
+
 static void serialize_2byte ( uint8_t* destination, uint16_t value ) {
   destination[0] = value>>8;
   destination[1] = value&0xFF;
@@ -169,6 +235,99 @@ static void serialize_4byte ( uint8_t* destination, uint32_t value ) {
   destination[3] =  value     &0xFF;
 }
 
+static voidpf pmg_zalloc ( voidpf opaque, uInt items, uInt size ) {
+  (void)opaque;
+  return pvPortMalloc ( items*size );
+}
+
+static void pmg_zfree ( voidpf opaque, voidpf address ) {
+  (void)opaque;
+  vPortFree ( address );
+}
+
+//  Free heap.
+//  With heap_3.c, pvPortMalloc() is newlib's malloc() and FreeRTOS
+//  has no xPortGetFreeHeapSize(). Count the free bytes inside the
+//  malloc arena, plus the heap section not yet claimed by malloc.
+//
+static size_t pmg_free_heap ( void ) {
+
+  extern void __heap_end__;
+
+  struct mallinfo const mi = mallinfo();
+  char* const brk = sbrk ( 0 );
+
+  size_t free_heap = mi.fordblks;
+  if ( brk < (char*)&__heap_end__ ) {
+    free_heap += (char*)&__heap_end__ - brk;
+  }
+  return free_heap;
+}
+
+//  Compress data_sz bytes of flat_bytes in place, using work as output.
+//  The parameters are chosen by the heap free right now.
+//
+//  Returns the compressed size,
+//  or 0 if the packet is to be sent uncompressed.
+//
+static uint16_t pmg_packet_deflate ( Profile_Data_Packet_t* raw, uint32_t data_sz, uint8_t* work ) {
+
+# if PMG_ADAPTIVE_COMPRESSION
+  size_t const free_heap = pmg_free_heap();
+
+  pmg_deflate_param_t const* param = 0;
+  uint16_t r;
+  for ( r=0; r<sizeof(pmg_deflate_params)/sizeof(pmg_deflate_params[0]); r++ ) {
+    if ( free_heap >= pmg_deflate_params[r].heap + PMG_HEAP_RESERVE ) {
+      param = pmg_deflate_params + r;
+      break;
+    }
+  }
+
+  if ( !param ) {
+    syslog_out ( SYSLOG_NOTICE, "pmg_packet_deflate", "Heap %lu, not compressing", (unsigned long)free_heap );
+    return 0;
+  }
+
+  z_stream strm;
+  memset ( &strm, 0, sizeof(strm) );
+  strm.zalloc = pmg_zalloc;
+  strm.zfree  = pmg_zfree;
+  strm.opaque = Z_NULL;
+
+  if ( Z_OK != deflateInit2 ( &strm, param->level, Z_DEFLATED, param->windowBits, param->memLevel, param->strategy ) ) {
+    syslog_out ( SYSLOG_WARNING, "pmg_packet_deflate", "deflateInit2() failed, heap %lu", (unsigned long)free_heap );
+    return 0;
+  }
+
+  strm.next_in   = raw->contents.flat_bytes;
+  strm.avail_in  = data_sz;
+  strm.next_out  = work;
+  strm.avail_out = data_sz;   //  Not worth sending if it does not shrink
+
+  int const rv = deflate ( &strm, Z_FINISH );
+  uint32_t const total = strm.total_out;
+
+  (void)deflateEnd ( &strm );
+
+  if ( Z_STREAM_END != rv || total >= data_sz ) {
+    return 0;
+  }
+
+  syslog_out ( SYSLOG_DEBUG, "pmg_packet_deflate", "Heap %lu, zlib %d/%d/%d/%d, %lu -> %lu",
+               (unsigned long)free_heap, param->level, param->windowBits, param->memLevel, param->strategy,
+               (unsigned long)data_sz, (unsigned long)total );
+
+  memcpy ( raw->contents.flat_bytes, work, total );
+  return (uint16_t)total;
+# else
+  (void)raw; (void)data_sz; (void)work;
+  return 0;
+# endif
+}
+
+static void write_spec_flush ( Bool close );
+
 //! \brief  Start profiling
 //!
 //! @param  
@@ -178,6 +337,10 @@ static void serialize_4byte ( uint8_t* destination, uint32_t value ) {
 static int16_t profile_start( uint16_t profileID )
 {
 
+  //  Spectra of a previous profile go to their own files
+  //
+  write_spec_flush ( TRUE );
+
   //  Check for valid profileID
   //
   if ( !profileID )
@@ -402,19 +565,29 @@ static int16_t profile_start( uint16_t profileID )
   return 0;
 }
 
+//  Spectra are appended through batched writers (port, starboard),
+//  kept open from the first spectrum until the profile is stopped or packaged.
+//  Data are staged in SRAM and written in whole SRAM_PMG_SPEC_SIZE blocks.
+//
+static fBatch_t pmg_spec_batch[2];
+static uint16_t pmg_spec_batch_profile[2];
+
 static int16_t write_spec_data ( uint16_t profileID, Spectrometer_Data_t* spec_data ) {
 
   if ( !spec_data ) return -1;
 
   char const* extension;
+  sram_pointer staging;
   if ( 0 == spec_data->aux.side)
   {
     extension = pmg_datafile_extension[PMG_DT_Port_Radiometer];
+    staging   = sram_PMG_SPEC_P;
   }
   
   else if ( 1 == spec_data->aux.side  )
   {
     extension = pmg_datafile_extension[PMG_DT_Starboard_Radiometer];
+    staging   = sram_PMG_SPEC_S;
   }
 
   else
@@ -422,46 +595,71 @@ static int16_t write_spec_data ( uint16_t profileID, Spectrometer_Data_t* spec_d
     return -2;
   }
 
-  char pID_str[8];
-  S32_to_str_dec ( (S32)profileID, pID_str, sizeof(pID_str), 5 );
+  fBatch_t* const batch = pmg_spec_batch + spec_data->aux.side;
 
-  char data_file_name[34];
-  strcpy ( data_file_name, EMMC_DRIVE PMG_PROFILE_FOLDER "\\" );
-  strcat ( data_file_name, pID_str );
-  strcat ( data_file_name, "\\" );
-  strcat ( data_file_name, pID_str );
-  strcat ( data_file_name, "." );
-  strcat ( data_file_name, extension );
+  if ( !batch->isOpen || pmg_spec_batch_profile[spec_data->aux.side] != profileID ) {
+
+    if ( batch->isOpen ) {
+      f_batchClose ( batch );
+    }
 
-  if ( !f_exists ( data_file_name ) ) {
+    char pID_str[8];
+    S32_to_str_dec ( (S32)profileID, pID_str, sizeof(pID_str), 5 );
+
+    char data_file_name[34];
+    strcpy ( data_file_name, EMMC_DRIVE PMG_PROFILE_FOLDER "\\" );
+    strcat ( data_file_name, pID_str );
+    strcat ( data_file_name, "\\" );
+    strcat ( data_file_name, pID_str );
+    strcat ( data_file_name, "." );
+    strcat ( data_file_name, extension );
+
+    if ( !f_exists ( data_file_name ) ) {
 
       //  Unexpected: This data log file should exist.
       //
       return -3;
+    }
+
+    //  Append to data log file.
+    //
+    if ( FILE_OK != f_batchOpen ( batch, data_file_name, O_WRONLY, staging, SRAM_PMG_SPEC_SIZE ) )
+    {
+      return -10;
+    }
 
+    pmg_spec_batch_profile[spec_data->aux.side] = profileID;
   }
-  
-  else
+
+  if ( (S32)sizeof(Spectrometer_Data_t) != f_batchWrite ( batch, spec_data, sizeof(Spectrometer_Data_t) ) )
   {
-      //  Append to data log file.
-      //
-      fHandler_t fh;
+    return -12;
+  }
 
-      if ( FILE_OK != f_open ( data_file_name, O_WRONLY | O_APPEND, &fh ) )
-      {
-        return -10;
-      }
+  //  Checkpoint: Limit the data lost to a power failure.
+  //
+  if ( batch->unsynced >= PMG_SPEC_CHECKPOINT ) {
+    if ( FILE_OK != f_batchSync ( batch ) ) {
+      syslog_out ( SYSLOG_WARNING, "write_spec_data", "Checkpoint failed, side %hu", spec_data->aux.side );
+    }
+  }
 
-      int16_t written = -12;
+  return 1;
+}
 
-      if ( sizeof(Spectrometer_Data_t) == f_write( &fh, spec_data, sizeof(Spectrometer_Data_t) ) )
-      {
-        written = 1;
+//  Write out staged spectra; with close, end batching until the next spectrum.
+//
+static void write_spec_flush ( Bool close ) {
+
+  int side;
+  for ( side=0; side<2; side++ ) {
+    if ( pmg_spec_batch[side].isOpen ) {
+      S16 const rv = close ? f_batchClose ( pmg_spec_batch + side )
+                           : f_batchSync  ( pmg_spec_batch + side );
+      if ( FILE_OK != rv ) {
+        syslog_out ( SYSLOG_ERROR, "write_spec_flush", "Failed writing side %d", side );
       }
-
-      f_close ( &fh );
-
-      return written;
+    }
   }
 }
 
@@ -617,6 +815,10 @@ static int16_t write_mcoms_data ( uint16_t profileID, MCOMS_Frame_t* mcoms_frame
 
 static int16_t profile_stop( uint16_t profileID, uint16_t frames[] ) {
 
+  //  All spectra must be in their files before the status says "IsDone"
+  //
+  write_spec_flush ( TRUE );
+
   //  Generic variable, able to hold any file or folder name.
   //
   char fname[64];
@@ -758,6 +960,64 @@ static int info_packet_burst_header24 ( Profile_Info_Packet_t* pip,
 
 
 
+//  Framing agreed with the receiver for this call, see pmg_mode_negotiate()
+//
+static Bool pmg_tx_binary = FALSE;
+
+//  Send one burst in the framing of this call:
+//    ASCII:   24 character header, CRC as 8 hex digits, data
+//    binary:  14 byte header, data, CRC as 4 bytes
+//  The CRC is over the header and the data.
+//  The binary header is made from ids (HYNV_num, PROF_num, PCKT_num),
+//  bNum (-1: terminating burst) and value, else header24 is sent.
+//
+static int pmg_burst_send ( unsigned char const* header24,
+                            uint8_t const*       ids,
+                            int                  bNum,
+                            int                  value,
+                            unsigned char const* burst_data,
+                            int                  sz
+                          )
+{
+  unsigned char header14[BRSB_HEADER];
+  unsigned char const* header = header24;
+  uint16_t header_len = 24;
+  unsigned char trailer[9];
+  uLong crc;
+
+  if  (pmg_tx_binary)
+  {
+    uint16_t hynv, prof, pckt;
+    memcpy ( &hynv, ids,   2 );
+    memcpy ( &prof, ids+2, 2 );
+    memcpy ( &pckt, ids+4, 2 );
+    data_packet_burst_header14 ( hynv, prof, pckt, ( -1 == bNum ) ? BRSB_END : (uint16_t)bNum, (uint16_t)value, header14 );
+    header     = header14;
+    header_len = BRSB_HEADER;
+  }
+
+  crc = crc32 ( 0L, Z_NULL, 0 );
+  crc = crc32 ( crc, header, header_len );
+  if  (sz)  crc = crc32 ( crc, burst_data, sz );
+
+  if  ( header_len != mdm_send ( header, header_len, MDM_USE_CTS, 5 ) ) return 1;
+
+  if  (pmg_tx_binary)
+  {
+    serialize_4byte ( trailer, crc );
+    if  ( sz  &&  sz != mdm_send ( burst_data, sz, MDM_USE_CTS, 5+sz/180 ) ) return 1;
+    if  ( BRSB_TRAILER != mdm_send ( trailer, BRSB_TRAILER, MDM_USE_CTS, 5 ) ) return 1;
+  }
+  else
+  {
+    snprintf ( (char*)trailer, 9, "%08lX", crc );
+    if  (  8 != mdm_send ( trailer, 8, MDM_USE_CTS, 5 ) ) return 1;
+    if  ( sz  &&  sz != mdm_send ( burst_data, sz, MDM_USE_CTS, 5+sz/180 ) ) return 1;
+  }
+
+  return 0;
+}
+
 static int info_packet_bursts_transmit (Profile_Info_Packet_t* pip, 
                                         int                    burst_size,
                                         int*                   numBurstsInPIP,
@@ -767,14 +1027,17 @@ static int info_packet_bursts_transmit (Profile_Info_Packet_t* pip,
   if  ( !pip )
     return 1;
 
+  //  All characters, the same in either framing
   unsigned char*  data = ((unsigned char*)pip) + 6;
   uint16_t const nData = 4 * 4  +  4 * 4 + BEGPAK_META;
 
-  int const numBursts = 1 + ( nData - 1 ) / burst_size;
+  //  Once split, keep the packet's bursts: *numBurstsInPIP is set,
+  //  and the bursts are the same, also in a later call.
+  //  Not yet split: into equal bursts of at most burst_size.
+  int const numBursts = ( 0 < *numBurstsInPIP ) ? *numBurstsInPIP : bt_burst_count ( nData, burst_size );
+  int const bSize     = 1 + ( nData - 1 ) / numBursts;
 
   unsigned char header[24];
-  char CRC32[9];
-  uLong crc;
 
   if  (burstToTx == 0)
   {
@@ -783,47 +1046,24 @@ static int info_packet_bursts_transmit (Profile_Info_Packet_t* pip,
     //  Burst ZERO is special: header only
     //
     info_packet_burst_header24 ( pip, 0, numBursts, header, 24 );
-
-    //  Calculate header's CRC
-    crc = crc32 ( 0L, Z_NULL, 0 );
-    crc = crc32 ( crc, header, 24 );
-    snprintf ( CRC32, 9, "%08X", crc );
-
-    if  ( 24 != mdm_send ( header, 24, MDM_USE_CTS, 5 ) ) return 1;
-    if  (  8 != mdm_send ( CRC32,   8, MDM_USE_CTS, 5 ) ) return 1;
+    return pmg_burst_send ( header, pip->HYNV_num, 0, numBursts, 0, 0 );
   }
 
   else if ( 1 <= burstToTx  &&  burstToTx <= numBursts )
   {
-    unsigned char* burst_data = data + (burstToTx-1) * burst_size;
-    int sz = (burstToTx < numBursts) ? burst_size : ( nData - (numBursts-1)*burst_size );
+    unsigned char* burst_data = data + (burstToTx-1) * bSize;
+    int sz = (burstToTx < numBursts) ? bSize : ( nData - (numBursts-1)*bSize );
 
     info_packet_burst_header24 ( pip, burstToTx, sz, header, 24 );
-
-    crc = crc32 ( 0L, Z_NULL, 0 );
-    crc = crc32 ( crc, header, 24 );
-    crc = crc32 ( crc, burst_data, sz );
-    snprintf ( CRC32, 9, "%08X", crc );
-
-    if( 24 != mdm_send ( header, 24, MDM_USE_CTS, 5 ) ) return 1;
-    if(  8 != mdm_send ( CRC32,   8, MDM_USE_CTS, 5 ) ) return 1;
-    if( sz != mdm_send ( burst_data, sz, MDM_USE_CTS, 5+sz/180 ) ) return 1;
+    return pmg_burst_send ( header, pip->HYNV_num, burstToTx, sz, burst_data, sz );
   }
 
   else
   {
     //  Burst TERMINATOR is special: header only
     info_packet_burst_header24 ( pip, -1, 0, header, 24 );
-
-    crc = crc32 ( 0L, Z_NULL, 0 );
-    crc = crc32 ( crc, header, 24 );
-    snprintf ( CRC32, 9, "%08X", crc );
-
-    if  ( 24 != mdm_send ( header, 24, MDM_USE_CTS, 5 ) ) return 1;
-    if  (  8 != mdm_send ( CRC32,   8, MDM_USE_CTS, 5 ) ) return 1;
+    return pmg_burst_send ( header, pip->HYNV_num, -1, 0, 0, 0 );
   }
-
-  return 0;
 }
 
 
@@ -879,11 +1119,21 @@ static int data_packet_burst_header24 (Profile_Data_Packet_t* packet,
 
 static int data_packet_size( Profile_Data_Packet_t* packet ) {
 
-  //  Currently, neither compression nore ASCII encoding is implemented.
+  //  Currently, ASCII encoding is not implemented.
   //
-  if ( packet->header.compression    != '0' ) return 0;
   if ( packet->header.ASCII_encoding != 'N' ) return 0;
 
+  if ( packet->header.compression == 'G' ) {
+    char numString[8];
+    memcpy ( numString, packet->header.compressed_sz, 6 );
+    numString[6] = 0;
+    int compressed_sz = 0;
+    sscanf ( numString, "%d", &compressed_sz );
+    return compressed_sz > 0 ? compressed_sz : 0;
+  }
+
+  if ( packet->header.compression    != '0' ) return 0;
+
   //  Find out the data type,
   //  and calculate the size of a single data item.
   //
@@ -921,21 +1171,73 @@ static int data_packet_size( Profile_Data_Packet_t* packet ) {
   return number_of_data * size_of_single_datum;
 }
 
+//  Bytes of a data packet on the wire, its 32 byte header included:
+//  its data ASCII85 encoded, unless framed in binary.
+//
+static int data_packet_sent_size( Profile_Data_Packet_t* packet ) {
+
+  int const raw = data_packet_size ( packet );
+  if ( raw <= 0 ) return 0;
+
+  return 32 + ( pmg_tx_binary ? raw : data_packet_ascii85_size ( raw ) );
+}
+
+//  The largest data packet splits into bursts of BT_BURST_MIN
+typedef char packet_fits_burst_status[ ( 32 + 5*( ( sizeof(Profile_Data_Packet_t)+3 ) / 4 ) <= BT_PACKET_MAX ) ? 1 : -1 ];
+
+//  Bytes from .. from+sz-1 of a data packet framed in ASCII: its header,
+//  marked ASCII85 encoded, then its data, encoded on the fly.
+//  Returns a buffer to vPortFree(), 0 if out of memory.
+//
+static unsigned char* data_packet_ascii85_bytes( Profile_Data_Packet_t* packet, uint16_t from, uint16_t sz ) {
+
+  unsigned char* bytes = pvPortMalloc ( sz );
+  if ( !bytes ) return 0;
+
+  unsigned char* const header = (unsigned char*)&packet->header;
+  uint16_t const raw = data_packet_size ( packet );
+
+  unsigned char head[32];
+  char numString[8];
+  memcpy ( head, header, 32 );
+  head[ (unsigned char*)&packet->header.ASCII_encoding - header ] = 'A';
+  snprintf ( numString, 7, "%6hu", data_packet_ascii85_size ( raw ) );
+  memcpy ( head + ( (unsigned char*)packet->header.encoded_sz - header ), numString, 6 );
+
+  uint16_t n = 0;
+  if ( from < 32 ) {
+    n = ( 32-from < sz ) ? 32-from : sz;
+    memcpy ( bytes, head+from, n );
+  }
+  if ( n < sz ) {
+    data_packet_ascii85_range ( header+32, raw, from+n-32, sz-n, bytes+n );
+  }
+
+  return bytes;
+}
+
 static int data_packet_bursts_transmit ( Profile_Data_Packet_t* packet, int burst_size, int* numBurstsInPDP, int burstToTx ) {
 
   if ( !packet ) return 1;
 
   unsigned char*  data = ((unsigned char*)packet) + 6;
-  uint16_t const nData = 32 + data_packet_size ( packet );  //  32: Packet header information
+  uint16_t const nData = data_packet_sent_size ( packet );  //  32: Packet header information
   if ( nData <=32 ) {
     return 1;
   }
 
-  int const numBursts = 1 + ( nData - 1 ) / burst_size;
+  //  Once split, keep the packet's bursts: *numBurstsInPDP is set,
+  //  and the bursts are the same, also in a later call.
+  //  Not yet split: into equal bursts of at most burst_size.
+  //  Split in binary during an earlier call, ASCII85 may make its bursts
+  //  too large: split again, with burst 0 (the receiver then starts over).
+  int numBursts = ( 0 < *numBurstsInPDP ) ? *numBurstsInPDP : bt_burst_count ( nData, burst_size );
+  if ( 0 == burstToTx  &&  1 + ( nData - 1 ) / numBursts > BRSB_MAX_DATA ) {
+    numBursts = bt_burst_count ( nData, BRSB_MAX_DATA );
+  }
+  int const bSize = 1 + ( nData - 1 ) / numBursts;
 
   unsigned char header[24];
-  char CRC32[9];
-  uLong crc;
 
   if  (burstToTx == 0 )
   {
@@ -945,31 +1247,27 @@ static int data_packet_bursts_transmit ( Profile_Data_Packet_t* packet, int burs
     //  Burst ZERO is special: header only
     //
     data_packet_burst_header24 ( packet, 0, numBursts, header, 24 );
-
-    //  Calculate header's CRC
-    crc = crc32 ( 0L, Z_NULL, 0 );
-    crc = crc32 ( crc, header, 24 );
-    snprintf ( CRC32, 9, "%08X", crc );
-
-    if( 24 != mdm_send ( header, 24, MDM_USE_CTS, 5 ) ) return 1;
-    if(  8 != mdm_send ( CRC32,   8, MDM_USE_CTS, 5 ) ) return 1;
+    return pmg_burst_send ( header, packet->HYNV_num, 0, numBursts, 0, 0 );
   }
 
   else if  ( 1 <= burstToTx  &&  burstToTx <= numBursts )
   {
-    unsigned char* burst_data = data + (burstToTx-1) * burst_size;
-    int sz = (burstToTx < numBursts) ? burst_size : ( nData - (numBursts - 1) * burst_size );
+    uint16_t const from = (burstToTx-1) * bSize;
+    int sz = (burstToTx < numBursts) ? bSize : ( nData - (numBursts - 1) * bSize );
 
     data_packet_burst_header24 ( packet, burstToTx, sz, header, 24 );
 
-    crc = crc32 ( 0L, Z_NULL, 0 );
-    crc = crc32 ( crc, header, 24 );
-    crc = crc32 ( crc, burst_data, sz );
-    snprintf ( CRC32, 9, "%08X", crc );
+    if  (pmg_tx_binary)
+    {
+      return pmg_burst_send ( header, packet->HYNV_num, burstToTx, sz, data + from, sz );
+    }
+
+    unsigned char* burst_data = data_packet_ascii85_bytes ( packet, from, sz );
+    if  ( !burst_data ) return 1;
 
-    if  ( 24 != mdm_send ( header, 24, MDM_USE_CTS, 5 ) ) return 1;
-    if  (  8 != mdm_send ( CRC32,   8, MDM_USE_CTS, 5 ) ) return 1;
-    if  ( sz != mdm_send ( burst_data, sz, MDM_USE_CTS, 5+sz/180 ) ) return 1;
+    int const rv = pmg_burst_send ( header, packet->HYNV_num, burstToTx, sz, burst_data, sz );
+    vPortFree ( burst_data );
+    return rv;
   }
   else
   {
@@ -978,16 +1276,48 @@ static int data_packet_bursts_transmit ( Profile_Data_Packet_t* packet, int burs
     //  Always send this, to facilitate receiver data assembly
     //
     data_packet_burst_header24 ( packet, -1, 0, header, 24 );
+    return pmg_burst_send ( header, packet->HYNV_num, -1, 0, 0, 0 );
+  }
+}
+
+//  Repair bursts 1..nRepair of a packet split into numBursts data bursts,
+//  framed like data bursts numbered 900 + 10*nRepair + j. Their data:
+//  "nnnnssss" (the number of data bursts and the size of the last one),
+//  then the XOR of the data bursts of repair group j (data_packet_repair()).
+//  Binary framing only.
+//
+static int data_packet_repair_transmit ( Profile_Data_Packet_t* packet, int numBursts, int nRepair ) {
 
-    crc = crc32 ( 0L, Z_NULL, 0 );
-    crc = crc32 ( crc, header, 24 );
-    snprintf ( CRC32, 9, "%08X", crc );
+  if ( !packet || !pmg_tx_binary || numBursts < 1 || nRepair < 1 || nRepair > 9 ) return 1;
 
-    if( 24 != mdm_send ( header, 24, MDM_USE_CTS, 5 ) ) return 1;
-    if(  8 != mdm_send ( CRC32,   8, MDM_USE_CTS, 5 ) ) return 1;
+  unsigned char*  data = ((unsigned char*)packet) + 6;
+  uint16_t const nData = data_packet_sent_size ( packet );
+  if ( nData <=32 ) {
+    return 1;
   }
 
-  return 0;
+  uint16_t const bSize  = 1 + ( nData - 1 ) / numBursts;
+  unsigned char* repair = pvPortMalloc ( 8 + bSize );
+  if ( !repair ) return 1;
+
+  char sizes[9];
+  snprintf ( sizes, 9, "%04d%04d", numBursts, nData - (numBursts-1) * bSize );
+
+  unsigned char header[24];
+  int rv = 0;
+  int j;
+
+  for ( j=1; j<=nRepair && j<=numBursts && !rv; j++ )
+  {
+    int const sz = 8 + data_packet_repair ( data, nData, numBursts, nRepair, j, repair+8 );
+    memcpy ( repair, sizes, 8 );
+
+    data_packet_burst_header24 ( packet, 900 + 10*nRepair + j, sz, header, 24 );
+    rv = pmg_burst_send ( header, packet->HYNV_num, 900 + 10*nRepair + j, sz, repair, sz );
+  }
+
+  vPortFree ( repair );
+  return rv;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1021,6 +1351,10 @@ static int16_t profile_package (uint16_t*                      tx_profile_id,
 
   if ( 0 == *tx_profile_id ) return -1;
 
+  //  Spectra still staged must be in the files to be packaged
+  //
+  write_spec_flush ( TRUE );
+
   S32_to_str_dec ( (S32)(*tx_profile_id), numString, sizeof(numString), 5 );
 
   char ppd_file_name[34];
@@ -1289,46 +1623,13 @@ tlm_send ( "PIP\r\n", 5, 0 );
 
         //
         //  Now generate bit-planes.
-        //  This code is klunky, re-using tested code that workes for 'after all data are available'.
-        //  Used klunky code to make sure nothing is broken.
+        //  Spectrum d goes to byte offset d*N_SPEC_PIX/8 of each plane,
+        //  the planes of all spectra in the packet are contiguous.
         //
-        int plane_item = 0;
-        int bit_mask;
-        for ( bit_mask = 0x8000>>tx_instruct->noise_bits_remove; bit_mask >= 0x0001; bit_mask >>= 1 )
-        {
-          uint8_t plane_byte = 0;
-          uint8_t plane_mask = 0x80;
-
-          int dd;
-          for (dd = 0;  dd < number_of_data;  ++dd)
-          {  
-            //  Here is the KLUNKY part: Will only use the d==dd part of the loop, the d!=dd part is used to ensure the proper plane_item is generated.
-            for ( p=0; p<N_SPEC_PIX; p++ )
-            {
-              if ( d==dd )
-              {
-                if ( static_spec_data->hnv_spectrum[p] & bit_mask )
-                {
-                  plane_byte |= plane_mask;
-                }
-              }
-              if ( 0x01 != plane_mask )
-              {
-                plane_mask >>= 1;
-              }
-              else
-              {
-                if ( d==dd )
-                {
-                  raw->contents.structured.sensor_data.bitplanes[plane_item] = plane_byte;
-                }
-                plane_item++;
-                plane_byte = 0;
-                plane_mask = 0x80;
-              }
-            }
-          }
-        }
+        bitplane_transpose ( static_spec_data->hnv_spectrum, N_SPEC_PIX,
+                             raw->contents.structured.sensor_data.bitplanes + d*(N_SPEC_PIX/8),
+                             number_of_data*(N_SPEC_PIX/8),
+                             15-tx_instruct->noise_bits_remove, 16-tx_instruct->noise_bits_remove );
 
         //
         //  Serialize auxiliary data.
@@ -1360,71 +1661,26 @@ tlm_send ( "PIP\r\n", 5, 0 );
 /*DBG*/ //serialize_2byte ( raw->contents.structured.aux_data.spec_serial+nn, static_spec_data->aux.spec_max  );                 nn+=2;
       }
 
-      //  ALERT: zlib is not working without tweaks to memory allocation / memory layout
-      //         For now, cannot use data compression.
-      if ( 0 ) {
-        //
-        //  Compress data
-        //
-        raw->header.compression = 'G';
-        uint16_t total = 0;
-
-        z_stream strm;
-        strm.zalloc  = pvPortMalloc;   //  FIXME
-        strm.zfree   = vPortFree;   //  FIXME
-        strm.opaque  = Z_NULL;   //  FIXME
-        int level    = Z_DEFAULT_COMPRESSION; // 0..9
-        int method   = Z_DEFLATED;
-        int windowBits =  9;   // 9..15  Memory used = 1<<(windowBits+2)  **** when using 8, as permitted according to DOC, get failure at inflate()  ****
-        int memLevel   =  2;   // 1..9   Memory used = 1<<(memLevel+9)
-        int strategy   = Z_DEFAULT_STRATEGY;  // Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE (run-lengh encoding)
-
-        windowBits = 9;
-        memLevel   = 2;
-        strategy   = Z_FILTERED;
-
-        if ( Z_OK != deflateInit2 ( &strm, level, method, windowBits, memLevel, strategy ) ) {
-        }
-
-        strm.avail_in = number_of_data*2*N_SPEC_PIX;  // FIXME -- LSB (noise) bits removed
-        strm.next_in  = raw->contents.structured.sensor_data.bitplanes;
-
-        strm.avail_out = FLAT_SZ;
-        strm.next_out  = sram_PMG_2;
-
-        int rv;
-        if ( Z_STREAM_ERROR ==  (rv = deflate ( &strm, Z_NO_FLUSH ) ) ) {
-        }
-
-        int done_1 = FLAT_SZ-strm.avail_out;
+      memcpy ( raw->contents.flat_bytes, raw->contents.structured.sensor_data.bitplanes,
+                                          256*(16-tx_instruct->noise_bits_remove)*number_of_data );
+      memcpy ( raw->contents.flat_bytes + 256*(16-tx_instruct->noise_bits_remove)*number_of_data,
+                      raw->contents.structured.aux_data.spec_serial, SPEC_AUX_SERIAL_SIZE*number_of_data );
 
-        if ( strm.avail_in ) {
-        }
-
-        strm.avail_in = number_of_data*SPEC_AUX_SERIAL_SIZE;
-        strm.next_in  = (Bytef*)raw->contents.structured.aux_data.spec_serial;
-
-        strm.avail_out = FLAT_SZ - done_1;
-        strm.next_out  = sram_PMG_2 + done_1;
-
-        if ( Z_STREAM_END != (rv = deflate ( &strm, Z_FINISH ) ) ) {
-        }
-
-        int done_2 = (FLAT_SZ-done_1) - strm.avail_out;
-
-        (void)deflateEnd ( &strm );
-
-        total = done_1 + done_2;
-        memcpy ( raw->contents.flat_bytes, sram_PMG_2, total );
+      //
+      //  Compress data, as far as the free heap permits
+      //
+      uint16_t compressed = 0;
+      if ( tx_instruct->compression == ZLIB ) {
+        compressed = pmg_packet_deflate ( raw,
+                         ( 256*(16-tx_instruct->noise_bits_remove) + SPEC_AUX_SERIAL_SIZE ) * number_of_data,
+                         sram_PMG_2 );
+      }
 
-        snprintf ( numString, 7, "%6hu", total );
+      if ( compressed ) {
+        raw->header.compression = 'G';
+        snprintf ( numString, 7, "%6hu", compressed );
         memcpy ( raw->header.compressed_sz, numString, 6 );
       } else {
-        memcpy ( raw->contents.flat_bytes, raw->contents.structured.sensor_data.bitplanes,
-                                            256*(16-tx_instruct->noise_bits_remove)*number_of_data );
-        memcpy ( raw->contents.flat_bytes + 256*(16-tx_instruct->noise_bits_remove)*number_of_data,
-                        raw->contents.structured.aux_data.spec_serial, SPEC_AUX_SERIAL_SIZE*number_of_data );
-
         raw->header.compression = '0';
         memcpy ( raw->header.compressed_sz, "      ", 6 );
       }
@@ -1595,18 +1851,26 @@ tlm_send ( "PTP\r\n", 5, 0 );
 /*DBG*/ //serialize_2byte ( raw->contents.structured.aux_data.spec_serial+nn, static_spec_data->aux.spec_max  );                 nn+=2;
       }
 
-      //  ALERT: zlib is not working without tweaks to memory allocation / memory layout
-      //         For now, cannot use data compression.
-      if ( 0 ) {
-        //
-        //  Compress data
-        //
-      } else {
-        memcpy ( raw->contents.flat_bytes, raw->contents.structured.sensor_data.bitplanes,
-                                            256*(16-tx_instruct->noise_bits_remove)*number_of_data );
-        memcpy ( raw->contents.flat_bytes + 256*(16-tx_instruct->noise_bits_remove)*number_of_data,
-                        raw->contents.structured.aux_data.spec_serial, SPEC_AUX_SERIAL_SIZE*number_of_data );
+      memcpy ( raw->contents.flat_bytes, raw->contents.structured.sensor_data.bitplanes,
+                                          256*(16-tx_instruct->noise_bits_remove)*number_of_data );
+      memcpy ( raw->contents.flat_bytes + 256*(16-tx_instruct->noise_bits_remove)*number_of_data,
+                      raw->contents.structured.aux_data.spec_serial, SPEC_AUX_SERIAL_SIZE*number_of_data );
 
+      //
+      //  Compress data, as far as the free heap permits
+      //
+      uint16_t compressed = 0;
+      if ( tx_instruct->compression == ZLIB ) {
+        compressed = pmg_packet_deflate ( raw,
+                         ( 256*(16-tx_instruct->noise_bits_remove) + SPEC_AUX_SERIAL_SIZE ) * number_of_data,
+                         sram_PMG_2 );
+      }
+
+      if ( compressed ) {
+        raw->header.compression = 'G';
+        snprintf ( numString, 7, "%6hu", compressed );
+        memcpy ( raw->header.compressed_sz, numString, 6 );
+      } else {
         raw->header.compression = '0';
         memcpy ( raw->header.compressed_sz, "      ", 6 );
       }
@@ -2064,250 +2328,371 @@ static void close_rudics_server (int con_state)
 
 
 
-# define PMG_PRF_TX_ALL_DONE 0
-# define PMG_PRF_TX_CONTINUE 1
-# define PMG_PRF_TX_MDM_FAIL 2
-static int pmg_profile_transmission (uint16_t         profileID,
-                                     uint16_t         numPackets, 
-                                     Packet_Status_t* packet_status,
-                                     uint16_t*        packet_bursts,
-                                     uint32_t*        burst_status 
-                                    )
+//  Profile transmission, see burst_transfer.c.
+//  The functions below are its outside: modem, clock, packet files, .STS records.
+//
+static bt_t pmg_bt;
+
+static int pmg_connection_state = 0;
+
+//  Packet in transfer, see pmg_io_retrieve()
+static Profile_Info_Packet_t pmg_tx_pip;
+
+//  Acknowledged bursts of a profile transmission.
+//
+//  Kept in the .STS file, following its 5 status lines, one line per packet
+//  (see bt_sts_line()). A transmission cut off by a lost call or a reset
+//  resumes from these, sending only the bursts not confirmed.
+//
+# define PMG_STS_HEADER   (5*8)
+
+static void pmg_sts_file_name ( uint16_t profileID, char* fname )
+{
+  char pID_str[8];
+  S32_to_str_dec ( (S32)profileID, pID_str, sizeof(pID_str), 5 );
+
+  strcpy ( fname, EMMC_DRIVE PMG_PROFILE_FOLDER "\\" );
+  strcat ( fname, pID_str );
+  strcat ( fname, "\\" );
+  strcat ( fname, pID_str );
+  strcat ( fname, ".STS" );
+}
+
+//  Update the record of packet p
+//
+static int16_t pmg_sts_acks_write ( uint16_t profileID, uint16_t p )
+{
+  char fname[34];
+  char line[BT_STS_LINE+1];
+  fHandler_t fh;
+
+  pmg_sts_file_name ( profileID, fname );
+  bt_sts_line ( &pmg_bt, p, line );
+
+  if ( FILE_OK != f_open ( fname, O_RDWR, &fh ) )
+  {
+    return -1;
+  }
+
+  if ( FILE_OK != f_seek ( &fh, PMG_STS_HEADER + p*BT_STS_LINE, FS_SEEK_SET )
+    || BT_STS_LINE != f_write ( &fh, line, BT_STS_LINE ) )
+  {
+    f_close ( &fh );
+    return -2;
+  }
+
+  f_close ( &fh );
+  return 0;
+}
+
+//  Restore the state of an earlier transmission of this profile,
+//  and add the records that are missing.
+//
+static int16_t pmg_sts_acks_read ( uint16_t profileID, uint16_t numPackets )
 {
-  char mmm[32];
+  char fname[34];
+  char line[BT_STS_LINE+1];
+  fHandler_t fh;
 
-  static int connected = 0;
-  static int connection_state = 0;
+  pmg_sts_file_name ( profileID, fname );
 
-  static uint16_t packet_in_transfer = NO_PACKET_IN_TRANSFER;
-  static Profile_Info_Packet_t  transferring_pip;
-  /*static*/ Profile_Data_Packet_t* transferring_pdp = sram_PMG_2;
+  if ( FILE_OK != f_open ( fname, O_RDWR, &fh ) )
+  {
+    return -1;
+  }
 
-  if  (packet_in_transfer == NO_PACKET_IN_TRANSFER  ||  packet_status[packet_in_transfer] != PCK_Unsent)
+  if ( f_getSize ( &fh ) < PMG_STS_HEADER
+    || FILE_OK != f_seek ( &fh, PMG_STS_HEADER, FS_SEEK_SET ) )
   {
-    //  FIXME -- In final version, check for == confirmed
+    f_close ( &fh );
+    return -2;
+  }
 
-    packet_in_transfer = NO_PACKET_IN_TRANSFER;
+  uint16_t p;
+  for ( p=0; p<numPackets; p++ )
+  {
+    if ( BT_STS_LINE != f_read ( &fh, line, BT_STS_LINE ) ) break;
+    line[BT_STS_LINE] = 0;
+    if ( bt_sts_parse ( &pmg_bt, p, line ) ) break;
+  }
+
+  //  First transmission of this profile: create the records
+  //
+  int16_t rv = 0;
 
-    //  No packet currently transferring. Find next packet to transfer.
-    int  p;
-    for  (p = 1;  p < numPackets;  p++)
+  if ( p < numPackets
+    && FILE_OK != f_seek ( &fh, PMG_STS_HEADER + p*BT_STS_LINE, FS_SEEK_SET ) )
+  {
+    rv = -3;
+  }
+
+  for ( ; p<numPackets && !rv; p++ )
+  {
+    bt_sts_line ( &pmg_bt, p, line );
+    if ( BT_STS_LINE != f_write ( &fh, line, BT_STS_LINE ) )
     {
+      rv = -4;
+    }
+  }
 
-      if  (PCK_Unsent == packet_status[p])
-      {
-        packet_in_transfer = p;
+  f_close ( &fh );
+  return rv;
+}
 
-        char packet_file_name[34];
-        strncpy ( packet_file_name, EMMC_DRIVE PMG_PROFILE_FOLDER "\\", 34 );
-        S32_to_str_dec ( (S32)(profileID), mmm, sizeof(mmm), 5 );
-        strncat ( packet_file_name, mmm, 5 );
-        strcat  ( packet_file_name, "\\" );
-        strncat ( packet_file_name, mmm, 5 );
-        strcat  ( packet_file_name, ".P" );
-        S32_to_str_dec ( (S32)packet_in_transfer, mmm, sizeof(mmm), 2 );
-        strncat ( packet_file_name, mmm, 2 );
+//  Adaptive burst size across calls and resets
+//
+static Bool     pmg_burst_loaded = FALSE;
+static uint16_t pmg_burst_saved  = 0;
 
-        if ( 0 == packet_in_transfer )
-        {
-          info_packet_retrieve_native (&transferring_pip, packet_file_name );
-        }
-        else
-        {
-          data_packet_retrieve_native( 12, packet_file_name );
-        }
+//  First call: start from the size kept in PMG_BURST_FILE
+//
+static void pmg_burst_load ( void )
+{
+  if ( pmg_burst_loaded ) return;
 
-        break;
-      }
-    }
+  char line[8];
+  fHandler_t fh;
+  unsigned int saved = 0;
 
-    if  (packet_in_transfer == NO_PACKET_IN_TRANSFER )
+  if ( FILE_OK == f_open ( PMG_BURST_FILE, O_RDONLY, &fh ) )
+  {
+    if ( 7 == f_read ( &fh, line, 7 ) )
     {
-      if  ( connected )
-      {
-        //  Let BRX terminate, then log out
-        vTaskDelay( (portTickType)TASK_DELAY_MS( 75000 ) );
-
-        close_rudics_server (connection_state);
-        connected = 0;
-        connection_state = 0;
-      }
-      return PMG_PRF_TX_ALL_DONE;
+      line[7] = 0;
+      sscanf ( line, "%u", &saved );
     }
+    f_close ( &fh );
   }
 
-  //  At this point, if packet_in_transfer == NO_PACKET_IN_TRANSFER,
-  //  that implies all packets were already sent.
-  //
+  pmg_burst_saved  = ( BT_BURST_MIN <= saved && saved <= BT_BURST_MAX ) ? saved : 0;
+  pmg_bt.good      = pmg_burst_saved;
+  pmg_burst_loaded = TRUE;
+}
+
+//  End of a call: keep the size that last went through, for the next one
+//
+static void pmg_burst_save ( void )
+{
+  if ( !pmg_bt.good || pmg_bt.good == pmg_burst_saved ) return;
 
-  if ( packet_in_transfer == NO_PACKET_IN_TRANSFER )
+  char line[8];
+  fHandler_t fh;
+  snprintf ( line, sizeof(line), "%05hu\r\n", pmg_bt.good );
+
+  if ( FILE_OK == f_open ( PMG_BURST_FILE, O_WRONLY | O_CREAT, &fh ) )
   {
-    //  FIXME: Check for rudics received/resend records.
-    //
-    char rudicsMessage[128];
-    if   (mdm_recv (rudicsMessage, 128, MDM_NONBLOCK))
+    if ( 7 == f_write ( &fh, line, 7 ) )
     {
-      //  Resend Burst request
-      //  ...
-# if 0
-      uint16_t const requested_profile = packet_rx_via_queue.data.Command.value.u16[0];
+      pmg_burst_saved = pmg_bt.good;
+    }
+    f_close ( &fh );
+  }
+}
 
-      if  (requested_profile == profileID)
-      {
-        uint16_t const requested_packet = packet_rx_via_queue.data.Command.value.u16[1];
+//  Wait for the MODE reply of the given step
+//
+static int pmg_mode_wait ( int step )
+{
+  int waited;
+  for ( waited=0; waited<PMG_MODE_REPLY_MS && pmg_bt.mode_reply[step] < 0; waited+=500 )
+  {
+    vTaskDelay( (portTickType)TASK_DELAY_MS( 500 ) );
+    bt_replies ( &pmg_bt, NO_PACKET_IN_TRANSFER );
+  }
+  return pmg_bt.mode_reply[step] >= 0;
+}
 
-        if  ( /* 0 <= requested_packet && */ requested_packet < numPackets )
-        {
-          switch ( packet_status[requested_packet] )
-          {
-          case PCK_Unsent:
-                  // nothing to do, was already planning to send
-                  break;
-          case PCK_Sent:
-                  packet_status[requested_packet] = PCK_Unsent;
-                  break;
-          case PCK_Confirmed:
-                  //  Assume the earlier confirmation was in error
-                  packet_status[requested_packet] = PCK_Unsent;
-                  break;
-          }
-        }
-      }
-# endif
-      //  Received burst confirmation
-      //  ...
-    }
+//  Offer the receiver binary framing, framed like burst 0:
+//  "MODEhhhhppppp0000mmm0000" and its CRC, mmm the modes offered.
+//  Granted, send the probe burst: all 256 byte values in binary framing,
+//  which arrive intact over an 8 bit clean path only.
+//  Older receivers skip the offer as noise between bursts and never answer.
+//  They, and paths that strip the 8th bit, take XON/XOFF for flow control
+//  or translate line endings, get ASCII framing: pmg_tx_binary stays FALSE.
+//
+static void pmg_mode_negotiate ( uint16_t profileID )
+{
+  pmg_tx_binary        = FALSE;
+  pmg_bt.mode_reply[0] = -1;
+  pmg_bt.mode_reply[1] = -1;
+  pmg_bt.have          = 0;
 
-    //  Check for status of all packets.
-    //  If all sent and all confirmed / no resend requests
-    //  then  close rudics connection & return PMG_PRF_TX_ALL_DONE;
-    //
+  if ( !PMG_TX_BINARY ) return;
+
+  char offer[33];
+  snprintf ( offer, 25, "MODE%04hu%05hu0000%03hu0000", CFG_Get_Serial_Number(), profileID,
+             (uint16_t)BRST_MODE_BINARY );
+
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, (Bytef*)offer, 24 );
+  snprintf ( offer+24, 9, "%08lX", crc );
+
+  if ( 32 != mdm_send ( offer, 32, MDM_USE_CTS, 5 ) ) return;
+
+  if ( !pmg_mode_wait ( 0 ) || !( BRST_MODE_BINARY & pmg_bt.mode_reply[0] ) ) return;
+
+  //  Highest values first: with software flow control,
+  //  XOFF (0x13) goes ahead of XON (0x11), and the path resumes.
+  unsigned char probe[BRSB_HEADER + 256 + BRSB_TRAILER];
+  data_packet_burst_header14 ( CFG_Get_Serial_Number(), profileID, 0, BRSB_PROBE, 256, probe );
+
+  int i;
+  for ( i=0; i<256; i++ )
+  {
+    probe[BRSB_HEADER+i] = (unsigned char)( 255-i );
   }
 
-  if  (packet_in_transfer != NO_PACKET_IN_TRANSFER)
+  crc = crc32 ( 0L, Z_NULL, 0 );
+  crc = crc32 ( crc, probe, BRSB_HEADER + 256 );
+  serialize_4byte ( probe + BRSB_HEADER + 256, crc );
+
+  if ( sizeof(probe) != mdm_send ( probe, sizeof(probe), MDM_USE_CTS, 5 ) ) return;
+
+  if ( pmg_mode_wait ( 1 ) && 1 == pmg_bt.mode_reply[1] )
   {
+    pmg_tx_binary = TRUE;
+  }
+}
 
-    if  (!connected  ||  !mdm_carrier_detect ())
-    {
-      //  (Re)-establish connection to rudics server
-      //
-      if  (!open_rudics_server (&connection_state))
-      {
-        snprintf (mmm, sizeof(mmm), "RUDICS Not Connected %04x\r\n", connection_state);
-        tlm_send (mmm, strlen(mmm), 0);
-        close_rudics_server( connection_state);
-        connected = 0;
-        return PMG_PRF_TX_MDM_FAIL;
-      }
-      else
-      {
-        tlm_send ( "RUDICS Connected\r\n", 19, 0 );
-        connected = 1;
-      }
-    }
+static uint32_t pmg_io_now_ms ( void* context )
+{
+  return xTaskGetTickCount() * portTICK_RATE_MS;
+}
 
-    if  (connected)
-    {
+static void pmg_io_sleep_ms ( void* context, uint32_t ms )
+{
+  vTaskDelay( (portTickType)TASK_DELAY_MS( ms ) );
+}
 
-      //   snprintf ( mmm, sizeof(mmm), "ToTx %02hu %04x\r\n", packet_in_transfer, burst_status[packet_in_transfer] );
-      //   tlm_send ( mmm, strlen(mmm), 0 );
+//  A lost call shows in the carrier, not here
+//
+static int16_t pmg_io_recv ( void* context, char* data, uint16_t size )
+{
+  S16 const n = mdm_recv ( data, size, MDM_NONBLOCK );
+  return ( n < 0 ) ? 0 : n;
+}
 
-      if  (0 == packet_in_transfer)
-      {
-        if  ((BST_Unsent << (3 * 0)) & burst_status[packet_in_transfer])
-        {
-          int nB;
-          if  (!info_packet_bursts_transmit (&transferring_pip, tx_instruct.burst_size, &nB, 0))
-          {
-            packet_bursts[packet_in_transfer] = nB;
-            burst_status [packet_in_transfer] &= ~(BST_Unsent<<(3*0));
-            burst_status [packet_in_transfer] |=  (BST_Sent  <<(3*0));
-            snprintf ( mmm, sizeof(mmm), "Txed %02hu.0\r\n", packet_in_transfer );
-            tlm_send ( mmm, strlen(mmm), 0 );
-            return PMG_PRF_TX_CONTINUE;
-          }
-        }
-        else
-        {
-          int b; int nB = packet_bursts[packet_in_transfer];
-          for  (b = 1;  b <= nB + 1;  b++)
-          {
-            if  ((BST_Unsent << (3 * b))  &  burst_status[packet_in_transfer])
-            {
-              if  (!info_packet_bursts_transmit (&transferring_pip, tx_instruct.burst_size, &nB, b))
-              {
-                burst_status [packet_in_transfer] &= ~(BST_Unsent<<(3*b));
-                burst_status [packet_in_transfer] |=  (BST_Sent  <<(3*b));
-                snprintf ( mmm, sizeof(mmm), "Txed %02hu.%d\r\n", packet_in_transfer, b );
-                tlm_send ( mmm, strlen(mmm), 0 );
+static int pmg_io_send ( void* context, char const* data, uint16_t size )
+{
+  return size != mdm_send ( data, size, MDM_USE_CTS, 5 );
+}
 
-                if ( b==nB )
-                {
-                  //  Send terminating burst immediately after last data burst
-                  if ( !info_packet_bursts_transmit( &transferring_pip, tx_instruct.burst_size, &nB, nB+1 ) )
-                  {
-                    burst_status [packet_in_transfer] &= ~(BST_Unsent<<(3*(b+1)));
-                    burst_status [packet_in_transfer] |=  (BST_Sent  <<(3*(b+1)));
-                    packet_status[packet_in_transfer] = PCK_Sent;
-                  }
-                }
-                return PMG_PRF_TX_CONTINUE;
-              }
-            }
-          }
-        }
-      }
-      else
-      {
-        if  ((BST_Unsent << (3 * 0)) & burst_status[packet_in_transfer])
-        {
-          int nB;
-          if  (!data_packet_bursts_transmit (transferring_pdp, tx_instruct.burst_size, &nB, 0))
-          {
-            packet_bursts[packet_in_transfer] = nB;
-            burst_status [packet_in_transfer] &= ~(BST_Unsent<<(3*0));
-            burst_status [packet_in_transfer] |=  (BST_Sent  <<(3*0));
-            snprintf ( mmm, sizeof(mmm), "Txed %02hu.0\r\n", packet_in_transfer );
-            tlm_send ( mmm, strlen(mmm), 0 );
-            return PMG_PRF_TX_CONTINUE;
-          }
-        }
-        else
-        {
-          int b; int nB = packet_bursts[packet_in_transfer];
-          for ( b=1; b<=nB; b++ )
-          {
-            if  ((BST_Unsent<<(3*b)) & burst_status[packet_in_transfer])
-            {
-              if ( !data_packet_bursts_transmit( transferring_pdp, tx_instruct.burst_size, &nB, b ) )
-              {
-                burst_status [packet_in_transfer] &= ~(BST_Unsent<<(3*b));
-                burst_status [packet_in_transfer] |=  (BST_Sent  <<(3*b));
-                snprintf ( mmm, sizeof(mmm), "Txed %02hu.%d\r\n", packet_in_transfer, b );
-                tlm_send ( mmm, strlen(mmm), 0 );
+static int pmg_io_carrier ( void* context )
+{
+  return mdm_carrier_detect ();
+}
 
-                if ( b==nB )
-                {
-                  //  Send terminating burst immediately after last data burst
-                  if ( !data_packet_bursts_transmit( transferring_pdp, tx_instruct.burst_size, &nB, nB+1 ) )
-                  {
-                    burst_status [packet_in_transfer] &= ~(BST_Unsent<<(3*(b+1)));
-                    burst_status [packet_in_transfer] |=  (BST_Sent  <<(3*(b+1)));
-                    packet_status[packet_in_transfer] = PCK_Sent;
-                  }
-                }
-                return PMG_PRF_TX_CONTINUE;
-              }
-            }
-          }
-        }
-      }
-    }
+//  (Re)-establish connection to rudics server
+//
+static int pmg_io_connect ( void* context )
+{
+  char mmm[32];
+
+  if  (!open_rudics_server (&pmg_connection_state))
+  {
+    snprintf (mmm, sizeof(mmm), "RUDICS Not Connected %04x\r\n", pmg_connection_state);
+    tlm_send (mmm, strlen(mmm), 0);
+    close_rudics_server( pmg_connection_state);
+    return 1;
   }
 
-  return PMG_PRF_TX_CONTINUE;
+  tlm_send ( "RUDICS Connected\r\n", 19, 0 );
+
+  //  Logged in: agree on the framing of bursts with the receiver,
+  //  before the first burst of this call
+  //
+  pmg_mode_negotiate ( pmg_bt.profileID );
+  if  (pmg_tx_binary)
+    tlm_send ( "Binary framing\r\n", 16, 0 );
+  else
+    tlm_send ( "ASCII framing\r\n", 15, 0 );
+
+  pmg_burst_load ();
+  pmg_bt.offer_repair = pmg_tx_binary ? PMG_TX_REPAIR : 0;
+  return 0;
 }
 
+static void pmg_io_disconnect ( void* context )
+{
+  close_rudics_server (pmg_connection_state);
+  pmg_connection_state = 0;
+}
+
+static void pmg_io_call_ended ( void* context )
+{
+  pmg_burst_save ();
+}
+
+static void pmg_io_retrieve ( void* context, uint16_t p )
+{
+  char mmm[8];
+  char packet_file_name[34];
+  strncpy ( packet_file_name, EMMC_DRIVE PMG_PROFILE_FOLDER "\\", 34 );
+  S32_to_str_dec ( (S32)(pmg_bt.profileID), mmm, sizeof(mmm), 5 );
+  strncat ( packet_file_name, mmm, 5 );
+  strcat  ( packet_file_name, "\\" );
+  strncat ( packet_file_name, mmm, 5 );
+  strcat  ( packet_file_name, ".P" );
+  S32_to_str_dec ( (S32)p, mmm, sizeof(mmm), 2 );
+  strncat ( packet_file_name, mmm, 2 );
+
+  if ( 0 == p )
+  {
+    info_packet_retrieve_native ( &pmg_tx_pip, packet_file_name );
+  }
+  else
+  {
+    data_packet_retrieve_native ( 12, packet_file_name );
+  }
+}
+
+//  Data packets are retrieved to sram_PMG_2
+//
+static int pmg_io_burst ( void* context, uint16_t p, int burst_size, int* nB, int b )
+{
+  if ( 0 == p ) return info_packet_bursts_transmit ( &pmg_tx_pip, burst_size, nB, b );
+  return data_packet_bursts_transmit ( (Profile_Data_Packet_t*)sram_PMG_2, burst_size, nB, b );
+}
+
+static int pmg_io_size ( void* context, uint16_t p )
+{
+  if ( 0 == p ) return 4*4 + 4*4 + BEGPAK_META;
+  return data_packet_sent_size ( (Profile_Data_Packet_t*)sram_PMG_2 );
+}
+
+static void pmg_io_repair ( void* context, uint16_t p, int nB, uint16_t nRepair )
+{
+  if ( p ) data_packet_repair_transmit ( (Profile_Data_Packet_t*)sram_PMG_2, nB, nRepair );
+}
+
+static void pmg_io_record ( void* context, uint16_t p )
+{
+  pmg_sts_acks_write ( pmg_bt.profileID, p );
+}
+
+static void pmg_io_note ( void* context, char const* text )
+{
+  tlm_send ( text, strlen(text), 0 );
+}
+
+static bt_io_t const pmg_io = {
+  0,
+  pmg_io_now_ms,
+  pmg_io_sleep_ms,
+  pmg_io_recv,
+  pmg_io_send,
+  pmg_io_carrier,
+  pmg_io_connect,
+  pmg_io_disconnect,
+  pmg_io_call_ended,
+  pmg_io_retrieve,
+  pmg_io_burst,
+  pmg_io_size,
+  pmg_io_repair,
+  pmg_io_record,
+  pmg_io_note
+};
+
 
 
 static void specdata_fake( Spectrometer_Data_t* s, int side )
@@ -2425,8 +2810,7 @@ static Transfer_Status_t profile_fake( uint16_t profileID )
   Packet_Status_t* packet_status = pvPortMalloc ( numPackets * sizeof(Packet_Status_t) );
 
   uint16_t* packet_bursts = pvPortMalloc ( numPackets * sizeof(uint16_t) );
-  int const maxBursts = 2 + 1 + ( sizeof(Profile_Data_Packet_t)-1 ) / tx_instruct.burst_size;
-  uint32_t* burst_status  = (uint32_t*) pvPortMalloc ( numPackets * sizeof(uint32_t) );
+  Burst_Status_t* burst_status = pvPortMalloc ( numPackets * sizeof(Burst_Status_t) );
 
   Transfer_Status_t tx_sts = Tx_Sts_Package_Fail;
 
@@ -2436,30 +2820,26 @@ static Transfer_Status_t profile_fake( uint16_t profileID )
   }
   else
   {
-    int p;
-    for ( p = 0;  p < numPackets;  p++ )
+    pmg_bt.serial = CFG_Get_Serial_Number();
+    bt_profile ( &pmg_bt, profileID, numPackets, packet_status, packet_bursts, burst_status );
+
+    //  Resume an earlier transmission of this profile
+    //
+    pmg_sts_acks_read ( profileID, numPackets );
+
+    int bt_value;
+    while ( BT_CONTINUE == ( bt_value = bt_transmission ( &pmg_bt ) )
+         || BT_SEND_NOW == bt_value )
     {
-      packet_status[p] = PCK_Unsent;
-      packet_bursts[p] = 0;
-      int b;
-      burst_status[p] = 0;
-      for ( b=0; b<maxBursts; b++ )
+      if ( BT_CONTINUE == bt_value )
       {
-        burst_status[p] |= (BST_Unsent<<(3*b));
+        vTaskDelay( (portTickType)TASK_DELAY_MS( 500 ) );
       }
     }
 
-    int PMG_PRF_TX_value;
-    while ( PMG_PRF_TX_CONTINUE ==
-         ( PMG_PRF_TX_value = pmg_profile_transmission ( profileID, numPackets,
-                             packet_status, packet_bursts, burst_status ) ) )
-    {
-      vTaskDelay( (portTickType)TASK_DELAY_MS( 500 ) );
-    }
-
-    //  Interpret pmg_profile_transmission() return value
+    //  Interpret bt_transmission() return value
     //
-    if ( PMG_PRF_TX_value == PMG_PRF_TX_ALL_DONE )
+    if ( BT_ALL_DONE == bt_value )
     {
       tx_sts = Tx_Sts_AllDone;
     }
@@ -2481,7 +2861,7 @@ static Transfer_Status_t profile_fake( uint16_t profileID )
 
 
 
-static int16_t rudics_connect ()
+static int16_t rudics_connect ( uint16_t profileID )
 {
   //
   //  Assertain basic modem communication and status
@@ -2587,6 +2967,12 @@ static int16_t rudics_connect ()
     return -1;
   }
 
+  //
+  //  Agree on the framing of bursts with the receiver.
+  //
+  pmg_mode_negotiate ( profileID );
+  io_out_string ( pmg_tx_binary ? "Binary framing\r\n" : "ASCII framing\r\n" );
+
   return 0;
 }
 # if 0
@@ -2663,7 +3049,7 @@ static int16_t transfer_start (uint16_t*                       tx_profile_id,
     return -1;
   }
 
-  if  (rudics_connect () < 0)
+  if  (rudics_connect (*tx_profile_id) < 0)
   {
     return -1;
   }
@@ -3059,6 +3445,7 @@ static void profile_manager_loop( __attribute__((unused)) void* pvParameters )
 
               if ( PMG_Profiling == pmg_state ) {
                 pmg_state = PMG_Idle;
+                write_spec_flush ( FALSE );   //  Checkpoint; offloaded spectra may follow
 //              profile_stop( profile_id, profile_frames );
 //              tx_profile_id = profile_id;
 //              profile_id = 0;
@@ -3643,6 +4030,12 @@ Bool profile_manager_createTask(void)
     sending_data_package.address = sram_PMG;
 # endif
 
+    //  Steps of profile transmissions
+    bt_init ( &pmg_bt, &pmg_io );
+    pmg_bt.offer_window = PMG_TX_WINDOW;
+    pmg_bt.fixed_burst  = FIXED_BURST_SIZE;
+    pmg_bt.adapt        = PMG_BURST_ADAPT;
+
     //  All local task variables are set up
 
     taskCreated = TRUE;
@@ -743,10 +743,11 @@ int data_packet_gray2bin ( Profile_Data_Packet_t* gray, Profile_Data_Packet_t* b
     for ( p=0; p<N_SPEC_PIX; p++ ) {
       uint16_t val = gray->contents.structured.sensor_data.pixel[i][p];
 
-      uint16_t mask;
-      for ( mask = val>>1; mask != 0; mask >>= 1 ) {
-        val = val ^ mask;
-      }
+      //  Prefix XOR: 4 steps for any 16-bit value
+      val ^= val >> 8;
+      val ^= val >> 4;
+      val ^= val >> 2;
+      val ^= val >> 1;
 
       bin->contents.structured.sensor_data.pixel[i][p] = val;
     }
@@ -1232,6 +1233,94 @@ int16_t data_packet_encode ( Profile_Data_Packet_t* unenc, Profile_Data_Packet_t
 }
 # endif
 
+//  Repair burst j (1..nRepair) of a packet of nData bytes sent as numBursts
+//  equal bursts: the XOR of its data bursts j, j+nRepair, j+2*nRepair, ...
+//  The last, shorter data burst counts as padded with zeros.
+//  One of these bursts lost is the XOR of the repair burst and the others.
+//  Returns the size of a data burst, written to repair, or 0.
+//
+uint16_t data_packet_repair ( const unsigned char* data, uint16_t nData, int numBursts, int nRepair, int j, unsigned char* repair ) {
+
+  if ( !data || !repair || !nData || numBursts < 1 || nRepair < 1 || j < 1 || j > nRepair ) {
+    return 0;
+  }
+
+  uint16_t const bSize = 1 + ( nData - 1 ) / numBursts;
+  memset ( repair, 0, bSize );
+
+  int b;
+  for ( b=j; b<=numBursts; b+=nRepair ) {
+    const unsigned char* burst = data + (b-1)*bSize;
+    uint16_t const sz = ( b < numBursts ) ? bSize : nData - (numBursts-1)*bSize;
+    uint16_t i;
+    for ( i=0; i<sz; i++ ) {
+      repair[i] ^= burst[i];
+    }
+  }
+
+  return bSize;
+}
+
+//  Header of a burst framed in binary (see profile_packet.shared.h),
+//  BRSB_HEADER bytes written to header.
+//
+void data_packet_burst_header14 ( uint16_t hynv, uint16_t prof, uint16_t pckt, uint16_t burst, uint16_t value, unsigned char* header ) {
+
+  uint16_t const field[5] = { hynv, prof, pckt, burst, value };
+
+  memcpy ( header, "BRSB", 4 );
+
+  int f;
+  for ( f=0; f<5; f++ ) {
+    header[4+2*f  ] = (unsigned char) ( field[f] >> 8 );
+    header[4+2*f+1] = (unsigned char) ( field[f] & 0xFF );
+  }
+}
+
+//  ASCII85 encoding of nData bytes as by data_packet_encode(), but without
+//  the 'z' and 'y' abbreviations, such that any part of it can be encoded
+//  on its own: 5 characters per 4 bytes, n+1 for the last n < 4 bytes.
+//
+uint16_t data_packet_ascii85_size ( uint16_t nData ) {
+  return 5*(nData/4) + ( (nData%4) ? nData%4 + 1 : 0 );
+}
+
+//  Characters from .. from+size-1 of that encoding, written to out.
+//  Returns the number of characters written.
+//
+uint16_t data_packet_ascii85_range ( const unsigned char* data, uint16_t nData, uint16_t from, uint16_t size, unsigned char* out ) {
+
+  uint32_t const total = data_packet_ascii85_size ( nData );
+  uint32_t const to    = ( (uint32_t)from + size < total ) ? (uint32_t)from + size : total;
+
+  uint32_t c = from;
+  while ( c < to ) {
+
+    uint32_t const g     = c / 5;
+    uint16_t const bytes = ( nData - 4*g < 4 ) ? nData - 4*g : 4;
+
+    uint32_t number = 0;
+    uint16_t i;
+    for ( i=0; i<bytes; i++ ) {
+      number |= (uint32_t)data[4*g+i] << (24-(i*8));
+    }
+
+    uint8_t encoded[5];
+    int idx;
+    for ( idx=4; idx>=0; idx-- ) {
+      encoded[idx] = (uint8_t) ( (number%85) + 33 );
+      number /= 85;
+    }
+
+    uint16_t k;
+    for ( k=c%5; k<=bytes && c<to; k++, c++ ) {
+      *out++ = encoded[k];
+    }
+  }
+
+  return ( to > from ) ? to - from : 0;
+}
+
 # if 0
 int data_packet_decode ( Profile_Data_Packet_t* enc, Profile_Data_Packet_t* dec ) {
 
@@ -36,6 +36,14 @@ int16_t data_packet_compress ( Profile_Data_Packet_t* unc, Profile_Data_Packet_t
 int16_t data_packet_encode ( Profile_Data_Packet_t* unenc, Profile_Data_Packet_t* enc, char encoding );
 //int data_packet_decode ( Profile_Data_Packet_t* dec, Profile_Data_Packet_t* enc );
 
+//  Repair burst j of a packet sent as numBursts bursts
+uint16_t data_packet_repair ( const unsigned char* data, uint16_t nData, int numBursts, int nRepair, int j, unsigned char* repair );
+
+//  Binary framing, and ASCII85 encoding of any part of a packet, see profile_packet.shared.h
+void     data_packet_burst_header14 ( uint16_t hynv, uint16_t prof, uint16_t pckt, uint16_t burst, uint16_t value, unsigned char* header );
+uint16_t data_packet_ascii85_size   ( uint16_t nData );
+uint16_t data_packet_ascii85_range  ( const unsigned char* data, uint16_t nData, uint16_t from, uint16_t size, unsigned char* out );
+
 //int data_packet_compare( Profile_Data_Packet_t* p1, Profile_Data_Packet_t* p2, char ID1, char ID2 );
 
 # endif // _PROFILE_PACKET_CONTROLLER_H_
@@ -14,8 +14,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <gpio.h>
+#include <eic.h>
+#include <intc.h>
 #include <FreeRTOS.h>
 #include <task.h>
+#include <semphr.h>
 
 #include <time.h>
 #include <sys/time.h>
@@ -48,6 +51,74 @@ SPI_Indicator_t SPI_Get_OtherBoard_Indicator() {
   return gpio_get_pin_value( SPEC1_RDY__INT2 ) ? SPI_IND_Passive : SPI_IND_Active;
 }
 
+static xSemaphoreHandle wakeSemaphore = NULL;
+
+static void SPI_OtherBoard_Active_ISR(void) __attribute__ ((naked));
+
+//  See the note on FreeRTOS interrupt service routines in power.c
+__attribute__ ((__noinline__))
+static portBASE_TYPE SPI_OtherBoard_Active_ISR_non_naked(void) {
+
+  portBASE_TYPE xHigherPrioTaskWoken = pdFALSE;
+
+  if ( wakeSemaphore ) {
+    portENTER_CRITICAL();
+    xSemaphoreGiveFromISR( wakeSemaphore, &xHigherPrioTaskWoken );
+    portEXIT_CRITICAL();
+  }
+
+  eic_clear_interrupt_line( &AVR32_EIC, SPEC1_RDY__INT2_LINE );
+
+  return xHigherPrioTaskWoken;
+}
+
+__attribute__((__naked__))
+static void SPI_OtherBoard_Active_ISR(void) {
+  portENTER_SWITCHING_ISR();
+  SPI_OtherBoard_Active_ISR_non_naked();
+  portEXIT_SWITCHING_ISR();
+}
+
+//! \brief   Give a semaphore whenever the other board's indicator turns Active
+void SPI_Wake_On_OtherBoard_Active( xSemaphoreHandle wake ) {
+
+  static Bool configured = FALSE;
+
+  if ( !configured ) {
+
+    //  The ready line is active low: interrupt on the falling edge.
+    //  The pin value can still be read while the pin is assigned to the EIC.
+    eic_options_t eic_options;
+    eic_options.eic_mode   = EIC_MODE_EDGE_TRIGGERED;
+    eic_options.eic_edge   = EIC_EDGE_FALLING_EDGE;
+    eic_options.eic_level  = EIC_LEVEL_LOW_LEVEL;
+    eic_options.eic_filter = EIC_FILTER_ENABLED;
+    eic_options.eic_async  = EIC_SYNCH_MODE;
+    eic_options.eic_line   = SPEC1_RDY__INT2_LINE;
+
+    static const gpio_map_t EIC_GPIO_MAP = {
+      { SPEC1_RDY__INT2, SPEC1_RDY__INT2_PIN_FUNCTION }
+    };
+    gpio_enable_module( EIC_GPIO_MAP, 1 );
+
+    Disable_global_interrupt();
+    INTC_register_interrupt( &SPI_OtherBoard_Active_ISR, SPEC1_RDY__INT2_IRQ, SPEC1_RDY__INT2_PRIO );
+    eic_init( &AVR32_EIC, &eic_options, 1 );
+    Enable_global_interrupt();
+
+    configured = TRUE;
+  }
+
+  eic_disable_interrupt_line( &AVR32_EIC, SPEC1_RDY__INT2_LINE );
+
+  wakeSemaphore = wake;
+
+  if ( wake ) {
+    eic_clear_interrupt_line( &AVR32_EIC, SPEC1_RDY__INT2_LINE );
+    eic_enable_interrupt_line( &AVR32_EIC, SPEC1_RDY__INT2_LINE );
+  }
+}
+
 # else
 
 # endif
@@ -558,3 +629,37 @@ int16_t SPI_rx_packet(uint8_t header[], int16_t const header_size, uint8_t data[
 
     return return_value;
 }
+
+
+//! \brief  spi_link transport: send one frame to the spectrometer board
+//!
+//!  The frame goes as the packet header, without packet data.
+//!
+//! @return  The frame size, or the negative SPI_tx_packet() code
+int32_t SPI_link_send( __attribute__((unused)) void* context, uint8_t* frame, uint16_t size ) {
+
+    int16_t tx_size = 0;
+    int16_t status  = SPI_tx_packet( frame, size, 0, 0, &tx_size );
+
+    return status < 0 ? status : tx_size;
+}
+
+//! \brief  spi_link transport: receive one frame, if the spectrometer board has one
+//!
+//!  The frame goes into the packet data. SPI_rx_packet() also reports
+//!  a full buffer (-34) and data bytes equal to its dummy byte (-1000-n)
+//!  as errors; both are normal in a binary frame, whose CRC is checked
+//!  by the link instead. Any received bytes are therefore passed on.
+//!
+//! @return  The frame size, 0 if the other board is passive, or the negative SPI_rx_packet() code
+int32_t SPI_link_receive( __attribute__((unused)) void* context, uint8_t* frame, uint16_t max_size ) {
+
+    if ( SPI_IND_Passive == SPI_Get_OtherBoard_Indicator() ) {
+      return 0;
+    }
+
+    int16_t rx_size = 0;
+    int16_t status  = SPI_rx_packet( 0, 0, frame, max_size, &rx_size );
+
+    return rx_size > 0 ? rx_size : ( status < 0 ? status : 0 );
+}
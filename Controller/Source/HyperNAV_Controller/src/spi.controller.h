@@ -11,6 +11,8 @@
 
 #include <compiler.h>
 #include <stdint.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
 
 # define SPI_HANDSHAKE_VIA_2_LINES 1
 # ifdef SPI_HANDSHAKE_VIA_2_LINES
@@ -31,6 +33,15 @@ SPI_Indicator_t SPI_Get_MyBoard_Indicator();
 //! @return  SPI_IND_Active or SPI_IND_Passive
 SPI_Indicator_t SPI_Get_OtherBoard_Indicator();
 
+//! \brief   Give a semaphore whenever the other board's indicator turns Active
+//!
+//!  Lets a task block on the semaphore instead of polling the indicator.
+//!  It is given at each falling edge of the ready line; a binary semaphore
+//!  holds a single wake-up, however many edges come before it is taken.
+//!
+//! @param   wake     A binary semaphore, NULL to stop giving
+void SPI_Wake_On_OtherBoard_Active( xSemaphoreHandle wake );
+
 # else
 
 # endif
@@ -59,6 +70,14 @@ int16_t SPI_tx_packet(uint8_t* header, int16_t header_size, uint8_t* data, int16
 //!
 int16_t SPI_rx_packet(uint8_t header[], int16_t const header_size, uint8_t data[], int16_t const data_size, int16_t* rx_size );
 
+//! \brief  spi_link transport: send one frame to the spectrometer board
+//! @return  The frame size, or the negative SPI_tx_packet() code
+int32_t SPI_link_send( void* context, uint8_t* frame, uint16_t size );
+
+//! \brief  spi_link transport: receive one frame, if the spectrometer board has one
+//! @return  The frame size, 0 if the other board is passive, or the negative SPI_rx_packet() code
+int32_t SPI_link_receive( void* context, uint8_t* frame, uint16_t max_size );
+
 
 
 #endif /* SPI.CONTROLLER_H_ */
@@ -46,9 +46,25 @@ sram_pointer const sram_DXC_2 = SRAM + ANY_DATA_BLOCK_SIZE;
 sram_pointer const sram_PMG_1 = SRAM + 2*ANY_DATA_BLOCK_SIZE;
 sram_pointer const sram_PMG_2 = SRAM + 3*ANY_DATA_BLOCK_SIZE;
 
+//    2 x Staging buffer for batched spectrum writes (port, starboard)
+
+sram_pointer const sram_PMG_SPEC_P = SRAM + 4*ANY_DATA_BLOCK_SIZE;
+sram_pointer const sram_PMG_SPEC_S = SRAM + 4*ANY_DATA_BLOCK_SIZE + SRAM_PMG_SPEC_SIZE;
+
+//  Data log file writer
+//    Ring of records, staging buffer
+
+sram_pointer const sram_DLF_RING  = SRAM + 4*ANY_DATA_BLOCK_SIZE + 2*SRAM_PMG_SPEC_SIZE;
+sram_pointer const sram_DLF_STAGE = SRAM + 4*ANY_DATA_BLOCK_SIZE + 2*SRAM_PMG_SPEC_SIZE + SRAM_DLF_RING_SIZE;
+
+//  Data exchange task
+//    Receive frame of the board to board link
+
+sram_pointer const sram_DXC_LINK  = SRAM + 4*ANY_DATA_BLOCK_SIZE + 2*SRAM_PMG_SPEC_SIZE + SRAM_DLF_RING_SIZE + SRAM_DLF_STAGE_SIZE;
+
 
 bool sram_memory_sufficient() {
-  return (S32)(4*ANY_DATA_BLOCK_SIZE) <= SRAM_SIZE;	
+  return (S32)(4*ANY_DATA_BLOCK_SIZE + 2*SRAM_PMG_SPEC_SIZE + SRAM_DLF_RING_SIZE + SRAM_DLF_STAGE_SIZE + SRAM_DXC_LINK_SIZE) <= SRAM_SIZE;	
 }
 
 void sram_read ( U8* destination, sram_pointer sram_source, size_t num_bytes ) {
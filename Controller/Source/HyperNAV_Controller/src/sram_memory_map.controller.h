@@ -28,6 +28,31 @@ extern sram_pointer const sram_DXC_2;
 extern sram_pointer const sram_PMG_1;
 extern sram_pointer const sram_PMG_2;
 
+//    2 x Staging buffer for batched spectrum writes (port, starboard)
+//        Divides the eMMC cluster size, so that staged writes are cluster aligned
+
+# define SRAM_PMG_SPEC_SIZE (8*1024)
+
+extern sram_pointer const sram_PMG_SPEC_P;
+extern sram_pointer const sram_PMG_SPEC_S;
+
+//  Data log file writer
+//    Ring of records on their way to the data log file, a power of two
+//    Staging buffer of the batched writer, divides the eMMC cluster size
+
+# define SRAM_DLF_RING_SIZE  (16*1024)
+# define SRAM_DLF_STAGE_SIZE (8*1024)
+
+extern sram_pointer const sram_DLF_RING;
+extern sram_pointer const sram_DLF_STAGE;
+
+//  Data exchange task
+//    Receive frame of the board to board link, at least DE_LINK_SPEC_FRAME
+
+# define SRAM_DXC_LINK_SIZE  (5*1024)
+
+extern sram_pointer const sram_DXC_LINK;
+
 //  API
 
 bool sram_memory_sufficient();
@@ -120,7 +120,14 @@ static void stream_log_loop( __attribute__((unused)) void* pvParameters_notUsed
 
       data_exchange_packet_t packet_rx_via_queue;
 
-      if ( pdPASS == xQueueReceive( rxPackets, &packet_rx_via_queue, 0 ) ) {
+      //  Sleep until a packet arrives.
+      //  The time out only serves to notice a pause request.
+      THIS_TASK_WILL_SLEEP( gHNV_StreamLogTask_Status );
+      portBASE_TYPE const received = xQueueReceive( rxPackets, &packet_rx_via_queue,
+                                                    (portTickType)TASK_DELAY_MS( HNV_StreamLogTask_PERIOD_MS ) );
+      THIS_TASK_IS_RUNNING( gHNV_StreamLogTask_Status );
+
+      if ( pdPASS == received ) {
 
         if ( packet_rx_via_queue.to != myAddress ) {
 
@@ -658,15 +665,12 @@ static void stream_log_loop( __attribute__((unused)) void* pvParameters_notUsed
 
     } else {
       gTaskIsRunning = FALSE;
-    }
 
-    // Delay so other tasks can operate
-    THIS_TASK_WILL_SLEEP( gHNV_StreamLogTask_Status );
-    switch ( slg_state ) {
-    case SLG_Idle:  vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_StreamLogTask_PERIOD_MS   ) ); break;
-    case SLG_Rxing: vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_StreamLogTask_PERIOD_MS/5 ) ); break;
+      // Delay so other tasks can operate
+      THIS_TASK_WILL_SLEEP( gHNV_StreamLogTask_Status );
+      vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_StreamLogTask_PERIOD_MS ) );
+      THIS_TASK_IS_RUNNING( gHNV_StreamLogTask_Status );
     }
-    THIS_TASK_IS_RUNNING( gHNV_StreamLogTask_Status );
   }
 }
 
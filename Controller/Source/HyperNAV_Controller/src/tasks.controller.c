@@ -38,6 +38,10 @@ taskStatus_t gHNV_AuxDatAcqTask_Status  = TASK_UNKNOWN;
 //  Stream log task
 xTaskHandle  gHNV_StreamLogTask_Handler = NULL;
 taskStatus_t gHNV_StreamLogTask_Status  = TASK_UNKNOWN;
+
+//  Data log file writer task
+xTaskHandle  gHNV_DataLogWriterTask_Handler = NULL;
+taskStatus_t gHNV_DataLogWriterTask_Status  = TASK_UNKNOWN;
 # endif
 
 # if defined(OPERATION_NAVIS)
@@ -63,6 +67,7 @@ static void gHNV_MonitorTask ( __attribute__((unused)) void* pvParameters_notUse
             &gHNV_SetupCmdCtrlTask_Status,
 # if defined(OPERATION_AUTONOMOUS)
             &gHNV_StreamLogTask_Status,
+            &gHNV_DataLogWriterTask_Status,
 # endif
 # if defined(OPERATION_NAVIS)
             &gHNV_ProfileManagerTask_Status,
@@ -76,6 +81,7 @@ static void gHNV_MonitorTask ( __attribute__((unused)) void* pvParameters_notUse
             HNV_SetupCmdCtrlTask_NAME,
 # if defined(OPERATION_AUTONOMOUS)
             HNV_StreamLogTask_NAME,
+            HNV_DataLogWriterTask_NAME,
 # endif
 # if defined(OPERATION_NAVIS)
             HNV_ProfileManagerTask_NAME,
@@ -68,6 +68,14 @@ extern taskStatus_t gHNV_AuxDatAcqTask_Status;
 extern xTaskHandle  gHNV_StreamLogTask_Handler;
 extern taskStatus_t gHNV_StreamLogTask_Status;
 
+//	HyperNav Data Log File Writer
+//
+# define HNV_DataLogWriterTask_NAME        ((const signed portCHAR *)"Data Log Writer")
+# define HNV_DataLogWriterTask_STACK_SIZE  (768)
+# define HNV_DataLogWriterTask_PRIORITY    (tskIDLE_PRIORITY + 1)
+extern xTaskHandle  gHNV_DataLogWriterTask_Handler;
+extern taskStatus_t gHNV_DataLogWriterTask_Status;
+
 //	HyperNav Profile Manager
 //
 # define HNV_ProfileManagerTask_NAME        ((const signed portCHAR *)"Profile Manager")
@@ -87,6 +95,14 @@ extern taskStatus_t gHNV_ProfileManagerTask_Status;
 extern xTaskHandle  gHNV_StreamLogTask_Handler;
 extern taskStatus_t gHNV_StreamLogTask_Status;
 
+//	HyperNav Data Log File Writer
+//
+# define HNV_DataLogWriterTask_NAME        ((const signed portCHAR *)"Data Log Writer")
+# define HNV_DataLogWriterTask_STACK_SIZE  (768)
+# define HNV_DataLogWriterTask_PRIORITY    (tskIDLE_PRIORITY + 1)
+extern xTaskHandle  gHNV_DataLogWriterTask_Handler;
+extern taskStatus_t gHNV_DataLogWriterTask_Status;
+
 # elif defined(OPERATION_NAVIS)
 
 //	HyperNav Profile Manager
@@ -106,6 +122,7 @@ extern taskStatus_t gHNV_ProfileManagerTask_Status;
 # define HNV_DataXControlTask_STACK_SIZE  (768)
 # define HNV_DataXControlTask_PRIORITY    (tskIDLE_PRIORITY + 2)
 # define HNV_DataXControlTask_PERIOD_MS   50
+# define HNV_DataXControlTask_IDLE_MS     1000   //  Longest sleep while waiting for packets
 extern xTaskHandle  gHNV_DataXControlTask_Handler;
 extern taskStatus_t gHNV_DataXControlTask_Status;
 
@@ -14,6 +14,7 @@
 # include "files.h"
 # include "extern.controller.h"
 # include "io_funcs.controller.h"
+# include "spectrometer_data.h"
 
 // Use thread-safe dynamic memory allocation if available
 #ifdef FREERTOS_USED
@@ -31,6 +32,16 @@ static S16 wl_PixBase[2] = { 0, 0 };
 static S16 wl_PixMin [2] = { 0, 0 };
 static S16 wl_PixMax [2] = { 0, 0 };
 
+//	Set when the coefficients are loaded:
+//	+1 / -1 if wavelengths increase / decrease over all N_SPEC_PIX cells, 0 otherwise.
+//	For increasing wavelengths, wl_coarse[side][k] is the first cell
+//	at or above wl_coarseEdge(side,k), narrowing down binary searches.
+# define WL_COARSE 32
+static S16 wl_direction[2] = { 0, 0 };
+static S16 wl_coarse[2][WL_COARSE+1];
+
+static void wl_check ( S16 side );
+
 
 //!	\brief	Generate the z-coeff file name.
 //!
@@ -267,6 +278,8 @@ S16 wl_ParseFile ( char const* filename, S16 side ) {
 	//	Write wavelength coefficients to binary file for faster retrieval
 	wl_writeBin( side );
 
+	wl_check( side );
+
 	return WL_OK;
 }
 
@@ -336,8 +349,150 @@ S16 wl_Load ( S16 side ) {
 		return wl_ParseFile ( wl_MakeFileName( side ), side );
 	}
 
+	wl_check( side );
+
 	return WL_OK;
 }
 
+static F64 wl_coarseEdge ( S16 side, S16 k ) {
+
+	F64 const first = wl_wlenOfCell ( side, 0 );
+	F64 const last  = wl_wlenOfCell ( side, N_SPEC_PIX-1 );
+
+	return first + ( last - first ) * k / WL_COARSE;
+}
+
+static void wl_check ( S16 side ) {
+
+	wl_direction[side] = 0;
+
+	if ( wl_NumCoefs(side) < 2 ) return;
+
+	//	One pass over all cells: Check monotony,
+	//	and note the first cell at or above each coarse edge.
+	S16 up = 1, down = 1;
+	S16 k = 0;
+	F64 edge = wl_coarseEdge ( side, k );
+	F64 prev = wl_wlenOfCell ( side, 0 );
+
+	S16 cell;
+	for ( cell=0; cell<N_SPEC_PIX; cell++ ) {
+		F64 const wl = wl_wlenOfCell ( side, cell );
+
+		if ( cell ) {
+			if ( wl <= prev ) up   = 0;
+			if ( wl >= prev ) down = 0;
+		}
+		prev = wl;
+
+		while ( up && k <= WL_COARSE && wl >= edge ) {
+			wl_coarse[side][k] = cell;
+			k++;
+			edge = wl_coarseEdge ( side, k );
+		}
+	}
+
+	while ( k <= WL_COARSE ) {
+		wl_coarse[side][k++] = N_SPEC_PIX;
+	}
+
+	wl_direction[side] = up ? 1 : ( down ? -1 : 0 );
+}
+
+//	First cell with a wavelength above (strict) or at or above wl,
+//	N_SPEC_PIX if there is none. Wavelengths must be increasing.
+static S16 wl_search ( S16 side, F64 wl, bool strict ) {
+
+	F64 const first = wl_wlenOfCell ( side, 0 );
+	F64 const last  = wl_wlenOfCell ( side, N_SPEC_PIX-1 );
+
+	if ( strict ? wl <  first : wl <= first ) return 0;
+	if ( strict ? wl >= last  : wl >  last  ) return N_SPEC_PIX;
+
+	//	Bracket wl by coarse edges: edge(k) <= wl < edge(k+1)
+	S16 k = (S16)( ( wl - first ) / ( last - first ) * WL_COARSE );
+	if ( k < 0 ) k = 0;
+	if ( k > WL_COARSE-1 ) k = WL_COARSE-1;
+	while ( k > 0 && wl < wl_coarseEdge ( side, k ) ) k--;
+	while ( k < WL_COARSE-1 && wl >= wl_coarseEdge ( side, k+1 ) ) k++;
+
+	S16 lo = wl_coarse[side][k];
+	S16 hi = ( k+1 < WL_COARSE ) ? wl_coarse[side][k+1] : N_SPEC_PIX;	//	Last edge may round below the last cell
+
+	while ( lo < hi ) {
+		S16 const mid = lo + ( hi - lo ) / 2;
+		F64 const wl_mid = wl_wlenOfCell ( side, mid );
+		if ( wl_mid < wl || ( strict && wl_mid == wl ) ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+//	The cell range of a wavelength window:
+//		px_low  = first cell with wl_low <= wavelength  (N_SPEC_PIX-1 if none)
+//		px_high = last  cell with wavelength <= wl_high (0 if none)
+//	Cell 0 is never taken as px_high.
+//	Fails if there are no coefficients or no px_high.
+S16 wl_PixelRange ( S16 side, F64 wl_low, F64 wl_high, S16* px_low, S16* px_high ) {
+
+	if ( side < 0 || side > 1 || wl_NumCoefs(side) < 2 ) return WL_FAIL;
+
+	*px_low  = N_SPEC_PIX-1;
+	*px_high = 0;
+
+	S16 cell;
+
+	switch ( wl_direction[side] ) {
+
+	case 1:
+		cell = wl_search ( side, wl_low, false );
+		if ( cell < N_SPEC_PIX ) *px_low = cell;
+
+		cell = wl_search ( side, wl_high, true ) - 1;
+		if ( cell > 0 ) *px_high = cell;
+		break;
+
+	case -1:
+		if ( wl_wlenOfCell ( side, 0 ) >= wl_low ) *px_low = 0;
+		if ( wl_wlenOfCell ( side, N_SPEC_PIX-1 ) <= wl_high ) *px_high = N_SPEC_PIX-1;
+		break;
+
+	default:
+		for ( cell=0; cell<N_SPEC_PIX; cell++ ) {
+			if ( wl_wlenOfCell ( side, cell ) >= wl_low ) {
+				*px_low = cell;
+				break;
+			}
+		}
+		for ( cell=N_SPEC_PIX-1; cell>0; cell-- ) {
+			if ( wl_wlenOfCell ( side, cell ) <= wl_high ) {
+				*px_high = cell;
+				break;
+			}
+		}
+		break;
+	}
+
+	return *px_high ? WL_OK : WL_FAIL;
+}
+
+S16 wl_PixelRanges ( S16 side, S16 n, F64 const wl_low[], F64 const wl_high[], S16 px_low[], S16 px_high[] ) {
+
+	S16 ok = 0;
+
+	S16 i;
+	for ( i=0; i<n; i++ ) {
+		if ( WL_OK == wl_PixelRange ( side, wl_low[i], wl_high[i], &px_low[i], &px_high[i] ) ) {
+			ok++;
+		}
+	}
+
+	return ok;
+}
+
 
 
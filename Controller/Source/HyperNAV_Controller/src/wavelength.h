@@ -27,4 +27,14 @@ S16 wl_NumCoefs( S16 side );
 F64 wl_GetCoef( S16 side, S16 c );
 U32 wl_GetSN( S16 side );
 
+//	Map a wavelength window to the cells within it,
+//	by binary search if wavelengths are monotonic over the cells.
+//	px_low is the first cell at or above wl_low,
+//	px_high is the last cell at or below wl_high.
+S16 wl_PixelRange ( S16 side, F64 wl_low, F64 wl_high, S16* px_low, S16* px_high );
+
+//	Map n windows at once, e.g., for frame subsampling.
+//	Returns the number of windows mapped successfully.
+S16 wl_PixelRanges ( S16 side, S16 n, F64 const wl_low[], F64 const wl_high[], S16 px_low[], S16 px_high[] );
+
 #endif /* WAVELENGTH_H_ */
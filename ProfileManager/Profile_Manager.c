@@ -21,7 +21,7 @@ static char ProgramRevision   [] = "Revision 0.1  2015-12-03";
 static void print_usage ( char* pn ) {
 
   printf ( "%s\n%s\n", ProgramDescription, ProgramRevision );
-  printf ( "Usage: %s [-h -? -gG -dD] {-l | -a | -tID [-Sk -r{g|b} -P -c{n|g}] | -r | -v }\n", pn );
+  printf ( "Usage: %s [-h -? -gG -dD] {-l | -a | -tID [-Sk -r{g|b} -P -c{n|g} -K] | -r | -v }\n", pn );
   printf ( "       -h, -?  Print this usage message.\n" );
   printf ( "       -gx     Debug (x=D|N|W|E (debug,notice,warn,error)\n" );
   printf ( "       -dD     Use directory D for file I/O, default is working directory\n" );
@@ -35,6 +35,7 @@ static void print_usage ( char* pn ) {
   printf ( "        -C{n|g} Compress (n=do not; g=zlib)\n" );
   printf ( "        -E{n|a} Encode (n=do not; a=ASCII85)\n" );
   printf ( "        -Bnnnn  Burst size; 0: whole packet transfer\n" );
+  printf ( "        -K      Keep intermediate stages (G,B,C,E files)\n" );
   printf ( "       -r      Receive profile\n" );
   printf ( "       -v      Verify code\n" );
 
@@ -76,13 +77,13 @@ int main( int argc, char* argv[] ) {
   //    compression         - zlib is default
   //                          non-use for debugging / testing
   //    burst_size          - 0 == No bursting; else powers of 2 in the 128 to 2048 range
-  transmit_instructions_t tx_instruct = { 32*1024, REP_GRAY, BITPLANE, 0, ZLIB, ASCII85, 0 };
+  transmit_instructions_t tx_instruct = { 32*1024, REP_GRAY, BITPLANE, 0, ZLIB, ASCII85, 0, 0 };
   uint16_t port = 0;
   char*    host_ip = 0;
 
   char opt;
 
-  for ( opterr=0; ( opt = getopt ( argc, argv, "?hg:d:la:t:S:R:QP:C:E:B:rH:p:v" ) ) != EOF ; ) {
+  for ( opterr=0; ( opt = getopt ( argc, argv, "?hg:d:la:t:S:R:QP:C:E:B:KrH:p:v" ) ) != EOF ; ) {
     switch ( opt ) {
     // Print usage
     case '?':
@@ -146,6 +147,8 @@ int main( int argc, char* argv[] ) {
               }
               }
               break;
+    //  Keep intermediate stages of each packet
+    case 'K': tx_instruct.save_stages = 1; break;
     //  Set compression algorithm
     case 'C': switch ( optarg[0] ) {
               case 'g': case 'G': tx_instruct.compression = ZLIB; break;
@@ -11,6 +11,7 @@ gcc \
      -I ../Spectrometer/Source/HyperNAV_Spectrometer/src/ \
      -I ../Controller/Source/HyperNAV_Controller/src/avr32rlib/Utils/Syslog/ \
      ../Controller/Source/HyperNAV_Controller/src/profile_packet.controller.c \
+     ../Controller/Source/HyperNAV_Controller/src/bitplane.c \
      ../Spectrometer/Source/HyperNAV_Spectrometer/src/profile_packet.spectrometer.c \
      ../Controller/Source/HyperNAV_Controller/src/avr32rlib/Utils/Syslog/syslog.c \
      ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/crc32.c \
@@ -26,6 +27,7 @@ gcc \
      code_verify.c \
      profile_acquire.c \
      profile_description.c \
+     packet_process.c \
      Profile_Manager.c \
      profile_receive.c \
      profiles_list.c \
@@ -0,0 +1,33 @@
+#!/bin/sh
+
+#  Build the host benchmark of the profile packet pipeline.
+#
+#  Usage:  sh compile_bench.sh
+#          ./pipeline_bench -w bench_baseline.csv        # record a baseline
+#          ./pipeline_bench -b bench_baseline.csv -x 10  # fail if >10% slower
+#          ./pipeline_bench -c                           # round-trip checks only
+#          ./pipeline_bench -T -i 30                     # by-value vs ping-pong staging, MXHNV spectra
+#          ./pipeline_bench -G                           # gray code decoding per pixel
+
+gcc \
+     -O2 -march=native \
+     -DFW_SIMULATION \
+     -o pipeline_bench \
+     -I ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8 \
+     -I ../Shared/FirmwareDefinitions \
+     -I ../Controller/Source/HyperNAV_Controller/src/ \
+     -I ../Controller/Source/HyperNAV_Controller/src/avr32rlib/Utils/Syslog/ \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/crc32.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/adler32.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/deflate.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inflate.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/trees.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inftrees.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inffast.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/zutil.c \
+     ../Controller/Source/HyperNAV_Controller/src/bitplane.c \
+     profile_packet.c \
+     packet_process.c \
+     sensor_data.c \
+     harness_common.c \
+     pipeline_bench.c
@@ -0,0 +1,47 @@
+#!/bin/sh
+
+#  Build the end-to-end test of the burst framing: binary bursts when
+#  the float offers them and the path is 8 bit clean, else ASCII bursts
+#  with the packet data ASCII85 encoded.
+#
+#  framing_e2e forks one receiver. Per profile, a float on the modem layer
+#  of the FirmwareSimulator (modem.c, as is) calls over a pseudo-tty, which
+#  the relay of rudicsd (relay.cpp, as is) connects to a login tty, whose
+#  session connects to the receiver. The login tty is raw, cooked (CR to NL,
+#  XON/XOFF) or strips the 8th bit. Per cell, it reports the framing used
+#  and the bytes on the wire per profile.
+#
+#  Usage:  sh compile_framing_e2e.sh
+#          ./framing_e2e                                 # 4 profiles of 8 packets
+#          ./framing_e2e -m 2 -k 20 -b 1200 -t 1000
+
+ZLIB=../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8
+
+gcc \
+     -O2 \
+     -DFW_SIMULATION \
+     -DTXRXERRORRATE=0 \
+     -o framing_e2e \
+     -I $ZLIB \
+     -I ../Shared/FirmwareDefinitions \
+     -I ../Controller/Source/HyperNAV_Controller/src/ \
+     -I ../Controller/Source/HyperNAV_Controller/src/avr32rlib/Utils/Syslog/ \
+     -I ../rudics/FirmwareSimulator \
+     -I ../rudics/rudicsd-server \
+     $ZLIB/crc32.c \
+     $ZLIB/adler32.c \
+     $ZLIB/deflate.c \
+     $ZLIB/inflate.c \
+     $ZLIB/trees.c \
+     $ZLIB/inftrees.c \
+     $ZLIB/inffast.c \
+     $ZLIB/zutil.c \
+     ../Controller/Source/HyperNAV_Controller/src/bitplane.c \
+     ../Controller/Source/HyperNAV_Controller/src/burst_transfer.c \
+     profile_packet.c \
+     profile_receive.c \
+     ../rudics/FirmwareSimulator/modem.c \
+     harness_common.c \
+     framing_e2e.c \
+     -x c++ ../rudics/rudicsd-server/relay.cpp -x none \
+     -lstdc++ -lutil -lm
@@ -0,0 +1,39 @@
+#!/bin/sh
+
+#  Build the load test of the profile receiver.
+#  Forks one receiver and N float transmitters on the loopback interface,
+#  then checks that every packet was received byte-identical.
+#
+#  The receiver is built with its TXRXERRORRATE hook, corrupting
+#  received characters at the given rate (default 1e-5 per character),
+#  so that bursts fail their CRC and arrive again out of order.
+#
+#  With -x, the link of each float is cut at random offsets, and the float
+#  calls again to resume from the bursts the receiver reports held.
+#  Without other losses, each cut may cost at most the burst it cut short and one burst 0.
+#
+#  Usage:  sh compile_receive_load.sh
+#          TXRXERRORRATE=0 sh compile_receive_load.sh   # no corruption
+#          ./receive_load -n 32 -k 12 -e 0.05 -r 0.05 -z 0.5
+#          ./receive_load -n 16 -k 20 -x 7 -e 0            # resume after cut links
+
+gcc \
+     -O2 \
+     -DFW_SIMULATION \
+     -DTXRXERRORRATE=${TXRXERRORRATE:-1e-5} \
+     -o receive_load \
+     -I ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8 \
+     -I ../Shared/FirmwareDefinitions \
+     -I ../Controller/Source/HyperNAV_Controller/src/ \
+     -I ../Controller/Source/HyperNAV_Controller/src/avr32rlib/Utils/Syslog/ \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/crc32.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/adler32.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/deflate.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inflate.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/trees.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inftrees.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inffast.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/zutil.c \
+     profile_receive.c \
+     harness_common.c \
+     receive_load.c
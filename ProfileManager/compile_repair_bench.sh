@@ -0,0 +1,41 @@
+#!/bin/sh
+
+#  Build the benchmark of the repair bursts: XOR parity over the data
+#  bursts of a packet, from which the receiver rebuilds a lost burst
+#  without asking for it again.
+#
+#  repair_bench forks one receiver, and sends it profiles from one float
+#  at a time, losing data and repair bursts at the given rates. Per number
+#  of repair bursts and burst loss, it reports the parity overhead against
+#  the share of lost bursts rebuilt and of packets needing no resend.
+#
+#  Usage:  sh compile_repair_bench.sh
+#          ./repair_bench                                # 8 bursts of 1024 bytes
+#          ./repair_bench -F 0,1,2,4 -L 0.02,0.1 -n 8 -B 2048
+#          ./repair_bench -F 0,2 -w 4                    # with a window of 4
+
+ZLIB=../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8
+
+gcc \
+     -O2 \
+     -DFW_SIMULATION \
+     -DTXRXERRORRATE=0 \
+     -o repair_bench \
+     -I $ZLIB \
+     -I ../Shared/FirmwareDefinitions \
+     -I ../Controller/Source/HyperNAV_Controller/src/ \
+     -I ../Controller/Source/HyperNAV_Controller/src/avr32rlib/Utils/Syslog/ \
+     $ZLIB/crc32.c \
+     $ZLIB/adler32.c \
+     $ZLIB/deflate.c \
+     $ZLIB/inflate.c \
+     $ZLIB/trees.c \
+     $ZLIB/inftrees.c \
+     $ZLIB/inffast.c \
+     $ZLIB/zutil.c \
+     ../Controller/Source/HyperNAV_Controller/src/bitplane.c \
+     profile_packet.c \
+     profile_receive.c \
+     harness_common.c \
+     repair_bench.c \
+     -lm
@@ -0,0 +1,54 @@
+#!/bin/sh
+
+#  Build the goodput matrix of the sliding window transmission,
+#  and the link emulator it runs each float through.
+#
+#  link_emulator is a userspace TCP proxy: it delays each direction and
+#  corrupts bytes at a given rate, so that bursts fail their CRC.
+#  It can also be put between the FirmwareSimulator and rudicsd.
+#
+#  window_matrix forks one receiver per byte error rate, one link emulator
+#  per combination of round trip time, burst loss, window, error rate and
+#  burst mode, and one float per combination, all at once. The float runs
+#  the controller's burst_transfer.c, as its profile_manager.c does, window 0
+#  being one burst per step as before, burst mode 1 its adaptive burst size.
+#  The receivers are built with their TXRXERRORRATE hook, set per receiver.
+#
+#  Usage:  sh compile_window_matrix.sh
+#          ./window_matrix                           # 300 bytes/s, 4096 byte bursts
+#          ./window_matrix -r 1200 -R 250,2000 -L 0,0.1 -W 0,4
+#          ./window_matrix -R 1000 -L 0 -W 4 -E 0,1e-5,1e-4,3e-4 -A 0,1 -k 8
+#          ./window_matrix -k 4 -s 7 -r 4800 -R 500 -L 0.5 -W 4 -A 0,1 -X
+#                  # large packets on a lossy link: adaptive bursts must come down
+#          ./link_emulator -l 43211 -c 127.0.0.1:43210 -d 600 -e 1e-5
+
+ZLIB=../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8
+
+gcc \
+     -O2 -Wall \
+     -o link_emulator \
+     link_emulator.c \
+     -lm
+
+gcc \
+     -O2 \
+     -DFW_SIMULATION \
+     -DTXRXERRORRATE=0 \
+     -o window_matrix \
+     -I $ZLIB \
+     -I ../Shared/FirmwareDefinitions \
+     -I ../Controller/Source/HyperNAV_Controller/src/ \
+     -I ../Controller/Source/HyperNAV_Controller/src/avr32rlib/Utils/Syslog/ \
+     $ZLIB/crc32.c \
+     $ZLIB/adler32.c \
+     $ZLIB/deflate.c \
+     $ZLIB/inflate.c \
+     $ZLIB/trees.c \
+     $ZLIB/inftrees.c \
+     $ZLIB/inffast.c \
+     $ZLIB/zutil.c \
+     ../Controller/Source/HyperNAV_Controller/src/burst_transfer.c \
+     profile_receive.c \
+     harness_common.c \
+     window_matrix.c \
+     -lm
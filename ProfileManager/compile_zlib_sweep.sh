@@ -0,0 +1,29 @@
+#!/bin/sh
+
+#  Build the zlib parameter sweep.
+#  Compresses packets with every level/windowBits/memLevel/strategy
+#  and reports output size, peak zlib heap and CPU time.
+#
+#  Usage:  sh compile_zlib_sweep.sh
+#          ./zlib_sweep -n 16 > sweep.csv          # simulated packets
+#          ./zlib_sweep -t DATA/0770/16291/*.P*    # recorded packets, per heap budget
+
+gcc \
+     -O2 \
+     -DFW_SIMULATION \
+     -o zlib_sweep \
+     -I ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8 \
+     -I ../Shared/FirmwareDefinitions \
+     -I ../Controller/Source/HyperNAV_Controller/src/ \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/crc32.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/adler32.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/deflate.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inflate.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/trees.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inftrees.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/inffast.c \
+     ../Spectrometer/Source/HyperNAV_Spectrometer/src/avr32rlib/Utils/zlib-1.2.8/zutil.c \
+     ../Controller/Source/HyperNAV_Controller/src/bitplane.c \
+     profile_packet.c \
+     sensor_data.c \
+     zlib_sweep.c
@@ -0,0 +1,691 @@
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <pty.h>
+# include <signal.h>
+# include <stdbool.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <termios.h>
+# include <time.h>
+# include <unistd.h>
+
+# include <arpa/inet.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/mman.h>
+# include <sys/socket.h>
+# include <sys/types.h>
+# include <sys/wait.h>
+
+# include "zlib.h"
+
+# include "profile_packet.h"
+# include "profile_receive.h"
+# include "syslog.h"
+# include "modem.h"
+# include "relay.h"
+# include "burst_transfer.h"
+# include "harness_common.h"
+
+static char ProgramDescription[] = "HyperNav Burst Framing End-to-End Test [Satlantic]";
+static char ProgramRevision   [] = "Revision 0.1  2026-10-17";
+
+/******************************
+ *  Function: Print usage
+ */
+static void print_usage ( char* pn ) {
+
+  printf ( "%s\n%s\n", ProgramDescription, ProgramRevision );
+  printf ( "Usage: %s [-h -? -mM -kK -sS -BB -bB -tT -pP -dD -gx]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -mM     Profiles per cell [default: 4]\n" );
+  printf ( "       -kK     Data packets per profile, 1..99 [default: 8]\n" );
+  printf ( "       -sS     Spectra per data packet, 1..%d [default: %d]\n", MXHNV, MXHNV );
+  printf ( "       -BB     Burst size [default: 4096]\n" );
+  printf ( "       -bB     Modem baud rate, for the transfer time [default: 2400]\n" );
+  printf ( "       -tT     Wait for a MODE reply, ms [default: 5000]\n" );
+  printf ( "       -pP     Receiver port [default: 43510]\n" );
+  printf ( "       -dD     Directory for received packets [default: mkdtemp]\n" );
+  printf ( "       -gx     Receiver log level (x=D|I|N|W|E) [default: W]\n" );
+  printf ( "A float on the modem layer of the FirmwareSimulator calls through the\n" );
+  printf ( "relay of rudicsd into a login tty, from which the receiver is reached.\n" );
+  printf ( "Per cell of binary framing offered or not, and a login tty that is\n" );
+  printf ( "raw, cooked (CR to NL, XON/XOFF) or 7 bit: the framing used, and per\n" );
+  printf ( "profile the packet bytes, the bytes on the wire to and from shore,\n" );
+  printf ( "and the time to shore at the baud rate.\n" );
+  printf ( "Exits 1 if a packet is not received byte-identical.\n" );
+}
+
+/******************************
+ *  Login ttys of the rudics server
+ */
+typedef enum { TTY_RAW, TTY_COOKED, TTY_7BIT, TTY_KINDS } e2e_tty_t;
+
+static const char* const tty_name[TTY_KINDS] = { "raw", "cooked", "7bit" };
+
+//  Per call, shared by the float, the relay and the harness
+//
+typedef struct e2e_call {
+  RelayStats relay;
+  int        binary;        //  framing used by the float
+  int        rv;            //  of the float
+  size_t     packet_bytes;  //  of the profile, as stored on the float
+} e2e_call_t;
+
+/******************************
+ *  Float side: bursts as sent by the profile manager firmware
+ *  over the modem, in the framing agreed by pmg_mode_negotiate()
+ */
+typedef struct e2e_packet {
+  unsigned char* bytes;     //  Packet content following HYNV_num/PROF_num/PCKT_num, as stored
+  uint16_t       size;
+  uint16_t       sent_size; //  in the framing of the call
+  unsigned char* saved;     //  as the receiver is to save it
+  size_t         saved_size;
+  uint16_t       num_bursts;
+  char           acked;
+} e2e_packet_t;
+
+typedef struct e2e_float {
+  uint16_t       hynv;
+  uint16_t       prof;
+  int            binary;
+  int            reply_ms;
+  int32_t        mode_reply[2];
+  char           line[4096];
+  size_t         have;
+} e2e_float_t;
+
+static int e2e_send ( const void* data, int size ) {
+  return size != MDM_putbuf ( data, size, 5+size/180 );
+}
+
+//  As pmg_burst_send()
+//
+static int e2e_frame ( e2e_float_t* f, int p, int b, int value, const unsigned char* data, int sz ) {
+
+  unsigned char header[40];
+  int header_len = 24;
+
+  if ( f->binary ) {
+    data_packet_burst_header14 ( f->hynv, f->prof, p, ( b < 0 ) ? BRSB_END : b, value, header );
+    header_len = BRSB_HEADER;
+  } else if ( b < 0 ) {
+    snprintf ( (char*)header, 25, "BRST%04hu%05hu%04dZZZZZZZ", f->hynv, f->prof, p );
+  } else {
+    snprintf ( (char*)header, 25, "BRST%04hu%05hu%04d%03d%04d", f->hynv, f->prof, p, b, value );
+  }
+
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, header, header_len );
+  if ( sz ) crc = crc32 ( crc, data, sz );
+
+  unsigned char trailer[9];
+  if ( f->binary ) {
+    int i;
+    for ( i=0; i<4; i++ ) trailer[i] = (unsigned char) ( crc >> (24-8*i) );
+    return e2e_send ( header, header_len ) || ( sz && e2e_send ( data, sz ) ) || e2e_send ( trailer, 4 );
+  }
+  snprintf ( (char*)trailer, 9, "%08lX", crc );
+  return e2e_send ( header, header_len ) || e2e_send ( trailer, 8 ) || ( sz && e2e_send ( data, sz ) );
+}
+
+//  Bytes from .. from+sz-1 of a data packet as sent: in ASCII framing,
+//  the header marked ASCII85 encoded and the data encoded, as
+//  data_packet_ascii85_bytes() does
+//
+static void e2e_sent_bytes ( e2e_float_t* f, e2e_packet_t* pk, int p, uint16_t from, uint16_t sz, unsigned char* out ) {
+
+  if ( f->binary || 0 == p ) {
+    memcpy ( out, pk->bytes+from, sz );
+    return;
+  }
+
+  unsigned char head[33];
+  char numString[8];
+  memcpy ( head, pk->bytes, 32 );
+  head[19] = 'A';
+  snprintf ( numString, 7, "%6hu", data_packet_ascii85_size ( pk->size - 32 ) );
+  memcpy ( head+26, numString, 6 );
+
+  uint16_t n = 0;
+  if ( from < 32 ) {
+    n = ( 32-from < sz ) ? 32-from : sz;
+    memcpy ( out, head+from, n );
+  }
+  if ( n < sz ) {
+    data_packet_ascii85_range ( pk->bytes+32, pk->size-32, from+n-32, sz-n, out+n );
+  }
+}
+
+//  Split into equal bursts of at most burst_size, as pmg_profile_transmission()
+//
+static void e2e_split ( e2e_float_t* f, e2e_packet_t* pk, int p, int burst_size ) {
+
+  pk->sent_size = ( f->binary || 0 == p ) ? pk->size : 32 + data_packet_ascii85_size ( pk->size - 32 );
+
+  int nB = bt_burst_count ( pk->sent_size, burst_size );
+  if ( 1 + ( pk->sent_size - 1 ) / nB > BRSB_MAX_DATA ) nB = bt_burst_count ( pk->sent_size, BRSB_MAX_DATA );
+  pk->num_bursts = nB;
+}
+
+//  Burst 0: header only, value = number of bursts
+//  Burst b: header and data, value = size of data
+//  Burst nB+1: terminator, header only
+//
+static int e2e_burst ( e2e_float_t* f, e2e_packet_t* pk, int p, int b ) {
+
+  if ( b > pk->num_bursts ) return e2e_frame ( f, p, -1, 0, 0, 0 );
+  if ( 0 == b )             return e2e_frame ( f, p,  0, pk->num_bursts, 0, 0 );
+
+  int const bsize = 1 + ( pk->sent_size - 1 ) / pk->num_bursts;
+  int const from  = (b-1)*bsize;
+  int const sz    = ( b < pk->num_bursts ) ? bsize : pk->sent_size - from;
+
+  unsigned char data[BRSB_MAX_DATA];
+  e2e_sent_bytes ( f, pk, p, from, sz, data );
+  return e2e_frame ( f, p, b, sz, data, sz );
+}
+
+//  Replies of the receiver, one per line. Resends requested bursts,
+//  followed by the terminating burst of their packet.
+//  Returns -1 if the link is gone.
+//
+static int e2e_replies ( e2e_float_t* f, e2e_packet_t* pk, int num_packets, int ms ) {
+
+  int n = MDM_getn ( f->line + f->have, 1, ms );
+  if ( n < 0 ) return -1;
+  if ( 0 == n ) return 0;
+  f->have++;
+
+  int more = MDM_IBytes();
+  if ( more > (int)( sizeof(f->line)-1-f->have ) ) more = sizeof(f->line)-1-f->have;
+  if ( more > 0 && 0 < ( n = MDM_getn ( f->line + f->have, more, 0 ) ) ) f->have += n;
+  f->line[f->have] = 0;
+
+  char resent[100];
+  memset ( resent, 0, sizeof(resent) );
+
+  char* start = f->line;
+  char* eol;
+  while ( ( eol = strstr ( start, "\r\n" ) ) ) {
+    *eol = 0;
+
+    char type[5];
+    uint16_t h, prof, p, value;
+    unsigned int crc;
+    if ( 6 == sscanf ( start, "%4[A-Z],%hu,%hu,%hu,%hu,%8X", type, &h, &prof, &p, &value, &crc )
+      && h == f->hynv && prof == f->prof ) {
+
+      uLong calc = crc32 ( 0L, Z_NULL, 0 );
+            calc = crc32 ( calc, (Bytef*)start, 25 );
+      if ( calc == crc ) {
+        if ( 0 == strcmp ( type, "MODE" ) ) {
+          if ( p < 2 ) f->mode_reply[p] = value;
+        } else if ( p > num_packets ) {
+          ;
+        } else if ( 0 == strcmp ( type, "RXED" ) ) {
+          pk[p].acked = 1;
+        } else if ( 0 == strcmp ( type, "RSND" ) ) {
+          int b;
+          for ( b=1; b<=pk[p].num_bursts; b++ ) {
+            if ( 999 != value && b != value ) continue;
+            if ( e2e_burst ( f, pk+p, p, b ) ) return -1;
+            resent[p] = 1;
+          }
+        }
+      }
+    }
+    start = eol+2;
+  }
+
+  f->have -= ( start - f->line );
+  memmove ( f->line, start, f->have );
+
+  int p;
+  for ( p=0; p<=num_packets; p++ ) {
+    if ( resent[p] && e2e_burst ( f, pk+p, p, pk[p].num_bursts+1 ) ) return -1;
+  }
+  return 0;
+}
+
+static int e2e_mode_wait ( e2e_float_t* f, int step ) {
+  double const until = now_s() + 0.001*f->reply_ms;
+  while ( f->mode_reply[step] < 0 && now_s() < until ) {
+    if ( e2e_replies ( f, 0, -1, 100 ) ) return 0;
+  }
+  return f->mode_reply[step] >= 0;
+}
+
+//  As pmg_mode_negotiate()
+//
+static void e2e_mode_negotiate ( e2e_float_t* f ) {
+
+  f->binary        = 0;
+  f->mode_reply[0] = -1;
+  f->mode_reply[1] = -1;
+
+  char offer[33];
+  snprintf ( offer, 25, "MODE%04hu%05hu0000%03hu0000", f->hynv, f->prof, (uint16_t)BRST_MODE_BINARY );
+
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, (Bytef*)offer, 24 );
+  snprintf ( offer+24, 9, "%08lX", crc );
+
+  if ( e2e_send ( offer, 32 ) ) return;
+
+  if ( !e2e_mode_wait ( f, 0 ) || !( BRST_MODE_BINARY & f->mode_reply[0] ) ) return;
+
+  unsigned char probe[BRSB_HEADER + 256];
+  int i;
+  for ( i=0; i<256; i++ ) {
+    probe[BRSB_HEADER+i] = (unsigned char)( 255-i );
+  }
+
+  f->binary = 1;
+  if ( e2e_frame ( f, 0, BRSB_PROBE, 256, probe+BRSB_HEADER, 256 ) ) {
+    f->binary = 0;
+    return;
+  }
+  f->binary = e2e_mode_wait ( f, 1 ) && 1 == f->mode_reply[1];
+}
+
+//  The profile of a float: the info packet 0, then K packets of
+//  S spectra and their auxiliary data, gray coded, in bitplanes and
+//  compressed as on the controller
+//
+static int make_profile ( e2e_packet_t* pk, int num_packets, int num_spectra, uint16_t hynv, unsigned int seed ) {
+
+  int p;
+
+  memset ( pk, 0, (num_packets+1)*sizeof(e2e_packet_t) );
+
+  pk[0].size  = 4*4 + 4*4 + BEGPAK_META;
+  pk[0].bytes = malloc ( pk[0].size+1 );
+  pk[0].saved = pk[0].bytes;
+  pk[0].saved_size = pk[0].size;
+  if ( !pk[0].bytes ) return 1;
+  snprintf ( (char*)pk[0].bytes, 33, "%04d%04d%04d%04d%04d%04d%04d%04d",
+             num_packets*num_spectra, 0, 0, 0, num_packets, 0, 0, 0 );
+  memset ( pk[0].bytes+32, '_', BEGPAK_META );
+
+  for ( p=1; p<=num_packets; p++ ) {
+
+    Profile_Data_Packet_t* unc = calloc ( 1, sizeof(Profile_Data_Packet_t) );
+    Profile_Data_Packet_t* bp  = calloc ( 1, sizeof(Profile_Data_Packet_t) );
+    Profile_Data_Packet_t* com = calloc ( 1, sizeof(Profile_Data_Packet_t) );
+    if ( !unc || !bp || !com ) return 1;
+
+    char header[40];
+    snprintf ( header, 33, "S SATYLU%04hu%04dBN0N            ", hynv, num_spectra );
+    memcpy ( &unc->header, header, 32 );
+
+    int s, i;
+    for ( s=0; s<num_spectra; s++ ) {
+      double const peak = 20000 + 2000*s + 500*p;
+      uint8_t* const pix = unc->contents.structured.sensor_data.bitplanes + 2*s*N_SPEC_PIX;
+      for ( i=0; i<N_SPEC_PIX; i++ ) {
+        double const x = ( i - 0.45*N_SPEC_PIX ) / ( 0.3*N_SPEC_PIX );
+        int const v = 500 + (int)( peak / ( 1 + x*x ) ) + rand_r(&seed) % 16;
+        pix[2*i  ] = (uint8_t) ( v >> 8 );
+        pix[2*i+1] = (uint8_t) ( v & 0xFF );
+      }
+    }
+    for ( i=0; i<num_spectra*SPEC_AUX_SERIAL_SIZE; i++ ) {
+      unc->contents.structured.aux_data.spec_serial[i] = (uint8_t) rand_r(&seed);
+    }
+
+    if ( data_packet_bin2gray ( unc, unc )
+      || data_packet_bitplane ( unc, bp, 0 )
+      || data_packet_compress ( bp, com, 'G' ) ) return 1;
+    free ( unc );
+
+    //  The receiver saves the packet inflated: bitplanes, then auxiliary data
+    pk[p].saved_size = 32 + num_spectra*(2*N_SPEC_PIX + SPEC_AUX_SERIAL_SIZE);
+    pk[p].saved      = (unsigned char*) bp;
+    memmove ( bp->contents.flat_bytes + num_spectra*2*N_SPEC_PIX,
+              bp->contents.structured.aux_data.spec_serial, num_spectra*SPEC_AUX_SERIAL_SIZE );
+    memcpy  ( bp->header.compressed_sz, "      ", 6 );
+    memcpy  ( bp->header.encoded_sz,    "      ", 6 );
+    memmove ( pk[p].saved, &bp->header, pk[p].saved_size );
+
+    pk[p].size  = 32 + atoi ( com->header.compressed_sz );
+    pk[p].bytes = (unsigned char*) com;
+    memmove ( pk[p].bytes, &com->header, pk[p].size );
+  }
+  return 0;
+}
+
+//  One call of the float: log in, negotiate the framing if offering it,
+//  send every packet once and then what the receiver asks for.
+//
+static int float_call ( const char* tty, int ready, uint16_t hynv, uint16_t prof, int offer, int reply_ms,
+                        e2e_packet_t* pk, int num_packets, int burst_size, int* binary ) {
+
+  e2e_float_t f;
+  memset ( &f, 0, sizeof(f) );
+  f.hynv     = hynv;
+  f.prof     = prof;
+  f.reply_ms = reply_ms;
+
+  char login[8];
+  snprintf ( login, sizeof(login), "f%04hu", hynv );
+
+  //  The inherited slave stays open until the modem has its own
+  if ( MDM_open_serial_port ( (char*)tty, 19200 ) ) return 1;
+  if ( 1 != write ( ready, "", 1 ) ) return 1;
+  close ( ready );
+
+  if ( 0 >= MDM_expect ( "login: ", login, 10, "\r" ) ) return 1;
+
+  if ( offer ) e2e_mode_negotiate ( &f );
+  *binary = f.binary;
+
+  int p, b;
+  for ( p=0; p<=num_packets; p++ ) {
+
+    e2e_packet_t* const k = pk+p;
+    e2e_split ( &f, k, p, burst_size );
+
+    for ( b=0; b<=k->num_bursts+1; b++ ) {
+      if ( e2e_burst ( &f, k, p, b ) ) return 1;
+    }
+
+    double const until = now_s() + 20;
+    while ( !k->acked && now_s() < until ) {
+      if ( e2e_replies ( &f, pk, num_packets, 100 ) ) return 1;
+    }
+    if ( !k->acked ) return 1;
+  }
+  return 0;
+}
+
+/******************************
+ *  Shore side
+ */
+static int write_all ( int fd, const char* p, ssize_t size ) {
+  while ( size > 0 ) {
+    ssize_t n = write ( fd, p, size );
+    if ( n < 0 ) {
+      if ( EINTR == errno ) continue;
+      return 1;
+    }
+    p += n; size -= n;
+  }
+  return 0;
+}
+
+//  The login session on the tty: prompt for the login name,
+//  then pass everything between the tty and the receiver
+//
+static int login_bridge ( int tty, uint16_t port ) {
+
+  char buf[8192];
+  ssize_t have = 0, n;
+  char* eol = 0;
+
+  if ( write_all ( tty, "\r\nlogin: ", 9 ) ) return 1;
+
+  while ( !eol ) {
+    if ( have >= (ssize_t)sizeof(buf) - 1 ) return 1;
+    if ( 0 >= ( n = read ( tty, buf+have, sizeof(buf)-1-have ) ) ) return 1;
+    have += n;
+    buf[have] = 0;
+    eol = strpbrk ( buf, "\r\n" );
+  }
+
+  int const sock = connect_port ( port, 1 );
+  if ( sock < 0 ) return 1;
+
+  //  Bytes that came after the login name
+  if ( write_all ( sock, eol+1, buf+have - (eol+1) ) ) return 1;
+
+  for ( ;; ) {
+    struct pollfd pfd[2] = { { tty, POLLIN, 0 }, { sock, POLLIN, 0 } };
+    if ( poll ( pfd, 2, -1 ) < 0 ) {
+      if ( EINTR == errno ) continue;
+      break;
+    }
+    if ( pfd[0].revents ) {
+      if ( 0 >= ( n = read ( tty, buf, sizeof(buf) ) ) || write_all ( sock, buf, n ) ) break;
+    }
+    if ( pfd[1].revents ) {
+      if ( 0 >= ( n = read ( sock, buf, sizeof(buf) ) ) || write_all ( tty, buf, n ) ) break;
+      int one = 1;
+      setsockopt ( sock, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one) );
+    }
+  }
+  close ( sock );
+  return 0;
+}
+
+//  Login tty settings: raw; cooked as a getty leaves it for a shell,
+//  without echo and line editing, but with CR to NL and XON/XOFF;
+//  7 bit is cooked and stripping the 8th bit.
+//
+static void tty_settings ( int fd, e2e_tty_t kind ) {
+
+  struct termios t;
+  tcgetattr ( fd, &t );
+  if ( TTY_RAW == kind ) {
+    cfmakeraw ( &t );
+  } else {
+    t.c_lflag &= ~( ICANON | ECHO | ECHONL | ISIG | IEXTEN );
+    t.c_oflag &= ~OPOST;
+    t.c_iflag |= ICRNL | IXON;
+    if ( TTY_7BIT == kind ) t.c_iflag |= ISTRIP;
+    t.c_cc[VMIN]  = 1;
+    t.c_cc[VTIME] = 0;
+  }
+  tcsetattr ( fd, TCSANOW, &t );
+}
+
+//  One call: the float on the serial line A, the relay of rudicsd between
+//  A and the login tty B, the login session on B connecting to the receiver
+//
+static int profile_call ( uint16_t port, const char* rx_dir, e2e_tty_t kind, int offer, int reply_ms,
+                          uint16_t hynv, uint16_t prof, int num_packets, int num_spectra, int burst_size,
+                          e2e_call_t* call ) {
+
+  e2e_packet_t pk[100];
+  if ( make_profile ( pk, num_packets, num_spectra, hynv, prof ) ) return 1;
+
+  memset ( call, 0, sizeof(*call) );
+  call->rv = 1;
+
+  struct termios raw;
+  memset ( &raw, 0, sizeof(raw) );
+  cfmakeraw ( &raw );
+
+  int am, as, bm, bs;
+  char a_name[128];
+  if ( openpty ( &am, &as, a_name, &raw, 0 ) ) return 1;
+  if ( openpty ( &bm, &bs, 0, 0, 0 ) ) {
+    close ( am ); close ( as );
+    return 1;
+  }
+  tty_settings ( bs, kind );
+
+  fflush ( stdout );
+  fflush ( stderr );
+
+  //  The modem flushes its input when opened: the call is answered,
+  //  and the login prompt sent, once the float has it open
+  int ready[2];
+  if ( pipe ( ready ) ) return 1;
+
+  pid_t const float_pid = fork();
+  if ( 0 == float_pid ) {
+    close ( am ); close ( bm ); close ( bs ); close ( ready[0] );
+    int binary = 0;
+    int const rv = float_call ( a_name, ready[1], hynv, prof, offer, reply_ms, pk, num_packets, burst_size, &binary );
+    close ( as );
+    call->binary = binary;
+    call->rv     = rv;
+    _exit ( rv );
+  }
+  close ( ready[1] );
+  char c;
+  ssize_t const opened = read ( ready[0], &c, 1 );
+  close ( ready[0] );
+
+  pid_t relay_pid = -1, bridge_pid = -1;
+
+  if ( 1 == opened ) {
+    relay_pid = fork();
+    if ( 0 == relay_pid ) {
+      close ( as ); close ( bs );
+      _exit ( relay ( am, bm, false, &call->relay ) ? 1 : 0 );
+    }
+
+    bridge_pid = fork();
+    if ( 0 == bridge_pid ) {
+      close ( am ); close ( as ); close ( bm );
+      _exit ( login_bridge ( bs, port ) );
+    }
+  }
+
+  close ( am ); close ( as ); close ( bm ); close ( bs );
+
+  waitpid ( float_pid, 0, 0 );
+  if ( relay_pid  > 0 ) waitpid ( relay_pid,  0, 0 );
+  if ( bridge_pid > 0 ) waitpid ( bridge_pid, 0, 0 );
+
+  int rv = call->rv, p;
+  if ( rv ) fprintf ( stderr, "%04hu %05hu: transfer failed\n", hynv, prof );
+
+  for ( p=0; p<=num_packets; p++ ) {
+    if ( !rv && compare_packet ( rx_dir, hynv, prof, p, pk[p].saved, pk[p].saved_size ) ) {
+      fprintf ( stderr, "%04hu %05hu %02d received not as sent\n", hynv, prof, p );
+      rv = 1;
+    }
+  }
+  for ( p=0; p<=num_packets; p++ ) {
+    call->packet_bytes += pk[p].size;
+    if ( p ) free ( pk[p].saved );
+    free ( pk[p].bytes );
+  }
+  return rv;
+}
+
+int main( int argc, char* argv[] ) {
+
+  int      num_profiles = 4;
+  int      num_packets  = 8;
+  int      num_spectra  = MXHNV;
+  int      burst_size   = 4096;
+  int      baud         = 2400;
+  int      reply_ms     = 5000;
+  uint16_t port         = 43510;
+  char*    dir          = 0;
+
+  int opt;
+
+  for ( opterr=0; ( opt = getopt ( argc, argv, "?hm:k:s:B:b:t:p:d:g:" ) ) != EOF ; ) {
+    switch ( opt ) {
+    case '?':
+    case 'h': print_usage(argv[0]); return 0;
+    case 'm': num_profiles = atoi ( optarg ); break;
+    case 'k': num_packets  = atoi ( optarg ); break;
+    case 's': num_spectra  = atoi ( optarg ); break;
+    case 'B': burst_size   = atoi ( optarg ); break;
+    case 'b': baud         = atoi ( optarg ); break;
+    case 't': reply_ms     = atoi ( optarg ); break;
+    case 'p': port         = atoi ( optarg ); break;
+    case 'd': dir          = optarg; break;
+    case 'g': switch ( optarg[0] ) {
+              case 'd': case 'D': syslog_setVerbosity( SYSLOG_DEBUG   ); break;
+              case 'i': case 'I': syslog_setVerbosity( SYSLOG_INFO    ); break;
+              case 'n': case 'N': syslog_setVerbosity( SYSLOG_NOTICE  ); break;
+              case 'w': case 'W': syslog_setVerbosity( SYSLOG_WARNING ); break;
+              case 'e': case 'E': syslog_setVerbosity( SYSLOG_ERROR   ); break;
+              }
+              break;
+    default : fprintf ( stderr, "%s: Ignoring unknown '-%c' option\n", argv[0], opt ); break;
+    }
+  }
+
+  if ( num_profiles < 1 || num_profiles > 999 || num_packets < 1 || num_packets > 99
+    || num_spectra < 1 || num_spectra > MXHNV || burst_size < 128 || burst_size > BRSB_MAX_DATA
+    || baud < 300 || reply_ms < 100 ) {
+    print_usage ( argv[0] );
+    return 2;
+  }
+
+  char tmpdir[] = "/tmp/framing_e2e_XXXXXX";
+  if ( !dir ) {
+    if ( !( dir = mkdtemp ( tmpdir ) ) ) {
+      perror ( "mkdtemp" );
+      return 2;
+    }
+  }
+
+  e2e_call_t* call = mmap ( 0, sizeof(e2e_call_t), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0 );
+  if ( MAP_FAILED == call ) {
+    perror ( "mmap" );
+    return 2;
+  }
+
+  fflush ( stdout );
+
+  pid_t receiver = fork();
+  if ( 0 == receiver ) {
+    _exit ( profile_receive ( dir, port ) );
+  }
+
+  int tries;
+  for ( tries=0; tries<50; tries++ ) {
+    int fd = connect_port ( port, 1 );
+    if ( fd >= 0 ) { close ( fd ); break; }
+    usleep ( 100000 );
+  }
+  if ( 50 == tries ) {
+    fprintf ( stderr, "Receiver does not listen on port %hu\n", port );
+    kill ( receiver, SIGTERM );
+    waitpid ( receiver, 0, 0 );
+    return 2;
+  }
+
+  printf ( "offer,tty,framing,profiles,packet_bytes,to_shore_bytes,to_shore_overhead,to_float_bytes,seconds_at_baud,received\n" );
+
+  int failures = 0;
+  int offer, kind, m;
+  uint16_t prof = 1;
+
+  for ( offer=0; offer<=1; offer++ ) {
+    for ( kind=0; kind<TTY_KINDS; kind++ ) {
+
+      double packet_bytes = 0, to_shore = 0, to_float = 0;
+      int binary = 0, cell_failures = 0;
+
+      for ( m=0; m<num_profiles; m++ ) {
+        if ( profile_call ( port, dir, kind, offer, reply_ms, 876, prof++,
+                            num_packets, num_spectra, burst_size, call ) ) {
+          cell_failures++;
+        }
+        packet_bytes += call->packet_bytes;
+        to_shore     += call->relay.rem2loc;
+        to_float     += call->relay.loc2rem;
+        binary       += call->binary;
+      }
+      failures += cell_failures;
+
+      printf ( "%d,%s,%s,%d,%.0f,%.0f,%.3f,%.0f,%.1f,%s\n",
+               offer, tty_name[kind],
+               binary == num_profiles ? "binary" : binary ? "mixed" : "ascii",
+               num_profiles,
+               packet_bytes / num_profiles, to_shore / num_profiles,
+               to_shore / packet_bytes - 1, to_float / num_profiles,
+               10 * to_shore / num_profiles / baud,
+               cell_failures ? "FAILED" : "ok" );
+      fflush ( stdout );
+    }
+  }
+
+  kill ( receiver, SIGTERM );
+  waitpid ( receiver, 0, 0 );
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+# include <stdarg.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+# include <arpa/inet.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/socket.h>
+
+# include "syslog.h"
+# include "harness_common.h"
+
+/******************************
+ *  The receiver logs via syslog_out(), which on the firmware
+ *  goes to file and telemetry. Here, log to stderr.
+ */
+static syslogVerbosity_t harness_verbosity = SYSLOG_WARNING;
+
+int8_t syslog_setVerbosity ( syslogVerbosity_t v ) {
+  harness_verbosity = v;
+  return 0;
+}
+
+void syslog_out ( syslogVerbosity_t v, const char* func, const char* fmt, ... ) {
+  if ( v > harness_verbosity ) return;
+  va_list ap;
+  va_start ( ap, fmt );
+  fprintf  ( stderr, "[%d] %s()\t", (int)getpid(), func );
+  vfprintf ( stderr, fmt, ap );
+  fprintf  ( stderr, "\n" );
+  va_end ( ap );
+}
+
+double now_s ( void ) {
+  struct timespec t;
+  clock_gettime ( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+int connect_port ( uint16_t port, int nodelay ) {
+
+  int fd = socket ( AF_INET, SOCK_STREAM, 0 );
+  if ( fd < 0 ) return -1;
+
+  struct sockaddr_in addr;
+  memset ( &addr, 0, sizeof(addr) );
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons ( port );
+  addr.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+
+  if ( connect ( fd, (struct sockaddr*)&addr, sizeof(addr) ) ) {
+    close ( fd );
+    return -1;
+  }
+  if ( nodelay ) {
+    int one = 1;
+    setsockopt ( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+  }
+  return fd;
+}
+
+int compare_packet ( const char* rx_dir, uint16_t hynv, uint16_t prof, int p,
+                     const unsigned char* expected, size_t size ) {
+
+  char fn[512];
+  snprintf ( fn, sizeof(fn), "%s/%04hu/%05hu/%05hu.P%02d", rx_dir, hynv, prof, prof, p );
+
+  FILE* fp = fopen ( fn, "r" );
+  if ( !fp ) return 1;
+
+  unsigned char* got = malloc ( size+1 );
+  int const rv = !got || size != fread ( got, 1, size+1, fp ) || memcmp ( got, expected, size );
+  free ( got );
+  fclose ( fp );
+  return rv;
+}
+
+int parse_list ( const char* list, double* v, int max ) {
+  int n = 0;
+  const char* s = list;
+  while ( n < max && *s ) {
+    char* e;
+    v[n++] = strtod ( s, &e );
+    if ( e == s ) return 0;
+    s = ( ',' == *e ) ? e+1 : e;
+  }
+  return n;
+}
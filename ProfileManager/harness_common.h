@@ -0,0 +1,29 @@
+# ifndef _PM_HARNESS_COMMON_H_
+# define _PM_HARNESS_COMMON_H_
+
+# include <stddef.h>
+# include <stdint.h>
+
+//  Shared by the host harnesses built by the compile_*.sh scripts.
+//
+//  Also here: syslog_out() and syslog_setVerbosity(), as declared in
+//  syslog.h, such that the receiver (profile_receive.c) logs to stderr.
+//  The verbosity starts at SYSLOG_WARNING.
+
+//  Seconds on the monotonic clock
+double now_s ( void );
+
+//  A TCP connection to port on the loopback interface, -1 if refused.
+//  With nodelay, short writes (bursts, replies) go out at once.
+int connect_port ( uint16_t port, int nodelay );
+
+//  0 if the receiver saved packet p of profile prof of float hynv
+//  under rx_dir as the size bytes expected
+int compare_packet ( const char* rx_dir, uint16_t hynv, uint16_t prof, int p,
+                     const unsigned char* expected, size_t size );
+
+//  A comma separated list of numbers into v, at most max of them.
+//  Returns how many, 0 if one is not a number.
+int parse_list ( const char* list, double* v, int max );
+
+# endif
@@ -0,0 +1,257 @@
+# include <errno.h>
+# include <math.h>
+# include <poll.h>
+# include <signal.h>
+# include <stdint.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+# include <arpa/inet.h>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/socket.h>
+# include <sys/types.h>
+
+static char ProgramDescription[] = "HyperNav Float Link Emulator [Satlantic]";
+static char ProgramRevision   [] = "Revision 0.1  2026-10-17";
+
+/******************************
+ *  Function: Print usage
+ */
+static void print_usage ( char* pn ) {
+
+  printf ( "%s\n%s\n", ProgramDescription, ProgramRevision );
+  printf ( "Usage: %s [-h -? -lL -cH:P -dD -eE -sS]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -lL     Port to accept floats on [default: 43211]\n" );
+  printf ( "       -cH:P   Receiver (or rudicsd) to connect each float to [default: 127.0.0.1:43210]\n" );
+  printf ( "       -dD     One-way delay in ms, each direction [default: 0]\n" );
+  printf ( "       -eE     Probability of a corrupted byte, each direction [default: 0]\n" );
+  printf ( "       -sS     Random seed [default: 1]\n" );
+  printf ( "A userspace TCP proxy standing in for the Iridium link between float and\n" );
+  printf ( "receiver: data are held for the delay, then passed on in order, with bytes\n" );
+  printf ( "corrupted at the given rate. A corrupted burst fails its CRC at the receiver,\n" );
+  printf ( "as a burst with bit errors would; a burst of B bytes is lost with\n" );
+  printf ( "probability 1-(1-E)^B. One process per float connection.\n" );
+}
+
+//  Data read from one side, held until due on the other
+//
+typedef struct link_chunk {
+  struct link_chunk* next;
+  double             due;
+  size_t             size;
+  size_t             done;
+  unsigned char      data[];
+} link_chunk_t;
+
+typedef struct link_direction {
+  int           from;
+  int           to;
+  int           eof;          //  from side closed
+  link_chunk_t* head;
+  link_chunk_t* tail;
+  double        skip;         //  bytes until the next corrupted one
+} link_direction_t;
+
+static double         link_delay = 0;
+static double         link_error = 0;
+static unsigned short link_seed[3];
+
+static double now_s ( void ) {
+  struct timespec t;
+  clock_gettime ( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+//  Bytes between corrupted ones are geometrically distributed
+//
+static double next_error ( void ) {
+  if ( link_error <= 0 ) return HUGE_VAL;
+  return floor ( log ( 1.0 - erand48 ( link_seed ) ) / log ( 1.0 - link_error ) );
+}
+
+//  Read what is available, corrupt it, and queue it with its due time.
+//  Returns 1 at end of input.
+//
+static int direction_read ( link_direction_t* d ) {
+
+  unsigned char buf[8192];
+  ssize_t n = read ( d->from, buf, sizeof(buf) );
+
+  if ( n < 0 && ( EINTR == errno || EAGAIN == errno ) ) return 0;
+  if ( n <= 0 ) return 1;
+
+  link_chunk_t* c = malloc ( sizeof(link_chunk_t) + n );
+  if ( !c ) return 1;
+
+  memcpy ( c->data, buf, n );
+  while ( d->skip < n ) {
+    c->data[(size_t)d->skip] ^= 0x66;
+    d->skip += 1 + next_error();
+  }
+  d->skip -= n;
+
+  c->next = 0;
+  c->due  = now_s() + link_delay;
+  c->size = n;
+  c->done = 0;
+
+  if ( d->tail ) d->tail->next = c;
+  else           d->head       = c;
+  d->tail = c;
+  return 0;
+}
+
+//  Pass on the chunks that are due.
+//  Returns 1 if the other side went away.
+//
+static int direction_write ( link_direction_t* d, double now ) {
+
+  while ( d->head && d->head->due <= now ) {
+
+    link_chunk_t* c = d->head;
+    ssize_t n = write ( d->to, c->data+c->done, c->size-c->done );
+    if ( n < 0 ) {
+      if ( EINTR == errno ) continue;
+      return 1;
+    }
+    c->done += n;
+    if ( c->done < c->size ) continue;
+
+    d->head = c->next;
+    if ( !d->head ) d->tail = 0;
+    free ( c );
+  }
+
+  if ( d->eof && !d->head ) {
+    shutdown ( d->to, SHUT_WR );
+  }
+  return 0;
+}
+
+static void link_serve ( int float_fd, int receiver_fd ) {
+
+  int one = 1;
+  setsockopt ( float_fd,    IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+  setsockopt ( receiver_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+
+  link_direction_t d[2];
+  memset ( d, 0, sizeof(d) );
+  d[0].from = float_fd;     d[0].to = receiver_fd;
+  d[1].from = receiver_fd;  d[1].to = float_fd;
+  d[0].skip = next_error();
+  d[1].skip = next_error();
+
+  while ( !( d[0].eof && !d[0].head && d[1].eof && !d[1].head ) ) {
+
+    double const now = now_s();
+    double next = now + 1;
+    int i;
+
+    struct pollfd pfd[2];
+    for ( i=0; i<2; i++ ) {
+      pfd[i].fd      = d[i].eof ? -1 : d[i].from;
+      pfd[i].events  = POLLIN;
+      pfd[i].revents = 0;
+      if ( d[i].head && d[i].head->due < next ) next = d[i].head->due;
+    }
+
+    int const ms = ( next > now ) ? (int)ceil ( 1e3*( next - now ) ) : 0;
+    if ( poll ( pfd, 2, ms ) < 0 && EINTR != errno ) break;
+
+    for ( i=0; i<2; i++ ) {
+      if ( pfd[i].revents && direction_read ( d+i ) ) d[i].eof = 1;
+    }
+    for ( i=0; i<2; i++ ) {
+      if ( direction_write ( d+i, now_s() ) ) return;
+    }
+  }
+}
+
+int main ( int argc, char* argv[] ) {
+
+  uint16_t listen_port = 43211;
+  char     target[256] = "127.0.0.1:43210";
+  long     seed        = 1;
+
+  int opt;
+
+  for ( opterr=0; ( opt = getopt ( argc, argv, "?hl:c:d:e:s:" ) ) != EOF ; ) {
+    switch ( opt ) {
+    case '?':
+    case 'h': print_usage(argv[0]); return 0;
+    case 'l': listen_port = atoi ( optarg ); break;
+    case 'c': strncpy ( target, optarg, sizeof(target)-1 ); break;
+    case 'd': link_delay  = atof ( optarg ) / 1000; break;
+    case 'e': link_error  = atof ( optarg ); break;
+    case 's': seed        = atol ( optarg ); break;
+    default : fprintf ( stderr, "%s: Ignoring unknown '-%c' option\n", argv[0], opt ); break;
+    }
+  }
+
+  char* colon = strrchr ( target, ':' );
+  if ( !colon || link_delay < 0 || link_error < 0 || link_error >= 1 ) {
+    print_usage ( argv[0] );
+    return 2;
+  }
+  *colon = 0;
+
+  struct addrinfo hints, *to = 0;
+  memset ( &hints, 0, sizeof(hints) );
+  hints.ai_family   = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if ( getaddrinfo ( target, colon+1, &hints, &to ) ) {
+    fprintf ( stderr, "%s: no host '%s'\n", argv[0], target );
+    return 2;
+  }
+
+  int lfd = socket ( AF_INET, SOCK_STREAM, 0 );
+  int one = 1;
+  setsockopt ( lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one) );
+
+  struct sockaddr_in addr;
+  memset ( &addr, 0, sizeof(addr) );
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons ( listen_port );
+  addr.sin_addr.s_addr = htonl ( INADDR_ANY );
+
+  if ( lfd < 0 || bind ( lfd, (struct sockaddr*)&addr, sizeof(addr) ) || listen ( lfd, 64 ) ) {
+    perror ( "link_emulator" );
+    return 2;
+  }
+
+  signal ( SIGCHLD, SIG_IGN );
+  signal ( SIGPIPE, SIG_IGN );
+
+  for ( ;; ) {
+
+    int const ffd = accept ( lfd, 0, 0 );
+    if ( ffd < 0 ) {
+      if ( EINTR == errno ) continue;
+      perror ( "link_emulator" );
+      return 1;
+    }
+    seed++;
+
+    if ( 0 == fork() ) {
+      close ( lfd );
+      link_seed[0] = 0x330E;
+      link_seed[1] = (unsigned short) seed;
+      link_seed[2] = (unsigned short) ( seed >> 16 );
+
+      int const rfd = socket ( AF_INET, SOCK_STREAM, 0 );
+      if ( rfd < 0 || connect ( rfd, to->ai_addr, to->ai_addrlen ) ) {
+        perror ( "link_emulator: receiver" );
+        _exit ( 1 );
+      }
+      link_serve ( ffd, rfd );
+      _exit ( 0 );
+    }
+    close ( ffd );
+  }
+}
@@ -0,0 +1,70 @@
+# include "packet_process.h"
+
+# include <stdio.h>
+
+Profile_Data_Packet_t* packet_process ( Profile_Data_Packet_t* packet,
+                                        Profile_Data_Packet_t* work,
+                                        transmit_instructions_t* tx_instruct,
+                                        packet_stage_dump_t dump, void* dump_arg ) {
+
+  //  'in' holds the result of the previous stage,
+  //  'out' receives the next stage. Swap after every stage.
+  //
+  Profile_Data_Packet_t* in  = packet;
+  Profile_Data_Packet_t* out = work;
+  Profile_Data_Packet_t* tmp;
+
+  //  Represent spectra pixel values in graycode
+  //
+  //  TODO: Round to proper position before graycoding if noise_remove>0
+
+  if ( tx_instruct->representation == REP_GRAY ) {
+    if ( data_packet_bin2gray ( in, out ) ) {
+      fprintf ( stderr, "Failed in data_packet_bin2gray()\n" );
+      return 0;
+    }
+    if ( dump ) dump ( out, "G", dump_arg );
+    tmp = in; in = out; out = tmp;
+  }
+
+  //  Arrange the spectral data in bitplanes
+  //
+  if ( tx_instruct->use_bitplanes == BITPLANE ) {
+    if ( data_packet_bitplane ( in, out, tx_instruct->noise_bits_remove ) ) {
+      fprintf ( stderr, "Failed in data_packet_bitplane()\n" );
+      return 0;
+    }
+    if ( dump ) dump ( out, "B", dump_arg );
+    tmp = in; in = out; out = tmp;
+  }
+
+  //  Compress the packet
+  //
+  if ( tx_instruct->compression == ZLIB ) {
+    if ( data_packet_compress ( in, out, 'G' ) ) {
+      fprintf ( stderr, "Failed in data_packet_compress()\n" );
+      return 0;
+    }
+    if ( dump ) dump ( out, "C", dump_arg );
+    tmp = in; in = out; out = tmp;
+  }
+
+  //  Encode the packet
+  //
+  if ( tx_instruct->encoding != NO_ENCODING ) {
+    char encoding;
+    switch ( tx_instruct->encoding ) {
+    case ASCII85: encoding = 'A'; break;
+    case BASE64 : encoding = 'B'; break;
+    default     : encoding = 'N'; break;
+    }
+    if ( data_packet_encode ( in, out, encoding ) ) {
+      fprintf ( stderr, "Failed in data_packet_encode()\n" );
+      return 0;
+    }
+    if ( dump ) dump ( out, "E", dump_arg );
+    tmp = in; in = out; out = tmp;
+  }
+
+  return in;
+}
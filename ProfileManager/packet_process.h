@@ -0,0 +1,27 @@
+# ifndef _PM_PACKET_PROCESS_H_
+# define _PM_PACKET_PROCESS_H_
+
+# include <unistd.h>
+# include <stdint.h>
+
+# include "profile_packet.h"
+# include "profile_transmit.h"
+
+//  Called after each processing stage with the stage result
+//  and a one-letter stage type ("G", "B", "C", "E").
+typedef int (*packet_stage_dump_t) ( Profile_Data_Packet_t* stage, const char* type, void* dump_arg );
+
+//  Process a raw packet for transmission
+//    Binary -> [Graycode ->] [Bitplaned ->] [Compressed ->] [ASCII-Encoded]
+//
+//  The stages alternate between the two buffers 'packet' and 'work',
+//  no packet is copied. Both buffers are overwritten.
+//  Returns the buffer holding the final stage, or 0 on failure.
+//  If dump is not 0, it is called for every stage that was run.
+//
+Profile_Data_Packet_t* packet_process ( Profile_Data_Packet_t* packet,
+                                        Profile_Data_Packet_t* work,
+                                        transmit_instructions_t* tx_instruct,
+                                        packet_stage_dump_t dump, void* dump_arg );
+
+# endif
@@ -0,0 +1,807 @@
+# include <stddef.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+# include "profile_packet.h"
+# include "packet_process.h"
+# include "sensor_data.h"
+# include "harness_common.h"
+
+static char ProgramDescription[] = "HyperNav Packet Pipeline Benchmark [Satlantic]";
+static char ProgramRevision   [] = "Revision 0.1  2026-10-17";
+
+//  The benchmarked stages, in pipeline order.
+//
+enum { STAGE_BIN2GRAY, STAGE_BITPLANE, STAGE_COMPRESS, STAGE_ENCODE, NUM_STAGES };
+
+static const char* const stage_name[NUM_STAGES] = { "bin2gray", "bitplane", "compress", "encode" };
+
+typedef struct Stage_Result {
+  double   seconds;      //  best-of-rounds wall time over all packets
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+  uint32_t allocs;       //  zalloc calls, all packets
+  uint32_t alloc_bytes;
+  uint32_t alloc_peak;   //  largest in-use heap of a single packet
+} Stage_Result_t;
+
+/************************
+ *  Function: Print usage
+ */
+static void print_usage ( char* pn ) {
+
+  printf ( "%s\n%s\n", ProgramDescription, ProgramRevision );
+  printf ( "Usage: %s [-h -? -c -nN -sS -PN -iN -rN -bFILE -wFILE -xP]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -c      Run round-trip checks of the packet stages and exit\n" );
+  printf ( "       -T      Compare the former by-value staging, saving every stage,\n" );
+  printf ( "               with ping-pong staging and its opt-in dump, and exit\n" );
+  printf ( "       -G      Time gray code decoding per pixel and exit\n" );
+  printf ( "       -nN     Number of packets per round [default: 128]\n" );
+  printf ( "       -sS     Spectra per packet, 1..%d [default: %d]\n", MXHNV, MXHNV );
+  printf ( "       -PN     Remove N noise bits when bitplaning [default: 0]\n" );
+  printf ( "       -iN     Rounds; the fastest round is reported [default: 5]\n" );
+  printf ( "       -rN     Random seed [default: 1]\n" );
+  printf ( "       -bFILE  Compare against baseline FILE (CSV as written by -w)\n" );
+  printf ( "       -wFILE  Write results as baseline to FILE\n" );
+  printf ( "       -xP     Fail if a stage is more than P percent slower than baseline [default: 10]\n" );
+  printf ( "Results are written to stdout as CSV.\n" );
+  printf ( "Exit status is 1 if any stage regressed against the baseline\n" );
+  printf ( "or any round-trip check failed, 2 on error.\n" );
+}
+
+static void serialize_2byte ( uint8_t* destination, uint16_t value ) {
+  destination[0] = value>>8;
+  destination[1] = value&0xFF;
+}
+
+static void serialize_4byte ( uint8_t* destination, uint32_t value ) {
+  destination[0] = (value>>24)&0xFF;
+  destination[1] = (value>>16)&0xFF;
+  destination[2] = (value>> 8)&0xFF;
+  destination[3] = (value    )&0xFF;
+}
+
+//  Fill a binary, uncompressed, unencoded packet
+//  with spectra from the sensor data simulator,
+//  the same way the controller packages SBRD data.
+//
+static void make_raw_packet ( Profile_Data_Packet_t* raw, uint16_t packet_number, uint16_t number_of_data ) {
+
+  memset ( raw, 0, sizeof(Profile_Data_Packet_t) );
+
+  serialize_2byte ( raw->HYNV_num, 770 );
+  serialize_2byte ( raw->PROF_num, 16291 );
+  serialize_2byte ( raw->PCKT_num, packet_number );
+
+  raw->header.sensor_type = 'S';
+  raw->header.empty_space = ' ';
+  memcpy ( raw->header.sensor_ID, "SATYLU0000", 10 );
+
+  char numString[8];
+  snprintf ( numString, 5, "%4hu", number_of_data );
+  memcpy ( raw->header.number_of_data, numString, 4 );
+
+  raw->header.representation     = 'B';
+  raw->header.noise_bits_removed = 'N';
+  raw->header.compression        = '0';
+  raw->header.ASCII_encoding     = 'N';
+  memcpy ( raw->header.compressed_sz, "      ", 6 );
+  memcpy ( raw->header.encoded_sz,    "      ", 6 );
+
+  uint16_t* px = (uint16_t*)raw->contents.structured.sensor_data.bitplanes;
+
+  int d;
+  for ( d=0; d<number_of_data; d++ ) {
+
+    Spectrometer_Data_t h;
+    generate_fake_hyper ( &h, 1 );
+    memcpy ( px + d*N_SPEC_PIX, h.hnv_spectrum, N_SPEC_PIX*sizeof(uint16_t) );
+
+    uint8_t* aux = raw->contents.structured.aux_data.spec_serial + d*SPEC_AUX_SERIAL_SIZE;
+    int nn = 0;
+    serialize_4byte ( aux+nn, h.aux.acquisition_time.tv_sec );  nn+=4;
+    serialize_4byte ( aux+nn, h.aux.acquisition_time.tv_usec ); nn+=4;
+    serialize_2byte ( aux+nn, h.aux.integration_time );         nn+=2;
+    serialize_2byte ( aux+nn, h.aux.sample_number );            nn+=2;
+    serialize_2byte ( aux+nn, h.aux.dark_average );             nn+=2;
+    serialize_2byte ( aux+nn, h.aux.dark_noise );               nn+=2;
+    serialize_2byte ( aux+nn, h.aux.light_minus_dark_up_shift ); nn+=2;
+    serialize_2byte ( aux+nn, h.aux.spectrometer_temperature ); nn+=2;
+    serialize_4byte ( aux+nn, h.aux.pressure );                 nn+=4;
+    serialize_2byte ( aux+nn, h.aux.sun_azimuth );              nn+=2;
+    serialize_2byte ( aux+nn, h.aux.housing_heading );          nn+=2;
+    serialize_2byte ( aux+nn, h.aux.housing_pitch );            nn+=2;
+    serialize_2byte ( aux+nn, h.aux.housing_roll );             nn+=2;
+    serialize_2byte ( aux+nn, h.aux.spectrometer_pitch );       nn+=2;
+    serialize_2byte ( aux+nn, h.aux.spectrometer_roll );        nn+=2;
+    serialize_4byte ( aux+nn, h.aux.tag );                      nn+=4;
+    serialize_2byte ( aux+nn, h.aux.side );                     nn+=2;
+  }
+}
+
+//  Bit-by-bit bitplaning, as done before the block transpose,
+//  used as the reference for the block transposer.
+//
+static void reference_bitplane ( const uint16_t* px, uint32_t npix, uint8_t* planes, uint16_t remove_noise_bits ) {
+
+  uint16_t low_mask = 0x0001 << remove_noise_bits;
+  uint16_t bit_mask;
+  uint32_t plane_item = 0;
+  for ( bit_mask = 0x8000; bit_mask >= low_mask && bit_mask; bit_mask >>= 1 ) {
+
+    uint8_t  plane_byte = 0;
+    uint8_t  plane_mask = 0x80;
+
+    uint32_t p;
+    for ( p=0; p<npix; p++ ) {
+      if ( px[p] & bit_mask ) {
+        plane_byte |= plane_mask;
+      }
+      if ( 0x01 != plane_mask ) {
+        plane_mask >>= 1;
+      } else {
+        planes[plane_item++] = plane_byte;
+        plane_byte = 0;
+        plane_mask = 0x80;
+      }
+    }
+  }
+}
+
+//  Gray code decoding one bit per loop pass, as done before the prefix XOR,
+//  used as the reference for data_packet_gray2bin_pixel(s).
+//
+static uint16_t reference_gray2bin ( uint16_t val ) {
+
+  uint16_t mask;
+  for ( mask = val>>1; mask != 0; mask >>= 1 ) {
+    val = val ^ mask;
+  }
+  return val;
+}
+
+//  All 65536 values through the reference, the scalar prefix XOR
+//  and the vector path (at every start alignment and tail length).
+//
+static int run_gray_checks ( void ) {
+
+  static uint16_t gray[65536+64], ref[65536], bin[65536+64];
+  int failures = 0;
+
+  uint32_t v;
+  for ( v=0; v<65536; v++ ) {
+    uint16_t const g = (uint16_t)v;
+    ref[v] = reference_gray2bin ( g );
+    if ( data_packet_gray2bin_pixel ( g ) != ref[v] ) {
+      if ( failures++ < 8 ) fprintf ( stderr, "FAIL gray %04x: %04hx, reference %04hx\n", v, data_packet_gray2bin_pixel ( g ), ref[v] );
+    }
+    if ( ( ref[v] ^ ( ref[v] >> 1 ) ) != g ) {
+      if ( failures++ < 8 ) fprintf ( stderr, "FAIL gray %04x: not the inverse of bin2gray\n", v );
+    }
+  }
+
+  uint32_t offset;
+  for ( offset=0; offset<32; offset++ ) {
+    for ( v=0; v<65536; v++ ) gray[offset+v] = (uint16_t)v;
+    memset ( bin, 0xA5, sizeof(bin) );
+
+    uint32_t const npix = 65536 - offset;   //  tails of 0..31 pixels
+    data_packet_gray2bin_pixels ( gray+offset, bin+offset, npix );
+
+    if ( memcmp ( bin+offset, ref, npix*sizeof(uint16_t) ) ) {
+      if ( failures++ < 8 ) fprintf ( stderr, "FAIL gray spectrum path at offset %u\n", offset );
+    }
+    if ( bin[offset+npix] != 0xA5A5 || ( offset && bin[offset-1] != 0xA5A5 ) ) {
+      if ( failures++ < 8 ) fprintf ( stderr, "FAIL gray spectrum path writes outside at offset %u\n", offset );
+    }
+  }
+
+  fprintf ( stderr, "Gray code checks: %d failures over 65536 values\n", failures );
+  return failures;
+}
+
+//  For every packet layout (1..MXHNV spectra of N_SPEC_PIX pixels)
+//  and every noise bit count (0..15) verify that
+//  - bitplane() produces the same planes as the bit-by-bit reference, and
+//  - debitplane(bitplane(x)) == x with the removed noise bits cleared.
+//
+static int run_checks ( void ) {
+
+  static Profile_Data_Packet_t raw, planed, restored;
+  static uint8_t ref_planes[MXHNV*N_SPEC_PIX*2];
+
+  int failures = 0;
+  int checks   = 0;
+
+  uint16_t number_of_data;
+  for ( number_of_data=1; number_of_data<=MXHNV; number_of_data++ ) {
+
+    uint16_t noise_bits;
+    for ( noise_bits=0; noise_bits<16; noise_bits++ ) {
+
+      make_raw_packet ( &raw, 1, number_of_data );
+
+      //  Use the full 16-bit range, including all-zero / all-one pixels
+      uint16_t* px = (uint16_t*)raw.contents.structured.sensor_data.bitplanes;
+      uint32_t const npix = (uint32_t)number_of_data*N_SPEC_PIX;
+      uint32_t p;
+      for ( p=0; p<npix; p++ ) {
+        switch ( p%64 ) {
+        case  0: px[p] = 0x0000; break;
+        case  1: px[p] = 0xFFFF; break;
+        case  2: px[p] = 0x8001; break;
+        default: px[p] = (uint16_t)random(); break;
+        }
+      }
+
+      memset ( &planed,   0xA5, sizeof(planed) );
+      memset ( &restored, 0x5A, sizeof(restored) );
+
+      checks++;
+
+      if ( data_packet_bitplane ( &raw, &planed, noise_bits )
+        || data_packet_debitplane ( &planed, &restored ) ) {
+        fprintf ( stderr, "FAIL %hu spectra, %hu noise bits: stage returned error\n", number_of_data, noise_bits );
+        failures++;
+        continue;
+      }
+
+      uint32_t const plane_bytes = (16-noise_bits)*(npix/8);
+      reference_bitplane ( px, npix, ref_planes, noise_bits );
+      if ( memcmp ( ref_planes, planed.contents.structured.sensor_data.bitplanes, plane_bytes ) ) {
+        fprintf ( stderr, "FAIL %hu spectra, %hu noise bits: planes differ from reference\n", number_of_data, noise_bits );
+        failures++;
+        continue;
+      }
+
+      uint16_t const keep = (uint16_t)( 0xFFFF << noise_bits );
+      uint16_t const* rx = (uint16_t*)restored.contents.structured.sensor_data.bitplanes;
+      for ( p=0; p<npix; p++ ) {
+        if ( rx[p] != ( px[p] & keep ) ) {
+          fprintf ( stderr, "FAIL %hu spectra, %hu noise bits: pixel %u %04hx -> %04hx\n",
+                    number_of_data, noise_bits, p, px[p], rx[p] );
+          failures++;
+          break;
+        }
+      }
+
+      if ( memcmp ( raw.contents.structured.aux_data.spec_serial,
+               restored.contents.structured.aux_data.spec_serial, number_of_data*SPEC_AUX_SERIAL_SIZE ) ) {
+        fprintf ( stderr, "FAIL %hu spectra, %hu noise bits: auxiliary data differ\n", number_of_data, noise_bits );
+        failures++;
+      }
+    }
+  }
+
+  fprintf ( stderr, "Round-trip checks: %d of %d layouts failed\n", failures, checks );
+  return failures + run_gray_checks();
+}
+
+static uint32_t size_field ( const char* field ) {
+  char numString[8];
+  memcpy ( numString, field, 6 );
+  numString[6] = 0;
+  return (uint32_t)atol ( numString );
+}
+
+//  Run all stages over all packets once, accumulating per-stage results.
+//
+static int run_round ( Profile_Data_Packet_t* raw, uint16_t num_packets, uint16_t number_of_data,
+                       uint16_t noise_bits, Stage_Result_t result[NUM_STAGES] ) {
+
+  static Profile_Data_Packet_t gray, bitplane, compressed, encoded;
+
+  uint32_t const pixel_bytes = number_of_data*N_SPEC_PIX*sizeof(uint16_t);
+  uint32_t const aux_bytes   = number_of_data*SPEC_AUX_SERIAL_SIZE;
+  uint32_t const plane_bytes = number_of_data*N_SPEC_PIX/8*(16-noise_bits);
+
+  memset ( result, 0, NUM_STAGES*sizeof(Stage_Result_t) );
+
+  uint16_t n;
+  for ( n=0; n<num_packets; n++ ) {
+
+    double t0, t1;
+    uint32_t calls, bytes, peak;
+
+    data_packet_zalloc_stats ( 0, 0, 0, 1 );
+    t0 = now_s();
+    if ( data_packet_bin2gray ( raw+n, &gray ) ) {
+      fprintf ( stderr, "data_packet_bin2gray() failed on packet %hu\n", n );
+      return 1;
+    }
+    t1 = now_s();
+    data_packet_zalloc_stats ( &calls, &bytes, &peak, 1 );
+    result[STAGE_BIN2GRAY].seconds   += t1-t0;
+    result[STAGE_BIN2GRAY].bytes_in  += pixel_bytes + aux_bytes;
+    result[STAGE_BIN2GRAY].bytes_out += pixel_bytes + aux_bytes;
+    result[STAGE_BIN2GRAY].allocs    += calls;
+    result[STAGE_BIN2GRAY].alloc_bytes += bytes;
+    if ( peak > result[STAGE_BIN2GRAY].alloc_peak ) result[STAGE_BIN2GRAY].alloc_peak = peak;
+
+    t0 = now_s();
+    if ( data_packet_bitplane ( &gray, &bitplane, noise_bits ) ) {
+      fprintf ( stderr, "data_packet_bitplane() failed on packet %hu\n", n );
+      return 1;
+    }
+    t1 = now_s();
+    data_packet_zalloc_stats ( &calls, &bytes, &peak, 1 );
+    result[STAGE_BITPLANE].seconds   += t1-t0;
+    result[STAGE_BITPLANE].bytes_in  += pixel_bytes + aux_bytes;
+    result[STAGE_BITPLANE].bytes_out += plane_bytes + aux_bytes;
+    result[STAGE_BITPLANE].allocs    += calls;
+    result[STAGE_BITPLANE].alloc_bytes += bytes;
+    if ( peak > result[STAGE_BITPLANE].alloc_peak ) result[STAGE_BITPLANE].alloc_peak = peak;
+
+    t0 = now_s();
+    if ( data_packet_compress ( &bitplane, &compressed, 'G' ) ) {
+      fprintf ( stderr, "data_packet_compress() failed on packet %hu\n", n );
+      return 1;
+    }
+    t1 = now_s();
+    data_packet_zalloc_stats ( &calls, &bytes, &peak, 1 );
+    result[STAGE_COMPRESS].seconds   += t1-t0;
+    result[STAGE_COMPRESS].bytes_in  += pixel_bytes + aux_bytes;
+    result[STAGE_COMPRESS].bytes_out += size_field ( compressed.header.compressed_sz );
+    result[STAGE_COMPRESS].allocs    += calls;
+    result[STAGE_COMPRESS].alloc_bytes += bytes;
+    if ( peak > result[STAGE_COMPRESS].alloc_peak ) result[STAGE_COMPRESS].alloc_peak = peak;
+
+    t0 = now_s();
+    if ( data_packet_encode ( &compressed, &encoded, 'A' ) ) {
+      fprintf ( stderr, "data_packet_encode() failed on packet %hu\n", n );
+      return 1;
+    }
+    t1 = now_s();
+    data_packet_zalloc_stats ( &calls, &bytes, &peak, 1 );
+    result[STAGE_ENCODE].seconds   += t1-t0;
+    result[STAGE_ENCODE].bytes_in  += size_field ( compressed.header.compressed_sz );
+    result[STAGE_ENCODE].bytes_out += size_field ( encoded.header.encoded_sz );
+    result[STAGE_ENCODE].allocs    += calls;
+    result[STAGE_ENCODE].alloc_bytes += bytes;
+    if ( peak > result[STAGE_ENCODE].alloc_peak ) result[STAGE_ENCODE].alloc_peak = peak;
+  }
+
+  return 0;
+}
+
+//  Bytes moved by memset/memcpy while staging a packet.
+//
+static uint64_t staging_bytes;
+
+# define STAGE_MEMSET(d,c,n) do { memset ( d, c, n ); staging_bytes += (n); } while (0)
+# define STAGE_MEMCPY(d,s,n) do { memcpy ( d, s, n ); staging_bytes += (n); } while (0)
+
+//  Save a stage as data_packet_save() did, whose packet file I/O is
+//  compiled out in profile_packet.c: one file per packet and stage,
+//  the 32 byte header and the bytes of the stage.
+//
+static int staging_save ( Profile_Data_Packet_t* stage, const char* type, void* dump_arg ) {
+
+  char fn[64];
+  snprintf ( fn, sizeof(fn), "%s/%s%04hu.pkt", (const char*)dump_arg, type,
+             (uint16_t)( stage->PCKT_num[0]<<8 | stage->PCKT_num[1] ) );
+
+  uint32_t size;
+  switch ( type[0] ) {
+  case 'C': size = size_field ( stage->header.compressed_sz ); break;
+  case 'E': size = size_field ( stage->header.encoded_sz    ); break;
+  default : {
+      char numString[5];
+      memcpy ( numString, stage->header.number_of_data, 4 );
+      numString[4] = 0;
+      size = atoi ( numString ) * ( N_SPEC_PIX*sizeof(uint16_t) + SPEC_AUX_SERIAL_SIZE );
+    }
+    break;
+  }
+  if ( size > FLAT_SZ ) size = FLAT_SZ;
+
+  FILE* fp = fopen ( fn, "w" );
+  if ( !fp ) return 1;
+  int const rv = 1 != fwrite ( stage, offsetof(Profile_Data_Packet_t,contents) + size, 1, fp );
+  return fclose ( fp ) || rv;
+}
+
+//  Packet staging as formerly done in packet_process_transmit():
+//  every stage into its own cleared packet, skipped stages copied.
+//  With save_dir, every stage run is saved, as it then always was.
+//
+static Profile_Data_Packet_t* staging_by_value ( Profile_Data_Packet_t* original, transmit_instructions_t* tx_instruct, const char* save_dir ) {
+
+  static Profile_Data_Packet_t represent, arranged, compressed, encoded;
+
+  if ( tx_instruct->representation == REP_GRAY ) {
+    STAGE_MEMSET ( &represent, 0, sizeof(Profile_Data_Packet_t) );
+    if ( data_packet_bin2gray ( original, &represent ) ) return 0;
+    if ( save_dir ) staging_save ( &represent, "G", (void*)save_dir );
+  } else {
+    STAGE_MEMCPY ( &represent, original, sizeof(Profile_Data_Packet_t) );
+  }
+
+  if ( tx_instruct->use_bitplanes == BITPLANE ) {
+    STAGE_MEMSET ( &arranged, 0, sizeof(Profile_Data_Packet_t) );
+    if ( data_packet_bitplane ( &represent, &arranged, tx_instruct->noise_bits_remove ) ) return 0;
+    if ( save_dir ) staging_save ( &arranged, "B", (void*)save_dir );
+  } else {
+    STAGE_MEMCPY ( &arranged, &represent, sizeof(Profile_Data_Packet_t) );
+  }
+
+  if ( tx_instruct->compression == ZLIB ) {
+    STAGE_MEMSET ( &compressed, 0, sizeof(Profile_Data_Packet_t) );
+    if ( data_packet_compress ( &arranged, &compressed, 'G' ) ) return 0;
+    if ( save_dir ) staging_save ( &compressed, "C", (void*)save_dir );
+  } else {
+    STAGE_MEMCPY ( &compressed, &arranged, sizeof(Profile_Data_Packet_t) );
+  }
+
+  if ( tx_instruct->encoding != NO_ENCODING ) {
+    STAGE_MEMSET ( &encoded, 0, sizeof(Profile_Data_Packet_t) );
+    if ( data_packet_encode ( &compressed, &encoded, 'A' ) ) return 0;
+    if ( save_dir ) staging_save ( &encoded, "E", (void*)save_dir );
+  } else {
+    STAGE_MEMCPY ( &encoded, &compressed, sizeof(Profile_Data_Packet_t) );
+  }
+
+  return &encoded;
+}
+
+//  The staging schemes compared by -T
+//
+enum { STG_FORMER, STG_BY_VALUE, STG_PING_PONG_SAVED, STG_PING_PONG, NUM_STG };
+
+static const char* const stg_name [NUM_STG] = { "by_value", "by_value", "ping_pong", "ping_pong" };
+static const int         stg_saved[NUM_STG] = { 1, 0, 1, 0 };
+
+//  One profile through one staging scheme.
+//  Each packet starts from a fresh copy of the raw packet,
+//  as the transmitter does when retrieving it from file;
+//  that copy is not counted as staging.
+//  Returns seconds, <0 on failure.
+//
+static double time_staging ( int scheme, Profile_Data_Packet_t* raw, uint16_t num_packets,
+                             Profile_Data_Packet_t* packet, Profile_Data_Packet_t* work,
+                             transmit_instructions_t* tx_instruct, const char* save_dir ) {
+
+  const char* const dir = stg_saved[scheme] ? save_dir : 0;
+
+  double const t0 = now_s();
+  uint16_t n;
+  for ( n=0; n<num_packets; n++ ) {
+    memcpy ( packet, raw+n, sizeof(Profile_Data_Packet_t) );
+    Profile_Data_Packet_t* out;
+    if ( STG_FORMER == scheme || STG_BY_VALUE == scheme ) {
+      out = staging_by_value ( packet, tx_instruct, dir );
+    } else {
+      out = packet_process ( packet, work, tx_instruct, dir ? staging_save : 0, (void*)dir );
+    }
+    if ( !out ) {
+      fprintf ( stderr, "%s staging failed on packet %hu\n", stg_name[scheme], n );
+      return -1;
+    }
+  }
+  return now_s() - t0;
+}
+
+//  Time a whole profile through the staging schemes:
+//  the former by-value staging, saving every stage to disk,
+//  and packet_process(), with and without its opt-in dump.
+//  Both the full pipeline and gray code and bitplanes only,
+//  where the stages do less work than the copies between them.
+//  The schemes take turns within each round, the fastest round is kept.
+//
+static int run_staging ( Profile_Data_Packet_t* raw, uint16_t num_packets, uint16_t noise_bits, int rounds ) {
+
+  transmit_instructions_t full  = { 32*1024, REP_GRAY, BITPLANE, 0, ZLIB,           ASCII85,     0, 0 };
+  transmit_instructions_t split = { 32*1024, REP_GRAY, BITPLANE, 0, NO_COMPRESSION, NO_ENCODING, 0, 0 };
+  full .noise_bits_remove = noise_bits;
+  split.noise_bits_remove = noise_bits;
+
+  struct { const char* name; transmit_instructions_t* tx; } const pipelines[2] = {
+    { "GBCE", &full }, { "GB", &split } };
+
+  char save_dir[] = "/tmp/pipeline_bench_XXXXXX";
+  if ( !mkdtemp ( save_dir ) ) {
+    fprintf ( stderr, "Cannot create a directory for the saved stages\n" );
+    return 2;
+  }
+
+  Profile_Data_Packet_t* packet = malloc ( 2*sizeof(Profile_Data_Packet_t) );
+  if ( !packet ) {
+    fprintf ( stderr, "Cannot allocate staging buffers\n" );
+    rmdir ( save_dir );
+    return 2;
+  }
+  Profile_Data_Packet_t* work = packet + 1;
+
+  double   best [2][NUM_STG];
+  uint64_t bytes[2][NUM_STG];
+  int rv = 0;
+
+  int r, p, s;
+  for ( r=0; !rv && r<rounds; r++ ) {
+    for ( p=0; !rv && p<2; p++ ) {
+      for ( s=0; !rv && s<NUM_STG; s++ ) {
+        staging_bytes = 0;
+        double const t = time_staging ( s, raw, num_packets, packet, work, pipelines[p].tx, save_dir );
+        if ( t < 0 ) { rv = 2; break; }
+        if ( 0 == r || t < best[p][s] ) best[p][s] = t;
+        bytes[p][s] = staging_bytes;
+      }
+    }
+  }
+
+  free ( packet );
+
+  char rm[64];
+  snprintf ( rm, sizeof(rm), "rm -rf %s", save_dir );
+  if ( system ( rm ) ) {
+    fprintf ( stderr, "Cannot remove '%s'\n", save_dir );
+  }
+
+  if ( rv ) return rv;
+
+  printf ( "staging,stages,saved,packets,packet_size,staging_bytes,seconds_per_profile,of_former\n" );
+  for ( p=0; p<2; p++ ) {
+    for ( s=0; s<NUM_STG; s++ ) {
+      printf ( "%s,%s,%d,%hu,%lu,%llu,%.6f,%.3f\n", stg_name[s], pipelines[p].name, stg_saved[s],
+               num_packets, (unsigned long)sizeof(Profile_Data_Packet_t),
+               (unsigned long long)bytes[p][s], best[p][s], best[p][s]/best[p][STG_FORMER] );
+    }
+  }
+
+  return 0;
+}
+
+//  Time gray code decoding of num_packets full packets' worth of pixels:
+//  bit loop reference, scalar prefix XOR and the spectrum (vector) path.
+//
+static int run_gray_bench ( Profile_Data_Packet_t* raw, uint16_t num_packets, uint16_t number_of_data, int rounds ) {
+
+  uint32_t const npix = (uint32_t)number_of_data*N_SPEC_PIX;
+  uint16_t* gray = malloc ( (size_t)num_packets*npix*sizeof(uint16_t) );
+  uint16_t* bin  = malloc ( (size_t)num_packets*npix*sizeof(uint16_t) );
+  if ( !gray || !bin ) {
+    fprintf ( stderr, "Cannot allocate gray code buffers\n" );
+    free ( gray ); free ( bin );
+    return 2;
+  }
+
+  uint16_t n;
+  uint32_t p;
+  for ( n=0; n<num_packets; n++ ) {
+    uint16_t const* px = (uint16_t*)raw[n].contents.structured.sensor_data.bitplanes;
+    for ( p=0; p<npix; p++ ) {
+      gray[n*npix+p] = px[p] ^ ( px[p] >> 1 );
+    }
+  }
+
+  static const char* const method[3] = { "bit_loop", "prefix_xor", "prefix_xor_spectrum" };
+  double best[3] = { 0, 0, 0 };
+  uint32_t check[3] = { 0, 0, 0 };
+
+  int r, m;
+  for ( r=0; r<rounds; r++ ) {
+    for ( m=0; m<3; m++ ) {
+      double const t0 = now_s();
+      for ( n=0; n<num_packets; n++ ) {
+        uint16_t const* g = gray + n*npix;
+        uint16_t      * b = bin  + n*npix;
+        switch ( m ) {
+        case 0: for ( p=0; p<npix; p++ ) b[p] = reference_gray2bin ( g[p] ); break;
+        case 1: for ( p=0; p<npix; p++ ) b[p] = data_packet_gray2bin_pixel ( g[p] ); break;
+        case 2: data_packet_gray2bin_pixels ( g, b, npix ); break;
+        }
+      }
+      double const t1 = now_s();
+      if ( 0 == r || t1-t0 < best[m] ) best[m] = t1-t0;
+
+      //  Keep the results alive and comparable
+      uint32_t sum = 0;
+      for ( p=0; p<(uint32_t)num_packets*npix; p++ ) sum = sum*31 + bin[p];
+      check[m] = sum;
+    }
+  }
+
+  free ( gray );
+  free ( bin );
+
+  uint64_t const pixels = (uint64_t)num_packets*npix;
+  printf ( "gray2bin,pixels,seconds,ns_per_pixel,MB_per_s,speedup\n" );
+  for ( m=0; m<3; m++ ) {
+    printf ( "%s,%llu,%.6f,%.3f,%.1f,%.1f\n", method[m], (unsigned long long)pixels, best[m],
+             1e9*best[m]/pixels, 2.0*pixels/best[m]/1e6, best[0]/best[m] );
+  }
+
+  if ( check[1] != check[0] || check[2] != check[0] ) {
+    fprintf ( stderr, "Gray code methods disagree\n" );
+    return 1;
+  }
+  return 0;
+}
+
+static double mb_per_s ( Stage_Result_t* r ) {
+  return r->seconds > 0 ? r->bytes_in / r->seconds / 1e6 : 0;
+}
+
+static void write_csv ( FILE* fp, Stage_Result_t result[NUM_STAGES], uint16_t num_packets ) {
+
+  fprintf ( fp, "stage,packets,bytes_in,bytes_out,seconds,MB_per_s,allocs_per_packet,alloc_bytes_per_packet,alloc_peak,ratio\n" );
+
+  int s;
+  for ( s=0; s<NUM_STAGES; s++ ) {
+    Stage_Result_t* r = result+s;
+    fprintf ( fp, "%s,%hu,%llu,%llu,%.6f,%.3f,%.2f,%.0f,%u,%.4f\n",
+              stage_name[s], num_packets,
+              (unsigned long long)r->bytes_in, (unsigned long long)r->bytes_out,
+              r->seconds, mb_per_s(r),
+              (double)r->allocs/num_packets, (double)r->alloc_bytes/num_packets, r->alloc_peak,
+              r->bytes_in ? (double)r->bytes_out/r->bytes_in : 0 );
+  }
+}
+
+//  Compare throughput against a baseline file.
+//  Returns the number of regressed stages, or -1 if the baseline is unusable.
+//
+static int check_baseline ( const char* baseline_file, Stage_Result_t result[NUM_STAGES], double tolerance ) {
+
+  FILE* fp = fopen ( baseline_file, "r" );
+  if ( !fp ) {
+    fprintf ( stderr, "Cannot open baseline '%s'\n", baseline_file );
+    return -1;
+  }
+
+  int regressed = 0;
+  int found = 0;
+  char line[256];
+
+  while ( fgets ( line, sizeof(line), fp ) ) {
+
+    char name[32];
+    double base_mbs;
+    if ( 2 != sscanf ( line, "%31[^,],%*[^,],%*[^,],%*[^,],%*[^,],%lf", name, &base_mbs ) ) {
+      continue;   //  header line
+    }
+
+    int s;
+    for ( s=0; s<NUM_STAGES; s++ ) {
+      if ( 0 == strcmp ( name, stage_name[s] ) ) {
+        double const current = mb_per_s ( result+s );
+        double const limit   = base_mbs * ( 1.0 - tolerance/100.0 );
+        found++;
+        if ( current < limit ) {
+          regressed++;
+          fprintf ( stderr, "REGRESSION %s: %.3f MB/s < %.3f MB/s (baseline %.3f, -%.0f%%)\n",
+                    name, current, limit, base_mbs, tolerance );
+        } else {
+          fprintf ( stderr, "ok         %s: %.3f MB/s (baseline %.3f)\n", name, current, base_mbs );
+        }
+      }
+    }
+  }
+
+  fclose ( fp );
+
+  if ( !found ) {
+    fprintf ( stderr, "Baseline '%s' has no stage entries\n", baseline_file );
+    return -1;
+  }
+
+  return regressed;
+}
+
+/******************************
+ *  Function: Main
+ */
+int main( int argc, char* argv[] ) {
+
+  uint16_t num_packets    = 128;
+  uint16_t number_of_data = MXHNV;
+  uint16_t noise_bits     = 0;
+  int      rounds         = 5;
+  long     seed           = 1;
+  char*    baseline_file  = 0;
+  char*    write_file     = 0;
+  double   tolerance      = 10.0;
+  int      check_only     = 0;
+  int      staging_only   = 0;
+  int      gray_only      = 0;
+
+  int opt;
+
+  for ( opterr=0; ( opt = getopt ( argc, argv, "?hcTGn:s:P:i:r:b:w:x:" ) ) != EOF ; ) {
+    switch ( opt ) {
+    case '?':
+    case 'h': print_usage(argv[0]); return 0;
+    case 'c': check_only     = 1; break;
+    case 'T': staging_only   = 1; break;
+    case 'G': gray_only      = 1; break;
+    case 'n': num_packets    = atoi ( optarg ); break;
+    case 's': number_of_data = atoi ( optarg ); break;
+    case 'P': noise_bits     = atoi ( optarg ); break;
+    case 'i': rounds         = atoi ( optarg ); break;
+    case 'r': seed           = atol ( optarg ); break;
+    case 'b': baseline_file  = optarg; break;
+    case 'w': write_file     = optarg; break;
+    case 'x': tolerance      = atof ( optarg ); break;
+    default : fprintf ( stderr, "%s: Ignoring unknown '-%c' option\n", argv[0], opt ); break;
+    }
+  }
+
+  if ( num_packets < 1 ) num_packets = 1;
+  if ( number_of_data < 1 || number_of_data > MXHNV ) number_of_data = MXHNV;
+  if ( noise_bits > 7 ) noise_bits = 7;   //  Never cut more than 7 bits
+  if ( rounds < 1 ) rounds = 1;
+
+  srandom ( seed );
+
+  if ( check_only ) {
+    return run_checks() ? 1 : 0;
+  }
+
+  Profile_Data_Packet_t* raw = malloc ( num_packets*sizeof(Profile_Data_Packet_t) );
+  if ( !raw ) {
+    fprintf ( stderr, "Cannot allocate %hu packets\n", num_packets );
+    return 2;
+  }
+
+  uint16_t n;
+  for ( n=0; n<num_packets; n++ ) {
+    make_raw_packet ( raw+n, n+1, number_of_data );
+  }
+
+  if ( staging_only ) {
+    int const rc = run_staging ( raw, num_packets, noise_bits, rounds );
+    free ( raw );
+    return rc;
+  }
+
+  if ( gray_only ) {
+    int const rc = run_gray_bench ( raw, num_packets, number_of_data, rounds );
+    free ( raw );
+    return rc;
+  }
+
+  //  Keep the fastest round of each stage
+  //
+  Stage_Result_t best[NUM_STAGES];
+  Stage_Result_t this_round[NUM_STAGES];
+
+  int r;
+  for ( r=0; r<rounds; r++ ) {
+    if ( run_round ( raw, num_packets, number_of_data, noise_bits, this_round ) ) {
+      free ( raw );
+      return 2;
+    }
+    int s;
+    for ( s=0; s<NUM_STAGES; s++ ) {
+      if ( 0 == r || this_round[s].seconds < best[s].seconds ) {
+        best[s] = this_round[s];
+      }
+    }
+  }
+
+  free ( raw );
+
+  write_csv ( stdout, best, num_packets );
+
+  if ( write_file ) {
+    FILE* fp = fopen ( write_file, "w" );
+    if ( !fp ) {
+      fprintf ( stderr, "Cannot write baseline '%s'\n", write_file );
+      return 2;
+    }
+    write_csv ( fp, best, num_packets );
+    fclose ( fp );
+  }
+
+  if ( baseline_file ) {
+    int const regressed = check_baseline ( baseline_file, best, tolerance );
+    if ( regressed < 0 ) return 2;
+    if ( regressed > 0 ) return 1;
+  }
+
+  return 0;
+}
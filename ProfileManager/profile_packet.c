@@ -7,7 +7,9 @@
 # include <sys/stat.h>
 # include <unistd.h>
 
-//# include "zlib.h"
+# include "zlib.h"
+
+# include "bitplane.h"
 
 # if 0
 
@@ -722,56 +724,167 @@ int data_packet_retrieve ( Profile_Data_Packet_t* p, const char* data_dir, const
 
 }
 
+# endif
+
+//  The processing stages below operate on the packet layout
+//  of profile_packet.shared.h: The spectra of a packet occupy
+//  the sensor_data area as number_of_data x N_SPEC_PIX uint16_t,
+//  the auxiliary data occupy spec_serial as number_of_data x SPEC_AUX_SERIAL_SIZE bytes.
+
+# define PACKET_PIXELS(p) ((uint16_t*)((p)->contents.structured.sensor_data.bitplanes))
+
+//  Counting allocator handed to zlib,
+//  so that heap use of the compression stage can be measured.
+//
+static uint32_t zalloc_calls = 0;
+static uint32_t zalloc_bytes = 0;
+static uint32_t zalloc_inuse = 0;
+static uint32_t zalloc_peak  = 0;
+
+static voidpf data_packet_zalloc ( voidpf opaque, uInt items, uInt size ) {
+
+  size_t const n = (size_t)items * size;
+  size_t* mem = malloc ( sizeof(size_t) + n );
+  if ( !mem ) return Z_NULL;
+
+  mem[0] = n;
+  zalloc_calls ++;
+  zalloc_bytes += n;
+  zalloc_inuse += n;
+  if ( zalloc_inuse > zalloc_peak ) zalloc_peak = zalloc_inuse;
+
+  return (voidpf)(mem+1);
+}
+
+static void data_packet_zfree ( voidpf opaque, voidpf address ) {
+
+  if ( !address ) return;
+
+  size_t* mem = ((size_t*)address) - 1;
+  zalloc_inuse -= mem[0];
+  free ( mem );
+}
+
+void data_packet_zalloc_stats ( uint32_t* calls, uint32_t* bytes, uint32_t* peak, int reset ) {
+
+  if ( calls ) *calls = zalloc_calls;
+  if ( bytes ) *bytes = zalloc_bytes;
+  if ( peak  ) *peak  = zalloc_peak;
+
+  if ( reset ) {
+    zalloc_calls = 0;
+    zalloc_bytes = 0;
+    zalloc_peak  = zalloc_inuse;
+  }
+}
+
+static uint16_t data_packet_number_of_data ( Profile_Data_Packet_t* packet ) {
+
+  char numString[5];
+  memcpy ( numString, packet->header.number_of_data, 4 );
+  numString[4] = 0;
+
+  uint16_t number_of_data = 0;
+  sscanf ( numString, "%hu", &number_of_data );
+
+  if ( number_of_data > MXHNV ) number_of_data = MXHNV;
+  return number_of_data;
+}
+
+static void data_packet_copy_ids ( Profile_Data_Packet_t* from, Profile_Data_Packet_t* to ) {
 
+  memcpy ( to->HYNV_num, from->HYNV_num, 2 );
+  memcpy ( to->PROF_num, from->PROF_num, 2 );
+  memcpy ( to->PCKT_num, from->PCKT_num, 2 );
+  to->header.sensor_type = from->header.sensor_type;
+  to->header.empty_space = from->header.empty_space;
+  memcpy ( to->header.sensor_ID, from->header.sensor_ID, 10 );
+  memcpy ( to->header.number_of_data, from->header.number_of_data, 4 );
+}
 
 int data_packet_bin2gray ( Profile_Data_Packet_t* bin, Profile_Data_Packet_t* gray ) {
 
   //  Make sure input packet data are in binary, not bitplaned,
   //  uncompressed and unencoded.
   //
-  if ( bin->representation != 'B'
-    || bin->noise_bits_removed != 'N'
-    || bin->compression != '0'
-    || bin->ASCII_encoding != 'N'
-    || !( bin->sensor_type == 'S' || bin->sensor_type == 'P' ) ) {
+  if ( bin->header.representation != 'B'
+    || bin->header.noise_bits_removed != 'N'
+    || bin->header.compression != '0'
+    || bin->header.ASCII_encoding != 'N'
+    || !( bin->header.sensor_type == 'S' || bin->header.sensor_type == 'P' ) ) {
 
-    fprintf ( stderr, "data_packet_bin2gray() fail %c %c %c %c %c\n", bin->representation, bin->noise_bits_removed, bin->compression, bin->ASCII_encoding, bin->sensor_type );
+    fprintf ( stderr, "data_packet_bin2gray() fail %c %c %c %c %c\n", bin->header.representation, bin->header.noise_bits_removed, bin->header.compression, bin->header.ASCII_encoding, bin->header.sensor_type );
     return (int16_t)1;
   }
-  
+
   //  Copy most of header and adjust some entries
   //
-  gray->HYNV_num    = bin->HYNV_num;
-  gray->PROF_num    = bin->PROF_num;
-  gray->PCKT_num    = bin->PCKT_num;
-  gray->sensor_type = bin->sensor_type;
-  gray->empty_space = bin->empty_space;
-  memcpy ( gray->sensor_ID, bin->sensor_ID, 10 );
-  memcpy ( gray->number_of_data, bin->number_of_data, 4 );
-  gray->representation     = 'G';
-  gray->noise_bits_removed = 'N';
-  gray->compression        = '0';
-  gray->ASCII_encoding     = 'N';
-  memcpy ( gray->compressed_sz, "      ", 6 );
-  memcpy ( gray->encoded_sz,    "      ", 6 );
-
-  uint16_t number_of_data, i, p;
-  sscanf ( gray->number_of_data, "%hu", &number_of_data );
+  data_packet_copy_ids ( bin, gray );
+  gray->header.representation     = 'G';
+  gray->header.noise_bits_removed = 'N';
+  gray->header.compression        = '0';
+  gray->header.ASCII_encoding     = 'N';
+  memcpy ( gray->header.compressed_sz, "      ", 6 );
+  memcpy ( gray->header.encoded_sz,    "      ", 6 );
+
+  uint16_t const number_of_data = data_packet_number_of_data ( bin );
+  uint16_t const* const b_px = PACKET_PIXELS(bin);
+  uint16_t      * const g_px = PACKET_PIXELS(gray);
+
   // convert pixels from binary to gray code
   //
-  for ( i=0; i<number_of_data; i++ ) {
-    for ( p=0; p<N_SPEC_PIX; p++ ) {
-      uint16_t const val = bin->contents.structured.sensor_data.pixel[i][p];
-      gray->contents.structured.sensor_data.pixel[i][p] = val ^ ( val >> 1 );
-    }
+  uint32_t p;
+  for ( p=0; p<(uint32_t)number_of_data*N_SPEC_PIX; p++ ) {
+    uint16_t const val = b_px[p];
+    g_px[p] = val ^ ( val >> 1 );
   }
 
   // copy auxiliary 'as is'
   //
-  memcpy ( gray->contents.structured.aux_data.spec_aux,
-            bin->contents.structured.aux_data.spec_aux,  number_of_data*sizeof(Spec_Aux_Data_t) );
-  
-  return 0;
+  memcpy ( gray->contents.structured.aux_data.spec_serial,
+            bin->contents.structured.aux_data.spec_serial,  number_of_data*SPEC_AUX_SERIAL_SIZE );
+
+  return (int16_t)0;
+}
+
+//  Gray code to binary: each binary bit is the XOR of its gray bit
+//  and all higher gray bits. A prefix XOR doubling the span per step
+//  takes 4 steps for 16 bits, whatever the value.
+//
+uint16_t data_packet_gray2bin_pixel ( uint16_t gray ) {
+  gray ^= gray >> 8;
+  gray ^= gray >> 4;
+  gray ^= gray >> 2;
+  gray ^= gray >> 1;
+  return gray;
+}
+
+# if defined(__GNUC__) && !defined(__AVR32__)
+//  Host builds: 16 pixels per GCC generic vector,
+//  compiled to SSE2/AVX2 or NEON as the target permits.
+typedef uint16_t gray_vector_t __attribute__ ((vector_size (32)));
+# define GRAY_VECTOR_PIX ( sizeof(gray_vector_t) / sizeof(uint16_t) )
+# endif
+
+void data_packet_gray2bin_pixels ( uint16_t const* gray, uint16_t* bin, uint32_t npix ) {
+
+  uint32_t p = 0;
+
+# ifdef GRAY_VECTOR_PIX
+  for ( ; p+GRAY_VECTOR_PIX <= npix; p += GRAY_VECTOR_PIX ) {
+    gray_vector_t v;
+    memcpy ( &v, gray+p, sizeof(v) );   //  pixels need not be vector aligned
+    v ^= v >> 8;
+    v ^= v >> 4;
+    v ^= v >> 2;
+    v ^= v >> 1;
+    memcpy ( bin+p, &v, sizeof(v) );
+  }
+# endif
+
+  for ( ; p<npix; p++ ) {
+    bin[p] = data_packet_gray2bin_pixel ( gray[p] );
+  }
 }
 
 int data_packet_gray2bin ( Profile_Data_Packet_t* gray, Profile_Data_Packet_t* bin ) {
@@ -779,128 +892,86 @@ int data_packet_gray2bin ( Profile_Data_Packet_t* gray, Profile_Data_Packet_t* b
   //  Make sure input packet data are in graycode, not bitplaned,
   //  uncompressed and unencoded.
   //
-  if ( gray->representation != 'G'
-    || gray->noise_bits_removed != 'N'
-    || gray->compression != '0'
-    || gray->ASCII_encoding != 'N'
-    || !( gray->sensor_type == 'S' || gray->sensor_type == 'P' ) ) {
-    fprintf ( stderr, "data_packet_gray2bin() fail %c %c %c %c %c\n", gray->representation, gray->noise_bits_removed, gray->compression, gray->ASCII_encoding, gray->sensor_type );
+  if ( gray->header.representation != 'G'
+    || gray->header.noise_bits_removed != 'N'
+    || gray->header.compression != '0'
+    || gray->header.ASCII_encoding != 'N'
+    || !( gray->header.sensor_type == 'S' || gray->header.sensor_type == 'P' ) ) {
+    fprintf ( stderr, "data_packet_gray2bin() fail %c %c %c %c %c\n", gray->header.representation, gray->header.noise_bits_removed, gray->header.compression, gray->header.ASCII_encoding, gray->header.sensor_type );
     return (int16_t)1;
   }
-  
+
   //  Copy most of header and adjust some entries
   //
-  bin->HYNV_num    = gray->HYNV_num;
-  bin->PROF_num    = gray->PROF_num;
-  bin->PCKT_num    = gray->PCKT_num;
-  bin->sensor_type = gray->sensor_type;
-  bin->empty_space = gray->empty_space;
-  memcpy ( bin->sensor_ID, gray->sensor_ID, 10 );
-  memcpy ( bin->number_of_data, gray->number_of_data, 4 );
-  bin->representation     = 'B';
-  bin->noise_bits_removed = 'N';
-  bin->compression        = '0';
-  bin->ASCII_encoding     = 'N';
-  memcpy ( bin->compressed_sz, "      ", 6 );
-  memcpy ( bin->encoded_sz,    "      ", 6 );
-
-  uint16_t number_of_data, i, p;
-  sscanf ( bin->number_of_data, "%hu", &number_of_data );
-  // convert pixels from binary to gray code
+  data_packet_copy_ids ( gray, bin );
+  bin->header.representation     = 'B';
+  bin->header.noise_bits_removed = 'N';
+  bin->header.compression        = '0';
+  bin->header.ASCII_encoding     = 'N';
+  memcpy ( bin->header.compressed_sz, "      ", 6 );
+  memcpy ( bin->header.encoded_sz,    "      ", 6 );
+
+  uint16_t const number_of_data = data_packet_number_of_data ( gray );
+  uint16_t const* const g_px = PACKET_PIXELS(gray);
+  uint16_t      * const b_px = PACKET_PIXELS(bin);
+
+  // convert pixels from gray code to binary
   //
-  for ( i=0; i<number_of_data; i++ ) {
-    for ( p=0; p<N_SPEC_PIX; p++ ) {
-      uint16_t val = gray->contents.structured.sensor_data.pixel[i][p];
-
-      uint16_t mask;
-      for ( mask = val>>1; mask != 0; mask >>= 1 ) {
-        val = val ^ mask;
-      }
-
-      bin->contents.structured.sensor_data.pixel[i][p] = val;
-    }
-  }
+  data_packet_gray2bin_pixels ( g_px, b_px, (uint32_t)number_of_data*N_SPEC_PIX );
 
   // copy auxiliary 'as is'
   //
-  memcpy (  bin->contents.structured.aux_data.spec_aux,
-           gray->contents.structured.aux_data.spec_aux,  number_of_data*sizeof(Spec_Aux_Data_t) );
-  
-  return 0;
+  memcpy (  bin->contents.structured.aux_data.spec_serial,
+           gray->contents.structured.aux_data.spec_serial,  number_of_data*SPEC_AUX_SERIAL_SIZE );
+
+  return (int16_t)0;
 }
 
 int data_packet_bitplane ( Profile_Data_Packet_t* pix, Profile_Data_Packet_t* bp, uint16_t remove_noise_bits ) {
 
   //  Make sure input packet is uncompressed and unencoded
   //  bitplaning can handle either binary or grayscale
-  if ( pix->noise_bits_removed != 'N'
-    || pix->compression != '0'
-    || pix->ASCII_encoding != 'N' ) {
+  if ( pix->header.noise_bits_removed != 'N'
+    || pix->header.compression != '0'
+    || pix->header.ASCII_encoding != 'N' ) {
     return (int16_t)1;
   }
 
   //  Copy most of header and adjust some entries
   //
-  bp->HYNV_num    = pix->HYNV_num;
-  bp->PROF_num    = pix->PROF_num;
-  bp->PCKT_num    = pix->PCKT_num;
-  bp->sensor_type = pix->sensor_type;
-  bp->empty_space = pix->empty_space;
-  memcpy ( bp->sensor_ID, pix->sensor_ID, 10 );
-  memcpy ( bp->number_of_data, pix->number_of_data, 4 );
-  bp->representation     = pix->representation;
+  data_packet_copy_ids ( pix, bp );
+  bp->header.representation     = pix->header.representation;
   char numString[4];
   if ( remove_noise_bits > 0x0F ) remove_noise_bits = 0x0F;
   snprintf ( numString, 2, "%hx", remove_noise_bits );
-  bp->noise_bits_removed = numString[0];
-  bp->compression        = '0';
-  bp->ASCII_encoding     = 'N';
+  bp->header.noise_bits_removed = numString[0];
+  bp->header.compression        = '0';
+  bp->header.ASCII_encoding     = 'N';
 
-  memcpy ( bp->compressed_sz, "      ", 6 );
-  memcpy ( bp->encoded_sz,    "      ", 6 );
+  memcpy ( bp->header.compressed_sz, "      ", 6 );
+  memcpy ( bp->header.encoded_sz,    "      ", 6 );
 
-  uint16_t number_of_data, i, p;
-  sscanf ( bp->number_of_data, "%hu", &number_of_data );
+  uint16_t const number_of_data = data_packet_number_of_data ( pix );
+  uint16_t const* const px = PACKET_PIXELS(pix);
 
   //  Bitplane the pixels
   //
+  uint32_t const npix       = (uint32_t)number_of_data*N_SPEC_PIX;
+  uint16_t const num_planes = 16 - remove_noise_bits;
+  uint32_t const plane_item = num_planes * (npix/8);
 
-  uint16_t low_mask = 0x0001 << remove_noise_bits;
-  uint16_t bit_mask;
-  uint16_t plane_item = 0;
-  for ( bit_mask = 0x8000; bit_mask >= low_mask; bit_mask >>= 1 ) {
-
-    uint8_t  plane_byte = 0;
-    uint8_t  plane_mask = 0x80;
+  bitplane_transpose ( px, npix, bp->contents.structured.sensor_data.bitplanes, npix/8, 15, num_planes );
 
-    for ( i=0; i<number_of_data; i++ ) {
-    for ( p=0; p<N_SPEC_PIX; p++ ) {
-      uint16_t const val = pix->contents.structured.sensor_data.pixel[i][p];
-
-      if ( val & bit_mask ) {
-        plane_byte |= plane_mask;
-      }
-
-      if ( 0x01 != plane_mask ) {
-        plane_mask >>= 1;
-      } else {
-        bp->contents.structured.sensor_data.bitplanes[plane_item] = plane_byte;
-        plane_item++;
-        plane_byte = 0;
-        plane_mask = 0x80;
-      }
-
-    }
-    }
-
-  }
-//fprintf ( stderr, "data_packet_bitplane() converted %hd items\n", plane_item );
+  //  Planes of removed noise bits are left zero
+  //
+  memset ( bp->contents.structured.sensor_data.bitplanes + plane_item, 0,
+           (uint32_t)number_of_data*N_SPEC_PIX*2 - plane_item );
 
   //  copy auxiliary 'as is'
   //
-  memcpy ( bp->contents.structured.aux_data.spec_aux,
-          pix->contents.structured.aux_data.spec_aux,  number_of_data*sizeof(Spec_Aux_Data_t) );
-  
+  memcpy ( bp->contents.structured.aux_data.spec_serial,
+          pix->contents.structured.aux_data.spec_serial,  number_of_data*SPEC_AUX_SERIAL_SIZE );
+
   return (int16_t)0;
 }
 
@@ -908,82 +979,45 @@ int data_packet_debitplane ( Profile_Data_Packet_t* bp, Profile_Data_Packet_t* p
 
   //  Make sure input packet is uncompressed and unencoded
   //  bitplaning can handle either binary or grayscale
-  if ( bp->compression != '0'
-    || bp->ASCII_encoding != 'N' ) {
+  if ( bp->header.compression != '0'
+    || bp->header.ASCII_encoding != 'N' ) {
     return (int16_t)1;
   }
 
   //  Copy most of header and adjust some entries
   //
-  pix->HYNV_num    = bp->HYNV_num;
-  pix->PROF_num    = bp->PROF_num;
-  pix->PCKT_num    = bp->PCKT_num;
-  pix->sensor_type = bp->sensor_type;
-  pix->empty_space = bp->empty_space;
-  memcpy ( pix->sensor_ID, bp->sensor_ID, 10 );
-  memcpy ( pix->number_of_data, bp->number_of_data, 4 );
-  pix->representation     = bp->representation;
+  data_packet_copy_ids ( bp, pix );
+  pix->header.representation     = bp->header.representation;
 
-  char numString[4];
-  uint16_t removed_noise_bits = bp->noise_bits_removed - '0';
+  uint16_t removed_noise_bits = 0;
+  char const nbr = bp->header.noise_bits_removed;
+  if      ( '0' <= nbr && nbr <= '9' ) removed_noise_bits = nbr - '0';
+  else if ( 'a' <= nbr && nbr <= 'f' ) removed_noise_bits = nbr - 'a' + 10;
+  else if ( 'A' <= nbr && nbr <= 'F' ) removed_noise_bits = nbr - 'A' + 10;
+  else return (int16_t)2;
 
-  pix->noise_bits_removed = 'N';  //  ALERT -- This is a loss of information
-  pix->compression        = '0';
-  pix->ASCII_encoding     = 'N';
+  pix->header.noise_bits_removed = 'N';  //  ALERT -- This is a loss of information
+  pix->header.compression        = '0';
+  pix->header.ASCII_encoding     = 'N';
 
-  memcpy ( pix->compressed_sz, "      ", 6 );
-  memcpy ( pix->encoded_sz,    "      ", 6 );
+  memcpy ( pix->header.compressed_sz, "      ", 6 );
+  memcpy ( pix->header.encoded_sz,    "      ", 6 );
 
-  uint16_t number_of_data, i, p;
-  sscanf ( bp->number_of_data, "%hu", &number_of_data );
+  uint16_t const number_of_data = data_packet_number_of_data ( bp );
+  uint16_t* const px = PACKET_PIXELS(pix);
 
   //  De-Bitplane the pixels
   //
 
-    //  Initialize all to zero
-    for ( i=0; i<number_of_data; i++ ) {
-    for ( p=0; p<N_SPEC_PIX; p++ ) {
-        pix->contents.structured.sensor_data.pixel[i][p] = 0;
-    }
-    }
-
-  uint16_t low_mask = 0x0001 << removed_noise_bits;
-  uint16_t bit_mask;
-  uint16_t plane_item = 0;
-  for ( bit_mask = 0x8000; bit_mask >= low_mask; bit_mask >>= 1 ) {
-
-    uint8_t  plane_byte = 0;
-    uint8_t  plane_mask = 0x80;
-
-    for ( i=0; i<number_of_data; i++ ) {
-    for ( p=0; p<N_SPEC_PIX; p++ ) {
-
-      if ( 0x80 == plane_mask ) {
-        plane_byte = bp->contents.structured.sensor_data.bitplanes[plane_item];
-
-      }
-
-      if ( plane_byte & plane_mask ) {
-        pix->contents.structured.sensor_data.pixel[i][p] |= bit_mask;
-      }
-
-      if ( 0x01 != plane_mask ) {
-        plane_mask >>= 1;
-      } else {
-        plane_item++;
-        plane_mask = 0x80;
-      }
-
-    }
-    }
-
-  }
+  //  Bits of removed noise planes are set to zero
+  uint32_t const npix = (uint32_t)number_of_data*N_SPEC_PIX;
+  bitplane_untranspose ( bp->contents.structured.sensor_data.bitplanes, npix/8, 15, 16-removed_noise_bits, px, npix );
 
   //  copy auxiliary 'as is'
   //
-  memcpy ( pix->contents.structured.aux_data.spec_aux,
-            bp->contents.structured.aux_data.spec_aux,  number_of_data*sizeof(Spec_Aux_Data_t) );
-  
+  memcpy ( pix->contents.structured.aux_data.spec_serial,
+            bp->contents.structured.aux_data.spec_serial,  number_of_data*SPEC_AUX_SERIAL_SIZE );
+
   return (int16_t)0;
 }
 
@@ -991,8 +1025,8 @@ int data_packet_compress ( Profile_Data_Packet_t* unc, Profile_Data_Packet_t* co
 
   //  Make sure input packet is uncompressed and unencoded
   //  bitplaning can handle either binary or grayscale
-  if ( unc->compression != '0'
-    || unc->ASCII_encoding != 'N' ) {
+  if ( unc->header.compression != '0'
+    || unc->header.ASCII_encoding != 'N' ) {
     return (int16_t)1;
   }
 
@@ -1002,22 +1036,16 @@ int data_packet_compress ( Profile_Data_Packet_t* unc, Profile_Data_Packet_t* co
 
   //  Copy most of header and adjust some entries
   //
-  com->HYNV_num    = unc->HYNV_num;
-  com->PROF_num    = unc->PROF_num;
-  com->PCKT_num    = unc->PCKT_num;
-  com->sensor_type = unc->sensor_type;
-  com->empty_space = unc->empty_space;
-  memcpy ( com->sensor_ID, unc->sensor_ID, 10 );
-  memcpy ( com->number_of_data, unc->number_of_data, 4 );
-  com->representation     = unc->representation;
-  com->noise_bits_removed = unc->noise_bits_removed;
-  com->compression        = algorithm;
-  com->ASCII_encoding     = 'N';
-
-  memcpy ( com->encoded_sz,    "      ", 6 );
-
-  uint16_t number_of_data, i, p;
-  sscanf ( unc->number_of_data, "%hu", &number_of_data );
+  data_packet_copy_ids ( unc, com );
+  com->header.representation     = unc->header.representation;
+  com->header.noise_bits_removed = unc->header.noise_bits_removed;
+  com->header.compression        = algorithm;
+  com->header.ASCII_encoding     = 'N';
+
+  memcpy ( com->header.encoded_sz,    "      ", 6 );
+
+  uint16_t const number_of_data = data_packet_number_of_data ( unc );
+  uint32_t const out_sz = sizeof(com->contents.flat_bytes);
 
   //  Compress bitplanes and auxiliary data using zlib
   //
@@ -1026,9 +1054,9 @@ int data_packet_compress ( Profile_Data_Packet_t* unc, Profile_Data_Packet_t* co
     int rv;
 
     z_stream strm;
-    strm.zalloc  = Z_NULL;   //  FIXME
-    strm.zfree   = Z_NULL;   //  FIXME
-    strm.opaque  = Z_NULL;   //  FIXME
+    strm.zalloc  = data_packet_zalloc;
+    strm.zfree   = data_packet_zfree;
+    strm.opaque  = Z_NULL;
     int level    = Z_DEFAULT_COMPRESSION; // 0..9
     int method   = Z_DEFLATED;
     int windowBits = 15;   // 9..15  Memory used = 1<<(windowBits+2)  **** when using 8, as permitted according to DOC, get failure at inflate()  ****
@@ -1041,94 +1069,78 @@ int data_packet_compress ( Profile_Data_Packet_t* unc, Profile_Data_Packet_t* co
 
     if ( Z_OK != deflateInit2 ( &strm, level, method, windowBits, memLevel, strategy ) ) {
       fprintf ( stderr, "deflateInit2() failed\n" );
+      return (int16_t)3;
     }
 
     strm.avail_in = number_of_data*2*N_SPEC_PIX;
     strm.next_in  = unc->contents.structured.sensor_data.bitplanes;
 
-    strm.avail_out = FLAT_SZ;
+    strm.avail_out = out_sz;
     strm.next_out  = com->contents.flat_bytes;
 
-# if 1
     if ( Z_STREAM_ERROR ==  (rv = deflate ( &strm, Z_NO_FLUSH ) ) ) {
       fprintf ( stderr, "deflate() failed %d\n", rv );
     }
 
-    int done_1 = FLAT_SZ-strm.avail_out;
-    //fprintf ( stderr, "deflate() outBP %d -> %d\n", number_of_data*2*N_SPEC_PIX, done_1 );
+    int done_1 = out_sz-strm.avail_out;
 
     if ( strm.avail_in ) {
       fprintf ( stderr, "deflate() did not consume all input %d\n", strm.avail_in );
     }
 
-    strm.avail_in = number_of_data*sizeof(Spec_Aux_Data_t);
-    strm.next_in  = (Bytef*)unc->contents.structured.aux_data.spec_aux;
+    strm.avail_in = number_of_data*SPEC_AUX_SERIAL_SIZE;
+    strm.next_in  = (Bytef*)unc->contents.structured.aux_data.spec_serial;
 
-    strm.avail_out = FLAT_SZ - done_1;
+    strm.avail_out = out_sz - done_1;
     strm.next_out  = com->contents.flat_bytes + done_1;
 
     if ( Z_STREAM_END != (rv = deflate ( &strm, Z_FINISH ) ) ) {
       fprintf ( stderr, "deflate() failed to finish (%d)\n", rv );
+      (void)deflateEnd ( &strm );
+      return (int16_t)4;
     }
 
-    int done_2 = (FLAT_SZ-done_1) - strm.avail_out;
-    //fprintf ( stderr, "deflate() outAUX %d -> %d\n", number_of_data*sizeof(Spec_Aux_Data_t), done_2 );
+    int done_2 = (out_sz-done_1) - strm.avail_out;
 
     (void)deflateEnd ( &strm );
 
     uint16_t total  = done_1 + done_2;
-    //fprintf ( stderr, "deflate() out total %d -> %hd\n", number_of_data*2*N_SPEC_PIX+number_of_data*sizeof(Spec_Aux_Data_t), total );
-
-# else
-    if ( Z_STREAM_END != (rv = deflate ( &strm, Z_FINISH ) ) ) {
-      fprintf ( stderr, "deflate() failed to finish (%d)\n", rv );
-    }
-
-    int done_1 = FLAT_SZ-strm.avail_out;
 
-    (void)deflateEnd ( &strm );
-
-    uint16_t total  = done_1;
-    fprintf ( stderr, "deflate() out total %d -> %hd\n", number_of_data*2*N_SPEC_PIX, total );
-# endif
-
-    char numString[8]; 
-    snprintf ( numString, 7, "% 6hu", total );
-    memcpy ( com->compressed_sz, numString, 6 );
+    char numString[8];
+    snprintf ( numString, 7, "%6hu", total );
+    memcpy ( com->header.compressed_sz, numString, 6 );
   }
-  
+
   return (int16_t)0;
 }
 
 int data_packet_uncompress ( Profile_Data_Packet_t* cmp, Profile_Data_Packet_t* ucp ) {
   //  Make sure input packet is compressed and unencoded
   //  bitplaning can handle either binary or grayscale
-  if ( cmp->compression != 'G'
-    || cmp->ASCII_encoding != 'N' ) {
+  if ( cmp->header.compression != 'G'
+    || cmp->header.ASCII_encoding != 'N' ) {
     return (int16_t)1;
   }
 
   //  Copy most of header and adjust some entries
   //
-  ucp->HYNV_num    = cmp->HYNV_num;
-  ucp->PROF_num    = cmp->PROF_num;
-  ucp->PCKT_num    = cmp->PCKT_num;
-  ucp->sensor_type = cmp->sensor_type;
-  ucp->empty_space = cmp->empty_space;
-  memcpy ( ucp->sensor_ID, cmp->sensor_ID, 10 );
-  memcpy ( ucp->number_of_data, cmp->number_of_data, 4 );
-  ucp->representation     = cmp->representation;
-  ucp->noise_bits_removed = cmp->noise_bits_removed;
-  ucp->compression        = '0';
-  ucp->ASCII_encoding     = 'N';
-
-  memcpy ( ucp->encoded_sz,    "      ", 6 );
-
-  uint16_t number_of_data;
-  sscanf ( cmp->number_of_data, "%hu", &number_of_data );
-
-  uint16_t number_of_bytes;
-  sscanf ( cmp->compressed_sz, "%hu", &number_of_bytes );
+  data_packet_copy_ids ( cmp, ucp );
+  ucp->header.representation     = cmp->header.representation;
+  ucp->header.noise_bits_removed = cmp->header.noise_bits_removed;
+  ucp->header.compression        = '0';
+  ucp->header.ASCII_encoding     = 'N';
+
+  memcpy ( ucp->header.encoded_sz,    "      ", 6 );
+
+  uint16_t const number_of_data = data_packet_number_of_data ( cmp );
+
+  char numString[8];
+  memcpy ( numString, cmp->header.compressed_sz, 6 );
+  numString[6] = 0;
+  uint16_t number_of_bytes = 0;
+  sscanf ( numString, "%hu", &number_of_bytes );
+
+  uint32_t const out_sz = sizeof(ucp->contents.flat_bytes);
 
   //  Uncompress via zlib and rebuild bitplanes and auxiliary data
   //
@@ -1138,8 +1150,8 @@ int data_packet_uncompress ( Profile_Data_Packet_t* cmp, Profile_Data_Packet_t*
 
     z_stream strm;
 
-    strm.zalloc  = Z_NULL;
-    strm.zfree   = Z_NULL;
+    strm.zalloc  = data_packet_zalloc;
+    strm.zfree   = data_packet_zfree;
     strm.opaque  = Z_NULL;
     strm.avail_in = 0;
     strm.next_in = Z_NULL;
@@ -1149,12 +1161,13 @@ int data_packet_uncompress ( Profile_Data_Packet_t* cmp, Profile_Data_Packet_t*
 
     if ( Z_OK != inflateInit2 ( &strm, windowBits ) ) {
       fprintf ( stderr, "inflateInit2() failed\n" );
+      return (int16_t)3;
     }
 
     strm.avail_in = (int)number_of_bytes;
     strm.next_in  = cmp->contents.flat_bytes;
 
-    strm.avail_out = FLAT_SZ;
+    strm.avail_out = out_sz;
     strm.next_out  = ucp->contents.flat_bytes;
 
     rv = inflate ( &strm, Z_FINISH );
@@ -1164,29 +1177,29 @@ int data_packet_uncompress ( Profile_Data_Packet_t* cmp, Profile_Data_Packet_t*
     case Z_DATA_ERROR:
     case Z_MEM_ERROR:
       fprintf ( stderr, "inflate() failed %d\n", rv );
+      (void)inflateEnd ( &strm );
+      return (int16_t)4;
     }
 
-    uint16_t uncompressed_sz = FLAT_SZ-strm.avail_out;
-
- // fprintf ( stderr, "inflate() out %hu -> %hu [have open space of %d]\n", number_of_bytes, uncompressed_sz, strm.avail_out );
+    uint32_t uncompressed_sz = out_sz-strm.avail_out;
 
     (void)inflateEnd ( &strm );
 
-    if ( uncompressed_sz != number_of_data*2*N_SPEC_PIX+number_of_data*sizeof(Spec_Aux_Data_t) ) {
-      fprintf ( stderr, "data_packet_uncompress() uncompressed to unexpected size: %hu instead of %d\n",
-             uncompressed_sz, number_of_data*2*N_SPEC_PIX+number_of_data*sizeof(Spec_Aux_Data_t) );
+    if ( uncompressed_sz != number_of_data*2*N_SPEC_PIX+number_of_data*SPEC_AUX_SERIAL_SIZE ) {
+      fprintf ( stderr, "data_packet_uncompress() uncompressed to unexpected size: %u instead of %d\n",
+             uncompressed_sz, number_of_data*2*N_SPEC_PIX+number_of_data*SPEC_AUX_SERIAL_SIZE );
     }
 
     //  The first part (spectrum) of the flat_bytes already overlays the bitplanes array.
     //
     //  The second part (auxiliary) is copied:
-    memmove ( ucp->contents.structured.aux_data.spec_aux,
+    memmove ( ucp->contents.structured.aux_data.spec_serial,
              (ucp->contents.flat_bytes)+number_of_data*2*N_SPEC_PIX,
-              number_of_data*sizeof(Spec_Aux_Data_t) );
+              number_of_data*SPEC_AUX_SERIAL_SIZE );
 
-    memcpy ( ucp->compressed_sz, "      ", 6 );
+    memcpy ( ucp->header.compressed_sz, "      ", 6 );
   }
-  
+
   return (int16_t)0;
 }
 
@@ -1195,8 +1208,8 @@ int data_packet_encode ( Profile_Data_Packet_t* unenc, Profile_Data_Packet_t* en
   //  Make sure input packet is compressed and unencoded
   //  TODO: Add ability to encode ANY packet
 
-  if ( unenc->compression == '0'
-    || unenc->ASCII_encoding != 'N' ) {
+  if ( unenc->header.compression == '0'
+    || unenc->header.ASCII_encoding != 'N' ) {
     return (int16_t)1;
   }
 
@@ -1209,47 +1222,46 @@ int data_packet_encode ( Profile_Data_Packet_t* unenc, Profile_Data_Packet_t* en
 
   //  Copy most of header and adjust some entries
   //
-  enc->HYNV_num    = unenc->HYNV_num;
-  enc->PROF_num    = unenc->PROF_num;
-  enc->PCKT_num    = unenc->PCKT_num;
-  enc->sensor_type = unenc->sensor_type;
-  enc->empty_space = unenc->empty_space;
-  memcpy ( enc->sensor_ID, unenc->sensor_ID, 10 );
-  memcpy ( enc->number_of_data, unenc->number_of_data, 4 );
-  enc->representation     = unenc->representation;
-  enc->noise_bits_removed = unenc->noise_bits_removed;
-  enc->compression        = unenc->compression;
-  enc->ASCII_encoding     = encoding;
-
-  memcpy ( enc->compressed_sz, unenc->compressed_sz, 6 );
-
-  uint16_t number_of_bytes;
-  sscanf ( unenc->compressed_sz, "%hu", &number_of_bytes );
+  data_packet_copy_ids ( unenc, enc );
+  enc->header.representation     = unenc->header.representation;
+  enc->header.noise_bits_removed = unenc->header.noise_bits_removed;
+  enc->header.compression        = unenc->header.compression;
+  enc->header.ASCII_encoding     = encoding;
+
+  memcpy ( enc->header.compressed_sz, unenc->header.compressed_sz, 6 );
+
+  char numString[8];
+  memcpy ( numString, unenc->header.compressed_sz, 6 );
+  numString[6] = 0;
+  uint16_t number_of_bytes = 0;
+  sscanf ( numString, "%hu", &number_of_bytes );
+
+  //  The encoded size is 5/4 of the input,
+  //  which must still fit into the packet.
+  //
+  if ( 5*((uint32_t)number_of_bytes+3)/4 > sizeof(enc->contents.flat_bytes) ) {
+    return (int16_t)3;
+  }
 
   //  Encode
   //
   uint16_t encoded_sz = 0;
 
-
-  fprintf ( stderr, "Encoding %hu bytes\n", number_of_bytes );
-
   uint16_t bytes = 0;
   uint32_t number = 0;
   uint16_t i;
   for ( i=0; i<number_of_bytes; i++ ) {
 
     uint8_t uByte = unenc->contents.flat_bytes[i];
-    number |= uByte << (24-(bytes*8));
+    number |= (uint32_t)uByte << (24-(bytes*8));
     bytes++;
 
     if ( 4 == bytes ) {
 
       if ( 0 == number ) {
         enc->contents.flat_bytes[encoded_sz++] = 'z';
-  fprintf ( stderr, "Encoding 'z'\n", number_of_bytes );
       } else if ( 0x20202020 == number ) {
         enc->contents.flat_bytes[encoded_sz++] = 'y';
-  fprintf ( stderr, "Encoding 'y'\n", number_of_bytes );
       } else {
 
         uint8_t encoded[5];
@@ -1271,7 +1283,6 @@ int data_packet_encode ( Profile_Data_Packet_t* unenc, Profile_Data_Packet_t* en
 
   if ( bytes ) {
 
-  fprintf ( stderr, "Encoding end %08x %d\n", number, bytes );
         uint8_t encoded[5];
         int idx;
         for ( idx=4; idx>=0; idx-- ) {
@@ -1282,57 +1293,136 @@ int data_packet_encode ( Profile_Data_Packet_t* unenc, Profile_Data_Packet_t* en
         encoded_sz += 1+bytes;
   }
 
-    char numString[8]; 
-    snprintf ( numString, 7, "% 6hu", encoded_sz );
-    memcpy ( enc->encoded_sz, numString, 6 );
+    snprintf ( numString, 7, "%6hu", encoded_sz );
+    memcpy ( enc->header.encoded_sz, numString, 6 );
 
   return (int16_t)0;
 }
 
+//  Repair burst j (1..nRepair) of a packet of nData bytes sent as numBursts
+//  equal bursts: the XOR of its data bursts j, j+nRepair, j+2*nRepair, ...
+//  The last, shorter data burst counts as padded with zeros.
+//  One of these bursts lost is the XOR of the repair burst and the others.
+//  Returns the size of a data burst, written to repair, or 0.
+//
+uint16_t data_packet_repair ( const unsigned char* data, uint16_t nData, int numBursts, int nRepair, int j, unsigned char* repair ) {
+
+  if ( !data || !repair || !nData || numBursts < 1 || nRepair < 1 || j < 1 || j > nRepair ) {
+    return 0;
+  }
+
+  uint16_t const bSize = 1 + ( nData - 1 ) / numBursts;
+  memset ( repair, 0, bSize );
+
+  int b;
+  for ( b=j; b<=numBursts; b+=nRepair ) {
+    const unsigned char* burst = data + (b-1)*bSize;
+    uint16_t const sz = ( b < numBursts ) ? bSize : nData - (numBursts-1)*bSize;
+    uint16_t i;
+    for ( i=0; i<sz; i++ ) {
+      repair[i] ^= burst[i];
+    }
+  }
+
+  return bSize;
+}
+
+//  Header of a burst framed in binary (see profile_packet.shared.h),
+//  BRSB_HEADER bytes written to header.
+//
+void data_packet_burst_header14 ( uint16_t hynv, uint16_t prof, uint16_t pckt, uint16_t burst, uint16_t value, unsigned char* header ) {
+
+  uint16_t const field[5] = { hynv, prof, pckt, burst, value };
+
+  memcpy ( header, "BRSB", 4 );
+
+  int f;
+  for ( f=0; f<5; f++ ) {
+    header[4+2*f  ] = (unsigned char) ( field[f] >> 8 );
+    header[4+2*f+1] = (unsigned char) ( field[f] & 0xFF );
+  }
+}
+
+//  ASCII85 encoding of nData bytes as by data_packet_encode(), but without
+//  the 'z' and 'y' abbreviations, such that any part of it can be encoded
+//  on its own: 5 characters per 4 bytes, n+1 for the last n < 4 bytes.
+//
+uint16_t data_packet_ascii85_size ( uint16_t nData ) {
+  return 5*(nData/4) + ( (nData%4) ? nData%4 + 1 : 0 );
+}
+
+//  Characters from .. from+size-1 of that encoding, written to out.
+//  Returns the number of characters written.
+//
+uint16_t data_packet_ascii85_range ( const unsigned char* data, uint16_t nData, uint16_t from, uint16_t size, unsigned char* out ) {
+
+  uint32_t const total = data_packet_ascii85_size ( nData );
+  uint32_t const to    = ( (uint32_t)from + size < total ) ? (uint32_t)from + size : total;
+
+  uint32_t c = from;
+  while ( c < to ) {
+
+    uint32_t const g     = c / 5;
+    uint16_t const bytes = ( nData - 4*g < 4 ) ? nData - 4*g : 4;
+
+    uint32_t number = 0;
+    uint16_t i;
+    for ( i=0; i<bytes; i++ ) {
+      number |= (uint32_t)data[4*g+i] << (24-(i*8));
+    }
+
+    uint8_t encoded[5];
+    int idx;
+    for ( idx=4; idx>=0; idx-- ) {
+      encoded[idx] = (uint8_t) ( (number%85) + 33 );
+      number /= 85;
+    }
+
+    uint16_t k;
+    for ( k=c%5; k<=bytes && c<to; k++, c++ ) {
+      *out++ = encoded[k];
+    }
+  }
+
+  return ( to > from ) ? to - from : 0;
+}
+
 int data_packet_decode ( Profile_Data_Packet_t* enc, Profile_Data_Packet_t* dec ) {
 
-  //  Make sure input packet is compressed and unencoded
-  //  TODO: Add ability to encode ANY packet
+  //  Make sure input packet is compressed and encoded
 
-  if ( enc->compression == '0'
-    || enc->ASCII_encoding == 'N' ) {
+  if ( enc->header.compression == '0'
+    || enc->header.ASCII_encoding == 'N' ) {
     return (int16_t)1;
   }
 
   //  encodings: 'A' == ASCII85
   //             'B' == BASE64
 
-  if ( enc->ASCII_encoding != 'A' /* || encoding != 'B' */ ) {
+  if ( enc->header.ASCII_encoding != 'A' /* || encoding != 'B' */ ) {
     return (int16_t)2;
   }
 
   //  Copy most of header and adjust some entries
   //
-  dec->HYNV_num    = enc->HYNV_num;
-  dec->PROF_num    = enc->PROF_num;
-  dec->PCKT_num    = enc->PCKT_num;
-  dec->sensor_type = enc->sensor_type;
-  dec->empty_space = enc->empty_space;
-  memcpy ( dec->sensor_ID, enc->sensor_ID, 10 );
-  memcpy ( dec->number_of_data, enc->number_of_data, 4 );
-  dec->representation     = enc->representation;
-  dec->noise_bits_removed = enc->noise_bits_removed;
-  dec->compression        = enc->compression;
-  dec->ASCII_encoding     = 'N';
-
-  memcpy ( dec->compressed_sz, enc->compressed_sz, 6 );
-
-  uint16_t compressed_sz;
-  sscanf ( enc->compressed_sz, "%hu", &compressed_sz );
+  data_packet_copy_ids ( enc, dec );
+  dec->header.representation     = enc->header.representation;
+  dec->header.noise_bits_removed = enc->header.noise_bits_removed;
+  dec->header.compression        = enc->header.compression;
+  dec->header.ASCII_encoding     = 'N';
+
+  memcpy ( dec->header.compressed_sz, enc->header.compressed_sz, 6 );
+
+  char numString[8];
+  memcpy ( numString, enc->header.encoded_sz, 6 );
+  numString[6] = 0;
   uint16_t encoded_sz = 0;
-  sscanf ( enc->encoded_sz, "%hu", &encoded_sz );
+  sscanf ( numString, "%hu", &encoded_sz );
 
   //  Decode
   //
   uint16_t decoded_sz = 0;
 
-  fprintf ( stderr, "Decoding %hu bytes\n", encoded_sz );
-
   uint16_t bytes = 0;
   uint32_t number = 0;
   const uint32_t pow85[5] = { 85u*85u*85u*85u, 85u*85u*85u, 85u*85u, 85u, 1u };
@@ -1375,98 +1465,74 @@ int data_packet_decode ( Profile_Data_Packet_t* enc, Profile_Data_Packet_t* dec
     return (int16_t)4;
   } else if ( 2 == bytes ) {
     number += 85L*85L*84L;
-    fprintf ( stderr, "Decoding end %08x 2->1\n", number );
     dec->contents.flat_bytes[decoded_sz++] = (uint8_t) ((number>>24)        );
   } else if ( 3 == bytes ) {
     number += 85L*84L;
-    fprintf ( stderr, "Decoding end %08x 3->2\n", number );
     dec->contents.flat_bytes[decoded_sz++] = (uint8_t) ((number>>24)        );
     dec->contents.flat_bytes[decoded_sz++] = (uint8_t) ((number>>16) & 0xFF );
   } else if ( 4 == bytes ) {
     number += 84;
-    fprintf ( stderr, "Decoding end %08x 4->3\n", number );
     dec->contents.flat_bytes[decoded_sz++] = (uint8_t) ((number>>24)        );
     dec->contents.flat_bytes[decoded_sz++] = (uint8_t) ((number>>16) & 0xFF );
     dec->contents.flat_bytes[decoded_sz++] = (uint8_t) ((number>> 8) & 0xFF );
-  } else if ( 5 == bytes ) {
-      fprintf ( stderr, "Decoding unexpected end of data\n" );
   }
 
-  fprintf ( stderr, "Decoded  %hu bytes\n", decoded_sz );
-
-  memcpy ( dec->encoded_sz, "      ", 6 );
+  memcpy ( dec->header.encoded_sz, "      ", 6 );
 
   return (int16_t)0;
 }
 
-# endif
-
 int data_packet_compare( Profile_Data_Packet_t* p1, Profile_Data_Packet_t* p2, char ID1, char ID2 ) {
 
   fprintf ( stderr, "Comparing %c %c\n", ID1, ID2 );
   uint16_t metaDiff = 0;
 
-  if ( p1->HYNV_num != p2->HYNV_num ) { metaDiff++; fprintf ( stderr, "Diff: HYNV_num '%hu' '%hu'\n", p1->HYNV_num, p2->HYNV_num ); }
-  if ( p1->PROF_num != p2->PROF_num ) { metaDiff++; fprintf ( stderr, "Diff: PROF_num '%hu' '%hu'\n", p1->PROF_num, p2->PROF_num ); }
-  if ( p1->PCKT_num != p2->PCKT_num ) { metaDiff++; fprintf ( stderr, "Diff: PCKT_num '%hu' '%hu'\n", p1->PCKT_num, p2->PCKT_num ); }
+  if ( memcmp( p1->HYNV_num, p2->HYNV_num, 2 ) ) { metaDiff++; fprintf ( stderr, "Diff: HYNV_num\n" ); }
+  if ( memcmp( p1->PROF_num, p2->PROF_num, 2 ) ) { metaDiff++; fprintf ( stderr, "Diff: PROF_num\n" ); }
+  if ( memcmp( p1->PCKT_num, p2->PCKT_num, 2 ) ) { metaDiff++; fprintf ( stderr, "Diff: PCKT_num\n" ); }
 
-  if ( p1->sensor_type != p2->sensor_type ) { metaDiff++; fprintf ( stderr, "Diff: sensor_type '%c' '%c'\n", p1->sensor_type, p2->sensor_type ); }
-  if ( p1->empty_space != p2->empty_space ) { metaDiff++; fprintf ( stderr, "Diff: empty_space '%c' '%c'\n", p1->empty_space, p2->empty_space ); }
-  if ( memcmp( p1->sensor_ID, p2->sensor_ID, 10 ) ) { metaDiff++; fprintf ( stderr, "Diff: sensor_ID '%10.10' '%10.10'\n", p1->sensor_ID, p2->sensor_ID ); }
-  if ( memcmp( p1->number_of_data, p2->number_of_data, 4 ) ) { metaDiff++; fprintf ( stderr, "Diff: number_of_data '%4.4s' '%4.4s'\n", p1->number_of_data, p2->number_of_data ); }
+  if ( p1->header.sensor_type != p2->header.sensor_type ) { metaDiff++; fprintf ( stderr, "Diff: sensor_type '%c' '%c'\n", p1->header.sensor_type, p2->header.sensor_type ); }
+  if ( p1->header.empty_space != p2->header.empty_space ) { metaDiff++; fprintf ( stderr, "Diff: empty_space '%c' '%c'\n", p1->header.empty_space, p2->header.empty_space ); }
+  if ( memcmp( p1->header.sensor_ID, p2->header.sensor_ID, 10 ) ) { metaDiff++; fprintf ( stderr, "Diff: sensor_ID '%10.10s' '%10.10s'\n", p1->header.sensor_ID, p2->header.sensor_ID ); }
+  if ( memcmp( p1->header.number_of_data, p2->header.number_of_data, 4 ) ) { metaDiff++; fprintf ( stderr, "Diff: number_of_data '%4.4s' '%4.4s'\n", p1->header.number_of_data, p2->header.number_of_data ); }
 
-  if ( p1->representation != p2->representation ) { metaDiff++; fprintf ( stderr, "Diff: representation '%c' '%c'\n", p1->representation, p2->representation ); }
-  if ( p1->noise_bits_removed != p2->noise_bits_removed ) { metaDiff++; fprintf ( stderr, "Diff: noise_bits_removed '%c' '%c'\n", p1->noise_bits_removed, p2->noise_bits_removed ); }
-  if ( p1->compression != p2->compression ) { metaDiff++; fprintf ( stderr, "Diff: compression '%c' '%c'\n", p1->compression, p2->compression ); }
-  if ( p1->ASCII_encoding != p2->ASCII_encoding ) { metaDiff++; fprintf ( stderr, "Diff: ASCII_encoding '%c' '%c'\n", p1->ASCII_encoding, p2->ASCII_encoding ); }
+  if ( p1->header.representation != p2->header.representation ) { metaDiff++; fprintf ( stderr, "Diff: representation '%c' '%c'\n", p1->header.representation, p2->header.representation ); }
+  if ( p1->header.noise_bits_removed != p2->header.noise_bits_removed ) { metaDiff++; fprintf ( stderr, "Diff: noise_bits_removed '%c' '%c'\n", p1->header.noise_bits_removed, p2->header.noise_bits_removed ); }
+  if ( p1->header.compression != p2->header.compression ) { metaDiff++; fprintf ( stderr, "Diff: compression '%c' '%c'\n", p1->header.compression, p2->header.compression ); }
+  if ( p1->header.ASCII_encoding != p2->header.ASCII_encoding ) { metaDiff++; fprintf ( stderr, "Diff: ASCII_encoding '%c' '%c'\n", p1->header.ASCII_encoding, p2->header.ASCII_encoding ); }
 
-  if ( memcmp( p1->compressed_sz, p2->compressed_sz, 6 ) ) { metaDiff++; fprintf ( stderr, "Diff: compressed_sz '%6.6s' '%6.6s'\n", p1->compressed_sz, p2->compressed_sz ); }
-  if ( memcmp( p1->encoded_sz, p2->encoded_sz, 6 ) ) { metaDiff++; fprintf ( stderr, "Diff: encoded_sz '%6.6s' '%6.6s'\n", p1->encoded_sz, p2->encoded_sz ); }
+  if ( memcmp( p1->header.compressed_sz, p2->header.compressed_sz, 6 ) ) { metaDiff++; fprintf ( stderr, "Diff: compressed_sz '%6.6s' '%6.6s'\n", p1->header.compressed_sz, p2->header.compressed_sz ); }
+  if ( memcmp( p1->header.encoded_sz, p2->header.encoded_sz, 6 ) ) { metaDiff++; fprintf ( stderr, "Diff: encoded_sz '%6.6s' '%6.6s'\n", p1->header.encoded_sz, p2->header.encoded_sz ); }
 
-  uint16_t number_of_data, d, p;
-  sscanf ( p1->number_of_data, "%hu", &number_of_data );
+  uint16_t const number_of_data = data_packet_number_of_data ( p1 );
 
   if ( metaDiff ) {
       fprintf ( stderr, "Not comparing %hu data spectra\n", number_of_data );
   } else {
-    if ( p1->noise_bits_removed == 'N'
-      && p1->compression == '0'
-      && p1->ASCII_encoding == 'N'
-      && ( p1->sensor_type == 'S' || p1->sensor_type == 'P' ) ) {
+    if ( p1->header.noise_bits_removed == 'N'
+      && p1->header.compression == '0'
+      && p1->header.ASCII_encoding == 'N'
+      && ( p1->header.sensor_type == 'S' || p1->header.sensor_type == 'P' ) ) {
+
+      uint16_t const* const px1 = PACKET_PIXELS(p1);
+      uint16_t const* const px2 = PACKET_PIXELS(p2);
 
+      uint16_t d, p;
       for ( d=0; d<number_of_data; d++ ) {
       for ( p=0; p<N_SPEC_PIX; p++ ) {
-        if ( p1->contents.structured.sensor_data.pixel[d][p]
-          != p2->contents.structured.sensor_data.pixel[d][p] ) {
-            metaDiff++; fprintf ( stderr, "Diff: px[%hu][%hu] '%04hx' '%04hx'\n", d, p, p1->contents.structured.sensor_data.pixel[d][p], p2->contents.structured.sensor_data.pixel[d][p] ); }
+        if ( px1[d*N_SPEC_PIX+p] != px2[d*N_SPEC_PIX+p] ) {
+            metaDiff++; fprintf ( stderr, "Diff: px[%hu][%hu] '%04hx' '%04hx'\n", d, p, px1[d*N_SPEC_PIX+p], px2[d*N_SPEC_PIX+p] ); }
       }
       }
 
-      Spec_Aux_Data_t* aux1 = p1->contents.structured.aux_data.spec_aux;
-      Spec_Aux_Data_t* aux2 = p2->contents.structured.aux_data.spec_aux;
-
       for ( d=0; d<number_of_data; d++ ) {
-        if ( aux1->integration_time != aux2->integration_time ) { metaDiff++; fprintf ( stderr, "Diff:aux:integration_time %hu %hu\n", aux1->integration_time, aux2->integration_time ); }
-        if ( aux1->sample_number != aux2->sample_number ) { metaDiff++; fprintf ( stderr, "Diff:aux:sample_number %hu %hu\n", aux1->sample_number, aux2->sample_number ); }
-        if ( aux1->dark_average != aux2->dark_average ) { metaDiff++; fprintf ( stderr, "Diff:aux:dark_average %hu %hu\n", aux1->dark_average, aux2->dark_average ); }
-        if ( aux1->dark_noise != aux2->dark_noise ) { metaDiff++; fprintf ( stderr, "Diff:aux:dark_noise %hu %hu\n", aux1->dark_noise, aux2->dark_noise ); }
-        if ( aux1->spectrometer_temperature != aux2->spectrometer_temperature ) { metaDiff++; fprintf ( stderr, "Diff:aux:spectrometer_temperature %hd %hd\n", aux1->spectrometer_temperature, aux2->spectrometer_temperature ); }
-        if ( aux1->acquisition_time.tv_sec != aux2->acquisition_time.tv_sec ) { metaDiff++; fprintf ( stderr, "Diff:aux:acquisition_time.tv_sec %d %d\n", aux1->acquisition_time.tv_sec, aux2->acquisition_time.tv_sec ); }
-        if ( aux1->acquisition_time.tv_usec != aux2->acquisition_time.tv_usec ) { metaDiff++; fprintf ( stderr, "Diff:aux:acquisition_time.tv_usec %d %d\n", aux1->acquisition_time.tv_usec, aux2->acquisition_time.tv_usec ); }
-        if ( aux1->pressure != aux2->pressure ) { metaDiff++; fprintf ( stderr, "Diff:aux:pressure %f %f\n", aux1->pressure, aux2->pressure ); }
-        if ( aux1->float_heading != aux2->float_heading ) { metaDiff++; fprintf ( stderr, "Diff:aux:float_heading %hu %hu\n", aux1->float_heading, aux2->float_heading ); }
-        if ( aux1->float_yaw != aux2->float_yaw ) { metaDiff++; fprintf ( stderr, "Diff:aux:float_yaw %hd %hd\n", aux1->float_yaw, aux2->float_yaw ); }
-        if ( aux1->float_roll != aux2->float_roll ) { metaDiff++; fprintf ( stderr, "Diff:aux:float_roll %hd %hd\n", aux1->float_roll, aux2->float_roll ); }
-        if ( aux1->radiometer_yaw != aux2->radiometer_yaw ) { metaDiff++; fprintf ( stderr, "Diff:aux:radiometer_yaw %hd %hd\n", aux1->radiometer_yaw, aux2->radiometer_yaw ); }
-        if ( aux1->radiometer_roll != aux2->radiometer_roll ) { metaDiff++; fprintf ( stderr, "Diff:aux:radiometer_roll %hd %hd\n", aux1->radiometer_roll, aux2->radiometer_roll ); }
-        if ( aux1->tag != aux2->tag ) { metaDiff++; fprintf ( stderr, "Diff:aux:tag %hu %hu\n", aux1->tag, aux2->tag ); }
-        if ( aux1->side != aux2->side ) { metaDiff++; fprintf ( stderr, "Diff:aux:side %hu %hu\n", aux1->side, aux2->side ); }
+        if ( memcmp ( p1->contents.structured.aux_data.spec_serial + d*SPEC_AUX_SERIAL_SIZE,
+                      p2->contents.structured.aux_data.spec_serial + d*SPEC_AUX_SERIAL_SIZE, SPEC_AUX_SERIAL_SIZE ) ) {
+          metaDiff++; fprintf ( stderr, "Diff:aux[%hu]\n", d );
+        }
       }
-
-      // fread ( &(p->contents.structured.aux_data.spec_aux), number_of_data*sizeof(Spec_Aux_Data_t), 1, fq);
     }
   }
 
   return metaDiff;
 }
-
@@ -13,15 +13,29 @@ int data_packet_save  ( Profile_Data_Packet_t* p, const char* data_dir, const ch
 int data_packet_fromBytes( Profile_Data_Packet_t* p, unsigned char* asBytes, uint16_t nBytes );
 
 int data_packet_retrieve ( Profile_Data_Packet_t* p, const char* data_dir, const char* type, uint16_t profile_id, uint16_t number_of_packet );
+# endif
+
 int data_packet_bin2gray ( Profile_Data_Packet_t* bin, Profile_Data_Packet_t* gray );
 int data_packet_gray2bin ( Profile_Data_Packet_t* gray, Profile_Data_Packet_t* bin );
+uint16_t data_packet_gray2bin_pixel  ( uint16_t gray );
+void     data_packet_gray2bin_pixels ( uint16_t const* gray, uint16_t* bin, uint32_t npix );
 int data_packet_bitplane ( Profile_Data_Packet_t* pix, Profile_Data_Packet_t* bp, uint16_t remove_noise_bits );
 int data_packet_debitplane ( Profile_Data_Packet_t* bp, Profile_Data_Packet_t* pix );
 int data_packet_compress ( Profile_Data_Packet_t* unc, Profile_Data_Packet_t* com, char algorithm );
 int data_packet_uncompress ( Profile_Data_Packet_t* cmp, Profile_Data_Packet_t* ucp );
 int data_packet_encode ( Profile_Data_Packet_t* unenc, Profile_Data_Packet_t* enc, char encoding );
 int data_packet_decode ( Profile_Data_Packet_t* dec, Profile_Data_Packet_t* enc );
-# endif
+
+//  Repair burst j of a packet sent as numBursts bursts, see profile_receive.c
+uint16_t data_packet_repair ( const unsigned char* data, uint16_t nData, int numBursts, int nRepair, int j, unsigned char* repair );
+
+//  Binary framing, and ASCII85 encoding of any part of a packet, see profile_packet.shared.h
+void     data_packet_burst_header14 ( uint16_t hynv, uint16_t prof, uint16_t pckt, uint16_t burst, uint16_t value, unsigned char* header );
+uint16_t data_packet_ascii85_size   ( uint16_t nData );
+uint16_t data_packet_ascii85_range  ( const unsigned char* data, uint16_t nData, uint16_t from, uint16_t size, unsigned char* out );
+
+//  Allocations made by zlib on behalf of (un)compress since the last reset
+void data_packet_zalloc_stats ( uint32_t* calls, uint32_t* bytes, uint32_t* peak, int reset );
 
 int data_packet_compare( Profile_Data_Packet_t* p1, Profile_Data_Packet_t* p2, char ID1, char ID2 );
 
@@ -1,12 +1,19 @@
+# define _GNU_SOURCE   //  accept4()
+
 # include "profile_receive.h"
 
 # include <errno.h>
+# include <fcntl.h>
+# include <signal.h>
+# include <stddef.h>
 # include <stdio.h>
 # include <stdlib.h>
 # include <string.h>
-# include <sys/ioctl.h>
+# include <time.h>
 # include <unistd.h>
 
+# include <sys/epoll.h>
+# include <sys/stat.h>
 # include <sys/types.h>
 # include <sys/socket.h>
 # include <netinet/in.h>
@@ -14,897 +21,1873 @@
 
 # include "zlib.h"
 
-# include "profile_description.h"
 # include "profile_packet.h"
 # include "syslog.h"
 
+//  Packet numbers 0 .. MXPCKT-1 are accepted
 # define MXPCKT 128
-//  Assume 32 kB packet size and 128 byte bursts --> 32*8 = 256
-# define MXBRST 256
+
+//  Each burst starts with a 24 byte header and an 8 hex digit CRC,
+//  or framed in binary, BRSB_HEADER bytes in front and the CRC after the data
+# define BRST_HEADER 32
+
+//  Grant binary framing to floats offering it (MODE), 0 for ASCII framing only
+# define RX_BINARY 1
+
+//  Per connection input buffer.
+//  Must hold at least one complete burst (32 + 9999 bytes).
+# define RXBUFSZ (64*1024)
+
+//  Largest sliding window granted to a float, in data bursts.
+//  0 answers no offer, floats then send as to older receivers.
+# define RX_MAX_WINDOW 32
+
+//  Most repair bursts per packet granted to a float, offered with the window.
+//  Repair burst j is the XOR of data bursts j, j+R, j+2R, ... of its packet,
+//  R repair bursts per packet. One data burst missing of these is rebuilt
+//  from it, without asking for a resend.
+# define RX_MAX_REPAIR 4
+
+//  Events handled per epoll_wait() call
+# define RX_MAX_EVENTS 64
+
+# ifdef TXRXERRORRATE
+double profile_receive_error_rate = TXRXERRORRATE;
+# endif
+
+//  Profiles kept after their float disconnected,
+//  and for how long, waiting for the float to call again
+# define RX_MAX_PARKED   64
+# define RX_PARK_SECONDS (6*3600)
+
+//  Position of a header field within the first META_SZ bytes of a data packet
+# define HEAD_OFFSET(field) ( offsetof(Profile_Data_Packet_t,header.field) - offsetof(Profile_Data_Packet_t,header) )
+
+//  Bursts of a single packet.
+//  Allocated when the first burst of a packet is received,
+//  released once the packet is assembled.
+//
+//  Data bursts are decoded as soon as they are next in order (b_next),
+//  straight from the connection input:
+//    header -> ASCII85 decode -> inflate -> PROFL.Pnn.part
+//  Only bursts received ahead of b_next are copied and held,
+//  until the gap in front of them is filled.
+//  The burst arrays grow with the highest burst number seen.
+//
+typedef struct assembling_packet {
+
+  uint16_t  b_need;    //  assigned when burst 0 is received
+  uint16_t  b_next;    //  next burst to decode, all before it are decoded
+  uint16_t  b_alloc;   //  Number of elements in the arrays below
+  uint16_t  b_nakd;    //  sliding window: missing bursts up to here were asked for
+
+  char**    b;         //  held bursts, ahead of b_next
+  uint16_t* b_size;
+  char*     b_have;
+
+  //  Streaming decoder
+  //
+  int       fd;          //  decoded packet, renamed when complete
+  char      failed;      //  decoding failed, resend the packet
+  char      binary;      //  bursts framed in binary, data not ASCII85 encoded
+
+  uint16_t  head_have;
+  char      head [ META_SZ ];
+
+  char      ascii85;     //  data are ASCII85 encoded
+  uint8_t   a85_count;   //  characters of the current group
+  uint32_t  a85_number;
+
+  char      inflating;   //  data are zlib compressed, strm is initialized
+  char      inflated;    //  Z_STREAM_END seen
+  z_stream  strm;
+
+  uint32_t  out_size;
+
+  //  Repair bursts (see packet_repair()): per group, the XOR of
+  //  its data bursts received so far, and its repair burst once received
+  //
+  uint8_t        x_groups;   //  repair bursts per packet, 0 for none
+  unsigned char* x      [ RX_MAX_REPAIR ];
+  uint16_t       x_size [ RX_MAX_REPAIR ];
+  unsigned char* r      [ RX_MAX_REPAIR ];
+  uint16_t       r_size [ RX_MAX_REPAIR ];
+  uint16_t       r_bursts;   //  number of data bursts, as told by a repair burst
+  uint16_t       r_last;     //  size of the last of them
+
+} Assembling_Packet_t;
 
 //  Typedefined such that
 //  memset to zero will give proper initialization
+//
+//  Outlives the connection it was received on:
+//  When the float disconnects, the profile is parked with all its bursts,
+//  and adopted by the next connection of the same float and profile.
+//  The float then learns from HELD replies which bursts need not be sent again.
+//
 typedef struct assembling_profile {
 
   //  Make sure packets added to this data structure
   //  belong to the same profile
-  //  -- Long shot, but would become relevant if more than
-  //     one float were to send to a single server
-  //
-
-  //  The Profile Packet Definition is based on the content of packet#0,
-  //  which is of type Profile_Info_Packet_t
   //
   Profile_Packet_Definition_t profile_def;
 
   //  Keep track if packets that have been received
   //
-  Profile_Info_Packet_t   pip;                  //  packet 0
-  char                    pip_have;
+  char                    pip_have;             //  packet 0
 
-  Profile_Data_Packet_t   dp      [ MXPCKT ];  //  packets >= 1
-  char                    dp_have [ MXPCKT ];
+  char                    dp_have [ MXPCKT ];   //  packets >= 1
   uint16_t                dp_need;
   uint16_t                dp_rxed;
 
-  //  Only use the items below if burst receiving
-  //
-  char*             b      [ MXPCKT ][ MXBRST ];
-  uint16_t          b_size [ MXPCKT ][ MXBRST ];
-  char              b_have [ MXPCKT ][ MXBRST ];
-  uint16_t          b_need [ MXPCKT ];
-  uint16_t          b_rxed [ MXPCKT ];
+  Assembling_Packet_t*    pk      [ MXPCKT ];
+
+  struct assembling_profile* next;      //  while parked
+  time_t                  parked;
 
 } Assembling_Profile_t;
 
-static Assembling_Profile_t rx_profile;
-static const char const* Terminator = "\r\n";
+//  One connected float.
+//  The profile assembler is allocated with the first valid burst.
+//
+typedef struct rx_connection {
 
+  int            fd;
+  struct rx_connection* next;
 
-static void initialize_profile ( Assembling_Profile_t* ap ) {
+  unsigned char* input;
+  size_t         start_input;
+  size_t         end_input;
+  size_t         total_input;
+  char           have_sync;    //  BRST (or BRSB, WNDW, MODE) found at start_input
+  char           binary;       //  binary framing: 1 granted, 2 confirmed by the probe
+  char           frame_binary; //  framing of the burst being parsed
 
-  ap -> pip_have = 0;
+  uint16_t       window;       //  data bursts the float may send ahead, 0 if not offered
+  uint8_t        repair;       //  repair bursts per packet, 0 if not offered
 
-  ap ->  dp_need = 0;
-  ap ->  dp_rxed = 0;
-  uint16_t p;
-  for ( p=0; p<MXPCKT; p++ ) {
-    ap -> dp_have [p] = 0;
+  time_t         lastrxed;
+  time_t         heartbeat;
+  time_t         statusout;
 
-    ap -> b_need [p] = 0;  //  assigned when burst 0 is received
-    ap -> b_rxed [p] = 0;
+  size_t         held;         //  bytes of bursts held out of order
+  size_t         held_peak;
 
-    uint16_t b;
-    for ( b=0; b<MXBRST; b++ ) {
-      ap -> b_have [p][b] = 0;
-      ap -> b_size [p][b] = 0;
-      ap -> b      [p][b] = 0;
-    }
+  Assembling_Profile_t* ap;
+
+} rx_connection_t;
+
+static const char* const Terminator = "\r\n";
+
+static const char* rx_data_dir = ".";
+
+static rx_connection_t*      rx_connections = 0;
+static Assembling_Profile_t* rx_parked      = 0;
+
+static volatile sig_atomic_t rx_stop = 0;
+
+static void rx_signal ( int sig ) {
+  (void)sig;
+  rx_stop = 1;
+}
 
+//  Send "TYPE,hynv,prof,pckt,brst,CRC\r\n" in a single write.
+//
+static void rx_reply ( int io_fd, const char* type, uint16_t hynv_number, uint16_t profile_ID, uint16_t packet_number, uint16_t burst_number ) {
+
+  char reply[48];
+  int n = snprintf ( reply, 32, "%4.4s,%04hu,%05hu,%04hu,%03hu,",
+                     type, hynv_number, profile_ID, packet_number, burst_number );
+
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, (Bytef*)reply, n );
+  n += snprintf ( reply+n, sizeof(reply)-n, "%08lX%s", crc, Terminator );
+
+  if ( n != write ( io_fd, reply, n ) ) {
+    syslog_out ( SYSLOG_NOTICE, "rx_reply", "%4.4s %04hu not sent", type, packet_number );
   }
 }
 
-static void packet_from_bursts( uint16_t hynv_number, uint16_t profile_ID, uint16_t packet_number, int io_fd, const char* data_dir ) {
-  const char* const function_name = "packet_from_bursts";
+//  Send "HELD,hynv,prof,pckt,nbrst,map,CRC\r\n": the bursts of a packet
+//  received so far, nbrst being the number of data bursts (0 if unknown).
+//  The map has one hex digit per 4 bursts, starting with bursts 0..3,
+//  and bit 0 of a digit is the lowest numbered burst of the digit.
+//
+static void rx_reply_held ( int io_fd, uint16_t hynv_number, uint16_t profile_ID, uint16_t packet_number, Assembling_Packet_t* pk ) {
 
-  uint16_t p_size = 0;
-  int b;
-  for ( b=1; b<=rx_profile.b_need[packet_number]; b++ ) {
-    p_size += rx_profile.b_size[packet_number][b];
+  char reply[32 + 1000/4 + 16];
+  int n = snprintf ( reply, 32, "HELD,%04hu,%05hu,%04hu,%03hu,",
+                     hynv_number, profile_ID, packet_number, pk->b_need );
+
+  uint16_t const last = ( pk->b_need+1 > pk->b_alloc ) ? pk->b_need+1 : pk->b_alloc;
+
+  uint16_t b;
+  for ( b=0; b<last && b<1000; b+=4 ) {
+    int digit = 0, j;
+    for ( j=0; j<4; j++ ) {
+      if ( b+j < pk->b_alloc && pk->b_have[b+j] ) digit |= 1<<j;
+    }
+    reply[n++] = "0123456789ABCDEF"[digit];
   }
+  reply[n++] = ',';
 
-  //  Copy all burst data into single packet data,
-  //  and clean-up burst data
-  //
-  char* p_data = malloc ( (size_t)p_size );
-  if ( !p_size ) {
-    syslog_out ( SYSLOG_ERROR, function_name, "Out-of-memory %4hu", packet_number );
-    //  FIXME -- How to handle internal error!
-  } else {
-    //  Copy burst[1..N] -> p_data
-    //  Reset burst information back to empty.
-    //  Then, if the content of this packet turns out to be invalid,
-    //  the empty burst items will all be re-received.
-    uint16_t location = 0;
-    for ( b=1; b<=rx_profile.b_need[packet_number]; b++ ) {
-      memcpy ( p_data+location,
-               rx_profile.b[packet_number][b],
-               rx_profile.b_size[packet_number][b] );
-      location += rx_profile.b_size[packet_number][b];
-      free ( rx_profile.b[packet_number][b] );
-      rx_profile.b     [packet_number][b] = 0;
-      rx_profile.b_size[packet_number][b] = 0;
-      rx_profile.b_have[packet_number][b] = 0;
-    }
-
-    rx_profile.b_need[packet_number] = 0;
-    rx_profile.b_rxed[packet_number] = 0;
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, (Bytef*)reply, n );
+  n += snprintf ( reply+n, sizeof(reply)-n, "%08lX%s", crc, Terminator );
 
-    if ( 0 == packet_number ) {
+  if ( n != write ( io_fd, reply, n ) ) {
+    syslog_out ( SYSLOG_NOTICE, "rx_reply_held", "HELD %04hu not sent", packet_number );
+  }
+}
 
-      if ( info_packet_fromBytes ( &(rx_profile.pip), p_data, p_size ) ) {
+static int rx_mkdir ( const char* dir ) {
 
-        //  Error returned by info_packet_fromBytes():
-        //  Must resend all of packet packet_number(=0),
-        //  because we cannot identify the place of error.
-        char rsnd[32];
-        snprintf ( rsnd, 32, "RSND,%04hu,%05hu,%04hu,%03hu,",
-                   hynv_number, profile_ID, packet_number, 999 );
-        syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu all", packet_number );
+  struct stat statbuf;
+  if ( 0 == stat ( dir, &statbuf ) ) {
+    return S_ISDIR(statbuf.st_mode) ? 0 : 1;
+  }
 
-        uLong crc = crc32 ( 0L, Z_NULL, 0 );
-              crc = crc32 ( crc, rsnd, strlen(rsnd) );
-        char crcStr[9];
-        snprintf ( crcStr, 9, "%08X", crc );
-        write ( io_fd, rsnd, strlen(rsnd) );
-        write ( io_fd, crcStr, strlen(crcStr) );
-        write ( io_fd, Terminator, strlen(Terminator) );
+  char* parent = strdup ( dir );
+  char* slash  = parent ? strrchr ( parent, '/' ) : 0;
+  if ( slash && slash != parent ) {
+    *slash = 0;
+    rx_mkdir ( parent );
+  }
+  free ( parent );
 
-      } else {
+  if ( mkdir ( dir, S_IRWXU | S_IRWXG | S_IRWXO ) && errno != EEXIST ) {
+    return 1;
+  }
+  return 0;
+}
 
-        rx_profile.pip.HYNV_num = hynv_number;
-        rx_profile.pip.PROF_num = profile_ID;
-        rx_profile.pip.PCKT_num = packet_number;
+//  Name of a received packet, named like on the float:
+//    data_dir/HYNV/PROFL/PROFL.Pnn
+//  Creates the directory if make_dir is set.
+//
+static int rx_packet_path ( uint16_t hynv_number, uint16_t profile_ID, uint16_t packet_number,
+                            const char* suffix, char* fn, size_t fn_size, int make_dir ) {
 
-        if ( rx_profile.pip_have ) {
-          syslog_out ( SYSLOG_ERROR, function_name, "Re-received %4hu", packet_number );
-          //  FIXME -- Keep ignoring???
-        } else {
-          rx_profile.pip_have = 1;
-        }
+  char dir[256];
+  snprintf ( dir, sizeof(dir), "%s/%04hu/%05hu", rx_data_dir, hynv_number, profile_ID );
 
-        //  Now read the number of packets stored in the pip,
-        //  so this receiver knows how many packets to expect in total
-        //
-        if ( profile_packet_definition_from_info_packet ( &(rx_profile.profile_def), &(rx_profile.pip) ) ) {
-          //  ERROR FIXME Should not possibly happen
-          syslog_out ( SYSLOG_ERROR, function_name, "Packet %4hu parse error", packet_number );
-        } else {
-          rx_profile.dp_need = rx_profile.profile_def.numPackets_SBRD
-                             + rx_profile.profile_def.numPackets_PORT
-                             + rx_profile.profile_def.numPackets_OCR
-                             + rx_profile.profile_def.numPackets_MCOMS;
-        }
+  if ( make_dir && rx_mkdir ( dir ) ) {
+    syslog_out ( SYSLOG_ERROR, "rx_packet_path", "Cannot mkdir(%s)", dir );
+    return 1;
+  }
 
-        //  ACK this packet
-        char rxed[32];
-        snprintf ( rxed, 32, "RXED,%04hu,%05hu,%04hu,%03hu,",
-                   hynv_number, profile_ID, packet_number, 999 );
-
-        uLong crc = crc32 ( 0L, Z_NULL, 0 );
-              crc = crc32 ( crc, rxed, strlen(rxed) );
-        char crcStr[9];
-        snprintf ( crcStr, 9, "%08X", crc );
-        write ( io_fd, rxed, strlen(rxed) );
-        write ( io_fd, crcStr, strlen(crcStr) );
-        write ( io_fd, Terminator, strlen(Terminator) );
-      }
+  snprintf ( fn, fn_size, "%s/%05hu.P%02hu%s", dir, profile_ID, packet_number, suffix );
+  return 0;
+}
+
+//  Subtracts the bytes of bursts held out of order from *held
+//
+static void packet_release ( Assembling_Profile_t* ap, size_t* held, uint16_t packet_number ) {
 
-    } else { // packet_number > 0
+  Assembling_Packet_t*  pk = ap->pk[packet_number];
+  if ( !pk ) return;
 
-      Profile_Data_Packet_t working_packet;
+  uint16_t b;
+  for ( b=0; b<pk->b_alloc; b++ ) {
+    if ( pk->b[b] ) *held -= pk->b_size[b];
+    free ( pk->b[b] );
+  }
+  free ( pk->b );
+  free ( pk->b_size );
+  free ( pk->b_have );
+
+  int g;
+  for ( g=0; g<RX_MAX_REPAIR; g++ ) {
+    free ( pk->x[g] );
+    free ( pk->r[g] );
+  }
 
-      if ( data_packet_fromBytes ( &working_packet, p_data, p_size ) ) {
+  if ( pk->inflating ) {
+    (void)inflateEnd ( &pk->strm );
+  }
 
-        //  Error returned by data_packet_fromBytes():
-        //  Must resend all of packet packet_number(>0),
-        //  because we cannot identify the place of error.
-        char rsnd[32];
-        snprintf ( rsnd, 32, "RSND,%04hu,%05hu,%04hu,%03hu,",
-                   hynv_number, profile_ID, packet_number, 999 );
-        syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu all", packet_number );
+  //  A decoded packet still open is incomplete
+  if ( pk->fd >= 0 ) {
+    char fn[300];
+    close ( pk->fd );
+    rx_packet_path ( ap->profile_def.profiler_sn, ap->profile_def.profile_id, packet_number,
+                     ".part", fn, sizeof(fn), 0 );
+    unlink ( fn );
+  }
 
-        uLong crc = crc32 ( 0L, Z_NULL, 0 );
-              crc = crc32 ( crc, rsnd, strlen(rsnd) );
-        char crcStr[9];
-        snprintf ( crcStr, 9, "%08X", crc );
-        write ( io_fd, rsnd, strlen(rsnd) );
-        write ( io_fd, crcStr, strlen(crcStr) );
-        write ( io_fd, Terminator, strlen(Terminator) );
+  free ( pk );
 
-      } else {
+  ap->pk[packet_number] = 0;
+}
 
-        working_packet.HYNV_num = hynv_number;
-        working_packet.PROF_num = profile_ID;
-        working_packet.PCKT_num = packet_number;
+//  Return the burst bookkeeping of a packet, with room for burst_number.
+//  A packet begun gets the repair bursts granted to the connection,
+//  and the framing of the burst that begins it.
+//
+static Assembling_Packet_t* packet_slot ( rx_connection_t* conn, uint16_t packet_number, uint16_t burst_number ) {
+
+  Assembling_Profile_t* ap = conn->ap;
+  Assembling_Packet_t*  pk = ap->pk[packet_number];
+
+  if ( !pk ) {
+    pk = calloc ( 1, sizeof(Assembling_Packet_t) );
+    if ( !pk ) return 0;
+    pk->b_next   = 1;
+    pk->fd       = -1;
+    pk->x_groups = conn->repair;
+    pk->binary   = conn->frame_binary;
+    ap->pk[packet_number] = pk;
+  }
 
-        data_packet_save ( &working_packet, data_dir, "r" );
+  if ( burst_number >= pk->b_alloc ) {
 
-        syslog_out ( SYSLOG_DEBUG, function_name,
-                                   "received packet SZ %hu 32+%6.6s", p_size, working_packet.compressed_sz );
+    uint16_t const n = burst_number + 1;
 
-        if ( working_packet.ASCII_encoding != 'N' ) {
+    char**    b      = realloc ( pk->b,      n*sizeof(char*) );
+    if ( b ) pk->b = b;
+    uint16_t* b_size = realloc ( pk->b_size, n*sizeof(uint16_t) );
+    if ( b_size ) pk->b_size = b_size;
+    char*     b_have = realloc ( pk->b_have, n*sizeof(char) );
+    if ( b_have ) pk->b_have = b_have;
 
-          Profile_Data_Packet_t decoded;
-          int ec;
-          if ( ec = data_packet_decode ( &working_packet, &decoded ) ) {
-            syslog_out ( SYSLOG_ERROR, function_name, "data_packet_decode() [%d] failed %4hu", ec, packet_number );
-          } else {
-            memcpy ( &working_packet, &decoded, sizeof( Profile_Data_Packet_t ) );
-          }
-        }
+    if ( !b || !b_size || !b_have ) return 0;
 
-        data_packet_save ( &working_packet, data_dir, "d" );
+    memset ( pk->b      + pk->b_alloc, 0, (n-pk->b_alloc)*sizeof(char*) );
+    memset ( pk->b_size + pk->b_alloc, 0, (n-pk->b_alloc)*sizeof(uint16_t) );
+    memset ( pk->b_have + pk->b_alloc, 0, (n-pk->b_alloc)*sizeof(char) );
+    pk->b_alloc = n;
+  }
 
-        if ( working_packet.compression == 'G' ) {
+  return pk;
+}
 
-          Profile_Data_Packet_t uncompressed;
-          if ( data_packet_uncompress ( &working_packet, &uncompressed ) ) {
-            syslog_out ( SYSLOG_ERROR, function_name, "data_packet_uncompress() failed %4hu", packet_number );
-          } else {
-            memcpy ( &working_packet, &uncompressed, sizeof( Profile_Data_Packet_t ) );
-          }
-        }
+//  All data bursts were decoded
+//
+static int packet_complete ( Assembling_Profile_t* ap, uint16_t packet_number ) {
+  Assembling_Packet_t* pk = ap->pk[packet_number];
+  return pk && pk->b_need && pk->b_next > pk->b_need;
+}
 
-        data_packet_save ( &working_packet, data_dir, "u" );
+static uint16_t number_from_4chars ( const char* field ) {
+  char numString[5];
+  memcpy ( numString, field, 4 );
+  numString[4] = 0;
+  return (uint16_t) atoi ( numString );
+}
 
-        if ( working_packet.compression        == '0'
-          && working_packet.noise_bits_removed != 'N' ) {
+static void stream_write ( Assembling_Packet_t* pk, const void* data, size_t size ) {
 
-          Profile_Data_Packet_t debitplaned;
-          if ( data_packet_debitplane ( &working_packet, &debitplaned ) ) {
-            syslog_out ( SYSLOG_ERROR, function_name, "data_packet_debitplane() failed %4hu", packet_number );
-          } else {
-            memcpy ( &working_packet, &debitplaned, sizeof( Profile_Data_Packet_t ) );
-          }
-        }
+  const char* p = data;
 
-        data_packet_save ( &working_packet, data_dir, "x" );
+  while ( !pk->failed && size ) {
+    ssize_t n = write ( pk->fd, p, size );
+    if ( n < 0 ) {
+      if ( EINTR == errno ) continue;
+      syslog_out ( SYSLOG_ERROR, "stream_write", "%s", strerror(errno) );
+      pk->failed = 1;
+    } else {
+      p += n; size -= n;
+      pk->out_size += n;
+    }
+  }
+}
 
-        if ( working_packet.compression        == '0'
-          && working_packet.noise_bits_removed == 'N'
-          && working_packet.representation     == 'G' ) {
+//  Decoded bytes: inflate them, or write them as they are
+//
+static void stream_sink ( Assembling_Packet_t* pk, unsigned char* data, size_t size ) {
 
-          Profile_Data_Packet_t binarycode;
-          if ( data_packet_gray2bin ( &working_packet, &binarycode ) ) {
-            syslog_out ( SYSLOG_ERROR, function_name, "data_packet_gray2bin() failed %4hu", packet_number );
-          } else {
-            memcpy ( &working_packet, &binarycode, sizeof( Profile_Data_Packet_t ) );
-          }
-        }
+  if ( !pk->inflating ) {
+    stream_write ( pk, data, size );
+    return;
+  }
 
-        data_packet_save ( &working_packet, data_dir, "z" );
+  unsigned char out[4096];
 
-        memcpy ( &(rx_profile.dp[packet_number]), &working_packet, sizeof( Profile_Data_Packet_t ) );
+  pk->strm.next_in  = data;
+  pk->strm.avail_in = size;
 
-        if ( rx_profile.dp_have[packet_number] ) {
-          syslog_out ( SYSLOG_ERROR, function_name, "Re-received %4hu", packet_number );
-        } else {
-          rx_profile.dp_have[packet_number] = 1;
-          rx_profile.dp_rxed                 ++;
-        }
+  //  Continue while input is left, or while the output was filled
+  //
+  do {
+    if ( pk->inflated ) {
+      //  Data following the end of the compressed stream
+      pk->failed = 1;
+      break;
+    }
 
-        //  ACK this packet
-        char rxed[32];
-        snprintf ( rxed, 32, "RXED,%04hu,%05hu,%04hu,%03hu,",
-                   hynv_number, profile_ID, packet_number, 999 );
-
-        uLong crc = crc32 ( 0L, Z_NULL, 0 );
-              crc = crc32 ( crc, rxed, strlen(rxed) );
-        char crcStr[9];
-        snprintf ( crcStr, 9, "%08X", crc );
-        write ( io_fd, rxed, strlen(rxed) );
-        write ( io_fd, crcStr, strlen(crcStr) );
-        write ( io_fd, Terminator, strlen(Terminator) );
-
-        //  TODO -- as frames to file - either here on a packet-by-packet base,
-        //  or at the end???
-        //
-        //  In any case, will need another flag
-        //  rx_profile.p_done[packet_number]  to indicate that the packet has been output
-        //
+    pk->strm.next_out  = out;
+    pk->strm.avail_out = sizeof(out);
 
-      }
+    int const rv = inflate ( &pk->strm, Z_NO_FLUSH );
 
+    if ( Z_STREAM_END == rv ) {
+      pk->inflated = 1;
+    } else if ( Z_OK != rv && Z_BUF_ERROR != rv ) {
+      syslog_out ( SYSLOG_NOTICE, "stream_sink", "inflate() failed %d", rv );
+      pk->failed = 1;
+      break;
     }
 
-    free ( p_data );
-  }
+    stream_write ( pk, out, sizeof(out) - pk->strm.avail_out );
+
+  } while ( !pk->failed && !pk->inflated && ( pk->strm.avail_in || 0 == pk->strm.avail_out ) );
 }
 
-int profile_receive ( const char* data_dir, uint16_t port ) {
-  const char* const function_name = "profile_receive";
+static void stream_ascii85 ( Assembling_Packet_t* pk, const unsigned char* data, size_t size ) {
 
-  syslog_out ( SYSLOG_NOTICE, function_name, "Start" );
+  unsigned char out[4096];
+  size_t        n = 0;
 
-  int socket_fd = -1;
-  int io_fd = -1;   //  i/o file descriptor
-                    //  If 0==port - cannot use for output!
-                    //  Else will comm with (so far any) client
+  size_t i;
+  for ( i=0; i<size && !pk->failed; i++ ) {
 
-  if ( 0 == port ) {
-    io_fd = 0;
-  } else {
+    uint8_t const ch = data[i];
 
-    socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if ( socket_fd < 0 ) {
-      syslog_out ( SYSLOG_ERROR, function_name, "%s", strerror(errno) );
-      return 1;
+    if ( 0 == pk->a85_count && ( 'z' == ch || 'y' == ch ) ) {
+      pk->a85_number = ( 'z' == ch ) ? 0 : 0x20202020;
+      pk->a85_count  = 5;
+    } else if ( '!' <= ch && ch <= 'u' ) {
+      pk->a85_number = 85*pk->a85_number + ( ch-'!' );
+      pk->a85_count++;
+    } else {
+      syslog_out ( SYSLOG_NOTICE, "stream_ascii85", "Decoding OOR char %02x", ch );
+      pk->failed = 1;
+      break;
     }
 
-# if RESTRICT_CONNECTIONS
-    struct hostent* server = gethostbyname( float_host_ip );
-    if ( NULL == server ) {
-      syslog_out ( SYSLOG_ERROR, function_name, "no '%s' host", host_ip );
-      return 1;
-    }
-# endif
+    if ( 5 == pk->a85_count ) {
 
-    struct sockaddr_in server_address;
-    memset ( &server_address, 0, sizeof(server_address) );
+      out[n++] = (uint8_t) ((pk->a85_number>>24)        );
+      out[n++] = (uint8_t) ((pk->a85_number>>16) & 0xFF );
+      out[n++] = (uint8_t) ((pk->a85_number>> 8) & 0xFF );
+      out[n++] = (uint8_t) ((pk->a85_number    ) & 0xFF );
 
-    server_address.sin_family = AF_INET;
- // memcpy ( &server_address.sin_addr.s_addr, server->h_addr, server->h_length);
-# if RESTRICT_CONNECTIONS
-    bcopy((char *)server->h_addr, (char *)&server_address.sin_addr.s_addr, server->h_length);
-# else
-    server_address.sin_addr.s_addr = INADDR_ANY;
-# endif
-    server_address.sin_port = htons(port);
+      pk->a85_count  = 0;
+      pk->a85_number = 0;
 
-    if (bind( socket_fd, (struct sockaddr *) &server_address, sizeof(server_address)) < 0) {
-      syslog_out ( SYSLOG_ERROR, function_name, "%s: Error on binding", strerror(errno) );
-      return 1;
+      if ( n+4 > sizeof(out) ) {
+        stream_sink ( pk, out, n );
+        n = 0;
+      }
     }
+  }
 
-    if ( listen( socket_fd, 5 ) < 0 ) {
-      syslog_out ( SYSLOG_ERROR, function_name, "%s: Error on listening", strerror(errno) );
-      return 1;
+  if ( n && !pk->failed ) {
+    stream_sink ( pk, out, n );
+  }
+}
+
+//  A final partial group of k characters holds k-1 bytes.
+//  Pad with the highest digit ('u').
+//
+static void stream_ascii85_end ( Assembling_Packet_t* pk ) {
+
+  if ( 0 == pk->a85_count ) return;
+
+  if ( 1 == pk->a85_count ) {
+    pk->failed = 1;
+    return;
+  }
+
+  unsigned char out[4];
+  int const n = pk->a85_count-1;
+
+  while ( pk->a85_count < 5 ) {
+    pk->a85_number = 85*pk->a85_number + 84;
+    pk->a85_count++;
+  }
+
+  out[0] = (uint8_t) ((pk->a85_number>>24)        );
+  out[1] = (uint8_t) ((pk->a85_number>>16) & 0xFF );
+  out[2] = (uint8_t) ((pk->a85_number>> 8) & 0xFF );
+
+  pk->a85_count  = 0;
+  pk->a85_number = 0;
+
+  stream_sink ( pk, out, n );
+}
+
+//  The header of a data packet is complete:
+//  check it, set up decoding, and write it
+//  with the encoding and compression that will be undone.
+//
+static void stream_header ( Assembling_Packet_t* pk ) {
+  const char* const function_name = "stream_header";
+
+  switch ( pk->head[HEAD_OFFSET(sensor_type)] ) {
+  case 'S': case 'P': case 'O': case 'M': break;
+  default : pk->failed = 1; return;
+  }
+
+  if ( 0 == number_from_4chars ( pk->head+HEAD_OFFSET(number_of_data) ) ) {
+    pk->failed = 1;
+    return;
+  }
+
+  char head[META_SZ];
+  memcpy ( head, pk->head, META_SZ );
+
+  switch ( head[HEAD_OFFSET(ASCII_encoding)] ) {
+  case 'N': break;
+  case 'A': pk->ascii85 = 1;
+            head[HEAD_OFFSET(ASCII_encoding)] = 'N';
+            memcpy ( head+HEAD_OFFSET(encoded_sz), "      ", 6 );
+            break;
+  default : syslog_out ( SYSLOG_NOTICE, function_name, "Encoding '%c' unknown", head[HEAD_OFFSET(ASCII_encoding)] );
+            pk->failed = 1;
+            return;
+  }
+
+  switch ( head[HEAD_OFFSET(compression)] ) {
+  case '0': break;
+  case 'G': memset ( &pk->strm, 0, sizeof(pk->strm) );
+            //  Window size as given in the zlib header of the stream
+            if ( Z_OK != inflateInit2 ( &pk->strm, 0 ) ) {
+              syslog_out ( SYSLOG_ERROR, function_name, "inflateInit2() failed" );
+              pk->failed = 1;
+              return;
+            }
+            pk->inflating = 1;
+            head[HEAD_OFFSET(compression)] = '0';
+            memcpy ( head+HEAD_OFFSET(compressed_sz), "      ", 6 );
+            break;
+  default : syslog_out ( SYSLOG_NOTICE, function_name, "Compression '%c' unknown", head[HEAD_OFFSET(compression)] );
+            pk->failed = 1;
+            return;
+  }
+
+  stream_write ( pk, head, META_SZ );
+}
+
+//  Decode the next burst of a packet
+//
+static void stream_feed ( rx_connection_t* conn, Assembling_Packet_t* pk, uint16_t packet_number,
+                          const unsigned char* data, size_t size ) {
+
+  if ( pk->failed ) return;
+
+  if ( pk->fd < 0 ) {
+    char fn[300];
+    if ( rx_packet_path ( conn->ap->profile_def.profiler_sn, conn->ap->profile_def.profile_id,
+                          packet_number, ".part", fn, sizeof(fn), 1 )
+      || 0 > ( pk->fd = open ( fn, O_CREAT|O_TRUNC|O_WRONLY, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH ) ) ) {
+      syslog_out ( SYSLOG_ERROR, "stream_feed", "Cannot open '%s' for writing", fn );
+      pk->failed = 1;
+      return;
     }
+  }
 
-    struct sockaddr_in client_address;
-    socklen_t clilen = sizeof(client_address);
-    io_fd = accept( socket_fd, (struct sockaddr *) &client_address, &clilen);
-    if ( io_fd < 0) {
-      syslog_out ( SYSLOG_ERROR, function_name, "%s: Error on accept", strerror(errno) );
-      return 1;
+  size_t const n = ( pk->head_have + size < META_SZ ) ? size : (size_t)( META_SZ - pk->head_have );
+  memcpy ( pk->head + pk->head_have, data, n );
+  pk->head_have += n;
+
+  if ( 0 == packet_number ) {
+    //  The info packet is neither compressed nor encoded
+    stream_write ( pk, data, size );
+    return;
+  }
+
+  data += n;
+  size -= n;
+
+  if ( n && META_SZ == pk->head_have ) {
+    stream_header ( pk );
+  }
+
+  if ( size && !pk->failed ) {
+    if ( pk->ascii85 ) {
+      stream_ascii85 ( pk, data, size );
+    } else {
+      stream_sink ( pk, (unsigned char*)data, size );
     }
   }
+}
 
-  syslog_out ( SYSLOG_NOTICE, function_name, "Connected" );
+//  Decode the bursts held since b_next was missing
+//
+static void stream_held ( rx_connection_t* conn, Assembling_Packet_t* pk, uint16_t packet_number ) {
 
-  //  Initialize profile
-  initialize_profile( &rx_profile );
+  while ( pk->b_next < pk->b_alloc && pk->b_have[pk->b_next] ) {
 
-  //  Receive all input into a single bit array
-  //  MAYBE TODO: Make this a circular buffer
-  size_t start_input = 0;
-  size_t end_input = 0;
-  size_t size_input = 64L*1024L*1024L;
-  unsigned char* all_input = malloc ( size_input );
+    uint16_t const b = pk->b_next++;
 
-  //  Keep incoming sync information
-  //
-  char* brst_sync = "BRST";
-# if 0
-  char* pack_sync = "HYNV";
-# endif
+    stream_feed ( conn, pk, packet_number, (unsigned char*)pk->b[b], pk->b_size[b] );
 
-  unsigned char* sync32 = 0;
+    free ( pk->b[b] );
+    pk->b[b] = 0;
+    conn->held -= pk->b_size[b];
+  }
+}
 
-  int waitmax = 120;
-  time_t now = time((time_t*)0);
-  time_t timeout = now + waitmax;
-  time_t lastrxed  = now-10;
-  time_t heartbeat = now-10;
-  time_t statusout = now-10;
+//  Add a data burst to the XOR of its repair group.
+//  Out of memory, the packet goes without repair.
+//
+static void packet_repair_add ( Assembling_Packet_t* pk, uint16_t burst_number, const unsigned char* data, size_t size ) {
 
-  // Non-blocking I/O
-  int const on = 1;
-  ioctl(io_fd,FIONBIO,&on);
+  if ( !pk->x_groups ) return;
 
-  do {
+  int const g = ( burst_number-1 ) % pk->x_groups;
 
-    ssize_t n;
-    char buf[1024];
+  if ( size > pk->x_size[g] ) {
+    unsigned char* x = realloc ( pk->x[g], size );
+    if ( !x ) {
+      syslog_out ( SYSLOG_ERROR, "packet_repair_add", "Out-of-memory, no repair" );
+      pk->x_groups = 0;
+      return;
+    }
+    memset ( x + pk->x_size[g], 0, size - pk->x_size[g] );
+    pk->x[g]      = x;
+    pk->x_size[g] = size;
+  }
 
-    //  Read up to 1024 bytes from current input into buffer
-    //
-    if ( 0 < ( n = read ( io_fd, buf, 1024 ) ) ) {
+  size_t i;
+  for ( i=0; i<size; i++ ) {
+    pk->x[g][i] ^= data[i];
+  }
+}
 
-    # ifdef TXRXERRORRATE
-      if ( TXRXERRORRATE>0 ) {
-        if ( TXRXERRORRATE*n > drand48() ) {
-          buf[rand()%n] ^= 0x66;
-        }
-      }
-    # endif
+//  Take a data burst not received before:
+//  decode it if next in order, followed by the bursts held for it,
+//  else hold a copy until the gap in front of it is filled.
+//
+static void packet_burst_accept ( rx_connection_t* conn, Assembling_Packet_t* pk, uint16_t packet_number,
+                                  uint16_t burst_number, const unsigned char* data, size_t size ) {
+  const char* const function_name = "packet_burst_accept";
 
-      memcpy ( all_input+end_input, buf, n );
-      end_input += n;
+  if ( burst_number == pk->b_next ) {
 
-      lastrxed = time((time_t*)0);
-      timeout = lastrxed + waitmax;
+    pk->b_have[ burst_number ] = 1;
+    pk->b_next                 ++;
 
-      if ( lastrxed > heartbeat+5 ) {
-        const char* const alif = "ALIF";
-        write ( io_fd, alif, strlen(alif) );
-        write ( io_fd, Terminator, strlen(Terminator) );
-        heartbeat = lastrxed;
-      }
+    packet_repair_add ( pk, burst_number, data, size );
+    stream_feed ( conn, pk, packet_number, data, size );
+    stream_held ( conn, pk, packet_number );
+
+    syslog_out ( SYSLOG_DEBUG, function_name, "Have %4hu %3hu %4zu", packet_number, burst_number, size );
+
+  } else {
+
+    char* bcp = malloc ( size ? size : 1 );
+    if ( !bcp ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "Out-of-memory %4hu %4hu", packet_number, burst_number );
+      return;
     }
+    memcpy ( bcp, data, size );
 
-    //  Look for complete 32 byte header
-    //    Search currently available input
-    //    for start of a BURST.
-    //    Skip over all non-sync data,
-    //    but only assign sync32 if at least 32 characters are available.
-    //
-    //    At this point, the frame sync may already be available,
-    //    but the data of BURST may not be complete yet.
-    //    In that case, skip the while() loop.
-    //
-    while ( !sync32 && end_input-start_input>=32 )
-    {
+    pk->b     [ burst_number ] = bcp;
+    pk->b_size[ burst_number ] = size;
+    pk->b_have[ burst_number ] = 1;
 
-      if ( memcmp ( all_input+start_input, brst_sync, 4 ) )
-      {
-        start_input++;
-      }
-      else
-      {
-        sync32 = all_input+start_input;
+    conn->held += size;
+    if ( conn->held > conn->held_peak ) conn->held_peak = conn->held;
+
+    packet_repair_add ( pk, burst_number, data, size );
+
+    syslog_out ( SYSLOG_DEBUG, function_name, "Hold %4hu %3hu %4zu", packet_number, burst_number, size );
+  }
+}
+
+//  Rebuild the data burst missing of a repair group: the XOR of
+//  the group's repair burst and its data bursts received.
+//  With more than one missing, the repair burst is kept for when
+//  resends arrive; with none, it is not needed.
+//
+static void packet_repair ( rx_connection_t* conn, Assembling_Packet_t* pk, uint16_t packet_number ) {
+
+  uint16_t const nB = pk->r_bursts;
+
+  int g;
+  for ( g=0; g<pk->x_groups; g++ ) {
+
+    if ( !pk->r[g] ) continue;
+
+    uint16_t missing = 0, m = 0, b;
+    for ( b=g+1; b<=nB; b+=pk->x_groups ) {
+      if ( b >= pk->b_alloc || !pk->b_have[b] ) {
+        missing++;
+        m = b;
       }
     }
+    if ( missing > 1 ) continue;
 
-# if 0
-    if ( !sync32 && end_input-start_input<32 ) {
-          syslog_out ( SYSLOG_TRACE, function_name, 
-                       "Have [%d] '%*.*s' waiting for more...",
-                          end_input-start_input, 
-                          end_input-start_input, 
-                          end_input-start_input, 
-                          all_input+start_input );
+    if ( missing ) {
+      uint16_t const size = ( m < nB ) ? pk->r_size[g] : pk->r_last;
+      uint16_t i;
+      for ( i=0; i<size && i<pk->x_size[g]; i++ ) {
+        pk->r[g][i] ^= pk->x[g][i];
+      }
+      syslog_out ( SYSLOG_NOTICE, "packet_repair", "Repaired %4hu %3hu", packet_number, m );
+      packet_burst_accept ( conn, pk, packet_number, m, pk->r[g], size );
     }
-# endif
 
-    //  If 32 char header was received, parse the 32 bytes,
-    //  and maybe wait for more input
+    free ( pk->r[g] );
+    pk->r[g] = 0;
+  }
+}
 
-    if  ( sync32 )
-    {
+//  Repair burst 900 + 10*R + j of a packet, R repair bursts per packet:
+//  "nnnnssss" (number of data bursts, size of the last one),
+//  then the XOR of data bursts j, j+R, j+2R, ..., each padded with zeros.
+//  Returns the packet, 0 if the burst is of no use.
+//
+static Assembling_Packet_t* packet_repair_burst ( rx_connection_t* conn, uint16_t packet_number, uint16_t burst_number,
+                                                  const unsigned char* data, size_t size ) {
 
-      uint16_t hynv_number = 0,
-               profile_ID = 0,
-               packet_number = 0,
-               burst_number = 0,
-               burst_size = 0;
-      uLong    crc = 0;
+  int const groups = ( burst_number - 900 ) / 10;
+  int const g      = ( burst_number - 900 ) % 10 - 1;
 
-      if ( 0 == memcmp ( sync32+17, "ZZZZZZZ", 7 ) )
-      {
+  Assembling_Packet_t* pk = conn->ap->pk[packet_number];
 
-        if ( 4 != sscanf ( sync32, "BRST%4hu%5hu%4huZZZZZZZ%8X",
-                            &hynv_number, &profile_ID, &packet_number, &crc ) )
-        {
+  if ( !pk || groups != pk->x_groups || g < 0 || g >= groups || pk->r[g] || size <= 8 ) return 0;
 
-          syslog_out ( SYSLOG_NOTICE, function_name, "EOP burst header misformatted" );
-          sync32 = 0; start_input += 4;
+  char numString[9];
+  memcpy ( numString, data, 8 );
+  numString[8] = 0;
 
-        }
-        else
-        {
+  unsigned int nB = 0, last = 0;
+  if ( 2 != sscanf ( numString, "%4u%4u", &nB, &last )
+    || nB < 1 || nB >= 900 || last < 1 || last > size-8
+    || ( pk->b_need && pk->b_need != nB )
+    || ( pk->r_bursts && pk->r_bursts != nB ) ) {
+    syslog_out ( SYSLOG_NOTICE, "packet_repair_burst", "Repair %4hu %3hu does not fit", packet_number, burst_number );
+    return 0;
+  }
 
-          //  Assemble packet from bursts OR identify missing bursts
-          //
+  if ( !( pk = packet_slot ( conn, packet_number, nB ) )
+    || !( pk->r[g] = malloc ( size-8 ) ) ) {
+    syslog_out ( SYSLOG_ERROR, "packet_repair_burst", "Out-of-memory %4hu %4hu", packet_number, burst_number );
+    return 0;
+  }
 
-          //  First make sure data were not corrupted in transfer
-          uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
-          calcCRC = crc32 ( calcCRC, sync32, 24 );
+  memcpy ( pk->r[g], data+8, size-8 );
+  pk->r_size[g] = size-8;
+  pk->r_bursts  = nB;
+  pk->r_last    = last;
 
-          if ( calcCRC != crc )
-          {
-            syslog_out ( SYSLOG_NOTICE, function_name, "burst %hu end, CRC Error", packet_number );
-            sync32 = 0; start_input+=4;
-          }
-          else
-          {
-
-            //  Unexpected, but not impossible: Burst zero might have been lost
-            if ( 0 == rx_profile.profile_def.profiler_sn && 0 == rx_profile.profile_def.profile_yyddd )
-            {
-              rx_profile.profile_def.profiler_sn = hynv_number;
-              rx_profile.profile_def.profile_yyddd = profile_ID;
-            }
+  packet_repair ( conn, pk, packet_number );
+  return pk;
+}
 
-            if ( hynv_number != rx_profile.profile_def.profiler_sn
-              || profile_ID != rx_profile.profile_def.profile_yyddd )
-            {
-              syslog_out ( SYSLOG_ERROR, function_name, "Profile mismatch %04hu %04hu P %05hu %05hu",
-                                  rx_profile.profile_def.profiler_sn, hynv_number,
-                                  rx_profile.profile_def.profile_yyddd, profile_ID );
-              //  Discard bursts intended for different profiler/profile
-              sync32 = 0; start_input+=32;
+//  End of the decoded packet.
+//  Returns 0 if the packet is valid.
+//
+static int stream_finish ( Assembling_Packet_t* pk, uint16_t packet_number ) {
 
-            }
-            else
-            {
-
-              syslog_out ( SYSLOG_DEBUG, function_name, "Have %hu %hu %4hu end brst %8x",
-                                hynv_number, profile_ID, packet_number, crc );
-
-              //  Check if all bursts in this packet were received
-              //
-              if ( rx_profile.b_need[packet_number]
-                && rx_profile.b_need[packet_number] == rx_profile.b_rxed[packet_number] )
-              {
-
-                //  All received, thus re-assemble this packet from individual bursts
-                //
-
-                packet_from_bursts( hynv_number, profile_ID, packet_number, io_fd, data_dir );
-
-                if ( packet_number > 0 )
-                {
-
-                  //
-                  //  Check if previous packets are not assembled (0==dp_have)
-                  //  In that case, check if all bursts are received.
-                  //  In that case, assemble the packet.
-                  //
-                  //  If not all bursts were received,
-                  //  there may already be a resend request on its way.
-                  //  !!!  NEVER issue double resend requests  !!!
-                  //  !!!  It wastes valuable modem-on time and float energy.  !!!
-                  //  However, there may be the case where a resend request
-                  //  was issued and serviced, but neither that burst not the
-                  //  following EOP burst were received.
-                  //  In that case, the resend must be re-issued.
-                  //
-                  //  FIXME  Resolve that condition
-                  //  FIXME  Maybe via timeout checking
-                  //  
-                  uint16_t p;
-                  for ( p=0; p<packet_number; p++ )
-                  {
-                    if ( !rx_profile.dp_have[p] )
-                    {
-                      if ( rx_profile.b_need[p]
-                        && rx_profile.b_need[p] == rx_profile.b_rxed[p] )
-                      {
-                        packet_from_bursts( hynv_number, profile_ID, p, io_fd, data_dir );
-                      }
-                    }
-                  }
-
-                }
-
-              }
-              
-              else if ( 0 == rx_profile.b_need[packet_number] )
-              {
-
-                //  This means that burst zero in this packet was not received.
-                //  Request resend of burst [packet_number][0]
-                //
-                char rsnd[32];
-                snprintf ( rsnd, 32, "RSND,%04hu,%05hu,%04hu,%03hu,",
-                           hynv_number, profile_ID, packet_number, 0 );
-                syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu %3hu", packet_number, 0 );
-
-                uLong crc = crc32 ( 0L, Z_NULL, 0 );
-                      crc = crc32 ( crc, rsnd, strlen(rsnd) );
-                char crcStr[9];
-                snprintf ( crcStr, 9, "%08X", crc );
-                write ( io_fd, rsnd, strlen(rsnd) );
-                write ( io_fd, crcStr, strlen(crcStr) );
-                write ( io_fd, Terminator, strlen(Terminator) );
-
-              }
-
-              else
-              {
-                //  b_need > 0 && b_need != b_rxed
-                //  This occurs when one or more bursts in the frame were not received
-                //  Request resending those bursts
-                //
-                int b;
-                for ( b = 1;  b <= rx_profile.b_need[packet_number];  b++ )
-                {
-                  if ( !rx_profile.b_have[packet_number][b] )
-                  {
-                    //  Request resend of burst [packet_number][b]
-                    //
-                    char rsnd[32];
-                    snprintf ( rsnd, 32, "RSND,%04hu,%05hu,%04hu,%03hu,",
-                               hynv_number, profile_ID, packet_number, b );
-                    syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu %3hu", packet_number, b );
-
-                    uLong crc = crc32 ( 0L, Z_NULL, 0 );
-                          crc = crc32 ( crc, rsnd, strlen(rsnd) );
-                    char crcStr[9];
-                    snprintf ( crcStr, 9, "%08X", crc );
-                    write ( io_fd, rsnd, strlen(rsnd) );
-                    write ( io_fd, crcStr, strlen(crcStr) );
-                    write ( io_fd, Terminator, strlen(Terminator) );
-
-                  }
-                }
-              }
-
-              sync32 = 0; start_input+=32;
-            }
-          }
-        }
-      }
+  if ( pk->ascii85 ) {
+    stream_ascii85_end ( pk );
+  }
 
-      else
-      {
-        /// Not final burst in packet (ZZZZZZZ burst)
+  if ( pk->inflating && !pk->inflated ) {
+    pk->failed = 1;
+  }
 
-        if ( 6 != sscanf ( sync32, "BRST%4hu%5hu%4hu%3hu%4hu%8X",
-                            &hynv_number, &profile_ID, &packet_number,
-                            &burst_number, &burst_size, &crc ) )
-        {
-          syslog_out ( SYSLOG_NOTICE, function_name, "burst header misformatted" );
-          sync32 = 0; start_input += 4;
-        }
-        else
-        {
-          if ( 0 == burst_number )
-          {
-            //  Burst #0 has 32 bytes, all ready to use
-
-            //  In burst #0, reinterpret the 5th value
-            uint16_t num_of_bursts = burst_size;
-
-            uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
-            calcCRC = crc32 ( calcCRC, sync32, 24 );
-
-            if ( calcCRC != crc )
-            {
-              syslog_out ( SYSLOG_NOTICE, function_name, "burst %hu 0, CRC Error", packet_number );
-              sync32 = 0; start_input+=4;
-            }
-            else
-            {
-              if ( 0 == rx_profile.profile_def.profiler_sn && 0 == rx_profile.profile_def.profile_yyddd )
-              {
-                rx_profile.profile_def.profiler_sn = hynv_number;
-                rx_profile.profile_def.profile_yyddd = profile_ID;
-              }
-
-              if ( hynv_number != rx_profile.profile_def.profiler_sn
-                || profile_ID != rx_profile.profile_def.profile_yyddd )
-              {
-
-                syslog_out ( SYSLOG_WARNING, function_name, "Profile mismatch %04hu %04hu P %05hu %05hu",
-                                    rx_profile.profile_def.profiler_sn, hynv_number,
-                                    rx_profile.profile_def.profile_yyddd, profile_ID );
-                //  Discard
-                sync32 = 0; start_input+=32;
-              }
-              else
-              {
-
-                if ( rx_profile.b_have[ packet_number ][ burst_number ] )
-                {
-                  syslog_out ( SYSLOG_ERROR, function_name, "Re-received %4hu %4hu", packet_number, burst_number );
-                }
-                else
-                {
-                  rx_profile.b_have[ packet_number ][ burst_number ] = 1;
-                  rx_profile.b_size[ packet_number ][ burst_number ] = 0;
-                  rx_profile.b_need[ packet_number ]                 = num_of_bursts;
-                  // do not set rx_profile.b_rxed[ packet_number ] = 0 , since previous burst for this packet may have been received
-
-                  syslog_out ( SYSLOG_DEBUG, function_name, "Have %hu %hu %4hu %3hu %4hu %8x",
-                                hynv_number, profile_ID, packet_number,
-                                burst_number, burst_size, crc );
-
-                }
-                sync32 = 0; start_input+=32;
-              }
-            }
-          }
-          else
-          { 
-            //  burst_number > 0
-
-            //  Need complete burst for CRC calculation
-            //
-            //  In order to calculate the CRC,
-            //  need burst_size bytes after the already present 32 bytes
-
-            if  ( end_input - start_input >= 32 + burst_size )
-            {
-              uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
-              calcCRC = crc32 ( calcCRC, sync32, 24 );
-              calcCRC = crc32 ( calcCRC, sync32+32, burst_size );
-
-              if ( calcCRC != crc )
-              {
-                syslog_out ( SYSLOG_NOTICE, function_name, "burst %hu %hu, CRC Error", packet_number, burst_number );
-                sync32 = 0; start_input+=4;
-              }
-
-              else
-              {
-                if ( 0 == rx_profile.profile_def.profiler_sn && 0 == rx_profile.profile_def.profile_yyddd )
-                {
-                  //  Unexpected, but not impossible: Burst zero might have been lost
-                  rx_profile.profile_def.profiler_sn = hynv_number;
-                  rx_profile.profile_def.profile_yyddd = profile_ID;
-                }
-
-                if ( hynv_number != rx_profile.profile_def.profiler_sn
-                  || profile_ID != rx_profile.profile_def.profile_yyddd )
-                {
-                  syslog_out ( SYSLOG_WARNING, function_name, "Profile mismatch %04hu %04hu P %05hu %05hu",
-                                    rx_profile.profile_def.profiler_sn, hynv_number,
-                                    rx_profile.profile_def.profile_yyddd, profile_ID );
-                  //  Discard
-                  sync32 = 0; start_input+=32;
-                }
-                else
-                {
-
-                  if ( rx_profile.b_have[ packet_number ][ burst_number ] )
-                  {
-                    syslog_out ( SYSLOG_ERROR, function_name, "Re-received %4hu %4hu", packet_number, burst_number );
-                  }
-                  else
-                  {
-                    char* bcp = malloc ( (size_t)burst_size );
-                    if ( !bcp )
-                    {
-                      syslog_out ( SYSLOG_ERROR, function_name, "Out-of-memory %4hu %4hu", packet_number, burst_number );
-                    }
-                    
-                    else
-                    {
-                      memcpy ( bcp, sync32+32, burst_size );
-                    
-                      rx_profile.b     [ packet_number ][ burst_number ] = bcp;
-                      rx_profile.b_size[ packet_number ][ burst_number ] = burst_size;
-                      rx_profile.b_have[ packet_number ][ burst_number ] = 1;
-                      rx_profile.b_rxed[ packet_number ]                  ++;
-
-                      syslog_out ( SYSLOG_DEBUG,
-                                  function_name,
-                                  "Have %hu %hu %4hu %3hu %4hu %8x (%u)",
-                                  hynv_number, profile_ID, packet_number,
-                                  burst_number, burst_size, crc, end_input-start_input-32
-                                 );
-                    }
-                  }
-
-                  sync32 = 0; start_input+=(32+burst_size);
-                }
-              }
+  if ( 0 == packet_number ) {
+    if ( pk->out_size != 4*4 + 4*4 + BEGPAK_META ) pk->failed = 1;
+  } else {
+    if ( pk->head_have < META_SZ ) pk->failed = 1;
+  }
 
-            }
-            else
-            {
-               //  wait for more input
-            }
-          }
-        }
-      }
+  return pk->failed || pk->fd < 0;
+}
+
+static void packet_from_bursts ( rx_connection_t* conn, uint16_t hynv_number, uint16_t profile_ID, uint16_t packet_number ) {
+  const char* const function_name = "packet_from_bursts";
+
+  Assembling_Profile_t* ap = conn->ap;
+  Assembling_Packet_t*  pk = ap->pk[packet_number];
+
+  int const invalid = stream_finish ( pk, packet_number );
+
+  uint32_t const p_size = pk->out_size;
+  char     head[META_SZ];
+  memcpy ( head, pk->head, META_SZ );
+
+  if ( !invalid ) {
+
+    char fn_part[300], fn[300];
+    rx_packet_path ( hynv_number, profile_ID, packet_number, ".part", fn_part, sizeof(fn_part), 0 );
+    rx_packet_path ( hynv_number, profile_ID, packet_number, "",      fn,      sizeof(fn),      0 );
+
+    close ( pk->fd );
+    pk->fd = -1;
+
+    if ( rename ( fn_part, fn ) ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "Cannot rename to '%s'", fn );
     }
+  }
 
-    now = time((time_t*)0);
+  //  Release burst information back to empty.
+  //  Then, if the content of this packet turned out to be invalid,
+  //  the empty burst items will all be re-received.
+  packet_release ( ap, &conn->held, packet_number );
 
-    //  If we did not receive anything for the last 60 seconds,
-    //  assume the sender believes it is done.
-    //
-    //  If we are not done, take action:
+  if ( invalid ) {
 
-    if ( now > lastrxed + 15 ) {
+    //  Must resend all of packet packet_number,
+    //  because we cannot identify the place of error.
+    syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu all", packet_number );
+    rx_reply ( conn->fd, "RSND", hynv_number, profile_ID, packet_number, 999 );
 
-      if ( !rx_profile.dp_need && rx_profile.dp_rxed > 0 ) {
-        //  We did not receive packet zero, but other packet(s).
-        //  Issue resend packet zero request
-        //
-        char rsnd[32];
-        snprintf ( rsnd, 32, "RSND,%04hu,%05hu,%04hu,%03hu,",
-                              rx_profile.profile_def.profiler_sn,
-                              rx_profile.profile_def.profile_yyddd, 0, 999 );
-        syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu all", 0 );
-
-        uLong crc = crc32 ( 0L, Z_NULL, 0 );
-              crc = crc32 ( crc, rsnd, strlen(rsnd) );
-        char crcStr[9];
-        snprintf ( crcStr, 9, "%08X", crc );
-        write ( io_fd, rsnd, strlen(rsnd) );
-        write ( io_fd, crcStr, strlen(crcStr) );
-        write ( io_fd, Terminator, strlen(Terminator) );
-      } else if ( rx_profile.dp_need
-               && rx_profile.dp_rxed < rx_profile.dp_need ) {
-        //  We received packet zero, but not all other packets.
-        //  (a) assemble those packets where all burst were received.
-        //  (b) issue re-send requests where bursts are missing
-        uint16_t p;
-        for ( p=1; p<=rx_profile.dp_need; p++ ) {
-          if ( !rx_profile.dp_have[p] ) {
-            if ( rx_profile.b_need[p]
-              && rx_profile.b_need[p] == rx_profile.b_rxed[p] ) {
-              packet_from_bursts( rx_profile.profile_def.profiler_sn,
-                                              rx_profile.profile_def.profile_yyddd, p, io_fd, data_dir );
-            } else if ( 0 == rx_profile.b_need[p] ) {
-              //  Request resend of burst [p][0]
-              char rsnd[32];
-              snprintf ( rsnd, 32, "RSND,%04hu,%05hu,%04hu,%03hu,",
-                              rx_profile.profile_def.profiler_sn,
-                              rx_profile.profile_def.profile_yyddd, p, 0 );
-              syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu %3hu", p, 0 );
-
-              uLong crc = crc32 ( 0L, Z_NULL, 0 );
-                    crc = crc32 ( crc, rsnd, strlen(rsnd) );
-              char crcStr[9];
-              snprintf ( crcStr, 9, "%08X", crc );
-              write ( io_fd, rsnd, strlen(rsnd) );
-              write ( io_fd, crcStr, strlen(crcStr) );
-              write ( io_fd, Terminator, strlen(Terminator) );
-
-            } else {  //  b_need > 0 && b_need != b_rxed
-
-              //  This occurs when one or more bursts in the frame were not received
-              //  Request resending those bursts
-              //
-              int b;
-              for ( b=1; b<=rx_profile.b_need[p]; b++ ) {
-                if ( !rx_profile.b_have[p][b] ) {
-                  //  Request resend of burst [p][b]
-                  char rsnd[32];
-                  snprintf ( rsnd, 32, "RSND,%04hu,%05hu,%04hu,%03hu,",
-                              rx_profile.profile_def.profiler_sn,
-                              rx_profile.profile_def.profile_yyddd, p, b );
-                  syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu %3hu", p, b );
-
-                  uLong crc = crc32 ( 0L, Z_NULL, 0 );
-                        crc = crc32 ( crc, rsnd, strlen(rsnd) );
-                  char crcStr[9];
-                  snprintf ( crcStr, 9, "%08X", crc );
-                  write ( io_fd, rsnd, strlen(rsnd) );
-                  write ( io_fd, crcStr, strlen(crcStr) );
-                  write ( io_fd, Terminator, strlen(Terminator) );
-                }
-              }
-            }
-          }
-        }
+  } else {
+
+    if ( 0 == packet_number ) {
+
+      if ( ap->pip_have ) {
+        syslog_out ( SYSLOG_ERROR, function_name, "Re-received %4hu", packet_number );
+      } else {
+        ap->pip_have = 1;
+      }
+
+      //  Now read the number of packets stored in the info packet,
+      //  so this receiver knows how many packets to expect in total
+      //
+      ap->profile_def.numData_SBRD     = number_from_4chars ( head+ 0 );
+      ap->profile_def.numData_PORT     = number_from_4chars ( head+ 4 );
+      ap->profile_def.numData_OCR      = number_from_4chars ( head+ 8 );
+      ap->profile_def.numData_MCOMS    = number_from_4chars ( head+12 );
+      ap->profile_def.numPackets_SBRD  = number_from_4chars ( head+16 );
+      ap->profile_def.numPackets_PORT  = number_from_4chars ( head+20 );
+      ap->profile_def.numPackets_OCR   = number_from_4chars ( head+24 );
+      ap->profile_def.numPackets_MCOMS = number_from_4chars ( head+28 );
+
+      ap->dp_need = ap->profile_def.numPackets_SBRD
+                  + ap->profile_def.numPackets_PORT
+                  + ap->profile_def.numPackets_OCR
+                  + ap->profile_def.numPackets_MCOMS;
+
+      if ( ap->dp_need >= MXPCKT ) {
+        syslog_out ( SYSLOG_ERROR, function_name, "Profile has %hu packets, accepting %d", ap->dp_need, MXPCKT-1 );
+        ap->dp_need = MXPCKT-1;
       }
 
-      lastrxed = now;   //  Make sure to wait again!
+    } else {
+
+      syslog_out ( SYSLOG_DEBUG, function_name,
+                                 "received packet SZ %u decoded", p_size );
+
+      if ( ap->dp_have[packet_number] ) {
+        syslog_out ( SYSLOG_ERROR, function_name, "Re-received %4hu", packet_number );
+      } else {
+        ap->dp_have[packet_number] = 1;
+        ap->dp_rxed                 ++;
+      }
     }
 
-    now = time((time_t*)0);
-    if ( now > statusout+5 ) {
-      syslog_out ( SYSLOG_INFO, function_name, "Status %hu / %hu", rx_profile.dp_rxed, rx_profile.dp_need );
-      statusout = now;
+    //  ACK this packet
+    rx_reply ( conn->fd, "RXED", hynv_number, profile_ID, packet_number, 999 );
+
+    if ( ap->dp_need && ap->dp_rxed == ap->dp_need ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "Profile %04hu %05hu complete", hynv_number, profile_ID );
     }
+  }
+}
 
-    //  Loop as long as
-    //    there is no packet zero (indicated by dp_need == 0)
-    //    or not all packets are received (dp_rxed < dp_need)
-    //  However, there is a timeout!
+static int packet_assembled ( Assembling_Profile_t* ap, uint16_t packet_number ) {
+  return 0 == packet_number ? ap->pip_have : ap->dp_have[packet_number];
+}
 
-  } while ( (rx_profile.dp_need==0 || rx_profile.dp_rxed < rx_profile.dp_need )
-         && time((time_t*)0) < timeout );
+//  Request all missing bursts of a packet.
+//  If burst zero is missing, the number of bursts is unknown,
+//  so request only that.
+//  Bursts asked for by the sliding window since the last request
+//  are left out: their resend may already be on its way.
+//
+static void packet_request_missing ( rx_connection_t* conn, uint16_t hynv_number, uint16_t profile_ID, uint16_t packet_number ) {
+  const char* const function_name = "packet_request_missing";
 
-  syslog_out ( SYSLOG_INFO, function_name, "Status %hu / %hu", rx_profile.dp_rxed, rx_profile.dp_need );
+  Assembling_Packet_t* pk = conn->ap->pk[packet_number];
 
-  if ( rx_profile.dp_rxed < rx_profile.dp_need ) {
-    uint16_t p;
-    for ( p=1; p<=rx_profile.dp_need; p++ ) {
-      syslog_out ( SYSLOG_INFO, function_name, "Status %hu : %c", p, rx_profile.dp_have[p] ? '+' : '-' );
+  if ( !pk || 0 == pk->b_need ) {
+    syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu %3hu", packet_number, 0 );
+    rx_reply ( conn->fd, "RSND", hynv_number, profile_ID, packet_number, 0 );
+  } else {
+    int b;
+    for ( b = pk->b_nakd+1;  b <= pk->b_need;  b++ ) {
+      if ( b >= pk->b_alloc || !pk->b_have[b] ) {
+        syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu %3hu", packet_number, b );
+        rx_reply ( conn->fd, "RSND", hynv_number, profile_ID, packet_number, b );
+      }
     }
+    pk->b_nakd = 0;
   }
+}
 
-  //  If total timeout, process all available data.
-  //
+//  Sliding window with repair bursts: a burst missing this close to
+//  the end of its packet is left to the repair bursts. The float sends
+//  them, and the terminating burst, before its window closes on the gap.
+//
+static int packet_repair_awaited ( rx_connection_t* conn, Assembling_Packet_t* pk, uint16_t burst_number ) {
+  return pk->x_groups && pk->b_need && burst_number + conn->window > pk->b_need;
+}
 
-  syslog_out ( SYSLOG_NOTICE, function_name, "Received %zu characters", end_input );
+//  Sliding window, after data burst burst_number of a packet came in:
+//  ask once for each burst missing in front of it (selective repeat),
+//  and acknowledge all bursts decoded so far (cumulative).
+//
+static void packet_window_reply ( rx_connection_t* conn, uint16_t hynv_number, uint16_t profile_ID, uint16_t packet_number,
+                                  Assembling_Packet_t* pk, uint16_t burst_number ) {
+  const char* const function_name = "packet_window_reply";
+
+  uint16_t b;
+  for ( b = ( pk->b_nakd >= pk->b_next ) ? pk->b_nakd+1 : pk->b_next;  b < burst_number;  b++ ) {
+    if ( packet_repair_awaited ( conn, pk, b ) ) break;
+    if ( b >= pk->b_alloc || !pk->b_have[b] ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu %3hu", packet_number, b );
+      rx_reply ( conn->fd, "RSND", hynv_number, profile_ID, packet_number, b );
+    }
+  }
+  if ( b > pk->b_nakd+1 ) {
+    pk->b_nakd = b-1;
+  }
 
-  free ( all_input );
+  if ( pk->b_next > 1 ) {
+    rx_reply ( conn->fd, "ACKD", hynv_number, profile_ID, packet_number, pk->b_next-1 );
+  }
+}
 
-  close( io_fd );
-  close( socket_fd );
+static void profile_free ( Assembling_Profile_t* ap ) {
 
-  syslog_out ( SYSLOG_NOTICE, function_name, "End" );
+  size_t held = 0;
 
-  return 0;
+  uint16_t p;
+  for ( p=0; p<MXPCKT; p++ ) {
+    packet_release ( ap, &held, p );
+  }
+  free ( ap );
+}
+
+//  Keep the profile of a closed connection for the next call of its float.
+//  If too many are kept, drop the one parked longest.
+//
+static void profile_park ( Assembling_Profile_t* ap ) {
+
+  ap->parked = time((time_t*)0);
+  ap->next   = rx_parked;
+  rx_parked  = ap;
+
+  int n = 0;
+  Assembling_Profile_t** pp;
+  for ( pp = &rx_parked; *pp; pp = &((*pp)->next) ) {
+    if ( ++n > RX_MAX_PARKED ) {
+      syslog_out ( SYSLOG_NOTICE, "profile_park", "Dropping %04hu %05hu",
+                   (*pp)->profile_def.profiler_sn, (*pp)->profile_def.profile_id );
+      profile_free ( *pp );
+      *pp = 0;
+      break;
+    }
+  }
 }
 
+//  Release the profiles parked before a given time
+//
+static void profile_expire ( time_t before ) {
 
+  Assembling_Profile_t** pp = &rx_parked;
+
+  while ( *pp ) {
+    Assembling_Profile_t* ap = *pp;
+    if ( ap->parked < before ) {
+      *pp = ap->next;
+      profile_free ( ap );
+    } else {
+      pp = &ap->next;
+    }
+  }
+}
+
+static int rx_connection_read ( rx_connection_t* conn );
+
+//  The profile a float was sending when its previous call ended:
+//  either parked, or still held by a connection that did not notice yet
+//  that the float is gone. That connection's pending input is parsed first.
+//  Returns 0 if this is a new profile.
+//
+static Assembling_Profile_t* profile_resume ( rx_connection_t* conn, uint16_t hynv_number, uint16_t profile_ID ) {
+
+  Assembling_Profile_t* ap = 0;
+
+  Assembling_Profile_t** pp;
+  for ( pp = &rx_parked; *pp; pp = &((*pp)->next) ) {
+    if ( (*pp)->profile_def.profiler_sn == hynv_number
+      && (*pp)->profile_def.profile_id  == profile_ID ) {
+      ap  = *pp;
+      *pp = ap->next;
+      break;
+    }
+  }
+
+  rx_connection_t* other;
+  for ( other = rx_connections; !ap && other; other = other->next ) {
+    if ( other != conn && other->ap
+      && other->ap->profile_def.profiler_sn == hynv_number
+      && other->ap->profile_def.profile_id  == profile_ID ) {
+      (void)rx_connection_read ( other );
+      ap = other->ap;
+      other->ap   = 0;
+      other->held = 0;
+    }
+  }
+
+  if ( !ap ) return 0;
+
+  ap->next = 0;
+
+  //  Bursts held out of order now count for this connection.
+  //  Resends asked for during the lost call will not come.
+  //
+  uint16_t p, b;
+  for ( p=0; p<MXPCKT; p++ ) {
+    if ( ap->pk[p] ) {
+      ap->pk[p]->b_nakd = 0;
+      for ( b=0; b<ap->pk[p]->b_alloc; b++ ) {
+        if ( ap->pk[p]->b[b] ) conn->held += ap->pk[p]->b_size[b];
+      }
+    }
+  }
+  if ( conn->held > conn->held_peak ) conn->held_peak = conn->held;
+
+  syslog_out ( SYSLOG_NOTICE, "profile_resume", "Resume %04hu %05hu %hu / %hu",
+               hynv_number, profile_ID, ap->dp_rxed, ap->dp_need );
+
+  return ap;
+}
+
+//  Tell a float that called again what was received during earlier calls:
+//  RXED for packets complete, HELD for packets partially received.
+//  Leaves out the packet of the burst that started the call,
+//  such that the reply to that burst comes after all of the report.
+//
+static void profile_report ( rx_connection_t* conn, uint16_t packet_number ) {
+
+  Assembling_Profile_t* ap = conn->ap;
+  uint16_t const hynv_number = ap->profile_def.profiler_sn;
+  uint16_t const profile_ID  = ap->profile_def.profile_id;
+
+  uint16_t p;
+  for ( p=0; p<MXPCKT; p++ ) {
+    if ( p == packet_number ) {
+      continue;
+    } else if ( 0 == p ? ap->pip_have : ap->dp_have[p] ) {
+      rx_reply ( conn->fd, "RXED", hynv_number, profile_ID, p, 999 );
+    } else if ( ap->pk[p] ) {
+      rx_reply_held ( conn->fd, hynv_number, profile_ID, p, ap->pk[p] );
+    }
+  }
+}
+
+//  Bursts of one connection must all belong to one profile.
+//  Returns 0 if the burst is to be discarded.
+//
+static int burst_matches_profile ( rx_connection_t* conn, uint16_t hynv_number, uint16_t profile_ID, uint16_t packet_number ) {
+  const char* const function_name = "burst_matches_profile";
+
+  if ( !conn->ap ) {
+    if ( ( conn->ap = profile_resume ( conn, hynv_number, profile_ID ) ) ) {
+      profile_report ( conn, packet_number );
+      return 1;
+    }
+    conn->ap = calloc ( 1, sizeof(Assembling_Profile_t) );
+    if ( !conn->ap ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "Out-of-memory" );
+      return 0;
+    }
+    conn->ap->profile_def.profiler_sn = hynv_number;
+    conn->ap->profile_def.profile_id  = profile_ID;
+  }
+
+  if ( hynv_number != conn->ap->profile_def.profiler_sn
+    || profile_ID  != conn->ap->profile_def.profile_id ) {
+    syslog_out ( SYSLOG_WARNING, function_name, "Profile mismatch %04hu %04hu P %05hu %05hu",
+                        conn->ap->profile_def.profiler_sn, hynv_number,
+                        conn->ap->profile_def.profile_id, profile_ID );
+    return 0;
+  }
+
+  return 1;
+}
+
+//  Parse one burst from the connection input.
+//  Returns 1 if input was consumed, 0 if more input is needed.
+//
+static int burst_parse ( rx_connection_t* conn ) {
+  const char* const function_name = "burst_parse";
+
+  //  Look for the start of a burst
+  //    Search currently available input
+  //    for start of a BURST (BRST, or BRSB once binary framing was granted),
+  //    or of an offer of the float (WNDW, MODE).
+  //    Skip over all non-sync data,
+  //    then wait for the complete header.
+  //
+  while ( !conn->have_sync && conn->end_input-conn->start_input >= 4 ) {
+    const unsigned char* const sync = conn->input+conn->start_input;
+    if ( memcmp ( sync, "BRST", 4 )
+      && memcmp ( sync, "WNDW", 4 )
+      && memcmp ( sync, "MODE", 4 )
+      && ( !conn->binary || memcmp ( sync, "BRSB", 4 ) ) ) {
+      conn->start_input++;
+    } else {
+      conn->have_sync = 1;
+    }
+  }
+
+  if ( !conn->have_sync ) return 0;
+
+  unsigned char* const frame = conn->input+conn->start_input;
+  size_t const         avail = conn->end_input-conn->start_input;
+
+  uint16_t hynv_number = 0,
+           profile_ID = 0,
+           packet_number = 0,
+           burst_number = 0,
+           burst_size = 0;
+  unsigned int crc = 0;
+
+  //  Either framing (see profile_packet.shared.h) is taken apart into
+  //    head   bytes in front of the data
+  //    size   bytes of data (burst_size for data bursts, else none)
+  //    tail   bytes after the data, the CRC with binary framing
+  //  the CRC being over the first crc_len bytes of the head and the data.
+  //
+  char const binary  = ( 0 == memcmp ( frame, "BRSB", 4 ) );
+  size_t     head    = BRST_HEADER;
+  size_t     tail    = 0;
+  size_t     crc_len = 24;
+  size_t     size    = 0;
+  char       end     = 0;
+
+  if ( binary ) {
+
+    if ( avail < BRSB_HEADER ) return 0;
+
+    hynv_number   = (uint16_t)( frame[ 4]<<8 | frame[ 5] );
+    profile_ID    = (uint16_t)( frame[ 6]<<8 | frame[ 7] );
+    packet_number = (uint16_t)( frame[ 8]<<8 | frame[ 9] );
+    burst_number  = (uint16_t)( frame[10]<<8 | frame[11] );
+    burst_size    = (uint16_t)( frame[12]<<8 | frame[13] );
+
+    end = ( BRSB_END == burst_number );
+
+    if ( !end && 0 != burst_number ) {
+      size = burst_size;
+    }
+
+    if ( size > BRSB_MAX_DATA || ( burst_number > 999 && !end && BRSB_PROBE != burst_number ) ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "binary burst header misformatted" );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+
+    head    = BRSB_HEADER;
+    tail    = BRSB_TRAILER;
+    crc_len = BRSB_HEADER;
+
+    if ( avail < head + size + tail ) {
+      //  wait for more input
+      return 0;
+    }
+
+    unsigned char const* const trailer = frame + head + size;
+    crc = (unsigned int)trailer[0]<<24 | (unsigned int)trailer[1]<<16 | (unsigned int)trailer[2]<<8 | trailer[3];
+
+  } else {
+
+    if ( avail < BRST_HEADER ) return 0;
+  }
+
+  char sync32[BRST_HEADER+1];
+  memset ( sync32, 0, sizeof(sync32) );
+  if ( !binary ) memcpy ( sync32, frame, BRST_HEADER );
+
+  if ( BRSB_PROBE == burst_number && binary ) {
+
+    //  Probe of binary framing, sent by the float once granted:
+    //  255, 254, ... 0, which arrive intact over an 8 bit clean path only.
+    //  Confirmed, bursts framed in binary are accepted.
+    //
+    uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
+          calcCRC = crc32 ( calcCRC, frame, crc_len + size );
+
+    uint16_t intact = ( calcCRC == crc && 256 == size );
+    size_t i;
+    for ( i=0; i<size && intact; i++ ) {
+      intact = ( frame[head+i] == 255-i );
+    }
+
+    syslog_out ( SYSLOG_INFO, function_name, "Probe %04hu %05hu %s", hynv_number, profile_ID, intact ? "intact" : "damaged" );
+
+    conn->binary = intact ? 2 : 0;
+    rx_reply ( conn->fd, "MODE", hynv_number, profile_ID, 1, intact );
+
+    //  Damaged, its length may be too: look for the next burst right after "BRSB"
+    conn->have_sync = 0; conn->start_input += intact ? head + size + tail : 4;
+    return 1;
+  }
+
+  if ( 0 == memcmp ( sync32, "MODE", 4 ) ) {
+
+    //  Framing modes offered by the float after calling, framed like burst 0,
+    //  in the burst number field. Granted binary framing, the float sends a probe.
+    //
+    uint16_t offered = 0;
+
+    if ( 6 != sscanf ( sync32, "MODE%4hu%5hu%4hu%3hu%4hu%8X",
+                        &hynv_number, &profile_ID, &packet_number, &offered, &burst_size, &crc ) ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "mode offer misformatted" );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+
+    uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
+          calcCRC = crc32 ( calcCRC, (Bytef*)sync32, 24 );
+
+    if ( calcCRC != crc ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "mode offer, CRC Error" );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+
+    conn->have_sync = 0; conn->start_input += BRST_HEADER;
+
+    uint16_t const granted = offered & ( RX_BINARY ? BRST_MODE_BINARY : 0 );
+    conn->binary = ( granted & BRST_MODE_BINARY ) ? 1 : 0;
+
+    syslog_out ( SYSLOG_INFO, function_name, "Mode %04hu %05hu offered %hu granted %hu",
+                 hynv_number, profile_ID, offered, granted );
+    rx_reply ( conn->fd, "MODE", hynv_number, profile_ID, 0, granted );
+    return 1;
+  }
+
+  if ( 0 == memcmp ( sync32, "WNDW", 4 ) ) {
+
+    //  Sliding window offered by the float after calling, framed like burst 0,
+    //  and in the burst number field, repair bursts per packet.
+    //  Granted up to RX_MAX_WINDOW data bursts; from then on,
+    //  every data burst is answered by ACKD and, past a gap, by RSND.
+    //  Granted up to RX_MAX_REPAIR repair bursts, replied in the packet field.
+    //
+    uint16_t offered = 0;
+
+    if ( 6 != sscanf ( sync32, "WNDW%4hu%5hu%4hu%3hu%4hu%8X",
+                        &hynv_number, &profile_ID, &packet_number, &burst_number, &offered, &crc ) ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "window offer misformatted" );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+
+    uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
+          calcCRC = crc32 ( calcCRC, (Bytef*)sync32, 24 );
+
+    if ( calcCRC != crc ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "window offer, CRC Error" );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+
+    conn->have_sync = 0; conn->start_input += BRST_HEADER;
+
+    conn->window = ( offered < RX_MAX_WINDOW ) ? offered : RX_MAX_WINDOW;
+    conn->repair = ( burst_number < RX_MAX_REPAIR ) ? burst_number : RX_MAX_REPAIR;
+    if ( conn->window || conn->repair ) {
+      syslog_out ( SYSLOG_INFO, function_name, "Window %04hu %05hu %hu repair %hu",
+                   hynv_number, profile_ID, conn->window, (uint16_t)conn->repair );
+      rx_reply ( conn->fd, "WNDW", hynv_number, profile_ID, conn->repair, conn->window );
+    }
+    return 1;
+  }
+
+  if ( !binary && 0 == memcmp ( sync32+17, "ZZZZZZZ", 7 ) ) {
+
+    if ( 4 != sscanf ( sync32, "BRST%4hu%5hu%4huZZZZZZZ%8X",
+                        &hynv_number, &profile_ID, &packet_number, &crc ) ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "EOP burst header misformatted" );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+    end = 1;
+
+  } else if ( !binary ) {
+
+    if ( 6 != sscanf ( sync32, "BRST%4hu%5hu%4hu%3hu%4hu%8X",
+                        &hynv_number, &profile_ID, &packet_number,
+                        &burst_number, &burst_size, &crc ) ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "burst header misformatted" );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+    if ( burst_number ) size = burst_size;
+  }
+
+  conn->frame_binary = binary;
+
+  if ( end ) {
+
+    //  Final burst in packet (ZZZZZZZ burst)
+    //  Assemble packet from bursts OR identify missing bursts
+    //
+
+    //  First make sure data were not corrupted in transfer
+    uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
+          calcCRC = crc32 ( calcCRC, frame, crc_len );
+
+    if ( calcCRC != crc ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "burst %hu end, CRC Error", packet_number );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+
+    conn->have_sync = 0; conn->start_input += head + tail;
+
+    if ( packet_number >= MXPCKT ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "Packet %hu out of range", packet_number );
+      return 1;
+    }
+
+    if ( !burst_matches_profile ( conn, hynv_number, profile_ID, packet_number ) ) {
+      //  Discard bursts intended for different profiler/profile
+      return 1;
+    }
+
+    syslog_out ( SYSLOG_DEBUG, function_name, "Have %hu %hu %4hu end brst %8x",
+                      hynv_number, profile_ID, packet_number, crc );
+
+    Assembling_Profile_t* ap = conn->ap;
+
+    if ( packet_assembled ( ap, packet_number ) ) {
+
+      //  Already have this packet: the earlier ACK may have been lost
+      rx_reply ( conn->fd, "RXED", hynv_number, profile_ID, packet_number, 999 );
+
+    } else if ( packet_complete ( ap, packet_number ) ) {
+
+      //  All received, thus re-assemble this packet from individual bursts
+      //
+      packet_from_bursts ( conn, hynv_number, profile_ID, packet_number );
+
+      //  Check if previous packets are not assembled.
+      //  In that case, check if all bursts are received.
+      //  In that case, assemble the packet.
+      //
+      //  If not all bursts were received,
+      //  there may already be a resend request on its way.
+      //  !!!  NEVER issue double resend requests  !!!
+      //  !!!  It wastes valuable modem-on time and float energy.  !!!
+      //
+      uint16_t p;
+      for ( p=1; p<packet_number; p++ ) {
+        if ( !ap->dp_have[p] && packet_complete ( ap, p ) ) {
+          packet_from_bursts ( conn, hynv_number, profile_ID, p );
+        }
+      }
+
+    } else {
+
+      //  Burst zero or one or more data bursts were not received.
+      //  Request resending those bursts
+      //
+      packet_request_missing ( conn, hynv_number, profile_ID, packet_number );
+    }
+
+    return 1;
+  }
+
+  if ( 0 == burst_number ) {
+
+    //  Burst #0 has its header only, all ready to use
+    //  In burst #0, reinterpret the 5th value
+    uint16_t num_of_bursts = burst_size;
+
+    uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
+          calcCRC = crc32 ( calcCRC, frame, crc_len );
+
+    if ( calcCRC != crc ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "burst %hu 0, CRC Error", packet_number );
+      conn->have_sync = 0; conn->start_input += 4;
+      return 1;
+    }
+
+    conn->have_sync = 0; conn->start_input += head + tail;
+
+    if ( packet_number >= MXPCKT ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "Packet %hu out of range", packet_number );
+      return 1;
+    }
+
+    if ( !burst_matches_profile ( conn, hynv_number, profile_ID, packet_number ) ) {
+      return 1;
+    }
+
+    if ( packet_assembled ( conn->ap, packet_number ) ) {
+      //  Already have this packet: the earlier ACK may have been lost
+      syslog_out ( SYSLOG_DEBUG, function_name, "Re-received %4hu %4hu", packet_number, burst_number );
+      rx_reply ( conn->fd, "RXED", hynv_number, profile_ID, packet_number, 999 );
+      return 1;
+    }
+
+    //  Held from a call in the other framing, its data encoded otherwise:
+    //  start over
+    if ( conn->ap->pk[packet_number] && conn->ap->pk[packet_number]->binary != binary ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "Framing changed %4hu, starting over", packet_number );
+      packet_release ( conn->ap, &conn->held, packet_number );
+    }
+
+    Assembling_Packet_t* pk = packet_slot ( conn, packet_number, num_of_bursts );
+    if ( !pk ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "Out-of-memory %4hu %4hu", packet_number, burst_number );
+    } else if ( pk->b_have[0] ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "Re-received %4hu %4hu", packet_number, burst_number );
+    } else {
+      pk->b_have[0] = 1;
+      pk->b_need    = num_of_bursts;
+      // data bursts for this packet may already have been received and decoded
+
+      syslog_out ( SYSLOG_DEBUG, function_name, "Have %hu %hu %4hu %3hu %4hu %8x",
+                    hynv_number, profile_ID, packet_number,
+                    burst_number, burst_size, crc );
+    }
+
+    //  A float resuming after a lost call waits for this,
+    //  then sends only the bursts not held.
+    //
+    if ( pk ) {
+      rx_reply_held ( conn->fd, hynv_number, profile_ID, packet_number, pk );
+    }
+    return 1;
+  }
+
+  //  burst_number > 0
+  //  In order to calculate the CRC,
+  //  need burst_size bytes after the header
+  //
+  if ( avail < head + size + tail ) {
+    //  wait for more input
+    return 0;
+  }
+
+  unsigned char* const burst_data = frame + head;
+
+  uLong calcCRC = crc32 ( 0L, Z_NULL, 0 );
+        calcCRC = crc32 ( calcCRC, frame, crc_len );
+        calcCRC = crc32 ( calcCRC, burst_data, size );
+
+  if ( calcCRC != crc ) {
+    syslog_out ( SYSLOG_NOTICE, function_name, "burst %hu %hu, CRC Error", packet_number, burst_number );
+
+    //  Sliding window: most likely the data were hit, not the header,
+    //  so ask for the burst now rather than after the next one,
+    //  which a float with a full window would not send.
+    //  Asked again each time, a resend can be hit too.
+    //  A header that was hit costs at most one needless resend.
+    //  Near the end of a packet with repair bursts, it is left to those.
+    //
+    if ( conn->window && conn->ap && packet_number < MXPCKT
+      && hynv_number == conn->ap->profile_def.profiler_sn
+      && profile_ID  == conn->ap->profile_def.profile_id ) {
+      Assembling_Packet_t* pk = conn->ap->pk[packet_number];
+      if ( pk && burst_number && burst_number <= pk->b_need ) {
+        packet_window_reply ( conn, hynv_number, profile_ID, packet_number, pk, burst_number );
+        if ( burst_number >= pk->b_next && ( burst_number >= pk->b_alloc || !pk->b_have[burst_number] )
+          && !packet_repair_awaited ( conn, pk, burst_number ) ) {
+          syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu %3hu", packet_number, burst_number );
+          rx_reply ( conn->fd, "RSND", hynv_number, profile_ID, packet_number, burst_number );
+          if ( burst_number > pk->b_nakd ) pk->b_nakd = burst_number;
+        }
+      }
+    }
+
+    conn->have_sync = 0; conn->start_input += 4;
+    return 1;
+  }
+
+  if ( packet_number >= MXPCKT ) {
+    syslog_out ( SYSLOG_ERROR, function_name, "Packet %hu out of range", packet_number );
+  } else if ( burst_matches_profile ( conn, hynv_number, profile_ID, packet_number ) ) {
+
+    Assembling_Packet_t* pk = 0;
+
+    if ( packet_assembled ( conn->ap, packet_number ) ) {
+      syslog_out ( SYSLOG_DEBUG, function_name, "Re-received %4hu %4hu", packet_number, burst_number );
+    } else if ( burst_number > 900 ) {
+
+      //  Repair burst, sent after the last data burst
+      //
+      if ( ( pk = packet_repair_burst ( conn, packet_number, burst_number, burst_data, burst_size ) ) ) {
+        burst_number = pk->r_bursts+1;
+      }
+
+    } else if ( !( pk = packet_slot ( conn, packet_number, burst_number ) ) ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "Out-of-memory %4hu %4hu", packet_number, burst_number );
+    } else if ( pk->b_have[burst_number] ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "Re-received %4hu %4hu", packet_number, burst_number );
+    } else if ( pk->binary != binary ) {
+      syslog_out ( SYSLOG_NOTICE, function_name, "Framing differs %4hu %4hu", packet_number, burst_number );
+    } else {
+
+      //  In order: decode directly from the input,
+      //  followed by bursts that were held for this one.
+      //  Ahead of a missing burst: hold a copy until the gap is filled.
+      //
+      packet_burst_accept ( conn, pk, packet_number, burst_number, burst_data, burst_size );
+      packet_repair ( conn, pk, packet_number );
+    }
+
+    if ( conn->window && pk ) {
+      packet_window_reply ( conn, hynv_number, profile_ID, packet_number, pk, burst_number );
+    }
+  }
+
+  conn->have_sync = 0; conn->start_input += head + size + tail;
+  return 1;
+}
+
+//  Read all available input of a connection and parse the complete bursts.
+//  Returns 1 if the connection was closed by the peer, or failed.
+//
+static int rx_connection_read ( rx_connection_t* conn ) {
+  const char* const function_name = "rx_connection_read";
+
+  for ( ;; ) {
+
+    //  Move unparsed input to the front of the buffer
+    //
+    if ( conn->start_input ) {
+      memmove ( conn->input, conn->input+conn->start_input, conn->end_input-conn->start_input );
+      conn->end_input  -= conn->start_input;
+      conn->start_input = 0;
+    }
+
+    ssize_t n = read ( conn->fd, conn->input+conn->end_input, RXBUFSZ-conn->end_input );
+
+    if ( 0 == n ) {
+      return 1;
+    }
+    if ( n < 0 ) {
+      if ( EAGAIN == errno || EWOULDBLOCK == errno ) return 0;
+      if ( EINTR  == errno ) continue;
+      syslog_out ( ECONNRESET == errno ? SYSLOG_NOTICE : SYSLOG_ERROR, function_name, "%s", strerror(errno) );
+      return 1;
+    }
+
+  # ifdef TXRXERRORRATE
+    if ( profile_receive_error_rate>0 ) {
+      if ( profile_receive_error_rate*n > drand48() ) {
+        conn->input[conn->end_input+rand()%n] ^= 0x66;
+      }
+    }
+  # endif
+
+    conn->end_input   += n;
+    conn->total_input += n;
+
+    conn->lastrxed = time((time_t*)0);
+
+    if ( conn->lastrxed > conn->heartbeat+5 ) {
+      char alif[8];
+      int const m = snprintf ( alif, sizeof(alif), "ALIF%s", Terminator );
+      if ( m != write ( conn->fd, alif, m ) ) {
+        syslog_out ( SYSLOG_WARNING, function_name, "ALIF not sent" );
+      }
+      conn->heartbeat = conn->lastrxed;
+    }
+
+    while ( burst_parse ( conn ) ) {
+      ;
+    }
+  }
+}
+
+//  If we did not receive anything for the last 15 seconds,
+//  assume the sender believes it is done.
+//  If we are not done, take action.
+//
+static void rx_connection_idle ( rx_connection_t* conn, time_t now ) {
+  const char* const function_name = "rx_connection_idle";
+
+  Assembling_Profile_t* ap = conn->ap;
+
+  if ( ap && now > conn->lastrxed + 15 ) {
+
+    uint16_t const hynv_number = ap->profile_def.profiler_sn;
+    uint16_t const profile_ID  = ap->profile_def.profile_id;
+
+    if ( !ap->dp_need && ap->dp_rxed > 0 ) {
+
+      //  We did not receive packet zero, but other packet(s).
+      //  Issue resend packet zero request
+      //
+      syslog_out ( SYSLOG_NOTICE, function_name, "Request Resend %4hu all", 0 );
+      rx_reply ( conn->fd, "RSND", hynv_number, profile_ID, 0, 999 );
+    }
+
+    if ( !ap->dp_need || ap->dp_rxed < ap->dp_need ) {
+
+      //  Not all packets received, or without packet zero, those begun.
+      //  (a) assemble those packets where all burst were received.
+      //  (b) issue re-send requests where bursts are missing
+      uint16_t const last = ap->dp_need ? ap->dp_need : MXPCKT-1;
+      uint16_t p;
+      for ( p=1; p<=last; p++ ) {
+        if ( !ap->dp_have[p] && ( ap->dp_need || ap->pk[p] ) ) {
+          if ( packet_complete ( ap, p ) ) {
+            packet_from_bursts ( conn, hynv_number, profile_ID, p );
+          } else {
+            //  Resends asked for by the window did not come either
+            if ( ap->pk[p] ) ap->pk[p]->b_nakd = 0;
+            packet_request_missing ( conn, hynv_number, profile_ID, p );
+          }
+        }
+      }
+    }
+
+    conn->lastrxed = now;   //  Make sure to wait again!
+  }
+
+  if ( ap && now > conn->statusout+5 ) {
+    syslog_out ( SYSLOG_INFO, function_name, "Status %04hu %05hu %hu / %hu",
+                 ap->profile_def.profiler_sn, ap->profile_def.profile_id, ap->dp_rxed, ap->dp_need );
+    conn->statusout = now;
+  }
+}
+
+static rx_connection_t* rx_connection_open ( int fd ) {
+
+  rx_connection_t* conn = calloc ( 1, sizeof(rx_connection_t) );
+  if ( !conn ) return 0;
+
+  conn->input = malloc ( RXBUFSZ );
+  if ( !conn->input ) {
+    free ( conn );
+    return 0;
+  }
+
+  conn->fd = fd;
+
+  time_t const now = time((time_t*)0);
+  conn->lastrxed  = now;
+  conn->heartbeat = now-10;
+  conn->statusout = now;
+
+  return conn;
+}
+
+static void rx_connection_close ( rx_connection_t* conn ) {
+  const char* const function_name = "rx_connection_close";
+
+  Assembling_Profile_t* ap = conn->ap;
+
+  if ( ap ) {
+    syslog_out ( SYSLOG_INFO, function_name, "Status %04hu %05hu %hu / %hu",
+                 ap->profile_def.profiler_sn, ap->profile_def.profile_id, ap->dp_rxed, ap->dp_need );
+
+    if ( ap->dp_rxed < ap->dp_need ) {
+      uint16_t p;
+      for ( p=1; p<=ap->dp_need; p++ ) {
+        syslog_out ( SYSLOG_INFO, function_name, "Status %hu : %c", p, ap->dp_have[p] ? '+' : '-' );
+      }
+    }
+
+    //  Keep what was received for the next call of the float
+    profile_park ( ap );
+  }
+
+  syslog_out ( SYSLOG_NOTICE, function_name, "Received %zu characters, held at most %zu out of order",
+               conn->total_input, conn->held_peak );
+
+  if ( conn->fd > 0 ) close ( conn->fd );
+  free ( conn->input );
+  free ( conn );
+}
+
+static int rx_listen ( uint16_t port ) {
+  const char* const function_name = "rx_listen";
+
+  int socket_fd = socket ( AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0 );
+  if ( socket_fd < 0 ) {
+    syslog_out ( SYSLOG_ERROR, function_name, "%s", strerror(errno) );
+    return -1;
+  }
+
+  int const on = 1;
+  setsockopt ( socket_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on) );
+
+  struct sockaddr_in server_address;
+  memset ( &server_address, 0, sizeof(server_address) );
+
+  server_address.sin_family = AF_INET;
+  server_address.sin_addr.s_addr = INADDR_ANY;
+  server_address.sin_port = htons(port);
+
+  if ( bind ( socket_fd, (struct sockaddr *) &server_address, sizeof(server_address) ) < 0 ) {
+    syslog_out ( SYSLOG_ERROR, function_name, "%s: Error on binding", strerror(errno) );
+    close ( socket_fd );
+    return -1;
+  }
+
+  if ( listen ( socket_fd, 64 ) < 0 ) {
+    syslog_out ( SYSLOG_ERROR, function_name, "%s: Error on listening", strerror(errno) );
+    close ( socket_fd );
+    return -1;
+  }
+
+  return socket_fd;
+}
+
+//  Receive profiles.
+//    0==port : A single float on stdin. Replies cannot be delivered.
+//    else    : Any number of floats connecting to port, each served
+//              in the same epoll loop with its own profile assembler.
+//  Runs until SIGINT/SIGTERM, or until stdin is closed.
+//
+int profile_receive ( const char* data_dir, uint16_t port ) {
+  const char* const function_name = "profile_receive";
+
+  syslog_out ( SYSLOG_NOTICE, function_name, "Start" );
+
+  if ( data_dir && data_dir[0] ) {
+    rx_data_dir = data_dir;
+  }
+
+  rx_stop = 0;
+  signal ( SIGINT,  rx_signal );
+  signal ( SIGTERM, rx_signal );
+  signal ( SIGPIPE, SIG_IGN );
+
+  int epoll_fd = epoll_create1 ( 0 );
+  if ( epoll_fd < 0 ) {
+    syslog_out ( SYSLOG_ERROR, function_name, "%s", strerror(errno) );
+    return 1;
+  }
+
+  int socket_fd = -1;
+
+  struct epoll_event ev;
+  memset ( &ev, 0, sizeof(ev) );
+
+  if ( 0 == port ) {
+
+    rx_connection_t* conn = rx_connection_open ( 0 );
+    if ( !conn ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "Out-of-memory" );
+      close ( epoll_fd );
+      return 1;
+    }
+
+    ev.events   = EPOLLIN;
+    ev.data.ptr = conn;
+    if ( epoll_ctl ( epoll_fd, EPOLL_CTL_ADD, 0, &ev ) ) {
+      //  A regular file cannot be polled, but never blocks either
+      while ( !rx_connection_read ( conn ) ) {
+        ;
+      }
+      rx_connection_close ( conn );
+      profile_expire ( time((time_t*)0)+1 );
+      close ( epoll_fd );
+      syslog_out ( SYSLOG_NOTICE, function_name, "End" );
+      return 0;
+    }
+
+    int const fl = fcntl ( 0, F_GETFL );
+    fcntl ( 0, F_SETFL, fl | O_NONBLOCK );
+    rx_connections = conn;
+
+  } else {
+
+    socket_fd = rx_listen ( port );
+    if ( socket_fd < 0 ) {
+      close ( epoll_fd );
+      return 1;
+    }
+
+    //  The listening socket is marked by a 0 pointer
+    ev.events   = EPOLLIN;
+    ev.data.ptr = 0;
+    epoll_ctl ( epoll_fd, EPOLL_CTL_ADD, socket_fd, &ev );
+  }
+
+  struct epoll_event events[RX_MAX_EVENTS];
+  time_t last_idle_check = time((time_t*)0);
+
+  while ( !rx_stop ) {
+
+    int const nev = epoll_wait ( epoll_fd, events, RX_MAX_EVENTS, 1000 );
+
+    if ( nev < 0 && EINTR != errno ) {
+      syslog_out ( SYSLOG_ERROR, function_name, "%s", strerror(errno) );
+      break;
+    }
+
+    int e;
+    for ( e=0; e<nev; e++ ) {
+
+      rx_connection_t* conn = events[e].data.ptr;
+
+      if ( !conn ) {
+
+        //  Accept all pending connections
+        //
+        int io_fd;
+        while ( 0 <= ( io_fd = accept4 ( socket_fd, 0, 0, SOCK_NONBLOCK ) ) ) {
+
+          conn = rx_connection_open ( io_fd );
+          if ( !conn ) {
+            syslog_out ( SYSLOG_ERROR, function_name, "Out-of-memory, refusing connection" );
+            close ( io_fd );
+            continue;
+          }
+
+          ev.events   = EPOLLIN | EPOLLRDHUP;
+          ev.data.ptr = conn;
+          epoll_ctl ( epoll_fd, EPOLL_CTL_ADD, io_fd, &ev );
+
+          conn->next     = rx_connections;
+          rx_connections = conn;
+
+          syslog_out ( SYSLOG_NOTICE, function_name, "Connected %d", io_fd );
+        }
+
+      } else if ( rx_connection_read ( conn ) ) {
+
+        epoll_ctl ( epoll_fd, EPOLL_CTL_DEL, conn->fd, 0 );
+
+        rx_connection_t** pp;
+        for ( pp = &rx_connections; *pp; pp = &((*pp)->next) ) {
+          if ( *pp == conn ) {
+            *pp = conn->next;
+            break;
+          }
+        }
+        rx_connection_close ( conn );
+
+        if ( 0 == port ) {
+          rx_stop = 1;
+        }
+      }
+    }
+
+    time_t const now = time((time_t*)0);
+    if ( now != last_idle_check ) {
+      rx_connection_t* conn;
+      for ( conn = rx_connections; conn; conn = conn->next ) {
+        rx_connection_idle ( conn, now );
+      }
+      profile_expire ( now - RX_PARK_SECONDS );
+      last_idle_check = now;
+    }
+  }
+
+  while ( rx_connections ) {
+    rx_connection_t* conn = rx_connections;
+    rx_connections = conn->next;
+    rx_connection_close ( conn );
+  }
+
+  //  Partially received packets stay as .part files only while parked
+  profile_expire ( time((time_t*)0)+1 );
+
+  if ( socket_fd >= 0 ) close ( socket_fd );
+  close ( epoll_fd );
+
+  syslog_out ( SYSLOG_NOTICE, function_name, "End" );
+
+  return 0;
+}
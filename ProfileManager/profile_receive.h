@@ -6,4 +6,10 @@
 
 int profile_receive ( const char* data_dir, uint16_t port );
 
+# ifdef TXRXERRORRATE
+//  Test builds corrupt a received byte at this rate,
+//  TXRXERRORRATE unless set before profile_receive()
+extern double profile_receive_error_rate;
+# endif
+
 # endif
@@ -17,113 +17,34 @@
 
 # include "profile_description.h"
 # include "profile_packet.h"
+# include "packet_process.h"
 
-static int packet_process_transmit ( Profile_Data_Packet_t* original, transmit_instructions_t* tx_instruct, uint8_t* bstStatus, const char* data_dir, int tx_fd ) {
+//  Opt-in dump of intermediate stages (tx_instruct->save_stages)
+//
+static int packet_stage_save ( Profile_Data_Packet_t* stage, const char* type, void* dump_arg ) {
+  return data_packet_save ( stage, (const char*)dump_arg, type );
+}
+
+//  Process and transmit the packet in 'packet'.
+//  'work' is scratch space of the same size;
+//  both buffers are overwritten, no packet is copied.
+//
+static int packet_process_transmit ( Profile_Data_Packet_t* packet, Profile_Data_Packet_t* work, transmit_instructions_t* tx_instruct, uint8_t* bstStatus, const char* data_dir, int tx_fd ) {
 
   // Process packet
   //   Binary -> Graycode -> Bitplaned -> Compressed -> ASCII-Encoded
 
-  //  Represent spectra pixel values in graycode
-  //
-
-  Profile_Data_Packet_t represent;
-    
-  //  TODO: Round to proper position before graycoding if noise_remove>0
-
-  if  (tx_instruct->representation == REP_GRAY)
-  {
-    memset( &represent, 0, sizeof(Profile_Data_Packet_t) );
-    if ( data_packet_bin2gray( &original, &represent ) )
-    {
-      fprintf ( stderr, "Failed in data_packet_bin2gray()\n" );
-      return 1;
-    }
-    else
-    {
-      data_packet_save ( &represent, data_dir, "G" );
-    }
-  }
-  else
-  {
-    memcpy( &represent, &original, sizeof(Profile_Data_Packet_t) );
-  }
-  //fprintf ( stderr, "  gray %d\n", p );
-
-  //  Arrange the spectral data in bitplanes
-  //
-
-  Profile_Data_Packet_t arranged;
-
-  if  ( tx_instruct->use_bitplanes == BITPLANE )
-  {
-    memset( &arranged, 0, sizeof(Profile_Data_Packet_t) );
-    if ( data_packet_bitplane( &represent, &arranged, tx_instruct->noise_bits_remove ) )
-    {
-      fprintf ( stderr, "Failed in data_packet_bitplane()\n" );
-      return 1;
-    }
-    data_packet_save ( &arranged, data_dir, "B" );
-  }
-  else
-  {
-    memcpy ( &arranged, &represent, sizeof(Profile_Data_Packet_t) );
-  }
-  //fprintf ( stderr, "  plne %d\n", p );
-
-  //  Compress the packet
-  //
-
-  Profile_Data_Packet_t compressed;
-    
-  if ( tx_instruct->compression == ZLIB )
-  {
-    memset( &compressed, 0, sizeof(Profile_Data_Packet_t) );
-    char compression = 'G';
-    if ( data_packet_compress( &arranged, &compressed, compression ) )
-    {
-      fprintf ( stderr, "Failed in data_packet_compress()\n" );
-      return 1;
-    }
-    data_packet_save ( &compressed, data_dir, "C" );
-  } else {
-    memcpy( &compressed, &arranged, sizeof(Profile_Data_Packet_t) );
-  }
-  //fprintf ( stderr, "  zlib %d\n", p );
-
-  //  Encode the packet
-  //
-
-  Profile_Data_Packet_t encoded;
-    
-  if ( tx_instruct->encoding != NO_ENCODING )
-  {
-    memset( &encoded, 0, sizeof(Profile_Data_Packet_t) );
-    char encoding;
-  
-    switch ( tx_instruct->encoding )
-    {
-    case ASCII85: encoding = 'A'; break;
-    case BASE64 : encoding = 'B'; break;
-    default     : encoding = 'N'; break;
-    }
-    
-    if  ( data_packet_encode ( &compressed, &encoded, encoding ) )
-    {
-      fprintf ( stderr, "Failed in data_packet_compress()\n" );
-      return 1;
-    }
-    data_packet_save ( &encoded, data_dir, "E" );
-  }
-  else
-  {
-    memcpy( &encoded, &compressed, sizeof(Profile_Data_Packet_t) );
+  Profile_Data_Packet_t* encoded = packet_process ( packet, work, tx_instruct,
+                                                    tx_instruct->save_stages ? packet_stage_save : 0,
+                                                    (void*)data_dir );
+  if ( !encoded ) {
+    return 1;
   }
-  //fprintf ( stderr, "  zlib %d\n", p );
 
   //  Transmit the packet
   //
 
-  return data_packet_txmit ( &encoded, tx_instruct->burst_size, tx_fd, bstStatus );
+  return data_packet_txmit ( encoded, tx_instruct->burst_size, tx_fd, bstStatus );
 }
 
 
@@ -335,6 +256,11 @@ int profile_transmit ( const char*              data_dir,
   size_t const size_input = 2*1024L;
   unsigned char* all_input = malloc ( size_input );
 
+  //  Packet and scratch buffer for processing, reused for every packet
+  //
+  Profile_Data_Packet_t* packet = malloc ( 2 * sizeof(Profile_Data_Packet_t) );
+  Profile_Data_Packet_t* work   = packet ? packet + 1 : 0;
+
   // num_packets = num_data * sizeof(packet_data) / sizeof(data)
   //
 
@@ -357,7 +283,7 @@ int profile_transmit ( const char*              data_dir,
     }
   }
 
-  if ( !all_input | !pckStatus | !bstStatus ) {
+  if ( !all_input | !packet | !pckStatus | !bstStatus ) {
     //  SYSTEM FAILURE!!!
     //  Need fallback
     fprintf ( stderr, "SYSTEM FAILURE MALLOC - Implement fallback" );
@@ -415,13 +341,12 @@ int profile_transmit ( const char*              data_dir,
 
           // Read a packet
           //
-          Profile_Data_Packet_t original;
-          memset ( &original, 0, sizeof (Profile_Data_Packet_t) );
-          data_packet_retrieve ( &original, data_dir, "Z", proID, p );
+          memset ( packet, 0, sizeof (Profile_Data_Packet_t) );
+          data_packet_retrieve ( packet, data_dir, "Z", proID, p );
           //fprintf ( stderr, "  read %d\n", p );
 	        //
 
-	        if  ( 0 == packet_process_transmit ( &original, tx_instruct, bstStatus[p], data_dir, tx_fd ) ) 
+	        if  ( 0 == packet_process_transmit ( packet, work, tx_instruct, bstStatus[p], data_dir, tx_fd ) ) 
           {
             pckStatus[p] = 0;  //  transmit was ok, done this one
             for  ( b = 0;  b < maxBrsts;  b++ )
@@ -621,6 +546,7 @@ int profile_transmit ( const char*              data_dir,
   //  TODO == Send End-of-Transmission ???
 
   free ( all_input );
+  free ( packet );
 
   return 0;
 }
@@ -13,6 +13,7 @@ typedef struct transmit_instructions {
   enum  { ZLIB, NO_COMPRESSION } compression;
   enum  { ASCII85, BASE64, NO_ENCODING } encoding;
   int   burst_size;	
+  int   save_stages;    //  Save G,B,C,E intermediate packets to data_dir
 
 } transmit_instructions_t;
 
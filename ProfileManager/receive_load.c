@@ -0,0 +1,726 @@
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <signal.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+# include <sys/mman.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <sys/wait.h>
+
+# include "zlib.h"
+
+# include "profile_packet.h"
+# include "profile_receive.h"
+# include "syslog.h"
+# include "harness_common.h"
+
+static char ProgramDescription[] = "HyperNav Profile Receiver Load Test [Satlantic]";
+static char ProgramRevision   [] = "Revision 0.1  2026-10-17";
+
+/******************************
+ *  Function: Print usage
+ */
+static void print_usage ( char* pn ) {
+
+  printf ( "%s\n%s\n", ProgramDescription, ProgramRevision );
+  printf ( "Usage: %s [-h -? -nN -kK -BB -eE -rR -zZ -xX -pP -dD -gx]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -nN     Number of concurrent floats [default: 16]\n" );
+  printf ( "       -kK     Data packets per profile, 1..%d [default: 12]\n", 99 );
+  printf ( "       -BB     Burst size [default: 512]\n" );
+  printf ( "       -eE     Probability of dropping a burst on first transmission [default: 0.02]\n" );
+  printf ( "       -rR     Probability of swapping a burst with the next one [default: 0.02]\n" );
+  printf ( "       -zZ     Fraction of data packets sent compressed and ASCII85 encoded [default: 0.5]\n" );
+  printf ( "       -xX     Cut the link of each float X times, at random offsets [default: 0]\n" );
+  printf ( "       -pP     Receiver port [default: 43210]\n" );
+  printf ( "       -dD     Directory for sent (D/tx) and received (D/rx) packets [default: mkdtemp]\n" );
+  printf ( "       -gx     Receiver log level (x=D|I|N|W|E) [default: W]\n" );
+  printf ( "Each cut link may cost at most one burst, plus one burst 0 to resume,\n" );
+  printf ( "beyond sending every burst once and the resends requested. Checked when\n" );
+  printf ( "the link is the only loss: -e0, and built with TXRXERRORRATE=0.\n" );
+}
+
+/******************************
+ *  Float side: packets and bursts as sent by the profile manager firmware.
+ */
+typedef struct load_packet {
+  unsigned char* bytes;     //  Packet content following HYNV_num/PROF_num/PCKT_num, as sent
+  uint16_t       size;
+  unsigned char* plain;     //  Uncompressed and unencoded, as the receiver saves it
+  uint16_t       plain_size;
+  uint16_t       num_bursts;
+  char           acked;
+  char           tried;     //  Burst 0 went out, during this or an earlier call
+  char           reported;  //  HELD or RXED received during this call
+  char           sent;      //  All bursts went out during this call
+  char*          held;      //  Bursts 0..num_bursts reported held by the receiver
+} load_packet_t;
+
+//  The float's end of the link.
+//  It is cut after kill_at bytes, anywhere within a burst,
+//  as when an Iridium call drops.
+//
+typedef struct load_link {
+  int     fd;
+  size_t  sent;             //  Bytes written, all calls
+  size_t  requested;        //  Of those, written in reply to RSND
+  size_t  burst_at;         //  Bytes written before the burst in progress
+  size_t  lost;             //  Bytes of bursts cut short, not counting resends
+  char    resending;
+  int     kills;
+  int     num_kills;
+  size_t* kill_at;          //  num_kills ascending offsets into the bytes written
+} load_link_t;
+
+//  Shared with the parent
+//
+typedef struct load_stats {
+  size_t ideal;             //  Every burst sent once, no link lost
+  size_t sent;
+  size_t requested;
+  size_t lost;
+  int    kills;
+} load_stats_t;
+
+static int write_all ( int fd, const void* data, size_t size ) {
+  const char* p = data;
+  while ( size ) {
+    ssize_t n = write ( fd, p, size );
+    if ( n < 0 ) {
+      if ( EINTR == errno ) continue;
+      return 1;
+    }
+    p += n; size -= n;
+  }
+  return 0;
+}
+
+//  Returns 1 if the link is (or was) cut
+//
+static int link_write ( load_link_t* link, const void* data, size_t size ) {
+
+  if ( link->fd < 0 ) return 1;
+
+  size_t n = size;
+  int    cut = 0;
+  if ( link->kills < link->num_kills && link->sent + size > link->kill_at[link->kills] ) {
+    n   = ( link->kill_at[link->kills] > link->sent ) ? link->kill_at[link->kills] - link->sent : 0;
+    cut = 1;
+  }
+
+  if ( n && write_all ( link->fd, data, n ) ) cut = 1;
+  link->sent += n;
+  if ( link->resending ) link->requested += n;
+
+  if ( cut ) {
+    if ( !link->resending ) link->lost += link->sent - link->burst_at;
+    //  Bytes written up to the cut still arrive:
+    //  close only after the receiver did, as closing with replies
+    //  unread would reset the connection and lose them.
+    char discard[1024];
+    struct pollfd pfd = { link->fd, POLLIN, 0 };
+    shutdown ( link->fd, SHUT_WR );
+    while ( poll ( &pfd, 1, 5000 ) > 0 && read ( link->fd, discard, sizeof(discard) ) > 0 ) {
+      ;
+    }
+    close ( link->fd );
+    link->fd = -1;
+    link->kills++;
+  }
+  return cut;
+}
+
+//  Burst 0: header only, value = number of bursts
+//  Burst b: header and data, value = size of data
+//  Burst -1: terminator, header only
+//
+static int send_burst ( load_link_t* link, uint16_t hynv, uint16_t prof, uint16_t pckt,
+                        load_packet_t* pk, int burst_size, int b ) {
+
+  char header[40];
+  const unsigned char* data = 0;
+  int sz = 0;
+
+  if ( -1 == b ) {
+    snprintf ( header, sizeof(header), "BRST%04hu%05hu%04huZZZZZZZ", hynv, prof, pckt );
+  } else if ( 0 == b ) {
+    snprintf ( header, sizeof(header), "BRST%04hu%05hu%04hu%03d%04hu", hynv, prof, pckt, 0, pk->num_bursts );
+    pk->tried = 1;
+  } else {
+    data = pk->bytes + (b-1)*burst_size;
+    sz   = ( b < pk->num_bursts ) ? burst_size : pk->size - (pk->num_bursts-1)*burst_size;
+    snprintf ( header, sizeof(header), "BRST%04hu%05hu%04hu%03d%04d", hynv, prof, pckt, b%1000, sz%10000 );
+  }
+
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, (Bytef*)header, 24 );
+  if ( sz ) crc = crc32 ( crc, data, sz );
+  snprintf ( header+24, 9, "%08lX", crc );
+
+  link->burst_at = link->sent;
+  if ( link_write ( link, header, 32 ) ) return 1;
+  if ( sz && link_write ( link, data, sz ) ) return 1;
+  return 0;
+}
+
+//  All bursts of a packet, leaving out those the receiver reported held.
+//  Only the first transmission of a packet is subject to drop and swap.
+//
+static int send_packet ( load_link_t* link, uint16_t hynv, uint16_t prof, uint16_t pckt,
+                         load_packet_t* pk, int burst_size, double drop, double swap, unsigned int* seed ) {
+  if ( pk->tried ) {
+    drop = 0;
+    swap = 0;
+  }
+  int b;
+  for ( b=0; b<=pk->num_bursts; b++ ) {
+    if ( pk->held[b] ) {
+      continue;   //  received during an earlier call
+    }
+    if ( b > 0 && drop > 0 && rand_r(seed) < drop*RAND_MAX ) {
+      continue;   //  lost on the way
+    }
+    if ( b > 0 && b < pk->num_bursts && !pk->held[b+1] && swap > 0 && rand_r(seed) < swap*RAND_MAX ) {
+      //  overtaken by the next burst
+      if ( send_burst ( link, hynv, prof, pckt, pk, burst_size, b+1 ) ) return 1;
+      if ( send_burst ( link, hynv, prof, pckt, pk, burst_size, b   ) ) return 1;
+      b++;
+      continue;
+    }
+    if ( send_burst ( link, hynv, prof, pckt, pk, burst_size, b ) ) return 1;
+  }
+  return send_burst ( link, hynv, prof, pckt, pk, burst_size, -1 );
+}
+
+//  Compress (as the firmware does, with a small window) and ASCII85 encode
+//  the data of a plain packet.
+//
+static int encode_packet ( load_packet_t* pk ) {
+
+  uLong const    data_sz = pk->plain_size - 32;
+  unsigned char* cmp     = malloc ( data_sz + data_sz/8 + 64 );
+  if ( !cmp ) return 1;
+
+  z_stream strm;
+  memset ( &strm, 0, sizeof(strm) );
+  if ( Z_OK != deflateInit2 ( &strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 9, 2, Z_FILTERED ) ) {
+    free ( cmp );
+    return 1;
+  }
+  strm.next_in   = pk->plain + 32;
+  strm.avail_in  = data_sz;
+  strm.next_out  = cmp;
+  strm.avail_out = data_sz + data_sz/8 + 64;
+  int const rv = deflate ( &strm, Z_FINISH );
+  uLong const cmp_sz = strm.total_out;
+  deflateEnd ( &strm );
+
+  pk->bytes = malloc ( 32 + 5*(cmp_sz+3)/4 );
+  if ( Z_STREAM_END != rv || !pk->bytes ) {
+    free ( cmp );
+    return 1;
+  }
+
+  unsigned char* enc = pk->bytes + 32;
+  size_t   enc_sz = 0;
+  uLong    i;
+  for ( i=0; i<cmp_sz; i+=4 ) {
+    int const      n = ( cmp_sz-i < 4 ) ? cmp_sz-i : 4;
+    uint32_t number = 0;
+    int k;
+    for ( k=0; k<4; k++ ) {
+      number = ( number<<8 ) | ( k<n ? cmp[i+k] : 0 );
+    }
+    if ( 4 == n && 0 == number ) {
+      enc[enc_sz++] = 'z';
+    } else if ( 4 == n && 0x20202020 == number ) {
+      enc[enc_sz++] = 'y';
+    } else {
+      unsigned char digits[5];
+      for ( k=4; k>=0; k-- ) {
+        digits[k] = (unsigned char) ( number%85 + 33 );
+        number /= 85;
+      }
+      memcpy ( enc+enc_sz, digits, n+1 );
+      enc_sz += n+1;
+    }
+  }
+  free ( cmp );
+
+  char numString[8];
+  memcpy ( pk->bytes, pk->plain, 32 );
+  pk->bytes[18] = 'G';
+  pk->bytes[19] = 'A';
+  snprintf ( numString, sizeof(numString), "%6lu", cmp_sz );  memcpy ( pk->bytes+20, numString, 6 );
+  snprintf ( numString, sizeof(numString), "%6zu", enc_sz );  memcpy ( pk->bytes+26, numString, 6 );
+  pk->size = 32 + enc_sz;
+
+  return 0;
+}
+
+static int packet_file ( const char* dir, uint16_t hynv, uint16_t prof, uint16_t pckt, char* fn, size_t fn_size ) {
+  return snprintf ( fn, fn_size, "%s/%04hu/%05hu/%05hu.P%02hu", dir, hynv, prof, prof, pckt ) >= (int)fn_size;
+}
+
+static int save_expected ( const char* dir, uint16_t hynv, uint16_t prof, uint16_t pckt, load_packet_t* pk ) {
+
+  char fn[512];
+  snprintf ( fn, sizeof(fn), "%s/%04hu", dir, hynv );              mkdir ( fn, 0755 );
+  snprintf ( fn, sizeof(fn), "%s/%04hu/%05hu", dir, hynv, prof );  mkdir ( fn, 0755 );
+  packet_file ( dir, hynv, prof, pckt, fn, sizeof(fn) );
+
+  FILE* fp = fopen ( fn, "w" );
+  if ( !fp ) return 1;
+  int rv = ( 1 == fwrite ( pk->plain, pk->plain_size, 1, fp ) ) ? 0 : 1;
+  fclose ( fp );
+  return rv;
+}
+
+//  Replies of the receiver, one per line:
+//    RXED: packet received
+//    RSND: resend a burst, or all of a packet (999)
+//    HELD: bursts received of a packet, in reply to its burst 0
+//  Returns 1 if the link was cut while resending.
+//
+static int float_replies ( load_link_t* link, char* line, size_t* have, uint16_t hynv, uint16_t prof,
+                           load_packet_t* pk, int num_packets, int burst_size, int* acked, unsigned int* seed, double swap ) {
+
+  char resend[100];
+  memset ( resend, 0, sizeof(resend) );
+  int cut = 0;
+
+  char* start = line;
+  char* eol;
+  while ( !cut && ( eol = strstr ( start, "\r\n" ) ) ) {
+    *eol = 0;
+
+    uint16_t h, f, k, b;
+    unsigned int crc;
+    char type[5], map[256];
+    int n = 0;
+    if ( 0 == strncmp ( start, "HELD", 4 )
+      && 7 == sscanf ( start, "%4[A-Z],%hu,%hu,%hu,%hu,%255[0-9A-F],%n%8X", type, &h, &f, &k, &b, map, &n, &crc )
+      && h == hynv && f == prof && k <= num_packets ) {
+
+      uLong calc = crc32 ( 0L, Z_NULL, 0 );
+            calc = crc32 ( calc, (Bytef*)start, n );
+      if ( calc == crc ) {
+        int i, j;
+        for ( i=0; map[i]; i++ ) {
+          int const digit = ( map[i] <= '9' ) ? map[i]-'0' : map[i]-'A'+10;
+          for ( j=0; j<4; j++ ) {
+            if ( ( digit & (1<<j) ) && 4*i+j <= pk[k].num_bursts ) pk[k].held[4*i+j] = 1;
+          }
+        }
+        pk[k].reported = 1;
+      }
+
+    } else if ( 6 == sscanf ( start, "%4[A-Z],%hu,%hu,%hu,%hu,%8X", type, &h, &f, &k, &b, &crc )
+      && h == hynv && f == prof && k <= num_packets ) {
+
+      uLong calc = crc32 ( 0L, Z_NULL, 0 );
+            calc = crc32 ( calc, (Bytef*)start, 25 );
+      if ( calc == crc ) {
+        if ( 0 == strcmp ( type, "RXED" ) ) {
+          if ( !pk[k].acked ) { pk[k].acked = 1; (*acked)++; }
+          pk[k].reported = 1;
+        } else if ( 0 == strcmp ( type, "RSND" ) ) {
+          link->resending = 1;
+          if ( 999 == b ) {
+            memset ( pk[k].held, 0, pk[k].num_bursts+1 );
+            cut = send_packet ( link, hynv, prof, k, pk+k, burst_size, 0, swap, seed );
+          } else if ( b <= pk[k].num_bursts ) {
+            pk[k].held[b] = 0;
+            cut = send_burst ( link, hynv, prof, k, pk+k, burst_size, b );
+            resend[k] = 1;
+          }
+          link->resending = 0;
+        }
+      }
+    }
+    start = eol+2;
+  }
+
+  //  One terminating burst per packet with resent bursts
+  //
+  int p;
+  link->resending = 1;
+  for ( p=0; p<=num_packets && !cut; p++ ) {
+    if ( resend[p] ) {
+      cut = send_burst ( link, hynv, prof, p, pk+p, burst_size, -1 );
+    }
+  }
+  link->resending = 0;
+
+  *have = strlen ( start );
+  memmove ( line, start, *have );
+  return cut;
+}
+
+//  One float: build a profile, send it, service RSND requests
+//  until every packet is acknowledged.
+//  The link is cut at the kill offsets; each new call first sends
+//  burst 0 of the next packet tried before, waits for the receiver's
+//  report, and then sends only the bursts the receiver does not hold.
+//
+static int float_client ( int id, uint16_t port, const char* tx_dir, int num_packets, int burst_size,
+                          double drop, double swap, double zip, int num_kills, load_stats_t* stats ) {
+
+  uint16_t const hynv = 100 + id;
+  uint16_t const prof = 16291;
+  unsigned int   seed = 1234 + id;
+
+  load_packet_t pk[100];
+  memset ( pk, 0, sizeof(pk) );
+
+  //  Packet 0: the info packet
+  //
+  pk[0].plain_size = 4*4 + 4*4 + BEGPAK_META;
+  pk[0].plain      = malloc ( pk[0].plain_size );
+  if ( !pk[0].plain ) return 2;
+  snprintf ( (char*)pk[0].plain, 33, "%04d%04d%04d%04d%04d%04d%04d%04d",
+             num_packets*MXHNV, 0, 0, 0, num_packets, 0, 0, 0 );
+  memset ( pk[0].plain+32, '_', BEGPAK_META );
+
+  //  Packets 1..K: bitplaned spectra,
+  //  some sent uncompressed, the others compressed and encoded
+  //
+  int p;
+  for ( p=1; p<=num_packets; p++ ) {
+    int const nd = 1 + rand_r(&seed) % MXHNV;
+    pk[p].plain_size = 32 + nd*( (N_SPEC_PIX/8)*16 + SPEC_AUX_SERIAL_SIZE );
+    pk[p].plain      = malloc ( pk[p].plain_size );
+    if ( !pk[p].plain ) return 2;
+    char header[33];
+    snprintf ( header, sizeof(header), "S SATYLU%04hu%04dG00N            ", hynv, nd );
+    memcpy ( pk[p].plain, header, 32 );
+    int i;
+    for ( i=32; i<pk[p].plain_size; i++ ) {
+      pk[p].plain[i] = (unsigned char) ( rand_r(&seed) % 23 );
+    }
+  }
+
+  stats->ideal = 0;
+  for ( p=0; p<=num_packets; p++ ) {
+    if ( p > 0 && rand_r(&seed) < zip*RAND_MAX ) {
+      if ( encode_packet ( pk+p ) ) return 2;
+    } else {
+      pk[p].bytes = pk[p].plain;
+      pk[p].size  = pk[p].plain_size;
+    }
+    pk[p].num_bursts = 1 + ( pk[p].size - 1 ) / burst_size;
+    pk[p].held       = calloc ( pk[p].num_bursts+2, 1 );
+    if ( !pk[p].held ) return 2;
+    if ( save_expected ( tx_dir, hynv, prof, p, pk+p ) ) return 2;
+    stats->ideal += 32*( pk[p].num_bursts+2 ) + pk[p].size;
+  }
+
+  //  Where the link is cut
+  //
+  load_link_t link;
+  memset ( &link, 0, sizeof(link) );
+  link.fd        = -1;
+  link.num_kills = num_kills;
+  link.kill_at   = calloc ( num_kills+1, sizeof(size_t) );
+  if ( !link.kill_at ) return 2;
+  int i, j;
+  for ( i=0; i<num_kills; i++ ) {
+    size_t const at = (size_t) ( (double)rand_r(&seed) / RAND_MAX * stats->ideal );
+    for ( j=i; j>0 && link.kill_at[j-1] > at; j-- ) {
+      link.kill_at[j] = link.kill_at[j-1];
+    }
+    link.kill_at[j] = at;
+  }
+
+  char   line[4096];
+  size_t have = 0;
+  int    acked = 0;
+  time_t const deadline = time(0) + 60;
+
+  while ( acked <= num_packets && time(0) < deadline ) {
+
+    if ( link.fd < 0 ) {
+      if ( 0 > ( link.fd = connect_port ( port, 0 ) ) ) {
+        fprintf ( stderr, "float %d: cannot connect\n", id );
+        break;
+      }
+      have = 0;
+      for ( p=0; p<=num_packets; p++ ) {
+        pk[p].reported = 0;
+        pk[p].sent     = 0;
+      }
+    }
+
+    //  Send every packet not yet acknowledged once during this call.
+    //  Ask about a packet tried during an earlier call, unless the
+    //  receiver already reported it.
+    //
+    int cut = 0;
+    for ( p=0; p<=num_packets && !cut; p++ ) {
+
+      if ( pk[p].acked || pk[p].sent ) continue;
+
+      if ( pk[p].tried && !pk[p].reported ) {
+
+        if ( ( cut = send_burst ( &link, hynv, prof, p, pk+p, burst_size, 0 ) ) ) break;
+
+        time_t const wait_until = time(0) + 10;
+        while ( !cut && !pk[p].reported && time(0) < wait_until ) {
+          struct pollfd pfd = { link.fd, POLLIN, 0 };
+          if ( poll ( &pfd, 1, 1000 ) <= 0 ) continue;
+          ssize_t n = read ( link.fd, line+have, sizeof(line)-1-have );
+          if ( n <= 0 ) { cut = 1; break; }
+          have += n;
+          line[have] = 0;
+          cut = float_replies ( &link, line, &have, hynv, prof, pk, num_packets, burst_size, &acked, &seed, swap );
+        }
+        if ( cut || pk[p].acked ) continue;
+      }
+
+      if ( ( cut = send_packet ( &link, hynv, prof, p, pk+p, burst_size, drop, swap, &seed ) ) ) break;
+      pk[p].sent = 1;
+    }
+
+    //  Service RSND requests until all acknowledged, or the link is cut
+    //
+    while ( !cut && link.fd >= 0 && acked <= num_packets && time(0) < deadline ) {
+
+      struct pollfd pfd = { link.fd, POLLIN, 0 };
+      if ( poll ( &pfd, 1, 1000 ) <= 0 ) continue;
+
+      ssize_t n = read ( link.fd, line+have, sizeof(line)-1-have );
+      if ( n <= 0 ) {
+        close ( link.fd );
+        link.fd = -1;
+        break;
+      }
+      have += n;
+      line[have] = 0;
+
+      cut = float_replies ( &link, line, &have, hynv, prof, pk, num_packets, burst_size, &acked, &seed, swap );
+    }
+
+    if ( cut && link.fd >= 0 ) {
+      close ( link.fd );
+      link.fd = -1;
+    }
+  }
+
+  if ( link.fd >= 0 ) close ( link.fd );
+
+  stats->sent      = link.sent;
+  stats->requested = link.requested;
+  stats->lost      = link.lost;
+  stats->kills     = link.kills;
+
+  for ( p=0; p<=num_packets; p++ ) {
+    if ( pk[p].bytes != pk[p].plain ) free ( pk[p].bytes );
+    free ( pk[p].plain );
+    free ( pk[p].held );
+  }
+  free ( link.kill_at );
+
+  if ( acked <= num_packets ) {
+    fprintf ( stderr, "float %d: %d of %d packets acknowledged\n", id, acked, num_packets+1 );
+    return 1;
+  }
+  return 0;
+}
+
+//  Compare the sent and received packet files byte by byte.
+//
+static int compare_files ( const char* fn_tx, const char* fn_rx ) {
+
+  FILE* ft = fopen ( fn_tx, "r" );
+  FILE* fr = fopen ( fn_rx, "r" );
+  int rv = 0;
+
+  if ( !ft || !fr ) {
+    rv = 1;
+  } else {
+    int a, b;
+    do {
+      a = getc ( ft );
+      b = getc ( fr );
+    } while ( a == b && a != EOF );
+    rv = ( a != b );
+  }
+
+  if ( ft ) fclose ( ft );
+  if ( fr ) fclose ( fr );
+  return rv;
+}
+
+int main( int argc, char* argv[] ) {
+
+  int      num_floats  = 16;
+  int      num_packets = 12;
+  int      burst_size  = 512;
+  double   drop        = 0.02;
+  double   swap        = 0.02;
+  double   zip         = 0.5;
+  int      num_kills   = 0;
+  uint16_t port        = 43210;
+  char*    dir         = 0;
+
+  int opt;
+
+  for ( opterr=0; ( opt = getopt ( argc, argv, "?hn:k:B:e:r:z:x:p:d:g:" ) ) != EOF ; ) {
+    switch ( opt ) {
+    case '?':
+    case 'h': print_usage(argv[0]); return 0;
+    case 'n': num_floats  = atoi ( optarg ); break;
+    case 'k': num_packets = atoi ( optarg ); break;
+    case 'B': burst_size  = atoi ( optarg ); break;
+    case 'e': drop        = atof ( optarg ); break;
+    case 'r': swap        = atof ( optarg ); break;
+    case 'z': zip         = atof ( optarg ); break;
+    case 'x': num_kills   = atoi ( optarg ); break;
+    case 'p': port        = atoi ( optarg ); break;
+    case 'd': dir         = optarg; break;
+    case 'g': switch ( optarg[0] ) {
+              case 'd': case 'D': syslog_setVerbosity( SYSLOG_DEBUG   ); break;
+              case 'i': case 'I': syslog_setVerbosity( SYSLOG_INFO    ); break;
+              case 'n': case 'N': syslog_setVerbosity( SYSLOG_NOTICE  ); break;
+              case 'w': case 'W': syslog_setVerbosity( SYSLOG_WARNING ); break;
+              case 'e': case 'E': syslog_setVerbosity( SYSLOG_ERROR   ); break;
+              }
+              break;
+    default : fprintf ( stderr, "%s: Ignoring unknown '-%c' option\n", argv[0], opt ); break;
+    }
+  }
+
+  if ( num_floats  < 1 ) num_floats = 1;
+  if ( num_packets < 1 ) num_packets = 1;
+  if ( num_packets > 99 ) num_packets = 99;
+  if ( burst_size  < 128 ) burst_size = 128;
+  if ( burst_size  > 9999 ) burst_size = 9999;
+  if ( num_kills   < 0 ) num_kills = 0;
+
+  char tmpdir[] = "/tmp/receive_load_XXXXXX";
+  if ( !dir ) {
+    if ( !( dir = mkdtemp ( tmpdir ) ) ) {
+      perror ( "mkdtemp" );
+      return 2;
+    }
+  }
+
+  char tx_dir[256], rx_dir[256];
+  snprintf ( tx_dir, sizeof(tx_dir), "%s/tx", dir ); mkdir ( tx_dir, 0755 );
+  snprintf ( rx_dir, sizeof(rx_dir), "%s/rx", dir ); mkdir ( rx_dir, 0755 );
+
+  fflush ( stdout );
+
+  pid_t receiver = fork();
+  if ( 0 == receiver ) {
+    _exit ( profile_receive ( rx_dir, port ) );
+  }
+
+  //  Wait for the receiver to listen
+  //
+  int tries;
+  for ( tries=0; tries<50; tries++ ) {
+    int fd = connect_port ( port, 0 );
+    if ( fd >= 0 ) { close ( fd ); break; }
+    usleep ( 100000 );
+  }
+  if ( 50 == tries ) {
+    fprintf ( stderr, "Receiver does not listen on port %hu\n", port );
+    kill ( receiver, SIGTERM );
+    waitpid ( receiver, 0, 0 );
+    return 2;
+  }
+
+  load_stats_t* stats = mmap ( 0, num_floats*sizeof(load_stats_t), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0 );
+  if ( MAP_FAILED == stats ) {
+    perror ( "mmap" );
+    kill ( receiver, SIGTERM );
+    waitpid ( receiver, 0, 0 );
+    return 2;
+  }
+  memset ( stats, 0, num_floats*sizeof(load_stats_t) );
+
+  double const t0 = now_s();
+
+  int i;
+  for ( i=0; i<num_floats; i++ ) {
+    if ( 0 == fork() ) {
+      _exit ( float_client ( i, port, tx_dir, num_packets, burst_size, drop, swap, zip, num_kills, stats+i ) );
+    }
+  }
+
+  int client_failures = 0;
+  for ( i=0; i<num_floats; i++ ) {
+    int status;
+    if ( wait ( &status ) < 0 ) break;
+    if ( !WIFEXITED(status) || WEXITSTATUS(status) ) client_failures++;
+  }
+
+  double const t1 = now_s();
+
+  kill ( receiver, SIGTERM );
+  waitpid ( receiver, 0, 0 );
+
+  //  Every packet of every float must have arrived,
+  //  decoded to exactly what was put into it
+  //
+  int mismatches = 0;
+  for ( i=0; i<num_floats; i++ ) {
+    int p;
+    for ( p=0; p<=num_packets; p++ ) {
+      char fn_tx[512], fn_rx[512];
+      packet_file ( tx_dir, 100+i, 16291, p, fn_tx, sizeof(fn_tx) );
+      packet_file ( rx_dir, 100+i, 16291, p, fn_rx, sizeof(fn_rx) );
+      if ( compare_files ( fn_tx, fn_rx ) ) {
+        fprintf ( stderr, "Mismatch %s\n", fn_rx );
+        mismatches++;
+      }
+    }
+  }
+
+  //  Bytes sent beyond the ideal, not counting resends requested,
+  //  may not exceed the burst cut short and one burst 0 per cut link:
+  //  Every burst written whole before a cut is held by the receiver.
+  //
+  size_t ideal = 0, sent = 0, requested = 0;
+  long   excess_max = 0;
+  int    kills = 0, over_budget = 0;
+  for ( i=0; i<num_floats; i++ ) {
+    long const excess = (long)stats[i].sent - (long)stats[i].requested - (long)stats[i].ideal;
+    if ( excess > excess_max ) excess_max = excess;
+    if ( stats[i].lost > (size_t)stats[i].kills * ( 32 + burst_size )
+      || excess > (long)stats[i].lost + 32L*stats[i].kills ) {
+      over_budget++;
+    }
+    ideal     += stats[i].ideal;
+    sent      += stats[i].sent;
+    requested += stats[i].requested;
+    kills     += stats[i].kills;
+  }
+  munmap ( stats, num_floats*sizeof(load_stats_t) );
+
+  //  A burst dropped, or corrupted, costs its terminating burst again
+  //  if the RSND for it is lost with the link
+  //
+  if ( drop > 0 ) over_budget = 0;
+# ifdef TXRXERRORRATE
+  if ( TXRXERRORRATE > 0 ) over_budget = 0;
+# endif
+  if ( over_budget ) {
+    fprintf ( stderr, "%d floats sent more than the burst cut short and one burst 0 beyond ideal per cut link\n", over_budget );
+  }
+
+  printf ( "floats,packets,burst_size,drop,swap,zip,seconds,client_failures,mismatches,kills,ideal_bytes,sent_bytes,requested_bytes,max_excess_bytes,over_budget\n" );
+  printf ( "%d,%d,%d,%.3f,%.3f,%.2f,%.3f,%d,%d,%d,%zu,%zu,%zu,%ld,%d\n", num_floats, num_floats*(num_packets+1), burst_size, drop, swap, zip,
+           t1-t0, client_failures, mismatches,
+           kills, ideal, sent, requested, excess_max, over_budget );
+
+  return ( client_failures || mismatches || over_budget ) ? 1 : 0;
+}
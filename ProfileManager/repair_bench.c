@@ -0,0 +1,518 @@
+# include <errno.h>
+# include <math.h>
+# include <poll.h>
+# include <signal.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+# include <arpa/inet.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <sys/wait.h>
+
+# include "zlib.h"
+
+# include "profile_packet.h"
+# include "profile_receive.h"
+# include "syslog.h"
+# include "burst_transfer.h"
+# include "harness_common.h"
+
+static char ProgramDescription[] = "HyperNav Repair Burst Benchmark [Satlantic]";
+static char ProgramRevision   [] = "Revision 0.1  2026-10-17";
+
+/******************************
+ *  Function: Print usage
+ */
+static void print_usage ( char* pn ) {
+
+  printf ( "%s\n%s\n", ProgramDescription, ProgramRevision );
+  printf ( "Usage: %s [-h -? -nN -BB -kK -mM -FL -LL -wW -pP -dD -gx]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -nN     Data bursts per packet, 1..%d [default: 8]\n", BST_Bursts-2 );
+  printf ( "       -BB     Burst size [default: 1024]\n" );
+  printf ( "       -kK     Data packets per profile, 1..99 [default: 50]\n" );
+  printf ( "       -mM     Profiles per cell [default: 8]\n" );
+  printf ( "       -FL     Repair bursts per packet [default: 0,1,2,4]\n" );
+  printf ( "       -LL     Burst loss probabilities [default: 0.01,0.02,0.05,0.1]\n" );
+  printf ( "       -wW     Window offered with the repair bursts [default: 0]\n" );
+  printf ( "       -pP     Receiver port [default: 43410]\n" );
+  printf ( "       -dD     Directory for received packets [default: mkdtemp]\n" );
+  printf ( "       -gx     Receiver log level (x=D|I|N|W|E) [default: W]\n" );
+  printf ( "A float sends each data packet once, each data and repair burst lost\n" );
+  printf ( "with the given probability, then resends what the receiver asks for.\n" );
+  printf ( "The same data bursts are lost whatever the number of repair bursts.\n" );
+  printf ( "Per cell: repair bytes over packet bytes, the share of lost bursts\n" );
+  printf ( "rebuilt by the receiver, and of packets received without any resend,\n" );
+  printf ( "measured and as expected for independent losses.\n" );
+  printf ( "Exits 1 if a packet is not received byte-identical.\n" );
+}
+
+/******************************
+ *  Float side: bursts as sent by the profile manager firmware,
+ *  repair bursts as by data_packet_repair_transmit()
+ */
+# define RB_MAX_BURSTS (BST_Bursts-2)
+
+typedef struct rb_packet {
+  unsigned char* bytes;     //  Packet content following HYNV_num/PROF_num/PCKT_num, as sent
+  uint16_t       size;
+  uint16_t       num_bursts;
+  char           acked;
+  char           lost  [ RB_MAX_BURSTS+2 ];   //  on first transmission
+  char           asked [ RB_MAX_BURSTS+2 ];   //  RSND received
+} rb_packet_t;
+
+typedef struct rb_float {
+  int            fd;
+  uint16_t       hynv;
+  uint16_t       prof;
+  uint16_t       repair;    //  granted
+  char           line[4096];
+  size_t         have;
+  size_t         sent;
+  size_t         repair_sent;
+} rb_float_t;
+
+//  Per cell
+//
+typedef struct rb_stats {
+  size_t packet_bytes;
+  size_t repair_bytes;
+  size_t sent_bytes;
+  long   packets;
+  long   bursts;
+  long   lost;
+  long   asked;             //  of the bursts lost
+  long   clean;             //  packets received without a resend
+  int    failures;
+} rb_stats_t;
+
+static int rb_send ( rb_float_t* f, const void* data, size_t size ) {
+  const char* p = data;
+  while ( size ) {
+    ssize_t n = write ( f->fd, p, size );
+    if ( n < 0 ) {
+      if ( EINTR == errno ) continue;
+      return 1;
+    }
+    p += n; size -= n; f->sent += n;
+  }
+  return 0;
+}
+
+static int rb_frame ( rb_float_t* f, char* header, const unsigned char* data, int sz ) {
+
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, (Bytef*)header, 24 );
+  if ( sz ) crc = crc32 ( crc, data, sz );
+  snprintf ( header+24, 9, "%08lX", crc );
+
+  if ( rb_send ( f, header, 32 ) ) return 1;
+  return sz ? rb_send ( f, data, sz ) : 0;
+}
+
+//  Burst 0: header only, value = number of bursts
+//  Burst b: header and data, value = size of data
+//  Burst nB+1: terminator, header only
+//
+static int rb_burst ( rb_float_t* f, rb_packet_t* pk, int p, int b ) {
+
+  char header[40];
+  const unsigned char* data = 0;
+  int sz = 0;
+
+  if ( b > pk->num_bursts ) {
+    snprintf ( header, 25, "BRST%04hu%05hu%04dZZZZZZZ", f->hynv, f->prof, p );
+  } else if ( 0 == b ) {
+    snprintf ( header, 25, "BRST%04hu%05hu%04d%03d%04hu", f->hynv, f->prof, p, 0, pk->num_bursts );
+  } else {
+    int const bsize = 1 + ( pk->size - 1 ) / pk->num_bursts;
+    data = pk->bytes + (b-1)*bsize;
+    sz   = ( b < pk->num_bursts ) ? bsize : pk->size - (pk->num_bursts-1)*bsize;
+    snprintf ( header, 25, "BRST%04hu%05hu%04d%03d%04d", f->hynv, f->prof, p, b, sz );
+  }
+  return rb_frame ( f, header, data, sz );
+}
+
+//  Repair burst j: "nnnnssss", then the XOR of its data bursts
+//
+static int rb_repair ( rb_float_t* f, rb_packet_t* pk, int p, int j ) {
+
+  unsigned char repair[8 + 10000];
+  int const nB = pk->num_bursts;
+  int const sz = 8 + data_packet_repair ( pk->bytes, pk->size, nB, f->repair, j, repair+8 );
+
+  char sizes[9];
+  snprintf ( sizes, 9, "%04d%04d", nB, pk->size - (nB-1)*( 1 + ( pk->size - 1 ) / nB ) );
+  memcpy ( repair, sizes, 8 );
+
+  char header[40];
+  snprintf ( header, 25, "BRST%04hu%05hu%04d%03d%04d", f->hynv, f->prof, p, 900 + 10*f->repair + j, sz );
+
+  size_t const before = f->sent;
+  int const rv = rb_frame ( f, header, repair, sz );
+  f->repair_sent += f->sent - before;
+  return rv;
+}
+
+//  Replies of the receiver, one per line. Resends requested bursts,
+//  followed by the terminating burst of their packet.
+//  Returns -1 if the link is gone.
+//
+static int rb_replies ( rb_float_t* f, rb_packet_t* pk, int num_packets, int ms ) {
+
+  struct pollfd pfd = { f->fd, POLLIN, 0 };
+  if ( poll ( &pfd, 1, ms ) <= 0 ) return 0;
+
+  ssize_t n = read ( f->fd, f->line + f->have, sizeof(f->line)-1-f->have );
+  if ( n <= 0 ) return -1;
+
+  //  Acknowledge at once, else the receiver's next reply
+  //  waits out the delayed acknowledgement of this one
+  int one = 1;
+  setsockopt ( f->fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one) );
+
+  f->have += n;
+  f->line[f->have] = 0;
+
+  char resent[100];
+  memset ( resent, 0, sizeof(resent) );
+
+  char* start = f->line;
+  char* eol;
+  while ( ( eol = strstr ( start, "\r\n" ) ) ) {
+    *eol = 0;
+
+    char type[5];
+    uint16_t h, prof, p, value;
+    unsigned int crc;
+    if ( 6 == sscanf ( start, "%4[A-Z],%hu,%hu,%hu,%hu,%8X", type, &h, &prof, &p, &value, &crc )
+      && h == f->hynv && prof == f->prof && p <= num_packets ) {
+
+      uLong calc = crc32 ( 0L, Z_NULL, 0 );
+            calc = crc32 ( calc, (Bytef*)start, 25 );
+      if ( calc == crc ) {
+        if ( 0 == strcmp ( type, "RXED" ) ) {
+          pk[p].acked = 1;
+        } else if ( 0 == strcmp ( type, "RSND" ) ) {
+          int b;
+          for ( b=1; b<=pk[p].num_bursts; b++ ) {
+            if ( 999 != value && b != value ) continue;
+            pk[p].asked[b] = 1;
+            if ( rb_burst ( f, pk+p, p, b ) ) return -1;
+            resent[p] = 1;
+          }
+        }
+      }
+    }
+    start = eol+2;
+  }
+
+  f->have -= ( start - f->line );
+  memmove ( f->line, start, f->have );
+
+  int p;
+  for ( p=0; p<=num_packets; p++ ) {
+    if ( resent[p] && rb_burst ( f, pk+p, p, pk[p].num_bursts+1 ) ) return -1;
+  }
+  return 0;
+}
+
+//  Offer the window and the repair bursts, as pmg_window_offer()
+//
+static int rb_offer ( rb_float_t* f, int repair, int window ) {
+
+  f->repair = 0;
+  if ( !repair && !window ) return 0;
+
+  char offer[40];
+  snprintf ( offer, 25, "WNDW%04hu%05hu0000%03d%04d", f->hynv, f->prof, repair, window );
+  if ( rb_frame ( f, offer, 0, 0 ) ) return 1;
+
+  double const until = now_s() + 5;
+  while ( now_s() < until ) {
+    struct pollfd pfd = { f->fd, POLLIN, 0 };
+    if ( poll ( &pfd, 1, 100 ) <= 0 ) continue;
+    ssize_t n = read ( f->fd, f->line + f->have, sizeof(f->line)-1-f->have );
+    if ( n <= 0 ) return 1;
+    f->have += n;
+    f->line[f->have] = 0;
+
+    char* eol;
+    while ( ( eol = strstr ( f->line, "\r\n" ) ) ) {
+      *eol = 0;
+      uint16_t h, prof, rep, win;
+      int const granted = 4 == sscanf ( f->line, "WNDW,%hu,%hu,%hu,%hu,", &h, &prof, &rep, &win );
+      f->have -= ( eol+2 - f->line );
+      memmove ( f->line, eol+2, f->have+1 );
+      if ( granted ) {
+        f->repair = ( rep < repair ) ? rep : repair;
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+//  The profile of a float: the info packet 0, then K packets of
+//  num_bursts bursts of up to burst_size bytes, sent uncompressed
+//  (the receiver saves them as they are)
+//
+static int make_profile ( rb_packet_t* pk, int num_packets, uint16_t hynv, int num_bursts, int burst_size, unsigned int seed ) {
+
+  int p;
+
+  memset ( pk, 0, (num_packets+1)*sizeof(rb_packet_t) );
+
+  pk[0].size       = 4*4 + 4*4 + BEGPAK_META;
+  pk[0].num_bursts = 1;
+  pk[0].bytes      = malloc ( pk[0].size+1 );
+  if ( !pk[0].bytes ) return 1;
+  snprintf ( (char*)pk[0].bytes, 33, "%04d%04d%04d%04d%04d%04d%04d%04d",
+             num_packets, 0, 0, 0, num_packets, 0, 0, 0 );
+  memset ( pk[0].bytes+32, '_', BEGPAK_META );
+
+  for ( p=1; p<=num_packets; p++ ) {
+    pk[p].num_bursts = num_bursts;
+    pk[p].size       = num_bursts*burst_size - rand_r(&seed) % ( burst_size/2 );
+    pk[p].bytes      = malloc ( pk[p].size+1 );
+    if ( !pk[p].bytes ) return 1;
+    char header[33];
+    snprintf ( header, sizeof(header), "S SATYLU%04hu%04dG00N            ", hynv, 1 );
+    memcpy ( pk[p].bytes, header, 32 );
+    int i;
+    for ( i=32; i<pk[p].size; i++ ) {
+      pk[p].bytes[i] = (unsigned char) rand_r(&seed);
+    }
+  }
+  return 0;
+}
+
+//  One profile over one call: every packet sent once, losing bursts,
+//  then resent from what the receiver asks for until it is received.
+//  Data bursts are lost by the draw of data_seed, repair bursts by that
+//  of repair_seed, so that the same data bursts go missing for any
+//  number of repair bursts.
+//
+static int float_profile ( uint16_t port, const char* rx_dir, uint16_t hynv, uint16_t prof,
+                           int num_packets, int num_bursts, int burst_size, int repair, int window,
+                           double loss, unsigned int data_seed, unsigned int repair_seed, rb_stats_t* st ) {
+
+  rb_packet_t pk[100];
+  if ( make_profile ( pk, num_packets, hynv, num_bursts, burst_size, prof ) ) return 2;
+
+  rb_float_t f;
+  memset ( &f, 0, sizeof(f) );
+  f.hynv = hynv;
+  f.prof = prof;
+
+  int rv = 0, p, b, j;
+
+  if ( 0 > ( f.fd = connect_port ( port, 1 ) ) || rb_offer ( &f, repair, window ) || f.repair != repair ) {
+    fprintf ( stderr, "%04hu %05hu: no connection, or %d repair bursts not granted\n", hynv, prof, repair );
+    rv = 1;
+  }
+
+  for ( p=0; p<=num_packets && !rv; p++ ) {
+
+    rb_packet_t* const k = pk+p;
+
+    if ( rb_burst ( &f, k, p, 0 ) ) rv = 1;
+
+    for ( b=1; b<=k->num_bursts && !rv; b++ ) {
+      if ( p && rand_r(&data_seed) < loss*RAND_MAX ) {
+        k->lost[b] = 1;
+        continue;
+      }
+      rv = rb_burst ( &f, k, p, b );
+    }
+    for ( j=1; p && j<=f.repair && j<=k->num_bursts && !rv; j++ ) {
+      if ( rand_r(&repair_seed) < loss*RAND_MAX ) continue;
+      rv = rb_repair ( &f, k, p, j );
+    }
+    if ( !rv ) rv = rb_burst ( &f, k, p, k->num_bursts+1 );
+
+    double const until = now_s() + 10;
+    while ( !rv && !k->acked && now_s() < until ) {
+      if ( rb_replies ( &f, pk, num_packets, 100 ) ) rv = 1;
+    }
+    if ( !k->acked ) rv = 1;
+  }
+
+  if ( f.fd >= 0 ) close ( f.fd );
+
+  for ( p=1; p<=num_packets; p++ ) {
+    int resent = 0;
+    for ( b=1; b<=pk[p].num_bursts; b++ ) {
+      st->lost  += pk[p].lost[b];
+      st->asked += pk[p].lost[b] && pk[p].asked[b];
+      resent    |= pk[p].asked[b];
+    }
+    st->clean        += pk[p].acked && !resent;
+    st->bursts       += pk[p].num_bursts;
+    st->packet_bytes += pk[p].size;
+    st->packets      ++;
+    if ( compare_packet ( rx_dir, hynv, prof, p, pk[p].bytes, pk[p].size ) ) {
+      fprintf ( stderr, "%04hu %05hu %02d received not as sent\n", hynv, prof, p );
+      rv = 1;
+    }
+  }
+  st->repair_bytes += f.repair_sent;
+  st->sent_bytes   += f.sent;
+
+  for ( p=0; p<=num_packets; p++ ) free ( pk[p].bytes );
+  return rv;
+}
+
+//  Independent losses at rate q: a repair group of s data bursts needs no
+//  resend if none is lost, or one is lost and its repair burst is not.
+//  A lost burst is rebuilt if the rest of its group and the repair burst came.
+//
+static void expected ( int num_bursts, int repair, double q, double* clean, double* rebuilt ) {
+
+  int const groups = repair ? repair : 1;
+  *clean   = 1;
+  *rebuilt = 0;
+
+  int g;
+  for ( g=0; g<groups && g<num_bursts; g++ ) {
+    int const s = ( num_bursts - g + groups - 1 ) / groups;
+    double const none = pow ( 1-q, s );
+    if ( repair ) {
+      double const one = s * q * pow ( 1-q, s-1 ) * ( 1-q );
+      *clean   *= none + one;
+      *rebuilt += s * pow ( 1-q, s );
+    } else {
+      *clean   *= none;
+    }
+  }
+  *rebuilt /= num_bursts;
+}
+
+int main( int argc, char* argv[] ) {
+
+  int      num_bursts  = 8;
+  int      burst_size  = 1024;
+  int      num_packets = 50;
+  int      num_profiles = 8;
+  int      window      = 0;
+  uint16_t port        = 43410;
+  char*    dir         = 0;
+  double   repair[16] = { 0, 1, 2, 4 };
+  double   loss  [16] = { 0.01, 0.02, 0.05, 0.1 };
+  int      n_repair = 4, n_loss = 4;
+
+  int opt;
+
+  for ( opterr=0; ( opt = getopt ( argc, argv, "?hn:B:k:m:F:L:w:p:d:g:" ) ) != EOF ; ) {
+    switch ( opt ) {
+    case '?':
+    case 'h': print_usage(argv[0]); return 0;
+    case 'n': num_bursts   = atoi ( optarg ); break;
+    case 'B': burst_size   = atoi ( optarg ); break;
+    case 'k': num_packets  = atoi ( optarg ); break;
+    case 'm': num_profiles = atoi ( optarg ); break;
+    case 'F': n_repair = parse_list ( optarg, repair, 16 ); break;
+    case 'L': n_loss   = parse_list ( optarg, loss,   16 ); break;
+    case 'w': window       = atoi ( optarg ); break;
+    case 'p': port         = atoi ( optarg ); break;
+    case 'd': dir          = optarg; break;
+    case 'g': switch ( optarg[0] ) {
+              case 'd': case 'D': syslog_setVerbosity( SYSLOG_DEBUG   ); break;
+              case 'i': case 'I': syslog_setVerbosity( SYSLOG_INFO    ); break;
+              case 'n': case 'N': syslog_setVerbosity( SYSLOG_NOTICE  ); break;
+              case 'w': case 'W': syslog_setVerbosity( SYSLOG_WARNING ); break;
+              case 'e': case 'E': syslog_setVerbosity( SYSLOG_ERROR   ); break;
+              }
+              break;
+    default : fprintf ( stderr, "%s: Ignoring unknown '-%c' option\n", argv[0], opt ); break;
+    }
+  }
+
+  int i;
+  for ( i=0; i<n_repair; i++ ) {
+    if ( repair[i] < 0 || repair[i] > 4 ) n_repair = 0;   //  RX_MAX_REPAIR
+  }
+
+  if ( num_bursts < 1 || num_bursts > RB_MAX_BURSTS || burst_size < 128 || burst_size > 9999
+    || num_packets < 1 || num_packets > 99 || num_profiles < 1 || num_profiles > 999
+    || window < 0 || window > 32 || !n_repair || !n_loss ) {
+    print_usage ( argv[0] );
+    return 2;
+  }
+
+  char tmpdir[] = "/tmp/repair_bench_XXXXXX";
+  if ( !dir ) {
+    if ( !( dir = mkdtemp ( tmpdir ) ) ) {
+      perror ( "mkdtemp" );
+      return 2;
+    }
+  }
+
+  fflush ( stdout );
+
+  pid_t receiver = fork();
+  if ( 0 == receiver ) {
+    _exit ( profile_receive ( dir, port ) );
+  }
+
+  int tries;
+  for ( tries=0; tries<50; tries++ ) {
+    int fd = connect_port ( port, 1 );
+    if ( fd >= 0 ) { close ( fd ); break; }
+    usleep ( 100000 );
+  }
+  if ( 50 == tries ) {
+    fprintf ( stderr, "Receiver does not listen on port %hu\n", port );
+    kill ( receiver, SIGTERM );
+    waitpid ( receiver, 0, 0 );
+    return 2;
+  }
+
+  printf ( "repair,burst_loss,packets,data_bursts,repair_overhead,sent_of_data,lost,rebuilt,expected_rebuilt,no_resend,expected_no_resend,received\n" );
+
+  int failures = 0;
+  int l, r, m;
+  uint16_t prof = 1;
+
+  for ( l=0; l<n_loss; l++ ) {
+    for ( r=0; r<n_repair; r++ ) {
+
+      rb_stats_t st;
+      memset ( &st, 0, sizeof(st) );
+
+      for ( m=0; m<num_profiles; m++ ) {
+        unsigned int const seed = 1 + 1000*l + m;
+        if ( float_profile ( port, dir, 300, prof++, num_packets, num_bursts, burst_size,
+                             (int)repair[r], window, loss[l], seed, seed+500, &st ) ) {
+          st.failures++;
+        }
+      }
+      failures += st.failures;
+
+      double clean, rebuilt;
+      expected ( num_bursts, (int)repair[r], loss[l], &clean, &rebuilt );
+
+      printf ( "%g,%g,%ld,%ld,%.3f,%.3f,%ld,%.3f,%.3f,%.3f,%.3f,%s\n",
+               repair[r], loss[l], st.packets, st.bursts,
+               (double)st.repair_bytes / st.packet_bytes,
+               (double)st.sent_bytes / st.packet_bytes,
+               st.lost, st.lost ? 1 - (double)st.asked / st.lost : 0, rebuilt,
+               (double)st.clean / st.packets, clean,
+               st.failures ? "FAILED" : "ok" );
+      fflush ( stdout );
+    }
+  }
+
+  kill ( receiver, SIGTERM );
+  waitpid ( receiver, 0, 0 );
+
+  return failures ? 1 : 0;
+}
@@ -1,25 +1,28 @@
 # include "sensor_data.h"
 
 # include <stdio.h>
+# include <stdlib.h>
 
 void generate_fake_hyper ( Spectrometer_Data_t* h, uint16_t side ) {
 
   int p;
   for ( p=0; p<N_SPEC_PIX; p++ ) {
-    h->light_minus_dark_spectrum[p] = 0x0040 + ( 0xFF00 & random() );
+    h->hnv_spectrum[p] = 0x0040 + ( 0xFF00 & random() );
   }
   h->aux.integration_time = 128;
   h->aux.sample_number    = 1;
   h->aux.dark_average     = 0x0100 + ( 0x002F & random() );
   h->aux.dark_noise       = 0x0010 + ( 0x0004 & random() );
+  h->aux.light_minus_dark_up_shift = 0;
   h->aux.spectrometer_temperature = 1230;
   gettimeofday ( &(h->aux.acquisition_time), (void*) 0 );
-  h->aux.pressure         = 123.456F;
-  h->aux.float_heading    = -8989;
-  h->aux.float_yaw        =   111;
-  h->aux.float_roll       =  -222;
-  h->aux.radiometer_yaw   =   -99;
-  h->aux.radiometer_roll  =   188;
+  h->aux.pressure         = 123456;
+  h->aux.sun_azimuth      =  1800;
+  h->aux.housing_heading  = -8989;
+  h->aux.housing_pitch    =   111;
+  h->aux.housing_roll     =  -222;
+  h->aux.spectrometer_pitch =  -99;
+  h->aux.spectrometer_roll  =  188;
   h->aux.tag              =     0;
   h->aux.side             =  side;
 }
@@ -29,11 +32,10 @@ void generate_fake_hyper ( Spectrometer_Data_t* h, uint16_t side ) {
 void  generate_fake_ocr (OCR_Data_t* o)
 {
   int p;
-  for  (p = 0;  p < 4;  p++)
+  for  (p = 0;  p < N_OCR_PIX;  p++)
   {
-    o->channel[p] = 0x0040 + ( 0x1FFF & random() );
+    o->pixel[p] = 0x0040 + ( 0x1FFF & random() );
   }
-  o->aux.sample_number = 1;
   gettimeofday ( &(o->aux.acquisition_time), (void*) 0 );
 }
 
@@ -41,16 +43,19 @@ void  generate_fake_ocr (OCR_Data_t* o)
 
 void generate_fake_mcoms( MCOMS_Data_t* m )
 {
-  int p, q;
-  for  (p = 0;  p < 4;  p++)
-  {
-    for  (q = 0;  q < 3;  q++)
-    {
-      m->rawdata[q][p] = 0x0040 + (0x1FFF & random ());
-    }
-  }
+  m->chl_led    = 0x0040 + (0x1FFF & random ());
+  m->chl_low    = 0x0040 + (0x1FFF & random ());
+  m->chl_hgh    = 0x0040 + (0x1FFF & random ());
+  m->chl_value  = 0x0040 + (0x1FFF & random ());
+  m->bb_led     = 0x0040 + (0x1FFF & random ());
+  m->bb_low     = 0x0040 + (0x1FFF & random ());
+  m->bb_hgh     = 0x0040 + (0x1FFF & random ());
+  m->bb_value   = 0x0040 + (0x1FFF & random ());
+  m->fdom_led   = 0x0040 + (0x1FFF & random ());
+  m->fdom_low   = 0x0040 + (0x1FFF & random ());
+  m->fdom_hgh   = 0x0040 + (0x1FFF & random ());
+  m->fdom_value = 0x0040 + (0x1FFF & random ());
 
-  m->aux.sample_number    = 1;
   gettimeofday (&(m->aux.acquisition_time), (void*) 0 );
 }
 
@@ -0,0 +1,481 @@
+# include <errno.h>
+# include <math.h>
+# include <poll.h>
+# include <signal.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+# include <sys/mman.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <sys/wait.h>
+
+# include "zlib.h"
+
+# include "profile_packet.h"
+# include "profile_receive.h"
+# include "burst_transfer.h"
+# include "harness_common.h"
+# include "syslog.h"
+
+static char ProgramDescription[] = "HyperNav Sliding Window Goodput Matrix [Satlantic]";
+static char ProgramRevision   [] = "Revision 0.2  2026-10-17";
+
+/******************************
+ *  Function: Print usage
+ */
+static void print_usage ( char* pn ) {
+
+  printf ( "%s\n%s\n", ProgramDescription, ProgramRevision );
+  printf ( "Usage: %s [-h -? -kK -sS -BB -rR -tT -RL -LL -WL -EL -AL -pP -dD -gx -X]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -kK     Data packets per profile [default: 3]\n" );
+  printf ( "       -sS     Spectra per data packet, 1..%d [default: 3]\n", MXHNV );
+  printf ( "       -BB     Burst size, the start for adaptive [default: 4096]\n" );
+  printf ( "       -rR     Link rate in bytes/s, float to receiver [default: 300]\n" );
+  printf ( "       -tT     Pause between transmission steps in ms [default: 500]\n" );
+  printf ( "       -RL     Round trip times in ms [default: 500,1000,2000,4000]\n" );
+  printf ( "       -LL     Burst loss probabilities [default: 0,0.02,0.05,0.1]\n" );
+  printf ( "       -WL     Windows, 0 for one burst per step [default: 0,1,4,8]\n" );
+  printf ( "       -EL     Byte error rates injected by the receiver (TXRXERRORRATE) [default: 0]\n" );
+  printf ( "       -AL     Burst sizes, 0 fixed, 1 adaptive [default: 0]\n" );
+  printf ( "       -pP     Receiver port; link emulators listen above it [default: 43310]\n" );
+  printf ( "       -dD     Directory for received packets [default: mkdtemp]\n" );
+  printf ( "       -gx     Receiver log level (x=D|I|N|W|E) [default: W]\n" );
+  printf ( "       -X      Check that adaptive bursts come down to %d bytes or less\n", 2*BT_BURST_MIN );
+  printf ( "               on every lossy link.\n" );
+  printf ( "Every combination runs concurrently: one float per combination, each\n" );
+  printf ( "over its own link_emulator (built next to this program), to a receiver\n" );
+  printf ( "per byte error rate.\n" );
+  printf ( "The float runs the transmission steps of burst_transfer.c, as the\n" );
+  printf ( "profile manager does; its modem returns from sending after the bytes\n" );
+  printf ( "went out at the link rate.\n" );
+  printf ( "Goodput is the profile's packet bytes over the seconds until all are\n" );
+  printf ( "acknowledged. Exits 1 if a packet is not received byte-identical,\n" );
+  printf ( "or with -X, if a check fails.\n" );
+}
+
+/******************************
+ *  Float side: the steps of burst_transfer.c, as the profile manager
+ *  runs them, over a socket to the link emulator
+ */
+typedef struct fm_packet {
+  unsigned char* bytes;     //  Packet content following HYNV_num/PROF_num/PCKT_num, as sent
+  uint16_t       size;
+} fm_packet_t;
+
+typedef struct fm_float {
+  int              fd;
+  uint16_t         hynv;
+  uint16_t         prof;
+  fm_packet_t*     pk;
+  double           rate;
+  double           link_free;     //  when the modem has sent all it was given
+  size_t           sent;
+  int              smallest;      //  data burst sent, in bytes
+
+  bt_t             bt;
+  Packet_Status_t  status [100];
+  uint16_t         bursts [100];
+  Burst_Status_t   bst    [100];
+} fm_float_t;
+
+//  Shared with the parent
+//
+typedef struct fm_stats {
+  double seconds;
+  size_t data;
+  size_t sent;
+  int    acked;
+  int    done;
+  int    burst;     //  last adaptive burst size that went through
+  int    smallest;  //  data burst sent
+} fm_stats_t;
+
+static void sleep_s ( double s ) {
+  if ( s <= 0 ) return;
+  struct timespec t = { (time_t)s, (long)( 1e9*( s - (time_t)s ) ) };
+  while ( nanosleep ( &t, &t ) && EINTR == errno ) {
+    ;
+  }
+}
+
+static uint32_t fm_now_ms ( void* context ) {
+  return (uint32_t) ( 1e3*now_s() );
+}
+
+static void fm_sleep_ms ( void* context, uint32_t ms ) {
+  sleep_s ( 1e-3*ms );
+}
+
+//  mdm_recv() without blocking: the link is gone once the emulator closed it
+//
+static int16_t fm_recv ( void* context, char* data, uint16_t size ) {
+
+  fm_float_t* f = context;
+  ssize_t const n = recv ( f->fd, data, size, MSG_DONTWAIT );
+
+  if ( n > 0 ) return (int16_t)n;
+  if ( n < 0 && ( EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno ) ) return 0;
+  return -1;
+}
+
+//  mdm_send() with CTS: returns once the modem sent the bytes at the link rate
+//
+static int fm_send ( void* context, const char* data, uint16_t size ) {
+
+  fm_float_t* f = context;
+  double const now = now_s();
+  f->link_free = ( f->link_free > now ? f->link_free : now ) + size / f->rate;
+  sleep_s ( f->link_free - now );
+
+  while ( size ) {
+    ssize_t n = write ( f->fd, data, size );
+    if ( n < 0 ) {
+      if ( EINTR == errno ) continue;
+      return 1;
+    }
+    data += n; size -= n; f->sent += n;
+  }
+  return 0;
+}
+
+//  Burst 0: header only, value = number of bursts
+//  Burst b: header and data, value = size of data
+//  Burst nB+1: terminator, header only
+//
+static int fm_burst ( void* context, uint16_t p, int burst_size, int* nB, int b ) {
+
+  fm_float_t* f = context;
+  fm_packet_t* pk = f->pk + p;
+  char burst[32 + 10000];
+  const unsigned char* data = 0;
+  int sz = 0;
+
+  if ( !*nB ) *nB = bt_burst_count ( pk->size, burst_size );
+
+  if ( b > *nB ) {
+    snprintf ( burst, 25, "BRST%04hu%05hu%04dZZZZZZZ", f->hynv, f->prof, p );
+  } else if ( 0 == b ) {
+    snprintf ( burst, 25, "BRST%04hu%05hu%04d%03d%04d", f->hynv, f->prof, p, 0, *nB );
+  } else {
+    int const bsize = 1 + ( pk->size - 1 ) / *nB;
+    data = pk->bytes + (b-1)*bsize;
+    sz   = ( b < *nB ) ? bsize : pk->size - (*nB-1)*bsize;
+    if ( !f->smallest || bsize < f->smallest ) f->smallest = bsize;
+    snprintf ( burst, 25, "BRST%04hu%05hu%04d%03d%04d", f->hynv, f->prof, p, b, sz );
+  }
+
+  uLong crc = crc32 ( 0L, Z_NULL, 0 );
+        crc = crc32 ( crc, (Bytef*)burst, 24 );
+  if ( sz ) crc = crc32 ( crc, data, sz );
+  snprintf ( burst+24, 9, "%08lX", crc );
+  if ( sz ) memcpy ( burst+32, data, sz );
+
+  return fm_send ( f, burst, 32+sz );
+}
+
+static int fm_size ( void* context, uint16_t p ) {
+  fm_float_t* f = context;
+  return f->pk[p].size;
+}
+
+static void fm_note ( void* context, const char* text ) {
+  fm_float_t* f = context;
+  syslog_out ( SYSLOG_INFO, "bt_transmission", "%hu %.*s", f->hynv, (int)strcspn ( text, "\r\n" ), text );
+}
+
+//  The profile every float sends: K packets of S spectra, sent uncompressed
+//  (the receiver saves them as they are). As in the profile manager,
+//  bt_transmission() leaves the info packet 0 out.
+//
+static int make_profile ( fm_packet_t* pk, int num_packets, int spectra, uint16_t hynv ) {
+
+  unsigned int seed = 5037;
+  int p;
+
+  memset ( pk, 0, (num_packets+1)*sizeof(fm_packet_t) );
+
+  pk[0].size  = 4*4 + 4*4 + BEGPAK_META;
+  pk[0].bytes = malloc ( pk[0].size+1 );
+  if ( !pk[0].bytes ) return 1;
+  snprintf ( (char*)pk[0].bytes, 33, "%04d%04d%04d%04d%04d%04d%04d%04d",
+             num_packets*spectra, 0, 0, 0, num_packets, 0, 0, 0 );
+  memset ( pk[0].bytes+32, '_', BEGPAK_META );
+
+  for ( p=1; p<=num_packets; p++ ) {
+    pk[p].size  = 32 + spectra*( (N_SPEC_PIX/8)*16 + SPEC_AUX_SERIAL_SIZE );
+    pk[p].bytes = malloc ( pk[p].size+1 );
+    if ( !pk[p].bytes ) return 1;
+    char header[33];
+    snprintf ( header, sizeof(header), "S SATYLU%04hu%04dG00N            ", hynv, spectra );
+    memcpy ( pk[p].bytes, header, 32 );
+    int i;
+    for ( i=32; i<pk[p].size; i++ ) {
+      pk[p].bytes[i] = (unsigned char) ( rand_r(&seed) % 23 );
+    }
+  }
+  return 0;
+}
+
+static int float_model ( uint16_t hynv, uint16_t port, int num_packets, int spectra, int burst_size, int adapt,
+                         double rate, int tick_ms, uint16_t window, fm_stats_t* stats ) {
+
+  static fm_float_t f;
+  fm_packet_t pk[100];
+  if ( make_profile ( pk, num_packets, spectra, hynv ) ) return 2;
+
+  memset ( &f, 0, sizeof(f) );
+  f.hynv = hynv;
+  f.prof = 16291;
+  f.pk   = pk;
+  f.rate = rate;
+
+  //  Always connected: no carrier, connect or call end
+  bt_io_t const io = { &f, fm_now_ms, fm_sleep_ms, fm_recv, fm_send,
+                       0, 0, 0, 0, 0, fm_burst, fm_size, 0, 0, fm_note };
+
+  bt_init ( &f.bt, &io );
+  f.bt.serial       = hynv;
+  f.bt.offer_window = window;
+  f.bt.fixed_burst  = burst_size;
+  f.bt.adapt        = adapt;
+  f.bt.poll_ms      = tick_ms;
+  bt_profile ( &f.bt, f.prof, num_packets+1, f.status, f.bursts, f.bst );
+
+  int p;
+  for ( p=1; p<=num_packets; p++ ) stats->data += pk[p].size;
+
+  double const t0 = now_s();
+
+  if ( 0 > ( f.fd = connect_port ( port, 1 ) ) ) return 2;
+
+  int rv;
+  while ( BT_CONTINUE == ( rv = bt_transmission ( &f.bt ) ) || BT_SEND_NOW == rv ) {
+    if ( BT_CONTINUE == rv ) sleep_s ( 1e-3*tick_ms );
+    if ( now_s() - t0 > 3600 ) break;
+  }
+
+  stats->seconds = now_s() - t0;
+  stats->sent    = f.sent;
+  stats->done    = ( BT_ALL_DONE == rv );
+  stats->burst   = f.bt.good;
+  stats->smallest = f.smallest;
+  for ( p=1; p<=num_packets; p++ ) stats->acked += ( PCK_Confirmed == f.status[p] );
+
+  close ( f.fd );
+  for ( p=0; p<=num_packets; p++ ) free ( pk[p].bytes );
+
+  return ( stats->done && stats->acked == num_packets ) ? 0 : 1;
+}
+
+//  Cell i of the matrix, the burst mode varying fastest
+//
+typedef struct matrix_cell {
+  int rtt, loss, win, err, adapt;
+} matrix_cell_t;
+
+static matrix_cell_t cell_of ( int i, int n_loss, int n_win, int n_err, int n_adapt ) {
+  matrix_cell_t c;
+  c.adapt = i % n_adapt;  i /= n_adapt;
+  c.err   = i % n_err;    i /= n_err;
+  c.win   = i % n_win;    i /= n_win;
+  c.loss  = i % n_loss;   i /= n_loss;
+  c.rtt   = i;
+  return c;
+}
+
+int main( int argc, char* argv[] ) {
+
+  int      num_packets = 3;
+  int      spectra     = 3;
+  int      burst_size  = 4096;
+  double   rate        = 300;
+  int      tick_ms     = 500;
+  uint16_t port        = 43310;
+  char*    dir         = 0;
+  int      check       = 0;
+  double   rtt [16] = { 500, 1000, 2000, 4000 };
+  double   loss[16] = { 0, 0.02, 0.05, 0.1 };
+  double   win [16] = { 0, 1, 4, 8 };
+  double   err [16] = { 0 };
+  double   adapt[2] = { 0 };
+  int      n_rtt = 4, n_loss = 4, n_win = 4, n_err = 1, n_adapt = 1;
+
+  int opt;
+
+  for ( opterr=0; ( opt = getopt ( argc, argv, "?hk:s:B:r:t:R:L:W:E:A:p:d:g:X" ) ) != EOF ; ) {
+    switch ( opt ) {
+    case '?':
+    case 'h': print_usage(argv[0]); return 0;
+    case 'k': num_packets = atoi ( optarg ); break;
+    case 's': spectra     = atoi ( optarg ); break;
+    case 'B': burst_size  = atoi ( optarg ); break;
+    case 'r': rate        = atof ( optarg ); break;
+    case 't': tick_ms     = atoi ( optarg ); break;
+    case 'R': n_rtt  = parse_list ( optarg, rtt,  16 ); break;
+    case 'L': n_loss = parse_list ( optarg, loss, 16 ); break;
+    case 'W': n_win  = parse_list ( optarg, win,  16 ); break;
+    case 'E': n_err  = parse_list ( optarg, err,  16 ); break;
+    case 'A': n_adapt = parse_list ( optarg, adapt, 2 ); break;
+    case 'p': port        = atoi ( optarg ); break;
+    case 'd': dir         = optarg; break;
+    case 'X': check       = 1; break;
+    case 'g': switch ( optarg[0] ) {
+              case 'd': case 'D': syslog_setVerbosity( SYSLOG_DEBUG   ); break;
+              case 'i': case 'I': syslog_setVerbosity( SYSLOG_INFO    ); break;
+              case 'n': case 'N': syslog_setVerbosity( SYSLOG_NOTICE  ); break;
+              case 'w': case 'W': syslog_setVerbosity( SYSLOG_WARNING ); break;
+              case 'e': case 'E': syslog_setVerbosity( SYSLOG_ERROR   ); break;
+              }
+              break;
+    default : fprintf ( stderr, "%s: Ignoring unknown '-%c' option\n", argv[0], opt ); break;
+    }
+  }
+
+  if ( num_packets < 1 || num_packets > 99 || spectra < 1 || spectra > MXHNV || burst_size < 128 || burst_size > 9999
+    || rate <= 0 || tick_ms < 1 || !n_rtt || !n_loss || !n_win || !n_err || !n_adapt ) {
+    print_usage ( argv[0] );
+    return 2;
+  }
+
+  int    const n_floats = n_rtt * n_loss * n_win * n_err * n_adapt;
+  int    const n_ports  = n_err + (int)n_floats;
+
+  char tmpdir[] = "/tmp/window_matrix_XXXXXX";
+  if ( !dir ) {
+    if ( !( dir = mkdtemp ( tmpdir ) ) ) {
+      perror ( "mkdtemp" );
+      return 2;
+    }
+  }
+
+  //  The link emulator is built next to this program
+  //
+  char emulator[512];
+  snprintf ( emulator, sizeof(emulator), "%s", argv[0] );
+  char* slash = strrchr ( emulator, '/' );
+  snprintf ( slash ? slash+1 : emulator, sizeof(emulator) - ( slash ? slash+1-emulator : 0 ), "link_emulator" );
+
+  fflush ( stdout );
+
+  //  One receiver per byte error rate
+  //
+  pid_t* receivers = calloc ( n_err, sizeof(pid_t) );
+  pid_t* links     = calloc ( n_floats, sizeof(pid_t) );
+  if ( !receivers || !links ) return 2;
+
+  int i;
+  for ( i=0; i<n_err; i++ ) {
+    if ( 0 == ( receivers[i] = fork() ) ) {
+      profile_receive_error_rate = err[i];
+      srand48 ( 1+i );
+      _exit ( profile_receive ( dir, port+i ) );
+    }
+  }
+
+  //  One link emulator per float
+  //
+  for ( i=0; i<n_floats; i++ ) {
+    matrix_cell_t const c = cell_of ( i, n_loss, n_win, n_err, n_adapt );
+    char lport[16], target[32], delay[32], error[32], seed[16];
+    snprintf ( lport,  sizeof(lport),  "-l%d", port+n_err+i );
+    snprintf ( target, sizeof(target), "-c127.0.0.1:%d", port+c.err );
+    snprintf ( delay,  sizeof(delay),  "-d%g", rtt[c.rtt]/2 );
+    snprintf ( error,  sizeof(error),  "-e%.6g", 1 - pow ( 1-loss[c.loss], 1.0/(32+burst_size) ) );
+    snprintf ( seed,   sizeof(seed),   "-s%d", 1 + c.rtt*n_loss + c.loss );
+    if ( 0 == ( links[i] = fork() ) ) {
+      execl ( emulator, emulator, lport, target, delay, error, seed, (char*)0 );
+      perror ( emulator );
+      _exit ( 2 );
+    }
+  }
+
+  //  Wait for all to listen
+  //
+  int tries, listening = 0;
+  for ( tries=0; tries<50 && listening < n_ports; tries++ ) {
+    usleep ( 100000 );
+    for ( listening=0; listening<n_ports; listening++ ) {
+      int fd = connect_port ( port+listening, 1 );
+      if ( fd < 0 ) break;
+      close ( fd );
+    }
+  }
+
+  fm_stats_t* stats = mmap ( 0, (size_t)n_floats*sizeof(fm_stats_t), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0 );
+
+  int failures = 0;
+
+  if ( listening < n_ports || MAP_FAILED == stats ) {
+    fprintf ( stderr, "Receivers or link emulators do not listen on ports %hu..%d\n", port, port+n_ports-1 );
+    failures = n_floats;
+  } else {
+
+    memset ( stats, 0, (size_t)n_floats*sizeof(fm_stats_t) );
+
+    for ( i=0; i<n_floats; i++ ) {
+      matrix_cell_t const c = cell_of ( i, n_loss, n_win, n_err, n_adapt );
+      if ( 0 == fork() ) {
+        _exit ( float_model ( 200+i, port+n_err+i, num_packets, spectra, burst_size, (int)adapt[c.adapt],
+                              rate, tick_ms, (uint16_t)win[c.win], stats+i ) );
+      }
+    }
+    for ( i=0; i<n_floats; i++ ) {
+      int status;
+      if ( wait ( &status ) < 0 ) break;
+      if ( !WIFEXITED(status) || WEXITSTATUS(status) ) failures++;
+    }
+  }
+
+  for ( i=0; i<n_floats; i++ ) {
+    kill ( links[i], SIGTERM );
+    waitpid ( links[i], 0, 0 );
+  }
+  for ( i=0; i<n_err; i++ ) {
+    kill ( receivers[i], SIGTERM );
+    waitpid ( receivers[i], 0, 0 );
+  }
+
+  //  Every packet must have arrived as sent
+  //
+  int mismatches = 0;
+  int checks     = 0;
+  fm_packet_t pk[100];
+
+  printf ( "rtt_ms,burst_loss,window,rx_error_rate,adaptive,seconds,packet_bytes,sent_bytes,goodput_Bps,goodput_of_rate,burst,smallest,acked,received\n" );
+
+  for ( i=0; i<n_floats && MAP_FAILED != stats; i++ ) {
+    matrix_cell_t const c = cell_of ( i, n_loss, n_win, n_err, n_adapt );
+    int bad = 0, p;
+    if ( !make_profile ( pk, num_packets, spectra, 200+i ) ) {
+      for ( p=1; p<=num_packets; p++ ) {
+        bad += compare_packet ( dir, 200+i, 16291, p, pk[p].bytes, pk[p].size );
+      }
+      for ( p=0; p<=num_packets; p++ ) free ( pk[p].bytes );
+    }
+    mismatches += bad;
+
+    //  -X: on a lossy link, the adaptive burst size comes down
+    //  towards BT_BURST_MIN, also for packets of many bursts
+    int const stuck = check && adapt[c.adapt] && loss[c.loss] > 0
+                   && !( stats[i].smallest && stats[i].smallest <= 2*BT_BURST_MIN );
+    checks += stuck;
+
+    double const goodput = stats[i].seconds > 0 ? stats[i].data / stats[i].seconds : 0;
+    printf ( "%g,%g,%g,%g,%g,%.1f,%zu,%zu,%.1f,%.3f,%d,%d,%d/%d,%s\n",
+             rtt[c.rtt], loss[c.loss], win[c.win], err[c.err], adapt[c.adapt],
+             stats[i].seconds, stats[i].data, stats[i].sent, goodput, goodput/rate,
+             stats[i].burst, stats[i].smallest, stats[i].acked, num_packets,
+             bad ? "MISMATCH" : stuck ? "BURST" : "ok" );
+  }
+
+  if ( failures ) fprintf ( stderr, "%d floats did not get all packets acknowledged\n", failures );
+  if ( checks   ) fprintf ( stderr, "%d adaptive floats kept bursts above %d bytes on a lossy link\n", checks, 2*BT_BURST_MIN );
+
+  return ( failures || mismatches || checks ) ? 1 : 0;
+}
@@ -0,0 +1,464 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+# include <sys/stat.h>
+
+# include "zlib.h"
+
+# include "profile_packet.h"
+# include "sensor_data.h"
+
+static char ProgramDescription[] = "HyperNav zlib Parameter Sweep [Satlantic]";
+static char ProgramRevision   [] = "Revision 0.1  2026-10-17";
+
+//  Packet data: bitplanes and auxiliary data may exceed FLAT_SZ
+# define CONTENTS_SZ sizeof(((Profile_Data_Packet_t*)0)->contents)
+
+//  Data of one packet, as passed to deflate()
+//
+typedef struct sweep_packet {
+  unsigned char* data;
+  uint32_t       size;
+} sweep_packet_t;
+
+//  Results of one parameter combination over all packets
+//
+typedef struct sweep_result {
+  int      level;
+  int      windowBits;
+  int      memLevel;
+  int      strategy;
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+  uint32_t heap_peak;    //  largest in-use heap of a single packet
+  double   cpu_ms;       //  deflate only
+  int      failures;     //  deflate errors, heap overruns or inflate mismatches
+  int      overruns;
+} sweep_result_t;
+
+static const char* strategy_name ( int strategy ) {
+  switch ( strategy ) {
+  case Z_DEFAULT_STRATEGY: return "default";
+  case Z_FILTERED:         return "filtered";
+  case Z_HUFFMAN_ONLY:     return "huffman";
+  case Z_RLE:              return "rle";
+  default:                 return "?";
+  }
+}
+
+/************************
+ *  Function: Print usage
+ */
+static void print_usage ( char* pn ) {
+
+  printf ( "%s\n%s\n", ProgramDescription, ProgramRevision );
+  printf ( "Usage: %s [-h -? -nN -sS -PN -t] [PROFL.Pnn ...]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -nN     Without packet files, simulate N packets [default: 16]\n" );
+  printf ( "       -sS     Spectra per simulated packet, 1..%d [default: %d]\n", MXHNV, MXHNV );
+  printf ( "       -PN     Noise bits removed from simulated packets [default: 0]\n" );
+  printf ( "       -t      Print the smallest output per heap budget instead of all combinations\n" );
+  printf ( "Packet files are uncompressed and unencoded spectrometer packets,\n" );
+  printf ( "either as saved on the float or as saved by the profile receiver.\n" );
+  printf ( "Results are written to stdout as CSV.\n" );
+  printf ( "Exits 1 if a combination failed to round-trip; heap overruns\n" );
+  printf ( "are reported in their own column and on stderr only.\n" );
+}
+
+/************************
+ *  Counting allocator: peak heap of a single deflate stream.
+ *
+ *  zlib 1.2.8 deflate can write past its pending buffer
+ *  for small memLevel values (stored blocks larger than the buffer).
+ *  Every allocation is followed by a guard area that is checked on free,
+ *  so such combinations are reported as failures instead of corrupting the heap.
+ */
+# define GUARD_SZ (64*1024+64)
+# define GUARD_BYTE 0xA5
+
+static uint32_t heap_inuse   = 0;
+static uint32_t heap_peak    = 0;
+static int      heap_overrun = 0;
+
+static voidpf sweep_zalloc ( voidpf opaque, uInt items, uInt size ) {
+  (void)opaque;
+  uint32_t const n = items*size;
+  unsigned char* p = malloc ( 16 + n + GUARD_SZ );
+  if ( !p ) return Z_NULL;
+  memcpy ( p, &n, sizeof(n) );
+  memset ( p+16+n, GUARD_BYTE, GUARD_SZ );
+  heap_inuse += n;
+  if ( heap_inuse > heap_peak ) heap_peak = heap_inuse;
+  return p+16;
+}
+
+static void sweep_zfree ( voidpf opaque, voidpf address ) {
+  (void)opaque;
+  if ( !address ) return;
+  unsigned char* p = (unsigned char*)address - 16;
+  uint32_t n;
+  memcpy ( &n, p, sizeof(n) );
+  uint32_t i;
+  for ( i=0; i<GUARD_SZ; i++ ) {
+    if ( GUARD_BYTE != p[16+n+i] ) {
+      heap_overrun = 1;
+      break;
+    }
+  }
+  heap_inuse -= n;
+  free ( p );
+}
+
+static double cpu_ms ( void ) {
+  struct timespec ts;
+  clock_gettime ( CLOCK_PROCESS_CPUTIME_ID, &ts );
+  return 1e3*ts.tv_sec + 1e-6*ts.tv_nsec;
+}
+
+/************************
+ *  Packet input
+ */
+
+//  Size of the data following the header of an uncompressed spectrometer packet,
+//  as laid out in flat_bytes by the controller: bitplanes, then auxiliary data.
+//
+static uint32_t spectrometer_data_size ( Profile_Data_Packet_t* p ) {
+
+  char numString[5];
+  memcpy ( numString, p->header.number_of_data, 4 );
+  numString[4] = 0;
+  uint32_t const number_of_data = atoi ( numString );
+
+  char const nbr = p->header.noise_bits_removed;
+  uint32_t planes = 16;
+  if      ( '0' <= nbr && nbr <= '9' ) planes = 16 - (nbr-'0');
+  else if ( 'A' <= nbr && nbr <= 'F' ) planes = 16 - (nbr-'A'+10);
+
+  return number_of_data * ( planes*(N_SPEC_PIX/8) + SPEC_AUX_SERIAL_SIZE );
+}
+
+static int packet_load ( const char* fn, sweep_packet_t* sp ) {
+
+  static Profile_Data_Packet_t p;
+
+  FILE* fp = fopen ( fn, "r" );
+  if ( !fp ) {
+    fprintf ( stderr, "Cannot open %s\n", fn );
+    return 1;
+  }
+
+  struct stat st;
+  fstat ( fileno(fp), &st );
+
+  memset ( &p, 0, sizeof(p) );
+
+  uint32_t size = 0;
+  unsigned char* data = 0;
+
+  if ( st.st_size == sizeof(Profile_Data_Packet_t) ) {
+
+    //  Saved on the float: the complete packet structure
+    //
+    if ( 1 != fread ( &p, sizeof(p), 1, fp ) ) {
+      fclose ( fp );
+      return 1;
+    }
+    data = p.contents.flat_bytes;
+    size = spectrometer_data_size ( &p );
+
+  } else if ( st.st_size > (off_t)sizeof(p.header) && st.st_size <= (off_t)(sizeof(p.header)+CONTENTS_SZ) ) {
+
+    //  Saved by the profile receiver: header and data
+    //
+    size = st.st_size - sizeof(p.header);
+    if ( 1 != fread ( &p.header, sizeof(p.header), 1, fp )
+      || 1 != fread ( p.contents.flat_bytes, size, 1, fp ) ) {
+      fclose ( fp );
+      return 1;
+    }
+    data = p.contents.flat_bytes;
+
+  } else {
+    fprintf ( stderr, "%s: not a packet\n", fn );
+    fclose ( fp );
+    return 1;
+  }
+
+  fclose ( fp );
+
+  if ( ( 'S' != p.header.sensor_type && 'P' != p.header.sensor_type )
+    || '0' != p.header.compression || 'N' != p.header.ASCII_encoding
+    || size > CONTENTS_SZ ) {
+    fprintf ( stderr, "%s: not an uncompressed, unencoded spectrometer packet\n", fn );
+    return 1;
+  }
+
+  sp->data = malloc ( size );
+  if ( !sp->data ) return 1;
+  memcpy ( sp->data, data, size );
+  sp->size = size;
+
+  return 0;
+}
+
+//  Gray-coded, bitplaned spectra from the sensor data simulator
+//
+static int packet_simulate ( sweep_packet_t* sp, uint16_t number_of_data, uint16_t noise_bits ) {
+
+  static Profile_Data_Packet_t raw, gray, bp;
+
+  memset ( &raw, 0, sizeof(raw) );
+
+  raw.header.sensor_type = 'S';
+  raw.header.empty_space = ' ';
+  memcpy ( raw.header.sensor_ID, "SATYLU0000", 10 );
+
+  char numString[8];
+  snprintf ( numString, 5, "%4hu", number_of_data );
+  memcpy ( raw.header.number_of_data, numString, 4 );
+
+  raw.header.representation     = 'B';
+  raw.header.noise_bits_removed = 'N';
+  raw.header.compression        = '0';
+  raw.header.ASCII_encoding     = 'N';
+
+  uint16_t* px = (uint16_t*)raw.contents.structured.sensor_data.bitplanes;
+
+  int d;
+  for ( d=0; d<number_of_data; d++ ) {
+    Spectrometer_Data_t h;
+    generate_fake_hyper ( &h, 1 );
+    memcpy ( px + d*N_SPEC_PIX, h.hnv_spectrum, N_SPEC_PIX*sizeof(uint16_t) );
+
+    uint8_t* aux = raw.contents.structured.aux_data.spec_serial + d*SPEC_AUX_SERIAL_SIZE;
+    memcpy ( aux, &h.aux, sizeof(h.aux) < SPEC_AUX_SERIAL_SIZE ? sizeof(h.aux) : SPEC_AUX_SERIAL_SIZE );
+  }
+
+  if ( data_packet_bin2gray ( &raw, &gray )
+    || data_packet_bitplane ( &gray, &bp, noise_bits ) ) {
+    return 1;
+  }
+
+  uint32_t const planes_sz = number_of_data * (16-noise_bits)*(N_SPEC_PIX/8);
+  uint32_t const aux_sz    = number_of_data * SPEC_AUX_SERIAL_SIZE;
+
+  sp->size = planes_sz + aux_sz;
+  sp->data = malloc ( sp->size );
+  if ( !sp->data ) return 1;
+
+  memcpy ( sp->data,             bp.contents.structured.sensor_data.bitplanes, planes_sz );
+  memcpy ( sp->data + planes_sz, bp.contents.structured.aux_data.spec_serial,  aux_sz    );
+
+  return 0;
+}
+
+/************************
+ *  Sweep
+ */
+
+//  Compress one packet with one parameter combination,
+//  and check that it inflates back to the input.
+//
+static int sweep_one ( sweep_packet_t* sp, sweep_result_t* r, unsigned char* out, uint32_t out_sz, unsigned char* back ) {
+
+  z_stream strm;
+  memset ( &strm, 0, sizeof(strm) );
+  strm.zalloc = sweep_zalloc;
+  strm.zfree  = sweep_zfree;
+
+  heap_inuse   = 0;
+  heap_peak    = 0;
+  heap_overrun = 0;
+
+  double const t0 = cpu_ms();
+
+  if ( Z_OK != deflateInit2 ( &strm, r->level, Z_DEFLATED, r->windowBits, r->memLevel, r->strategy ) ) {
+    return 1;
+  }
+
+  strm.next_in   = sp->data;
+  strm.avail_in  = sp->size;
+  strm.next_out  = out;
+  strm.avail_out = out_sz;
+
+  int const rv = deflate ( &strm, Z_FINISH );
+  uint32_t const total = strm.total_out;
+  (void)deflateEnd ( &strm );
+
+  r->cpu_ms += cpu_ms() - t0;
+
+  if ( heap_overrun ) {
+    r->overruns++;
+    return 1;
+  }
+
+  if ( Z_STREAM_END != rv ) {
+    return 1;
+  }
+
+  r->bytes_in  += sp->size;
+  r->bytes_out += total;
+  if ( heap_peak > r->heap_peak ) r->heap_peak = heap_peak;
+
+  //  The receiver inflates with the window size given in the zlib header
+  //
+  uLongf back_sz = sp->size;
+  memset ( &strm, 0, sizeof(strm) );
+  if ( Z_OK != inflateInit2 ( &strm, 0 ) ) return 1;
+  strm.next_in   = out;
+  strm.avail_in  = total;
+  strm.next_out  = back;
+  strm.avail_out = back_sz;
+  int const irv = inflate ( &strm, Z_FINISH );
+  back_sz = strm.total_out;
+  (void)inflateEnd ( &strm );
+
+  return Z_STREAM_END != irv || back_sz != sp->size || memcmp ( back, sp->data, sp->size );
+}
+
+int main( int argc, char* argv[] ) {
+
+  int      num_packets = 16;
+  uint16_t num_spectra = MXHNV;
+  uint16_t noise_bits  = 0;
+  int      table       = 0;
+
+  int opt;
+
+  for ( opterr=0; ( opt = getopt ( argc, argv, "?hn:s:P:t" ) ) != EOF ; ) {
+    switch ( opt ) {
+    case '?':
+    case 'h': print_usage(argv[0]); return 0;
+    case 'n': num_packets = atoi ( optarg ); break;
+    case 's': num_spectra = atoi ( optarg ); break;
+    case 'P': noise_bits  = atoi ( optarg ); break;
+    case 't': table       = 1; break;
+    default : fprintf ( stderr, "%s: Ignoring unknown '-%c' option\n", argv[0], opt ); break;
+    }
+  }
+
+  if ( num_packets < 1 ) num_packets = 1;
+  if ( num_spectra < 1 || num_spectra > MXHNV ) num_spectra = MXHNV;
+  if ( noise_bits > 15 ) noise_bits = 0;
+
+  //  Packets from files, or simulated
+  //
+  int const num_files = argc - optind;
+  int const n = num_files ? num_files : num_packets;
+
+  sweep_packet_t* sp = calloc ( n, sizeof(sweep_packet_t) );
+  if ( !sp ) return 2;
+
+  int have = 0;
+  int i;
+  for ( i=0; i<n; i++ ) {
+    if ( num_files ? packet_load ( argv[optind+i], sp+have )
+                   : packet_simulate ( sp+have, num_spectra, noise_bits ) ) {
+      continue;
+    }
+    have++;
+  }
+
+  if ( !have ) {
+    fprintf ( stderr, "No packets\n" );
+    return 2;
+  }
+
+  uint32_t const out_sz = CONTENTS_SZ + CONTENTS_SZ/8 + 64;   //  more than deflate expands stored data
+  unsigned char* out  = malloc ( out_sz );
+  unsigned char* back = malloc ( CONTENTS_SZ );
+
+  static const int strategies[] = { Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE };
+  int const num_results = 10 * 7 * 9 * 4;
+  sweep_result_t* result = calloc ( num_results, sizeof(sweep_result_t) );
+  if ( !out || !back || !result ) return 2;
+
+  int failures = 0;
+  int overruns = 0;
+  int nr = 0;
+
+  int level, windowBits, memLevel, s;
+  for ( level = 0; level <= 9; level++ ) {
+  for ( windowBits = 9; windowBits <= 15; windowBits++ ) {
+  for ( memLevel = 1; memLevel <= 9; memLevel++ ) {
+  for ( s = 0; s < 4; s++ ) {
+
+    sweep_result_t* r = result + nr++;
+    r->level      = level;
+    r->windowBits = windowBits;
+    r->memLevel   = memLevel;
+    r->strategy   = strategies[s];
+
+    for ( i=0; i<have; i++ ) {
+      r->failures += sweep_one ( sp+i, r, out, out_sz, back );
+    }
+    failures += r->failures - r->overruns;
+    overruns += r->overruns;
+  }
+  }
+  }
+  }
+
+  if ( !table ) {
+
+    printf ( "level,windowBits,memLevel,strategy,bytes_in,bytes_out,ratio,heap_peak,cpu_ms,failures,overruns\n" );
+    for ( i=0; i<nr; i++ ) {
+      sweep_result_t* r = result+i;
+      printf ( "%d,%d,%d,%s,%llu,%llu,%.4f,%u,%.2f,%d,%d\n",
+               r->level, r->windowBits, r->memLevel, strategy_name(r->strategy),
+               (unsigned long long)r->bytes_in, (unsigned long long)r->bytes_out,
+               r->bytes_in ? (double)r->bytes_out/r->bytes_in : 0.0,
+               r->heap_peak, r->cpu_ms, r->failures, r->overruns );
+    }
+
+  } else {
+
+    //  Per heap budget, the combination with the smallest output;
+    //  of equal outputs, the one using the least CPU.
+    //
+    printf ( "heap_budget,level,windowBits,memLevel,strategy,ratio,heap_peak,cpu_ms_per_packet\n" );
+
+    uint32_t budget;
+    for ( budget = 4*1024; budget <= 512*1024; budget *= 2 ) {
+      sweep_result_t* best = 0;
+      for ( i=0; i<nr; i++ ) {
+        sweep_result_t* r = result+i;
+        if ( r->failures || r->heap_peak > budget ) continue;
+        if ( !best || r->bytes_out < best->bytes_out
+                   || ( r->bytes_out == best->bytes_out && r->cpu_ms < best->cpu_ms ) ) {
+          best = r;
+        }
+      }
+      if ( best ) {
+        printf ( "%u,%d,%d,%d,%s,%.4f,%u,%.3f\n", budget,
+                 best->level, best->windowBits, best->memLevel, strategy_name(best->strategy),
+                 (double)best->bytes_out/best->bytes_in, best->heap_peak, best->cpu_ms/have );
+      } else {
+        printf ( "%u,,,,,,,\n", budget );
+      }
+    }
+  }
+
+  //  Known for zlib 1.2.8: level 0 with Z_RLE and large windows
+  //  writes beyond its pending buffer. Not used on the float.
+  //
+  if ( overruns ) {
+    fprintf ( stderr, "%d deflate runs wrote beyond their allocation (see overruns column)\n", overruns );
+  }
+  if ( failures ) {
+    fprintf ( stderr, "%d deflate runs failed or did not inflate to the original\n", failures );
+  }
+
+  for ( i=0; i<have; i++ ) {
+    free ( sp[i].data );
+  }
+  free ( sp );
+  free ( out );
+  free ( back );
+  free ( result );
+
+  return failures ? 1 : 0;
+}
@@ -387,6 +387,18 @@ typedef struct data_exchange_packet {
 
 } data_exchange_packet_t;
 
+//  Between the boards, packets travel as records of spi_link frames (spi_link.h):
+//  the packet header (to, from, type), then the value or the package data.
+//  Frames from the spectrometer board hold a spectrum and a few messages,
+//  frames from the controller board hold commands and configuration data.
+//  A package (DataPackagePointer) always starts a frame, so that the receiver
+//  only takes a frame while it has a package free for it.
+
+# define DE_LINK_HEADER_SIZE  ( 2*sizeof(data_exchange_address_t) + sizeof(data_exchange_type_t) )
+# define DE_LINK_SPEC_FRAME   4864  //  Bytes, spectrometer board to controller board
+# define DE_LINK_CTRL_FRAME   1024  //  Bytes, controller board to spectrometer board
+# define DE_LINK_RECORDS_MAX    32
+
 //*****************************************************************************
 // Exported functions
 //*****************************************************************************
@@ -0,0 +1,18 @@
+#!/bin/sh
+
+#  Build the host loopback test of the framed board to board link.
+#  spi_link.c is compiled unchanged; both boards run in threads
+#  of one process, connected by a socket pair.
+#
+#  Usage:  sh compile_spi_link_test.sh
+#          ./spi_link_test                # clean link
+#          ./spi_link_test -l20 -b20      # 2% of frames lost, 2% corrupted
+#          ./spi_link_test -r1            # one packet per frame
+
+gcc \
+     -O2 -Wall \
+     -o spi_link_test \
+     -I .. \
+     ../spi_link.c \
+     spi_link_test.c \
+     -lpthread
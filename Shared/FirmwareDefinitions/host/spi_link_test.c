@@ -0,0 +1,389 @@
+/*! \file spi_link_test.c **********************************************************
+ *
+ * \brief Host loopback test of the framed board to board link
+ *
+ *  Two threads, one per board, each run the link state machine the way
+ *  the data exchange task does (receive, queue, flush), over a socket pair
+ *  standing in for the SPI. Each board sends packets to the other:
+ *  mostly command sized, some spectrum sized.
+ *
+ *  The transport can drop frames and flip bits (fault injection).
+ *  Link time is modelled per transfer, as the handshake (ready lines,
+ *  sync string, task delay) plus the bytes, and compared with one
+ *  transfer per packet as SPI_tx_packet() does now.
+ *
+ *  Checks that every packet arrives once, in order and intact,
+ *  and that nothing is given up. Before that, in one thread, checks
+ *  that a board restarting its link is heard by the other board, and
+ *  that the packets of a frame given up are handed back.
+ *  Exits 1 on any failed check.
+ *
+ ***************************************************************************/
+
+# include <poll.h>
+# include <pthread.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <sys/socket.h>
+# include <time.h>
+# include <unistd.h>
+
+# include "spectrometer_data.h"
+# include "spi_link.h"
+
+# define HEADER_SIZE 12   //  to, from, type of a data_exchange_packet_t
+
+typedef struct {
+  int       fd;
+  uint32_t  rng;
+  uint64_t  link_us;      //  modelled link time of this board's transfers
+  uint32_t  transfers;
+  uint32_t  lost, flipped;
+  int       drop;         //  lose every transfer
+} Transport_Context_t;
+
+typedef struct {
+  int                   id;
+  SPI_Link_t            link;
+  SPI_Link_Transport_t  transport;
+  Transport_Context_t   tc;
+  uint8_t*              frame[3];
+
+  uint32_t              queued;       //  packets handed to the link
+  uint64_t              queued_bytes; //  their header + data bytes
+  uint32_t              expect;       //  next packet from the other board
+  uint32_t              received, bad_order, bad_payload;
+} Board_t;
+
+static Board_t   board[2];
+static int       packets    = 20000;
+static int       frame_size = 9216;
+static int       records    = 255;
+static int       spectra    = 10;     //  percent of packets spectrum sized
+static int       loss       = 0;      //  per mille of transfers
+static int       flips      = 0;      //  per mille of transfers
+static int       handshake  = 5000;   //  us per transfer
+static int       byte_ns    = 10000;  //  ns per byte
+static int volatile idle[2];
+
+static uint32_t next_random ( uint32_t* s ) {
+  *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5;
+  return *s;
+}
+
+static uint16_t packet_size ( int from, uint32_t n ) {
+  uint32_t h = ( n + 1 ) * 2654435761u ^ ( from * 40503u );
+  return h % 100 < (uint32_t)spectra ? sizeof(Spectrometer_Data_t) : 8 + h % 17;
+}
+
+static uint8_t packet_byte ( int from, uint32_t n, int i ) {
+  return (uint8_t)( n * 31 + i * 7 + from * 101 + ( i >> 8 ) );
+}
+
+static void put32 ( uint8_t* p, uint32_t v ) { memcpy ( p, &v, 4 ); }
+static uint32_t get32 ( uint8_t const* p ) { uint32_t v; memcpy ( &v, p, 4 ); return v; }
+
+static int write_all ( int fd, uint8_t const* p, size_t n ) {
+  while ( n ) {
+    ssize_t w = write ( fd, p, n );
+    if ( w <= 0 ) return -1;
+    p += w; n -= w;
+  }
+  return 0;
+}
+
+static int read_all ( int fd, uint8_t* p, size_t n ) {
+  while ( n ) {
+    ssize_t r = read ( fd, p, n );
+    if ( r <= 0 ) return -1;
+    p += r; n -= r;
+  }
+  return 0;
+}
+
+//  Transport: a 2 byte size, then the frame, as SPI_tx_packet() sends it
+static int32_t loop_send ( void* context, uint8_t* frame, uint16_t size ) {
+
+  Transport_Context_t* tc = context;
+  uint8_t buf[ 2 + 0x8000 ];
+
+  tc->transfers++;
+  tc->link_us += handshake + ( (uint64_t)size + 2 ) * byte_ns / 1000;
+
+  if ( tc->drop || (int)( next_random ( &tc->rng ) % 1000 ) < loss ) {
+    tc->lost++;
+    return size;   //  the other board dropped out after the bytes were clocked
+  }
+
+  buf[0] = size >> 8;
+  buf[1] = size;
+  memcpy ( buf+2, frame, size );
+
+  if ( (int)( next_random ( &tc->rng ) % 1000 ) < flips ) {
+    uint32_t bit = next_random ( &tc->rng ) % ( size * 8 );
+    buf[ 2 + bit/8 ] ^= 1 << ( bit%8 );
+    tc->flipped++;
+  }
+
+  return write_all ( tc->fd, buf, 2 + size ) ? -1 : size;
+}
+
+static int32_t loop_receive ( void* context, uint8_t* frame, uint16_t max_size ) {
+
+  Transport_Context_t* tc = context;
+  struct pollfd pfd = { tc->fd, POLLIN, 0 };
+
+  //  Other board passive
+  if ( poll ( &pfd, 1, 0 ) <= 0 ) return 0;
+
+  uint8_t s[2];
+  if ( read_all ( tc->fd, s, 2 ) ) return -1;
+  uint16_t size = ( s[0] << 8 ) | s[1];
+
+  if ( size > max_size ) {
+    uint8_t sink[256];
+    while ( size ) {
+      uint16_t n = size < sizeof(sink) ? size : sizeof(sink);
+      if ( read_all ( tc->fd, sink, n ) ) return -1;
+      size -= n;
+    }
+    return -6;
+  }
+  if ( read_all ( tc->fd, frame, size ) ) return -1;
+  return size;
+}
+
+static void deliver ( void* context, uint8_t* header, uint16_t header_size, uint8_t* data, uint16_t data_size ) {
+
+  Board_t* b = context;
+  int const from = !b->id;
+  uint32_t n = get32 ( header );
+  int i;
+
+  if ( header_size != HEADER_SIZE || n != b->expect || get32 ( header+4 ) != (uint32_t)from ) {
+    b->bad_order++;
+  }
+  b->expect = n + 1;
+
+  if ( data_size != packet_size ( from, n ) || get32 ( header+8 ) != data_size ) {
+    b->bad_payload++;
+  } else {
+    for ( i=0; i<data_size; i++ ) {
+      if ( data[i] != packet_byte ( from, n, i ) ) { b->bad_payload++; break; }
+    }
+  }
+  b->received++;
+}
+
+static void count_record ( void* context, uint8_t* header, uint16_t header_size, uint8_t* data, uint16_t data_size ) {
+  ( *(int*)context )++;
+}
+
+//  One board sends, the other acknowledges, in turn
+static void pump ( Board_t* from, Board_t* to, int* delivered, int rounds ) {
+  while ( rounds-- ) {
+    spi_link_flush   ( &from->link );
+    spi_link_receive ( &to->link, count_record, delivered );
+    spi_link_flush   ( &to->link );
+    spi_link_receive ( &from->link, 0, 0 );
+  }
+}
+
+//  Board 0 restarts its link after a frame went through, then loses
+//  every frame until one is given up. Returns 1 on a failed check.
+static int check_restart_and_give_up ( void ) {
+
+  static uint8_t header[HEADER_SIZE], data[8];
+  Board_t b[2];
+  int sv[2], k, f;
+  int delivered = 0, given_up = 0, fail = 0;
+  int const faults[2] = { loss, flips };
+
+  //  Deterministic, the fault injection is for the threaded test
+  loss = flips = 0;
+
+  if ( socketpair ( AF_UNIX, SOCK_STREAM, 0, sv ) ) return 1;
+
+  memset ( b, 0, sizeof(b) );
+  for ( k=0; k<2; k++ ) {
+    b[k].id      = k;
+    b[k].tc.fd   = sv[k];
+    b[k].transport.context = &b[k].tc;
+    b[k].transport.send    = loop_send;
+    b[k].transport.receive = loop_receive;
+    for ( f=0; f<3; f++ ) b[k].frame[f] = malloc ( 1024 );
+    spi_link_init ( &b[k].link, b[k].frame, 1024, 1024, 8, &b[k].transport );
+  }
+
+  spi_link_queue ( &b[0].link, header, HEADER_SIZE, data, sizeof(data) );
+  pump ( &b[0], &b[1], &delivered, 4 );
+  fail |= delivered != 1;
+
+  //  Restarted, its next data frame has the sequence number of the last one
+  spi_link_init  ( &b[0].link, b[0].frame, 1024, 1024, 8, &b[0].transport );
+  spi_link_queue ( &b[0].link, header, HEADER_SIZE, data, sizeof(data) );
+  pump ( &b[0], &b[1], &delivered, 4 );
+  fail |= delivered != 2 || b[1].link.stats.duplicates || b[1].link.stats.gaps;
+
+  spi_link_on_given_up ( &b[0].link, count_record, &given_up );
+  b[0].tc.drop = 1;
+  spi_link_queue ( &b[0].link, header, HEADER_SIZE, data, sizeof(data) );
+  spi_link_queue ( &b[0].link, header, HEADER_SIZE, data, sizeof(data) );
+  pump ( &b[0], &b[1], &delivered, SPI_LINK_RETRY_POLLS * SPI_LINK_MAX_SENDS + 2 );
+  fail |= given_up != 2 || b[0].link.stats.given_up != 1 || !spi_link_idle ( &b[0].link );
+
+  printf ( "restart,delivered,%d,syncs,%u,duplicates,%u,gaps,%u\n", delivered,
+           b[1].link.stats.syncs, b[1].link.stats.duplicates, b[1].link.stats.gaps );
+  printf ( "give_up,records_returned,%d,given_up,%u%s\n", given_up, b[0].link.stats.given_up, fail ? ",FAIL" : "" );
+
+  for ( k=0; k<2; k++ ) {
+    for ( f=0; f<3; f++ ) free ( b[k].frame[f] );
+    close ( sv[k] );
+  }
+  loss  = faults[0];
+  flips = faults[1];
+  return fail;
+}
+
+static void* board_task ( void* arg ) {
+
+  Board_t* b = arg;
+  static __thread uint8_t data[ sizeof(Spectrometer_Data_t) ];
+
+  while ( !( idle[0] && idle[1] ) ) {
+
+    int busy = 0;
+
+    //  Service the other board first, as the data exchange task does
+    if ( spi_link_receive ( &b->link, deliver, b ) != 0 ) busy = 1;
+
+    //  Queue what the tasks on this board sent, until the frame is full
+    while ( b->queued < (uint32_t)packets ) {
+      uint8_t  header[HEADER_SIZE];
+      uint16_t size = packet_size ( b->id, b->queued );
+      int i;
+      put32 ( header,   b->queued );
+      put32 ( header+4, b->id     );
+      put32 ( header+8, size      );
+      for ( i=0; i<size; i++ ) data[i] = packet_byte ( b->id, b->queued, i );
+      if ( spi_link_queue ( &b->link, header, HEADER_SIZE, data, size ) != SPI_LINK_OK ) break;
+      b->queued++;
+      b->queued_bytes += HEADER_SIZE + size;
+    }
+
+    if ( spi_link_flush ( &b->link ) != 0 ) busy = 1;
+
+    idle[b->id] = b->queued == (uint32_t)packets && spi_link_idle ( &b->link );
+
+    if ( !busy ) {
+      struct timespec ts = { 0, 100000 };
+      nanosleep ( &ts, 0 );
+    }
+  }
+  return 0;
+}
+
+static void print_usage ( char const* pn ) {
+  printf ( "Host loopback test of the framed board to board link\n" );
+  printf ( "Usage: %s [-h -? -nN -fF -rR -sS -lL -bB -HH -BB]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -nN     Packets sent by each board [default: 20000]\n" );
+  printf ( "       -fF     Frame size, bytes [default: 9216]\n" );
+  printf ( "       -rR     Records per frame, 1..255 [default: 255]\n" );
+  printf ( "       -sS     Percent of packets spectrum sized [default: 10]\n" );
+  printf ( "       -lL     Frames lost, per mille [default: 0]\n" );
+  printf ( "       -bB     Frames with a flipped bit, per mille [default: 0]\n" );
+  printf ( "       -HH     Modelled handshake per transfer, us [default: 5000]\n" );
+  printf ( "       -BB     Modelled time per byte, ns [default: 10000]\n" );
+}
+
+int main ( int argc, char** argv ) {
+
+  int opt;
+  while ( ( opt = getopt ( argc, argv, "h?n:f:r:s:l:b:H:B:" ) ) != -1 ) {
+    switch ( opt ) {
+    case 'n': packets    = atoi ( optarg ); break;
+    case 'f': frame_size = atoi ( optarg ); break;
+    case 'r': records    = atoi ( optarg ); break;
+    case 's': spectra    = atoi ( optarg ); break;
+    case 'l': loss       = atoi ( optarg ); break;
+    case 'b': flips      = atoi ( optarg ); break;
+    case 'H': handshake  = atoi ( optarg ); break;
+    case 'B': byte_ns    = atoi ( optarg ); break;
+    default : print_usage ( argv[0] ); return 0;
+    }
+  }
+
+  int fail = check_restart_and_give_up ();
+
+  int sv[2];
+  if ( socketpair ( AF_UNIX, SOCK_STREAM, 0, sv ) ) {
+    fprintf ( stderr, "Cannot create socket pair\n" );
+    return 1;
+  }
+
+  int k;
+  for ( k=0; k<2; k++ ) {
+    Board_t* b = &board[k];
+    int f;
+    b->id     = k;
+    b->tc.fd  = sv[k];
+    b->tc.rng = 0x9E3779B9u + k;
+    b->transport.context = &b->tc;
+    b->transport.send    = loop_send;
+    b->transport.receive = loop_receive;
+    for ( f=0; f<3; f++ ) b->frame[f] = malloc ( frame_size > 0 ? frame_size : 1 );
+    if ( packets < 1 || records > 255 || records < 1
+      || spi_link_init ( &b->link, b->frame, frame_size, frame_size, records, &b->transport ) ) {
+      print_usage ( argv[0] );
+      return 1;
+    }
+    if ( spi_link_data_max ( &b->link, HEADER_SIZE ) < sizeof(Spectrometer_Data_t) ) {
+      fprintf ( stderr, "Frame of %d bytes cannot hold a spectrum\n", frame_size );
+      return 1;
+    }
+  }
+
+  struct timespec t0, t1;
+  clock_gettime ( CLOCK_MONOTONIC, &t0 );
+
+  pthread_t t[2];
+  for ( k=0; k<2; k++ ) pthread_create ( &t[k], 0, board_task, &board[k] );
+  for ( k=0; k<2; k++ ) pthread_join ( t[k], 0 );
+
+  clock_gettime ( CLOCK_MONOTONIC, &t1 );
+  double wall = ( t1.tv_sec - t0.tv_sec ) + ( t1.tv_nsec - t0.tv_nsec ) * 1e-9;
+
+  //  One handshake per packet, two size bytes, header and data
+  double per_packet_s = 0, framed_s = 0;
+  uint32_t transfers = 0;
+
+  printf ( "board,received,bad_order,bad_payload,frames_sent,records_sent,acks_sent,resent,given_up,send_failed,bad_frames,duplicates,gaps,lost,flipped\n" );
+  for ( k=0; k<2; k++ ) {
+    Board_t* b = &board[k];
+    SPI_Link_Stats_t* s = &b->link.stats;
+    printf ( "%d,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", k, b->received, b->bad_order, b->bad_payload,
+             s->frames_sent, s->records_sent, s->acks_sent, s->resent, s->given_up, s->send_failed,
+             s->bad_frames, s->duplicates, s->gaps, b->tc.lost, b->tc.flipped );
+
+    per_packet_s += ( (double)packets * handshake + ( b->queued_bytes + 2.0*packets ) * byte_ns / 1000 ) * 1e-6;
+    framed_s     += b->tc.link_us * 1e-6;
+    transfers    += b->tc.transfers;
+
+    fail |= b->received != (uint32_t)packets || b->bad_order || b->bad_payload
+         || s->given_up || s->gaps || s->records_sent != (uint32_t)packets;
+    fail |= !loss && !flips && s->bad_frames;
+  }
+
+  printf ( "scheme,transfers,link_s,packets_per_s,wall_s\n" );
+  printf ( "per_packet,%d,%.1f,%.1f,\n", 2*packets, per_packet_s, 2*packets / per_packet_s );
+  printf ( "framed,%u,%.1f,%.1f,%.2f%s\n", transfers, framed_s, 2*packets / framed_s, wall, fail ? ",FAIL" : "" );
+
+  for ( k=0; k<2; k++ ) {
+    int f;
+    for ( f=0; f<3; f++ ) free ( board[k].frame[f] );
+    close ( sv[k] );
+  }
+  return fail;
+}
@@ -148,6 +148,21 @@ typedef struct Packet {
 
 } Profile_Data_Packet_t;
 
+//  Bursts are framed in ASCII ("BRST", see ProfileManager/profile_receive.c),
+//  with packet data ASCII85 encoded, unless the float and the receiver agree
+//  on binary framing after the float called ("MODE"): packet data as they are,
+//    "BRSB", hynv, profile, packet, burst, value   (16 bit each, big endian)
+//  then value bytes of data (none for burst 0 and the terminating burst),
+//  then the CRC32 of all in front of it (32 bit, big endian).
+//  A probe burst of all 256 byte values confirms the path is 8 bit clean.
+//
+# define BRST_MODE_BINARY 1        //  modes offered and granted, bit mask
+# define BRSB_HEADER      14
+# define BRSB_TRAILER      4
+# define BRSB_END     0xFFFF       //  burst number of the terminating burst
+# define BRSB_PROBE   0xFFFE       //  burst number of the probe, data 255, 254, ... 0
+# define BRSB_MAX_DATA  9999       //  as with ASCII framing
+
 
 # endif // _PROFILE_PACKET_SHARED_H_
 
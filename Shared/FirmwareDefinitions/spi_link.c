@@ -0,0 +1,344 @@
+/*! \file spi_link.c ***********************************************************
+ *
+ * \brief Framed, pipelined packet link between the two boards
+ *
+ *  See spi_link.h for the frame layout. Used by the data exchange task
+ *  of either board; plain C, no FreeRTOS calls, so that both board-side
+ *  state machines can also run on a host over a socket pair.
+ *
+ ***************************************************************************/
+
+# include "spi_link.h"
+
+# include <string.h>
+
+//  CRC-16/CCITT, polynomial 0x1021, initial 0xFFFF, a nibble at a time
+static uint16_t const crc_nibble[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint16_t spi_link_crc ( uint8_t const* p, uint16_t n ) {
+
+  uint16_t crc = 0xFFFF;
+  while ( n-- ) {
+    crc = ( crc << 4 ) ^ crc_nibble[ ( crc >> 12 ) ^ ( *p   >> 4 ) ];
+    crc = ( crc << 4 ) ^ crc_nibble[ ( crc >> 12 ) ^ ( *p++ & 15 ) ];
+  }
+  return crc;
+}
+
+static void put16 ( uint8_t* p, uint16_t v ) {
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+static uint16_t get16 ( uint8_t const* p ) {
+  return ( (uint16_t)p[0] << 8 ) | p[1];
+}
+
+//  Fill in the frame header and trailer, with the current acknowledgement
+static uint16_t spi_link_seal ( SPI_Link_t* link, uint8_t* frame, uint8_t flags, uint8_t seq, uint8_t count, uint16_t length ) {
+
+  if ( link->rx_seq   ) flags |= SPI_LINK_F_ACK;
+  if ( link->nak_owed ) flags |= SPI_LINK_F_NAK;
+
+  put16 ( frame, SPI_LINK_MAGIC );
+  frame[2] = flags;
+  frame[3] = seq;
+  frame[4] = link->rx_seq;
+  frame[5] = count;
+  put16 ( frame+6, length );
+  put16 ( frame+SPI_LINK_HEAD+length, spi_link_crc ( frame, SPI_LINK_HEAD+length ) );
+
+  return SPI_LINK_HEAD + length + SPI_LINK_TAIL;
+}
+
+static int32_t spi_link_send ( SPI_Link_t* link, uint8_t* frame, uint16_t size ) {
+
+  int32_t r = link->transport->send ( link->transport->context, frame, size );
+
+  if ( r < 0 ) {
+    link->stats.send_failed++;
+  } else {
+    //  Whatever was owed went out with this frame
+    link->ack_owed = 0;
+    link->nak_owed = 0;
+  }
+  return r;
+}
+
+int16_t spi_link_init ( SPI_Link_t* link, uint8_t* frame[3], uint16_t frame_size, uint16_t rx_size, uint8_t records_max, SPI_Link_Transport_t const* transport ) {
+
+  if ( !link || !frame || !transport || !transport->send || !transport->receive
+    || frame_size < SPI_LINK_HEAD + SPI_LINK_RECORD + SPI_LINK_TAIL
+    || frame_size >= 0x8000   //  SPI transfer size limit
+    || rx_size    < SPI_LINK_HEAD + SPI_LINK_RECORD + SPI_LINK_TAIL
+    || rx_size    >= 0x8000
+    || records_max < 1 ) {
+    return SPI_LINK_FAIL;
+  }
+
+  memset ( link, 0, sizeof(SPI_Link_t) );
+
+  link->transport   = transport;
+  link->tx[0]       = frame[0];
+  link->tx[1]       = frame[1];
+  link->rx          = frame[2];
+  link->frame_size  = frame_size;
+  link->rx_size     = rx_size;
+  link->records_max = records_max;
+  link->next_seq    = 1;
+  link->sync_owed   = 1;
+
+  return SPI_LINK_OK;
+}
+
+void spi_link_on_given_up ( SPI_Link_t* link, SPI_Link_Deliver_t given_up, void* context ) {
+  link->given_up         = given_up;
+  link->given_up_context = context;
+}
+
+uint16_t spi_link_data_max ( SPI_Link_t const* link, uint16_t header_size ) {
+
+  uint16_t const room = link->frame_size - SPI_LINK_HEAD - SPI_LINK_TAIL - SPI_LINK_RECORD;
+  return header_size < room ? room - header_size : 0;
+}
+
+int16_t spi_link_queue ( SPI_Link_t* link, uint8_t const* header, uint16_t header_size, uint8_t const* data, uint16_t data_size ) {
+
+  uint32_t const need = (uint32_t)SPI_LINK_RECORD + header_size + data_size;
+  uint32_t const room = link->frame_size - SPI_LINK_HEAD - SPI_LINK_TAIL;
+
+  if ( need > room ) {
+    return SPI_LINK_FAIL;
+  }
+
+  if ( link->fill_count >= link->records_max
+    || link->fill_length + need > room ) {
+    return SPI_LINK_FULL;
+  }
+
+  uint8_t* p = link->tx[link->fill] + SPI_LINK_HEAD + link->fill_length;
+
+  put16 ( p,   header_size );
+  put16 ( p+2, data_size   );
+  p += SPI_LINK_RECORD;
+  if ( header_size ) memcpy ( p, header, header_size );
+  p += header_size;
+  if ( data_size   ) memcpy ( p, data,   data_size   );
+
+  link->fill_length += need;
+  link->fill_count++;
+
+  return SPI_LINK_OK;
+}
+
+//  Hand the records of a frame to deliver, each checked against the frame length.
+//  Returns the records handed, *rest the bytes left over.
+static int32_t spi_link_records ( uint8_t* frame, SPI_Link_Deliver_t deliver, void* context, int32_t* rest ) {
+
+  uint8_t const count = frame[5];
+  uint8_t* p   = frame + SPI_LINK_HEAD;
+  uint8_t* end = p + get16 ( frame+6 );
+  int32_t  delivered = 0;
+
+  while ( delivered < count && p + SPI_LINK_RECORD <= end ) {
+
+    uint16_t const header_size = get16 ( p   );
+    uint16_t const data_size   = get16 ( p+2 );
+    p += SPI_LINK_RECORD;
+
+    if ( header_size + data_size > end - p ) {
+      break;
+    }
+    if ( deliver ) {
+      deliver ( context, p, header_size, p+header_size, data_size );
+    }
+    p += header_size + data_size;
+    delivered++;
+  }
+
+  *rest = end - p;
+  return delivered;
+}
+
+//  Make the frame not being filled the one on the link
+static void spi_link_put_out ( SPI_Link_t* link, uint8_t flags ) {
+
+  link->out_seq    = link->next_seq;
+  link->next_seq   = link->next_seq == 255 ? 1 : link->next_seq+1;
+  link->out_flags  = flags;
+  link->out        = 1;
+  link->out_sent   = 0;
+  link->out_polls  = 0;
+  link->out_resend = 1;   //  until the transport took it
+}
+
+//  Send the frame on the link, first time or again
+static int32_t spi_link_send_out ( SPI_Link_t* link ) {
+
+  uint8_t* frame = link->tx[!link->fill];
+  uint16_t size  = spi_link_seal ( link, frame, link->out_flags, link->out_seq, frame[5], get16 ( frame+6 ) );
+  int32_t  r     = spi_link_send ( link, frame, size );
+
+  if ( r < 0 ) {
+    return r;
+  }
+
+  if ( link->out_sent ) {
+    link->stats.resent++;
+  } else {
+    link->stats.frames_sent++;
+    link->stats.records_sent += frame[5];
+  }
+  link->out_sent++;
+  link->out_polls  = 0;
+  link->out_resend = 0;
+  return 1;
+}
+
+int32_t spi_link_flush ( SPI_Link_t* link ) {
+
+  //  The frame on the link: wait for its acknowledgement,
+  //  send it again, or give up on it
+  if ( link->out ) {
+
+    if ( !link->out_resend && ++link->out_polls >= SPI_LINK_RETRY_POLLS ) {
+      link->out_resend = 1;
+    }
+
+    if ( link->out_resend ) {
+      if ( link->out_sent < SPI_LINK_MAX_SENDS ) {
+        return spi_link_send_out ( link );
+      }
+      link->stats.given_up++;
+      link->out = 0;
+      if ( link->given_up ) {
+        int32_t rest;
+        spi_link_records ( link->tx[!link->fill], link->given_up, link->given_up_context, &rest );
+      }
+    }
+  }
+
+  //  The other board does not know this sequence yet: an empty SYNC frame
+  //  goes out first, from the buffer not being filled
+  if ( !link->out && link->fill_count && link->sync_owed ) {
+
+    uint8_t* frame = link->tx[!link->fill];
+    frame[5] = 0;
+    put16 ( frame+6, 0 );
+
+    spi_link_put_out ( link, SPI_LINK_F_DATA | SPI_LINK_F_SYNC );
+    return spi_link_send_out ( link );
+  }
+
+  //  The link is free: the frame being filled goes out,
+  //  and the other buffer takes the next packets
+  if ( !link->out && link->fill_count ) {
+
+    uint8_t* frame = link->tx[link->fill];
+    frame[5] = link->fill_count;
+    put16 ( frame+6, link->fill_length );
+
+    link->fill        ^= 1;
+    link->fill_length  = 0;
+    link->fill_count   = 0;
+
+    spi_link_put_out ( link, SPI_LINK_F_DATA );
+    return spi_link_send_out ( link );
+  }
+
+  //  Nothing to send, but the other board waits for an acknowledgement
+  if ( link->ack_owed || link->nak_owed ) {
+
+    uint8_t frame[ SPI_LINK_HEAD + SPI_LINK_TAIL ];
+    uint16_t size = spi_link_seal ( link, frame, 0, 0, 0, 0 );
+    int32_t  r    = spi_link_send ( link, frame, size );
+
+    if ( r < 0 ) {
+      return r;
+    }
+    link->stats.acks_sent++;
+    return 1;
+  }
+
+  return 0;
+}
+
+int32_t spi_link_receive ( SPI_Link_t* link, SPI_Link_Deliver_t deliver, void* context ) {
+
+  uint8_t* frame = link->rx;
+  int32_t  size  = link->transport->receive ( link->transport->context, frame, link->rx_size );
+
+  if ( size <= 0 ) {
+    return size;
+  }
+
+  if ( size < SPI_LINK_HEAD + SPI_LINK_TAIL
+    || get16 ( frame ) != SPI_LINK_MAGIC
+    || SPI_LINK_HEAD + get16 ( frame+6 ) + SPI_LINK_TAIL != size
+    || get16 ( frame+size-SPI_LINK_TAIL ) != spi_link_crc ( frame, size-SPI_LINK_TAIL ) ) {
+    link->stats.bad_frames++;
+    link->nak_owed = 1;
+    return 0;
+  }
+
+  uint8_t const flags  = frame[2];
+  uint8_t const seq    = frame[3];
+  uint8_t const ack    = frame[4];
+  uint8_t const count  = frame[5];
+
+  if ( link->out && link->out_sent ) {
+    if ( ( flags & SPI_LINK_F_ACK ) && ack == link->out_seq ) {
+      if ( link->out_flags & SPI_LINK_F_SYNC ) {
+        link->sync_owed = 0;
+      }
+      link->out = 0;
+    } else if ( flags & SPI_LINK_F_NAK ) {
+      link->out_resend = 1;
+    }
+  }
+
+  if ( !( flags & SPI_LINK_F_DATA ) ) {
+    return 0;
+  }
+
+  link->stats.frames_received++;
+  link->ack_owed = 1;
+
+  if ( flags & SPI_LINK_F_SYNC ) {
+    //  The other board (re)started, its sequence continues from here.
+    //  The frame has no records, so taking it again does no harm.
+    link->stats.syncs++;
+    link->rx_seq = seq;
+    return 0;
+  }
+  if ( seq == link->rx_seq ) {
+    //  Our acknowledgement was lost, the other board sent it again
+    link->stats.duplicates++;
+    return 0;
+  }
+  if ( link->rx_seq && seq != ( link->rx_seq == 255 ? 1 : link->rx_seq+1 ) ) {
+    link->stats.gaps++;
+  }
+  link->rx_seq = seq;
+
+  int32_t rest;
+  int32_t delivered = spi_link_records ( frame, deliver, context, &rest );
+
+  link->stats.records_received += delivered;
+  if ( delivered != count || rest ) {
+    link->stats.bad_frames++;
+  }
+
+  return delivered;
+}
+
+uint8_t spi_link_filling ( SPI_Link_t const* link ) {
+  return link->fill_count;
+}
+
+int16_t spi_link_idle ( SPI_Link_t const* link ) {
+  return !link->out && !link->fill_count;
+}
@@ -0,0 +1,164 @@
+/*! \file spi_link.h ***********************************************************
+ *
+ * \brief Framed, pipelined packet link between the two boards
+ *
+ *  Several data exchange packets (header + data) are packed into one frame,
+ *  which crosses the SPI in a single SPI_tx_packet() / SPI_rx_packet() call,
+ *  so the ready-line handshake and sync string are paid once per frame
+ *  instead of once per packet.
+ *
+ *  Frame layout, all multi-byte fields big endian:
+ *
+ *    0  U16  SPI_LINK_MAGIC
+ *    2  U8   flags        SPI_LINK_F_*
+ *    3  U8   seq          1..255, 0 in an acknowledgement-only frame
+ *    4  U8   ack          last data frame received from the other board, 0 if none
+ *    5  U8   count        number of records
+ *    6  U16  length       bytes of records
+ *    8       records      U16 header_size, U16 data_size, header bytes, data bytes
+ *    8+length U16 crc     CRC-16/CCITT of all preceding bytes
+ *
+ *  Two transmit frames are used alternately: one is on the link, waiting
+ *  for the other board to acknowledge it, while the next one is being
+ *  filled. A frame is retransmitted when the other board reports a bad
+ *  frame (NAK) or no acknowledgement arrived in time. Duplicates are
+ *  dropped by sequence number. A frame sent SPI_LINK_MAX_SENDS times
+ *  without acknowledgement is given up, and its records are handed back
+ *  to the caller (spi_link_on_given_up()).
+ *
+ *  The first data frame after spi_link_init() is an empty SYNC frame.
+ *  The other board takes its sequence number as is, so that a board which
+ *  restarted at sequence 1 is not mistaken for a duplicate or a gap.
+ *
+ *  The board provides the transport (spi.controller.c, spi.spectrometer.c),
+ *  the host tests a socket pair.
+ *
+ ***************************************************************************/
+
+# ifndef   _SPI_LINK_H_
+# define   _SPI_LINK_H_
+
+# include <stdint.h>
+
+# define SPI_LINK_MAGIC     0x5A4C
+
+# define SPI_LINK_HEAD      8
+# define SPI_LINK_TAIL      2
+# define SPI_LINK_RECORD    4   //  header_size, data_size
+
+# define SPI_LINK_F_DATA    0x01  //  carries records, has a sequence number
+# define SPI_LINK_F_ACK     0x02  //  the ack field is valid
+# define SPI_LINK_F_NAK     0x04  //  the last frame received was bad, send again
+# define SPI_LINK_F_SYNC    0x08  //  no records, restart the sequence at seq
+
+//  Flush calls without acknowledgement before a frame is sent again,
+//  and the number of times it is sent before it is given up
+# ifndef SPI_LINK_RETRY_POLLS
+#  define SPI_LINK_RETRY_POLLS  20
+# endif
+# ifndef SPI_LINK_MAX_SENDS
+#  define SPI_LINK_MAX_SENDS    8
+# endif
+
+//  Return codes
+# define SPI_LINK_OK         0
+# define SPI_LINK_FULL       1    //  the frame being filled has no room, flush first
+# define SPI_LINK_FAIL     (-1)   //  bad argument, or the record can never fit a frame
+
+//  Board to board transfer of one frame.
+//  send():    0 or positive when the other board took all bytes, negative otherwise
+//  receive(): 0 when the other board has nothing to send,
+//             the frame size when a frame was received, negative on failure
+typedef struct {
+  void*   context;
+  int32_t (*send)    ( void* context, uint8_t* frame, uint16_t size );
+  int32_t (*receive) ( void* context, uint8_t* frame, uint16_t max_size );
+} SPI_Link_Transport_t;
+
+//  Receives the records of a good frame, in order
+typedef void (*SPI_Link_Deliver_t) ( void* context, uint8_t* header, uint16_t header_size,
+                                                    uint8_t* data,   uint16_t data_size );
+
+typedef struct {
+  uint32_t frames_sent;
+  uint32_t records_sent;
+  uint32_t acks_sent;       //  acknowledgement-only frames
+  uint32_t resent;          //  frames sent again
+  uint32_t given_up;        //  frames dropped after SPI_LINK_MAX_SENDS
+  uint32_t send_failed;     //  transport failures, frame kept
+  uint32_t frames_received;
+  uint32_t records_received;
+  uint32_t bad_frames;      //  size, magic, length or crc
+  uint32_t duplicates;
+  uint32_t gaps;            //  sequence numbers skipped by the other board
+  uint32_t syncs;           //  SYNC frames received
+} SPI_Link_Stats_t;
+
+typedef struct {
+
+  SPI_Link_Transport_t const* transport;
+
+  uint8_t*  tx[2];          //  frame on the link / frame being filled
+  uint8_t*  rx;
+  uint16_t  frame_size;     //  of the transmit frames
+  uint16_t  rx_size;        //  of the receive frame, the other board's frame_size
+  uint8_t   records_max;
+
+  uint8_t   fill;           //  index of the frame being filled
+  uint16_t  fill_length;    //  bytes of records in it
+  uint8_t   fill_count;
+
+  uint8_t   out;            //  the other frame is on the link (sent or to be sent)
+  uint8_t   out_seq;
+  uint8_t   out_sent;       //  times sent
+  uint16_t  out_polls;      //  flush calls since it was last sent
+  uint8_t   out_resend;     //  send again at the next flush
+  uint8_t   out_flags;      //  SPI_LINK_F_DATA, and SPI_LINK_F_SYNC for the SYNC frame
+  uint8_t   sync_owed;      //  the other board has not acknowledged a SYNC frame yet
+
+  uint8_t   next_seq;
+  uint8_t   rx_seq;         //  last data frame received, 0 if none
+  uint8_t   ack_owed;
+  uint8_t   nak_owed;
+
+  SPI_Link_Deliver_t given_up;  //  receives the records of a frame given up
+  void*     given_up_context;
+
+  SPI_Link_Stats_t stats;
+
+} SPI_Link_t;
+
+//! \brief  Set up a link on caller provided frame buffers
+//! @param  frame       Two transmit buffers of frame_size bytes, and one receive buffer of rx_size bytes.
+//!                     The sizes differ when the boards send packets of different sizes.
+//! @param  records_max Records per frame, 1..255
+//! @return SPI_LINK_OK or SPI_LINK_FAIL
+int16_t spi_link_init ( SPI_Link_t* link, uint8_t* frame[3], uint16_t frame_size, uint16_t rx_size, uint8_t records_max, SPI_Link_Transport_t const* transport );
+
+//! \brief  Have the records of a frame that is given up handed back, in order,
+//!         so that the caller can send them again or release what they refer to.
+//!         Call after spi_link_init(), which clears it.
+void spi_link_on_given_up ( SPI_Link_t* link, SPI_Link_Deliver_t given_up, void* context );
+
+//! \brief  Add a packet to the frame being filled
+//! @return SPI_LINK_OK, SPI_LINK_FULL (flush and try again) or SPI_LINK_FAIL
+int16_t spi_link_queue ( SPI_Link_t* link, uint8_t const* header, uint16_t header_size, uint8_t const* data, uint16_t data_size );
+
+//! \brief  Largest data_size that fits an empty frame with the given header
+uint16_t spi_link_data_max ( SPI_Link_t const* link, uint16_t header_size );
+
+//! \brief  Send what is due: a frame again, the next frame, or an acknowledgement
+//! @return 1 if a frame was sent, 0 if nothing was due, negative transport failure
+int32_t spi_link_flush ( SPI_Link_t* link );
+
+//! \brief  Receive one frame if the other board has one, and deliver its records
+//! @return Records delivered, 0 if none, negative transport failure
+int32_t spi_link_receive ( SPI_Link_t* link, SPI_Link_Deliver_t deliver, void* context );
+
+//! \brief  Records in the frame being filled
+uint8_t spi_link_filling ( SPI_Link_t const* link );
+
+//! \brief  Nothing left to send and nothing waiting for acknowledgement
+int16_t spi_link_idle ( SPI_Link_t const* link );
+
+# endif /* _SPI_LINK_H_ */
@@ -365,6 +365,12 @@
 #define SPEC1_RDY__INT2				AVR32_PIN_PA23
 // SPI, spectrometer board #1 ready, interrupt line
 #define SPEC1_RDY__INT2_LINE		EXT_INT2
+// SPI, spectrometer board #1 ready, interrupt line pin function
+#define SPEC1_RDY__INT2_PIN_FUNCTION	AVR32_EIC_EXTINT_2_FUNCTION
+// SPI, spectrometer board #1 ready, IRQ line
+#define SPEC1_RDY__INT2_IRQ			AVR32_EIC_IRQ_2
+// SPI, spectrometer board #1 ready, interrupt priority
+#define SPEC1_RDY__INT2_PRIO		AVR32_INTC_INT0
 // SPI, spectrometer board #2 ready
 #define SPEC2_RDY__INT7				AVR32_PIN_PA13
 // SPI, spectrometer board #2 ready, interrupt line
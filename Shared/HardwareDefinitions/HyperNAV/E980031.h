@@ -449,6 +449,10 @@
 #define ADC_CNVST_IRQ							AVR32_EIC_IRQ_2
 #define ADC_CNVST_PRIO							AVR32_INTC_INTLEVEL_INT3	//high priority interrupt
 
+// Controller board ready, GPIO pin change interrupt (no EIC line on this pin)
+#define CTRL_RDY_IRQ							(AVR32_GPIO_IRQ_0 + CTRL_RDY/8)
+#define CTRL_RDY_PRIO							AVR32_INTC_INTLEVEL_INT0
+
 // ADC BUSY interrupt line
 #define ADC_BUSY_INT_LINE						AVR32_EIC_NMI
 #define ADC_BUSY_PIN_FUNCTION					AVR32_EIC_EXTINT_0_2_FUNCTION
@@ -0,0 +1,13 @@
+/*! \file FreeRTOS.h (host build) ***********************************************
+ *
+ * \brief Stand-in for the FreeRTOS header included by sn74v283.c.
+ *
+  ***************************************************************************/
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+typedef unsigned long portTickType;
+
+#define TASK_DELAY_MS(x)	(x)
+
+#endif
@@ -0,0 +1,27 @@
+/*! \file board.h (host build) **************************************************
+ *
+ * \brief Pins and types of the board header used by sn74v283.c,
+ *        for building the FIFO readout against the FIFO mock.
+ *
+  ***************************************************************************/
+#ifndef _BOARD_H_
+#define _BOARD_H_
+
+#include <stdint.h>
+
+typedef uint16_t	U16;
+
+#define FIFO_A_RESETN	1
+#define FIFO_A_EMPTYN	2
+#define FIFO_A_HFN	3
+#define FIFO_A_FULLN	4
+#define FIFO_B_RESETN	11
+#define FIFO_B_EMPTYN	12
+#define FIFO_B_HFN	13
+#define FIFO_B_FULLN	14
+
+#define AVR32_EBI_NCS_2	20
+#define AVR32_EBI_NCS_3	21
+#define AVR32_EBI_NRD	22
+
+#endif /* _BOARD_H_ */
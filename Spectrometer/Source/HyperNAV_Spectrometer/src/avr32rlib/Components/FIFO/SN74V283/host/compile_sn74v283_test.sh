@@ -0,0 +1,20 @@
+#!/bin/sh
+
+#  Build the host test of the SN74V283 spectrum readout.
+#  sn74v283.c is compiled unchanged; this folder provides the FIFO mock
+#  (data ports and flag/reset pins) and stand-ins for the board,
+#  GPIO and FreeRTOS headers.
+#
+#  Usage:  sh compile_sn74v283_test.sh
+#          ./sn74v283_test
+
+gcc \
+     -O2 -Wall \
+     -o sn74v283_test \
+     -I . \
+     -I .. \
+     -I ../../.. \
+     -I ../../../../../../../../../Shared/FirmwareDefinitions \
+     ../sn74v283.c \
+     sn74v283_mock.c \
+     sn74v283_test.c
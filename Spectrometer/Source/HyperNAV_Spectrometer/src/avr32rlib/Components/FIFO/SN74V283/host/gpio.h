@@ -0,0 +1,21 @@
+/*! \file gpio.h (host build) ***************************************************
+ *
+ * \brief GPIO calls of sn74v283.c, served by the FIFO mock:
+ *        the reset pins clear a mock FIFO, the flag pins report its fill.
+ *
+  ***************************************************************************/
+#ifndef _GPIO_H_
+#define _GPIO_H_
+
+#define GPIO_DIR_INPUT	0x00
+#define GPIO_DIR_OUTPUT	0x01
+#define GPIO_INIT_LOW	0x00
+#define GPIO_INIT_HIGH	0x02
+
+void gpio_configure_pin(uint32_t pin, uint32_t flags);
+void gpio_enable_gpio_pin(uint32_t pin);
+void gpio_set_pin_high(uint32_t pin);
+void gpio_set_pin_low(uint32_t pin);
+int  gpio_pin_is_low(uint32_t pin);
+
+#endif /* _GPIO_H_ */
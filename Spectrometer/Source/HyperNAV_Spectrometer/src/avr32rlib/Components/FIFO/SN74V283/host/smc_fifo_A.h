@@ -0,0 +1,13 @@
+/*! \file smc_fifo_A.h (host build) **********************************************
+ *
+ * \brief FIFO A data port, read through the FIFO mock.
+ *
+  ***************************************************************************/
+#ifndef SMC_FIFO_A_H_
+#define SMC_FIFO_A_H_
+
+#include "sn74v283_mock.h"
+
+#define FIFO_DATA_A	(&sn74v283_mock_port[0])
+
+#endif /* SMC_FIFO_A_H_ */
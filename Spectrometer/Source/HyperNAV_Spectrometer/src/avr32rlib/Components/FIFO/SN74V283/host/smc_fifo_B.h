@@ -0,0 +1,13 @@
+/*! \file smc_fifo_B.h (host build) **********************************************
+ *
+ * \brief FIFO B data port, read through the FIFO mock.
+ *
+  ***************************************************************************/
+#ifndef SMC_FIFO_B_H_
+#define SMC_FIFO_B_H_
+
+#include "sn74v283_mock.h"
+
+#define FIFO_DATA_B	(&sn74v283_mock_port[1])
+
+#endif /* SMC_FIFO_B_H_ */
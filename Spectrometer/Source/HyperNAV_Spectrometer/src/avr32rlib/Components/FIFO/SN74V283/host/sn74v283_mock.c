@@ -0,0 +1,85 @@
+/*! \file sn74v283_mock.c (host build) *******************************************
+ *
+ * \brief Two SN74V283 FIFOs in memory, and the GPIO pins reporting them.
+ *
+  ***************************************************************************/
+
+#include <string.h>
+
+#include "board.h"
+#include "gpio.h"
+#include "sn74v283_mock.h"
+
+uint16_t volatile	sn74v283_mock_port[2];
+sn74v283_mock_t		sn74v283_mock[2];
+
+
+uint16_t sn74v283_mock_pop(uint16_t volatile* port)
+{
+	sn74v283_mock_t* f = &sn74v283_mock[port - sn74v283_mock_port];
+
+	if(!f->count)
+	{
+		f->empty_reads++;
+		return 0;
+	}
+
+	uint16_t w = f->word[f->head];
+	f->head = (f->head + 1) % SN74V283_MOCK_DEPTH;
+	f->count--;
+	f->reads++;
+	return w;
+}
+
+
+void sn74v283_mock_write(int fifo, uint16_t word)
+{
+	sn74v283_mock_t* f = &sn74v283_mock[fifo];
+
+	if(f->count == SN74V283_MOCK_DEPTH)
+	{
+		f->dropped++;
+		return;
+	}
+
+	f->word[(f->head + f->count) % SN74V283_MOCK_DEPTH] = word;
+	f->count++;
+}
+
+
+void sn74v283_mock_clear(int fifo)
+{
+	memset(&sn74v283_mock[fifo], 0, sizeof(sn74v283_mock_t));
+}
+
+
+//*****************************************************************************
+// GPIO
+//*****************************************************************************
+void gpio_configure_pin(uint32_t pin, uint32_t flags)	{ (void)pin; (void)flags; }
+void gpio_enable_gpio_pin(uint32_t pin)			{ (void)pin; }
+void gpio_set_pin_high(uint32_t pin)			{ (void)pin; }
+
+void gpio_set_pin_low(uint32_t pin)
+{
+	// Master reset
+	if(pin == FIFO_A_RESETN || pin == FIFO_B_RESETN)
+	{
+		sn74v283_mock_t* f = &sn74v283_mock[pin == FIFO_B_RESETN];
+		f->head = f->count = 0;
+		f->resets++;
+	}
+}
+
+int gpio_pin_is_low(uint32_t pin)
+{
+	sn74v283_mock_t* f = &sn74v283_mock[pin > 10];
+
+	switch(pin)
+	{
+	case FIFO_A_EMPTYN: case FIFO_B_EMPTYN:	return f->count == 0;
+	case FIFO_A_HFN:    case FIFO_B_HFN:	return f->count > SN74V283_MOCK_DEPTH/2;
+	case FIFO_A_FULLN:  case FIFO_B_FULLN:	return f->count == SN74V283_MOCK_DEPTH;
+	default:				return 0;
+	}
+}
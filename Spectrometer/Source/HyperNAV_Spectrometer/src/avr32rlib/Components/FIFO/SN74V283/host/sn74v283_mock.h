@@ -0,0 +1,36 @@
+/*! \file sn74v283_mock.h (host build) *******************************************
+ *
+ * \brief Two SN74V283 FIFOs in memory.
+ *
+ *  The test writes words as the ADC would; each read of a data port
+ *  pops one word (reads of an empty FIFO return 0 and are counted).
+ *  Taking a reset pin low clears the FIFO.
+ *
+  ***************************************************************************/
+#ifndef SN74V283_MOCK_H_
+#define SN74V283_MOCK_H_
+
+#include <stdint.h>
+
+#define SN74V283_MOCK_DEPTH	65536
+
+typedef struct {
+	uint16_t	word[SN74V283_MOCK_DEPTH];
+	uint32_t	head;
+	uint32_t	count;
+	unsigned long	reads;		// words popped
+	unsigned long	empty_reads;	// reads of an empty FIFO
+	unsigned long	dropped;	// words written to a full FIFO
+	unsigned long	resets;
+} sn74v283_mock_t;
+
+extern uint16_t volatile	sn74v283_mock_port[2];
+extern sn74v283_mock_t		sn74v283_mock[2];
+
+uint16_t sn74v283_mock_pop(uint16_t volatile* port);
+void     sn74v283_mock_write(int fifo, uint16_t word);
+void     sn74v283_mock_clear(int fifo);
+
+#define SN74V283_POP(port)	sn74v283_mock_pop(port)
+
+#endif /* SN74V283_MOCK_H_ */
@@ -0,0 +1,186 @@
+/*! \file sn74v283_test.c **********************************************************
+ *
+ * \brief Host test of the SN74V283 spectrum readout over the FIFO mock.
+ *
+ * Fills the mock FIFOs the way the ADC and the EOS interrupts do
+ * (cleared spectra, the acquired spectrum, spurious words beyond it)
+ * and checks what the readout copies, discards and counts,
+ * in one step and in steps of various budgets.
+ *
+ * Exits 1 on the first failed check.
+ *
+ **********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sn74v283.h"
+#include "sn74v283_mock.h"
+
+#define WORDS	(N_SPEC_PIX + 21)	// N_SPEC_MARGINS of data_acquisition.c
+
+static int checks, failed;
+
+#define CHECK(cond)	do { checks++; if(!(cond)) { failed++; fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); } } while(0)
+
+
+// Word i of spectrum s as it leaves the ADC
+static uint16_t word_of(int s, int i)
+{
+	return (uint16_t)(s*4099 + i*7 + 1);
+}
+
+static void write_spectrum(int fifo, int s)
+{
+	int i;
+	for(i=0; i<WORDS; i++)
+		sn74v283_mock_write(fifo, word_of(s, i));
+}
+
+// Fill a FIFO: nClear cleared spectra, one acquired, nOver spurious words
+static void fill(component_selection_t which, int nClear, int nOver)
+{
+	int fifo = (which == component_B);
+	int c;
+
+	SN74V283_Start(which);
+	sn74v283_mock_clear(fifo);
+
+	for(c=0; c<nClear; c++)
+	{
+		write_spectrum(fifo, 100+c);
+		SN74V283_ReportNewClearout(which);
+	}
+
+	write_spectrum(fifo, 7);
+	SN74V283_AddedSpectrum(which, (Spec_Aux_Data_t*)0);
+
+	for(c=0; c<nOver; c++)
+		sn74v283_mock_write(fifo, 0xDEAD);
+}
+
+// The spectrum is stored last word first
+static int spectrum_ok(uint16_t const* dest)
+{
+	int i;
+	for(i=0; i<WORDS; i++)
+		if(dest[WORDS-1-i] != word_of(7, i))
+			return 0;
+	return 1;
+}
+
+static void test_one_shot(component_selection_t which, int nClear, int nOver)
+{
+	sn74v283_mock_t* f = &sn74v283_mock[which == component_B];
+	static uint16_t dest[WORDS+2];
+	uint16_t over = 0xFFFF;
+
+	fill(which, nClear, nOver);
+	memset(dest, 0, sizeof(dest));
+	dest[WORDS] = dest[WORDS+1] = 0x5A5A;
+
+	CHECK(SN74V283_ReadoutSpectrum(which, dest, WORDS, &over) == SN74V283_OK);
+	CHECK(spectrum_ok(dest));
+	CHECK(dest[WORDS] == 0x5A5A && dest[WORDS+1] == 0x5A5A);
+
+	int expectOver = nOver < SN74V283_MAX_OVER ? nOver : SN74V283_MAX_OVER;
+	CHECK(over == expectOver);
+	CHECK(f->reads == (unsigned long)((nClear+1)*WORDS + expectOver));
+	CHECK(f->empty_reads == 0);
+	CHECK(f->count == (uint32_t)(nOver - expectOver));
+
+	// Start resets the FIFO and drains what the reset leaves
+	unsigned long resets = f->resets;
+	sn74v283_mock_write(which == component_B, 0x1234);
+	SN74V283_Start(which);
+	CHECK(f->resets == resets+1);
+	CHECK(f->count == 0);
+	CHECK(SN74V283_GetNumOfCleared(which) == 0);
+	CHECK(SN74V283_GetNumOfSpectra(which) == 0);
+}
+
+static void test_steps(component_selection_t which, int nClear, int nOver, int32_t budget)
+{
+	sn74v283_mock_t* f = &sn74v283_mock[which == component_B];
+	static uint16_t dest[WORDS];
+	SN74V283_Readout_t rd;
+	int steps = 0, rv;
+
+	fill(which, nClear, nOver);
+	memset(dest, 0, sizeof(dest));
+
+	CHECK(SN74V283_ReadoutStart(&rd, which, dest, WORDS) == SN74V283_OK);
+	CHECK(rd.cleared == nClear);
+	CHECK(f->reads == 0);
+
+	unsigned long before = 0;
+	while((rv = SN74V283_ReadoutStep(&rd, budget)) == 1)
+	{
+		// Never more than the budget per step
+		CHECK(f->reads - before <= (unsigned long)budget);
+		before = f->reads;
+		if(++steps > 1000000) break;
+	}
+
+	int expectOver = nOver < SN74V283_MAX_OVER ? nOver : SN74V283_MAX_OVER;
+	CHECK(rv == 0);
+	CHECK(rd.phase == SN74V283_RD_Done);
+	CHECK(rd.over == expectOver);
+	CHECK(spectrum_ok(dest));
+	CHECK(f->reads == (unsigned long)((nClear+1)*WORDS + expectOver));
+
+	// A finished readout stays finished
+	CHECK(SN74V283_ReadoutStep(&rd, budget) == 0);
+	CHECK(f->reads == (unsigned long)((nClear+1)*WORDS + expectOver));
+}
+
+int main(void)
+{
+	static uint16_t dest[WORDS];
+	SN74V283_Readout_t rd;
+	int nClear, nOver;
+	int32_t const budget[] = { 1, 7, 8, 64, 1000, WORDS, 3*WORDS };
+	unsigned int b;
+
+	SN74V283_InitGpio();
+
+	for(nClear=0; nClear<=3; nClear++)
+	{
+		int const overs[] = { 0, 1, 10, SN74V283_MAX_OVER, SN74V283_MAX_OVER+1, 150 };
+		unsigned int o;
+		for(o=0; o<sizeof(overs)/sizeof(overs[0]); o++)
+		{
+			nOver = overs[o];
+			test_one_shot(component_A, nClear, nOver);
+			test_one_shot(component_B, nClear, nOver);
+			for(b=0; b<sizeof(budget)/sizeof(budget[0]); b++)
+				test_steps(o&1 ? component_B : component_A, nClear, nOver, budget[b]);
+		}
+	}
+
+	// The two FIFOs do not interfere
+	fill(component_A, 1, 3);
+	fill(component_B, 0, 5);
+	uint16_t over = 0;
+	CHECK(SN74V283_ReadoutSpectrum(component_B, dest, WORDS, &over) == SN74V283_OK && over == 5);
+	CHECK(sn74v283_mock[0].count == 2u*WORDS + 3);
+	CHECK(SN74V283_ReadoutSpectrum(component_A, dest, WORDS, &over) == SN74V283_OK && over == 3);
+	CHECK(spectrum_ok(dest));
+
+	// A FIFO short of the spectrum: the readout does not wait on it
+	fill(component_A, 0, 0);
+	sn74v283_mock[0].count -= 100;
+	CHECK(SN74V283_ReadoutSpectrum(component_A, dest, WORDS, &over) == SN74V283_OK);
+	CHECK(over == 0);
+	CHECK(sn74v283_mock[0].empty_reads == 100);
+
+	// Bad readouts
+	CHECK(SN74V283_ReadoutStart(&rd, component_A, dest, 0) == SN74V283_FAIL);
+	CHECK(SN74V283_ReadoutStep(&rd, 0) == SN74V283_FAIL);
+	CHECK(SN74V283_ReadoutStart(&rd, (component_selection_t)2, dest, WORDS) == SN74V283_FAIL);
+	CHECK(SN74V283_ReadoutSpectrum((component_selection_t)2, dest, WORDS, &over) == SN74V283_FAIL);
+
+	printf("%d checks, %d failed\n", checks, failed);
+	return failed ? 1 : 0;
+}
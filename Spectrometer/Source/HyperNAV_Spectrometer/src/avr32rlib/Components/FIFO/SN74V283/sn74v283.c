@@ -41,6 +41,84 @@ static uint16_t sn74v283_start[2] = { 0, 0 };
 static uint16_t sn74v283_count[2] = { 0, 0 };
 static Spec_Aux_Data_t sn74v283_aux[2][SN74V283_MAX];
 
+//  Each read of the chip select region pops one word off the FIFO.
+//  The host test of the readout supplies its own SN74V283_POP.
+//
+# ifndef SN74V283_POP
+# define SN74V283_POP(port) (*(port))
+# endif
+
+static U16 volatile* sn74v283_port (component_selection_t which)
+{
+  switch  (which)
+  {
+  case component_A:  return FIFO_DATA_A;
+  case component_B:  return FIFO_DATA_B;
+  default:           return 0;
+  }
+}
+
+//  Discard n words.
+//  The port is volatile, so that none of the reads is optimized away.
+//
+static void sn74v283_sink (U16 volatile* port, uint32_t n)
+{
+  while  (n >= 8)
+  {
+    (void)SN74V283_POP(port); (void)SN74V283_POP(port);
+    (void)SN74V283_POP(port); (void)SN74V283_POP(port);
+    (void)SN74V283_POP(port); (void)SN74V283_POP(port);
+    (void)SN74V283_POP(port); (void)SN74V283_POP(port);
+    n -= 8;
+  }
+  while  (n--)
+  {
+    (void)SN74V283_POP(port);
+  }
+}
+
+//  Copy n words, storing downwards from dst.
+//  Returns where the next word goes.
+//
+static uint16_t* sn74v283_copy_down (U16 volatile* port, uint16_t* dst, uint32_t n)
+{
+  while  (n >= 8)
+  {
+    dst[ 0] = SN74V283_POP(port);
+    dst[-1] = SN74V283_POP(port);
+    dst[-2] = SN74V283_POP(port);
+    dst[-3] = SN74V283_POP(port);
+    dst[-4] = SN74V283_POP(port);
+    dst[-5] = SN74V283_POP(port);
+    dst[-6] = SN74V283_POP(port);
+    dst[-7] = SN74V283_POP(port);
+    dst -= 8;
+    n   -= 8;
+  }
+  while  (n--)
+  {
+    *dst-- = SN74V283_POP(port);
+  }
+  return dst;
+}
+
+//  Empty the FIFO after a master reset.
+//  Reading an empty FIFO does not change it,
+//  so the empty flag is only checked between blocks.
+//
+static void sn74v283_flush (component_selection_t which)
+{
+  U16 volatile* port = sn74v283_port (which);
+  uint32_t n = 32;
+
+  sn74v283_sink (port, 32);
+  while  (n < 32768  &&  !SN74V283_IsEmpty (which))
+  {
+    sn74v283_sink (port, 32);
+    n += 32;
+  }
+}
+
 int16_t SN74V283_InitGpio ()
 {
   //  The sn74v283 FIFOs each have a total of 80 pins.
@@ -211,18 +289,7 @@ int16_t SN74V283_Start (component_selection_t which)
        sn74v283_start  [0] = 0;
        sn74v283_count  [0] = 0;
 
-       {
-         int rot = 32;
-         int cnt = 0;
-         int zro = 0;
-         do
-         {
-           U16 v = FIFO_DATA_A[0];
-           if (v) cnt++; else zro++;
-           rot--;
-         }
-         while ( rot  ||  (cnt < 32768  &&  !SN74V283_IsEmpty (component_A) ) );
-       }
+       sn74v283_flush (component_A);
 
        break;
 
@@ -236,16 +303,7 @@ int16_t SN74V283_Start (component_selection_t which)
                     sn74v283_start  [1] = 0;
                     sn74v283_count  [1] = 0;
 
-                    {
-                    int rot = 32;
-                    int cnt = 0;
-                    int zro = 0;
-                    do {
-                      U16 v = FIFO_DATA_B[0];
-                      if (v) cnt++; else zro++;
-                      rot--;
-                    } while ( rot || ( cnt<32768 && !SN74V283_IsEmpty(component_B) ) );
-                    }
+                    sn74v283_flush (component_B);
 
                     break;
   default:          //  Code design should make it impossible to get here.
@@ -404,7 +462,8 @@ void SN74V283_AddedSpectrum ( component_selection_t which, Spec_Aux_Data_t *aux
     if  (sn74v283_count[0] < SN74V283_MAX)
     {
       int addIdx = ( sn74v283_count[0]+sn74v283_start[0] ) % SN74V283_MAX;
-      memcpy (&(sn74v283_aux[0][addIdx]), aux, sizeof (Spec_Aux_Data_t) );
+      if  (aux)
+        memcpy (&(sn74v283_aux[0][addIdx]), aux, sizeof (Spec_Aux_Data_t) );
       sn74v283_count  [0] ++;
       sn74v283_spectra[0] ++;
     }
@@ -414,7 +473,8 @@ void SN74V283_AddedSpectrum ( component_selection_t which, Spec_Aux_Data_t *aux
     if  (sn74v283_count[1] < SN74V283_MAX)
     {
       int addIdx = (sn74v283_count[1] + sn74v283_start[1] ) % SN74V283_MAX;
-      memcpy (&(sn74v283_aux[1][addIdx]), aux, sizeof (Spec_Aux_Data_t));
+      if  (aux)
+        memcpy (&(sn74v283_aux[1][addIdx]), aux, sizeof (Spec_Aux_Data_t));
       sn74v283_count  [1] ++;
       sn74v283_spectra[1] ++;
     }
@@ -483,6 +543,117 @@ uint16_t SN74V283_GetNumOfCleared (component_selection_t  which)
 
 
 
+int16_t SN74V283_ReadoutStart (SN74V283_Readout_t*   rd,
+                               component_selection_t which,
+                               uint16_t              destination[],
+                               uint32_t              words
+                              )
+{
+  if  (!sn74v283_port (which)  ||  words == 0)
+  {
+    rd->phase = SN74V283_RD_Idle;
+    return SN74V283_FAIL;
+  }
+
+  rd->which       = which;
+  rd->destination = destination + words - 1;
+  rd->words       = words;
+  rd->cleared     = SN74V283_GetNumOfCleared (which);
+  rd->over        = 0;
+  rd->phase       = SN74V283_RD_Clear;
+  rd->left        = rd->cleared * words;
+
+  return SN74V283_OK;
+}
+
+
+
+int16_t SN74V283_ReadoutStep (SN74V283_Readout_t* rd, int32_t budget)
+{
+  U16 volatile* port = sn74v283_port (rd->which);
+  uint32_t quota = (budget > 0) ? (uint32_t)budget : 0xFFFFFFFF;
+
+  if  (!port  ||  rd->phase == SN74V283_RD_Idle)
+  {
+    return SN74V283_FAIL;
+  }
+
+  while  (quota  &&  rd->phase != SN74V283_RD_Done)
+  {
+    uint32_t n = (rd->left < quota) ? rd->left : quota;
+
+    switch  (rd->phase)
+    {
+    case SN74V283_RD_Clear:
+      sn74v283_sink (port, n);
+      rd->left -= n;
+      quota    -= n;
+      if  (rd->left == 0)
+      {
+        rd->phase = SN74V283_RD_Spectrum;
+        rd->left  = rd->words;
+      }
+      break;
+
+    case SN74V283_RD_Spectrum:
+      rd->destination = sn74v283_copy_down (port, rd->destination, n);
+      rd->left -= n;
+      quota    -= n;
+      if  (rd->left == 0)
+      {
+        rd->phase = SN74V283_RD_Overflow;
+      }
+      break;
+
+    case SN74V283_RD_Overflow:
+      //  The overflow is counted, and shifts the pixels of the
+      //  spectrum, so check the empty flag for each word.
+      if  (rd->over < SN74V283_MAX_OVER  &&  !SN74V283_IsEmpty (rd->which))
+      {
+        sn74v283_sink (port, 1);
+        rd->over++;
+        quota--;
+      }
+      else
+      {
+        rd->phase = SN74V283_RD_Done;
+      }
+      break;
+
+    default:
+      return SN74V283_FAIL;
+    }
+  }
+
+  return  (rd->phase == SN74V283_RD_Done) ? 0 : 1;
+}
+
+
+
+int16_t SN74V283_ReadoutSpectrum (component_selection_t which,
+                                  uint16_t              destination[],
+                                  uint32_t              words,
+                                  uint16_t*             over
+                                 )
+{
+  SN74V283_Readout_t rd;
+
+  if  (SN74V283_OK != SN74V283_ReadoutStart (&rd, which, destination, words)
+   ||  0           != SN74V283_ReadoutStep  (&rd, 0))
+  {
+    return SN74V283_FAIL;
+  }
+
+  if  (over)
+  {
+    *over = rd.over;
+  }
+
+  return SN74V283_OK;
+}
+
+
+
 # if 0
 int16_t SN74V283_ReadSpectrum (component_selection_t which, 
                                uint16_t              sram_destination[],
@@ -67,6 +67,49 @@ uint16_t SN74V283_GetNumOfSpectra   ( component_selection_t which );
 void     SN74V283_ReportNewClearout ( component_selection_t which );
 uint16_t SN74V283_GetNumOfCleared   ( component_selection_t which );
 
+//  Readout of one spectrum.
+//
+//  The FIFO holds, in this order, the spectra cleared since the last
+//  Start (discarded), the spectrum (copied), and up to SN74V283_MAX_OVER
+//  spurious words beyond it (discarded, counted in 'over').
+//  The FIFO has no address lines and the PDCA cannot reach the EBI,
+//  so the words are moved by unrolled bus reads, in steps of at most
+//  'budget' words, letting the caller interleave other work.
+//  Discarded words are read into a sink and never stored.
+//
+//  Pixels leave the FIFO last-to-first: destination[words-1] receives
+//  the first word of the spectrum, destination[0] the last.
+//
+# define SN74V283_MAX_OVER 99
+
+typedef enum {
+  SN74V283_RD_Idle,
+  SN74V283_RD_Clear,
+  SN74V283_RD_Spectrum,
+  SN74V283_RD_Overflow,
+  SN74V283_RD_Done
+} SN74V283_ReadPhase_t;
+
+typedef struct {
+  component_selection_t which;
+  SN74V283_ReadPhase_t  phase;
+  uint16_t* destination; //  where the next spectrum word goes
+  uint32_t  words;       //  words per spectrum
+  uint32_t  left;        //  words left in the current phase
+  uint16_t  cleared;     //  cleared spectra discarded
+  uint16_t  over;        //  overflow words discarded
+} SN74V283_Readout_t;
+
+//  Prepare a readout; nothing is read yet.
+int16_t SN74V283_ReadoutStart ( SN74V283_Readout_t* rd, component_selection_t which, uint16_t destination[], uint32_t words );
+
+//  Move up to budget words (budget <= 0: to completion).
+//  Returns 1 while words are left, 0 when done, SN74V283_FAIL on a bad readout.
+int16_t SN74V283_ReadoutStep  ( SN74V283_Readout_t* rd, int32_t budget );
+
+//  Start and run a readout to completion, report the overflow words.
+int16_t SN74V283_ReadoutSpectrum ( component_selection_t which, uint16_t destination[], uint32_t words, uint16_t* over );
+
 //  Read spectrum from FIFO.
 //  !!! Must have enabled reading before calling this function  !!!
 //  !!! Must select the proper chip for the shared parallel bus !!!
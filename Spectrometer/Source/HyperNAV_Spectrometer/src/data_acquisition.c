@@ -51,6 +51,8 @@
 # include "FlashMemory.h"
 
 # include "SunPosition.h"
+# include "spectrum_stats.h"
+# include "package_ring.h"
 
 //*****************************************************************************
 // Settings
@@ -81,14 +83,59 @@ typedef union
 
 # define NumSpectrometers 2  //  Spectrometer 0 == A == PORT      == LEFT
                              //  Spectrometer 1 == B == STARBOARD == RIGHT
-# define NumADP 4
+//  Acquired spectra are handed to the data exchange task through a ring
+//  of packages, oldest first. The first DAQ_ADP_RAM packages are in RAM,
+//  the others in SRAM, where a slow consumer lets the spectra pile up.
+//  Two in RAM: the heap also holds the frames of the board to board link.
+# define DAQ_ADP_RAM  2
+# define DAQ_ADP_SRAM SRAM_DAQ_SLOTS
+# define NumADP ( DAQ_ADP_RAM + DAQ_ADP_SRAM )
 static data_exchange_data_package_t acquired_data_package[NumADP] = { {0, 0, 0} };
+static Package_Ring_t adp_ring;
+
+//  Spectra for SRAM packages are assembled here, then copied over
+static Spectrometer_Data_t adp_staging;
 
 # define UVDARKS 0   //  While shutters not operational
 
 //*****************************************************************************
 // Local Functions
 //*****************************************************************************
+
+//  Give the packages the consumer has emptied back to the ring (oldest first),
+//  then claim the next one. Returns -1 when all packages are in use.
+//  The data exchange task flags a package empty without its mutex,
+//  after its last access to the data (data_package_emptied()).
+static int adp_claim ( void ) {
+
+  int adp;
+  while ( ( adp = package_ring_oldest ( &adp_ring ) ) >= 0 ) {
+    data_exchange_data_state_t const state = *(data_exchange_data_state_t volatile*)&acquired_data_package[adp].state;
+    if ( state != EmptyRAM && state != EmptySRAM ) break;
+    package_ring_release ( &adp_ring );
+  }
+
+  return package_ring_claim ( &adp_ring );
+}
+
+//  Where to assemble the spectrum of a claimed package
+static Spectrometer_Data_t* adp_buffer ( int adp ) {
+  return ( adp < DAQ_ADP_RAM ) ? (Spectrometer_Data_t*)acquired_data_package[adp].address : &adp_staging;
+}
+
+//  Mark a claimed package full and hand it over.
+//  A package claimed but not published is claimed again next time.
+static void adp_publish ( int adp ) {
+
+  if ( adp < DAQ_ADP_RAM ) {
+    acquired_data_package[adp].state = FullRAM;
+  } else {
+    copy_to_sram_from_ram ( acquired_data_package[adp].address, (uint8_t const*)&adp_staging, sizeof(Spectrometer_Data_t) );
+    acquired_data_package[adp].state = FullSRAM;
+  }
+
+  package_ring_publish ( &adp_ring );
+}
 //static Bool parseAndTimeStamp(U8 port, char* header, U16 expectedFrameLen,  U16 *foundFrameLen);
 //static void timevalToSatlanticTimestamp(const struct timeval* timeval, U8* SatlanticTimestamp);
 //static U8 createPyrometerFrame(char* frame, U16 max_len, pyro_msg_t* pyrometer);
@@ -487,6 +534,7 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
   _static_ U16                  dark_max [NumSpectrometers];
   _static_ U16                  lght_min [NumSpectrometers];
   _static_ U16                  lght_max [NumSpectrometers];
+  _static_ U16                 lmd_shift [NumSpectrometers];
   _static_ int         lights_after_dark [NumSpectrometers];
 
   int firstSpec = 1;
@@ -1149,6 +1197,12 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
 
         simulate_pressure_profile = false;
 
+        //  How close the package ring came to refusing spectra
+        //
+        io_out_S32 ( "ADP %ld", (S32)adp_ring.high_water );
+        io_out_S32 ( "/%ld",    (S32)adp_ring.depth );
+        io_out_S32 ( " refused %ld\r\n", (S32)adp_ring.refused );
+
         data_exchange_packet_t packet_message;
         packet_message.to   = DE_Addr_ProfileManager;
         packet_message.from = myAddress;
@@ -1185,26 +1239,11 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
         {
           io_out_S32( "x%ld", FlashMemory_nOfFrames() );
 
-          int adp; int use_adp = -1;
-
-          for ( adp=0; adp<NumADP && use_adp==-1; adp++ )
-          {
-            if ( pdTRUE == xSemaphoreTake ( acquired_data_package[adp].mutex, 250 /*portMAX_DELAY*/ /*15*/ ) )
-            {
-              if ( acquired_data_package[adp].state == EmptyRAM )
-              {
-                use_adp = adp;
-              }
-              else
-              {
-                xSemaphoreGive ( acquired_data_package[adp].mutex );
-              }
-            }
-          }
+          int use_adp = adp_claim ();
 
           if ( use_adp >= 0 )
           {
-            Spectrometer_Data_t* local_data_pointer = (Spectrometer_Data_t*)acquired_data_package[use_adp].address;
+            Spectrometer_Data_t* local_data_pointer = adp_buffer ( use_adp );
             FlashMemory_RetrieveFrame ( local_data_pointer );
 
             data_exchange_packet_t SDATA_packet;
@@ -1221,15 +1260,13 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
             // }
                    
             SDATA_packet.type = DE_Type_Spectrometer_Data;
-            acquired_data_package[use_adp].state = FullRAM;
+            adp_publish ( use_adp );
 
             SDATA_packet.data.DataPackagePointer = &acquired_data_package[use_adp];
 
             //  Send packet to destination, will go onto a queue, managed by another thread
             //
             data_exchange_packet_router ( myAddress, &SDATA_packet );
-
-            xSemaphoreGive ( acquired_data_package[use_adp].mutex );
           }
 	      }
       }
@@ -1436,13 +1473,11 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
 
           component_selection_t componentID;
           spec_num_t                 SpecID;
-          U16*                         fifo;
 
           switch ( spectrometer )
           {
-            //                                                          ((U16*)AVR32_EBI_CS2_ADDRESS)
-            case  0: SpecID = SPEC_A; componentID = component_A; fifo = FIFO_DATA_A; break;
-            case  1: SpecID = SPEC_B; componentID = component_B; fifo = FIFO_DATA_B; break;
+            case  0: SpecID = SPEC_A; componentID = component_A; break;
+            case  1: SpecID = SPEC_B; componentID = component_B; break;
             default: break;
           }
 
@@ -1583,61 +1618,27 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
                 //  Spectrometer readouts complete; critical sections in the SPI transfers are permitted again
                 // data_exchange_spectrometer_resumeTask();
 
-                int px;
-
-                uint16_t nClear = SN74V283_GetNumOfCleared (componentID);
-
-                // kurt,  Assuming every refernces to fifo causes a 2 byte data to pop off a queue
-                //  This next loop is to clear out rows of pixel data from fifo.
-                int cc;
-                for  (cc = 0;  cc < nClear;  cc++)
-                {
-                  for  (px = 0;  px < N_SPEC_PIX + N_SPEC_MARGINS;  px++)
-                  {
-                    U16 discard = fifo[0];
-                  }
-                }
-
-                for  (px = N_SPEC_PIX + N_SPEC_MARGINS - 1;  px >= 0;  px--)
-                {
-                  darkSpectrum[spectrometer][px] = fifo[0];
-                }
-
-                // readoutOk[spectrometer] = N_SPEC_PIX;
-
-                dark_fifo_over[ spectrometer ] = 0;
+                //  Skips the spectra cleared since the last start,
+                //  and counts the spurious words beyond this one.
 					      // Burkhard typically see ~10 unaccounted for pixels. Unknown reasons VS 5/17/18
 					      // We are reading all of the pixels we expect to see but the fifo receives more pin triggers than expected
 					      // Need to look into why fifo is triggered to read these extra values, not sure if before or after data acq
-                while  (!SN74V283_IsEmpty ( componentID )  &&  dark_fifo_over [ spectrometer ] < 99)
-                {
-                  U16 discard = fifo[0];
-                  dark_fifo_over [spectrometer]++;
-                }
+                SN74V283_ReadoutSpectrum ( componentID, darkSpectrum[spectrometer], N_SPEC_PIX + N_SPEC_MARGINS,
+                                           &dark_fifo_over[spectrometer] );
 
                 SN74V283_Start(componentID);
 
                 {
-                  U32 d_avg = 0;
 # if UVDARKS
+                  int px;
+                  U32 d_avg = 0;
                   for ( px=spec_fifo_over[spectrometer]+N_SPEC_SKIP; px<64; px++ ) {
                     d_avg += darkSpectrum[spectrometer][px];
                   }
                   d_avg /= 64;
-# else
-                  for (px = 10 - dark_fifo_over[spectrometer];
-                       px < 10 - dark_fifo_over[spectrometer] + N_SPEC_PIX;
-                       px++
-                      )
-                  {
-                    d_avg += darkSpectrum[spectrometer][px];
-                  }
-                  d_avg /= N_SPEC_PIX;
-# endif
                   U32 d_sdv = 0;
                   U32 d_min = 0xFFFF;
                   U32 d_max = 0;
-# if UVDARKS
                   for ( px=0; px<64; px++ ) {
                     S32 val  = darkSpectrum[spectrometer][px];
                     if ( d_max < val ) d_max = val;
@@ -1647,19 +1648,16 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
                     d_sdv += diff*diff;
                   }
                   d_sdv /= 64;
+                  d_sdv  = (d_sdv>0 ) ? ceil(sqrt(d_sdv)) : 0;
 # else
-                  for  (px = 10 - dark_fifo_over[spectrometer];  px < 10 - dark_fifo_over[spectrometer] + N_SPEC_PIX;  px++)
-                  {
-                    S32 val  = darkSpectrum[spectrometer][px];
-                    if ( d_max < val ) d_max = val;
-                    if ( d_min > val ) d_min = val;
-                    S32 diff = val;
-                    diff -= d_avg;
-                    d_sdv += diff*diff;
-                  }
-                  d_sdv /= N_SPEC_PIX;
+                  Spectrum_Stats_t d_stats;
+                  spectrum_stats ( &darkSpectrum[spectrometer][10 - dark_fifo_over[spectrometer]], NULL, N_SPEC_PIX, &d_stats );
+
+                  U32 d_avg = d_stats.avg;
+                  U32 d_sdv = d_stats.sdv;
+                  U32 d_min = d_stats.min;
+                  U32 d_max = d_stats.max;
 # endif
-                  d_sdv  = (d_sdv>0 ) ? ceil(sqrt(d_sdv)) : 0;
 
                   dark_avg[spectrometer] = d_avg;
                   dark_sdv[spectrometer] = d_sdv;
@@ -1994,65 +1992,29 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
                   pressure_time [ 0 /* spectrometer */ ].tv_sec  = last_pressure_time.tv_sec;
                   pressure_time [ 0 /* spectrometer */ ].tv_usec = last_pressure_time.tv_usec;
 
-                  int px;
-
-                  uint16_t nClear = SN74V283_GetNumOfCleared(componentID);
-
-                  int cc;
-                  for  (cc = 0;  cc < nClear;  cc++)
-                  {
-                    for ( px=0; px<N_SPEC_PIX+N_SPEC_MARGINS; px++ )
-                    {
-                      U16 discard = fifo[0];
-                    }
-                  }
-
-                  for ( px=N_SPEC_PIX+N_SPEC_MARGINS-1; px>=0; px-- )
-                  {
-                    lghtSpectrum[spectrometer][px] = fifo[0];
-                  }
-
-                  // readoutOk[spectrometer] = 2048;
-
-                  lght_fifo_over[ spectrometer ] = 0;
-
-                  while ( !SN74V283_IsEmpty ( componentID )
-                       && lght_fifo_over [ spectrometer ] < 99 )
-                  {
-                      U16  discard = fifo[0];
-                      lght_fifo_over [ spectrometer ] ++;
-                  }
+                  //  Skips the spectra cleared since the last start,
+                  //  and counts the spurious words beyond this one.
+                  SN74V283_ReadoutSpectrum ( componentID, lghtSpectrum[spectrometer], N_SPEC_PIX + N_SPEC_MARGINS,
+                                             &lght_fifo_over[spectrometer] );
 
                   SN74V283_Start(componentID);
 
                   {
-                    U32 l_avg = 0;
-                    for ( px=10-lght_fifo_over[spectrometer];
-                          px<10-lght_fifo_over[spectrometer]+N_SPEC_PIX; px++ )
-                    {
-                      l_avg += lghtSpectrum[spectrometer][px];
-                    }
-                    l_avg /= N_SPEC_PIX;
-
-                    U32 l_sdv = 0;
-                    U32 l_min = 0xFFFF;
-                    U32 l_max = 0;
-                    
-                    for ( px = 10 - lght_fifo_over[spectrometer];  
-                          px < 10 - lght_fifo_over[spectrometer] + N_SPEC_PIX;  px++)
-                    {
-                      S32 val  = lghtSpectrum[spectrometer][px];
-                      if ( l_max < val ) l_max = val;
-                      if ( l_min > val ) l_min = val;
-                      S32 diff = val;
-                      diff -= l_avg;
-                      l_sdv += diff*diff;
-                    }
-                    l_sdv /= N_SPEC_PIX;
-                    l_sdv  = (l_sdv>0 ) ? ceil(sqrt(l_sdv)) : 0;
+                    //  The dark of this light is already in place,
+                    //  so the light-minus-dark up-shift comes with the statistics
+                    Spectrum_Stats_t l_stats;
+                    spectrum_stats ( &lghtSpectrum[spectrometer][10 - lght_fifo_over[spectrometer]],
+                                     &darkSpectrum[spectrometer][10 - dark_fifo_over[spectrometer]],
+                                     N_SPEC_PIX, &l_stats );
+
+                    U32 l_avg = l_stats.avg;
+                    U32 l_sdv = l_stats.sdv;
+                    U32 l_min = l_stats.min;
+                    U32 l_max = l_stats.max;
 
                     lght_min[spectrometer] = l_min;
                     lght_max[spectrometer] = l_max;
+                    lmd_shift[spectrometer] = l_stats.up_shift;
 
 # if 0
                     if ( DBG ) {
@@ -2206,28 +2168,13 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
               }
 
               {
-                int adp; int use_adp = -1;
-              
-                for ( adp=0; adp<NumADP && use_adp==-1; adp++ )
-                {
-                  if  ( pdTRUE == xSemaphoreTake ( acquired_data_package[adp].mutex, 250 /*portMAX_DELAY*/ /*15*/ ) )
-                  {
-                    if ( acquired_data_package[adp].state == EmptyRAM)
-                    {
-                      use_adp = adp;
-                    }
-                    else
-                    {
-                      xSemaphoreGive ( acquired_data_package[adp].mutex );
-                    }
-                  }
-                }
+                int use_adp = adp_claim ();
               
                 if  ( use_adp >= 0 )
                 {
                   //char ooo[2]; ooo[0] = '0'+use_adp; ooo[1] = 0;
                   //io_out_string(  ooo );
-                  Spectrometer_Data_t* local_data_pointer = (Spectrometer_Data_t*)acquired_data_package[use_adp].address;
+                  Spectrometer_Data_t* local_data_pointer = adp_buffer ( use_adp );
               
                   local_data_pointer -> aux.tag = 0; // Will be OR-ed with flags further down
               
@@ -2407,27 +2354,14 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
                       //  When transferring Light-minus-Dark,
                       //  must add an up-shift value to ensure
                       //  the difference does not become negative (using unsigned integers!)
-                      uint16_t use_shift = 0;
-                      for ( dpx = 10 - dark_fifo_over[spectrometer], lpx=10-lght_fifo_over[spectrometer];
-                            dpx < 10 - dark_fifo_over[spectrometer] + N_SPEC_PIX;
-                            dpx++, lpx++)
-                      {
-                        if  ( lghtSpectrum[spectrometer][lpx] < darkSpectrum[spectrometer][dpx] )
-                        {
-                          uint16_t shift = darkSpectrum[spectrometer][dpx] - lghtSpectrum[spectrometer][lpx];
-                          if ( shift>use_shift )
-                            use_shift = shift;
-                        }
-                      }
+                      //  The up-shift was found with the light statistics.
+                      uint16_t use_shift = lmd_shift[spectrometer];
                       local_data_pointer -> aux.light_minus_dark_up_shift = use_shift;
 
-                      for  (px=0, dpx=10-dark_fifo_over[spectrometer], lpx=10-lght_fifo_over[spectrometer];
-                            px<N_SPEC_PIX;
-                            px++, dpx++, lpx++ )
-                      {
-                        uint32_t difference = use_shift + lghtSpectrum[spectrometer][lpx]; difference -= darkSpectrum[spectrometer][dpx];
-                        local_data_pointer -> hnv_spectrum[px] = difference;
-                      }
+                      spectrum_light_minus_dark ( &lghtSpectrum[spectrometer][10 - lght_fifo_over[spectrometer]],
+                                                  &darkSpectrum[spectrometer][10 - dark_fifo_over[spectrometer]],
+                                                  use_shift, N_SPEC_PIX,
+                                                  local_data_pointer -> hnv_spectrum );
 
                       local_data_pointer -> aux.spec_min = lght_min[spectrometer];
                       local_data_pointer -> aux.spec_max = lght_max[spectrometer];
@@ -2499,7 +2433,7 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
                     }
                     
                     SDATA_packet.type = DE_Type_Spectrometer_Data;
-                    acquired_data_package[use_adp].state = FullRAM;
+                    adp_publish ( use_adp );
 
                     SDATA_packet.data.DataPackagePointer = &acquired_data_package[use_adp];
 
@@ -2507,8 +2441,6 @@ int const DBG = 0;  //  ALERT: Changing to 1 typically causes watchdog resets !!
                     //
                     data_exchange_packet_router ( myAddress, &SDATA_packet );
 			            }
-
-                  SemaphoreGive ( acquired_data_package[use_adp].mutex );
                 }
               }
 
@@ -2829,8 +2761,13 @@ Bool data_acquisition_createTask(void)
       int adp;
       for ( adp=0; adp<NumADP; adp++) {
         acquired_data_package[adp].mutex = xSemaphoreCreateMutex();
-        acquired_data_package[adp].state = EmptyRAM;
-        acquired_data_package[adp].address = (void*) pvPortMalloc ( sizeof(any_acquired_data_t) );
+        if ( adp < DAQ_ADP_RAM ) {
+          acquired_data_package[adp].state = EmptyRAM;
+          acquired_data_package[adp].address = (void*) pvPortMalloc ( sizeof(any_acquired_data_t) );
+        } else {
+          acquired_data_package[adp].state = EmptySRAM;
+          acquired_data_package[adp].address = (void*) sram_DAQ ( adp - DAQ_ADP_RAM );
+        }
 
         if ( NULL == acquired_data_package[adp].mutex
           || NULL == acquired_data_package[adp].address ) {
@@ -2849,15 +2786,17 @@ Bool data_acquisition_createTask(void)
             vQueueDelete(acquired_data_package[adp].mutex);
             acquired_data_package[adp].mutex = NULL;
           }
-          if ( acquired_data_package[adp].address ) {
+          if ( acquired_data_package[adp].address && adp < DAQ_ADP_RAM ) {
             vPortFree ( acquired_data_package[adp].address );
-            acquired_data_package[adp].address = NULL;
           }
+          acquired_data_package[adp].address = NULL;
         }
 
         break;  //  To return FALSE
       }
 
+      package_ring_init ( &adp_ring, NumADP );
+
       res = true;
       gTaskCreated = true;
 
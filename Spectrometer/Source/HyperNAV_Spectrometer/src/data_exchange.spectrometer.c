@@ -24,8 +24,10 @@
 # include "config_data.h"
 # include "profile_packet.shared.h"
 # include "spi.spectrometer.h"
+# include "spi_link.h"
 
 # include "sram_memory_map.spectrometer.h"
+# include "package_ring.h"
 
 # include "io_funcs.spectrometer.h"
 # include "gplp_trace.spectrometer.h"
@@ -48,6 +50,10 @@ static xSemaphoreHandle gTaskCtrlMutex = NULL;
 # define N_RX_PACKETS 16
 static xQueueHandle rxPackets = NULL;
 
+//  Given when a packet is pushed, and by the interrupt on the other board's
+//  ready line, so that the task can sleep on it alone
+static xSemaphoreHandle wakeSemaphore = NULL;
+
 typedef union {
   Spectrometer_Data_t          Spectrometer_Data;
   OCR_Data_t                            OCR_Data;
@@ -64,6 +70,220 @@ static data_exchange_data_package_t local_data_package[N_DA_POINTERS] = { { 0 }
 // Local Functions
 //*****************************************************************************
 
+//  Flag a full package empty, once done with its data.
+//  The data acquisition task takes its packages back by this flag alone,
+//  without the mutex (see adp_claim()), so every access to the data
+//  must be ordered in front of the change.
+//
+static void data_package_emptied ( data_exchange_data_package_t* package ) {
+
+  PACKAGE_RING_BARRIER();
+
+  if ( package->state == FullRAM ) {
+    package->state = EmptyRAM;
+  } else if ( package->state == FullSRAM ) {
+    package->state = EmptySRAM;
+  }
+}
+
+//  Board to board link, see data_exchange_packet.h
+//  All frames in RAM, allocated with the task
+static SPI_Link_t board_link;
+
+static SPI_Link_Transport_t const link_transport = { 0, SPI_link_send, SPI_link_receive };
+
+typedef char link_spectrum_fits_frame[ ( SPI_LINK_HEAD + SPI_LINK_RECORD + DE_LINK_HEADER_SIZE
+                                        + sizeof(Spectrometer_Data_t) + SPI_LINK_TAIL <= DE_LINK_SPEC_FRAME ) ? 1 : -1 ];
+
+//! Size of the value or package data of a packet
+//! @param      type            Packet type
+//! @param      usePointer      Set to 1 if the data is in a data package
+//! @return                     Data size in bytes
+static uint16_t link_data_size( data_exchange_type_t type, int* usePointer ) {
+
+  *usePointer = 0;
+
+  switch ( type ) {
+
+  case DE_Type_Nothing:              return 0;
+
+  case DE_Type_Ping:                 return sizeof(((data_exchange_packet_t*)0)->data.Ping_Message);
+  case DE_Type_Command:              return sizeof(data_exchange_command_t);
+  case DE_Type_Response:             return sizeof(data_exchange_respond_t);
+  case DE_Type_Syslog_Message:       return sizeof(data_exchange_syslog_t);
+
+  case DE_Type_Configuration_Data:   *usePointer = 1; return sizeof(        Config_Data_t);
+  case DE_Type_Spectrometer_Data:    *usePointer = 1; return sizeof(  Spectrometer_Data_t);
+//case DE_Type_OCR_Data:             *usePointer = 1; return sizeof(           OCR_Data_t);
+  case DE_Type_OCR_Frame:            *usePointer = 1; return             OCR_FRAME_LENGTH ;
+//case DE_Type_MCOMS_Data:           *usePointer = 1; return sizeof(         MCOMS_Data_t);
+  case DE_Type_MCOMS_Frame:          *usePointer = 1; return           MCOMS_FRAME_LENGTH ;
+  case DE_Type_Profile_Info_Packet:  *usePointer = 1; return sizeof(Profile_Info_Packet_t);
+  case DE_Type_Profile_Data_Packet:  *usePointer = 1; return sizeof(Profile_Data_Packet_t);
+
+  //  Do NOT add a "default:" here.
+  //  That way, the compiler will generate a warning
+  //  if one possible packet type was missed.
+
+  }
+
+  return 0;
+}
+
+//! Add a packet to the frame being filled.
+//! The data of a package is copied into the frame, and the package released.
+//! @return                     SPI_LINK_OK, SPI_LINK_FULL (flush, then try again) or SPI_LINK_FAIL
+static int16_t link_queue_packet( data_exchange_packet_t* packet ) {
+
+  int usePointer;
+  uint16_t const data_size = link_data_size( packet->type, &usePointer );
+
+  uint8_t packet_header[ DE_LINK_HEADER_SIZE ];
+
+  memcpy ( packet_header,                                   &(packet->to  ), sizeof(data_exchange_address_t) );
+  memcpy ( packet_header+  sizeof(data_exchange_address_t), &(packet->from), sizeof(data_exchange_address_t) );
+  memcpy ( packet_header+2*sizeof(data_exchange_address_t), &(packet->type), sizeof(data_exchange_type_t)    );
+
+  if ( !usePointer ) {
+    return spi_link_queue ( &board_link, packet_header, DE_LINK_HEADER_SIZE, (uint8_t const*)&(packet->data), data_size );
+  }
+
+  //  A package starts a frame of its own
+  if ( spi_link_filling ( &board_link ) ) {
+    return SPI_LINK_FULL;
+  }
+
+  int16_t queued = SPI_LINK_FAIL;
+
+  if ( pdTRUE == xSemaphoreTake ( packet->data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
+
+    if ( packet->data.DataPackagePointer->state == FullRAM
+      || packet->data.DataPackagePointer->state == FullSRAM ) {
+      //  Byte reads from SRAM are fine, spi_link_queue() copies with memcpy()
+      queued = spi_link_queue ( &board_link, packet_header, DE_LINK_HEADER_SIZE, packet->data.DataPackagePointer->address, data_size );
+    }
+
+    //  Copied into the frame, or can never be sent: release the package
+    if ( queued != SPI_LINK_FULL ) {
+      data_package_emptied ( packet->data.DataPackagePointer );
+    }
+
+    xSemaphoreGive ( packet->data.DataPackagePointer->mutex );
+  }
+
+  if ( queued == SPI_LINK_FAIL ) {
+    io_out_S32 ( "TX Dropped %ld\r\n", (S32)packet->type );
+  }
+
+  return queued;
+}
+
+//! spi_link return of a record whose frame was given up.
+//! Its package, if any, was released when copied into the frame,
+//! so the packet is only reported.
+static void link_given_up( void* context, uint8_t* header, uint16_t header_size, uint8_t* data, uint16_t data_size ) {
+
+  data_exchange_type_t type = DE_Type_Nothing;
+
+  if ( header_size == DE_LINK_HEADER_SIZE ) {
+    memcpy ( &type, header+2*sizeof(data_exchange_address_t), sizeof(data_exchange_type_t) );
+  }
+  io_out_S32 ( "TX GivenUp %ld\r\n", (S32)type );
+}
+
+//! True if a local data package is free to receive a frame into
+static int link_package_free( void ) {
+
+  int i;
+  for ( i=0; i<N_DA_POINTERS; i++ ) {
+    if ( local_data_package[i].state == EmptySRAM ) return 1;
+  }
+  return 0;
+}
+
+//! spi_link delivery of one received record:
+//! Rebuild the packet, then pass it on, or respond to it if addressed to myself
+static void link_deliver( void* context, uint8_t* header, uint16_t header_size, uint8_t* data, uint16_t data_size ) {
+
+  data_exchange_address_t const myAddress = *(data_exchange_address_t const*)context;
+
+  data_exchange_packet_t packet_rx_via_SPI;
+
+  if ( header_size != DE_LINK_HEADER_SIZE ) {
+    io_out_S32 ( "RX HSzErr %ld\r\n", (S32)header_size );
+    return;
+  }
+
+  memcpy ( &(packet_rx_via_SPI.to  ), header                                  , sizeof(data_exchange_address_t) );
+  memcpy ( &(packet_rx_via_SPI.from), header+  sizeof(data_exchange_address_t), sizeof(data_exchange_address_t) );
+  memcpy ( &(packet_rx_via_SPI.type), header+2*sizeof(data_exchange_address_t), sizeof(data_exchange_type_t)    );
+
+  int usePointer;
+  uint16_t const expected_size = link_data_size( packet_rx_via_SPI.type, &usePointer );
+
+  if ( packet_rx_via_SPI.type == DE_Type_Nothing || data_size != expected_size ) {
+    io_out_S32 ( "RX DSzErr %ld\r\n", (S32)data_size );
+    return;
+  }
+
+  if ( !usePointer ) {
+
+    memcpy ( &(packet_rx_via_SPI.data), data, data_size );
+
+  } else {
+
+    int data_copied = 0;
+    int i;
+    for ( i=0; i<N_DA_POINTERS && !data_copied; i++) {
+      if ( pdTRUE == xSemaphoreTake ( local_data_package[i].mutex, 100 /*portMAX_DELAY*/ ) ) {
+        if ( local_data_package[i].state == EmptySRAM ) {
+          copy_to_sram_from_ram ( local_data_package[i].address, data, data_size );
+          local_data_package[i].state = FullSRAM;
+          packet_rx_via_SPI.data.DataPackagePointer = &local_data_package[i];
+          data_copied = 1;
+        }
+        xSemaphoreGive( local_data_package[i].mutex );
+      }
+    }
+
+    if ( !data_copied ) {
+      io_out_string ( "RX NoPackage\r\n" );
+      return;
+    }
+  }
+
+  if ( packet_rx_via_SPI.to == myAddress ) {
+
+    //  Only expecting Ping, ignore all others (that were sent in error!).
+
+    if ( packet_rx_via_SPI.type == DE_Type_Ping ) {
+
+      data_exchange_packet_t packet_response;
+
+      packet_response.to = packet_rx_via_SPI.from;
+      packet_response.from = myAddress;
+      packet_response.type = DE_Type_Response;
+      packet_response.data.Response.Code = RSP_ALL_Ping;
+      packet_response.data.Response.value.u64 = 0;  //  Will be ignored
+
+      data_exchange_packet_router ( myAddress, &packet_response );
+
+    } else if ( usePointer ) {
+
+      //  This is not supposed to happen.
+      //  Throw out the data, and mark the package as empty, ie. reusable
+      //
+      if ( pdTRUE == xSemaphoreTake ( packet_rx_via_SPI.data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
+        data_package_emptied ( packet_rx_via_SPI.data.DataPackagePointer );
+        xSemaphoreGive ( packet_rx_via_SPI.data.DataPackagePointer->mutex );
+      }
+    }
+
+  } else if ( packet_rx_via_SPI.to != DE_Addr_Nobody ) {
+    data_exchange_packet_router ( myAddress, &packet_rx_via_SPI );
+  }
+}
+
 //*****************************************************************************
 // Local Tasks Implementation
 //*****************************************************************************
@@ -88,8 +308,15 @@ static void data_exchange_spectrometer( void* pvParameters ) {
 
   data_exchange_address_t const myAddress = DE_Addr_SpectrometerBoard_DataExchange;
 
+  //  A packet that did not fit the frame being filled,
+  //  it goes into the next frame ahead of the queue
+  data_exchange_packet_t pendingPacket;
+  Bool havePending = false;
+
   for(;;)
   {
+    int busy = 0;
+
     if(gRunTask) {
 
       gTaskIsRunning = true;
@@ -118,25 +345,47 @@ uint32_t gplp1  = pcl_read_gplp(1);
 
       //  The other board will indicate if it 
       //  has intention / no intention of sending something.
-      //  If the other board wants to send,
-      //  we will defer checking the in-queue for 'to-be-sent' packets,
-      //  and will first service the request from the other board.
-      if ( SPI_IND_Passive == SPI_Get_OtherBoard_Indicator() ) {
+      //  If the other board wants to send, its frame is taken first,
+      //  as soon as a package is free for the data it may carry.
+      if ( SPI_IND_Active == SPI_Get_OtherBoard_Indicator() ) {
 
-        data_exchange_packet_t packet_rx_via_queue;
+        if ( link_package_free() ) {
+
+gplp1  = pcl_read_gplp(1);
+gplp1 |= 0x04000000;
+         pcl_write_gplp( 1, gplp1 );
+
+          int32_t const received = spi_link_receive ( &board_link, link_deliver, (void*)&myAddress );
+
+gplp1  = pcl_read_gplp(1);
+gplp1 |= 0x08000000;
+         pcl_write_gplp( 1, gplp1 );
+
+          if ( received < 0 ) {
+            io_out_S32 ( "RX %ld\r\n", (S32)received );
+          }
+
+          busy = 1;
+        }
 
-//io_out_string ( "DXS P\r\n" );
+      } else {
 
-        if ( pdPASS == xQueueReceive( rxPackets, &packet_rx_via_queue, 0 ) ) {
+        //  Packets for the other board fill the next frame
+        //
+        data_exchange_packet_t packet_rx_via_queue;
+
+        if ( havePending && SPI_LINK_FULL != link_queue_packet ( &pendingPacket ) ) {
+          havePending = false;
+          busy = 1;
+        }
 
-//io_out_string ( "DXS PQ\r\n" );
+        while ( !havePending && pdPASS == xQueueReceive( rxPackets, &packet_rx_via_queue, 0 ) ) {
 
           if ( packet_rx_via_queue.to == myAddress ) {
 
 gplp1  = pcl_read_gplp(1);
 gplp1 |= 0x00100000;
          pcl_write_gplp( 1, gplp1 );
-//io_out_string( "r" );
 
             //  Only handle Ping, ignore all others.
 
@@ -154,405 +403,60 @@ gplp1 |= 0x00100000;
 
             } else {
 
-# if 0
-              //  This is not supposed to happen
-              //
-              data_exchange_packet_t packet_error;
-
-              packet_error.to   = DE_Addr_ControllerBoard_Commander;
-              packet_error.from = myAddress;
-              packet_error.type = DE_Type_Syslog_Message;
-              packet_error.data.Syslog.number = SL_ERR_RxNonPingPacket;
-              packet_error.data.Syslog.value  = 0;
-
-              data_exchange_spectrometer_pushPacket_viaSPI ( &packet_error );
-# endif
-
               //  Mark data as free to prevent lockup.
               //
-              switch ( packet_rx_via_queue.type ) {
-
-              case DE_Type_Configuration_Data:
-              case DE_Type_Spectrometer_Data:
-//            case DE_Type_OCR_Data:
-              case DE_Type_OCR_Frame:
-//            case DE_Type_MCOMS_Data:
-              case DE_Type_MCOMS_Frame:
-              case DE_Type_Profile_Info_Packet:
-              case DE_Type_Profile_Data_Packet:
+              int usePointer;
+              link_data_size ( packet_rx_via_queue.type, &usePointer );
+
+              if ( usePointer ) {
                 if ( pdTRUE == xSemaphoreTake ( packet_rx_via_queue.data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
-                  if ( packet_rx_via_queue.data.DataPackagePointer->state == FullRAM ) {
-                    packet_rx_via_queue.data.DataPackagePointer->state = EmptyRAM;
-                  } else if ( packet_rx_via_queue.data.DataPackagePointer->state == FullSRAM ) {
-                    packet_rx_via_queue.data.DataPackagePointer->state = EmptySRAM;
-                  }
+                  data_package_emptied ( packet_rx_via_queue.data.DataPackagePointer );
                   xSemaphoreGive ( packet_rx_via_queue.data.DataPackagePointer->mutex );
                 }
-              break;
-
-              case DE_Type_Ping:
-              case DE_Type_Command:
-              case DE_Type_Response:
-              case DE_Type_Syslog_Message:
-              //  No action required. Packet ignored.
-              break;
-
-              case DE_Type_Nothing:
-              break;
-
-              //  Do NOT add a "default:" here.
-              //  That way, the compiler will generate a warning
-              //  if one possible packet type was missed.
-
               }
             }
 
 gplp1  = pcl_read_gplp(1);
 gplp1 |= 0x00200000;
          pcl_write_gplp( 1, gplp1 );
-//io_out_string( "R" );
 
           } else {  //  The final destination of this packet is another task. -- Pass it on.
 
-              int data_size = 0;
-              int usePointer = 0;
-
-              switch ( packet_rx_via_queue.type ) {
-
-              case DE_Type_Ping:                 data_size = sizeof(packet_rx_via_queue.data.Ping_Message); break;
-              case DE_Type_Command:              data_size = sizeof(data_exchange_command_t);               break;
-              case DE_Type_Response:             data_size = sizeof(data_exchange_respond_t);               break;
-              case DE_Type_Syslog_Message:       data_size = sizeof(data_exchange_syslog_t);                break;
-
-              case DE_Type_Configuration_Data:   data_size = sizeof(        Config_Data_t); usePointer = 1; break;
-              case DE_Type_Spectrometer_Data:    data_size = sizeof(  Spectrometer_Data_t); usePointer = 1; break;
-              case DE_Type_OCR_Frame:            data_size =             OCR_FRAME_LENGTH ; usePointer = 1; break;
-              case DE_Type_MCOMS_Frame:          data_size =           MCOMS_FRAME_LENGTH ; usePointer = 1; break;
-              case DE_Type_Profile_Info_Packet:  data_size = sizeof(Profile_Info_Packet_t); usePointer = 1; break;
-              case DE_Type_Profile_Data_Packet:  data_size = sizeof(Profile_Data_Packet_t); usePointer = 1; break;
-
-              case DE_Type_Nothing:              break;
-              //  Do NOT add a "default:" here.
-              //  That way, the compiler will generate a warning
-              //  if one possible packet type was missed.
-
-              }
-
-              uint16_t const packet_header_size = sizeof(data_exchange_address_t)
-                                                + sizeof(data_exchange_address_t)
-                                                + sizeof(data_exchange_type_t);
-              uint8_t  packet_header[ packet_header_size ];
-
-              //  Packet header as bytes
-
-              memcpy ( packet_header,                                   &(packet_rx_via_queue.to  ), sizeof(data_exchange_address_t) );
-              memcpy ( packet_header+  sizeof(data_exchange_address_t), &(packet_rx_via_queue.from), sizeof(data_exchange_address_t) );
-              memcpy ( packet_header+2*sizeof(data_exchange_address_t), &(packet_rx_via_queue.type), sizeof(data_exchange_type_t)    );
-
-              int16_t num_bytes_sent = 0;
-              int16_t sent_status = 0;
-
-              if ( !usePointer ) {
-
-
-                switch ( packet_rx_via_queue.type ) {
-
-                case DE_Type_Ping:                sent_status = SPI_tx_packet ( packet_header, packet_header_size,
-                                                                         (uint8_t*)packet_rx_via_queue.data.Ping_Message, sizeof(packet_rx_via_queue.data.Ping_Message),
-                                                                         &num_bytes_sent );
-                                                  break;
-
-                case DE_Type_Command:             sent_status = SPI_tx_packet ( packet_header, packet_header_size,
-                                                                         (uint8_t*)(&packet_rx_via_queue.data.Command), sizeof(data_exchange_command_t),
-                                                                         &num_bytes_sent );
-                                                  break;
-
-                case DE_Type_Response:            sent_status = SPI_tx_packet ( packet_header, packet_header_size,
-                                                                         (uint8_t*)(&packet_rx_via_queue.data.Response), sizeof(data_exchange_respond_t),
-                                                                         &num_bytes_sent );
-                                                  break;
-
-                case DE_Type_Syslog_Message:      sent_status = SPI_tx_packet ( packet_header, packet_header_size,
-                                                                         (uint8_t*)(&packet_rx_via_queue.data.Syslog), sizeof(data_exchange_syslog_t),
-                                                                         &num_bytes_sent );
-                                                  break;
+            if ( SPI_LINK_FULL == link_queue_packet ( &packet_rx_via_queue ) ) {
+              //  Into the next frame, once this one is on its way
+              pendingPacket = packet_rx_via_queue;
+              havePending = true;
+            }
+          }
 
-                default:
-                                                  //  Handled via data_size > 0 in following else block
-                                                  break;
-                }
+          busy = 1;
+        }
 
-              } else {
+        //  Send what is due: the frame being filled, a frame again,
+        //  or an acknowledgement of the last frame received
 
 gplp1  = pcl_read_gplp(1);
 gplp1 |= 0x00400000;
          pcl_write_gplp( 1, gplp1 );
-//io_out_string( "s" );
-
-                //  Inside this code block,
-                //  (1) the data pointed to by the received packet is pused to SPI
-                //  (2) Then the received memory is released (flagged as Empty[S]RAM),
-
-                //  Mutex control access to received memory
-                //  (1) send to SPI
-                //  (2) flag reseived as Empty
-                //
-                if ( pdTRUE == xSemaphoreTake ( packet_rx_via_queue.data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
 
-gplp1  = pcl_read_gplp(1);
-gplp1 |= 0x01000000;
-         pcl_write_gplp( 1, gplp1 );
-//io_out_string( "u" );
-
-                  if ( packet_rx_via_queue.data.DataPackagePointer->state == FullRAM ) {
-                    //  send data from RAM
-                    sent_status = SPI_tx_packet ( packet_header, packet_header_size,
-                                           packet_rx_via_queue.data.DataPackagePointer->address, data_size,
-                                           &num_bytes_sent );
-                    packet_rx_via_queue.data.DataPackagePointer->state = EmptyRAM;
-                  } else if ( packet_rx_via_queue.data.DataPackagePointer->state == FullSRAM ) {
-                    //  send data from SRAM
-                    sent_status = SPI_tx_packet ( packet_header, packet_header_size,
-                                           packet_rx_via_queue.data.DataPackagePointer->address, data_size,
-                                           &num_bytes_sent );
-                    packet_rx_via_queue.data.DataPackagePointer->state = EmptySRAM;
-                  }
+        int32_t const sent = spi_link_flush ( &board_link );
 
 gplp1  = pcl_read_gplp(1);
-gplp1 |= 0x02000000;
-         pcl_write_gplp( 1, gplp1 );
-//io_out_string( "U" );
-
-                  xSemaphoreGive ( packet_rx_via_queue.data.DataPackagePointer->mutex );
-
-                  if(0) io_out_S32 ( "TXF %lx\r\n", (S32)(packet_rx_via_queue.data.DataPackagePointer->address) );
-
-                  if ( sent_status ) {
-                    io_out_S32 ( "TX %ld ", (S32)sent_status );
-                    io_out_S32 ( "%ld ", (S32)num_bytes_sent );
-                    io_out_S32 ( "%ld\r\n", (S32)(packet_header_size+data_size) );
-                  }
-
-                } else {
-                  io_out_string ( "TX Not Attempted, Mutex Locked\r\n" );
-                  //  TODO  --  Push back onto queue, to eventually have the memory made empty
-                }
-gplp1  = pcl_read_gplp(1);
 gplp1 |= 0x00800000;
          pcl_write_gplp( 1, gplp1 );
-//io_out_string( "S" );
-
-              }
-//io_out_string ( "DXS Td\r\n" );
-          }
-
-          vTaskDelay( (portTickType)TASK_DELAY_MS( 25 ) );
-        } // End of while loop
-
-      //  Check for incoming packet via SPI
-      } /* else */ if ( SPI_IND_Active == SPI_Get_OtherBoard_Indicator() ) {
-
-          data_exchange_packet_t packet_rx_via_SPI;
-
-          uint16_t const packet_header_size = sizeof(data_exchange_address_t)
-                                            + sizeof(data_exchange_address_t)
-                                            + sizeof(data_exchange_type_t);
-          uint8_t  packet_header[ packet_header_size ];
-
-          int32_t received_data_size;
-
-gplp1  = pcl_read_gplp(1);
-gplp1 |= 0x10000000;
-         pcl_write_gplp( 1, gplp1 );
-//io_out_string( "a" );
-
-          int data_copied = 0;
-          int i;
-          for ( i=0; i<N_DA_POINTERS && !data_copied; i++) {
-            if ( pdTRUE == xSemaphoreTake ( local_data_package[i].mutex, portMAX_DELAY /*10*/ ) ) {
-
-              if ( local_data_package[i].state == EmptySRAM ) {
-
-gplp1  = pcl_read_gplp(1);
-gplp1 |= 0x04000000;
-         pcl_write_gplp( 1, gplp1 );
-//io_out_string( "b" );
-
-                received_data_size = SPI_rx_packet( packet_header, packet_header_size,
-                                                    (uint8_t*)0, local_data_package[i].address,
-                                                    sizeof(any_local_data_t) );
-gplp1  = pcl_read_gplp(1);
-gplp1 |= 0x08000000;
-         pcl_write_gplp( 1, gplp1 );
-//io_out_string( "B" );
-
-
-                int32_t remaining_data_size;
-
-                if ( received_data_size > packet_header_size ) {
-                  memcpy ( &packet_rx_via_SPI.to  , packet_header                                  , sizeof(data_exchange_address_t) );
-                  memcpy ( &packet_rx_via_SPI.from, packet_header+  sizeof(data_exchange_address_t), sizeof(data_exchange_address_t) );
-                  memcpy ( &packet_rx_via_SPI.type, packet_header+2*sizeof(data_exchange_address_t), sizeof(data_exchange_type_t)    );
 
-                  remaining_data_size = received_data_size-packet_header_size;
-                } else {
-                  remaining_data_size = 0;
-                  packet_rx_via_SPI.type = DE_Type_Nothing;
-                  packet_rx_via_SPI.to   = DE_Addr_Nobody;
-                  packet_rx_via_SPI.from = DE_Addr_Nobody;
-                }
-
-                uint16_t value_size = 0;
-                uint16_t data_size = 0;
-
-                switch ( packet_rx_via_SPI.type ) {
-
-                case DE_Type_Ping:                 value_size = sizeof(packet_rx_via_SPI.data.Ping_Message);
-                                                   if ( value_size == remaining_data_size ) {
-                                                     copy_to_ram_from_sram ( (uint8_t*)&packet_rx_via_SPI.data.Ping_Message, local_data_package[i].address, value_size );
-						     
-                                                   } else {
-                                                     packet_rx_via_SPI.to = DE_Addr_Nobody;
-                                                   }
-                                                   break;
-
-                case DE_Type_Command:              value_size = sizeof(data_exchange_command_t);
-                                                   if ( value_size == remaining_data_size ) {
-                                                     copy_to_ram_from_sram ( (uint8_t*)&packet_rx_via_SPI.data.Command, local_data_package[i].address, value_size );
-                                                   } else {
-                                                     packet_rx_via_SPI.to = DE_Addr_Nobody;
-                                                   }
-                                                   break;
-
-                case DE_Type_Response:             value_size = sizeof(data_exchange_respond_t);
-                                                   if ( value_size == remaining_data_size ) {
-                                                     copy_to_ram_from_sram ( (uint8_t*)&packet_rx_via_SPI.data.Response, local_data_package[i].address, value_size );
-                                                   } else {
-                                                     packet_rx_via_SPI.to = DE_Addr_Nobody;
-                                                   }
-                                                   break;
-
-                case DE_Type_Syslog_Message:       value_size = sizeof(data_exchange_syslog_t);
-                                                   if ( value_size == remaining_data_size ) {
-                                                     copy_to_ram_from_sram ( (uint8_t*)&packet_rx_via_SPI.data.Syslog, local_data_package[i].address, value_size );
-                                                   } else {
-                                                     packet_rx_via_SPI.to = DE_Addr_Nobody;
-                                                   }
-                                                   break;
-
-                case DE_Type_Configuration_Data:   data_size = sizeof(        Config_Data_t); break;
-                case DE_Type_Spectrometer_Data:    data_size = sizeof(  Spectrometer_Data_t); break;
-//              case DE_Type_OCR_Data:             data_size = sizeof(           OCR_Data_t); break;
-                case DE_Type_OCR_Frame:            data_size =             OCR_FRAME_LENGTH ; break;
-//              case DE_Type_MCOMS_Data:           data_size = sizeof(         MCOMS_Data_t); break;
-                case DE_Type_MCOMS_Frame:          data_size =           MCOMS_FRAME_LENGTH ; break;
-                case DE_Type_Profile_Info_Packet:  data_size = sizeof(Profile_Info_Packet_t); break;
-                case DE_Type_Profile_Data_Packet:  data_size = sizeof(Profile_Data_Packet_t); break;
-
-                case DE_Type_Nothing:              // when error in SPI_rx_packet() occurred
-                default:                           /*  Should never happen -- Trigger ERROR message -- TODO??? */
-                                                   break;
-                }
-
-                if ( data_size > 0 ) {
-                  if ( data_size == remaining_data_size ) {
-                    packet_rx_via_SPI.data.DataPackagePointer = &local_data_package[i];
-                    local_data_package[i].state = FullSRAM;
-                  } else {
-                    //  data size mismatch!
-                    packet_rx_via_SPI.to = DE_Addr_Nobody;
-                  }
-                }
-
-                switch ( received_data_size ) {
-                case -1:  io_out_string ( "RX NoCom\r\n" ); break;
-                case -2:  io_out_string ( "RX Conflict\r\n" ); break;
-                case -3:  io_out_string ( "RX Timeout\r\n" ); break;
-                case -4:  io_out_string ( "RX Fail\r\n" ); break;
-                case -5:  io_out_string ( "RX NoResp\r\n" ); break;
-                default:  if ( ( data_size && remaining_data_size == data_size )
-                            || ( value_size && remaining_data_size == value_size ) ) {
-                        //io_out_string ( "RX Ok\r\n" );
-                          } else {
-                          io_out_string ( "RX Error\r\n" );
-                          }
-                }
-
-                data_copied = 1;
-              }
-              xSemaphoreGive( local_data_package[i].mutex );
-
-            }
-          }
-
-gplp1  = pcl_read_gplp(1);
-gplp1 |= 0x20000000;
-         pcl_write_gplp( 1, gplp1 );
-//io_out_string( "A" );
-
-          if ( !data_copied ) {
-                          io_out_string ( "RX NotTried\r\n" );
-          }
-
-           //  Send the just received packet on its way
-           //  or respond to it if addressed to myself
-           //
-           if ( packet_rx_via_SPI.to == myAddress ) {
-
-            //  Only expecting Ping, ignore all others (that were sent in error!).
-
-            if ( packet_rx_via_SPI.type == DE_Type_Ping ) {
-
-              data_exchange_packet_t packet_response;
-
-              packet_response.to = packet_rx_via_SPI.from;
-              packet_response.from = myAddress;
-              packet_response.type = DE_Type_Response;
-              packet_response.data.Response.Code = RSP_ALL_Ping;
-              packet_response.data.Response.value.u64 = 0;  //  Will be ignored
-
-              data_exchange_packet_router ( myAddress, &packet_response );
-
-            } else {
-
-              //  This is not supposed to happen.
-              //  If received a packet containing data, clean data,
-              //  ie., throw out, and mark location as empty, ie. reusable
-              //
-              switch ( packet_rx_via_SPI.type ) {
-
-              case DE_Type_Configuration_Data:
-              case DE_Type_Spectrometer_Data:
-//            case DE_Type_OCR_Data:
-              case DE_Type_OCR_Frame:
-//            case DE_Type_MCOMS_Data:
-              case DE_Type_MCOMS_Frame:
-              case DE_Type_Profile_Info_Packet:
-              case DE_Type_Profile_Data_Packet:
-                if ( pdTRUE == xSemaphoreTake ( packet_rx_via_SPI.data.DataPackagePointer->mutex, portMAX_DELAY ) ) {
-                  if ( packet_rx_via_SPI.data.DataPackagePointer->state == FullRAM ) {
-                    packet_rx_via_SPI.data.DataPackagePointer->state = EmptyRAM;
-                  } else if ( packet_rx_via_SPI.data.DataPackagePointer->state == FullSRAM ) {
-                    packet_rx_via_SPI.data.DataPackagePointer->state = EmptySRAM;
-                  }
-                  xSemaphoreGive ( packet_rx_via_SPI.data.DataPackagePointer->mutex );
-                }
-              break;
-
-              default:
-                //  No action required. Packet has been consumed without a trace.
-              break;
-              }
-
-            }
-           } else if ( packet_rx_via_SPI.to != DE_Addr_Nobody ) {
-            data_exchange_packet_router ( myAddress, &packet_rx_via_SPI );
-           }
-gplp1  = pcl_read_gplp(1);
-gplp1 |= 0x40000000;
-         pcl_write_gplp( 1, gplp1 );
-//io_out_string( "C" );
+        if ( sent > 0 ) {
+          busy = 1;
+        } else if ( sent < 0 ) {
+          io_out_S32 ( "TX %ld\r\n", (S32)sent );
+        }
+      }
 
+      //  A frame waiting for its acknowledgement is polled as often
+      //  as a frame moved, else its retransmission takes seconds.
+      //  The same while the other board waits for a free package.
+      if ( !spi_link_idle ( &board_link ) || SPI_IND_Active == SPI_Get_OtherBoard_Indicator() ) {
+        busy = 1;
       }
 
     } else {
@@ -561,8 +465,16 @@ gplp1 |= 0x40000000;
     }
 
     gHNV_DataXSpectrmTask_Status = TASK_SLEEPING;   //  Notify task monitor to not trigger a watchdog reset on behalf of this task
-    //  Allow scheduler to run other tasks
-    vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_DataXSpectrmTask_PERIOD_MS ) );
+    //  Allow scheduler to run other tasks.
+    //  Block until a packet is pushed, or the other board's ready line
+    //  falls; either gives wakeSemaphore. After a frame, look again within
+    //  25 ms: more may be queued, or the other board may answer. Otherwise
+    //  the time out only covers a missed edge.
+    if ( gTaskIsRunning ) {
+      xSemaphoreTake( wakeSemaphore, (portTickType)TASK_DELAY_MS( busy ? 25 : HNV_DataXSpectrmTask_IDLE_MS ) );
+    } else {
+      vTaskDelay( (portTickType)TASK_DELAY_MS( HNV_DataXSpectrmTask_PERIOD_MS ) );
+    }
     gHNV_DataXSpectrmTask_Status = TASK_RUNNING;    //  Notify task monitor to trigger a watchdog reset if this task becomes unresponsive
   }
 
@@ -578,7 +490,24 @@ void data_exchange_spectrometer_pushPacket( data_exchange_packet_t* packet ) {
   //  Multiple threads may call concurrently.
   //  We trust that the queue is implemented thread-safe.
   if ( packet ) {
-    xQueueSendToBack ( rxPackets, packet, 0 );
+    if ( pdTRUE == xQueueSendToBack ( rxPackets, packet, 0 ) ) {
+      xSemaphoreGive ( wakeSemaphore );
+    } else {
+      //  Not delivered: nobody else holds the package, so free it here,
+      //  or its sender would wait for it forever.
+      switch ( packet->type ) {
+      case DE_Type_Configuration_Data:
+      case DE_Type_Spectrometer_Data:
+      case DE_Type_OCR_Frame:
+      case DE_Type_MCOMS_Frame:
+      case DE_Type_Profile_Info_Packet:
+      case DE_Type_Profile_Data_Packet:
+        data_package_emptied ( packet->data.DataPackagePointer );
+        break;
+      default:
+        break;
+      }
+    }
   }
 }
 
@@ -589,6 +518,7 @@ Bool data_exchange_spectrometer_resumeTask(void)
   xSemaphoreTake(gTaskCtrlMutex, portMAX_DELAY);
 
   // Potentially do setup here
+  SPI_Wake_On_OtherBoard_Active( wakeSemaphore );
 
   // Command
   gRunTask = true;
@@ -609,13 +539,15 @@ Bool data_exchange_spectrometer_pauseTask(void)
   // Grab control mutex
   xSemaphoreTake(gTaskCtrlMutex, portMAX_DELAY);
 
-  // Command
+  // Command, and wake the task to see it
   gRunTask = false;
+  xSemaphoreGive( wakeSemaphore );
 
   // Wait for task to stop running
   while(gTaskIsRunning) vTaskDelay( (portTickType)TASK_DELAY_MS(10) );
 
   // Potentially do cleanup here
+  SPI_Wake_On_OtherBoard_Active( NULL );
 
   // Return control mutex
   xSemaphoreGive(gTaskCtrlMutex);
@@ -652,6 +584,12 @@ Bool data_exchange_spectrometer_createTask(void)
       if ( NULL == ( rxPackets = xQueueCreate(N_RX_PACKETS, sizeof(data_exchange_packet_t) ) ) )
         break;
 
+      // Create wake-up semaphore, not given until there is something to do
+      vSemaphoreCreateBinary( wakeSemaphore );
+      if ( NULL == wakeSemaphore )
+        break;
+      xSemaphoreTake( wakeSemaphore, 0 );
+
       // Allocate memory for frames that are received
       //
       bool all_allocated = true;
@@ -673,6 +611,21 @@ Bool data_exchange_spectrometer_createTask(void)
         }
       }
 
+      //  Board to board link
+      //
+      uint8_t* link_frame[3] = { (uint8_t*) pvPortMalloc ( DE_LINK_SPEC_FRAME ),
+                                 (uint8_t*) pvPortMalloc ( DE_LINK_SPEC_FRAME ),
+                                 (uint8_t*) pvPortMalloc ( DE_LINK_CTRL_FRAME ) };
+      if ( !link_frame[0] || !link_frame[1] || !link_frame[2]
+        || SPI_LINK_OK != spi_link_init ( &board_link, link_frame, DE_LINK_SPEC_FRAME, DE_LINK_CTRL_FRAME,
+                                          DE_LINK_RECORDS_MAX, &link_transport ) ) {
+        for ( i=0; i<3; i++ ) {
+          if ( link_frame[i] ) vPortFree ( link_frame[i] );
+        }
+        all_allocated = false;
+      }
+      spi_link_on_given_up ( &board_link, link_given_up, NULL );
+
       if ( !all_allocated ) {
         for ( i=0; i<N_DA_POINTERS; i++) {
           if ( local_data_package[i].mutex ) {
@@ -0,0 +1,19 @@
+#!/bin/sh
+
+#  Build the host simulation of the acquired data package ring.
+#  package_ring.c is compiled unchanged, with a full memory barrier
+#  in place of the compiler barrier that suffices on the single-core AVR32.
+#
+#  Usage:  sh compile_package_ring_test.sh
+#          ./package_ring_test                      # consumer 20% slower, depth 16
+#          ./package_ring_test -s -t 40 -k 400      # firmware release, consumer stalls 40 ms
+#          ./package_ring_test -d 4 -c 200          # over capacity: refusals, nothing lost
+
+gcc \
+     -O2 -Wall \
+     -DPACKAGE_RING_BARRIER=__sync_synchronize \
+     -o package_ring_test \
+     -I .. \
+     ../package_ring.c \
+     package_ring_test.c \
+     -lpthread
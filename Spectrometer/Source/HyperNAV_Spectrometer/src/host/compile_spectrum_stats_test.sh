@@ -0,0 +1,18 @@
+#!/bin/sh
+
+#  Build the host test of the single pass spectrum statistics.
+#  spectrum_stats.c is compiled unchanged; the former multi-pass code
+#  of data_acquisition.c is reproduced in the test for reference.
+#
+#  Usage:  sh compile_spectrum_stats_test.sh
+#          ./spectrum_stats_test                 # 2000 synthetic dark/light pairs
+#          ./spectrum_stats_test -f PROFILE.SBR  # recorded spectra
+
+gcc \
+     -O2 -Wall \
+     -o spectrum_stats_test \
+     -I .. \
+     -I ../../../../../Shared/FirmwareDefinitions \
+     ../spectrum_stats.c \
+     spectrum_stats_test.c \
+     -lm
@@ -0,0 +1,204 @@
+/*! \file package_ring_test.c ******************************************************
+ *
+ * \brief Host simulation of the acquired data package ring
+ *
+ *  A producer thread (the acquisition task) claims, fills and publishes
+ *  packages; a consumer thread (the data exchange task) takes them oldest
+ *  first. The consumer is slower on average or stalls in bursts, so the
+ *  ring fills and drains.
+ *
+ *  The consumer gives packages back either through the ring directly,
+ *  or as in the firmware (-s): it only flags a package empty, and the
+ *  producer returns the flagged packages to the ring before each claim.
+ *
+ *  Checks that every published package arrives once, in order and
+ *  intact, that no claim is refused while the ring has room, and that
+ *  the high-water mark never exceeds the depth.
+ *
+ *  Exits 1 on any failed check.
+ *
+ ***************************************************************************/
+
+# include <pthread.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+# include "package_ring.h"
+
+# define PAYLOAD 64
+
+typedef struct {
+  uint32_t volatile full;     //  the firmware package state, Full / Empty
+  uint32_t          seq;
+  uint32_t          payload[PAYLOAD];
+} Slot_t;
+
+static Package_Ring_t ring;
+static Slot_t*        slot;
+
+static int      depth     = 16;
+static int      produce   = 20000;
+static int      prod_us   = 50;     //  acquisition period
+static int      cons_us   = 60;     //  consumer time per package
+static int      stall_ms  = 0;      //  consumer stall ...
+static int      stall_per = 500;    //  ... every so many packages
+static int      state_rel = 0;      //  release as the firmware does
+
+static uint32_t volatile produced_done, published;
+static uint32_t refused_with_room, consumed, bad_order, bad_payload;
+
+static void sleep_us ( long us ) {
+  if ( us <= 0 ) return;
+  struct timespec ts = { us / 1000000, ( us % 1000000 ) * 1000 };
+  nanosleep ( &ts, 0 );
+}
+
+static uint32_t word_of ( uint32_t seq, int i ) {
+  return seq * 2654435761u + i;
+}
+
+static void* producer ( void* arg ) {
+
+  uint32_t seq;
+  (void)arg;
+
+  for ( seq=0; seq<(uint32_t)produce; seq++ ) {
+
+    //  Firmware: return the packages the consumer flagged empty, oldest first
+    if ( state_rel ) {
+      int s;
+      while ( ( s = package_ring_oldest ( &ring ) ) >= 0 && !slot[s].full )
+        package_ring_release ( &ring );
+    }
+
+    uint16_t used = package_ring_used ( &ring );
+    int s = package_ring_claim ( &ring );
+
+    if ( s < 0 ) {
+      //  Only a full ring may refuse. The consumer may have released since
+      //  'used' was read, but never the producer, so used < depth is a failure.
+      if ( used < depth ) refused_with_room++;
+    } else {
+      int i;
+      slot[s].seq = seq;
+      for ( i=0; i<PAYLOAD; i++ ) slot[s].payload[i] = word_of ( seq, i );
+      __sync_synchronize();
+      slot[s].full = 1;
+      package_ring_publish ( &ring );
+      published++;
+    }
+
+    sleep_us ( prod_us/2 + rand() % ( prod_us+1 ) );
+  }
+
+  produced_done = 1;
+  return 0;
+}
+
+static void* consumer ( void* arg ) {
+
+  int64_t last = -1;
+  (void)arg;
+
+  for ( ;; ) {
+    int s;
+
+    if ( state_rel ) {
+      //  Firmware: packages arrive through a queue in publish order,
+      //  which is ring order, so the next one is at a fixed slot
+      s = consumed % depth;
+      if ( !slot[s].full ) s = -1;
+    } else {
+      s = package_ring_oldest ( &ring );
+    }
+
+    if ( s < 0 ) {
+      if ( produced_done && consumed == published ) break;
+      sleep_us ( 10 );
+      continue;
+    }
+
+    __sync_synchronize();
+
+    int i;
+    if ( (int64_t)slot[s].seq <= last ) bad_order++;
+    last = slot[s].seq;
+    for ( i=0; i<PAYLOAD; i++ )
+      if ( slot[s].payload[i] != word_of ( slot[s].seq, i ) ) { bad_payload++; break; }
+
+    consumed++;
+    sleep_us ( cons_us/2 + rand() % ( cons_us+1 ) );
+    if ( stall_ms && consumed % stall_per == 0 ) sleep_us ( stall_ms*1000L );
+
+    //  As data_package_emptied(): done with the data, then the flag
+    PACKAGE_RING_BARRIER();
+    slot[s].full = 0;
+    if ( !state_rel ) package_ring_release ( &ring );
+  }
+  return 0;
+}
+
+static void print_usage ( char const* pn ) {
+  printf ( "Host simulation of the acquired data package ring\n" );
+  printf ( "Usage: %s [-h -? -dD -nN -pP -cC -tT -kK -s]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -dD     Ring depth [default: 16]\n" );
+  printf ( "       -nN     Spectra acquired [default: 20000]\n" );
+  printf ( "       -pP     Acquisition period, us [default: 50]\n" );
+  printf ( "       -cC     Consumer time per package, us [default: 60]\n" );
+  printf ( "       -tT     Consumer stall, ms [default: 0]\n" );
+  printf ( "       -kK     Stall every K packages [default: 500]\n" );
+  printf ( "       -s      Release by flagging packages empty, as the firmware does\n" );
+}
+
+int main ( int argc, char** argv ) {
+
+  int opt;
+  while ( ( opt = getopt ( argc, argv, "h?d:n:p:c:t:k:s" ) ) != -1 ) {
+    switch ( opt ) {
+    case 'd': depth     = atoi ( optarg ); break;
+    case 'n': produce   = atoi ( optarg ); break;
+    case 'p': prod_us   = atoi ( optarg ); break;
+    case 'c': cons_us   = atoi ( optarg ); break;
+    case 't': stall_ms  = atoi ( optarg ); break;
+    case 'k': stall_per = atoi ( optarg ); break;
+    case 's': state_rel = 1; break;
+    default : print_usage ( argv[0] ); return 0;
+    }
+  }
+
+  if ( package_ring_init ( &ring, depth ) || produce < 1 || stall_per < 1 ) {
+    print_usage ( argv[0] );
+    return 1;
+  }
+
+  slot = calloc ( depth, sizeof(Slot_t) );
+
+  pthread_t p, c;
+  pthread_create ( &c, 0, consumer, 0 );
+  pthread_create ( &p, 0, producer, 0 );
+  pthread_join ( p, 0 );
+  pthread_join ( c, 0 );
+
+  //  Firmware: the last flagged packages go back on the next claim
+  int o;
+  while ( ( o = package_ring_oldest ( &ring ) ) >= 0 && !slot[o].full )
+    package_ring_release ( &ring );
+
+  int fail = published != consumed
+          || published + ring.refused != (uint32_t)produce
+          || refused_with_room || bad_order || bad_payload
+          || ring.high_water > depth
+          || package_ring_used ( &ring ) != 0;
+
+  printf ( "release,depth,acquired,published,consumed,refused,refused_with_room,high_water,bad_order,bad_payload\n" );
+  printf ( "%s,%d,%d,%u,%u,%u,%u,%u,%u,%u%s\n", state_rel ? "flag" : "ring", depth, produce,
+           published, consumed, ring.refused, refused_with_room, ring.high_water,
+           bad_order, bad_payload, fail ? ",FAIL" : "" );
+
+  free ( slot );
+  return fail;
+}
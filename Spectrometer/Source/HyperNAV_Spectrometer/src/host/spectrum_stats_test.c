@@ -0,0 +1,238 @@
+/*! \file spectrum_stats_test.c ****************************************************
+ *
+ * \brief Host test of the single pass spectrum statistics
+ *
+ *  Runs the former multi-pass code of the acquisition task (dark stats,
+ *  light stats, up-shift, light-minus-dark) and the fused kernels over the
+ *  same dark/light pairs, compares every result, and prints the cycles
+ *  per spectrum of both as CSV.
+ *
+ *  Spectra are synthetic unless recorded ones are given with -f:
+ *  a file of Spectrometer_Data_t records as stored by the controller.
+ *  Each recorded spectrum is used as light, over a dark drawn from
+ *  its dark average and noise.
+ *
+ *  Exits 1 on any mismatch other than the former 32 bit wrap
+ *  of the sum of squared deviations (counted separately).
+ *
+ ***************************************************************************/
+
+# include <math.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+
+# include "spectrometer_data.h"
+# include "spectrum_stats.h"
+
+//  Cycle count shim: the COUNT system register on the board,
+//  the time stamp counter on x86, nanoseconds elsewhere
+# if defined(__AVR32__)
+#  include <avr32/io.h>
+#  define CYCLES() ( (uint64_t)Get_system_register ( AVR32_COUNT ) )
+# elif defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#  define CYCLES() ( (uint64_t)__rdtsc() )
+# else
+#  include <time.h>
+static uint64_t CYCLES ( void ) {
+  struct timespec ts; clock_gettime ( CLOCK_MONOTONIC, &ts );
+  return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+# endif
+
+typedef struct {
+  uint16_t avg, sdv, min, max;
+  int      wrapped;   //  the U32 sum of squared deviations overflowed
+} Ref_Stats_t;
+
+//  The former two passes, unchanged but for the array access
+static void ref_stats ( uint16_t const* spec, Ref_Stats_t* r ) {
+
+  int px;
+  uint32_t avg = 0;
+  for ( px=0; px<N_SPEC_PIX; px++ ) {
+    avg += spec[px];
+  }
+  avg /= N_SPEC_PIX;
+
+  uint32_t sdv = 0;
+  uint32_t min = 0xFFFF;
+  uint32_t max = 0;
+  uint64_t exact = 0;
+  for ( px=0; px<N_SPEC_PIX; px++ ) {
+    int32_t val = spec[px];
+    if ( max < val ) max = val;
+    if ( min > val ) min = val;
+    int32_t diff = val;
+    diff -= avg;
+    sdv += (uint32_t)diff*(uint32_t)diff;
+    exact += (uint64_t)( (int64_t)diff*diff );
+  }
+  sdv /= N_SPEC_PIX;
+  sdv  = (sdv>0 ) ? ceil(sqrt(sdv)) : 0;
+
+  r->avg = avg;
+  r->sdv = sdv;
+  r->min = min;
+  r->max = max;
+  r->wrapped = ( exact >> 32 ) != 0;
+}
+
+//  The former up-shift and difference passes
+static uint16_t ref_lmd ( uint16_t const* light, uint16_t const* dark, uint16_t* out ) {
+
+  int px;
+  uint16_t use_shift = 0;
+  for ( px=0; px<N_SPEC_PIX; px++ ) {
+    if ( light[px] < dark[px] ) {
+      uint16_t shift = dark[px] - light[px];
+      if ( shift>use_shift )
+        use_shift = shift;
+    }
+  }
+  for ( px=0; px<N_SPEC_PIX; px++ ) {
+    uint32_t difference = use_shift + light[px]; difference -= dark[px];
+    out[px] = difference;
+  }
+  return use_shift;
+}
+
+static double gauss ( void ) {
+  double u = ( rand() + 1.0 ) / ( RAND_MAX + 2.0 );
+  double v = ( rand() + 1.0 ) / ( RAND_MAX + 2.0 );
+  return sqrt ( -2*log(u) ) * cos ( 2*M_PI*v );
+}
+
+static uint16_t clip ( double v ) {
+  return v < 0 ? 0 : v > 65535 ? 65535 : (uint16_t)v;
+}
+
+static void make_dark ( uint16_t* dark, double level, double noise ) {
+  int px;
+  for ( px=0; px<N_SPEC_PIX; px++ )
+    dark[px] = clip ( level + noise*gauss() );
+}
+
+//  A smooth spectrum, peak scaled by s (saturates for s > 1)
+static void make_light ( uint16_t* light, uint16_t const* dark, double s ) {
+  int px;
+  for ( px=0; px<N_SPEC_PIX; px++ ) {
+    double x = ( px - 900.0 ) / 350.0;
+    double signal = 60000.0 * s * exp ( -x*x ) * ( 1 + 0.2*sin ( px/13.0 ) );
+    light[px] = clip ( dark[px] + signal + sqrt ( signal+1 ) * gauss() );
+  }
+}
+
+static void print_usage ( char const* pn ) {
+  printf ( "Host test of the single pass spectrum statistics\n" );
+  printf ( "Usage: %s [-h -? -nN -fFILE]\n", pn );
+  printf ( "       -h, -?  Print this usage message.\n" );
+  printf ( "       -nN     Synthetic dark/light pairs [default: 2000]\n" );
+  printf ( "       -fFILE  Recorded Spectrometer_Data_t records instead\n" );
+}
+
+int main ( int argc, char** argv ) {
+
+  int pairs = 2000;
+  char const* file = 0;
+  int opt;
+
+  while ( ( opt = getopt ( argc, argv, "h?n:f:" ) ) != -1 ) {
+    switch ( opt ) {
+    case 'n': pairs = atoi ( optarg ); break;
+    case 'f': file  = optarg; break;
+    default : print_usage ( argv[0] ); return 0;
+    }
+  }
+
+  Spectrometer_Data_t* rec = 0;
+  if ( file ) {
+    FILE* fp = fopen ( file, "rb" );
+    if ( !fp ) { fprintf ( stderr, "Cannot open %s\n", file ); return 1; }
+    fseek ( fp, 0, SEEK_END );
+    long size = ftell ( fp );
+    rewind ( fp );
+    pairs = size / sizeof(Spectrometer_Data_t);
+    rec = malloc ( pairs * sizeof(Spectrometer_Data_t) );
+    if ( pairs < 1 || fread ( rec, sizeof(Spectrometer_Data_t), pairs, fp ) != (size_t)pairs ) {
+      fprintf ( stderr, "No records in %s\n", file );
+      return 1;
+    }
+    fclose ( fp );
+  } else if ( pairs < 2 ) {
+    print_usage ( argv[0] );
+    return 1;
+  }
+
+  uint16_t* dark  = malloc ( pairs * N_SPEC_PIX * sizeof(uint16_t) );
+  uint16_t* light = malloc ( pairs * N_SPEC_PIX * sizeof(uint16_t) );
+  uint16_t ref_out[N_SPEC_PIX], new_out[N_SPEC_PIX];
+  int p;
+
+  srand ( 12345 );
+  for ( p=0; p<pairs; p++ ) {
+    uint16_t* d = dark  + p*N_SPEC_PIX;
+    uint16_t* l = light + p*N_SPEC_PIX;
+    if ( rec ) {
+      make_dark ( d, rec[p].aux.dark_average, rec[p].aux.dark_noise );
+      memcpy ( l, rec[p].hnv_spectrum, sizeof(rec[p].hnv_spectrum) );
+    } else {
+      make_dark ( d, 1500 + 500*(p%7), 8 + p%40 );
+      //  Dim to saturated, and every 50th dark-only (light below dark)
+      if ( p%50 == 49 ) make_dark ( l, 1500, 30 );
+      else              make_light ( l, d, ( p%100 ) / 60.0 );
+    }
+  }
+
+  int mismatch = 0, wrapped = 0;
+  uint64_t ref_cyc = 0, new_cyc = 0;
+
+  for ( p=0; p<pairs; p++ ) {
+    uint16_t const* d = dark  + p*N_SPEC_PIX;
+    uint16_t const* l = light + p*N_SPEC_PIX;
+    Ref_Stats_t rd, rl;
+    Spectrum_Stats_t sd, sl;
+
+    uint64_t t0 = CYCLES();
+    ref_stats ( d, &rd );
+    ref_stats ( l, &rl );
+    uint16_t ref_shift = ref_lmd ( l, d, ref_out );
+    uint64_t t1 = CYCLES();
+    spectrum_stats ( d, 0, N_SPEC_PIX, &sd );
+    spectrum_stats ( l, d, N_SPEC_PIX, &sl );
+    spectrum_light_minus_dark ( l, d, sl.up_shift, N_SPEC_PIX, new_out );
+    uint64_t t2 = CYCLES();
+
+    ref_cyc += t1 - t0;
+    new_cyc += t2 - t1;
+
+    Ref_Stats_t*      r[2] = { &rd, &rl };
+    Spectrum_Stats_t* s[2] = { &sd, &sl };
+    int k;
+    for ( k=0; k<2; k++ ) {
+      int bad_sdv = r[k]->sdv != s[k]->sdv;
+      if ( bad_sdv && r[k]->wrapped ) { wrapped++; bad_sdv = 0; }
+      if ( bad_sdv || r[k]->avg != s[k]->avg || r[k]->min != s[k]->min || r[k]->max != s[k]->max ) {
+        if ( mismatch++ < 10 )
+          fprintf ( stderr, "pair %d %s: %u %u %u %u vs %u %u %u %u\n", p, k ? "light" : "dark",
+                    r[k]->avg, r[k]->sdv, r[k]->min, r[k]->max, s[k]->avg, s[k]->sdv, s[k]->min, s[k]->max );
+      }
+    }
+    if ( ref_shift != sl.up_shift || memcmp ( ref_out, new_out, sizeof(ref_out) ) ) {
+      if ( mismatch++ < 10 )
+        fprintf ( stderr, "pair %d: light-minus-dark differs (shift %u vs %u)\n", p, ref_shift, sl.up_shift );
+    }
+  }
+
+  printf ( "code,pairs,cycles_per_pair,cycles_per_pixel,mismatches,former_wraps\n" );
+  printf ( "multi_pass,%d,%.0f,%.2f,,\n", pairs, (double)ref_cyc/pairs, (double)ref_cyc/pairs/N_SPEC_PIX/3 );
+  printf ( "single_pass,%d,%.0f,%.2f,%d,%d\n", pairs, (double)new_cyc/pairs, (double)new_cyc/pairs/N_SPEC_PIX/3, mismatch, wrapped );
+
+  free ( dark );
+  free ( light );
+  free ( rec );
+
+  return mismatch ? 1 : 0;
+}
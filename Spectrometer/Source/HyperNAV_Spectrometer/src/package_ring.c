@@ -0,0 +1,94 @@
+/*! \file package_ring.c *******************************************************
+ *
+ * \brief Single-producer / single-consumer ring of data package slots
+ *
+ *  Head and tail count modulo twice the depth,
+ *  so that a full ring is told apart from an empty one
+ *  without giving up a slot, for any depth.
+ *
+ ***************************************************************************/
+
+# include "package_ring.h"
+
+static uint16_t ring_used ( Package_Ring_t const* ring, uint16_t head, uint16_t tail ) {
+  return ( head >= tail ) ? head - tail : head + 2*ring->depth - tail;
+}
+
+int package_ring_init ( Package_Ring_t* ring, uint16_t depth ) {
+
+  if ( depth == 0 || depth > PACKAGE_RING_MAX_DEPTH ) {
+    ring->depth = 0;
+    return -1;
+  }
+
+  ring->depth      = depth;
+  ring->head       = 0;
+  ring->tail       = 0;
+  ring->high_water = 0;
+  ring->refused    = 0;
+
+  return 0;
+}
+
+int package_ring_claim ( Package_Ring_t* ring ) {
+
+  uint16_t head = ring->head;
+  uint16_t tail = ring->tail;
+
+  if ( ring->depth == 0 || ring_used ( ring, head, tail ) == ring->depth ) {
+    ring->refused++;
+    return -1;
+  }
+
+  //  The slot was released before tail moved on
+  PACKAGE_RING_BARRIER();
+
+  return head % ring->depth;
+}
+
+void package_ring_publish ( Package_Ring_t* ring ) {
+
+  uint16_t head = ring->head;
+
+  //  Slot contents first, then the index
+  PACKAGE_RING_BARRIER();
+
+  head = ( head + 1 == 2*ring->depth ) ? 0 : head + 1;
+  ring->head = head;
+
+  uint16_t used = ring_used ( ring, head, ring->tail );
+  if ( used > ring->high_water ) ring->high_water = used;
+}
+
+int package_ring_oldest ( Package_Ring_t* ring ) {
+
+  uint16_t head = ring->head;
+  uint16_t tail = ring->tail;
+
+  if ( ring->depth == 0 || head == tail ) {
+    return -1;
+  }
+
+  //  The index was read before the slot contents
+  PACKAGE_RING_BARRIER();
+
+  return tail % ring->depth;
+}
+
+void package_ring_release ( Package_Ring_t* ring ) {
+
+  uint16_t tail = ring->tail;
+
+  if ( ring->depth == 0 || ring->head == tail ) {
+    return;
+  }
+
+  //  Done with the slot contents, then the index
+  PACKAGE_RING_BARRIER();
+
+  ring->tail = ( tail + 1 == 2*ring->depth ) ? 0 : tail + 1;
+}
+
+uint16_t package_ring_used ( Package_Ring_t const* ring ) {
+  return ring->depth ? ring_used ( ring, ring->head, ring->tail ) : 0;
+}
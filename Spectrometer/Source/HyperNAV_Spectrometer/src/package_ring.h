@@ -0,0 +1,55 @@
+/*! \file package_ring.h *******************************************************
+ *
+ * \brief Single-producer / single-consumer ring of data package slots
+ *
+ *  The producer claims the next free slot, fills it, and publishes it.
+ *  The consumer takes published slots oldest first and releases them.
+ *  Each index is written by one side only, so producer and consumer
+ *  may run in different tasks without a lock.
+ *
+ *  In the data acquisition task both sides run in that one task:
+ *  the slots are handed to the data exchange task through the state
+ *  flag of their data package, not through the ring. adp_claim() releases
+ *  the oldest slots once data_package_emptied() (data_exchange.spectrometer.c)
+ *  flagged them empty, and its barrier orders the last access to the data
+ *  in front of the flag.
+ *
+ *  Pure C, so that the ring can be exercised on a host.
+ *
+ ***************************************************************************/
+
+# ifndef _PACKAGE_RING_H_
+# define _PACKAGE_RING_H_
+
+# include <stdint.h>
+
+//  Orders the slot contents before the index that hands them over.
+//  A compiler barrier suffices on the single-core AVR32.
+# ifndef PACKAGE_RING_BARRIER
+# define PACKAGE_RING_BARRIER() __asm__ __volatile__ ( "" ::: "memory" )
+# endif
+
+# define PACKAGE_RING_MAX_DEPTH 32767
+
+typedef struct {
+  uint16_t          depth;
+  uint16_t volatile head;        //  published, modulo 2*depth; producer only
+  uint16_t volatile tail;        //  released,  modulo 2*depth; consumer only
+  uint16_t          high_water;  //  most slots ever published and not released
+  uint32_t          refused;     //  claims that found the ring full
+} Package_Ring_t;
+
+//  Returns -1 for a depth of 0 or above PACKAGE_RING_MAX_DEPTH.
+int      package_ring_init    ( Package_Ring_t* ring, uint16_t depth );
+
+//  Producer
+int      package_ring_claim   ( Package_Ring_t* ring );  //  slot to fill, -1 if the ring is full
+void     package_ring_publish ( Package_Ring_t* ring );  //  hand the claimed slot over
+
+//  Consumer
+int      package_ring_oldest  ( Package_Ring_t* ring );  //  oldest published slot, -1 if none
+void     package_ring_release ( Package_Ring_t* ring );  //  give the oldest slot back
+
+uint16_t package_ring_used    ( Package_Ring_t const* ring );
+
+# endif
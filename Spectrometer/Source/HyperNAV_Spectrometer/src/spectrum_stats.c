@@ -0,0 +1,85 @@
+/*! \file spectrum_stats.c *******************************************************
+ *
+ * \brief Single pass statistics of dark and light spectra
+ *
+ *  Replaces the separate average, deviation/min/max and up-shift passes
+ *  of the acquisition task. Results are identical to the former code,
+ *  except that the sum of squared deviations no longer wraps at 2^32
+ *  (which it did for standard deviations above ~1450 counts).
+ *
+ ***************************************************************************/
+
+# include "spectrum_stats.h"
+
+//  Smallest r with r*r >= v, same as ceil(sqrt(v)) without floating point
+static uint32_t isqrt_ceil ( uint32_t v ) {
+
+  uint32_t r = 0;
+  uint32_t bit = 1UL << 30;
+
+  while ( bit > v ) bit >>= 2;
+
+  uint32_t x = v;
+  while ( bit ) {
+    if ( x >= r + bit ) {
+      x -= r + bit;
+      r = ( r >> 1 ) + bit;
+    } else {
+      r >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  //  r is now floor(sqrt(v)), x == v - r*r
+  return x ? r+1 : r;
+}
+
+void spectrum_stats ( uint16_t const* spectrum, uint16_t const* dark, int n, Spectrum_Stats_t* stats ) {
+
+  uint32_t sum   = 0;
+  uint64_t sumsq = 0;
+  uint16_t min   = 0xFFFF;
+  uint16_t max   = 0;
+  int32_t  shift = 0;
+  int px;
+
+  if ( dark ) {
+    for ( px=0; px<n; px++ ) {
+      uint32_t val = spectrum[px];
+      sum   += val;
+      sumsq += val*val;
+      if ( min > val ) min = val;
+      if ( max < val ) max = val;
+      int32_t d = (int32_t)dark[px] - (int32_t)val;
+      if ( shift < d ) shift = d;
+    }
+  } else {
+    for ( px=0; px<n; px++ ) {
+      uint32_t val = spectrum[px];
+      sum   += val;
+      sumsq += val*val;
+      if ( min > val ) min = val;
+      if ( max < val ) max = val;
+    }
+  }
+
+  //  The deviation is taken about the truncated mean, as it always was:
+  //  sum (v-a)^2 = sumsq - 2 a sum + n a^2, exact in 64 bit integers
+  uint32_t avg = n ? sum / n : 0;
+  uint64_t ssd = sumsq - 2 * (uint64_t)avg * sum + (uint64_t)n * avg * avg;
+  uint32_t var = n ? (uint32_t)( ssd / n ) : 0;
+
+  stats->avg      = avg;
+  stats->sdv      = isqrt_ceil ( var );
+  stats->min      = min;
+  stats->max      = max;
+  stats->up_shift = shift;
+}
+
+void spectrum_light_minus_dark ( uint16_t const* light, uint16_t const* dark, uint16_t up_shift, int n, uint16_t* out ) {
+
+  int px;
+  for ( px=0; px<n; px++ ) {
+    out[px] = up_shift + light[px] - dark[px];
+  }
+}
@@ -0,0 +1,32 @@
+/*! \file spectrum_stats.h *******************************************************
+ *
+ * \brief Single pass statistics of dark and light spectra
+ *
+ *  Pure C, no board or RTOS dependencies, so that the kernels
+ *  can be compiled and checked on a host.
+ *
+ ***************************************************************************/
+
+# ifndef _SPECTRUM_STATS_H_
+# define _SPECTRUM_STATS_H_
+
+# include <stdint.h>
+
+typedef struct {
+  uint16_t avg;       //  truncated mean
+  uint16_t sdv;       //  standard deviation about the truncated mean, rounded up
+  uint16_t min;
+  uint16_t max;
+  uint16_t up_shift;  //  max ( dark - spectrum ), 0 if no dark was given
+} Spectrum_Stats_t;
+
+//  Average, standard deviation, minimum and maximum of n pixels,
+//  accumulated in integers in one pass; the square root is taken once.
+//  If dark is not NULL, the same pass also finds the up-shift
+//  that keeps spectrum - dark non-negative.
+void spectrum_stats ( uint16_t const* spectrum, uint16_t const* dark, int n, Spectrum_Stats_t* stats );
+
+//  out[px] = up_shift + light[px] - dark[px]
+void spectrum_light_minus_dark ( uint16_t const* light, uint16_t const* dark, uint16_t up_shift, int n, uint16_t* out );
+
+# endif
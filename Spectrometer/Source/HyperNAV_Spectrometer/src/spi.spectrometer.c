@@ -12,10 +12,12 @@
 #include "board.h"
 #include "io_funcs.spectrometer.h"
 #include <gpio.h>
+#include <intc.h>
 #include <stdlib.h>
 #include <string.h>
 #include <FreeRTOS.h>
 #include <task.h>
+#include <semphr.h>
 #include <time.h>
 #include <sys/time.h>
 
@@ -57,6 +59,63 @@ SPI_Indicator_t SPI_Get_OtherBoard_Indicator() {
   return gpio_get_pin_value( CTRL_RDY ) ? SPI_IND_Passive : SPI_IND_Active;
 }
 
+static xSemaphoreHandle wakeSemaphore = NULL;
+
+static void SPI_OtherBoard_Active_ISR(void) __attribute__ ((naked));
+
+//  See the note on FreeRTOS interrupt service routines in power.spectrometer.c
+__attribute__ ((__noinline__))
+static portBASE_TYPE SPI_OtherBoard_Active_ISR_non_naked(void) {
+
+  portBASE_TYPE xHigherPrioTaskWoken = pdFALSE;
+
+  if ( gpio_get_pin_interrupt_flag( CTRL_RDY ) ) {
+
+    if ( wakeSemaphore ) {
+      portENTER_CRITICAL();
+      xSemaphoreGiveFromISR( wakeSemaphore, &xHigherPrioTaskWoken );
+      portEXIT_CRITICAL();
+    }
+
+    gpio_clear_pin_interrupt_flag( CTRL_RDY );
+  }
+
+  return xHigherPrioTaskWoken;
+}
+
+__attribute__((__naked__))
+static void SPI_OtherBoard_Active_ISR(void) {
+  portENTER_SWITCHING_ISR();
+  SPI_OtherBoard_Active_ISR_non_naked();
+  portEXIT_SWITCHING_ISR();
+}
+
+//! \brief   Give a semaphore whenever the other board's indicator turns Active
+void SPI_Wake_On_OtherBoard_Active( xSemaphoreHandle wake ) {
+
+  static Bool configured = FALSE;
+
+  if ( !configured ) {
+
+    //  The ready line is active low and stays a GPIO input:
+    //  a pin change interrupt on the falling edge.
+    Disable_global_interrupt();
+    INTC_register_interrupt( &SPI_OtherBoard_Active_ISR, CTRL_RDY_IRQ, CTRL_RDY_PRIO );
+    Enable_global_interrupt();
+
+    configured = TRUE;
+  }
+
+  gpio_disable_pin_interrupt( CTRL_RDY );
+
+  wakeSemaphore = wake;
+
+  if ( wake ) {
+    gpio_clear_pin_interrupt_flag( CTRL_RDY );
+    gpio_enable_pin_interrupt( CTRL_RDY, GPIO_FALLING_EDGE );
+  }
+}
+
 
 //! \brief   Clear out any remaining data from hardware RX buffer
 //! @return  The number of bytes that were present
@@ -509,3 +568,31 @@ int16_t SPI_tx_packet(uint8_t* header, int16_t const header_size, uint8_t* data,
     // Return the number of bytes sent
     return return_value;
 }
+
+
+//! \brief  spi_link transport: send one frame to the controller board
+//!
+//!  The frame goes as the packet header, without packet data.
+//!
+//! @return  The frame size, or the negative SPI_tx_packet() code
+int32_t SPI_link_send( __attribute__((unused)) void* context, uint8_t* frame, uint16_t size ) {
+
+    int16_t tx_size = 0;
+    int16_t status  = SPI_tx_packet( frame, size, 0, 0, &tx_size );
+
+    return status < 0 ? status : tx_size;
+}
+
+//! \brief  spi_link transport: receive one frame, if the controller board has one
+//!
+//!  The frame goes into the packet data, in RAM.
+//!
+//! @return  The frame size, 0 if the other board is passive, or the negative SPI_rx_packet() code
+int32_t SPI_link_receive( __attribute__((unused)) void* context, uint8_t* frame, uint16_t max_size ) {
+
+    if ( SPI_IND_Passive == SPI_Get_OtherBoard_Indicator() ) {
+      return 0;
+    }
+
+    return SPI_rx_packet( 0, 0, frame, 0, max_size );
+}
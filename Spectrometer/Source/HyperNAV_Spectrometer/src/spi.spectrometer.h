@@ -15,6 +15,9 @@
 
 #include "smc_sram.h"  //  Needed to ensure sram adressing done properly
 
+#include <FreeRTOS.h>
+#include <semphr.h>
+
 #define FALSE 0
 #define TRUE  1
 
@@ -36,6 +39,15 @@ SPI_Indicator_t SPI_Get_MyBoard_Indicator(void);
 //! @return  SPI_IND_Active or SPI_IND_Passive
 SPI_Indicator_t SPI_Get_OtherBoard_Indicator(void);
 
+//! \brief   Give a semaphore whenever the other board's indicator turns Active
+//!
+//!  Lets a task block on the semaphore instead of polling the indicator.
+//!  It is given at each falling edge of the ready line; a binary semaphore
+//!  holds a single wake-up, however many edges come before it is taken.
+//!
+//! @param   wake     A binary semaphore, NULL to stop giving
+void SPI_Wake_On_OtherBoard_Active( xSemaphoreHandle wake );
+
 # if 0
 //! \brief  Is a received packet available?
 //! @return	TRUE: packet available, FALSE: no packet available
@@ -86,4 +98,12 @@ int32_t SPI_rx_packet(uint8_t* header, int16_t header_size, uint8_t* data_ram, s
 //!
 int16_t SPI_tx_packet(uint8_t* header, int16_t header_size, uint8_t* data, int16_t data_size, int16_t* tx_size );
 
+//! \brief  spi_link transport: send one frame to the controller board
+//! @return  The frame size, or the negative SPI_tx_packet() code
+int32_t SPI_link_send( void* context, uint8_t* frame, uint16_t size );
+
+//! \brief  spi_link transport: receive one frame, if the controller board has one
+//! @return  The frame size, 0 if the other board is passive, or the negative SPI_rx_packet() code
+int32_t SPI_link_receive( void* context, uint8_t* frame, uint16_t max_size );
+
 #endif /* SPI.SPECTROMETER_H_ */
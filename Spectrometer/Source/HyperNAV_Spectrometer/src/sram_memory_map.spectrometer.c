@@ -30,6 +30,11 @@ typedef union {
 
 # define ANY_DATA_BLOCK_SIZE (BLOCK_MULTIPLE*(1+(sizeof(any_local_data_t)-1)/BLOCK_MULTIPLE))
 
+//  The SRAM_*_START values are word indices into the 16-bit SRAM.
+//  Every sram_pointer2 handed out adds them to the chip select base SRAM_U16.
+
+# define SRAM_WORD(index) (SRAM_U16 + (index))
+
 //  The data exchange tasks needs:
 //    2 x Arbitrary Data Items
 //    May receive two spec data packets in quick succession from data acquisition
@@ -37,15 +42,27 @@ typedef union {
 
 # define SRAM_DX_START SPEC_GND_END_TIME_ADDR	
 
-sram_pointer2 const sram_DXS_1 = (sram_pointer2) SRAM_DX_START;
-sram_pointer2 const sram_DXS_2 = (sram_pointer2) (SRAM_DX_START + ANY_DATA_BLOCK_SIZE/2);
+sram_pointer2 const sram_DXS_1 = SRAM_WORD( SRAM_DX_START );
+sram_pointer2 const sram_DXS_2 = SRAM_WORD( SRAM_DX_START + ANY_DATA_BLOCK_SIZE/2 );
 
 //  Profile manager
 //    1 x Profile_*_Packet for transmit to Spec Board
 
 # define SRAM_PM_START (SRAM_DX_START + 2*(ANY_DATA_BLOCK_SIZE/2))
 
-sram_pointer2 const sram_PMG = (sram_pointer2)SRAM_PM_START;
+sram_pointer2 const sram_PMG = SRAM_WORD( SRAM_PM_START );
+
+//  Data acquisition
+//    SRAM_DAQ_SLOTS x Spectrometer_Data_t
+
+# define DAQ_BLOCK_SIZE (BLOCK_MULTIPLE*(1+(sizeof(Spectrometer_Data_t)-1)/BLOCK_MULTIPLE))
+
+# define SRAM_DAQ_START (SRAM_PM_START + ANY_DATA_BLOCK_SIZE/2)
+
+sram_pointer2 sram_DAQ ( int slot ) {
+  if ( slot < 0 || slot >= SRAM_DAQ_SLOTS ) return (sram_pointer2)0;
+  return SRAM_WORD( SRAM_DAQ_START + slot*(DAQ_BLOCK_SIZE/2) );
+}
 
 # if 0
 bool sram_memory_sufficient() {
@@ -74,20 +91,35 @@ void sram_sram_copy2 ( sram_pointer sram_destination, sram_pointer sram_source,
 }
 # endif
 
+//  Both copies move whole 16-bit words, the width of the SRAM bus.
+//  An odd last byte travels alone in the low byte of one more word,
+//  so that neither side is accessed past nBytes.
+
 void copy_to_ram_from_sram( uint8_t* ram, sram_pointer2 sram, size_t nBytes ) {
 
-# if 1
   uint16_t* ram2 = (uint16_t*)ram;
-  for ( int i=0; i<(nBytes/2); i++ ) {
+  size_t i;
+  for ( i=0; i<nBytes/2; i++ ) {
     ram2[i] = sram[i];
   }
-# else
-  for ( int i=0; i<nBytes; i+=2 ) {
-    union { uint8_t u8[2]; uint16_t u16 } d;
-    d.u16 = sram_pointer2[i/2];
-    ram[i  ] = d.u8[0];
-    ram[i+1] = d.u8[1];
+  if ( nBytes & 1 ) {
+    union { uint8_t u8[2]; uint16_t u16; } d;
+    d.u16 = sram[i];
+    ram[nBytes-1] = d.u8[0];
   }
-# endif
 }
 
+void copy_to_sram_from_ram( sram_pointer2 sram, uint8_t const* ram, size_t nBytes ) {
+
+  uint16_t const* ram2 = (uint16_t const*)ram;
+  size_t i;
+  for ( i=0; i<nBytes/2; i++ ) {
+    sram[i] = ram2[i];
+  }
+  if ( nBytes & 1 ) {
+    union { uint8_t u8[2]; uint16_t u16; } d;
+    d.u8[0] = ram[nBytes-1];
+    d.u8[1] = 0;
+    sram[i] = d.u16;
+  }
+}
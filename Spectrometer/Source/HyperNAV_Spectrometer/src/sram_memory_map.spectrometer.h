@@ -36,6 +36,14 @@ extern sram_pointer2 const sram_DXS_2;
 
 extern sram_pointer2 const sram_PMG;
 
+//  Data acquisition
+//    SRAM_DAQ_SLOTS x Spectrometer_Data_t,
+//    where acquired spectra spill when the RAM packages are in use
+
+# define SRAM_DAQ_SLOTS 12
+
+sram_pointer2 sram_DAQ ( int slot );
+
 //  API
 
 //bool sram_memory_sufficient(void);
@@ -45,5 +53,6 @@ extern sram_pointer2 const sram_PMG;
 //void sram_sram_copy2 ( sram_pointer sram_destination, sram_pointer sram_source, size_t num_2bytes );
 
 void copy_to_ram_from_sram( uint8_t* ram, sram_pointer2 sram, size_t nBytes );
+void copy_to_sram_from_ram( sram_pointer2 sram, uint8_t const* ram, size_t nBytes );
 
 #endif /* _SRAM_MEMORY_MAP_CONTROLLER_H_ */
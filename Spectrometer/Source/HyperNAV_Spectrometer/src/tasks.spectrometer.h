@@ -49,6 +49,7 @@ extern taskStatus_t gHNV_SetupCmdSpecTask_Status;
 # define HNV_DataXSpectrmTask_STACK_SIZE  (1024+256+128)
 # define HNV_DataXSpectrmTask_PRIORITY    (tskIDLE_PRIORITY + 2)
 # define HNV_DataXSpectrmTask_PERIOD_MS   200
+# define HNV_DataXSpectrmTask_IDLE_MS     1000   //  Longest sleep while waiting for packets
 extern xTaskHandle  gHNV_DataXSpectrmTask_Handler;
 extern taskStatus_t gHNV_DataXSpectrmTask_Status;
 
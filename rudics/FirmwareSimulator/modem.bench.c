@@ -0,0 +1,246 @@
+/*
+ *  File: modem.bench.c
+ *
+ *  Benchmark of the modem input of the firmware simulator.
+ *
+ *  A profile is sent at a simulated baud rate into the master of a raw
+ *  pseudo-tty; the slave is the modem serial port. It is received once
+ *  the way MDM_getbuf() used to read (one nonblocking read() per byte,
+ *  time() for the time-out), and once through the read-ahead ring of
+ *  modem.c (MDM_expect() for the leading prompt, then MDM_getn()).
+ *  Reported per mode are CPU time and read()/readv()/poll() calls,
+ *  per transferred byte.
+ */
+
+# define _GNU_SOURCE
+
+# include <errno.h>
+# include <fcntl.h>
+# include <pthread.h>
+# include <pty.h>
+# include <stdarg.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <termios.h>
+# include <time.h>
+# include <unistd.h>
+# include <poll.h>
+# include <sys/ioctl.h>
+# include <sys/resource.h>
+# include <sys/uio.h>
+
+# include "modem.h"
+# include "syslog.h"
+
+# define LEADER "Modem input benchmark"
+# define PROMPT "BEGIN\r\n"
+
+//  Syscalls of the receiving side, counted by linking with --wrap
+static unsigned long n_read, n_readv, n_poll;
+
+ssize_t __real_read  ( int fd, void* buf, size_t count );
+ssize_t __real_readv ( int fd, const struct iovec* iov, int iovcnt );
+int     __real_poll  ( struct pollfd* fds, nfds_t nfds, int timeout );
+
+ssize_t __wrap_read  ( int fd, void* buf, size_t count )                { n_read++;  return __real_read  ( fd, buf, count ); }
+ssize_t __wrap_readv ( int fd, const struct iovec* iov, int iovcnt )    { n_readv++; return __real_readv ( fd, iov, iovcnt ); }
+int     __wrap_poll  ( struct pollfd* fds, nfds_t nfds, int timeout )   { n_poll++;  return __real_poll  ( fds, nfds, timeout ); }
+
+//  syslog.c is not built here
+void syslog_out ( syslogVerbosity_t v, const char* func, const char* fmt, ... ) {
+  if ( v <= SYSLOG_ERROR ) {
+    va_list ap;
+    va_start ( ap, fmt );
+    fprintf ( stderr, "%s: ", func );
+    vfprintf ( stderr, fmt, ap );
+    fprintf ( stderr, "\n" );
+    va_end ( ap );
+  }
+}
+
+static double Now () {
+  struct timespec t;
+  clock_gettime ( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+static double ThreadCPU () {
+  struct rusage ru;
+  getrusage ( RUSAGE_THREAD, &ru );
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + 1e-6*( ru.ru_utime.tv_usec + ru.ru_stime.tv_usec );
+}
+
+//  Sender: prompt, then profile, paced at baud/10 bytes per second
+typedef struct {
+  int            fd;
+  uint32_t       baud;
+  const uint8_t* data;
+  size_t         size;
+} sender_t;
+
+static void* Send ( void* arg ) {
+
+  sender_t const* s = (sender_t const*) arg;
+
+  if ( write ( s->fd, PROMPT, strlen(PROMPT) ) < 0 ) return NULL;
+
+  double const t0 = Now();
+  size_t sent = 0;
+
+  while ( sent < s->size ) {
+    size_t due = (size_t)( ( Now() - t0 ) * s->baud / 10 ) + 1;
+    if ( due > s->size ) due = s->size;
+    if ( due > sent ) {
+      ssize_t const n = write ( s->fd, s->data + sent, due - sent );
+      if ( n < 0 && errno != EAGAIN ) break;
+      if ( n > 0 ) sent += n;
+    }
+    usleep ( 2000 );
+  }
+  return NULL;
+}
+
+//  The former MDM_getb() and MDM_getbuf()
+static int legacy_getb ( int fd, char* byte ) {
+  return read ( fd, byte, 1 );
+}
+
+static int legacy_getbuf ( int fd, char* buf, int size, time_t sec ) {
+
+  time_t To=0, T=To;
+  int n=0;
+
+  do {
+    if( legacy_getb( fd, &buf[n] ) > 0 ) {
+      n++;
+    } else {
+      T=time(NULL);
+      if ( 0 == To) {
+        To=T;
+      }
+      if ( difftime(T,To)>sec ) {
+        break;
+      }
+    }
+  } while (n<size);
+
+  return n;
+}
+
+static int Bench ( const char* mode, uint32_t baud, const uint8_t* profile, size_t size, int chunk ) {
+
+  int master, slave;
+  char name[64];
+
+  if ( openpty ( &master, &slave, name, NULL, NULL ) ) {
+    perror ( "openpty" );
+    return -1;
+  }
+
+  struct termios raw;
+  tcgetattr ( master, &raw ); cfmakeraw ( &raw ); tcsetattr ( master, TCSANOW, &raw );
+  tcgetattr ( slave,  &raw ); cfmakeraw ( &raw ); tcsetattr ( slave,  TCSANOW, &raw );
+
+  int legacy_fd = -1;
+  int const legacy = !strcmp ( mode, "per_byte" );
+
+  if ( legacy ) {
+    legacy_fd = open ( name, O_RDWR | O_NOCTTY );
+    int nb = 1;
+    ioctl ( legacy_fd, FIONBIO, &nb );
+  } else if ( MDM_open_serial_port ( name, baud ) ) {
+    return -1;
+  }
+
+  char* got = malloc ( size+1 );
+
+  sender_t s = { master, baud, profile, size };
+  pthread_t sender;
+
+  n_read = n_readv = n_poll = 0;
+  double const t0   = Now();
+  double const cpu0 = ThreadCPU();
+
+  pthread_create ( &sender, NULL, Send, &s );
+
+  size_t n = 0;
+  int ok;
+
+  if ( legacy ) {
+    char prompt[sizeof(PROMPT)];
+    ok = (int)strlen(PROMPT) == legacy_getbuf ( legacy_fd, prompt, strlen(PROMPT), 5 );
+    while ( ok && n < size ) {
+      int const r = legacy_getbuf ( legacy_fd, got+n, size-n < (size_t)chunk ? size-n : chunk, 5 );
+      if ( r <= 0 ) break;
+      n += r;
+    }
+  } else {
+    ok = MDM_expect ( PROMPT, "", 5, NULL ) > 0;
+    while ( ok && n < size ) {
+      int const r = MDM_getn ( got+n, size-n < (size_t)chunk ? size-n : chunk, 5000 );
+      if ( r <= 0 ) break;
+      n += r;
+    }
+  }
+
+  double const cpu  = ThreadCPU() - cpu0;
+  double const wall = Now() - t0;
+  unsigned long const calls = n_read + n_readv + n_poll;
+
+  pthread_join ( sender, NULL );
+
+  ok = ok && n == size && !memcmp ( got, profile, size );
+
+  printf ( "%s,%lu,%zu,%.2f,%.1f,%.3f,%lu,%lu,%lu,%.4f,%s\n",
+           mode, (unsigned long)baud, size, wall, 1e3*cpu, 1e6*cpu/size,
+           n_read, n_readv, n_poll, (double)calls/size, ok ? "ok" : "FAILED" );
+
+  free ( got );
+  if ( legacy_fd >= 0 ) close ( legacy_fd );
+  close ( slave );
+  close ( master );
+  return ok ? 0 : 1;
+}
+
+static void PrintUsage ( const char* pn ) {
+  printf ( "%s\n", LEADER );
+  printf ( "usage: %s [-k KB] [-b baud] [-c chunk]\n", pn );
+  printf ( "   -k  Profile size in kB [default: 48]\n" );
+  printf ( "   -b  Simulated baud rate [default: 57600]\n" );
+  printf ( "   -c  Bytes asked for per read call [default: 1024]\n" );
+}
+
+int main ( int argc, char** argv ) {
+
+  size_t kb = 48;
+  uint32_t baud = 57600;
+  int chunk = 1024;
+  int opt;
+
+  while ( ( opt = getopt ( argc, argv, "?hk:b:c:" ) ) != EOF ) {
+    switch ( opt ) {
+    case 'k': kb    = atol ( optarg ); break;
+    case 'b': baud  = atol ( optarg ); break;
+    case 'c': chunk = atoi ( optarg ); break;
+    default : PrintUsage ( argv[0] ); return 0;
+    }
+  }
+  if ( !kb || baud < 300 || chunk < 1 ) { PrintUsage ( argv[0] ); return 0; }
+
+  //  Compressed, ASCII85 encoded profile data look random
+  size_t const size = kb*1024;
+  uint8_t* profile = malloc ( size );
+  size_t i;
+  srand ( 5037 );
+  for ( i=0; i<size; i++ ) profile[i] = '!' + rand() % 85;
+
+  printf ( "mode,baud,bytes,seconds,cpu_ms,cpu_us_per_byte,reads,readvs,polls,syscalls_per_byte,data\n" );
+
+  int fail = 0;
+  fail |= Bench ( "per_byte", baud, profile, size, chunk );
+  fail |= Bench ( "buffered", baud, profile, size, chunk );
+
+  free ( profile );
+  return fail;
+}
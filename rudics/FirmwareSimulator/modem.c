@@ -9,6 +9,8 @@
 # include <string.h>
 # include <errno.h>
 # include <unistd.h>
+# include <poll.h>
+# include <sys/uio.h>
 # else
 # endif
 
@@ -18,7 +20,96 @@
 # include "syslog.h"
 
 # ifdef FW_SIMULATION
-static int serial_port_fd = -1;
+//  Received bytes are taken from a ring, which is filled
+//  by one readv() of whatever the port has, up to the ring size.
+//  Waits for input are poll() calls with millisecond deadlines.
+# define MDM_RX_RING 4096
+
+typedef struct {
+  int      fd;
+  uint16_t head;                  /*  Next byte to take  */
+  uint16_t count;                 /*  Bytes in the ring  */
+  char     ring[MDM_RX_RING];
+} mdm_port_t;
+
+static mdm_port_t modem_port = { -1, 0, 0 };
+
+static int64_t mdm_now_ms() {
+  struct timespec now;
+  clock_gettime ( CLOCK_MONOTONIC, &now );
+  return (int64_t)now.tv_sec*1000 + now.tv_nsec/1000000;
+}
+
+//  Wait until the port has input, up to timeout_ms, and read it into the ring
+//  return  n>0 : bytes read
+//            0 : no input, or ring full
+//           -1 : error, or end of input
+static int mdm_fill ( mdm_port_t* port, int64_t timeout_ms ) {
+
+  if ( port->fd < 0 ) {
+    return -1;
+  }
+
+  if ( port->count == MDM_RX_RING ) {
+    return 0;
+  }
+
+  struct pollfd pfd = { port->fd, POLLIN, 0 };
+
+  int const ready = poll ( &pfd, 1, timeout_ms > 0 ? (int)timeout_ms : 0 );
+  if ( ready <= 0 ) {
+    return ( ready < 0 && errno != EINTR ) ? -1 : 0;
+  }
+
+  uint16_t const tail = ( port->head + port->count ) % MDM_RX_RING;
+
+  struct iovec iov[2];
+  iov[0].iov_base = port->ring + tail;
+  iov[0].iov_len  = ( tail >= port->head ) ? MDM_RX_RING - tail : port->head - tail;
+  iov[1].iov_base = port->ring;
+  iov[1].iov_len  = ( tail >= port->head ) ? port->head : 0;
+
+  ssize_t const n = readv ( port->fd, iov, iov[1].iov_len ? 2 : 1 );
+
+  if ( n > 0 ) {
+    port->count += n;
+    return n;
+  } else if ( n < 0 && ( errno == EAGAIN || errno == EINTR ) ) {
+    return 0;
+  } else {
+    return -1;
+  }
+}
+
+//  Take up to size bytes, waiting for input until the deadline
+//  return  n>0 : bytes taken
+//            0 : deadline passed
+//           -1 : error
+static int mdm_take ( mdm_port_t* port, char* buf, int size, int64_t deadline ) {
+
+  while ( 0 == port->count ) {
+    int64_t const left = deadline - mdm_now_ms();
+    int const filled = mdm_fill ( port, left );
+    if ( filled < 0 ) {
+      return -1;
+    }
+    if ( 0 == filled && left <= 0 ) {
+      return 0;
+    }
+  }
+
+  int n = 0;
+  while ( n < size && port->count ) {
+    int chunk = MDM_RX_RING - port->head;
+    if ( chunk > port->count ) chunk = port->count;
+    if ( chunk > size - n ) chunk = size - n;
+    memcpy ( buf + n, port->ring + port->head, chunk );
+    port->head   = ( port->head + chunk ) % MDM_RX_RING;
+    port->count -= chunk;
+    n += chunk;
+  }
+  return n;
+}
 # endif
 
 static char* asPrintStr( char c ) {
@@ -41,9 +132,9 @@ static uint32_t GetBaudCode( uint32_t baud) {
   switch(baud) {
   case    9600: return B9600;
   case   19200: return B19200;
-//case   38400: return B38400;
-//case   57600: return B57600;
-//case  115200: return B115200;
+  case   38400: return B38400;
+  case   57600: return B57600;
+  case  115200: return B115200;
 //case  230400: return B230400;
   default     : return B9600;
   }
@@ -123,7 +214,9 @@ int MDM_open_serial_port ( char* serial_device, uint32_t baudrate ) {
     return -1;
   }
 
-  serial_port_fd = serial_port;
+  modem_port.fd    = serial_port;
+  modem_port.head  = 0;
+  modem_port.count = 0;
 
   return 0;
 }
@@ -235,20 +328,26 @@ int16_t MDM_cd() {
 }
 
 # ifdef FW_SIMULATION
-# warning "MDM_*Flush() are no-op"
+# warning "MDM_OFlush() is no-op"
 # else
 # error "MDM_*Flush() not implemented."
 # endif
-uint16_t MDM_IFlush()  { return 0; }
+uint16_t MDM_IFlush()  {
+  //  Drop what was read ahead into the ring
+  uint16_t const flushed = modem_port.count;
+  modem_port.head  = 0;
+  modem_port.count = 0;
+  return flushed;
+}
 uint16_t MDM_OFlush()  { return 0; }
-uint16_t MDM_IOFlush() { return 0; }
+uint16_t MDM_IOFlush() { return MDM_IFlush() + MDM_OFlush(); }
 
 # ifdef FW_SIMULATION
-# warning "MDM_[I|O]Bytes() are no-op"
+# warning "MDM_OBytes() is no-op"
 # else
 # error "MDM_[I|O]Bytes() not implemented."
 # endif
-uint16_t MDM_IBytes() { return 0; }
+uint16_t MDM_IBytes() { return modem_port.count; }
 uint16_t MDM_OBytes() { return 0; }
 
 int16_t MDM_putb( char byte ) {
@@ -258,7 +357,7 @@ int16_t MDM_putb( char byte ) {
   }
 
 # ifdef FW_SIMULATION
-  return write ( serial_port_fd, &byte, 1 );
+  return write ( modem_port.fd, &byte, 1 );
 # else
 # error "MDM_putb() not implemented." 
   return 0;
@@ -272,13 +371,80 @@ int16_t MDM_getb( char* byte ) {
   }
 
 # ifdef FW_SIMULATION
-  return read ( serial_port_fd, byte, 1 );
+  //  Does not wait: a byte from the ring, or whatever the port has now
+  return mdm_take ( &modem_port, byte, 1, 0 );
 # else
 # error "MDM_getb() not implemented." 
   return 0;
 # endif
 }
 
+//  Get a byte, waiting until the deadline [ms, mdm_now_ms()] for it
+static int16_t mdm_getb_until ( char* byte, int64_t deadline ) {
+
+  if ( !MDM_cd() ) {
+    return -1;
+  }
+
+# ifdef FW_SIMULATION
+  return mdm_take ( &modem_port, byte, 1, deadline );
+# else
+# error "mdm_getb_until() not implemented." 
+  return 0;
+# endif
+}
+
+/*---------------------------------------------------------------------*/
+/* function to read a number of bytes from the serial port             */
+/*---------------------------------------------------------------------*/
+/**
+   This function reads size bytes from the serial port, unless a time-out
+   period of msec milliseconds elapses first.  Bytes are taken from the
+   read-ahead ring; the function sleeps in poll() while there is no input.
+
+      output:
+
+         buf.....The buffer into which the bytes are stored (not NUL
+                 terminated).
+
+         This function returns the number of bytes read (less than size
+         on time-out), or -1 if there is no carrier or an error occurred
+         before any byte was read.
+*/
+int16_t MDM_getn( void* vbuf, int size, int32_t msec ) {
+
+  if ( !MDM_cd() ) {
+    return -1;
+  }
+
+  if( !vbuf || size<0 ) {
+    return -1;
+  }
+
+# ifdef FW_SIMULATION
+  int64_t const deadline = mdm_now_ms() + ( msec > 0 ? msec : 0 );
+
+  char* buf = (char*) vbuf;
+  int n = 0;
+
+  while ( n < size ) {
+    int const got = mdm_take ( &modem_port, buf+n, size-n, deadline );
+    if ( got < 0 ) {
+      return n ? n : -1;
+    }
+    if ( 0 == got ) {
+      break;
+    }
+    n += got;
+  }
+
+  return n;
+# else
+# error "MDM_getn() not implemented." 
+  return 0;
+# endif
+}
+
 /*---------------------------------------------------------------------*/
 /* function to read bytes from the serial port                         */
 /*---------------------------------------------------------------------*/
@@ -304,10 +470,7 @@ int16_t MDM_getb( char* byte ) {
 
          sec.....The maximum amount of time (measured in seconds) that this
                  function will attempt to read bytes from the serial port
-                 before returning to the calling function.  Due to the
-                 limited (ie., 1 sec) resolution of the time() function, the
-                 actuall timeout period will be somewhere in the semiclosed
-                 interval [sec,sec+1) if sec>0.
+                 before returning to the calling function.
          
       output:
 
@@ -336,32 +499,12 @@ int16_t MDM_getbuf( void* vbuf, int size, time_t sec) {
 
   if ( sec < 0 ) sec = 0;
 
-  time_t To=0, T=To;              /*  Record the current time */
-
-  int n=0;                        /*  To record (&return) the number of bytes that have been read  */
-  buf[0]=0;                       /*  NUL terminare buffer read so far  */
-      
-  do {
-                                  /*  attempt to read the next byte from the serial port */
-    if( MDM_getb( &buf[n] ) > 0 ) {
-
-      n++;
-      buf[n]=0;
-
-    } else {
-
-      T=time(NULL);               /*  get the current time */
-      if ( 0 == To) {
-	To=T;
-      }
+  int n = MDM_getn( buf, size, 1000*sec );  /*  Read up to size bytes, sec seconds at most  */
+  if ( n < 0 ) n = 0;
 
-      if ( difftime(T,To)>sec ) { /*  Check time-related exit criteria */
-        break;
-      }
-    }
-  } while (n<size);               /*  Check termination criteria */
+  buf[n]=0;                       /*  NUL terminate buffer read */
    
-   return n;
+  return n;
 }
 
 /*------------------------------------------------------------------------*/
@@ -393,11 +536,8 @@ int16_t MDM_getbuf( void* vbuf, int size, time_t sec) {
                  serial port.
 
          sec.....The maximum amount of time (measured in seconds) that this
-j                function will attempt to read bytes from the serial port
-                 before returning to the calling function.  Due to the
-                 limited (ie., 1 sec) resolution of the time() function, the
-                 actuall timeout period will be somewhere in the semiclosed
-                 interval [sec,sec+1) if sec>0.
+                 function will attempt to read bytes from the serial port
+                 before returning to the calling function.
 
          trm.....The termination string.  For example, if the termination
                  string is "\r\n" then once this string is read from the
@@ -435,34 +575,24 @@ int16_t MDM_gets( char* buf, int size, time_t sec, const char* trm) {
   int trmlen=strlen(trm);         /*  Length of the termination string */
   int trm_found=0;                /*  [0|1] Flag; asserted when termination string found */
 
-  time_t To=0, T=To;              /*  Record the current time */
+  int64_t const deadline = mdm_now_ms() + 1000*sec;  /*  Time-out  */
       
   int n=0;                        /*  To record (&return) the number of bytes that have been read  */
   buf[0]=0;                       /*  NUL terminare buffer read so far  */
       
   do {
-                                  /*  attempt to read the next byte from the serial port */
-    if( MDM_getb( &buf[n] ) > 0 ) {
+                                  /*  read the next byte from the serial port, or time out */
+    if( mdm_getb_until( &buf[n], deadline ) <= 0 ) {
+      break;
+    }
 
-      n++;
-      buf[n]=0;
+    n++;
+    buf[n]=0;
                                   /*  check for the line terminator string */
-      if( n>=trmlen && !strcmp(buf+n-trmlen,trm) ) {
+    if( n>=trmlen && !strcmp(buf+n-trmlen,trm) ) {
 
                                   /*  remove the termination string from the buffer */
-        trm_found=1; buf[n-trmlen]=0;
-      }
-         
-    } else {
-
-      T=time(NULL);               /*  get the current time */
-      if ( 0 == To) {
-	To=T;
-      }
-
-      if ( difftime(T,To)>sec ) { /*  Check time-related exit criteria */
-        break;
-      }
+      trm_found=1; buf[n-trmlen]=0;
     }
   } while (n<size && !trm_found); /* check termination criteria */
    
@@ -728,8 +858,6 @@ int16_t MDM_chat( const char* cmd, const char* expect, time_t sec, const char *t
 
   MDM_IOFlush();
 
-  if (sec==1) sec=2;                                   /*  Work around a time descretization problem */
-
   const unsigned char wait_char = '~';                 /*  If finding this character in command...  */
   const time_t        wait_period = 1;                 /*  ... wait for this duration [seconds]  */
 
@@ -759,32 +887,22 @@ int16_t MDM_chat( const char* cmd, const char* expect, time_t sec, const char *t
       
   if (*expect) {                                       /*  If non-empty expected response,
 							   Seek the expect string in the response  */
-    char byte; int n=0;
+    char byte;
 
-    time_t To=time((time_t*)0),T=To;                   /*  get the reference time */
+    int64_t const deadline = mdm_now_ms() + 1000*sec;  /*  Time-out  */
          
     int const explen = strlen(expect);                 /*  compute the length of the prompt string */
       
     i=0;                                               /*  define the index of prompt string */
 
-    do {
+    while ( mdm_getb_until(&byte, deadline) > 0 ) {    /*  read the next byte from the serial port, or time out */
 
-      if( MDM_getb(&byte) > 0 ) {                      /*  read the next byte from the serial port */
-
-        syslog_out ( SYSLOG_DEBUG, FuncName, "Received %s", asPrintStr(byte) );
+      syslog_out ( SYSLOG_DEBUG, FuncName, "Received %s", asPrintStr(byte) );
                
-        if (byte==expect[i]) {i++;} else i=0;          /* check if the current byte matches the expected byte from the prompt */
+      if (byte==expect[i]) {i++;} else i=0;            /* check if the current byte matches the expected byte from the prompt */
 
-        if (i>=explen) {status=1; break;}              /* the expect-string has been found if the index (i) matches its length */
-
-        if (n<0 || n>25) {T=time((time_t*)0); n=0;} else n++; /* don't allow too many bytes to be read between time checks */
-
-      } else {
-
-        T=time((time_t*)0);                            /*  get the current time */
-      }
-
-    } while (T>=0 && To>=0 && difftime(T,To)<sec); /* check the termination conditions */
+      if (i>=explen) {status=1; break;}                /* the expect-string has been found if the index (i) matches its length */
+    }
 
     if (status<=0) {
       syslog_out( SYSLOG_ERROR, FuncName, "Expected string [%s] not received.", expect);
@@ -851,31 +969,21 @@ int16_t MDM_expect( const char *prompt, const char *response, time_t sec, const
   int status=0;                                        /* initialize the return value */
 
   char byte;
-  int n=0;
 
-  time_t To=time((time_t*)0),T=To;                     /*  get the reference time */
+  int64_t const deadline = mdm_now_ms() + 1000*sec;    /*  Time-out  */
 
   int const promptLen = strlen(prompt);                /*  compute the length of the prompt string */
 
   int i=0;                                             /*  define the index of prompt string */
 
-  do {
-
-    if ( MDM_getb(&byte) > 0 ) {                       /*  read the next byte from the serial port */
+  while ( mdm_getb_until(&byte, deadline) > 0 ) {      /*  read the next byte from the serial port, or time out */
 
-      syslog_out ( SYSLOG_DEBUG, FuncName, "Received %s", asPrintStr(byte) );
+    syslog_out ( SYSLOG_DEBUG, FuncName, "Received %s", asPrintStr(byte) );
  
-      if (byte==prompt[i]) {i++;} else i=0;            /*  check if the current byte matches the expected byte from the prompt */
-
-      if (i>=promptLen) {status=1; break;}             /*  prompt string has been found if the index (i) matches its length */
-
-      if (n<0 || n>25) {T=time((time_t*)0); n=0;} else n++; /* don't allow too many bytes to be read between time checks */
+    if (byte==prompt[i]) {i++;} else i=0;              /*  check if the current byte matches the expected byte from the prompt */
 
-    } else {
-
-      T=time((time_t*)0);                                  /* get the current time */
-    }
-  } while (T>=0 && To>=0 && difftime(T,To)<sec);           /* check the termination conditions */
+    if (i>=promptLen) {status=1; break;}               /*  prompt string has been found if the index (i) matches its length */
+  }
       
   if (status<=0) {
     syslog_out( SYSLOG_ERROR, FuncName, "Prompt [%s] not received.", prompt);
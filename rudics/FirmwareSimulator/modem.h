@@ -39,12 +39,17 @@ uint16_t MDM_OBytes();
 //           0 : failed to put
 //          -1 : error
 int16_t MDM_putb( char  byte );
-//  MDM_putb
+//  MDM_getb (does not wait)
 //    return 1 : byte gotten
 //           0 : failed to get a byte
 //          -1 : error
 int16_t MDM_getb( char* byte );
 
+//  read 'size' bytes from modem into buf, waiting at most msec milliseconds
+//  returns -1 if no carrier at modem 
+//        n>=0 else number of bytes read, n<size if timed out
+int16_t MDM_getn  ( void* buf, int size, int32_t msec );
+
 //  read up to 'size' bytes from modem, put into buf
 //  returns -1 if no carrier at modem 
 //        n>=0 else number of bytes read
@@ -72,6 +77,10 @@ int16_t MDM_putbuf( const void* buf, int size, time_t sec );
 //          >0 if exchange was successful
 int16_t MDM_chat( const char* cmd, const char* expect, time_t sec, const char *trm );
 
+//  read until prompt is received, then write response and trm
+//  returns -1 if prompt is empty
+//         ==0 if prompt not received or response not written
+//          >0 if exchange was successful
 int16_t MDM_expect( const char *prompt, const char *response, time_t sec, const char *trm );
 
 # endif
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pty.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// the FIFOs of the former relay loop
+using namespace std;
+#include <list>
+#include <queue>
+
+#include "relay.h"
+
+#define LEADER "Rudics relay loopback benchmark [SwiftWare]"
+
+// prototypes for functions with static linkage
+static int    Bench(const char *name, int mode, size_t nbytes);
+static double Now(void);
+static void   PrintUsage(const char *progname);
+static int    RelayFifo(int rfd, int mfd, RelayStats *stats);
+
+/*========================================================================*/
+/* Push data each way through socket -> relay -> pseudo-tty and back      */
+/*========================================================================*/
+/**
+   The relay runs in a child process between one end of a socketpair and
+   the master of a raw pseudo-tty.  The parent writes to the other end of
+   the socketpair and to the slave, and reads what comes out at the
+   opposite ends.  Reported are the syscalls made by the relay per KB of
+   relayed data, for the former per-byte FIFO loop and the ring buffers,
+   without and with splice().
+*/
+int main(int argc, char **argv)
+{
+   size_t megabytes=10; char opt;
+
+   for (opterr=0; (opt=getopt(argc,argv,"?hm:"))!=EOF;)
+   {
+      switch (opt)
+      {
+         case 'm': {megabytes=atol(optarg); if (!megabytes) megabytes=1; break;}
+         default: {PrintUsage(argv[0]); return 0;}
+      }
+   }
+
+   signal(SIGPIPE,SIG_IGN);
+
+   printf("relay,bytes_each_way,seconds,MB_per_s,syscalls,syscalls_per_KB,splice\n");
+
+   int status=0;
+   status|=Bench("fifo",  0,megabytes<<20);
+   status|=Bench("ring",  1,megabytes<<20);
+   status|=Bench("splice",2,megabytes<<20);
+
+   return status;
+}
+
+/*------------------------------------------------------------------------*/
+/* run one relay variant, verify the data, print a CSV line               */
+/*------------------------------------------------------------------------*/
+static int Bench(const char *name, int mode, size_t nbytes)
+{
+   int sv[2],mfd,sfd;
+
+   if (socketpair(AF_UNIX,SOCK_STREAM,0,sv) || openpty(&mfd,&sfd,NULL,NULL,NULL))
+   {
+      perror("socketpair/openpty"); return 1;
+   }
+
+   // binary transparent pseudo-tty
+   struct termios tio; tcgetattr(sfd,&tio); cfmakeraw(&tio); tcsetattr(sfd,TCSANOW,&tio);
+
+   // the relay reports its counters through shared memory
+   RelayStats *stats=(RelayStats *)mmap(NULL,sizeof(RelayStats),PROT_READ|PROT_WRITE,
+                                        MAP_SHARED|MAP_ANONYMOUS,-1,0);
+   memset(stats,0,sizeof(*stats));
+
+   double t0=Now();
+
+   pid_t pid=fork();
+   if (!pid)
+   {
+      close(sv[1]); close(sfd);
+      int rv = mode ? relay(sv[0],mfd,mode==2,stats) : RelayFifo(sv[0],mfd,stats);
+      _exit(rv ? 1 : 0);
+   }
+   close(sv[0]); close(mfd);
+
+   int n=1; ioctl(sv[1],FIONBIO,&n); ioctl(sfd,FIONBIO,&n);
+
+   // a pattern that catches loss, duplication and reordering
+   unsigned char *out=(unsigned char *)malloc(nbytes), *in[2];
+   for (size_t i=0; i<nbytes; i++) out[i]=(unsigned char)(i*7+(i>>8));
+   in[0]=(unsigned char *)malloc(nbytes); in[1]=(unsigned char *)malloc(nbytes);
+
+   // [0]: socket -> pty slave,  [1]: pty slave -> socket
+   size_t sent[2]={0,0}, rcvd[2]={0,0};
+   int wfd[2]={sv[1],sfd}, rfd[2]={sfd,sv[1]};
+
+   while (rcvd[0]<nbytes || rcvd[1]<nbytes)
+   {
+      struct pollfd pfd[2]; pfd[0].fd=sv[1]; pfd[1].fd=sfd;
+      pfd[0].events=pfd[1].events=POLLIN;
+      if (sent[0]<nbytes) pfd[0].events|=POLLOUT;
+      if (sent[1]<nbytes) pfd[1].events|=POLLOUT;
+
+      if (poll(pfd,2,5000)<=0) {fprintf(stderr,"%s: stalled\n",name); break;}
+
+      for (int d=0; d<2; d++)
+      {
+         if (sent[d]<nbytes)
+         {
+            ssize_t w=write(wfd[d],out+sent[d],nbytes-sent[d]>16384 ? 16384 : nbytes-sent[d]);
+            if (w>0) sent[d]+=w;
+         }
+         ssize_t r=read(rfd[d],in[d]+rcvd[d],nbytes-rcvd[d]);
+         if (r>0) rcvd[d]+=r;
+      }
+   }
+
+   double t1=Now();
+
+   // closing the socket ends the relay
+   close(sv[1]); close(sfd);
+   int status; waitpid(pid,&status,0);
+
+   int bad = rcvd[0]!=nbytes || rcvd[1]!=nbytes ||
+             memcmp(in[0],out,nbytes) || memcmp(in[1],out,nbytes);
+
+   double kb=2.0*nbytes/1024.0;
+   printf("%s,%zu,%.3f,%.1f,%lu,%.3f,%d%d%s\n",name,nbytes,t1-t0,2.0*nbytes/(t1-t0)/1e6,
+          stats->syscalls,stats->syscalls/kb,stats->splice[0],stats->splice[1],bad?",CORRUPT":"");
+
+   munmap(stats,sizeof(RelayStats)); free(out); free(in[0]); free(in[1]);
+
+   return bad;
+}
+
+static double Now(void)
+{
+   struct timespec ts; clock_gettime(CLOCK_MONOTONIC,&ts);
+   return ts.tv_sec+1e-9*ts.tv_nsec;
+}
+
+static void PrintUsage(const char *progname)
+{
+   printf("%s\n",LEADER);
+   printf("usage: %s -h -? -m[MB]\n",progname);
+   printf("        -h, -?   Print this usage summary.\n");
+   printf("        -m[MB]   Megabytes pushed each way [default: 10].\n");
+}
+
+/*------------------------------------------------------------------------*/
+/* the relay loop as it was before the ring buffers, for reference        */
+/*------------------------------------------------------------------------*/
+/**
+   Unchanged except for the syscall counters and for returning at
+   end-of-file (the former loop only ended with SIGCHLD).
+*/
+static int RelayFifo(int rfd, int mfd, RelayStats *stats)
+{
+   char byte,buf[1024]; int n=1;
+
+   // enable nonblocking mode for stdio and the pseudo-tty
+   ioctl(rfd,FIONBIO,&n); ioctl(mfd,FIONBIO,&n);
+
+   // create 2 FIFOs to buffer the IO
+   queue<char,list<char> > RemToLoc,LocToRem;
+
+   int maxfd = rfd>mfd ? rfd : mfd;
+
+   while (1)
+   {
+      fd_set rbits,wbits; FD_ZERO(&rbits); FD_ZERO(&wbits);
+
+      if (!RemToLoc.empty()) FD_SET(mfd,&wbits); else FD_SET(rfd,&rbits);
+      if (!LocToRem.empty()) FD_SET(rfd,&wbits); else FD_SET(mfd,&rbits);
+
+      stats->syscalls++;
+      if (select(maxfd+1,&rbits,&wbits,NULL,NULL)<0)
+      {
+         if (errno==EINTR) continue;
+         return -1;
+      }
+
+      if (FD_ISSET(rfd,&rbits))
+      {
+         stats->syscalls++;
+         n=read(rfd,buf,sizeof(buf));
+         if (n==0) return 0;
+         if (n>0) {for (int i=0; i<n; i++) RemToLoc.push(buf[i]); FD_SET(mfd,&wbits);}
+      }
+
+      if (FD_ISSET(mfd,&wbits))
+      {
+         while (!RemToLoc.empty())
+         {
+            byte = RemToLoc.front();
+            stats->syscalls++;
+            if (write(mfd,&byte,1)>0) {RemToLoc.pop(); stats->rem2loc++;} else break;
+         }
+      }
+
+      if (FD_ISSET(mfd,&rbits))
+      {
+         stats->syscalls++;
+         n=read(mfd,buf,sizeof(buf));
+         if (n==0 || (n<0 && errno==EIO)) return 0;
+         if (n>0) {for (int i=0; i<n; i++) LocToRem.push(buf[i]); FD_SET(rfd,&wbits);}
+      }
+
+      if (FD_ISSET(rfd,&wbits))
+      {
+         while (!LocToRem.empty())
+         {
+            byte = LocToRem.front();
+            stats->syscalls++;
+            if (write(rfd,&byte,1)>0) {LocToRem.pop(); stats->loc2rem++;} else break;
+         }
+      }
+   }
+}
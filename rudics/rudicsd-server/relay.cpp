@@ -0,0 +1,248 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+
+#include "relay.h"
+
+// one direction of the relay
+struct Channel
+{
+   int src, dst;
+
+   // ring buffer: count bytes starting at head
+   char buf[RELAY_BUFSIZE];
+   size_t head, count;
+
+   // splice path: inpipe bytes are held in the pipe p[]
+   bool splice;
+   int p[2];
+   size_t inpipe;
+
+   bool eof;
+   unsigned long long *bytes;
+};
+
+// prototypes for functions with static linkage
+static ssize_t ChannelFill(Channel *c, RelayStats *s);
+static ssize_t ChannelDrain(Channel *c, RelayStats *s);
+static void    ChannelInit(Channel *c, int src, int dst, bool use_splice, unsigned long long *bytes);
+static void    ChannelUnsplice(Channel *c, RelayStats *s);
+static bool    ChannelWantsRead(const Channel *c);
+static bool    ChannelWantsWrite(const Channel *c);
+
+/*------------------------------------------------------------------------*/
+/* relay traffic between the socket (rfd) and the pseudo-tty (mfd)        */
+/*------------------------------------------------------------------------*/
+/**
+   Returns 0 when either side reached end-of-file after buffered data for
+   the other side were delivered, or -1 on an exception.
+*/
+int relay(int rfd, int mfd, bool use_splice, RelayStats *stats)
+{
+   int n=1, status=0;
+
+   RelayStats dummy; if (!stats) stats=&dummy;
+   memset(stats,0,sizeof(*stats));
+
+   // enable nonblocking mode for stdio and the pseudo-tty
+   ioctl(rfd,FIONBIO,&n); ioctl(mfd,FIONBIO,&n);
+
+   // the two channels are too big for the stack of a forked daemon
+   static Channel RemToLoc, LocToRem;
+   ChannelInit(&RemToLoc,rfd,mfd,use_splice,&stats->rem2loc);
+   ChannelInit(&LocToRem,mfd,rfd,use_splice,&stats->loc2rem);
+
+   Channel *chan[2] = {&RemToLoc,&LocToRem};
+
+   while (1)
+   {
+      // stop once a side is closed and its data were delivered
+      if ((RemToLoc.eof && !ChannelWantsWrite(&RemToLoc)) ||
+          (LocToRem.eof && !ChannelWantsWrite(&LocToRem))) break;
+
+      // initialize the controlling file-descriptor bits
+      fd_set rbits,wbits; FD_ZERO(&rbits); FD_ZERO(&wbits); int maxfd=-1;
+
+      // read only while the channel has room, write only while it holds data
+      for (int i=0; i<2; i++)
+      {
+         if (ChannelWantsRead(chan[i]))  {FD_SET(chan[i]->src,&rbits); if (chan[i]->src>maxfd) maxfd=chan[i]->src;}
+         if (ChannelWantsWrite(chan[i])) {FD_SET(chan[i]->dst,&wbits); if (chan[i]->dst>maxfd) maxfd=chan[i]->dst;}
+      }
+
+      // multiplexed input model
+      stats->syscalls++;
+      if (select(maxfd+1,&rbits,&wbits,NULL,NULL)<0)
+      {
+         // ignore the error if select() was interrupted
+         if (errno==EINTR) continue;
+
+         status=-1; break;
+      }
+
+      for (int i=0; i<2; i++)
+      {
+         Channel *c=chan[i];
+
+         if (FD_ISSET(c->src,&rbits))
+         {
+            ssize_t r=ChannelFill(c,stats);
+
+            // a pseudo-tty reports EIO once the slave side is closed
+            if (r==0 || (r<0 && errno==EIO)) c->eof=true;
+            else if (r<0 && errno!=EWOULDBLOCK && errno!=EINTR) {status=-1; break;}
+         }
+
+         if (FD_ISSET(c->dst,&wbits) || ChannelWantsWrite(c))
+         {
+            ssize_t w=ChannelDrain(c,stats);
+
+            if (w<0 && errno!=EWOULDBLOCK && errno!=EINTR) {status=-1; break;}
+         }
+      }
+
+      if (status) break;
+   }
+
+   stats->splice[0]=RemToLoc.splice; stats->splice[1]=LocToRem.splice;
+
+   for (int i=0; i<2; i++)
+   {
+      if (chan[i]->p[0]>=0) {close(chan[i]->p[0]); close(chan[i]->p[1]);}
+   }
+
+   return status;
+}
+
+/*------------------------------------------------------------------------*/
+/* read as much as fits into the channel                                  */
+/*------------------------------------------------------------------------*/
+static ssize_t ChannelFill(Channel *c, RelayStats *s)
+{
+   ssize_t n;
+
+   if (c->splice)
+   {
+      s->syscalls++;
+      n=splice(c->src,NULL,c->p[1],NULL,RELAY_BUFSIZE-c->inpipe,SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+
+      if (n>0) {c->inpipe+=n; return n;}
+
+      // this file type can't be spliced from: continue with the ring
+      if (n<0 && errno==EINVAL) ChannelUnsplice(c,s); else return n;
+   }
+
+   // the free space of the ring, in at most two pieces
+   size_t tail=(c->head+c->count)%RELAY_BUFSIZE, avail=RELAY_BUFSIZE-c->count;
+   struct iovec iov[2]; int niov=0;
+
+   iov[niov].iov_base=c->buf+tail;
+   iov[niov].iov_len=(tail+avail<=RELAY_BUFSIZE) ? avail : RELAY_BUFSIZE-tail;
+   niov++;
+
+   if (iov[0].iov_len<avail) {iov[niov].iov_base=c->buf; iov[niov].iov_len=avail-iov[0].iov_len; niov++;}
+
+   s->syscalls++;
+   n=readv(c->src,iov,niov);
+
+   if (n>0) c->count+=n;
+
+   return n;
+}
+
+/*------------------------------------------------------------------------*/
+/* write as much of the channel content as the destination accepts        */
+/*------------------------------------------------------------------------*/
+static ssize_t ChannelDrain(Channel *c, RelayStats *s)
+{
+   ssize_t n;
+
+   if (c->inpipe)
+   {
+      s->syscalls++;
+      n=splice(c->p[0],NULL,c->dst,NULL,c->inpipe,SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+
+      if (n>0) {c->inpipe-=n; *c->bytes+=n; return n;}
+
+      // this file type can't be spliced to: continue with the ring
+      if (n<0 && errno==EINVAL) ChannelUnsplice(c,s); else return n;
+   }
+
+   if (!c->count) return 0;
+
+   // the content of the ring, in at most two pieces
+   struct iovec iov[2]; int niov=0;
+
+   iov[niov].iov_base=c->buf+c->head;
+   iov[niov].iov_len=(c->head+c->count<=RELAY_BUFSIZE) ? c->count : RELAY_BUFSIZE-c->head;
+   niov++;
+
+   if (iov[0].iov_len<c->count) {iov[niov].iov_base=c->buf; iov[niov].iov_len=c->count-iov[0].iov_len; niov++;}
+
+   s->syscalls++;
+   n=writev(c->dst,iov,niov);
+
+   if (n>0)
+   {
+      c->head=(c->head+n)%RELAY_BUFSIZE; c->count-=n; *c->bytes+=n;
+      if (!c->count) c->head=0;
+   }
+
+   return n;
+}
+
+/*------------------------------------------------------------------------*/
+/* initialize a channel; the splice pipe is created on request            */
+/*------------------------------------------------------------------------*/
+static void ChannelInit(Channel *c, int src, int dst, bool use_splice, unsigned long long *bytes)
+{
+   c->src=src; c->dst=dst;
+   c->head=0; c->count=0;
+   c->splice=false; c->p[0]=c->p[1]=-1; c->inpipe=0;
+   c->eof=false; c->bytes=bytes;
+
+   if (use_splice && !pipe2(c->p,O_NONBLOCK))
+   {
+      // a pipe of RELAY_BUFSIZE always fits into an empty ring
+      fcntl(c->p[1],F_SETPIPE_SZ,RELAY_BUFSIZE);
+      c->splice=true;
+   }
+}
+
+/*------------------------------------------------------------------------*/
+/* leave the splice path, moving data still held in the pipe to the ring  */
+/*------------------------------------------------------------------------*/
+static void ChannelUnsplice(Channel *c, RelayStats *s)
+{
+   c->splice=false;
+
+   while (c->inpipe)
+   {
+      size_t tail=(c->head+c->count)%RELAY_BUFSIZE;
+      size_t len=RELAY_BUFSIZE-tail; if (len>c->inpipe) len=c->inpipe;
+
+      s->syscalls++;
+      ssize_t n=read(c->p[0],c->buf+tail,len);
+      if (n<=0) break;
+
+      c->count+=n; c->inpipe-=n;
+   }
+}
+
+/*------------------------------------------------------------------------*/
+/* channel conditions for select()                                        */
+/*------------------------------------------------------------------------*/
+static bool ChannelWantsRead(const Channel *c)
+{
+   if (c->eof) return false;
+   return c->splice ? c->inpipe<RELAY_BUFSIZE : c->count<RELAY_BUFSIZE;
+}
+
+static bool ChannelWantsWrite(const Channel *c)
+{
+   return c->inpipe || c->count;
+}
@@ -0,0 +1,43 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+/*========================================================================*/
+/* Relay between the rudics socket and the pseudo-tty of the login shell  */
+/*========================================================================*/
+/**
+   Each direction is buffered in a fixed-capacity ring that is filled with
+   a single readv() and drained with a single writev(), so that a burst of
+   modem data costs a few syscalls instead of one write() per byte.
+
+   Optionally, data are moved through a pipe with splice() and never copied
+   to user space.  Not all file types support splice (e.g., pseudo-ttys on
+   recent kernels); a direction where splice() fails with EINVAL silently
+   falls back to its ring.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+// capacity of each ring and of each splice pipe
+#define RELAY_BUFSIZE 65536
+
+// counters kept while relaying
+typedef struct RelayStats
+{
+   unsigned long syscalls;      // select, read(v), write(v), splice
+   unsigned long long rem2loc;  // bytes socket -> pseudo-tty
+   unsigned long long loc2rem;  // bytes pseudo-tty -> socket
+   bool splice[2];              // splice in use at return (rem2loc, loc2rem)
+} RelayStats;
+
+// relay until either side reaches end-of-file or fails
+int relay(int rfd, int mfd, bool use_splice, RelayStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RELAY_H */
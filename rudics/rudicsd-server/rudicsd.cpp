@@ -19,10 +19,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
-// STL list-based queues are used as FIFOs in rudicsd()
-using namespace std;
-#include <list>
-#include <queue>
+#include "relay.h"
 
 #define LEADER "Iridium RUDICS server [SwiftWare]"
 #define VERSION "$Revision: 0.4 $ $Date: 2009/03/10 17:09:55 $"
@@ -56,6 +53,7 @@ static char tty[1024];
 static time_t To=0L;
 static time_t RudicsdTimeout=900L;
 static bool RudicsLog=true;
+static bool RudicsSplice=false;
 static struct sockaddr_in host;
 static char hostaddr[128];
 
@@ -105,7 +103,7 @@ int main(int argc, char **argv)
    if (argv[0]) progname=argv[0];
 
    // circulate through the command line arguements
-   for (opterr=0; (opt=getopt(argc,argv,"?hit:"))!=EOF;)
+   for (opterr=0; (opt=getopt(argc,argv,"?hist:"))!=EOF;)
    {
       switch (opt)
       {
@@ -115,6 +113,9 @@ int main(int argc, char **argv)
          // inhibit syslog-ing to /var/log/rudics.log
          case 'i': {RudicsLog=false; break;}
 
+         // relay through pipes with splice() where the kernel supports it
+         case 's': {RudicsSplice=true; break;}
+
          // specify the timeout for the iridium orphan killer
          case 't':
          {
@@ -131,7 +132,7 @@ int main(int argc, char **argv)
          }
 
          // write the usage string to the syslogx
-         default: {RudicsLog=false; syserr("usage: %s -? -h -i -t[Min]\n",progname);}
+         default: {RudicsLog=false; syserr("usage: %s -? -h -i -s -t[Min]\n",progname);}
       }
    }
    
@@ -323,9 +324,10 @@ static void metachar(unsigned char c,utsname *uts)
 static void PrintUsage(void)
 {
    printf("%s\n%s\n",LEADER,VERSION);
-   printf("usage: %s -h -? -i -t[Min]\n",progname);
+   printf("usage: %s -h -? -i -s -t[Min]\n",progname);
    printf("        -h, -?   Print this usage summary.\n");
    printf("            -i   Inhibit syslog entries in /var/log/rudics.log.\n");
+   printf("            -s   Relay data with splice() where supported.\n");
    printf("       -t[Min]   This option implements a financial safety valve that\n"
           "                    will kill the RUDICS server after a specified number\n"
           "                    of minutes so that orphaned Iridium connections won't\n"
@@ -341,115 +343,23 @@ static void PrintUsage(void)
 /*------------------------------------------------------------------------*/
 void rudicsd(int mfd)
 {
-   char byte,buf[1024]; int n=1; const int rfd=0;
-
-   // enable nonblocking mode for stdio and the pseudo-tty
-   ioctl(rfd,FIONBIO,&n); ioctl(mfd,FIONBIO,&n);
-
-   // create 2 FIFOs to buffer the IO
-   queue<char,list<char> > RemToLoc,LocToRem;
+   const int rfd=0; RelayStats stats;
 
    // make a syslog entry that a rudics connection is initated 
    To=time(NULL); sysmsg("Rudics connection initiated[%s]:  "
                          "UnixEpoch: %lds",hostaddr,To);
-   
-   while (1)
-   {
-      // initialize the controlling file-descriptor bits
-      fd_set rbits,wbits; FD_ZERO(&rbits); FD_ZERO(&wbits);
 
-      // these conditionals keep the FIFOs from becoming larger than 1024 bytes
-      if (!RemToLoc.empty()) FD_SET(mfd,&wbits); else FD_SET(rfd,&rbits);
-      if (!LocToRem.empty()) FD_SET(rfd,&wbits); else FD_SET(mfd,&rbits);
-
-      // multiplexed input model
-      switch (select(mfd+1,&rbits,&wbits,NULL,NULL))
-      {
-         // exceptional conditions
-         case -1:
-         {
-            // ignore the error if select() was interrupted
-            if (errno==EINTR) continue;
-
-            // log the execption and crash out
-            syserr("Exceptional condition [%d] encountered: %s\n",
-                    errno,strerror(errno));
-         }
-
-         // this shouldn't happen because select() uses a blocking model
-         case  0: {sleep(5); continue;}
-
-         default:
-         {
-            // check if input is ready at the socket
-            if (FD_ISSET(rfd,&rbits))
-            {
-               // read from the socket into the buffer
-               n=read(rfd,buf,sizeof(buf));
-
-               // check if no bytes were available
-               if (n<0 && errno==EWOULDBLOCK) continue;
-
-               // check for exceptions
-               if (n<=0) break;
-
-               // add the bytes to the FIFO
-               for (int i=0; i<n; i++) RemToLoc.push(buf[i]);
-
-               // indicate that bytes should be written to the pseudo-tty
-               FD_SET(mfd,&wbits);
-            }
-
-            // check condition for writing to the pseudo-tty
-            if (FD_ISSET(mfd,&wbits))
-            {
-               // attempt to write the whole FIFO
-               while (!RemToLoc.empty())
-               {
-                  // get the next byte from the FIFO
-                  byte = RemToLoc.front();
-
-                  // write the byte to the pseudo-tty
-                  if (write(mfd,&byte,1)>0) {RemToLoc.pop();} else break;
-               }
-            }
-            
-            // check condition for reading from the pseudo-tty
-            if (FD_ISSET(mfd,&rbits))
-            {
-               // read from the pseudo-tty into the buffer
-               n=read(mfd,buf,sizeof(buf));
-               
-               // check if no bytes were available
-               if (n<0 && errno==EWOULDBLOCK) continue;
-
-               // check for exceptions
-               if (n<=0) break;
-
-               // add the bytes to the FIFO
-               for (int i=0; i<n; i++) LocToRem.push(buf[i]);
-
-               // indicate that bytes should be written to the socket
-               FD_SET(rfd,&wbits);
-            }
-
-            // check condition for writing to the socket
-            if (FD_ISSET(rfd,&wbits))
-            {
-               // attempt to write the whole FIFO
-               while (!LocToRem.empty())
-               {
-                  // get the next byte from the FIFO
-                  byte = LocToRem.front();
-
-                  // write the byte to the socket
-                  if (write(rfd,&byte,1)>0) LocToRem.pop(); else break;
-               }
-            }
-         }
-      }
+   // buffer the IO between socket and pseudo-tty until either side closes
+   if (relay(rfd,mfd,RudicsSplice,&stats)<0)
+   {
+      // log the execption and crash out
+      syserr("Exceptional condition [%d] encountered: %s\n",
+             errno,strerror(errno));
    }
 
+   sysmsg("Rudics relay[%s]: %llu bytes in, %llu bytes out, %lu syscalls",
+          hostaddr,stats.rem2loc,stats.loc2rem,stats.syscalls);
+
    // ignore SIGCHLD signals
    signal(SIGCHLD,SIG_IGN);
 